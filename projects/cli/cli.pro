@@ -22,7 +22,7 @@ mac {
     CONFIG -= app_bundle
 }
 
-QT = core
+QT = core network sql
 
 # Code
 include(src/src.pri)
@@ -0,0 +1,91 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Allocation hooks for builds with CONFIG+=alloc_stats. They are in
+ * the executable so that they replace the allocation functions of the
+ * whole process, including the library and Qt.
+ *
+ * With glibc the malloc family is replaced, which also covers
+ * operator new and the buffers of Qt's containers. Elsewhere only
+ * operator new is replaced, so the container buffers are not counted.
+ */
+
+#include <allocationstats.h>
+
+#ifdef CUTECHESS_ALLOC_STATS
+
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+
+extern "C" {
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size)
+{
+	AllocationStats::addAllocation(size);
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+	AllocationStats::addAllocation(count * size);
+	return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+	AllocationStats::addAllocation(size);
+	return __libc_realloc(ptr, size);
+}
+
+} // extern "C"
+
+#else // not __GLIBC__
+
+void* operator new(std::size_t size)
+{
+	AllocationStats::addAllocation(size);
+	void* ptr = std::malloc(size != 0 ? size : 1);
+	if (ptr == 0)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* ptr) throw()
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) throw()
+{
+	std::free(ptr);
+}
+
+#endif // not __GLIBC__
+
+#endif // CUTECHESS_ALLOC_STATS
@@ -0,0 +1,282 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "bookmaker.h"
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QtAlgorithms>
+#include <pgnstream.h>
+#include <pgngame.h>
+#include <polyglotbook.h>
+
+// The minimum number of unmerged records a worker keeps before
+// merging them with its table
+static const int s_minPendingCount = 1 << 20;
+
+
+static quint32 packMove(const Chess::GenericMove& move)
+{
+	const Chess::Square source(move.sourceSquare());
+	const Chess::Square target(move.targetSquare());
+
+	return quint32(source.file() + 1)
+	     | (quint32(source.rank() + 1) << 6)
+	     | (quint32(target.file() + 1) << 12)
+	     | (quint32(target.rank() + 1) << 18)
+	     | (quint32(move.promotion()) << 24);
+}
+
+static Chess::GenericMove unpackMove(quint32 data)
+{
+	return Chess::GenericMove(
+		Chess::Square(int(data & 0x3F) - 1, int((data >> 6) & 0x3F) - 1),
+		Chess::Square(int((data >> 12) & 0x3F) - 1, int((data >> 18) & 0x3F) - 1),
+		int(data >> 24));
+}
+
+
+// A Polyglot book that can be filled with finished entries
+class BookWriter : public PolyglotBook
+{
+	public:
+		void add(quint64 key, const Chess::GenericMove& move, quint16 weight)
+		{
+			Entry entry = { move, weight };
+			addEntry(entry, key);
+		}
+};
+
+
+BookMaker::BookMaker(const QString& fileName)
+	: m_file(fileName),
+	  m_depth(30),
+	  m_weightPolicy(Score),
+	  m_minGames(1)
+{
+}
+
+BookMaker::~BookMaker()
+{
+}
+
+void BookMaker::setDepth(int plies)
+{
+	Q_ASSERT(plies > 0);
+	m_depth = plies;
+}
+
+void BookMaker::setWeightPolicy(WeightPolicy policy)
+{
+	m_weightPolicy = policy;
+}
+
+void BookMaker::setMinGames(int count)
+{
+	Q_ASSERT(count > 0);
+	m_minGames = count;
+}
+
+void BookMaker::runJob(int index)
+{
+	int worker = workerIndex();
+	readChunk(m_chunks.at(index),
+		  &m_tables[worker],
+		  &m_pending[worker],
+		  &m_games[worker]);
+}
+
+void BookMaker::readChunk(const PgnFileBuffer::Chunk& chunk,
+			  Table* table,
+			  Table* pending,
+			  int* games) const
+{
+	// The chunk is read in place, without copying it
+	const QByteArray data(QByteArray::fromRawData(m_file.data() + chunk.start,
+						      int(chunk.size)));
+	PgnStream in(&data);
+	PgnGame game;
+
+	while (game.read(in, m_depth))
+	{
+		// Polyglot keys only exist for standard chess
+		if (game.variant() != "standard" || game.moves().isEmpty())
+			continue;
+
+		addGame(game, pending);
+		(*games)++;
+
+		if (pending->size() >= qMax(s_minPendingCount, table->size()))
+			merge(table, pending);
+	}
+}
+
+void BookMaker::addGame(const PgnGame& game, Table* pending) const
+{
+	const Chess::Result result(game.result());
+	const Chess::Side winner(result.winner());
+	Chess::Side side(game.startingSide());
+
+	foreach (const PgnGame::MoveData& md, game.moves())
+	{
+		Record record = { md.key, packMove(md.move), 1, 0, 0 };
+		if (result.isDraw())
+			record.draws = 1;
+		else if (side == winner)
+			record.wins = 1;
+		pending->append(record);
+
+		side = side.opposite();
+	}
+}
+
+quint32 BookMaker::weight(const Record& record) const
+{
+	switch (m_weightPolicy)
+	{
+	case GameCount:
+		return record.games;
+	case WinCount:
+		return record.wins;
+	default:
+		return record.wins * 2 + record.draws;
+	}
+}
+
+bool BookMaker::recordLessThan(const Record& a, const Record& b)
+{
+	if (a.key != b.key)
+		return a.key < b.key;
+	return a.move < b.move;
+}
+
+void BookMaker::merge(Table* table, Table* pending)
+{
+	if (pending->isEmpty())
+		return;
+
+	qSort(pending->begin(), pending->end(), recordLessThan);
+
+	// Merge the sorted records and combine the duplicates
+	Table merged;
+	merged.reserve(table->size() + pending->size());
+	Table::const_iterator a = table->constBegin();
+	Table::const_iterator b = pending->constBegin();
+	while (a != table->constEnd() || b != pending->constEnd())
+	{
+		const Record* next;
+		if (b == pending->constEnd()
+		||  (a != table->constEnd() && !recordLessThan(*b, *a)))
+			next = &*a++;
+		else
+			next = &*b++;
+
+		if (!merged.isEmpty()
+		&&  merged.last().key == next->key
+		&&  merged.last().move == next->move)
+		{
+			Record& last = merged.last();
+			last.games += next->games;
+			last.wins += next->wins;
+			last.draws += next->draws;
+		}
+		else
+			merged.append(*next);
+	}
+
+	*table = merged;
+	pending->clear();
+}
+
+bool BookMaker::run(const QString& bookFileName, QTextStream& out)
+{
+	QString error;
+	if (!m_file.open(&error))
+	{
+		out << error << endl;
+		return false;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+
+	m_chunks = m_file.split(threadCount());
+
+	m_tables.fill(Table(), threadCount());
+	m_pending.fill(Table(), threadCount());
+	m_games.fill(0, threadCount());
+	runJobs(m_chunks.size());
+
+	// Merge the tables of the threads
+	Table table;
+	int games = 0;
+	for (int i = 0; i < threadCount(); i++)
+	{
+		merge(&m_tables[i], &m_pending[i]);
+		merge(&table, &m_tables[i]);
+		games += m_games.at(i);
+	}
+	m_tables.clear();
+	m_pending.clear();
+	m_games.clear();
+	m_chunks.clear();
+	m_file.close();
+
+	// Polyglot weights are 16 bits wide, so big weights are scaled
+	quint32 maxWeight = 0;
+	foreach (const Record& record, table)
+	{
+		if (int(record.games) >= m_minGames)
+			maxWeight = qMax(maxWeight, weight(record));
+	}
+
+	BookWriter book;
+	int entries = 0;
+	int positions = 0;
+	quint64 lastKey = 0;
+	foreach (const Record& record, table)
+	{
+		quint32 w = weight(record);
+		if (int(record.games) < m_minGames || w == 0)
+			continue;
+		if (maxWeight > 0xffff)
+			w = qMax(quint32(quint64(w) * 0xffff / maxWeight), quint32(1));
+
+		book.add(record.key, unpackMove(record.move), quint16(w));
+		if (entries == 0 || record.key != lastKey)
+			positions++;
+		lastKey = record.key;
+		entries++;
+	}
+	table.clear();
+
+	if (!book.write(bookFileName))
+	{
+		out << "Can't write opening book " << bookFileName << endl;
+		return false;
+	}
+
+	qint64 elapsed = timer.elapsed();
+	out << "Games: " << games << endl;
+	out << "Positions: " << positions << endl;
+	out << "Book entries: " << entries << endl;
+	out << "Time: " << elapsed << " ms" << endl;
+	if (elapsed > 0)
+		out << "Games/second: " << qint64(games) * 1000 / elapsed << endl;
+
+	return true;
+}
@@ -0,0 +1,115 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef BOOKMAKER_H
+#define BOOKMAKER_H
+
+#include <QString>
+#include <QVector>
+#include "pgnfilebuffer.h"
+#include "workerpool.h"
+class QTextStream;
+class PgnGame;
+
+/*!
+ * \brief A multithreaded Polyglot opening book builder.
+ *
+ * BookMaker reads the games of a PGN file and writes the moves
+ * played in their first plies to a Polyglot book. The file is split
+ * into chunks at game boundaries, and the chunks are parsed by worker
+ * threads. Each thread collects the moves in its own table, and the
+ * tables are merged when all the games are read.
+ */
+class BookMaker : public WorkerPool
+{
+	public:
+		/*! The policy for weighting the book moves. */
+		enum WeightPolicy
+		{
+			/*! The weight is the number of games played. */
+			GameCount,
+			/*!
+			 * The weight is the score of the moving side, with
+			 * two points for each win and one for each draw.
+			 */
+			Score,
+			/*! The weight is the number of games won. */
+			WinCount
+		};
+
+		/*! Creates a new BookMaker for the PGN file \a fileName. */
+		BookMaker(const QString& fileName);
+		/*! Destroys the BookMaker object. */
+		~BookMaker();
+
+		/*!
+		 * Sets the maximum book depth to \a plies halfmoves.
+		 * The default is 30.
+		 */
+		void setDepth(int plies);
+		/*! Sets the weighting policy. The default is \a Score. */
+		void setWeightPolicy(WeightPolicy policy);
+		/*!
+		 * Sets the minimum number of games a move must be played
+		 * in to be included in the book to \a count. The default
+		 * is 1.
+		 */
+		void setMinGames(int count);
+
+		/*!
+		 * Builds the book, writes it to \a bookFileName and writes
+		 * statistics to \a out. Returns true if successful.
+		 */
+		bool run(const QString& bookFileName, QTextStream& out);
+
+	protected:
+		// Inherited from WorkerPool
+		virtual void runJob(int index);
+
+	private:
+		// The statistics of a move in a position
+		struct Record
+		{
+			quint64 key;
+			quint32 move;
+			quint32 games;
+			quint32 wins;
+			quint32 draws;
+		};
+		typedef QVector<Record> Table;
+
+		void readChunk(const PgnFileBuffer::Chunk& chunk,
+			       Table* table,
+			       Table* pending,
+			       int* games) const;
+		void addGame(const PgnGame& game, Table* pending) const;
+		quint32 weight(const Record& record) const;
+		static bool recordLessThan(const Record& a, const Record& b);
+		static void merge(Table* table, Table* pending);
+
+		PgnFileBuffer m_file;
+		int m_depth;
+		WeightPolicy m_weightPolicy;
+		int m_minGames;
+		QVector<PgnFileBuffer::Chunk> m_chunks;
+		QVector<Table> m_tables;
+		QVector<Table> m_pending;
+		QVector<int> m_games;
+};
+
+#endif // BOOKMAKER_H
@@ -0,0 +1,513 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "broadcastserver.h"
+#include <QCryptographicHash>
+#include <QHostAddress>
+#include <QSet>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <chessgame.h>
+#include <chessplayer.h>
+#include <pgngame.h>
+#include <timecontrol.h>
+#include <tournament.h>
+#include <jsonwriter.h>
+
+static const int s_maxRequestSize = 8192;
+
+// Clients with more unsent data than this are disconnected
+static const qint64 s_maxPendingBytes = 4 * 1024 * 1024;
+
+static const char s_webSocketGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+enum FrameOpcode
+{
+	TextFrame = 0x1,
+	CloseFrame = 0x8,
+	PingFrame = 0x9,
+	PongFrame = 0xA
+};
+
+static QByteArray webSocketFrame(const char* payload, int size, int opcode)
+{
+	QByteArray frame;
+	frame.reserve(size + 10);
+	frame += char(0x80 | opcode);
+	if (size < 126)
+		frame += char(size);
+	else if (size < 0x10000)
+	{
+		frame += char(126);
+		frame += char(size >> 8);
+		frame += char(size & 0xFF);
+	}
+	else
+	{
+		frame += char(127);
+		for (int i = 7; i >= 0; i--)
+			frame += char((quint64(size) >> (i * 8)) & 0xFF);
+	}
+	frame.append(payload, size);
+	return frame;
+}
+
+// Returns the writer's record as a text frame without the newline
+static QByteArray textFrame(const JsonWriter& writer)
+{
+	const QByteArray& data = writer.data();
+	int size = data.size();
+	if (size > 0 && data.at(size - 1) == '\n')
+		size--;
+	return webSocketFrame(data.constData(), size, TextFrame);
+}
+
+static void writeClocks(JsonWriter& writer, const ChessGame* game)
+{
+	writer.writeName("clock");
+	writer.beginArray();
+	writer.writeValue(game->player(Chess::Side::White)->timeControl()->timeLeft());
+	writer.writeValue(game->player(Chess::Side::Black)->timeControl()->timeLeft());
+	writer.endArray();
+}
+
+
+class BroadcastSocketServer : public QObject
+{
+	Q_OBJECT
+
+	public:
+		BroadcastSocketServer()
+			: m_server(0)
+		{
+		}
+
+	public slots:
+		bool listen(const QString& host, int port)
+		{
+			QHostAddress address(QHostAddress::LocalHost);
+			if (!host.isEmpty() && host != "localhost"
+			&&  !address.setAddress(host))
+			{
+				qWarning("Invalid broadcast server address: %s",
+					 qPrintable(host));
+				return false;
+			}
+
+			m_server = new QTcpServer(this);
+			connect(m_server, SIGNAL(newConnection()),
+				this, SLOT(onNewConnection()));
+			if (!m_server->listen(address, quint16(port)))
+			{
+				qWarning("Can't start the broadcast server: %s",
+					 qPrintable(m_server->errorString()));
+				return false;
+			}
+			return true;
+		}
+
+		void close()
+		{
+			// The sockets are deleted with the server
+			foreach (QTcpSocket* socket, m_buffers.keys())
+				socket->disconnect(this);
+			delete m_server;
+			m_server = 0;
+			m_clients.clear();
+			m_buffers.clear();
+			m_frames.clear();
+		}
+
+		/*!
+		 * Sends \a frame to every client and keeps it for the
+		 * clients that connect later, until \a last marks the
+		 * end of game \a game.
+		 */
+		void broadcast(int game, const QByteArray& frame, bool last)
+		{
+			if (last)
+				m_frames.remove(game);
+			else
+				m_frames[game].append(frame);
+
+			if (frame.isEmpty())
+				return;
+			foreach (QTcpSocket* socket, m_clients)
+				send(socket, frame);
+		}
+
+	private slots:
+		void onNewConnection()
+		{
+			while (QTcpSocket* socket = m_server->nextPendingConnection())
+			{
+				m_buffers[socket] = QByteArray();
+				connect(socket, SIGNAL(readyRead()),
+					this, SLOT(onReadyRead()));
+				connect(socket, SIGNAL(disconnected()),
+					this, SLOT(onDisconnected()));
+			}
+		}
+
+		void onReadyRead()
+		{
+			QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+			Q_ASSERT(socket != 0);
+
+			QByteArray& buffer = m_buffers[socket];
+			buffer += socket->readAll();
+			if (buffer.size() > s_maxRequestSize)
+			{
+				socket->abort();
+				return;
+			}
+
+			if (m_clients.contains(socket))
+				readFrames(socket, buffer);
+			else
+				readHandshake(socket, buffer);
+		}
+
+		void onDisconnected()
+		{
+			QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+			Q_ASSERT(socket != 0);
+
+			m_clients.remove(socket);
+			m_buffers.remove(socket);
+			socket->deleteLater();
+		}
+
+	private:
+		void send(QTcpSocket* socket, const QByteArray& frame)
+		{
+			if (socket->bytesToWrite() > s_maxPendingBytes)
+			{
+				m_clients.remove(socket);
+				socket->abort();
+				return;
+			}
+			socket->write(frame);
+		}
+
+		void readHandshake(QTcpSocket* socket, QByteArray& buffer)
+		{
+			const int end = buffer.indexOf("\r\n\r\n");
+			if (end == -1)
+				return;
+
+			QByteArray key;
+			const QList<QByteArray> lines(buffer.left(end).split('\n'));
+			foreach (const QByteArray& line, lines)
+			{
+				const int colon = line.indexOf(':');
+				if (colon != -1
+				&&  line.left(colon).trimmed().toLower() == "sec-websocket-key")
+					key = line.mid(colon + 1).trimmed();
+			}
+			buffer.remove(0, end + 4);
+
+			if (key.isEmpty() || !lines.first().startsWith("GET "))
+			{
+				socket->write("HTTP/1.1 400 Bad Request\r\n"
+					      "Connection: close\r\n\r\n");
+				socket->disconnectFromHost();
+				return;
+			}
+
+			QByteArray response("HTTP/1.1 101 Switching Protocols\r\n"
+					    "Upgrade: websocket\r\n"
+					    "Connection: Upgrade\r\n"
+					    "Sec-WebSocket-Accept: ");
+			response += QCryptographicHash::hash(key + s_webSocketGuid,
+				QCryptographicHash::Sha1).toBase64();
+			response += "\r\n\r\n";
+			socket->write(response);
+			m_clients.insert(socket);
+
+			// Catch up with the games in progress
+			QMap< int, QList<QByteArray> >::const_iterator it;
+			for (it = m_frames.constBegin(); it != m_frames.constEnd(); ++it)
+			{
+				foreach (const QByteArray& frame, it.value())
+					socket->write(frame);
+			}
+			readFrames(socket, buffer);
+		}
+
+		void readFrames(QTcpSocket* socket, QByteArray& buffer)
+		{
+			for (;;)
+			{
+				if (buffer.size() < 2)
+					return;
+
+				const uchar* data = reinterpret_cast<const uchar*>(buffer.constData());
+				const int opcode = data[0] & 0x0F;
+				const bool masked = (data[1] & 0x80) != 0;
+				qint64 size = data[1] & 0x7F;
+				int pos = 2;
+				if (size >= 126)
+				{
+					const int count = (size == 126) ? 2 : 8;
+					if (buffer.size() < pos + count)
+						return;
+					size = 0;
+					for (int i = 0; i < count; i++)
+						size = (size << 8) | data[pos++];
+				}
+				if (size > s_maxRequestSize)
+				{
+					socket->abort();
+					return;
+				}
+				const int maskPos = pos;
+				if (masked)
+					pos += 4;
+				if (buffer.size() < pos + size)
+					return;
+
+				QByteArray payload(buffer.mid(pos, int(size)));
+				if (masked)
+				{
+					for (int i = 0; i < payload.size(); i++)
+						payload[i] = payload.at(i) ^ data[maskPos + i % 4];
+				}
+				buffer.remove(0, pos + int(size));
+
+				if (opcode == CloseFrame)
+				{
+					m_clients.remove(socket);
+					socket->write(webSocketFrame(payload.constData(),
+								     qMin(payload.size(), 2),
+								     CloseFrame));
+					socket->disconnectFromHost();
+					return;
+				}
+				if (opcode == PingFrame)
+					socket->write(webSocketFrame(payload.constData(),
+								     payload.size(),
+								     PongFrame));
+			}
+		}
+
+		QTcpServer* m_server;
+		QSet<QTcpSocket*> m_clients;
+		QHash<QTcpSocket*, QByteArray> m_buffers;
+		QMap< int, QList<QByteArray> > m_frames;
+};
+
+
+/*!
+ * Builds the messages of a single game in the game's thread.
+ *
+ * The feed is connected directly to the game's signals, so each
+ * message is serialized exactly once, by the thread that played
+ * the move, and the encoded frame is handed over to the socket
+ * server. The feed is a child of the game.
+ */
+class BroadcastFeed : public QObject
+{
+	Q_OBJECT
+
+	public:
+		BroadcastFeed(BroadcastSocketServer* server,
+			      ChessGame* game,
+			      int number)
+			: m_server(server),
+			  m_game(game),
+			  m_number(number),
+			  m_scorePly(-1),
+			  m_score(0),
+			  m_finished(false)
+		{
+			connect(game, SIGNAL(moveEvaluated(int, int)),
+				this, SLOT(onMoveEvaluated(int, int)),
+				Qt::DirectConnection);
+			connect(game, SIGNAL(moveMade(Chess::GenericMove, QString, QString)),
+				this, SLOT(onMoveMade(Chess::GenericMove, QString)),
+				Qt::DirectConnection);
+			connect(game, SIGNAL(finished(ChessGame*)),
+				this, SLOT(onFinished()),
+				Qt::DirectConnection);
+		}
+
+		virtual ~BroadcastFeed()
+		{
+			if (!m_finished)
+				send(QByteArray(), true);
+		}
+
+		/*! Sends the game so far, and its players. */
+		void sendSnapshot()
+		{
+			QByteArray pgn;
+			m_game->pgn()->write(pgn, PgnGame::Verbose);
+
+			m_writer.clear();
+			m_writer.beginObject();
+			m_writer.writeName("type");
+			m_writer.writeValue("game");
+			m_writer.writeName("game");
+			m_writer.writeValue(m_number);
+			m_writer.writeName("white");
+			m_writer.writeValue(m_game->player(Chess::Side::White)->name());
+			m_writer.writeName("black");
+			m_writer.writeValue(m_game->player(Chess::Side::Black)->name());
+			writeClocks(m_writer, m_game);
+			m_writer.writeName("pgn");
+			m_writer.writeValue(QString::fromUtf8(pgn.constData(), pgn.size()));
+			m_writer.endObject();
+			send(textFrame(m_writer), false);
+		}
+
+	private slots:
+		void onMoveEvaluated(int ply, int score)
+		{
+			m_scorePly = ply;
+			m_score = score;
+		}
+
+		void onMoveMade(const Chess::GenericMove& move, const QString& san)
+		{
+			Q_UNUSED(move);
+
+			const int ply = m_game->pgn()->moves().size() - 1;
+			m_writer.clear();
+			m_writer.beginObject();
+			m_writer.writeName("type");
+			m_writer.writeValue("move");
+			m_writer.writeName("game");
+			m_writer.writeValue(m_number);
+			m_writer.writeName("ply");
+			m_writer.writeValue(ply);
+			m_writer.writeName("san");
+			m_writer.writeValue(san);
+			writeClocks(m_writer, m_game);
+			if (m_scorePly == ply)
+			{
+				m_writer.writeName("score");
+				m_writer.writeValue(m_score);
+			}
+			m_writer.endObject();
+			send(textFrame(m_writer), false);
+		}
+
+		void onFinished()
+		{
+			m_writer.clear();
+			m_writer.beginObject();
+			m_writer.writeName("type");
+			m_writer.writeValue("result");
+			m_writer.writeName("game");
+			m_writer.writeValue(m_number);
+			m_writer.writeName("result");
+			m_writer.writeValue(m_game->result().toShortString());
+			m_writer.endObject();
+			send(textFrame(m_writer), true);
+			m_finished = true;
+		}
+
+	private:
+		void send(const QByteArray& frame, bool last)
+		{
+			QMetaObject::invokeMethod(m_server, "broadcast",
+						  Qt::QueuedConnection,
+						  Q_ARG(int, m_number),
+						  Q_ARG(QByteArray, frame),
+						  Q_ARG(bool, last));
+		}
+
+		BroadcastSocketServer* m_server;
+		ChessGame* m_game;
+		int m_number;
+		int m_scorePly;
+		int m_score;
+		bool m_finished;
+		JsonWriter m_writer;
+};
+
+
+BroadcastServer::BroadcastServer(Tournament* tournament, QObject* parent)
+	: QObject(parent),
+	  m_tournament(tournament),
+	  m_server(0)
+{
+	Q_ASSERT(tournament != 0);
+}
+
+BroadcastServer::~BroadcastServer()
+{
+	if (m_thread.isRunning())
+	{
+		QMetaObject::invokeMethod(m_server, "close",
+					  Qt::BlockingQueuedConnection);
+		m_thread.quit();
+		m_thread.wait();
+	}
+	delete m_server;
+}
+
+bool BroadcastServer::listen(const QString& address)
+{
+	Q_ASSERT(m_server == 0);
+
+	const int colon = address.lastIndexOf(':');
+	bool ok = false;
+	const int port = address.mid(colon + 1).toInt(&ok);
+	if (!ok || port <= 0 || port > 65535)
+	{
+		qWarning("Invalid broadcast server port: %s", qPrintable(address));
+		return false;
+	}
+
+	m_server = new BroadcastSocketServer;
+	m_server->moveToThread(&m_thread);
+	m_thread.start();
+
+	QMetaObject::invokeMethod(m_server, "listen",
+				  Qt::BlockingQueuedConnection,
+				  Q_RETURN_ARG(bool, ok),
+				  Q_ARG(QString, address.left(qMax(colon, 0))),
+				  Q_ARG(int, port));
+	return ok;
+}
+
+void BroadcastServer::start()
+{
+	connect(m_tournament, SIGNAL(gameStarted(ChessGame*, int, int, int)),
+		this, SLOT(onGameStarted(ChessGame*, int)));
+}
+
+void BroadcastServer::onGameStarted(ChessGame* game, int number)
+{
+	Q_ASSERT(game != 0);
+
+	// The game is paused so that no move is missed or sent twice
+	// between the snapshot and the first delta
+	game->lockThread();
+
+	BroadcastFeed* feed = new BroadcastFeed(m_server, game, number);
+	feed->moveToThread(game->thread());
+	feed->setParent(game);
+	feed->sendSnapshot();
+
+	game->unlockThread();
+}
+
+#include "broadcastserver.moc"
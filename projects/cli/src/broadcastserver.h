@@ -0,0 +1,72 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef BROADCASTSERVER_H
+#define BROADCASTSERVER_H
+
+#include <QObject>
+#include <QThread>
+
+class ChessGame;
+class Tournament;
+class BroadcastSocketServer;
+
+/*!
+ * \brief A WebSocket server that broadcasts the games being played.
+ *
+ * BroadcastServer lets spectators follow every game of the match
+ * live. When a game starts its clients get a "game" message with
+ * the players and the game so far as PGN, followed by a "move"
+ * message for each new ply with the move in SAN, both clocks and
+ * the mover's evaluation, and a "result" message when the game ends.
+ * Every message is a single line of compact JSON.
+ *
+ * The move messages are built once in the game's thread, directly
+ * as WebSocket frames, and the frames are sent to each client by a
+ * server running in its own thread. The frames of a game in progress
+ * are kept, so clients that connect late are caught up with the
+ * same frames instead of re-serialized games. Clients that can't
+ * keep up are disconnected.
+ */
+class BroadcastServer : public QObject
+{
+	Q_OBJECT
+
+	public:
+		BroadcastServer(Tournament* tournament, QObject* parent = 0);
+		virtual ~BroadcastServer();
+
+		/*!
+		 * Starts listening for WebSocket connections at \a address,
+		 * which is "[HOST:]PORT". The default host is localhost.
+		 * Returns false on failure.
+		 */
+		bool listen(const QString& address);
+		/*! Starts broadcasting the tournament's games. */
+		void start();
+
+	private slots:
+		void onGameStarted(ChessGame* game, int number);
+
+	private:
+		Tournament* m_tournament;
+		QThread m_thread;
+		BroadcastSocketServer* m_server;
+};
+
+#endif // BROADCASTSERVER_H
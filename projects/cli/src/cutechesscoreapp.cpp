@@ -24,6 +24,7 @@
 #include <enginemanager.h>
 #include <gamemanager.h>
 #include <board/gaviotatablebase.h>
+#include "startuptimer.h"
 #include <cstdlib>
 #include <cstdio>
 
@@ -47,12 +48,6 @@ CuteChessCoreApplication::CuteChessCoreApplication(int& argc, char* argv[])
 	#else
 	qInstallMsgHandler(CuteChessCoreApplication::messageHandler);
 	#endif
-
-	// Load the engines
-	QString configFile("engines.json");
-	if (!QFile::exists(configFile))
-		configFile = configPath() + "/" + configFile;
-	engineManager()->loadEngines(configFile);
 }
 
 CuteChessCoreApplication::~CuteChessCoreApplication()
@@ -124,9 +119,19 @@ QString CuteChessCoreApplication::configPath()
 
 EngineManager* CuteChessCoreApplication::engineManager()
 {
+	// The engine configuration is only loaded when it's needed
+	// because many modes don't use it
 	if (m_engineManager == 0)
+	{
+		StartupTimer timer("engine configuration");
 		m_engineManager = new EngineManager(this);
 
+		QString configFile("engines.json");
+		if (!QFile::exists(configFile))
+			configFile = configPath() + "/" + configFile;
+		m_engineManager->loadEngines(configFile);
+	}
+
 	return m_engineManager;
 }
 
@@ -0,0 +1,270 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "endgamegenerator.h"
+#include <cstring>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QVarLengthArray>
+#include <QFile>
+#include <board/board.h>
+#include <board/boardfactory.h>
+#include <mersenne.h>
+#include <openingsuite.h>
+
+
+EndgameGenerator::EndgameGenerator(const QString& material)
+	: m_isValid(false),
+	  m_draws(false),
+	  m_minDtm(0),
+	  m_count(0),
+	  m_attempts(0),
+	  m_maxAttempts(0)
+{
+	QStringList sides = material.split('v');
+	if (sides.size() != 2)
+		return;
+
+	const QString pieceTypes("KQRBNP");
+	for (int i = 0; i < 2; i++)
+	{
+		const QString& side = sides.at(i);
+		if (side.count('K') != 1 || side.count('P') > 8)
+			return;
+
+		foreach (const QChar& c, side)
+		{
+			if (!pieceTypes.contains(c))
+				return;
+			m_pieces += (i == 0) ? c : c.toLower();
+		}
+	}
+
+	m_isValid = m_pieces.size() <= 7;
+}
+
+EndgameGenerator::~EndgameGenerator()
+{
+}
+
+bool EndgameGenerator::isValid() const
+{
+	return m_isValid;
+}
+
+void EndgameGenerator::setDrawsIncluded(bool enabled)
+{
+	m_draws = enabled;
+}
+
+void EndgameGenerator::setMinimumDtm(int plies)
+{
+	Q_ASSERT(plies >= 0);
+	m_minDtm = plies;
+}
+
+void EndgameGenerator::runJob(int index)
+{
+	Q_UNUSED(index);
+
+	Chess::Board* board = Chess::BoardFactory::create("standard");
+	Q_ASSERT(board != 0);
+
+	// Each job has its own xorshift generator seeded from the
+	// shared PRNG, so that -srand makes the suite reproducible
+	// with a single thread
+	quint64 rng = (quint64(Mersenne::random()) << 32) | Mersenne::random();
+	if (rng == 0)
+		rng = 1;
+
+	QString epd;
+	while (nextAttempt())
+	{
+		QString fen(randomFen(&rng));
+		if (tryPosition(board, fen, &epd))
+			addPosition(board->key(), epd);
+	}
+
+	Chess::BoardFactory::release(board);
+}
+
+bool EndgameGenerator::nextAttempt()
+{
+	QMutexLocker locker(&m_mutex);
+
+	if (m_positions.size() >= m_count || m_attempts >= m_maxAttempts)
+		return false;
+	m_attempts++;
+	return true;
+}
+
+QString EndgameGenerator::randomFen(quint64* rng) const
+{
+	char squares[64];
+	memset(squares, 0, sizeof(squares));
+
+	foreach (const QChar& c, m_pieces)
+	{
+		char piece = c.toLatin1();
+		bool isPawn = (piece == 'P' || piece == 'p');
+		for (;;)
+		{
+			quint64& x = *rng;
+			x ^= x << 13;
+			x ^= x >> 7;
+			x ^= x << 17;
+
+			int square = int(x % 64);
+			int rank = square / 8;
+			if (squares[square] != 0
+			||  (isPawn && (rank == 0 || rank == 7)))
+				continue;
+
+			squares[square] = piece;
+			break;
+		}
+	}
+
+	// Squares are numbered from a8 to h1, like in a FEN string
+	QString fen;
+	for (int rank = 0; rank < 8; rank++)
+	{
+		int empty = 0;
+		for (int file = 0; file < 8; file++)
+		{
+			char piece = squares[rank * 8 + file];
+			if (piece == 0)
+			{
+				empty++;
+				continue;
+			}
+			if (empty > 0)
+				fen += QString::number(empty);
+			fen += QChar(piece);
+			empty = 0;
+		}
+		if (empty > 0)
+			fen += QString::number(empty);
+		if (rank < 7)
+			fen += '/';
+	}
+
+	fen += (*rng & 1) ? " w - - 0 1" : " b - - 0 1";
+	return fen;
+}
+
+bool EndgameGenerator::tryPosition(Chess::Board* board,
+				   const QString& fen,
+				   QString* epd) const
+{
+	if (!board->setFenString(fen))
+		return false;
+
+	// Mates and stalemates are trivial
+	QVarLengthArray<Chess::Move> moves;
+	board->legalMoves(moves);
+	if (moves.isEmpty())
+		return false;
+
+	unsigned int dtm = 0;
+	Chess::Result result(board->tablebaseResult(m_minDtm > 0 ? &dtm : 0));
+	if (result.isNone())
+		return false;
+	if (result.isDraw())
+	{
+		if (!m_draws)
+			return false;
+	}
+	else if (int(dtm) < m_minDtm)
+		return false;
+
+	// EPD has the first four FEN fields
+	QStringList fields(board->fenString().split(' ').mid(0, 4));
+	*epd = fields.join(" ") + QString(" c0 \"%1\";")
+		.arg(result.toShortString());
+
+	return true;
+}
+
+void EndgameGenerator::addPosition(quint64 key, const QString& epd)
+{
+	QMutexLocker locker(&m_mutex);
+
+	if (m_positions.size() >= m_count || m_keys.contains(key))
+		return;
+	m_keys.insert(key);
+	m_positions.append(epd);
+}
+
+bool EndgameGenerator::run(int count, const QString& outFileName, QTextStream& out)
+{
+	Q_ASSERT(m_isValid);
+	Q_ASSERT(count > 0);
+
+	QElapsedTimer timer;
+	timer.start();
+
+	// Give up eventually if the tablebases don't cover the material
+	// or the filters are too strict
+	m_count = count;
+	m_attempts = 0;
+	m_maxAttempts = quint64(count) * 100000;
+	m_keys.clear();
+	m_positions.clear();
+
+	// The attempts are shared, so each thread runs a single job
+	runJobs(threadCount());
+
+	QFile file(outFileName);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+	{
+		out << "Can't open output file " << outFileName << endl;
+		return false;
+	}
+
+	QTextStream stream(&file);
+	foreach (const QString& epd, m_positions)
+		stream << epd << '\n';
+	stream.flush();
+	file.close();
+	if (file.error() != QFile::NoError)
+	{
+		out << "Can't write output file " << outFileName << endl;
+		return false;
+	}
+
+	qint64 elapsed = timer.elapsed();
+	out << "Positions: " << m_positions.size() << endl;
+	out << "Attempts: " << m_attempts << endl;
+	out << "Time: " << elapsed << " ms" << endl;
+
+	if (m_positions.size() < count)
+	{
+		out << "Only " << m_positions.size() << " of " << count
+		    << " positions were found. Are the tablebases available?"
+		    << endl;
+		return false;
+	}
+
+	// Verify that the suite can be used as an opening suite
+	OpeningSuite suite(outFileName, OpeningSuite::EpdFormat,
+			   OpeningSuite::SequentialOrder);
+	return suite.initialize();
+}
@@ -0,0 +1,108 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef ENDGAMEGENERATOR_H
+#define ENDGAMEGENERATOR_H
+
+#include <QString>
+#include <QVector>
+#include <QMutex>
+#include <QSet>
+#include "workerpool.h"
+class QTextStream;
+namespace Chess { class Board; }
+
+/*!
+ * \brief A multithreaded generator for endgame test suites.
+ *
+ * EndgameGenerator places the pieces of a material signature, eg.
+ * "KRPvKR", on random squares of a standard chess board and keeps
+ * the legal positions whose tablebase result is decisive. Positions
+ * without legal moves are left out, and so are duplicates. The kept
+ * positions are written as an EPD suite that OpeningSuite can read,
+ * with the tablebase result in the "c0" opcode.
+ *
+ * Each worker thread generates and probes positions with its own
+ * board until enough positions have been found. The tablebases must
+ * be initialized before the generator is run.
+ *
+ * \sa Chess::Board::tablebaseResult()
+ */
+class EndgameGenerator : public WorkerPool
+{
+	public:
+		/*!
+		 * Creates a new EndgameGenerator for positions with
+		 * \a material material.
+		 *
+		 * \a material lists the white pieces, the letter 'v' and
+		 * the black pieces, with upper case piece letters. Each
+		 * side must have one king.
+		 */
+		EndgameGenerator(const QString& material);
+		/*! Destroys the EndgameGenerator object. */
+		~EndgameGenerator();
+
+		/*! Returns true if the material signature is valid. */
+		bool isValid() const;
+
+		/*!
+		 * If \a enabled is true, drawn positions are kept too.
+		 * By default only decisive positions are kept.
+		 */
+		void setDrawsIncluded(bool enabled);
+		/*!
+		 * Keeps only the decisive positions where the mate is at
+		 * least \a plies plies away. The distance to mate needs
+		 * Gaviota tablebases. The default is 0 (no limit).
+		 */
+		void setMinimumDtm(int plies);
+
+		/*!
+		 * Generates \a count positions, writes them to
+		 * \a outFileName and writes statistics to \a out.
+		 * Returns true if successful.
+		 */
+		bool run(int count, const QString& outFileName, QTextStream& out);
+
+	protected:
+		// Inherited from WorkerPool
+		virtual void runJob(int index);
+
+	private:
+		bool nextAttempt();
+		QString randomFen(quint64* rng) const;
+		bool tryPosition(Chess::Board* board,
+				 const QString& fen,
+				 QString* epd) const;
+		void addPosition(quint64 key, const QString& epd);
+
+		QString m_pieces;
+		bool m_isValid;
+		bool m_draws;
+		int m_minDtm;
+		int m_count;
+		quint64 m_attempts;
+		quint64 m_maxAttempts;
+		QSet<quint64> m_keys;
+		QVector<QString> m_positions;
+		QMutex m_mutex;
+};
+
+#endif // ENDGAMEGENERATOR_H
@@ -18,20 +18,42 @@
 #include "enginematch.h"
 #include <cmath>
 #include <QMultiMap>
+#include <QFile>
+#include <QTextStream>
 #include <chessplayer.h>
 #include <playerbuilder.h>
 #include <chessgame.h>
-#include <polyglotbook.h>
+#include <openingbookcache.h>
 #include <tournament.h>
+#include <openingsuite.h>
+#include <openingstats.h>
 #include <gamemanager.h>
 #include <sprt.h>
+#include <ratingsolver.h>
+#include <jsonserializer.h>
+#include <allocationstats.h>
+#include "resultstream.h"
+#include "resultdatabase.h"
+#include "metricsserver.h"
+#include "broadcastserver.h"
 
 
 EngineMatch::EngineMatch(Tournament* tournament, QObject* parent)
 	: QObject(parent),
 	  m_tournament(tournament),
 	  m_debug(false),
-	  m_ratingInterval(0)
+	  m_sharedGameManager(false),
+	  m_ratingInterval(0),
+	  m_crosstable(false),
+	  m_statsInterval(-1),
+	  m_resultStream(0),
+	  m_resultDatabase(0),
+	  m_metricsServer(0),
+	  m_broadcastServer(0),
+	  m_pruneMinGames(0),
+	  m_pruneMaxShare(0),
+	  m_threadLimit(0),
+	  m_memoryLimit(0)
 {
 	Q_ASSERT(tournament != 0);
 
@@ -40,27 +62,41 @@ EngineMatch::EngineMatch(Tournament* tournament, QObject* parent)
 
 EngineMatch::~EngineMatch()
 {
-	qDeleteAll(m_books);
 }
 
-OpeningBook* EngineMatch::addOpeningBook(const QString& fileName)
+Tournament* EngineMatch::tournament() const
+{
+	return m_tournament;
+}
+
+QList< QSharedPointer<const OpeningBook> > EngineMatch::openingBooks() const
+{
+	return m_books;
+}
+
+const OpeningBook* EngineMatch::addOpeningBook(const QString& fileName,
+					       OpeningBook::AccessMode mode)
 {
 	if (fileName.isEmpty())
 		return 0;
 
-	if (m_books.contains(fileName))
-		return m_books[fileName];
-
-	PolyglotBook* book = new PolyglotBook;
-	if (!book->read(fileName))
+	// Engines that use the same book file share the cached book
+	QSharedPointer<const OpeningBook> book(
+		OpeningBookCache::polyglotBook(fileName, mode));
+	if (book.isNull())
 	{
-		delete book;
 		qWarning("Can't read opening book file %s", qPrintable(fileName));
 		return 0;
 	}
 
-	m_books[fileName] = book;
-	return book;
+	if (!m_books.contains(book))
+		m_books.append(book);
+	return book.data();
+}
+
+void EngineMatch::setSummaryFile(const QString& fileName)
+{
+	m_summaryFile = fileName;
 }
 
 void EngineMatch::start()
@@ -75,6 +111,10 @@ void EngineMatch::start()
 	if (m_debug)
 		connect(m_tournament->gameManager(), SIGNAL(debugMessage(QString)),
 			this, SLOT(print(QString)));
+	if (m_metricsServer != 0)
+		m_metricsServer->start();
+	if (m_broadcastServer != 0)
+		m_broadcastServer->start();
 
 	QMetaObject::invokeMethod(m_tournament, "start", Qt::QueuedConnection);
 }
@@ -89,12 +129,85 @@ void EngineMatch::setDebugMode(bool debug)
 	m_debug = debug;
 }
 
+void EngineMatch::setSharedGameManager(bool shared)
+{
+	m_sharedGameManager = shared;
+}
+
 void EngineMatch::setRatingInterval(int interval)
 {
 	Q_ASSERT(interval >= 0);
 	m_ratingInterval = interval;
 }
 
+void EngineMatch::setCrosstableEnabled(bool enabled)
+{
+	m_crosstable = enabled;
+}
+
+void EngineMatch::setStatsInterval(int interval)
+{
+	Q_ASSERT(interval >= 0);
+	m_statsInterval = interval;
+}
+
+void EngineMatch::setResourceLimits(int threads, int memory)
+{
+	Q_ASSERT(threads >= 0);
+	Q_ASSERT(memory >= 0);
+
+	m_threadLimit = threads;
+	m_memoryLimit = memory;
+}
+
+bool EngineMatch::setResultStream(const QString& target)
+{
+	delete m_resultStream;
+	m_resultStream = new ResultStream(this);
+	if (m_resultStream->open(target))
+		return true;
+
+	delete m_resultStream;
+	m_resultStream = 0;
+	return false;
+}
+
+bool EngineMatch::setResultDatabase(const QString& fileName)
+{
+	delete m_resultDatabase;
+	m_resultDatabase = new ResultDatabase(this);
+	if (m_resultDatabase->open(fileName))
+		return true;
+
+	delete m_resultDatabase;
+	m_resultDatabase = 0;
+	return false;
+}
+
+bool EngineMatch::setMetricsServer(const QString& address)
+{
+	delete m_metricsServer;
+	m_metricsServer = new MetricsServer(m_tournament, this);
+	if (m_metricsServer->listen(address))
+		return true;
+
+	delete m_metricsServer;
+	m_metricsServer = 0;
+	return false;
+}
+
+bool EngineMatch::setBroadcastServer(const QString& address)
+{
+	delete m_broadcastServer;
+	m_broadcastServer = new BroadcastServer(m_tournament, this);
+	if (m_broadcastServer->listen(address))
+		return true;
+
+	delete m_broadcastServer;
+	m_broadcastServer = 0;
+	return false;
+}
+
 void EngineMatch::onGameStarted(ChessGame* game, int number)
 {
 	Q_ASSERT(game != 0);
@@ -130,9 +243,29 @@ void EngineMatch::onGameFinished(ChessGame* game, int number)
 		       totalResults);
 	}
 
+	if (m_resultStream != 0)
+	{
+		m_resultStream->writeGame(m_tournament, game, number,
+					  m_startTime.elapsed());
+
+		const Sprt* sprt = m_tournament->sprt();
+		if (!sprt->isNull())
+			m_resultStream->writeSprt(sprt->status(),
+						  m_tournament->finishedGameCount());
+	}
+
+	if (m_resultDatabase != 0)
+		m_resultDatabase->writeGame(m_tournament, game, number);
+
 	if (m_ratingInterval != 0
 	&&  (m_tournament->finishedGameCount() % m_ratingInterval) == 0)
 		printRanking();
+
+	checkResourceLimits();
+
+	if (m_statsInterval > 0
+	&&  (m_tournament->finishedGameCount() % m_statsInterval) == 0)
+		printStats();
 }
 
 void EngineMatch::onTournamentFinished()
@@ -140,12 +273,36 @@ void EngineMatch::onTournamentFinished()
 	if (m_ratingInterval == 0
 	||  m_tournament->finishedGameCount() % m_ratingInterval != 0)
 		printRanking();
+	printLatency();
+	printTimeUsage();
+	printSearchStats();
+	printBookStats();
+	printResourceUsage();
+	printAllocations();
+	printRestarts();
+	if (m_resultStream != 0)
+		m_resultStream->writeSearchStats(m_tournament);
+	printAdjudication();
+	if (m_statsInterval >= 0)
+		printStats();
+	if (!m_summaryFile.isEmpty())
+		writeSummary();
+	if (!m_openingStatsFile.isEmpty())
+		writeOpeningStats();
 
 	QString error = m_tournament->errorString();
 	if (!error.isEmpty())
 		qWarning("%s", qPrintable(error));
 
 	qDebug("Finished match");
+
+	// Other matches may still be using the game manager
+	if (m_sharedGameManager)
+	{
+		emit finished();
+		return;
+	}
+
 	connect(m_tournament->gameManager(), SIGNAL(finished()),
 		this, SIGNAL(finished()));
 	m_tournament->gameManager()->finish();
@@ -159,6 +316,7 @@ void EngineMatch::print(const QString& msg)
 struct RankingData
 {
 	QString name;
+	int index;
 	int games;
 	qreal score;
 	qreal draws;
@@ -167,6 +325,9 @@ struct RankingData
 void EngineMatch::printRanking()
 {
 	QMultiMap<qreal, RankingData> ranking;
+	RatingSolver* ratings = m_tournament->ratings();
+	if (m_tournament->playerCount() > 2)
+		ratings->solve();
 
 	for (int i = 0; i < m_tournament->playerCount(); i++)
 	{
@@ -187,31 +348,57 @@ void EngineMatch::printRanking()
 		}
 
 		RankingData data = { player.builder->name(),
+				     i,
 				     total / 2,
 				     ratio,
 				     qreal(player.draws * 2) / qreal(total) };
-		ranking.insert(-eloDiff, data);
+		ranking.insert(-ratings->rating(i), data);
 	}
 
 	if (!ranking.isEmpty())
-		qDebug("%4s %-25.25s %7s %7s %7s %7s",
-		       "Rank", "Name", "ELO", "Games", "Score", "Draws");
+		qDebug("%4s %-25.25s %7s %7s %7s %7s %7s %7s",
+		       "Rank", "Name", "ELO", "+/-", "LOS", "Games",
+		       "Score", "Draws");
 
+	// LOS is the likelihood of superiority over the next player
 	int rank = 0;
 	QMultiMap<qreal, RankingData>::const_iterator it;
 	for (it = ranking.constBegin(); it != ranking.constEnd(); ++it)
 	{
 		const RankingData& data = it.value();
-		qDebug("%4d %-25.25s %7.0f %7d %6.0f%% %6.0f%%",
+		QString los;
+		QMultiMap<qreal, RankingData>::const_iterator next(it + 1);
+		if (next != ranking.constEnd())
+			los = QString("%1%").arg(ratings->los(data.index,
+							      next.value().index) * 100.0,
+						 0, 'f', 0);
+
+		qDebug("%4d %-25.25s %7.0f %7.0f %7s %7d %6.0f%% %6.0f%%",
 		       ++rank,
 		       qPrintable(data.name),
 		       -it.key(),
+		       ratings->error(data.index),
+		       qPrintable(los),
 		       data.games,
 		       data.score * 100.0,
 		       data.draws * 100.0);
 	}
 
-	Sprt::Status sprtStatus = m_tournament->sprt()->status();
+	if (m_crosstable && m_tournament->playerCount() > 2)
+		printCrosstable();
+
+	const Sprt* sprt = m_tournament->sprt();
+	if (!sprt->isNull() && sprt->model() == Sprt::Pentanomial)
+	{
+		qDebug("Ptnml(0-2): %d, %d, %d, %d, %d",
+		       sprt->pairResultCount(0),
+		       sprt->pairResultCount(1),
+		       sprt->pairResultCount(2),
+		       sprt->pairResultCount(3),
+		       sprt->pairResultCount(4));
+	}
+
+	Sprt::Status sprtStatus = sprt->status();
 	if (sprtStatus.llr != 0.0
 	||  sprtStatus.lBound != 0.0
 	||  sprtStatus.uBound != 0.0)
@@ -228,3 +415,373 @@ void EngineMatch::printRanking()
 		qDebug("%s", qPrintable(sprtStr));
 	}
 }
+
+void EngineMatch::printCrosstable()
+{
+	// The pairwise results are kept up to date by the rating solver,
+	// so printing the table doesn't depend on the number of games
+	const RatingSolver* ratings = m_tournament->ratings();
+	const int count = m_tournament->playerCount();
+
+	QString header = QString("%1 %2").arg("", 4).arg("Crosstable", -25);
+	for (int i = 0; i < count; i++)
+		header += QString(" %1").arg(i + 1, 7);
+	qDebug("%s", qPrintable(header));
+
+	for (int i = 0; i < count; i++)
+	{
+		Tournament::PlayerData player(m_tournament->playerAt(i));
+		QString line = QString("%1 %2").arg(i + 1, 4)
+			.arg(player.builder->name().left(25), -25);
+
+		for (int j = 0; j < count; j++)
+		{
+			QString cell;
+			if (i == j)
+				cell = "-";
+			else
+			{
+				RatingSolver::Results results =
+					ratings->pairResults(i, j);
+				if (results.games > 0)
+					cell = QString("%1/%2")
+						.arg(results.halfPoints / 2.0)
+						.arg(results.games);
+			}
+			line += QString(" %1").arg(cell, 7);
+		}
+		qDebug("%s", qPrintable(line));
+	}
+}
+
+void EngineMatch::printLatency()
+{
+	bool header = false;
+
+	for (int i = 0; i < m_tournament->playerCount(); i++)
+	{
+		Tournament::PlayerData player(m_tournament->playerAt(i));
+		const LatencyStats& ping = player.pingStats;
+		const LatencyStats& response = player.responseStats;
+		if (ping.isEmpty() && response.isEmpty())
+			continue;
+
+		if (!header)
+		{
+			qDebug("%-25.25s %7s %9s %9s %7s %9s %9s",
+			       "Latency (ms)", "Pings", "Avg", "Max",
+			       "Moves", "Avg", "Max");
+			header = true;
+		}
+		qDebug("%-25.25s %7d %9d %9d %7d %9d %9d",
+		       qPrintable(player.builder->name()),
+		       ping.count(),
+		       ping.average(),
+		       ping.maximum(),
+		       response.count(),
+		       response.average(),
+		       response.maximum());
+	}
+}
+
+void EngineMatch::printTimeUsage()
+{
+	bool header = false;
+
+	for (int i = 0; i < m_tournament->playerCount(); i++)
+	{
+		Tournament::PlayerData player(m_tournament->playerAt(i));
+		const TimeUsageStats& usage = player.timeUsage;
+		if (usage.isEmpty())
+			continue;
+
+		if (!header)
+		{
+			qDebug("%-25.25s %7s %9s %9s %9s %9s %9s %8s %8s",
+			       "Time usage (ms)", "Moves", "Avg", "Raw",
+			       "Overhead", "99%", "Max", "Forfeits", "Misses");
+			header = true;
+		}
+		const LatencyStats& overhead = usage.overhead();
+		int moves = usage.moveTimes().count();
+		qint64 raw = usage.moveTimes().total() + usage.refunds().total();
+		qDebug("%-25.25s %7d %9d %9lld %9d %9d %9d %8d %8d",
+		       qPrintable(player.builder->name()),
+		       moves,
+		       usage.moveTimes().average(),
+		       moves > 0 ? raw / moves : -1LL,
+		       overhead.average(),
+		       overhead.percentile(99),
+		       overhead.maximum(),
+		       usage.forfeits(),
+		       usage.nearMisses());
+	}
+}
+
+void EngineMatch::printSearchStats()
+{
+	bool header = false;
+
+	for (int i = 0; i < m_tournament->playerCount(); i++)
+	{
+		Tournament::PlayerData player(m_tournament->playerAt(i));
+		const SearchStats& stats = player.searchStats;
+		if (stats.isEmpty())
+			continue;
+
+		if (!header)
+		{
+			qDebug("%-25.25s %7s %9s %6s %6s %6s %6s %11s",
+			       "Search", "Moves", "kNps", "D-open", "D-mid",
+			       "D-end", "Hash%", "TB hits");
+			header = true;
+		}
+		int hash = stats.hashUsage();
+		qDebug("%-25.25s %7d %9llu %6.1f %6.1f %6.1f %6s %11llu",
+		       qPrintable(player.builder->name()),
+		       stats.count(),
+		       stats.nps() / 1000,
+		       stats.depth(SearchStats::Opening),
+		       stats.depth(SearchStats::Middlegame),
+		       stats.depth(SearchStats::Endgame),
+		       hash < 0 ? "-" : qPrintable(QString::number(hash / 10.0, 'f', 1)),
+		       stats.tbHits());
+	}
+}
+
+void EngineMatch::printBookStats()
+{
+	bool header = false;
+
+	for (int i = 0; i < m_tournament->playerCount(); i++)
+	{
+		Tournament::PlayerData player(m_tournament->playerAt(i));
+		if (player.bookGames == 0)
+			continue;
+
+		if (!header)
+		{
+			qDebug("%-25.25s %7s %9s %9s %9s",
+			       "Book", "Games", "Moves", "Avg", "Exits");
+			header = true;
+		}
+		qDebug("%-25.25s %7d %9d %9.1f %9d",
+		       qPrintable(player.builder->name()),
+		       player.bookGames,
+		       player.bookMoves,
+		       double(player.bookMoves) / player.bookGames,
+		       player.bookExits);
+	}
+}
+
+void EngineMatch::printResourceUsage()
+{
+	bool header = false;
+
+	for (int i = 0; i < m_tournament->playerCount(); i++)
+	{
+		Tournament::PlayerData player(m_tournament->playerAt(i));
+		const ResourceStats& stats = player.resourceStats;
+		if (stats.isEmpty())
+			continue;
+
+		if (!header)
+		{
+			qDebug("%-25.25s %7s %9s %8s %8s %7s %7s",
+			       "Resources", "Samples", "CPU (s)", "Avg MB",
+			       "Peak MB", "Avg thr", "Max thr");
+			header = true;
+		}
+		qDebug("%-25.25s %7d %9.1f %8lld %8lld %7.1f %7d",
+		       qPrintable(player.builder->name()),
+		       stats.count(),
+		       stats.cpuTime() / 1000.0,
+		       stats.averageMemory() / (1024 * 1024),
+		       stats.peakMemory() / (1024 * 1024),
+		       stats.averageThreads(),
+		       stats.peakThreads());
+	}
+
+	header = false;
+	for (int i = 0; i < m_tournament->playerCount(); i++)
+	{
+		Tournament::PlayerData player(m_tournament->playerAt(i));
+		const ResourceStats& stats = player.resourceStats;
+		if (!stats.hasThrottling())
+			continue;
+
+		if (!header)
+		{
+			qDebug("%-25.25s %13s %9s %10s",
+			       "Throttling", "Throttled (s)", "Periods",
+			       "Mem limit");
+			header = true;
+		}
+		qDebug("%-25.25s %13.1f %9d %10d",
+		       qPrintable(player.builder->name()),
+		       stats.throttledTime() / 1000.0,
+		       stats.throttleCount(),
+		       stats.memoryEvents());
+	}
+}
+
+void EngineMatch::printAllocations()
+{
+	if (!AllocationStats::isEnabled())
+		return;
+
+	int games = qMax(m_tournament->finishedGameCount(), 1);
+	qDebug("%-25.25s %12s %10s %12s %10s",
+	       "Allocations", "Count", "MB", "Per game", "KB/game");
+	for (int i = 0; i < AllocationStats::SubsystemCount; i++)
+	{
+		AllocationStats::Subsystem subsystem = AllocationStats::Subsystem(i);
+		quint64 count = AllocationStats::count(subsystem);
+		quint64 bytes = AllocationStats::bytes(subsystem);
+		qDebug("%-25.25s %12llu %10.1f %12llu %10.1f",
+		       AllocationStats::name(subsystem),
+		       count,
+		       bytes / (1024.0 * 1024.0),
+		       count / games,
+		       bytes / 1024.0 / games);
+	}
+}
+
+void EngineMatch::checkResourceLimits()
+{
+	if (m_threadLimit == 0 && m_memoryLimit == 0)
+		return;
+
+	// Each player is reported only once, when it first goes over
+	for (int i = 0; i < m_tournament->playerCount(); i++)
+	{
+		if (m_overLimit.contains(i))
+			continue;
+
+		Tournament::PlayerData player(m_tournament->playerAt(i));
+		const ResourceStats& stats = player.resourceStats;
+		int threads = stats.peakThreads();
+		qint64 memory = stats.peakMemory() / (1024 * 1024);
+
+		if (m_threadLimit > 0 && threads > m_threadLimit)
+			qWarning("%s used %d threads, the limit is %d",
+				 qPrintable(player.builder->name()),
+				 threads, m_threadLimit);
+		else if (m_memoryLimit > 0 && memory > m_memoryLimit)
+			qWarning("%s used %lld MB of memory, the limit is %d MB",
+				 qPrintable(player.builder->name()),
+				 memory, m_memoryLimit);
+		else
+			continue;
+
+		m_overLimit.insert(i);
+	}
+}
+
+void EngineMatch::setOpeningStats(const QString& fileName,
+				  const QString& prunedSuiteFile,
+				  int minGames,
+				  int maxShare)
+{
+	m_openingStatsFile = fileName;
+	m_prunedSuiteFile = prunedSuiteFile;
+	m_pruneMinGames = minGames;
+	m_pruneMaxShare = maxShare;
+}
+
+void EngineMatch::writeOpeningStats()
+{
+	OpeningSuite* suite = m_tournament->openingSuite();
+	const OpeningStats* stats = m_tournament->openingStats();
+	if (suite == 0)
+		return;
+
+	if (!stats->save(m_openingStatsFile, suite->fileName()))
+	{
+		qWarning("Can't write opening statistics file %s",
+			 qPrintable(m_openingStatsFile));
+		return;
+	}
+	if (m_prunedSuiteFile.isEmpty())
+		return;
+
+	QSet<int> excluded(stats->lowInformation(m_pruneMinGames,
+						 m_pruneMaxShare));
+	int count = suite->writeSubset(m_prunedSuiteFile, excluded);
+	if (count < 0)
+		qWarning("Can't write pruned opening suite %s",
+			 qPrintable(m_prunedSuiteFile));
+	else
+		qDebug("Pruned %d openings, %d left in %s",
+		       excluded.size(), count,
+		       qPrintable(m_prunedSuiteFile));
+}
+
+void EngineMatch::writeSummary()
+{
+	QFile file(m_summaryFile);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+	{
+		qWarning("Can't open summary file %s", qPrintable(m_summaryFile));
+		return;
+	}
+
+	QTextStream out(&file);
+	JsonSerializer serializer(m_tournament->summary());
+	if (!serializer.serialize(out))
+		qWarning("Can't write summary file %s", qPrintable(m_summaryFile));
+}
+
+void EngineMatch::printAdjudication()
+{
+	int count = m_tournament->adjudicatedGameCount();
+	if (count == 0)
+		return;
+
+	qDebug("%d game(s) adjudicated, saving about %.1f engine-seconds",
+	       count, m_tournament->adjudicationSavings() / 1000.0);
+}
+
+void EngineMatch::printRestarts()
+{
+	for (int i = 0; i < m_tournament->playerCount(); i++)
+	{
+		Tournament::PlayerData player(m_tournament->playerAt(i));
+		int count = player.builder->restartCount();
+		if (count > 0)
+			qDebug("%s was restarted %d time(s) after a crash",
+			       qPrintable(player.builder->name()), count);
+	}
+}
+
+static void printLatencyStats(const QString& name, const LatencyStats& stats)
+{
+	if (stats.isEmpty())
+		return;
+
+	qDebug("%-25.25s %7d %7d %7d %7d %7d %7d",
+	       qPrintable(name),
+	       stats.count(),
+	       stats.average(),
+	       stats.percentile(50),
+	       stats.percentile(90),
+	       stats.percentile(99),
+	       stats.maximum());
+}
+
+void EngineMatch::printStats()
+{
+	GameManager::Statistics stats(m_tournament->gameManager()->statistics());
+
+	qDebug("Game manager: %d games started, %d game threads created, "
+	       "%d cleaned up",
+	       stats.gamesStarted, stats.threadsCreated, stats.threadsFinished);
+	qDebug("%-25.25s %7s %7s %7s %7s %7s %7s",
+	       "", "Samples", "Avg", "p50", "p90", "p99", "Max");
+	printLatencyStats("Queue depth", stats.queueDepth);
+	printLatencyStats("Start delay (ms)", stats.startDelay);
+	printLatencyStats("Main loop latency (ms)", stats.mainLoopLatency);
+	for (int i = 0; i < stats.workerLoopLatency.size(); i++)
+		printLatencyStats(QString("Worker %1 latency (ms)").arg(i + 1),
+				  stats.workerLoopLatency.at(i));
+}
@@ -19,13 +19,19 @@
 #define ENGINEMATCH_H
 
 #include <QObject>
-#include <QMap>
+#include <QList>
+#include <QSet>
 #include <QString>
 #include <QElapsedTimer>
+#include <QSharedPointer>
+#include <openingbook.h>
 
 class ChessGame;
-class OpeningBook;
 class Tournament;
+class ResultStream;
+class ResultDatabase;
+class MetricsServer;
+class BroadcastServer;
 
 
 class EngineMatch : public QObject
@@ -36,9 +42,25 @@ class EngineMatch : public QObject
 		EngineMatch(Tournament* tournament, QObject* parent = 0);
 		virtual ~EngineMatch();
 
-		OpeningBook* addOpeningBook(const QString& fileName);
+		Tournament* tournament() const;
+		QList< QSharedPointer<const OpeningBook> > openingBooks() const;
+		const OpeningBook* addOpeningBook(const QString& fileName,
+						  OpeningBook::AccessMode mode = OpeningBook::Ram);
 		void setDebugMode(bool debug);
+		void setSharedGameManager(bool shared);
 		void setRatingInterval(int interval);
+		void setCrosstableEnabled(bool enabled);
+		void setStatsInterval(int interval);
+		bool setResultStream(const QString& target);
+		bool setResultDatabase(const QString& fileName);
+		bool setMetricsServer(const QString& address);
+		bool setBroadcastServer(const QString& address);
+		void setSummaryFile(const QString& fileName);
+		void setOpeningStats(const QString& fileName,
+				     const QString& prunedSuiteFile,
+				     int minGames,
+				     int maxShare);
+		void setResourceLimits(int threads, int memory);
 
 		void start();
 		void stop();
@@ -54,11 +76,39 @@ class EngineMatch : public QObject
 
 	private:
 		void printRanking();
+		void printCrosstable();
+		void printLatency();
+		void printTimeUsage();
+		void printSearchStats();
+		void printBookStats();
+		void printResourceUsage();
+		void printAllocations();
+		void checkResourceLimits();
+		void printRestarts();
+		void printAdjudication();
+		void printStats();
+		void writeSummary();
+		void writeOpeningStats();
 
 		Tournament* m_tournament;
 		bool m_debug;
+		bool m_sharedGameManager;
 		int m_ratingInterval;
-		QMap<QString, OpeningBook*> m_books;
+		bool m_crosstable;
+		int m_statsInterval;
+		QList< QSharedPointer<const OpeningBook> > m_books;
+		ResultStream* m_resultStream;
+		ResultDatabase* m_resultDatabase;
+		MetricsServer* m_metricsServer;
+		BroadcastServer* m_broadcastServer;
+		QString m_summaryFile;
+		QString m_openingStatsFile;
+		QString m_prunedSuiteFile;
+		int m_pruneMinGames;
+		int m_pruneMaxShare;
+		int m_threadLimit;
+		int m_memoryLimit;
+		QSet<int> m_overLimit;
 		QElapsedTimer m_startTime;
 };
 
@@ -0,0 +1,468 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "engineprofiler.h"
+#include <cmath>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QStringList>
+#include <QTextStream>
+#include <engineoption.h>
+#include <jsonserializer.h>
+
+static const int s_startupTimeout = 10000;
+static const int s_readyTimeout = 5000;
+static const int s_searchTimeout = 120000;
+// The number of "isready" commands of the latency tests
+static const int s_readyCount = 10;
+// The time a search runs before its "isready" latency is measured
+static const int s_loadDelay = 200;
+
+// Commands that a robust engine ignores or rejects without crashing
+static const char* const s_malformedInput[] =
+{
+	"xyzzy",
+	"position fen 8/8/8/8 w - - 0 1",
+	"position startpos moves e2e5",
+	"position startpos moves a1a1 zz99",
+	"setoption name NoSuchOption value 1",
+	"go depth x",
+	"go movetime -100",
+	"",
+	0
+};
+
+
+EngineProfiler::EngineProfiler(const EngineConfiguration& config)
+	: m_config(config),
+	  m_depth(12),
+	  m_searchCount(5)
+{
+	m_moveTimes << 100 << 500 << 1000;
+	m_process.setProcessChannelMode(QProcess::MergedChannels);
+}
+
+EngineProfiler::~EngineProfiler()
+{
+	if (m_process.state() != QProcess::NotRunning)
+	{
+		write("quit");
+		if (!m_process.waitForFinished(s_readyTimeout))
+			m_process.kill();
+		m_process.waitForFinished();
+	}
+}
+
+void EngineProfiler::setDepth(int depth)
+{
+	Q_ASSERT(depth > 0);
+	m_depth = depth;
+}
+
+void EngineProfiler::setSearchCount(int count)
+{
+	Q_ASSERT(count > 0);
+	m_searchCount = count;
+}
+
+void EngineProfiler::setMoveTimes(const QList<int>& times)
+{
+	m_moveTimes = times;
+}
+
+bool EngineProfiler::start()
+{
+	QString cmd = m_config.command().trimmed();
+	QString workDir = m_config.workingDirectory();
+	if (workDir.isEmpty())
+	{
+		QFileInfo cmdInfo(cmd);
+		if (cmdInfo.isFile())
+			cmd = cmdInfo.absoluteFilePath();
+		m_process.setWorkingDirectory(QDir::tempPath());
+	}
+	else
+		m_process.setWorkingDirectory(workDir);
+
+	if (!m_config.arguments().isEmpty())
+		m_process.start(cmd, m_config.arguments());
+	else
+		m_process.start(cmd);
+	if (!m_process.waitForStarted())
+	{
+		qWarning("Cannot execute command: %s",
+			 qPrintable(m_config.command()));
+		return false;
+	}
+
+	foreach (const QString& str, m_config.initStrings())
+		write(str);
+	return true;
+}
+
+void EngineProfiler::write(const QString& line)
+{
+	m_process.write(line.toLatin1() + '\n');
+}
+
+bool EngineProfiler::waitFor(const QString& command, int timeout, QString* line)
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	for (;;)
+	{
+		while (m_process.canReadLine())
+		{
+			QString str(QString::fromLatin1(m_process.readLine()).trimmed());
+			if (str == command || str.startsWith(command + ' '))
+			{
+				if (line != 0)
+					*line = str;
+				return true;
+			}
+		}
+
+		const qint64 left = timeout - timer.elapsed();
+		if (left <= 0 || m_process.state() != QProcess::Running)
+			return false;
+		m_process.waitForReadyRead(int(left));
+	}
+}
+
+qint64 EngineProfiler::readyLatency(int timeout)
+{
+	QElapsedTimer timer;
+	timer.start();
+	write("isready");
+	if (!waitFor("readyok", timeout))
+		return -1;
+	return timer.elapsed();
+}
+
+void EngineProfiler::readInfo(const QString& line, SearchResult* result) const
+{
+	const QStringList tokens(line.split(' ', QString::SkipEmptyParts));
+	for (int i = 1; i + 1 < tokens.size(); i++)
+	{
+		if (tokens.at(i) == "nodes")
+			result->nodes = tokens.at(i + 1).toULongLong();
+		else if (tokens.at(i) == "nps")
+			result->nps = tokens.at(i + 1).toULongLong();
+		else if (tokens.at(i) == "pv" || tokens.at(i) == "string")
+			break;
+	}
+}
+
+EngineProfiler::SearchResult EngineProfiler::search(const QString& go,
+						    int timeout)
+{
+	SearchResult result = { false, 0, 0, 0 };
+
+	QElapsedTimer timer;
+	timer.start();
+	write("position startpos");
+	write(go);
+
+	for (;;)
+	{
+		const qint64 left = timeout - timer.elapsed();
+		if (left <= 0 || !m_process.canReadLine())
+		{
+			if (left <= 0 || m_process.state() != QProcess::Running)
+				return result;
+			m_process.waitForReadyRead(int(left));
+			continue;
+		}
+
+		const QString line(QString::fromLatin1(m_process.readLine()).trimmed());
+		if (line.startsWith("info "))
+			readInfo(line, &result);
+		else if (line.startsWith("bestmove"))
+			break;
+	}
+
+	result.ok = true;
+	result.time = timer.elapsed();
+	if (result.nps == 0 && result.time > 0)
+		result.nps = result.nodes * 1000 / result.time;
+	return result;
+}
+
+QVariantMap EngineProfiler::timeStats(const QList<qint64>& times)
+{
+	QVariantMap map;
+	if (times.isEmpty())
+		return map;
+
+	qint64 sum = 0;
+	qint64 max = times.first();
+	qint64 min = times.first();
+	foreach (qint64 time, times)
+	{
+		sum += time;
+		max = qMax(max, time);
+		min = qMin(min, time);
+	}
+	map["count"] = times.size();
+	map["average"] = double(sum) / times.size();
+	map["min"] = min;
+	map["max"] = max;
+	return map;
+}
+
+QVariant EngineProfiler::profileStartup()
+{
+	QVariantMap map;
+	QElapsedTimer timer;
+	timer.start();
+	if (!start())
+		return QVariant();
+
+	write("uci");
+	if (!waitFor("uciok", s_startupTimeout))
+	{
+		qWarning("The engine didn't send \"uciok\" in %d ms",
+			 s_startupTimeout);
+		return QVariant();
+	}
+	map["uciok"] = timer.elapsed();
+
+	foreach (const EngineOption* option, m_config.options())
+	{
+		const QString value(option->value().toString());
+		if (value.isEmpty())
+			write(QString("setoption name %1").arg(option->name()));
+		else
+			write(QString("setoption name %1 value %2")
+			      .arg(option->name()).arg(value));
+	}
+
+	write("isready");
+	if (!waitFor("readyok", s_startupTimeout))
+	{
+		qWarning("The engine didn't send \"readyok\" in %d ms",
+			 s_startupTimeout);
+		return QVariant();
+	}
+	map["readyok"] = timer.elapsed();
+	return map;
+}
+
+QVariant EngineProfiler::profileIsReady()
+{
+	QVariantMap map;
+	QList<qint64> idle;
+	for (int i = 0; i < s_readyCount; i++)
+	{
+		qint64 latency = readyLatency(s_readyTimeout);
+		if (latency < 0)
+		{
+			m_errors << "No \"readyok\" from an idle engine";
+			break;
+		}
+		idle << latency;
+	}
+	map["idle"] = timeStats(idle);
+
+	// The engine must answer "isready" while it's searching
+	write("position startpos");
+	write("go infinite");
+	QElapsedTimer loadTimer;
+	loadTimer.start();
+	while (loadTimer.elapsed() < s_loadDelay
+	&&     m_process.state() == QProcess::Running)
+		m_process.waitForReadyRead(int(s_loadDelay - loadTimer.elapsed()));
+
+	QList<qint64> searching;
+	for (int i = 0; i < s_readyCount; i++)
+	{
+		qint64 latency = readyLatency(s_readyTimeout);
+		if (latency < 0)
+		{
+			m_errors << "No \"readyok\" from a searching engine";
+			break;
+		}
+		searching << latency;
+	}
+	map["searching"] = timeStats(searching);
+
+	write("stop");
+	if (!waitFor("bestmove", s_readyTimeout))
+		m_errors << "No \"bestmove\" after \"stop\"";
+	return map;
+}
+
+QVariant EngineProfiler::profileNewGame()
+{
+	QList<qint64> times;
+	for (int i = 0; i < m_searchCount; i++)
+	{
+		QElapsedTimer timer;
+		timer.start();
+		write("ucinewgame");
+		write("isready");
+		if (!waitFor("readyok", s_startupTimeout))
+		{
+			m_errors << "No \"readyok\" after \"ucinewgame\"";
+			break;
+		}
+		times << timer.elapsed();
+	}
+	return timeStats(times);
+}
+
+QVariant EngineProfiler::profileSearches()
+{
+	QVariantMap map;
+	QVariantList npsList;
+	QList<qint64> times;
+	double sum = 0.0;
+	double sumSquares = 0.0;
+
+	const QString go(QString("go depth %1").arg(m_depth));
+	for (int i = 0; i < m_searchCount; i++)
+	{
+		write("ucinewgame");
+		if (readyLatency(s_startupTimeout) < 0)
+			break;
+
+		SearchResult result(search(go, s_searchTimeout));
+		if (!result.ok)
+		{
+			m_errors << QString("The depth %1 search didn't finish "
+					    "in %2 ms").arg(m_depth).arg(s_searchTimeout);
+			break;
+		}
+		times << result.time;
+		npsList << result.nps;
+		sum += result.nps;
+		sumSquares += double(result.nps) * result.nps;
+	}
+
+	map["depth"] = m_depth;
+	map["time"] = timeStats(times);
+	map["nps"] = npsList;
+	if (!npsList.isEmpty())
+	{
+		const double mean = sum / npsList.size();
+		const double stdDev = std::sqrt(qMax(0.0, sumSquares / npsList.size()
+							  - mean * mean));
+		map["npsAverage"] = mean;
+		map["npsStdDev"] = stdDev;
+		// The coefficient of variation: lower is more stable
+		map["npsVariation"] = (mean > 0.0) ? stdDev / mean : 0.0;
+	}
+	return map;
+}
+
+QVariant EngineProfiler::profileMoveTimes()
+{
+	QVariantList list;
+	foreach (int moveTime, m_moveTimes)
+	{
+		QList<qint64> overshoots;
+		const QString go(QString("go movetime %1").arg(moveTime));
+		for (int i = 0; i < m_searchCount; i++)
+		{
+			SearchResult result(search(go, moveTime + s_readyTimeout));
+			if (!result.ok)
+			{
+				m_errors << QString("No \"bestmove\" for a %1 ms "
+						    "movetime search").arg(moveTime);
+				write("stop");
+				waitFor("bestmove", s_readyTimeout);
+				break;
+			}
+			overshoots << result.time - moveTime;
+		}
+
+		QVariantMap map(timeStats(overshoots));
+		map["movetime"] = moveTime;
+		list << map;
+	}
+	return list;
+}
+
+QVariant EngineProfiler::profileMalformedInput()
+{
+	QVariantList list;
+	for (int i = 0; s_malformedInput[i] != 0; i++)
+	{
+		const QString input(s_malformedInput[i]);
+		QVariantMap map;
+		map["input"] = input;
+
+		write(input);
+		const qint64 latency = readyLatency(s_readyTimeout);
+		map["responsive"] = latency >= 0;
+		if (latency >= 0)
+			map["latency"] = latency;
+
+		// A malformed "go" command may still start a search
+		if (input.startsWith("go "))
+		{
+			write("stop");
+			waitFor("bestmove", s_readyTimeout);
+		}
+
+		const bool alive = m_process.state() == QProcess::Running;
+		map["alive"] = alive;
+		list << map;
+		if (!alive)
+		{
+			m_errors << QString("The engine exited after \"%1\"")
+				    .arg(input);
+			break;
+		}
+	}
+	return list;
+}
+
+bool EngineProfiler::run(QTextStream& out)
+{
+	if (m_config.protocol() != "uci")
+	{
+		qWarning("Only UCI engines can be profiled");
+		return false;
+	}
+
+	QVariantMap report;
+	report["engine"] = m_config.name();
+
+	QVariant startup(profileStartup());
+	if (!startup.isValid())
+		return false;
+	report["startup"] = startup;
+	report["isready"] = profileIsReady();
+	report["ucinewgame"] = profileNewGame();
+	report["search"] = profileSearches();
+	report["movetime"] = profileMoveTimes();
+	report["malformedInput"] = profileMalformedInput();
+
+	QVariantList errors;
+	foreach (const QString& error, m_errors)
+		errors << error;
+	report["errors"] = errors;
+
+	JsonSerializer serializer(report);
+	bool ok = serializer.serialize(out);
+	out.flush();
+	return ok;
+}
@@ -0,0 +1,105 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ENGINEPROFILER_H
+#define ENGINEPROFILER_H
+
+#include <QList>
+#include <QProcess>
+#include <QVariant>
+#include <engineconfiguration.h>
+class QTextStream;
+
+/*!
+ * \brief A performance and compliance profiler for UCI engines.
+ *
+ * EngineProfiler talks to a UCI engine directly and measures how well
+ * it fits an automated testing harness:
+ * - the time from starting the process to "uciok" and "readyok"
+ * - the "isready" latency of an idle engine and a searching engine
+ * - the cost of "ucinewgame"
+ * - the speed (nps) and its stability over repeated fixed-depth
+ *   searches of the starting position
+ * - the time overshoot of "go movetime" searches
+ * - whether the engine survives and keeps answering "isready"
+ *   after malformed commands
+ *
+ * The report is written as a JSON object. Each step is run in order
+ * with a timeout, so a hung engine fails the step instead of the
+ * whole profile.
+ */
+class EngineProfiler
+{
+	public:
+		/*! Creates a new profiler for the engine \a config. */
+		EngineProfiler(const EngineConfiguration& config);
+		/*! Destroys the profiler and the engine process. */
+		~EngineProfiler();
+
+		/*! Sets the depth of the fixed-depth searches to \a depth. */
+		void setDepth(int depth);
+		/*!
+		 * Sets the number of repetitions of each fixed-depth and
+		 * movetime search to \a count.
+		 */
+		void setSearchCount(int count);
+		/*! Sets the search times of the movetime tests to \a times. */
+		void setMoveTimes(const QList<int>& times);
+
+		/*!
+		 * Profiles the engine and writes the report to \a out.
+		 * Returns false if the engine couldn't be started or
+		 * didn't complete the UCI handshake.
+		 */
+		bool run(QTextStream& out);
+
+	private:
+		struct SearchResult
+		{
+			bool ok;
+			qint64 time;
+			quint64 nodes;
+			quint64 nps;
+		};
+
+		bool start();
+		void write(const QString& line);
+		bool waitFor(const QString& command, int timeout,
+			     QString* line = 0);
+		qint64 readyLatency(int timeout);
+		SearchResult search(const QString& go, int timeout);
+		void readInfo(const QString& line, SearchResult* result) const;
+
+		QVariant profileStartup();
+		QVariant profileIsReady();
+		QVariant profileNewGame();
+		QVariant profileSearches();
+		QVariant profileMoveTimes();
+		QVariant profileMalformedInput();
+
+		static QVariantMap timeStats(const QList<qint64>& times);
+
+		EngineConfiguration m_config;
+		int m_depth;
+		int m_searchCount;
+		QList<int> m_moveTimes;
+		QProcess m_process;
+		QStringList m_errors;
+};
+
+#endif // ENGINEPROFILER_H
@@ -0,0 +1,354 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "epdtest.h"
+#include <QFile>
+#include <QTextStream>
+#include <QMutexLocker>
+#include <board/board.h>
+#include <board/boardfactory.h>
+#include <chessgame.h>
+#include <chessplayer.h>
+#include <pgngame.h>
+#include <epdrecord.h>
+#include <gamemanager.h>
+#include <enginebuilder.h>
+#include <humanbuilder.h>
+
+
+EpdTest::EpdTest(GameManager* manager, QObject* parent)
+	: QObject(parent),
+	  m_manager(manager),
+	  m_engine(0),
+	  m_opponent(new HumanBuilder("EPD test")),
+	  m_variant("standard"),
+	  m_debug(false),
+	  m_stopping(false),
+	  m_nextTest(0),
+	  m_finishedTests(0)
+{
+	Q_ASSERT(manager != 0);
+
+	m_startTime.start();
+}
+
+EpdTest::~EpdTest()
+{
+	delete m_engine;
+	delete m_opponent;
+}
+
+bool EpdTest::load(const QString& fileName, const QString& variant)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		qWarning("Can't open EPD file %s", qPrintable(fileName));
+		return false;
+	}
+
+	Chess::Board* board = Chess::BoardFactory::create(variant);
+	if (board == 0)
+	{
+		qWarning("Unknown chess variant: %s", qPrintable(variant));
+		return false;
+	}
+	m_variant = variant;
+	m_tests.clear();
+
+	QTextStream stream(&file);
+	EpdRecord record;
+	int skipped = 0;
+	while (record.parse(stream))
+	{
+		Test test;
+		test.fen = record.fen();
+		if (!board->setFenString(test.fen))
+		{
+			qWarning("Invalid FEN string: %s", qPrintable(test.fen));
+			skipped++;
+			continue;
+		}
+		test.side = board->sideToMove();
+
+		// The moves are compared as generic moves, because the
+		// same move can be written in many ways in SAN
+		test.bestMoveStrings = record.operands("bm");
+		test.avoidMoveStrings = record.operands("am");
+		foreach (const QString& str, test.bestMoveStrings + test.avoidMoveStrings)
+		{
+			Chess::Move move(board->moveFromString(str));
+			if (move.isNull())
+			{
+				qWarning("Illegal move %s in position %s",
+					 qPrintable(str), qPrintable(test.fen));
+				continue;
+			}
+			if (test.bestMoveStrings.contains(str))
+				test.bestMoves.append(board->genericMove(move));
+			else
+				test.avoidMoves.append(board->genericMove(move));
+		}
+		if (test.bestMoves.isEmpty() && test.avoidMoves.isEmpty())
+		{
+			skipped++;
+			continue;
+		}
+
+		test.id = record.operands("id").join(" ");
+		if (test.id.isEmpty())
+			test.id = QString::number(m_tests.size() + 1);
+		test.hasMove = false;
+		test.solved = false;
+		test.time = 0;
+		test.nodes = 0;
+		test.depth = 0;
+		m_tests.append(test);
+	}
+	Chess::BoardFactory::release(board);
+
+	if (skipped > 0)
+		qWarning("Skipped %d positions without valid bm or am moves", skipped);
+	if (m_tests.isEmpty())
+	{
+		qWarning("No test positions in %s", qPrintable(fileName));
+		return false;
+	}
+	return true;
+}
+
+void EpdTest::setEngine(const EngineConfiguration& config,
+			const TimeControl& timeControl)
+{
+	delete m_engine;
+	m_engine = new EngineBuilder(config);
+	m_timeControl = timeControl;
+}
+
+void EpdTest::setDebugMode(bool debug)
+{
+	m_debug = debug;
+}
+
+void EpdTest::start()
+{
+	Q_ASSERT(m_engine != 0);
+
+	if (m_debug)
+		connect(m_manager, SIGNAL(debugMessage(QString)),
+			this, SLOT(print(QString)));
+	connect(m_manager, SIGNAL(ready()),
+		this, SLOT(startNextTest()));
+
+	m_stopping = false;
+	m_nextTest = 0;
+	m_finishedTests = 0;
+	m_startTime.start();
+	qDebug("Running %d test positions", m_tests.size());
+
+	startNextTest();
+}
+
+void EpdTest::stop()
+{
+	if (m_stopping)
+		return;
+
+	m_stopping = true;
+	disconnect(m_manager, SIGNAL(ready()),
+		   this, SLOT(startNextTest()));
+
+	if (m_games.isEmpty())
+	{
+		printSummary();
+		connect(m_manager, SIGNAL(finished()),
+			this, SIGNAL(finished()));
+		m_manager->finish();
+		return;
+	}
+
+	foreach (ChessGame* game, m_games)
+		QMetaObject::invokeMethod(game, "stop", Qt::QueuedConnection);
+}
+
+void EpdTest::startNextTest()
+{
+	if (m_stopping || m_nextTest >= m_tests.size())
+		return;
+
+	int index = m_nextTest++;
+	const Test& test = m_tests.at(index);
+
+	Chess::Board* board = Chess::BoardFactory::create(m_variant);
+	Q_ASSERT(board != 0);
+	ChessGame* game = new ChessGame(board, new PgnGame());
+	game->setProperty("epdTest", index);
+	game->setStartingFen(test.fen);
+	game->setTimeControl(m_timeControl);
+	m_games.append(game);
+
+	// The engine's move is recorded in the game thread, and the
+	// game is stopped before the opponent has to move.
+	connect(game, SIGNAL(moveMade(Chess::GenericMove, QString, QString)),
+		this, SLOT(onMoveMade(Chess::GenericMove, QString, QString)),
+		Qt::DirectConnection);
+	connect(game, SIGNAL(finished(ChessGame*)),
+		this, SLOT(onGameFinished(ChessGame*)));
+	connect(game, SIGNAL(startFailed(ChessGame*)),
+		this, SLOT(onGameStartFailed(ChessGame*)));
+
+	if (test.side == Chess::Side::White)
+		m_manager->newGame(game, m_engine, m_opponent,
+				   GameManager::Enqueue, GameManager::ReusePlayers);
+	else
+		m_manager->newGame(game, m_opponent, m_engine,
+				   GameManager::Enqueue, GameManager::ReusePlayers);
+}
+
+void EpdTest::onMoveMade(const Chess::GenericMove& move,
+			 const QString& sanString,
+			 const QString& comment)
+{
+	Q_UNUSED(comment);
+
+	ChessGame* game = qobject_cast<ChessGame*>(QObject::sender());
+	Q_ASSERT(game != 0);
+
+	int index = game->property("epdTest").toInt();
+	{
+		QMutexLocker locker(&m_mutex);
+		Test& test = m_tests[index];
+		if (test.hasMove)
+			return;
+
+		const MoveEvaluation& eval(game->player(test.side)->evaluation());
+		test.hasMove = true;
+		test.move = sanString;
+		test.solved = isSolution(test, move);
+		test.time = eval.time();
+		test.nodes = eval.nodeCount();
+		test.depth = eval.depth();
+	}
+
+	QMetaObject::invokeMethod(game, "stop", Qt::QueuedConnection);
+}
+
+void EpdTest::onGameFinished(ChessGame* game)
+{
+	finishTest(game);
+}
+
+void EpdTest::onGameStartFailed(ChessGame* game)
+{
+	qWarning("%s", qPrintable(game->errorString()));
+	finishTest(game);
+	stop();
+}
+
+void EpdTest::finishTest(ChessGame* game)
+{
+	if (!m_games.contains(game))
+		return;
+	m_games.removeOne(game);
+
+	int index = game->property("epdTest").toInt();
+	Test test;
+	{
+		QMutexLocker locker(&m_mutex);
+		test = m_tests.at(index);
+	}
+	game->deleteLater();
+	m_finishedTests++;
+
+	QString expected;
+	if (!test.bestMoveStrings.isEmpty())
+		expected = "bm " + test.bestMoveStrings.join(" ");
+	if (!test.avoidMoveStrings.isEmpty())
+	{
+		if (!expected.isEmpty())
+			expected += ", ";
+		expected += "am " + test.avoidMoveStrings.join(" ");
+	}
+
+	if (test.hasMove)
+		qDebug("%d/%d %s: %s (%s) %s, time %d ms, nodes %llu, depth %d",
+		       m_finishedTests, m_tests.size(), qPrintable(test.id),
+		       qPrintable(test.move), qPrintable(expected),
+		       test.solved ? "solved" : "failed",
+		       test.time, test.nodes, test.depth);
+	else if (!m_stopping)
+		qDebug("%d/%d %s: no move (%s) failed",
+		       m_finishedTests, m_tests.size(), qPrintable(test.id),
+		       qPrintable(expected));
+
+	if (m_finishedTests >= m_tests.size() || (m_stopping && m_games.isEmpty()))
+	{
+		m_stopping = false;
+		stop();
+	}
+}
+
+bool EpdTest::isSolution(const Test& test, const Chess::GenericMove& move) const
+{
+	if (test.avoidMoves.contains(move))
+		return false;
+	return test.bestMoves.isEmpty() || test.bestMoves.contains(move);
+}
+
+void EpdTest::printSummary()
+{
+	int moved = 0;
+	int solved = 0;
+	qint64 solveTime = 0;
+	quint64 solveNodes = 0;
+	quint64 totalNodes = 0;
+	QStringList unsolved;
+
+	foreach (const Test& test, m_tests)
+	{
+		if (!test.hasMove)
+			continue;
+		moved++;
+		totalNodes += test.nodes;
+		if (test.solved)
+		{
+			solved++;
+			solveTime += test.time;
+			solveNodes += test.nodes;
+		}
+		else
+			unsolved.append(test.id);
+	}
+
+	qDebug("Solved %d of %d positions (%.1f%%) in %lld ms",
+	       solved, moved, moved > 0 ? 100.0 * solved / moved : 0.0,
+	       m_startTime.elapsed());
+	if (solved > 0)
+		qDebug("Average solve time %lld ms, average solve nodes %llu",
+		       solveTime / solved, solveNodes / solved);
+	qDebug("Total nodes %llu", totalNodes);
+	if (moved < m_tests.size())
+		qDebug("%d positions weren't tested", m_tests.size() - moved);
+	if (!unsolved.isEmpty())
+		qDebug("Unsolved: %s", qPrintable(unsolved.join(", ")));
+}
+
+void EpdTest::print(const QString& msg)
+{
+	qDebug("%lld %s", m_startTime.elapsed(), qPrintable(msg));
+}
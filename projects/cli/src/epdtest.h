@@ -0,0 +1,132 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef EPDTEST_H
+#define EPDTEST_H
+
+#include <QObject>
+#include <QList>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <timecontrol.h>
+#include <board/genericmove.h>
+#include <board/side.h>
+
+class ChessGame;
+class GameManager;
+class EngineConfiguration;
+class PlayerBuilder;
+
+
+/*!
+ * \brief A runner for EPD test suites.
+ *
+ * EpdTest gives the positions of an EPD test suite to an engine one
+ * at a time, and compares the engine's moves to the best moves
+ * ("bm") and the moves to avoid ("am") of each position. Each position
+ * is analyzed in its own game, so the positions are distributed over
+ * GameManager::concurrency() engine instances.
+ */
+class EpdTest : public QObject
+{
+	Q_OBJECT
+
+	public:
+		/*! Creates a new test runner that plays in \a manager. */
+		EpdTest(GameManager* manager, QObject* parent = 0);
+		/*! Destroys the test runner. */
+		virtual ~EpdTest();
+
+		/*!
+		 * Reads the test positions of variant \a variant from
+		 * \a fileName. Positions without a "bm" or "am" operation
+		 * are skipped. Returns true if any positions were read.
+		 */
+		bool load(const QString& fileName, const QString& variant);
+		/*!
+		 * Sets the engine to \a config and its time control for
+		 * each position to \a timeControl.
+		 */
+		void setEngine(const EngineConfiguration& config,
+			       const TimeControl& timeControl);
+		/*! Enables the engines' debug output if \a debug is true. */
+		void setDebugMode(bool debug);
+
+		/*! Starts the test. */
+		void start();
+
+	public slots:
+		/*! Stops the test after the current positions. */
+		void stop();
+
+	signals:
+		/*! Emitted when the test is finished or stopped. */
+		void finished();
+
+	private slots:
+		void startNextTest();
+		void onMoveMade(const Chess::GenericMove& move,
+				const QString& sanString,
+				const QString& comment);
+		void onGameFinished(ChessGame* game);
+		void onGameStartFailed(ChessGame* game);
+		void print(const QString& msg);
+
+	private:
+		struct Test
+		{
+			QString id;
+			QString fen;
+			Chess::Side side;
+			QStringList bestMoveStrings;
+			QStringList avoidMoveStrings;
+			QList<Chess::GenericMove> bestMoves;
+			QList<Chess::GenericMove> avoidMoves;
+
+			bool hasMove;
+			QString move;
+			bool solved;
+			int time;
+			quint64 nodes;
+			int depth;
+		};
+
+		bool isSolution(const Test& test,
+				const Chess::GenericMove& move) const;
+		void finishTest(ChessGame* game);
+		void printSummary();
+
+		GameManager* m_manager;
+		PlayerBuilder* m_engine;
+		PlayerBuilder* m_opponent;
+		TimeControl m_timeControl;
+		QString m_variant;
+		bool m_debug;
+		bool m_stopping;
+		QVector<Test> m_tests;
+		int m_nextTest;
+		int m_finishedTests;
+		QList<ChessGame*> m_games;
+		QMutex m_mutex;
+		QElapsedTimer m_startTime;
+};
+
+#endif // EPDTEST_H
@@ -0,0 +1,388 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "jobserver.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTextStream>
+#include <chessgame.h>
+#include <chessplayer.h>
+#include <gamemanager.h>
+#include <openingbook.h>
+#include <tournament.h>
+#include <jsonparser.h>
+#include "enginematch.h"
+
+
+static void writeVariant(JsonWriter& writer, const QVariant& value)
+{
+	switch (value.type())
+	{
+	case QVariant::Invalid:
+		writer.writeNull();
+		break;
+	case QVariant::Bool:
+		writer.writeValue(value.toBool());
+		break;
+	case QVariant::Int:
+		writer.writeValue(value.toInt());
+		break;
+	case QVariant::UInt:
+	case QVariant::LongLong:
+	case QVariant::ULongLong:
+		writer.writeValue(value.toLongLong());
+		break;
+	case QVariant::Double:
+		writer.writeValue(value.toDouble());
+		break;
+	case QVariant::List:
+	case QVariant::StringList:
+		writer.beginArray();
+		foreach (const QVariant& item, value.toList())
+			writeVariant(writer, item);
+		writer.endArray();
+		break;
+	case QVariant::Map:
+		{
+			writer.beginObject();
+			const QVariantMap map(value.toMap());
+			QVariantMap::const_iterator it;
+			for (it = map.constBegin(); it != map.constEnd(); ++it)
+			{
+				writer.writeName(it.key());
+				writeVariant(writer, it.value());
+			}
+			writer.endObject();
+		}
+		break;
+	default:
+		writer.writeValue(value.toString());
+		break;
+	}
+}
+
+
+JobServer::JobServer(GameManager* manager,
+		     MatchFactory factory,
+		     QObject* parent)
+	: QObject(parent),
+	  m_manager(manager),
+	  m_factory(factory),
+	  m_server(new QLocalServer(this)),
+	  m_concurrency(manager->concurrency()),
+	  m_poolSize(manager->playerPoolSize()),
+	  m_nextId(1),
+	  m_stopping(false)
+{
+	Q_ASSERT(manager != 0);
+	Q_ASSERT(factory != 0);
+
+	connect(m_server, SIGNAL(newConnection()),
+		this, SLOT(onNewConnection()));
+}
+
+JobServer::~JobServer()
+{
+	qDeleteAll(m_jobs);
+}
+
+bool JobServer::listen(const QString& name)
+{
+	// Any client of the server can run commands, so only the
+	// user who started it may connect
+	#if QT_VERSION >= 0x050000
+	m_server->setSocketOptions(QLocalServer::UserAccessOption);
+	#endif
+
+	if (!m_server->listen(name))
+	{
+		qWarning("Can't listen on %s: %s",
+			 qPrintable(name),
+			 qPrintable(m_server->errorString()));
+		return false;
+	}
+
+	qDebug("Waiting for jobs on %s", qPrintable(m_server->fullServerName()));
+	return true;
+}
+
+void JobServer::stop()
+{
+	if (m_stopping)
+		return;
+
+	m_stopping = true;
+	m_server->close();
+
+	if (m_jobs.isEmpty())
+	{
+		finishManager();
+		return;
+	}
+
+	foreach (Job* job, m_jobs)
+		job->match->stop();
+}
+
+void JobServer::onNewConnection()
+{
+	while (m_server->hasPendingConnections())
+	{
+		QLocalSocket* client = m_server->nextPendingConnection();
+		connect(client, SIGNAL(readyRead()),
+			this, SLOT(onReadyRead()));
+		connect(client, SIGNAL(disconnected()),
+			this, SLOT(onDisconnected()));
+	}
+}
+
+void JobServer::onReadyRead()
+{
+	QLocalSocket* client = qobject_cast<QLocalSocket*>(sender());
+	Q_ASSERT(client != 0);
+
+	while (client->canReadLine())
+	{
+		QByteArray line(client->readLine().trimmed());
+		if (!line.isEmpty())
+			handleRequest(client, line);
+	}
+}
+
+void JobServer::onDisconnected()
+{
+	QLocalSocket* client = qobject_cast<QLocalSocket*>(sender());
+	Q_ASSERT(client != 0);
+
+	// Nobody is waiting for the results of the client's jobs
+	foreach (Job* job, m_jobs)
+	{
+		if (job->client != client)
+			continue;
+
+		job->client = 0;
+		job->match->stop();
+	}
+
+	client->deleteLater();
+}
+
+void JobServer::handleRequest(QLocalSocket* client, const QByteArray& line)
+{
+	QTextStream stream(line, QIODevice::ReadOnly);
+	JsonParser parser(stream);
+	const QVariantMap request(parser.parse().toMap());
+	if (parser.hasError() || request.isEmpty())
+	{
+		sendStatus(client, "error", QString(), tr("Invalid request"));
+		return;
+	}
+
+	const QString type(request.value("type").toString());
+	QString id(request.value("id").toString());
+
+	if (type == "job")
+	{
+		if (m_stopping)
+		{
+			sendStatus(client, "error", id, tr("The server is stopping"));
+			return;
+		}
+		if (id.isEmpty())
+			id = QString::number(m_nextId++);
+		else if (findJob(client, id) != 0)
+		{
+			sendStatus(client, "error", id, tr("Duplicate job id"));
+			return;
+		}
+
+		startJob(client, id, request.value("arguments").toStringList());
+	}
+	else if (type == "stop")
+	{
+		Job* job = findJob(client, id);
+		if (job == 0)
+		{
+			sendStatus(client, "error", id, tr("Unknown job id"));
+			return;
+		}
+		job->match->stop();
+	}
+	else
+		sendStatus(client, "error", id, tr("Unknown request type"));
+}
+
+void JobServer::startJob(QLocalSocket* client,
+			 const QString& id,
+			 const QStringList& arguments)
+{
+	EngineMatch* match = m_factory(arguments, this);
+
+	// The jobs share the game manager's settings
+	m_manager->setConcurrency(m_concurrency);
+	m_manager->setPlayerPoolSize(m_poolSize);
+
+	if (match == 0)
+	{
+		sendStatus(client, "error", id, tr("Invalid match arguments"));
+		return;
+	}
+
+	Tournament* tournament = match->tournament();
+	Job* job = new Job;
+	job->id = id;
+	job->client = client;
+	job->match = match;
+	job->timer.start();
+	m_jobs[tournament] = job;
+
+	match->setSharedGameManager(true);
+	connect(tournament, SIGNAL(gameFinished(ChessGame*, int, int, int)),
+		this, SLOT(onGameFinished(ChessGame*, int)));
+	connect(match, SIGNAL(finished()),
+		this, SLOT(onMatchFinished()));
+
+	qDebug("Starting job %s", qPrintable(id));
+	sendStatus(client, "accepted", id);
+	match->start();
+}
+
+JobServer::Job* JobServer::findJob(QLocalSocket* client, const QString& id)
+{
+	foreach (Job* job, m_jobs)
+	{
+		if (job->client == client && job->id == id)
+			return job;
+	}
+
+	return 0;
+}
+
+void JobServer::onGameFinished(ChessGame* game, int number)
+{
+	Tournament* tournament = qobject_cast<Tournament*>(sender());
+	Job* job = m_jobs.value(tournament);
+	if (job == 0 || job->client == 0)
+		return;
+
+	const Chess::Result result(game->result());
+
+	m_writer.beginObject();
+	m_writer.writeName("type");
+	m_writer.writeValue("game");
+	m_writer.writeName("id");
+	m_writer.writeValue(job->id);
+	m_writer.writeName("game");
+	m_writer.writeValue(number);
+	m_writer.writeName("time");
+	m_writer.writeValue(job->timer.elapsed());
+	m_writer.writeName("white");
+	m_writer.writeValue(game->player(Chess::Side::White)->name());
+	m_writer.writeName("black");
+	m_writer.writeValue(game->player(Chess::Side::Black)->name());
+	m_writer.writeName("result");
+	m_writer.writeValue(result.toShortString());
+	m_writer.writeName("termination");
+	m_writer.writeValue(result.description());
+	m_writer.writeName("plies");
+	m_writer.writeValue(game->moves().size());
+	m_writer.endObject();
+	send(job->client);
+}
+
+void JobServer::onMatchFinished()
+{
+	EngineMatch* match = qobject_cast<EngineMatch*>(sender());
+	Q_ASSERT(match != 0);
+
+	Tournament* tournament = match->tournament();
+	Job* job = m_jobs.take(tournament);
+	Q_ASSERT(job != 0);
+
+	if (job->client != 0)
+	{
+		m_writer.beginObject();
+		m_writer.writeName("type");
+		m_writer.writeValue("finished");
+		m_writer.writeName("id");
+		m_writer.writeValue(job->id);
+		m_writer.writeName("time");
+		m_writer.writeValue(job->timer.elapsed());
+		const QString error(tournament->errorString());
+		if (!error.isEmpty())
+		{
+			m_writer.writeName("error");
+			m_writer.writeValue(error);
+		}
+		m_writer.writeName("summary");
+		writeVariant(m_writer, tournament->summary());
+		m_writer.endObject();
+		send(job->client);
+	}
+	qDebug("Finished job %s", qPrintable(job->id));
+
+	// Keep the books loaded for the next jobs
+	foreach (const QSharedPointer<const OpeningBook>& book,
+		 match->openingBooks())
+	{
+		if (!m_books.contains(book))
+			m_books.append(book);
+	}
+
+	delete job;
+	match->deleteLater();
+	tournament->deleteLater();
+
+	if (m_stopping && m_jobs.isEmpty())
+		finishManager();
+}
+
+void JobServer::sendStatus(QLocalSocket* client,
+			   const char* type,
+			   const QString& id,
+			   const QString& message)
+{
+	m_writer.beginObject();
+	m_writer.writeName("type");
+	m_writer.writeValue(type);
+	m_writer.writeName("id");
+	if (id.isEmpty())
+		m_writer.writeNull();
+	else
+		m_writer.writeValue(id);
+	if (!message.isEmpty())
+	{
+		m_writer.writeName("message");
+		m_writer.writeValue(message);
+	}
+	m_writer.endObject();
+	send(client);
+}
+
+void JobServer::send(QLocalSocket* client)
+{
+	client->write(m_writer.data());
+	m_writer.clear();
+}
+
+void JobServer::finishManager()
+{
+	m_books.clear();
+	connect(m_manager, SIGNAL(finished()), this, SIGNAL(finished()));
+	m_manager->finish();
+}
@@ -0,0 +1,130 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef JOBSERVER_H
+#define JOBSERVER_H
+
+#include <QObject>
+#include <QMap>
+#include <QList>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <jsonwriter.h>
+
+class QLocalServer;
+class QLocalSocket;
+class ChessGame;
+class EngineMatch;
+class GameManager;
+class OpeningBook;
+class Tournament;
+
+/*!
+ * \brief A long-running server that plays match jobs sent over a
+ * local socket.
+ *
+ * Each client request is one line of compact JSON. A job request
+ * looks like {"type":"job","id":"ID","arguments":[...]}, where the
+ * arguments are the usual match arguments, and a running job is
+ * stopped with {"type":"stop","id":"ID"}. The server answers with
+ * an "accepted" or "error" record, then sends a "game" record for
+ * every finished game and a "finished" record with the match
+ * summary when the job ends.
+ *
+ * All jobs share one GameManager, so they share its concurrency
+ * limit and its pool of idle engines. The opening books of finished
+ * jobs are kept loaded for later jobs.
+ */
+class JobServer : public QObject
+{
+	Q_OBJECT
+
+	public:
+		/*! A function that creates a match from its arguments. */
+		typedef EngineMatch* (*MatchFactory)(const QStringList& args,
+						     QObject* parent);
+
+		/*!
+		 * Creates a new server that plays the jobs with \a manager
+		 * and creates their matches with \a factory.
+		 *
+		 * The manager's current concurrency and player pool size
+		 * apply to every job, so the jobs can't change them.
+		 */
+		JobServer(GameManager* manager,
+			  MatchFactory factory,
+			  QObject* parent = 0);
+		virtual ~JobServer();
+
+		/*!
+		 * Starts listening for clients at the local socket \a name.
+		 * Returns false on failure.
+		 */
+		bool listen(const QString& name);
+		/*!
+		 * Stops all jobs and the engines. Emits finished() when
+		 * they're done.
+		 */
+		void stop();
+
+	signals:
+		/*! Emitted after stop() when all engines have quit. */
+		void finished();
+
+	private slots:
+		void onNewConnection();
+		void onReadyRead();
+		void onDisconnected();
+		void onGameFinished(ChessGame* game, int number);
+		void onMatchFinished();
+
+	private:
+		struct Job
+		{
+			QString id;
+			QLocalSocket* client;
+			EngineMatch* match;
+			QElapsedTimer timer;
+		};
+
+		void handleRequest(QLocalSocket* client, const QByteArray& line);
+		void startJob(QLocalSocket* client,
+			      const QString& id,
+			      const QStringList& arguments);
+		Job* findJob(QLocalSocket* client, const QString& id);
+		void sendStatus(QLocalSocket* client,
+				const char* type,
+				const QString& id,
+				const QString& message = QString());
+		void send(QLocalSocket* client);
+		void finishManager();
+
+		GameManager* m_manager;
+		MatchFactory m_factory;
+		QLocalServer* m_server;
+		QMap<Tournament*, Job*> m_jobs;
+		QList< QSharedPointer<const OpeningBook> > m_books;
+		JsonWriter m_writer;
+		int m_concurrency;
+		int m_poolSize;
+		int m_nextId;
+		bool m_stopping;
+};
+
+#endif // JOBSERVER_H
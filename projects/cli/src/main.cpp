@@ -23,32 +23,89 @@
 #include <QTextStream>
 #include <QStringList>
 #include <QFile>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QHash>
 
 #include <mersenne.h>
 #include <enginemanager.h>
 #include <enginebuilder.h>
+#include <randombuilder.h>
+#include <pluginbuilder.h>
+#include <engineserver.h>
 #include <gamemanager.h>
 #include <tournament.h>
 #include <tournamentfactory.h>
+#include <gauntlettournament.h>
 #include <board/boardfactory.h>
 #include <enginefactory.h>
 #include <enginetextoption.h>
+#include <openingbook.h>
 #include <openingsuite.h>
+#include <openingstats.h>
+#include <gamearchive.h>
+#include <gameannotator.h>
 #include <sprt.h>
+#include <tracelog.h>
+#include <enginelog.h>
+#include <memorybudget.h>
+#include <fileprefetcher.h>
+#include <jsonreader.h>
+#include <jsonserializer.h>
 #include <board/gaviotatablebase.h>
+#include <board/syzygytablebase.h>
+#include <board/standardboard.h>
 
 #include "cutechesscoreapp.h"
 #include "matchparser.h"
 #include "enginematch.h"
+#include "matchrunner.h"
+#include "startuptimer.h"
+#include "perft.h"
+#include "pgnvalidator.h"
+#include "tbscanner.h"
+#include "pgnfilter.h"
+#include "bookmaker.h"
+#include "suitededuplicator.h"
+#include "endgamegenerator.h"
+#include "epdtest.h"
+#include "openingbalancer.h"
+#include "shardmerger.h"
+#include "sprtsimulator.h"
+#include "engineprofiler.h"
+#include "jobserver.h"
 
 
 static EngineMatch* match = 0;
+static MatchRunner* runner = 0;
+static EpdTest* epdTest = 0;
+static OpeningBalancer* balancer = 0;
+static GameAnnotator* annotator = 0;
+static JobServer* jobServer = 0;
+
+// The player builders of the job server by engine settings, so that
+// later jobs can reuse the idle engines of earlier jobs
+static QMultiHash<QString, PlayerBuilder*>* builderCache = 0;
+// The currently loaded tablebases
+static QStringList syzygyPaths;
+static QString gaviotaSettings;
 
 void sigintHandler(int param)
 {
 	Q_UNUSED(param);
 	if (match != 0)
 		match->stop();
+	else if (runner != 0)
+		runner->stop();
+	else if (epdTest != 0)
+		epdTest->stop();
+	else if (balancer != 0)
+		balancer->stop();
+	else if (annotator != 0)
+		annotator->stop();
+	else if (jobServer != 0)
+		jobServer->stop();
 	else
 		abort();
 }
@@ -59,9 +116,45 @@ struct EngineData
 	EngineConfiguration config;
 	TimeControl tc;
 	QString book;
+	OpeningBook::AccessMode bookMode;
 	int bookDepth;
+	int delay;
 };
 
+static QString builderKey(const EngineData& engine,
+			  int maxRestarts,
+			  int restartWindow)
+{
+	QString key;
+	QTextStream stream(&key);
+	JsonSerializer serializer(engine.config.toVariant());
+	serializer.serialize(stream);
+	stream << engine.config.arguments().join(" ") << '\n'
+	       << engine.delay << ' ' << maxRestarts << ' ' << restartWindow;
+	stream.flush();
+
+	return key;
+}
+
+// Returns a builder for \a key that isn't used by \a tournament yet
+static PlayerBuilder* cachedBuilder(const QString& key,
+				    const Tournament* tournament)
+{
+	if (builderCache == 0)
+		return 0;
+
+	foreach (PlayerBuilder* builder, builderCache->values(key))
+	{
+		bool used = false;
+		for (int i = 0; i < tournament->playerCount() && !used; i++)
+			used = tournament->playerAt(i).builder == builder;
+		if (!used)
+			return builder;
+	}
+
+	return 0;
+}
+
 static bool readEngineConfig(const QString& name, EngineConfiguration& config)
 {
 	const QList<EngineConfiguration> engines =
@@ -101,11 +194,14 @@ static bool parseEngine(const QStringList& args, EngineData& data)
 			data.config.setCommand(val);
 		else if (name == "dir")
 			data.config.setWorkingDirectory(val);
+		else if (name == "host")
+			data.config.setHost(val);
 		else if (name == "arg")
 			data.config.addArgument(val);
 		else if (name == "proto")
 		{
-			if (EngineFactory::protocols().contains(val))
+			if (EngineFactory::protocols().contains(val)
+			||  val == "random" || val == "plugin")
 				data.config.setProtocol(val);
 			else
 			{
@@ -179,8 +275,34 @@ static bool parseEngine(const QStringList& args, EngineData& data)
 			}
 			data.tc.setExpiryMargin(margin);
 		}
+		// Refunds of harness overhead
+		else if (name == "latencycredit")
+		{
+			bool ok = false;
+			int credit = val.toInt(&ok);
+			if (!ok || credit < 0)
+			{
+				qWarning() << "Invalid latency credit:" << val;
+				return false;
+			}
+			data.tc.setLatencyCredit(credit);
+		}
+		else if (name == "datafile")
+			data.config.addDataFile(val);
 		else if (name == "book")
 			data.book = val;
+		else if (name == "bookmode")
+		{
+			if (val == "ram")
+				data.bookMode = OpeningBook::Ram;
+			else if (val == "disk")
+				data.bookMode = OpeningBook::Disk;
+			else
+			{
+				qWarning() << "Invalid book mode:" << val;
+				return false;
+			}
+		}
 		else if (name == "bookdepth")
 		{
 			if (val.toInt() <= 0)
@@ -190,10 +312,26 @@ static bool parseEngine(const QStringList& args, EngineData& data)
 			}
 			data.bookDepth = val.toInt();
 		}
+		// Move delay of the built-in random player
+		else if (name == "delay")
+		{
+			bool delayOk = false;
+			int delay = val.toInt(&delayOk);
+			if (!delayOk || delay < 0)
+			{
+				qWarning() << "Invalid move delay:" << val;
+				return false;
+			}
+			data.delay = delay;
+		}
 		else if (name == "whitepov")
 		{
 			data.config.setWhiteEvalPov(true);
 		}
+		else if (name == "ponder")
+		{
+			data.config.setPondering(true);
+		}
 		else if (name == "depth")
 		{
 			if (val.toInt() <= 0)
@@ -212,6 +350,17 @@ static bool parseEngine(const QStringList& args, EngineData& data)
 			}
 			data.tc.setNodeLimit(val.toInt());
 		}
+		else if (name == "nodetolerance")
+		{
+			bool ok = false;
+			int tolerance = val.toInt(&ok);
+			if (!ok || tolerance < 0)
+			{
+				qWarning() << "Invalid node tolerance:" << val;
+				return false;
+			}
+			data.tc.setNodeTolerance(tolerance);
+		}
 		// Custom engine option
 		else if (name.startsWith("option."))
 			data.config.setOption(name.section('.', 1), val);
@@ -225,6 +374,68 @@ static bool parseEngine(const QStringList& args, EngineData& data)
 	return true;
 }
 
+/*
+ * Measures the speed of this host with a single-threaded perft and
+ * returns the factor by which the time controls have to be multiplied
+ * to match a reference host that runs the same workload at
+ * \a referenceNps nodes per second. Returns 0 on failure.
+ */
+static double calibrationFactor(int referenceNps)
+{
+	Chess::Board* board = Chess::BoardFactory::create("standard");
+	Q_ASSERT(board != 0);
+	board->setFenString(board->defaultFenString());
+
+	QString output;
+	QTextStream out(&output);
+	Perft perft(board, 5);
+
+	QElapsedTimer timer;
+	timer.start();
+	quint64 nodes = perft.run(out);
+	qint64 elapsed = timer.elapsed();
+	delete board;
+
+	if (elapsed <= 0)
+		return 0.0;
+
+	quint64 nps = nodes * 1000 / elapsed;
+	double factor = double(referenceNps) / double(nps);
+	qDebug("Calibration: %llu nodes/second, time scale %.3f",
+	       nps, factor);
+
+	return factor;
+}
+
+static bool parseSprt(const MatchParser::Option& option, Sprt* sprt)
+{
+	QMap<QString, QString> params = option.toMap(
+		"elo0|elo1|alpha|beta|model=trinomial|elomodel=logistic");
+	bool sprtOk[4];
+	double elo0 = params["elo0"].toDouble(sprtOk);
+	double elo1 = params["elo1"].toDouble(sprtOk + 1);
+	double alpha = params["alpha"].toDouble(sprtOk + 2);
+	double beta = params["beta"].toDouble(sprtOk + 3);
+
+	bool ok = (sprtOk[0] && sprtOk[1] && sprtOk[2] && sprtOk[3]);
+
+	Sprt::Model model = Sprt::Trinomial;
+	if (params["model"] == "pentanomial")
+		model = Sprt::Pentanomial;
+	else if (params["model"] != "trinomial")
+		ok = false;
+
+	Sprt::EloModel eloModel = Sprt::LogisticElo;
+	if (params["elomodel"] == "normalized")
+		eloModel = Sprt::NormalizedElo;
+	else if (params["elomodel"] != "logistic")
+		ok = false;
+
+	if (ok)
+		sprt->initialize(elo0, elo1, alpha, beta, model, eloModel);
+	return ok;
+}
+
 static EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 {
 	MatchParser parser(args);
@@ -232,23 +443,64 @@ static EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 	parser.addOption("-each", QVariant::StringList, 1);
 	parser.addOption("-variant", QVariant::String, 1, 1);
 	parser.addOption("-concurrency", QVariant::Int, 1, 1);
+	parser.addOption("-enginepool", QVariant::Int, 1, 1);
+	parser.addOption("-warmup", QVariant::Int, 1, 1);
+	parser.addOption("-quittimeout", QVariant::Int, 1, 1);
+	parser.addOption("-priority", QVariant::Int, 1, 1);
+	parser.addOption("-affinity", QVariant::Int, 1, 1);
+	parser.addOption("-maxoverhead", QVariant::Int, 1, 1);
+	parser.addOption("-calibrate", QVariant::Int, 1, 1);
+	parser.addOption("-workers", QVariant::StringList, 1, -1);
+	parser.addOption("-workersecret", QVariant::String, 1, 1);
+	parser.addOption("-recordio", QVariant::String, 1, 1);
+	parser.addOption("-resourcelimit", QVariant::StringList);
+	parser.addOption("-hashbudget", QVariant::StringList);
+	parser.addOption("-replayio", QVariant::String, 1, 1);
+	parser.addOption("-stderr", QVariant::StringList, 1, 2);
+	parser.addOption("-cgroup", QVariant::StringList, 1, 3);
 	parser.addOption("-draw", QVariant::StringList);
 	parser.addOption("-resign", QVariant::StringList);
-	parser.addOption("-gtb", QVariant::String, 1, 1);
+	parser.addOption("-win", QVariant::StringList);
+	parser.addOption("-mate", QVariant::Bool, 0, 0);
+	parser.addOption("-maxmoves", QVariant::Int, 1, 1);
+	parser.addOption("-gtb", QVariant::StringList, 1, 4);
+	parser.addOption("-syzygy", QVariant::String, 1, 1);
+	parser.addOption("-tbshare", QVariant::StringList);
 	parser.addOption("-tournament", QVariant::String, 1, 1);
 	parser.addOption("-event", QVariant::String, 1, 1);
 	parser.addOption("-games", QVariant::Int, 1, 1);
 	parser.addOption("-rounds", QVariant::Int, 1, 1);
 	parser.addOption("-sprt", QVariant::StringList);
+	parser.addOption("-gauntletstop", QVariant::Double, 1, 1);
 	parser.addOption("-ratinginterval", QVariant::Int, 1, 1);
+	parser.addOption("-crosstable", QVariant::Bool, 0, 0);
+	parser.addOption("-stats", QVariant::Int, 1, 1);
+	parser.addOption("-statstrace", QVariant::String, 1, 1);
+	parser.addOption("-timeline", QVariant::String, 1, 1);
+	parser.addOption("-enginelog", QVariant::String, 1, 1);
+	parser.addOption("-jsonout", QVariant::String, 1, 1);
+	parser.addOption("-resultdb", QVariant::String, 1, 1);
+	parser.addOption("-metrics", QVariant::String, 1, 1);
+	parser.addOption("-broadcast", QVariant::String, 1, 1);
 	parser.addOption("-debug", QVariant::Bool, 0, 0);
 	parser.addOption("-openings", QVariant::StringList);
+	parser.addOption("-openingstats", QVariant::String, 1, 1);
+	parser.addOption("-pruneopenings", QVariant::StringList);
 	parser.addOption("-pgnout", QVariant::StringList, 1, 2);
+	parser.addOption("-pgnrotate", QVariant::StringList);
+	parser.addOption("-archiveout", QVariant::String, 1, 1);
+	parser.addOption("-checkpoint", QVariant::StringList);
+	parser.addOption("-resume", QVariant::Bool, 0, 0);
 	parser.addOption("-repeat", QVariant::Bool, 0, 0);
+	parser.addOption("-pairedstart", QVariant::Bool, 0, 0);
 	parser.addOption("-recover", QVariant::Bool, 0, 0);
+	parser.addOption("-abortonstop", QVariant::Bool, 0, 0);
+	parser.addOption("-restarts", QVariant::StringList);
 	parser.addOption("-site", QVariant::String, 1, 1);
 	parser.addOption("-srand", QVariant::UInt, 1, 1);
 	parser.addOption("-wait", QVariant::Int, 1, 1);
+	parser.addOption("-shard", QVariant::String, 1, 1);
+	parser.addOption("-summary", QVariant::String, 1, 1);
 	if (!parser.parse())
 		return 0;
 
@@ -264,11 +516,27 @@ static EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 		return 0;
 	}
 
+	if (builderCache != 0)
+		tournament->setPlayerBuildersOwned(false);
 	EngineMatch* match = new EngineMatch(tournament, parent);
 
 	QList<EngineData> engines;
 	QStringList eachOptions;
 	GameAdjudicator adjudicator;
+	int maxRestarts = 0;
+	int restartWindow = 0;
+	int referenceNps = 0;
+	MemoryBudget* memoryBudget = 0;
+	QString cgroupDir;
+	int cgroupCpu = -1;
+	int cgroupMemory = -1;
+	QString checkpointFile;
+	bool resume = false;
+	QString openingStatsFile;
+	QString prunedSuiteFile;
+	int pruneMinGames = 0;
+	int pruneMaxShare = 0;
+	bool repeat = false;
 
 	foreach (const MatchParser::Option& option, parser.options())
 	{
@@ -281,7 +549,9 @@ static EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 		if (name == "-engine")
 		{
 			EngineData engine;
+			engine.bookMode = OpeningBook::Ram;
 			engine.bookDepth = 1000;
+			engine.delay = 0;
 			ok = parseEngine(value.toStringList(), engine);
 			if (ok)
 				engines.append(engine);
@@ -302,6 +572,141 @@ static EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 			if (ok)
 				manager->setConcurrency(value.toInt());
 		}
+		// Idle engine instances kept alive per engine
+		else if (name == "-enginepool")
+		{
+			ok = value.toInt() >= 0;
+			if (ok)
+				manager->setPlayerPoolSize(value.toInt());
+		}
+		// Engine instances started ahead of the games
+		else if (name == "-warmup")
+		{
+			ok = value.toInt() >= 0;
+			if (ok)
+				manager->setWarmupCount(value.toInt());
+		}
+		// Shared deadline for terminating the engines at the end
+		else if (name == "-quittimeout")
+		{
+			ok = value.toInt() >= 0;
+			if (ok)
+				manager->setQuitTimeout(value.toInt());
+		}
+		// Share of the game slots among matches run together
+		else if (name == "-priority")
+		{
+			ok = value.toInt() > 0;
+			if (ok)
+				manager->setQueueWeight(tournament, value.toInt());
+		}
+		// Timing overhead limit for adaptive concurrency
+		else if (name == "-maxoverhead")
+		{
+			ok = value.toInt() >= 0;
+			if (ok)
+				manager->setMaxTimingOverhead(value.toInt());
+		}
+		// Dedicated physical cores per engine
+		else if (name == "-affinity")
+		{
+			ok = value.toInt() >= 0;
+			if (ok)
+			{
+				CpuPlacement placement;
+				placement.setCoresPerPlayer(value.toInt());
+				manager->setCpuPlacement(placement);
+			}
+		}
+		// Remote worker nodes that run the engines
+		else if (name == "-workers")
+		{
+			QStringList hosts;
+			foreach (const QString& arg, value.toStringList())
+				hosts += arg.split(',', QString::SkipEmptyParts);
+			ok = !hosts.isEmpty();
+			if (ok)
+				EngineBuilder::setRemoteHosts(hosts);
+		}
+		// The secret shared with the worker nodes
+		else if (name == "-workersecret")
+		{
+			ok = !value.toString().isEmpty();
+			if (ok)
+				EngineBuilder::setRemoteSecret(value.toString());
+		}
+		// Warn about engines that use too many resources
+		else if (name == "-resourcelimit")
+		{
+			QMap<QString, QString> params =
+				option.toMap("threads=0|memory=0");
+			bool threadsOk = false;
+			bool memoryOk = false;
+			int threads = params["threads"].toInt(&threadsOk);
+			int memory = params["memory"].toInt(&memoryOk);
+			ok = threadsOk && memoryOk && threads >= 0 && memory >= 0;
+			if (ok)
+				match->setResourceLimits(threads, memory);
+		}
+		// Fit the engines' hash tables into memory
+		else if (name == "-hashbudget")
+		{
+			QMap<QString, QString> params =
+				option.toMap("size=0|policy=concurrency");
+			int size = params["size"].toInt(&ok);
+			QString policy = params["policy"];
+			ok = ok && size >= 0
+			  && (policy == "concurrency" || policy == "hash");
+			if (ok)
+			{
+				delete memoryBudget;
+				memoryBudget = new MemoryBudget(size, policy == "hash" ?
+					MemoryBudget::ScaleHash : MemoryBudget::CapConcurrency);
+			}
+		}
+		// Log the engines' I/O for replaying it later
+		else if (name == "-recordio")
+		{
+			ok = QDir().mkpath(value.toString());
+			if (ok)
+				EngineBuilder::setRecordDirectory(value.toString());
+		}
+		// Replay recorded engine I/O instead of running the engines
+		else if (name == "-replayio")
+		{
+			ok = QDir(value.toString()).exists();
+			if (ok)
+				EngineBuilder::setReplayDirectory(value.toString());
+		}
+		// Drain the engines' error output into a buffer and a log
+		else if (name == "-stderr")
+		{
+			QStringList list = value.toStringList();
+			int size = list.at(0).toInt(&ok);
+			ok = ok && size >= 0;
+			if (ok && list.size() == 2)
+				ok = QDir().mkpath(list.at(1));
+			if (ok)
+				EngineBuilder::setStandardErrorCapture(size, list.value(1));
+		}
+		// Run each engine in a cgroup with a CPU quota and memory limit
+		else if (name == "-cgroup")
+		{
+			QMap<QString, QString> params =
+				option.toMap("dir|cpu=auto|memory=auto");
+			cgroupDir = params["dir"];
+			ok = !cgroupDir.isEmpty() && QDir(cgroupDir).exists();
+			if (ok && params["cpu"] != "auto")
+			{
+				cgroupCpu = params["cpu"].toInt(&ok);
+				ok = ok && cgroupCpu >= 0;
+			}
+			if (ok && params["memory"] != "auto")
+			{
+				cgroupMemory = params["memory"].toInt(&ok);
+				ok = ok && cgroupMemory >= 0;
+			}
+		}
 		// Threshold for draw adjudication
 		else if (name == "-draw")
 		{
@@ -331,16 +736,107 @@ static EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 			if (ok)
 				adjudicator.setResignThreshold(moveCount, -score);
 		}
+		// Threshold for win adjudication
+		else if (name == "-win")
+		{
+			QMap<QString, QString> params =
+				option.toMap("movecount|score|hysteresis=0");
+			bool countOk = false;
+			bool scoreOk = false;
+			bool hysteresisOk = false;
+			int moveCount = params["movecount"].toInt(&countOk);
+			int score = params["score"].toInt(&scoreOk);
+			int hysteresis = params["hysteresis"].toInt(&hysteresisOk);
+
+			ok = (countOk && scoreOk && hysteresisOk
+			      && moveCount > 0 && score > 0
+			      && hysteresis >= 0 && hysteresis < score);
+			if (ok)
+				adjudicator.setWinThreshold(moveCount, score, hysteresis);
+		}
+		// Mate score adjudication
+		else if (name == "-mate")
+			adjudicator.setMateAdjudication(true);
+		// Maximum game length
+		else if (name == "-maxmoves")
+		{
+			ok = value.toInt() > 0;
+			if (ok)
+				adjudicator.setMaximumLength(value.toInt());
+		}
 		// Gaviota tablebase adjudication
 		else if (name == "-gtb")
+		{
+			// The first argument is the path, the rest are
+			// optional cache and probe settings
+			QStringList list = value.toStringList();
+			QStringList paths = QStringList() << list.takeFirst();
+			MatchParser::Option settings(option);
+			settings.value = list;
+			QMap<QString, QString> params =
+				settings.toMap("cache=32|wdl=96|probe=hard");
+
+			bool cacheOk = false;
+			bool wdlOk = false;
+			int cacheSize = params["cache"].toInt(&cacheOk);
+			int wdlFraction = params["wdl"].toInt(&wdlOk);
+			QString probe = params["probe"];
+			ok = cacheOk && cacheSize > 0
+			  && wdlOk && wdlFraction >= 0 && wdlFraction <= 100
+			  && (probe == "hard" || probe == "soft");
+			if (ok)
+			{
+				adjudicator.setTablebaseAdjudication(true);
+				GaviotaTablebase::setProbeMode(probe == "soft"
+					? GaviotaTablebase::SoftProbe
+					: GaviotaTablebase::HardProbe);
+
+				// Games of other jobs may be probing the
+				// loaded tables, so they're only reloaded if
+				// the settings change
+				QString settings = value.toStringList().join(" ");
+				if (settings != gaviotaSettings)
+				{
+					StartupTimer timer("gaviota tablebases");
+					ok = GaviotaTablebase::initialize(paths, cacheSize,
+									  wdlFraction) &&
+					     GaviotaTablebase::tbAvailable(3);
+					if (!ok)
+						qWarning("Could not load Gaviota tablebases");
+					gaviotaSettings = ok ? settings : QString();
+				}
+			}
+		}
+		// Time control scaling relative to a reference host
+		else if (name == "-calibrate")
+		{
+			referenceNps = value.toInt();
+			ok = referenceNps > 0;
+		}
+		// Syzygy tablebase adjudication
+		else if (name == "-syzygy")
 		{
 			adjudicator.setTablebaseAdjudication(true);
-			QStringList paths = QStringList() << value.toString();
+			QStringList paths = value.toString().split(';', QString::SkipEmptyParts);
 
-			ok = GaviotaTablebase::initialize(paths) &&
-			     GaviotaTablebase::tbAvailable(3);
-			if (!ok)
-				qWarning("Could not load Gaviota tablebases");
+			if (paths != syzygyPaths)
+			{
+				StartupTimer timer("syzygy tablebases");
+				ok = SyzygyTablebase::initialize(paths);
+				if (!ok)
+					qWarning("Could not load Syzygy tablebases");
+				syzygyPaths = ok ? paths : QStringList();
+			}
+		}
+		// Tablebase probe results shared by the processes of the host
+		else if (name == "-tbshare")
+		{
+			QMap<QString, QString> params = option.toMap("name|size=64");
+			int size = params["size"].toInt(&ok);
+			ok = ok && size > 0 && !params["name"].isEmpty();
+			if (ok)
+				ok = Chess::StandardBoard::shareTablebaseCache(params["name"],
+									       size);
 		}
 		// Event name
 		else if (name == "-event")
@@ -361,21 +857,49 @@ static EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 		}
 		// SPRT-based stopping rule
 		else if (name == "-sprt")
+			ok = parseSprt(option, tournament->sprt());
+		// Early stopping of the opponents in a gauntlet
+		else if (name == "-gauntletstop")
 		{
-			QMap<QString, QString> params = option.toMap("elo0|elo1|alpha|beta");
-			bool sprtOk[4];
-			double elo0 = params["elo0"].toDouble(sprtOk);
-			double elo1 = params["elo1"].toDouble(sprtOk + 1);
-			double alpha = params["alpha"].toDouble(sprtOk + 2);
-			double beta = params["beta"].toDouble(sprtOk + 3);
-
-			ok = (sprtOk[0] && sprtOk[1] && sprtOk[2] && sprtOk[3]);
+			GauntletTournament* gauntlet =
+				qobject_cast<GauntletTournament*>(tournament);
+			ok = (gauntlet != 0 && value.toDouble() > 0.0);
 			if (ok)
-				tournament->sprt()->initialize(elo0, elo1, alpha, beta);
+				gauntlet->setMaxEloError(value.toDouble());
 		}
 		// Interval for rating list updates
 		else if (name == "-ratinginterval")
 			match->setRatingInterval(value.toInt());
+		// Head-to-head results with the rating list
+		else if (name == "-crosstable")
+			match->setCrosstableEnabled(true);
+		// Game manager statistics
+		else if (name == "-stats")
+		{
+			ok = value.toInt() >= 0;
+			if (ok)
+				match->setStatsInterval(value.toInt());
+		}
+		else if (name == "-statstrace")
+			ok = manager->setTraceFile(value.toString());
+		// Timeline of the whole match in Chrome's trace format
+		else if (name == "-timeline")
+			TraceLog::start(value.toString());
+		// Engine I/O written to files by a background thread
+		else if (name == "-enginelog")
+			ok = EngineLog::start(value.toString());
+		// Live results in JSON Lines format
+		else if (name == "-jsonout")
+			ok = match->setResultStream(value.toString());
+		// SQLite database of the finished games
+		else if (name == "-resultdb")
+			ok = match->setResultDatabase(value.toString());
+		// Prometheus metrics endpoint
+		else if (name == "-metrics")
+			ok = match->setMetricsServer(value.toString());
+		// WebSocket broadcast of the games
+		else if (name == "-broadcast")
+			ok = match->setBroadcastServer(value.toString());
 		// Debugging mode. Prints all engine input and output.
 		else if (name == "-debug")
 			match->setDebugMode(true);
@@ -383,7 +907,7 @@ static EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 		else if (name == "-openings")
 		{
 			QMap<QString, QString> params =
-				option.toMap("file|format=pgn|order=sequential|plies=1024|start=1");
+				option.toMap("file|format=pgn|order=sequential|plies=1024|start=1|setup=moves|index=auto");
 			ok = !params.isEmpty();
 
 			OpeningSuite::Format format = OpeningSuite::EpdFormat;
@@ -410,6 +934,16 @@ static EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 				ok = false;
 			}
 
+			bool collapse = false;
+			if (params["setup"] == "fen")
+				collapse = true;
+			else if (params["setup"] != "moves" && ok)
+			{
+				qWarning("Invalid opening setup: \"%s\"",
+					 qPrintable(params["setup"]));
+				ok = false;
+			}
+
 			int plies = params["plies"].toInt();
 			int start = params["start"].toInt();
 
@@ -417,11 +951,14 @@ static EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 			if (ok)
 			{
 				tournament->setOpeningDepth(plies);
+				tournament->setOpeningCollapsed(collapse);
 
 				OpeningSuite* suite = new OpeningSuite(params["file"],
 								       format,
 								       order,
 								       start - 1);
+				if (params["index"] != "auto")
+					suite->setIndexDirectory(params["index"]);
 				if (order == OpeningSuite::RandomOrder)
 					qDebug("Indexing opening suite...");
 				ok = suite->initialize();
@@ -429,6 +966,24 @@ static EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 					tournament->setOpeningSuite(suite);
 			}
 		}
+		// Results per opening of the opening suite
+		else if (name == "-openingstats")
+			openingStatsFile = value.toString();
+		// Opening suite without the openings that decide the game
+		else if (name == "-pruneopenings")
+		{
+			QMap<QString, QString> params =
+				option.toMap("file|mingames=10|maxshare=90");
+			bool minOk = false;
+			bool shareOk = false;
+			prunedSuiteFile = params["file"];
+			pruneMinGames = params["mingames"].toInt(&minOk);
+			pruneMaxShare = params["maxshare"].toInt(&shareOk);
+
+			ok = (minOk && shareOk && !prunedSuiteFile.isEmpty()
+			      && pruneMinGames > 0
+			      && pruneMaxShare > 0 && pruneMaxShare <= 100);
+		}
 		// PGN file where the games should be saved
 		else if (name == "-pgnout")
 		{
@@ -444,12 +999,64 @@ static EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 			if (ok)
 				tournament->setPgnOutput(list.at(0), mode);
 		}
+		// Rotation of the PGN output file
+		else if (name == "-pgnrotate")
+		{
+			QMap<QString, QString> params = option.toMap("games=0|size=0");
+			bool gamesOk = false;
+			bool sizeOk = false;
+			int maxGames = params["games"].toInt(&gamesOk);
+			int maxSize = params["size"].toInt(&sizeOk);
+
+			ok = (gamesOk && sizeOk && maxGames >= 0 && maxSize >= 0
+			      && (maxGames > 0 || maxSize > 0));
+			if (ok)
+				tournament->setPgnRotation(maxGames,
+							   qint64(maxSize) * 1024 * 1024);
+		}
+		// Binary archive file where the games should be saved
+		else if (name == "-archiveout")
+			tournament->setArchiveOutput(value.toString());
+		// Checkpoint file for resuming an interrupted tournament
+		else if (name == "-checkpoint")
+		{
+			QMap<QString, QString> params = option.toMap("file|interval=60");
+			int interval = params["interval"].toInt(&ok);
+			checkpointFile = params["file"];
+
+			ok = (ok && interval >= 0 && !checkpointFile.isEmpty());
+			if (ok)
+				tournament->setCheckpoint(checkpointFile, interval * 1000);
+		}
+		// Continue from the checkpoint file
+		else if (name == "-resume")
+			resume = true;
 		// Play every opening twice, just switch the players' sides
 		else if (name == "-repeat")
+		{
 			tournament->setOpeningRepetition(true);
+			repeat = true;
+		}
+		// Start both games of an opening pair together
+		else if (name == "-pairedstart")
+			tournament->setPairedStart(true);
 		// Recover crashed/stalled engines
 		else if (name == "-recover")
 			tournament->setRecoveryMode(true);
+		// Kill the running games when the match stops early
+		else if (name == "-abortonstop")
+			tournament->setAbortOnStop(true);
+		// Restart limit for crashed engines
+		else if (name == "-restarts")
+		{
+			QMap<QString, QString> params = option.toMap("count|window");
+			bool countOk = false;
+			bool windowOk = false;
+			maxRestarts = params["count"].toInt(&countOk);
+			restartWindow = params["window"].toInt(&windowOk);
+
+			ok = (countOk && windowOk && maxRestarts > 0 && restartWindow > 0);
+		}
 		// Site/location name
 		else if (name == "-site")
 			tournament->setSite(value.toString());
@@ -463,6 +1070,22 @@ static EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 			if (ok)
 				tournament->setStartDelay(value.toInt());
 		}
+		// Play only one part of the tournament
+		else if (name == "-shard")
+		{
+			const QStringList list(value.toString().split('/'));
+			bool indexOk = false;
+			bool countOk = false;
+			int index = list.value(0).toInt(&indexOk);
+			int count = list.value(1).toInt(&countOk);
+			ok = list.size() == 2 && indexOk && countOk
+			  && count > 0 && index >= 1 && index <= count;
+			if (ok)
+				tournament->setShard(index - 1, count);
+		}
+		// Mergeable summary of the results
+		else if (name == "-summary")
+			match->setSummaryFile(value.toString());
 		else
 			qFatal("Unknown argument: \"%s\"", qPrintable(name));
 
@@ -485,6 +1108,7 @@ static EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 
 			delete match;
 			delete tournament;
+			delete memoryBudget;
 			return 0;
 		}
 	}
@@ -502,6 +1126,87 @@ static EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 		}
 	}
 
+	if (ok && referenceNps > 0)
+	{
+		double factor = calibrationFactor(referenceNps);
+		ok = factor > 0.0;
+		if (ok)
+		{
+			QList<EngineData>::iterator it;
+			for (it = engines.begin(); it != engines.end(); ++it)
+				it->tc.scale(factor);
+		}
+		else
+			qWarning("Calibration failed");
+	}
+
+	if (ok)
+	{
+		QList<EngineConfiguration*> configs;
+		QList<EngineData>::iterator it;
+		for (it = engines.begin(); it != engines.end(); ++it)
+			configs << &it->config;
+
+		int concurrency = manager->concurrency();
+		qint64 required = MemoryBudget::requiredMemory(configs, concurrency);
+		if (memoryBudget != 0)
+		{
+			int planned = memoryBudget->plan(configs, concurrency);
+			if (planned < concurrency)
+			{
+				qWarning("Lowering the concurrency from %d to %d to "
+					 "fit the hash tables in %d MB",
+					 concurrency, planned, memoryBudget->size());
+				manager->setConcurrency(planned);
+			}
+			else if (MemoryBudget::requiredMemory(configs, concurrency) < required)
+				qWarning("Scaling down the hash tables to fit them "
+					 "in %d MB", memoryBudget->size());
+		}
+
+		// Warn before the engines start swapping
+		qint64 available = MemoryBudget::availableMemory();
+		required = MemoryBudget::requiredMemory(configs, manager->concurrency());
+		if (available > 0 && required > available)
+			qWarning("The hash tables may need %lld MB of memory, "
+				 "but only %lld MB is available",
+				 required, available);
+	}
+	delete memoryBudget;
+
+	if (ok && !cgroupDir.isEmpty())
+	{
+		// Without pondering only one engine of a game searches at a
+		// time, so each engine gets the whole game's share of the
+		// CPUs. The memory of both engines is resident all the time.
+		int concurrency = manager->concurrency();
+		if (cgroupCpu < 0)
+			cgroupCpu = qMax(100 * QThread::idealThreadCount() / concurrency, 1);
+		if (cgroupMemory < 0)
+			cgroupMemory = int(MemoryBudget::availableMemory() / (2 * concurrency));
+		EngineBuilder::setCgroup(cgroupDir, cgroupCpu, cgroupMemory);
+	}
+
+	if (ok)
+	{
+		// Warm up the page cache before all the engines load their
+		// networks and other data files at the same time
+		QStringList dataFiles;
+		foreach (const EngineData& engine, engines)
+		{
+			foreach (const QString& file, engine.config.resolvedDataFiles())
+			{
+				if (!dataFiles.contains(file))
+					dataFiles << file;
+			}
+		}
+		if (!dataFiles.isEmpty())
+		{
+			StartupTimer timer("engine data files");
+			FilePrefetcher::prefetch(dataFiles);
+		}
+	}
+
 	foreach (const EngineData& engine, engines)
 	{
 		if (!engine.tc.isValid())
@@ -511,6 +1216,30 @@ static EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 			break;
 		}
 
+		QString key;
+		PlayerBuilder* builder = 0;
+		if (builderCache != 0)
+		{
+			key = builderKey(engine, maxRestarts, restartWindow);
+			builder = cachedBuilder(key, tournament);
+		}
+
+		if (engine.config.protocol() == "random")
+		{
+			if (builder == 0)
+			{
+				builder = new RandomBuilder(engine.config.name(),
+							    engine.delay);
+				if (builderCache != 0)
+					builderCache->insert(key, builder);
+			}
+			tournament->addPlayer(builder,
+					      engine.tc,
+					      match->addOpeningBook(engine.book, engine.bookMode),
+					      engine.bookDepth);
+			continue;
+		}
+
 		if (engine.config.command().isEmpty())
 		{
 			ok = false;
@@ -525,10 +1254,22 @@ static EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 			break;
 		}
 
-		tournament->addPlayer(new EngineBuilder(engine.config),
+		if (builder == 0)
+		{
+			if (engine.config.protocol() == "plugin")
+				builder = new PluginBuilder(engine.config);
+			else
+				builder = new EngineBuilder(engine.config);
+			builder->setRestartLimit(maxRestarts, restartWindow * 1000);
+			if (builderCache != 0)
+				builderCache->insert(key, builder);
+		}
+		tournament->addPlayer(builder,
 				      engine.tc,
-				      match->addOpeningBook(engine.book),
+				      match->addOpeningBook(engine.book, engine.bookMode),
 				      engine.bookDepth);
+		tournament->setPlayerHashSize(tournament->playerCount() - 1,
+					      MemoryBudget::hashSize(engine.config));
 	}
 
 	if (engines.size() < 2)
@@ -537,6 +1278,58 @@ static EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 		ok = false;
 	}
 
+	if (tournament->sprt()->model() == Sprt::Pentanomial && !repeat)
+	{
+		qWarning("The pentanomial SPRT needs game pairs, use \"-repeat\"");
+		ok = false;
+	}
+
+	if (ok && resume)
+	{
+		if (checkpointFile.isEmpty())
+		{
+			qWarning("Option \"-resume\" needs a checkpoint file");
+			ok = false;
+		}
+		else if (!QFile::exists(checkpointFile))
+			qWarning("Checkpoint file %s not found, starting a new tournament",
+				 qPrintable(checkpointFile));
+		else if (!tournament->loadCheckpoint(checkpointFile))
+		{
+			qWarning("%s", qPrintable(tournament->errorString()));
+			ok = false;
+		}
+	}
+
+	if (ok && !prunedSuiteFile.isEmpty() && openingStatsFile.isEmpty())
+	{
+		qWarning("Option \"-pruneopenings\" needs \"-openingstats\"");
+		ok = false;
+	}
+	if (ok && !openingStatsFile.isEmpty())
+	{
+		const OpeningSuite* suite = tournament->openingSuite();
+		if (suite == 0)
+		{
+			qWarning("Option \"-openingstats\" needs an opening suite");
+			ok = false;
+		}
+		else if (QFile::exists(openingStatsFile)
+		     &&  !tournament->openingStats()->load(openingStatsFile,
+							    suite->fileName()))
+		{
+			qWarning("Can't use the opening statistics in %s, "
+				 "starting new statistics",
+				 qPrintable(openingStatsFile));
+			tournament->openingStats()->clear();
+		}
+		if (ok)
+			match->setOpeningStats(openingStatsFile,
+					       prunedSuiteFile,
+					       pruneMinGames,
+					       pruneMaxShare);
+	}
+
 	if (!ok)
 	{
 		delete match;
@@ -549,15 +1342,1233 @@ static EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 	return match;
 }
 
-int main(int argc, char* argv[])
+static int runPerft(const QStringList& args)
 {
-	setvbuf(stdout, NULL, _IONBF, 0);
-	signal(SIGINT, sigintHandler);
-
-	CuteChessCoreApplication app(argc, argv);
+	MatchParser parser(args);
+	parser.addOption("-perft", QVariant::StringList, 1, -1);
+	parser.addOption("-variant", QVariant::String, 1, 1);
+	parser.addOption("-divide", QVariant::Bool, 0, 0);
+	parser.addOption("-threads", QVariant::Int, 1, 1);
+	parser.addOption("-hash", QVariant::Int, 1, 1);
+	if (!parser.parse())
+		return 1;
 
-	QStringList arguments = CuteChessCoreApplication::arguments();
-	arguments.takeFirst(); // application name
+	// The last token is the depth, the others form the FEN string
+	QStringList list = parser.takeOption("-perft").toStringList();
+	bool ok = false;
+	int depth = list.takeLast().toInt(&ok);
+	if (!ok || depth <= 0)
+	{
+		qWarning("Invalid perft depth");
+		return 1;
+	}
+
+	QString variant = parser.takeOption("-variant").toString();
+	if (variant.isEmpty())
+		variant = "standard";
+	Chess::Board* board = Chess::BoardFactory::create(variant);
+	if (board == 0)
+	{
+		qWarning("Unknown chess variant: %s", qPrintable(variant));
+		return 1;
+	}
+
+	QString fen = list.join(" ");
+	if (fen.isEmpty() || fen == "startpos")
+		fen = board->defaultFenString();
+	if (!board->setFenString(fen))
+	{
+		qWarning("Invalid FEN string: %s", qPrintable(fen));
+		delete board;
+		return 1;
+	}
+
+	Perft perft(board, depth);
+	perft.setDivide(parser.takeOption("-divide").toBool());
+
+	QVariant threads = parser.takeOption("-threads");
+	if (threads.isValid())
+	{
+		ok = threads.toInt() > 0;
+		if (ok)
+			perft.setThreadCount(threads.toInt());
+		else
+			qWarning("Invalid thread count");
+	}
+	QVariant hash = parser.takeOption("-hash");
+	if (ok && hash.isValid())
+	{
+		ok = hash.toInt() >= 0;
+		if (ok)
+			perft.setHashSize(hash.toInt());
+		else
+			qWarning("Invalid hash size");
+	}
+
+	if (ok)
+	{
+		QTextStream out(stdout);
+		perft.run(out);
+	}
+
+	delete board;
+	return ok ? 0 : 1;
+}
+
+static int runValidate(const QStringList& args)
+{
+	MatchParser parser(args);
+	parser.addOption("-validate", QVariant::String, 1, 1);
+	parser.addOption("-variant", QVariant::String, 1, 1);
+	parser.addOption("-threads", QVariant::Int, 1, 1);
+	if (!parser.parse())
+		return 1;
+
+	PgnValidator validator(parser.takeOption("-validate").toString());
+
+	QVariant variant = parser.takeOption("-variant");
+	if (variant.isValid())
+	{
+		if (!Chess::BoardFactory::variants().contains(variant.toString()))
+		{
+			qWarning("Unknown chess variant: %s",
+				 qPrintable(variant.toString()));
+			return 1;
+		}
+		validator.setVariant(variant.toString());
+	}
+
+	QVariant threads = parser.takeOption("-threads");
+	if (threads.isValid())
+	{
+		if (threads.toInt() <= 0)
+		{
+			qWarning("Invalid thread count");
+			return 1;
+		}
+		validator.setThreadCount(threads.toInt());
+	}
+
+	QTextStream out(stdout);
+	return validator.run(out) ? 0 : 1;
+}
+
+static int runPgnFilter(const QStringList& args)
+{
+	MatchParser parser(args);
+	parser.addOption("-pgnfilter", QVariant::StringList, 2, 2);
+	parser.addOption("-event", QVariant::String, 1, 1);
+	parser.addOption("-site", QVariant::String, 1, 1);
+	parser.addOption("-player", QVariant::String, 1, 1);
+	parser.addOption("-opponent", QVariant::String, 1, 1);
+	parser.addOption("-side", QVariant::String, 1, 1);
+	parser.addOption("-result", QVariant::String, 1, 1);
+	parser.addOption("-variant", QVariant::String, 1, 1);
+	parser.addOption("-minplies", QVariant::Int, 1, 1);
+	parser.addOption("-maxplies", QVariant::Int, 1, 1);
+	parser.addOption("-nocomments", QVariant::Bool, 0, 0);
+	parser.addOption("-min", QVariant::Bool, 0, 0);
+	parser.addOption("-threads", QVariant::Int, 1, 1);
+	if (!parser.parse())
+		return 1;
+
+	QStringList files = parser.takeOption("-pgnfilter").toStringList();
+	PgnFilter pgnFilter(files.at(0), files.at(1));
+
+	PgnGameFilter filter;
+	filter.setEvent(parser.takeOption("-event").toString());
+	filter.setSite(parser.takeOption("-site").toString());
+	filter.setOpponent(parser.takeOption("-opponent").toString());
+
+	Chess::Side side;
+	QVariant sideArg = parser.takeOption("-side");
+	if (sideArg.isValid())
+	{
+		if (sideArg.toString() == "white")
+			side = Chess::Side::White;
+		else if (sideArg.toString() == "black")
+			side = Chess::Side::Black;
+		else
+		{
+			qWarning("Invalid side: %s", qPrintable(sideArg.toString()));
+			return 1;
+		}
+	}
+	filter.setPlayer(parser.takeOption("-player").toString(), side);
+
+	QVariant result = parser.takeOption("-result");
+	if (result.isValid())
+	{
+		QString str = result.toString();
+		if (str == "white")
+			filter.setResult(PgnGameFilter::WhiteWins);
+		else if (str == "black")
+			filter.setResult(PgnGameFilter::BlackWins);
+		else if (str == "draw")
+			filter.setResult(PgnGameFilter::Draw);
+		else if (str == "decisive")
+			filter.setResult(PgnGameFilter::EitherPlayerWins);
+		else if (str == "unfinished")
+			filter.setResult(PgnGameFilter::Unfinished);
+		else if (str == "win")
+			filter.setResult(PgnGameFilter::FirstPlayerWins);
+		else if (str == "loss")
+			filter.setResult(PgnGameFilter::FirstPlayerLoses);
+		else
+		{
+			qWarning("Invalid result: %s", qPrintable(str));
+			return 1;
+		}
+	}
+	pgnFilter.setFilter(filter);
+
+	QVariant variant = parser.takeOption("-variant");
+	if (variant.isValid())
+	{
+		if (!Chess::BoardFactory::variants().contains(variant.toString()))
+		{
+			qWarning("Unknown chess variant: %s",
+				 qPrintable(variant.toString()));
+			return 1;
+		}
+		pgnFilter.setVariant(variant.toString());
+	}
+
+	int minPlies = parser.takeOption("-minplies").toInt();
+	int maxPlies = parser.takeOption("-maxplies").toInt();
+	if (minPlies < 0 || maxPlies < 0
+	||  (maxPlies > 0 && minPlies > maxPlies))
+	{
+		qWarning("Invalid ply range");
+		return 1;
+	}
+	pgnFilter.setPlyRange(minPlies, maxPlies);
+
+	pgnFilter.setCommentsStripped(parser.takeOption("-nocomments").toBool());
+	if (parser.takeOption("-min").toBool())
+		pgnFilter.setPgnMode(PgnGame::Minimal);
+
+	QVariant threads = parser.takeOption("-threads");
+	if (threads.isValid())
+	{
+		if (threads.toInt() <= 0)
+		{
+			qWarning("Invalid thread count");
+			return 1;
+		}
+		pgnFilter.setThreadCount(threads.toInt());
+	}
+
+	QTextStream out(stdout);
+	return pgnFilter.run(out) ? 0 : 1;
+}
+
+static int runMakeBook(const QStringList& args)
+{
+	MatchParser parser(args);
+	parser.addOption("-makebook", QVariant::StringList, 2, 2);
+	parser.addOption("-depth", QVariant::Int, 1, 1);
+	parser.addOption("-threads", QVariant::Int, 1, 1);
+	parser.addOption("-weight", QVariant::String, 1, 1);
+	parser.addOption("-mingames", QVariant::Int, 1, 1);
+	if (!parser.parse())
+		return 1;
+
+	QStringList files = parser.takeOption("-makebook").toStringList();
+	BookMaker maker(files.at(0));
+
+	QVariant depth = parser.takeOption("-depth");
+	if (depth.isValid())
+	{
+		if (depth.toInt() <= 0)
+		{
+			qWarning("Invalid book depth");
+			return 1;
+		}
+		maker.setDepth(depth.toInt());
+	}
+
+	QVariant threads = parser.takeOption("-threads");
+	if (threads.isValid())
+	{
+		if (threads.toInt() <= 0)
+		{
+			qWarning("Invalid thread count");
+			return 1;
+		}
+		maker.setThreadCount(threads.toInt());
+	}
+
+	QVariant weight = parser.takeOption("-weight");
+	if (weight.isValid())
+	{
+		QString policy = weight.toString();
+		if (policy == "games")
+			maker.setWeightPolicy(BookMaker::GameCount);
+		else if (policy == "score")
+			maker.setWeightPolicy(BookMaker::Score);
+		else if (policy == "wins")
+			maker.setWeightPolicy(BookMaker::WinCount);
+		else
+		{
+			qWarning("Invalid weighting policy: %s", qPrintable(policy));
+			return 1;
+		}
+	}
+
+	QVariant minGames = parser.takeOption("-mingames");
+	if (minGames.isValid())
+	{
+		if (minGames.toInt() <= 0)
+		{
+			qWarning("Invalid minimum game count");
+			return 1;
+		}
+		maker.setMinGames(minGames.toInt());
+	}
+
+	QTextStream out(stdout);
+	return maker.run(files.at(1), out) ? 0 : 1;
+}
+
+static int runDedup(const QStringList& args)
+{
+	MatchParser parser(args);
+	parser.addOption("-dedup", QVariant::StringList, 2, 2);
+	parser.addOption("-format", QVariant::String, 1, 1);
+	parser.addOption("-plies", QVariant::Int, 1, 1);
+	parser.addOption("-variant", QVariant::String, 1, 1);
+	parser.addOption("-threads", QVariant::Int, 1, 1);
+	if (!parser.parse())
+		return 1;
+
+	QStringList files = parser.takeOption("-dedup").toStringList();
+
+	OpeningSuite::Format format = OpeningSuite::PgnFormat;
+	QVariant formatOption = parser.takeOption("-format");
+	if (formatOption.isValid())
+	{
+		if (formatOption.toString() == "epd")
+			format = OpeningSuite::EpdFormat;
+		else if (formatOption.toString() != "pgn")
+		{
+			qWarning("Invalid opening suite format: %s",
+				 qPrintable(formatOption.toString()));
+			return 1;
+		}
+	}
+	SuiteDeduplicator deduplicator(files.at(0), format);
+
+	QVariant plies = parser.takeOption("-plies");
+	if (plies.isValid())
+	{
+		if (plies.toInt() <= 0)
+		{
+			qWarning("Invalid opening depth");
+			return 1;
+		}
+		deduplicator.setDepth(plies.toInt());
+	}
+
+	QVariant variant = parser.takeOption("-variant");
+	if (variant.isValid())
+	{
+		if (!Chess::BoardFactory::variants().contains(variant.toString()))
+		{
+			qWarning("Unknown chess variant: %s",
+				 qPrintable(variant.toString()));
+			return 1;
+		}
+		deduplicator.setVariant(variant.toString());
+	}
+
+	QVariant threads = parser.takeOption("-threads");
+	if (threads.isValid())
+	{
+		if (threads.toInt() <= 0)
+		{
+			qWarning("Invalid thread count");
+			return 1;
+		}
+		deduplicator.setThreadCount(threads.toInt());
+	}
+
+	QTextStream out(stdout);
+	return deduplicator.run(files.at(1), out) ? 0 : 1;
+}
+
+static int runEndgames(const QStringList& args)
+{
+	MatchParser parser(args);
+	parser.addOption("-endgames", QVariant::StringList, 2, 2);
+	parser.addOption("-count", QVariant::Int, 1, 1);
+	parser.addOption("-draws", QVariant::Bool, 0, 0);
+	parser.addOption("-mindtm", QVariant::Int, 1, 1);
+	parser.addOption("-gtb", QVariant::String, 1, 1);
+	parser.addOption("-syzygy", QVariant::String, 1, 1);
+	parser.addOption("-threads", QVariant::Int, 1, 1);
+	parser.addOption("-srand", QVariant::UInt, 1, 1);
+	if (!parser.parse())
+		return 1;
+
+	QStringList list = parser.takeOption("-endgames").toStringList();
+	EndgameGenerator generator(list.at(0));
+	if (!generator.isValid())
+	{
+		qWarning("Invalid material signature: %s", qPrintable(list.at(0)));
+		return 1;
+	}
+
+	int count = 1000;
+	QVariant countOption = parser.takeOption("-count");
+	if (countOption.isValid())
+	{
+		count = countOption.toInt();
+		if (count <= 0)
+		{
+			qWarning("Invalid position count");
+			return 1;
+		}
+	}
+
+	generator.setDrawsIncluded(parser.takeOption("-draws").toBool());
+
+	QVariant minDtm = parser.takeOption("-mindtm");
+	if (minDtm.isValid())
+	{
+		if (minDtm.toInt() < 0)
+		{
+			qWarning("Invalid distance to mate");
+			return 1;
+		}
+		generator.setMinimumDtm(minDtm.toInt());
+	}
+
+	bool tablebases = false;
+	QVariant gtb = parser.takeOption("-gtb");
+	if (gtb.isValid())
+	{
+		QStringList paths = QStringList() << gtb.toString();
+		if (!GaviotaTablebase::initialize(paths)
+		||  !GaviotaTablebase::tbAvailable(3))
+		{
+			qWarning("Could not load Gaviota tablebases");
+			return 1;
+		}
+		tablebases = true;
+	}
+	QVariant syzygy = parser.takeOption("-syzygy");
+	if (syzygy.isValid())
+	{
+		QStringList paths = syzygy.toString().split(';', QString::SkipEmptyParts);
+		if (!SyzygyTablebase::initialize(paths))
+		{
+			qWarning("Could not load Syzygy tablebases");
+			return 1;
+		}
+		tablebases = true;
+	}
+	if (!tablebases)
+	{
+		qWarning("Option \"-endgames\" needs \"-gtb\" or \"-syzygy\"");
+		return 1;
+	}
+
+	QVariant threads = parser.takeOption("-threads");
+	if (threads.isValid())
+	{
+		if (threads.toInt() <= 0)
+		{
+			qWarning("Invalid thread count");
+			return 1;
+		}
+		generator.setThreadCount(threads.toInt());
+	}
+
+	QVariant seed = parser.takeOption("-srand");
+	if (seed.isValid())
+		Mersenne::initialize(seed.toUInt());
+
+	QTextStream out(stdout);
+	return generator.run(count, list.at(1), out) ? 0 : 1;
+}
+
+static int runTbScan(const QStringList& args)
+{
+	MatchParser parser(args);
+	parser.addOption("-tbscan", QVariant::String, 1, 1);
+	parser.addOption("-out", QVariant::String, 1, 1);
+	parser.addOption("-gtb", QVariant::String, 1, 1);
+	parser.addOption("-syzygy", QVariant::String, 1, 1);
+	parser.addOption("-threads", QVariant::Int, 1, 1);
+	if (!parser.parse())
+		return 1;
+
+	TbScanner scanner(parser.takeOption("-tbscan").toString());
+
+	bool tablebases = false;
+	QVariant gtb = parser.takeOption("-gtb");
+	if (gtb.isValid())
+	{
+		QStringList paths = QStringList() << gtb.toString();
+		if (!GaviotaTablebase::initialize(paths)
+		||  !GaviotaTablebase::tbAvailable(3))
+		{
+			qWarning("Could not load Gaviota tablebases");
+			return 1;
+		}
+		tablebases = true;
+	}
+	QVariant syzygy = parser.takeOption("-syzygy");
+	if (syzygy.isValid())
+	{
+		QStringList paths = syzygy.toString().split(';', QString::SkipEmptyParts);
+		if (!SyzygyTablebase::initialize(paths))
+		{
+			qWarning("Could not load Syzygy tablebases");
+			return 1;
+		}
+		tablebases = true;
+	}
+	if (!tablebases)
+	{
+		qWarning("Option \"-tbscan\" needs \"-gtb\" or \"-syzygy\"");
+		return 1;
+	}
+
+	QVariant threads = parser.takeOption("-threads");
+	if (threads.isValid())
+	{
+		if (threads.toInt() <= 0)
+		{
+			qWarning("Invalid thread count");
+			return 1;
+		}
+		scanner.setThreadCount(threads.toInt());
+	}
+
+	QTextStream out(stdout);
+	return scanner.run(parser.takeOption("-out").toString(), out) ? 0 : 1;
+}
+
+static int runEpdTest(const QStringList& args)
+{
+	MatchParser parser(args);
+	parser.addOption("-epdtest", QVariant::String, 1, 1);
+	parser.addOption("-engine", QVariant::StringList, 1, -1);
+	parser.addOption("-variant", QVariant::String, 1, 1);
+	parser.addOption("-concurrency", QVariant::Int, 1, 1);
+	parser.addOption("-debug", QVariant::Bool, 0, 0);
+	if (!parser.parse())
+		return 1;
+
+	QString variant("standard");
+	QVariant variantOption = parser.takeOption("-variant");
+	if (variantOption.isValid())
+	{
+		variant = variantOption.toString();
+		if (!Chess::BoardFactory::variants().contains(variant))
+		{
+			qWarning("Unknown chess variant: %s", qPrintable(variant));
+			return 1;
+		}
+	}
+
+	EngineData engine;
+	engine.bookMode = OpeningBook::Ram;
+	engine.bookDepth = 1000;
+	engine.delay = 0;
+	QVariant engineOption = parser.takeOption("-engine");
+	if (!engineOption.isValid()
+	||  !parseEngine(engineOption.toStringList(), engine))
+	{
+		qWarning("Missing or invalid chess engine");
+		return 1;
+	}
+	if (!engine.tc.isValid())
+	{
+		qWarning("Invalid or missing time control");
+		return 1;
+	}
+	if (engine.config.command().isEmpty())
+	{
+		qCritical("missing chess engine command");
+		return 1;
+	}
+	if (engine.config.protocol().isEmpty())
+	{
+		qWarning("Missing chess protocol");
+		return 1;
+	}
+
+	GameManager* manager = CuteChessCoreApplication::instance()->gameManager();
+	QVariant concurrency = parser.takeOption("-concurrency");
+	if (concurrency.isValid())
+	{
+		if (concurrency.toInt() <= 0)
+		{
+			qWarning("Invalid concurrency");
+			return 1;
+		}
+		manager->setConcurrency(concurrency.toInt());
+	}
+
+	EpdTest test(manager);
+	if (!test.load(parser.takeOption("-epdtest").toString(), variant))
+		return 1;
+	test.setEngine(engine.config, engine.tc);
+	test.setDebugMode(parser.takeOption("-debug").toBool());
+
+	QObject::connect(&test, SIGNAL(finished()),
+			 CuteChessCoreApplication::instance(), SLOT(quit()));
+	epdTest = &test;
+	test.start();
+	int ret = CuteChessCoreApplication::exec();
+	epdTest = 0;
+
+	return ret;
+}
+
+static int runBalance(const QStringList& args)
+{
+	MatchParser parser(args);
+	parser.addOption("-balance", QVariant::StringList, 2, 2);
+	parser.addOption("-engine", QVariant::StringList, 1, -1);
+	parser.addOption("-format", QVariant::String, 1, 1);
+	parser.addOption("-window", QVariant::StringList, 2, 2);
+	parser.addOption("-evalcache", QVariant::String, 1, 1);
+	parser.addOption("-concurrency", QVariant::Int, 1, 1);
+	parser.addOption("-debug", QVariant::Bool, 0, 0);
+	if (!parser.parse())
+		return 1;
+
+	OpeningSuite::Format format = OpeningSuite::PgnFormat;
+	QVariant formatOption = parser.takeOption("-format");
+	if (formatOption.isValid())
+	{
+		if (formatOption.toString() == "epd")
+			format = OpeningSuite::EpdFormat;
+		else if (formatOption.toString() != "pgn")
+		{
+			qWarning("Invalid opening suite format: %s",
+				 qPrintable(formatOption.toString()));
+			return 1;
+		}
+	}
+
+	GameManager* manager = CuteChessCoreApplication::instance()->gameManager();
+	OpeningBalancer openingBalancer(manager);
+
+	// The engine isn't needed if every position is in the cache
+	QVariant engineOption = parser.takeOption("-engine");
+	if (engineOption.isValid())
+	{
+		EngineData engine;
+		engine.bookMode = OpeningBook::Ram;
+		engine.bookDepth = 1000;
+		engine.delay = 0;
+		if (!parseEngine(engineOption.toStringList(), engine))
+		{
+			qWarning("Invalid chess engine");
+			return 1;
+		}
+		if (!engine.tc.isValid())
+		{
+			qWarning("Invalid or missing time control");
+			return 1;
+		}
+		if (engine.config.command().isEmpty())
+		{
+			qCritical("missing chess engine command");
+			return 1;
+		}
+		if (engine.config.protocol().isEmpty())
+		{
+			qWarning("Missing chess protocol");
+			return 1;
+		}
+		openingBalancer.setEngine(engine.config, engine.tc);
+	}
+
+	QVariant window = parser.takeOption("-window");
+	if (window.isValid())
+	{
+		QStringList list = window.toStringList();
+		bool minOk = false;
+		bool maxOk = false;
+		int minScore = list.at(0).toInt(&minOk);
+		int maxScore = list.at(1).toInt(&maxOk);
+		if (!minOk || !maxOk || minScore > maxScore)
+		{
+			qWarning("Invalid score window: %s",
+				 qPrintable(list.join(" ")));
+			return 1;
+		}
+		openingBalancer.setWindow(minScore, maxScore);
+	}
+
+	QVariant concurrency = parser.takeOption("-concurrency");
+	if (concurrency.isValid())
+	{
+		if (concurrency.toInt() <= 0)
+		{
+			qWarning("Invalid concurrency");
+			return 1;
+		}
+		manager->setConcurrency(concurrency.toInt());
+	}
+
+	QVariant cacheFile = parser.takeOption("-evalcache");
+	if (cacheFile.isValid()
+	&&  !openingBalancer.setCacheFile(cacheFile.toString()))
+		return 1;
+	openingBalancer.setDebugMode(parser.takeOption("-debug").toBool());
+
+	QStringList files = parser.takeOption("-balance").toStringList();
+	if (!openingBalancer.load(files.at(0), format)
+	||  !openingBalancer.start(files.at(1)))
+		return 1;
+
+	QObject::connect(&openingBalancer, SIGNAL(finished()),
+			 CuteChessCoreApplication::instance(), SLOT(quit()));
+	balancer = &openingBalancer;
+	int ret = CuteChessCoreApplication::exec();
+	balancer = 0;
+
+	return ret;
+}
+
+static int runAnnotate(const QStringList& args)
+{
+	MatchParser parser(args);
+	parser.addOption("-annotate", QVariant::StringList, 2, 2);
+	parser.addOption("-engine", QVariant::StringList, 1, -1);
+	parser.addOption("-concurrency", QVariant::Int, 1, 1);
+	parser.addOption("-checkpoint", QVariant::String, 1, 1);
+	if (!parser.parse())
+		return 1;
+
+	EngineData engine;
+	engine.bookMode = OpeningBook::Ram;
+	engine.bookDepth = 1000;
+	engine.delay = 0;
+	QVariant engineOption = parser.takeOption("-engine");
+	if (!engineOption.isValid()
+	||  !parseEngine(engineOption.toStringList(), engine))
+	{
+		qWarning("Missing or invalid chess engine");
+		return 1;
+	}
+	if (!engine.tc.isValid())
+	{
+		qWarning("Invalid or missing time control");
+		return 1;
+	}
+	if (engine.tc.isInfinite() && engine.tc.nodeLimit() <= 0)
+	{
+		qWarning("The positions need a time or node limit");
+		return 1;
+	}
+	if (engine.config.command().isEmpty())
+	{
+		qCritical("missing chess engine command");
+		return 1;
+	}
+	if (engine.config.protocol().isEmpty())
+	{
+		qWarning("Missing chess protocol");
+		return 1;
+	}
+
+	GameManager* manager = CuteChessCoreApplication::instance()->gameManager();
+	QVariant concurrency = parser.takeOption("-concurrency");
+	if (concurrency.isValid())
+	{
+		if (concurrency.toInt() <= 0)
+		{
+			qWarning("Invalid concurrency");
+			return 1;
+		}
+		manager->setConcurrency(concurrency.toInt());
+	}
+
+	GameAnnotator gameAnnotator(manager);
+	gameAnnotator.setEngine(engine.config, engine.tc);
+	gameAnnotator.setCheckpointFile(parser.takeOption("-checkpoint").toString());
+
+	// The annotator may finish before the event loop is running
+	QObject::connect(&gameAnnotator, SIGNAL(finished()),
+			 manager, SLOT(finish()), Qt::QueuedConnection);
+	QObject::connect(manager, SIGNAL(finished()),
+			 CuteChessCoreApplication::instance(), SLOT(quit()));
+
+	QStringList files = parser.takeOption("-annotate").toStringList();
+	if (!gameAnnotator.start(files.at(0), files.at(1)))
+	{
+		qWarning("%s", qPrintable(gameAnnotator.errorString()));
+		return 1;
+	}
+	if (gameAnnotator.gameCount() > 0)
+		qDebug("Continuing after %d annotated games", gameAnnotator.gameCount());
+
+	annotator = &gameAnnotator;
+	CuteChessCoreApplication::exec();
+	annotator = 0;
+
+	qDebug("Annotated %d games", gameAnnotator.gameCount());
+	return gameAnnotator.errorString().isEmpty() ? 0 : 1;
+}
+
+static int runUnpack(const QStringList& args)
+{
+	MatchParser parser(args);
+	parser.addOption("-unpack", QVariant::StringList, 1, 2);
+	if (!parser.parse())
+		return 1;
+
+	QStringList list = parser.takeOption("-unpack").toStringList();
+	PgnGame::PgnMode mode = PgnGame::Verbose;
+	if (list.size() == 2)
+	{
+		if (list.at(1) != "min")
+		{
+			qWarning("Invalid PGN mode: %s", qPrintable(list.at(1)));
+			return 1;
+		}
+		mode = PgnGame::Minimal;
+	}
+
+	GameArchive archive;
+	if (!archive.open(list.at(0), GameArchive::ReadOnly))
+	{
+		qWarning("%s", qPrintable(archive.errorString()));
+		return 1;
+	}
+
+	QFile out;
+	out.open(stdout, QIODevice::WriteOnly);
+	PgnGame game;
+	QByteArray buffer;
+	buffer.reserve(4096);
+	for (int i = 0; i < archive.gameCount(); i++)
+	{
+		if (!archive.readGame(i, game))
+		{
+			qWarning("%s", qPrintable(archive.errorString()));
+			return 1;
+		}
+		buffer.resize(0);
+		game.write(buffer, mode);
+		out.write(buffer);
+	}
+
+	return 0;
+}
+
+static int runWorker(const QStringList& args)
+{
+	MatchParser parser(args);
+	parser.addOption("-worker", QVariant::Int, 1, 1);
+	parser.addOption("-listen", QVariant::String, 1, 1);
+	parser.addOption("-workersecret", QVariant::String, 1, 1);
+	if (!parser.parse())
+		return 1;
+
+	int port = parser.takeOption("-worker").toInt();
+	if (port <= 0 || port > 65535)
+	{
+		qWarning("Invalid worker port: %d", port);
+		return 1;
+	}
+
+	// Only local connections are accepted unless an address is
+	// given explicitly
+	QHostAddress address(QHostAddress::LocalHost);
+	QVariant value = parser.takeOption("-listen");
+	if (value.isValid() && !address.setAddress(value.toString()))
+	{
+		qWarning("Invalid listening address: %s",
+			 qPrintable(value.toString()));
+		return 1;
+	}
+
+	const QString secret(parser.takeOption("-workersecret").toString());
+	if (secret.isEmpty())
+	{
+		qWarning("Missing worker secret");
+		return 1;
+	}
+
+	EngineServer server;
+	server.setEngines(CuteChessCoreApplication::instance()->engineManager()->engines());
+	server.setSecret(secret);
+	if (!server.listen(port, address))
+		return 1;
+
+	return CuteChessCoreApplication::exec();
+}
+
+static int runTournamentFile(const QStringList& args)
+{
+	MatchParser parser(args);
+	parser.addOption("-tournamentfile", QVariant::String, 1, 1);
+	parser.addOption("-concurrency", QVariant::Int, 1, 1);
+	if (!parser.parse())
+		return 1;
+
+	const QString fileName(parser.takeOption("-tournamentfile").toString());
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		qWarning("Can't open tournament file %s", qPrintable(fileName));
+		return 1;
+	}
+
+	JsonReader reader(&file);
+	reader.readNext();
+	const QVariantMap spec(reader.readValue().toMap());
+	if (reader.readNext() != JsonReader::EndDocument)
+	{
+		qWarning("Invalid tournament file %s, line %lld: %s",
+			 qPrintable(fileName),
+			 reader.lineNumber(),
+			 qPrintable(reader.errorString()));
+		return 1;
+	}
+
+	const QVariantList matches(spec.value("matches").toList());
+	if (matches.isEmpty())
+	{
+		qWarning("No matches in tournament file %s", qPrintable(fileName));
+		return 1;
+	}
+
+	int concurrency = spec.value("concurrency", 1).toInt();
+	QVariant concurrencyOption = parser.takeOption("-concurrency");
+	if (concurrencyOption.isValid())
+		concurrency = concurrencyOption.toInt();
+	if (concurrency <= 0)
+	{
+		qWarning("Invalid concurrency");
+		return 1;
+	}
+
+	GameManager* manager = CuteChessCoreApplication::instance()->gameManager();
+	MatchRunner matchRunner(manager);
+
+	// The common arguments are shared by every match, and the
+	// match's own arguments are appended to them
+	const QStringList common(spec.value("arguments").toStringList());
+	for (int i = 0; i < matches.size(); i++)
+	{
+		StartupTimer timer("match setup");
+		EngineMatch* engineMatch = parseMatch(
+			common + matches.at(i).toStringList(), &matchRunner);
+		if (engineMatch == 0)
+		{
+			qWarning("Invalid match %d in tournament file %s",
+				 i + 1, qPrintable(fileName));
+			return 1;
+		}
+		matchRunner.addMatch(engineMatch);
+	}
+
+	// All matches share the same concurrency budget
+	manager->setConcurrency(concurrency);
+	qDebug("Running %d matches with %d concurrent games",
+	       matchRunner.matchCount(), concurrency);
+
+	QObject::connect(&matchRunner, SIGNAL(finished()),
+			 CuteChessCoreApplication::instance(), SLOT(quit()));
+	runner = &matchRunner;
+	StartupTimer::print();
+	matchRunner.start();
+	int ret = CuteChessCoreApplication::exec();
+	runner = 0;
+
+	if (TraceLog::isEnabled() && !TraceLog::finish())
+		ret = 1;
+	EngineLog::finish();
+	return ret;
+}
+
+static int runMergeShards(const QStringList& args)
+{
+	MatchParser parser(args);
+	parser.addOption("-mergeshards", QVariant::StringList, 1, -1);
+	parser.addOption("-summary", QVariant::String, 1, 1);
+	if (!parser.parse())
+		return 1;
+
+	ShardMerger merger;
+	foreach (const QString& fileName,
+		 parser.takeOption("-mergeshards").toStringList())
+	{
+		if (!merger.addFile(fileName))
+		{
+			qWarning("%s", qPrintable(merger.errorString()));
+			return 1;
+		}
+	}
+
+	QTextStream out(stdout);
+	merger.print(out);
+	out.flush();
+
+	const QString summaryFile(parser.takeOption("-summary").toString());
+	if (!summaryFile.isEmpty())
+	{
+		QFile file(summaryFile);
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+		{
+			qWarning("Can't open summary file %s",
+				 qPrintable(summaryFile));
+			return 1;
+		}
+		QTextStream stream(&file);
+		JsonSerializer serializer(merger.summary());
+		if (!serializer.serialize(stream))
+			return 1;
+	}
+
+	return 0;
+}
+
+static int runSprtSim(const QStringList& args)
+{
+	MatchParser parser(args);
+	parser.addOption("-sprtsim", QVariant::StringList, 4, 6);
+	parser.addOption("-trueelo", QVariant::Double, 1, 1);
+	parser.addOption("-drawelo", QVariant::Double, 1, 1);
+	parser.addOption("-runs", QVariant::Int, 1, 1);
+	parser.addOption("-threads", QVariant::Int, 1, 1);
+	parser.addOption("-games", QVariant::Int, 1, 1);
+	parser.addOption("-srand", QVariant::UInt, 1, 1);
+	if (!parser.parse())
+		return 1;
+
+	MatchParser::Option option;
+	option.name = "-sprtsim";
+	option.value = parser.takeOption("-sprtsim");
+	Sprt sprt;
+	if (!parseSprt(option, &sprt))
+	{
+		qWarning("Invalid SPRT parameters");
+		return 1;
+	}
+
+	SprtSimulator simulator(sprt);
+	simulator.setTrueElo(parser.takeOption("-trueelo").toDouble());
+
+	QVariant drawElo = parser.takeOption("-drawelo");
+	if (drawElo.isValid())
+	{
+		if (drawElo.toDouble() < 0.0)
+		{
+			qWarning("Invalid draw ELO");
+			return 1;
+		}
+		simulator.setDrawElo(drawElo.toDouble());
+	}
+
+	QVariant runs = parser.takeOption("-runs");
+	if (runs.isValid())
+	{
+		if (runs.toInt() <= 0)
+		{
+			qWarning("Invalid run count");
+			return 1;
+		}
+		simulator.setRunCount(runs.toInt());
+	}
+
+	QVariant threads = parser.takeOption("-threads");
+	if (threads.isValid())
+	{
+		if (threads.toInt() <= 0)
+		{
+			qWarning("Invalid thread count");
+			return 1;
+		}
+		simulator.setThreadCount(threads.toInt());
+	}
+
+	QVariant games = parser.takeOption("-games");
+	if (games.isValid())
+	{
+		if (games.toInt() <= 0)
+		{
+			qWarning("Invalid game count");
+			return 1;
+		}
+		simulator.setMaxGames(games.toInt());
+	}
+
+	QVariant seed = parser.takeOption("-srand");
+	if (seed.isValid())
+		simulator.setSeed(seed.toUInt());
+
+	QTextStream out(stdout);
+	simulator.run(out);
+	return 0;
+}
+
+static int runProfileEngine(const QStringList& args)
+{
+	MatchParser parser(args);
+	parser.addOption("-profile-engine", QVariant::StringList, 1, -1);
+	parser.addOption("-depth", QVariant::Int, 1, 1);
+	parser.addOption("-searches", QVariant::Int, 1, 1);
+	parser.addOption("-movetimes", QVariant::String, 1, 1);
+	if (!parser.parse())
+		return 1;
+
+	EngineData engine;
+	QVariant engineOption = parser.takeOption("-profile-engine");
+	if (!parseEngine(engineOption.toStringList(), engine))
+	{
+		qWarning("Invalid chess engine");
+		return 1;
+	}
+	if (engine.config.command().isEmpty())
+	{
+		qCritical("missing chess engine command");
+		return 1;
+	}
+	if (engine.config.protocol().isEmpty())
+		engine.config.setProtocol("uci");
+
+	EngineProfiler profiler(engine.config);
+
+	QVariant depth = parser.takeOption("-depth");
+	if (depth.isValid())
+	{
+		if (depth.toInt() <= 0)
+		{
+			qWarning("Invalid search depth");
+			return 1;
+		}
+		profiler.setDepth(depth.toInt());
+	}
+
+	QVariant searches = parser.takeOption("-searches");
+	if (searches.isValid())
+	{
+		if (searches.toInt() <= 0)
+		{
+			qWarning("Invalid search count");
+			return 1;
+		}
+		profiler.setSearchCount(searches.toInt());
+	}
+
+	QVariant moveTimes = parser.takeOption("-movetimes");
+	if (moveTimes.isValid())
+	{
+		QList<int> times;
+		foreach (const QString& str, moveTimes.toString().split(','))
+		{
+			bool ok = false;
+			int time = str.toInt(&ok);
+			if (!ok || time <= 0)
+			{
+				qWarning("Invalid move time: %s", qPrintable(str));
+				return 1;
+			}
+			times << time;
+		}
+		profiler.setMoveTimes(times);
+	}
+
+	QTextStream out(stdout);
+	return profiler.run(out) ? 0 : 1;
+}
+
+static int runServe(const QStringList& args)
+{
+	MatchParser parser(args);
+	parser.addOption("-serve", QVariant::String, 1, 1);
+	parser.addOption("-concurrency", QVariant::Int, 1, 1);
+	parser.addOption("-enginepool", QVariant::Int, 1, 1);
+	if (!parser.parse())
+		return 1;
+
+	GameManager* manager = CuteChessCoreApplication::instance()->gameManager();
+
+	QVariant concurrency = parser.takeOption("-concurrency");
+	if (concurrency.isValid())
+	{
+		if (concurrency.toInt() <= 0)
+		{
+			qWarning("Invalid concurrency");
+			return 1;
+		}
+		manager->setConcurrency(concurrency.toInt());
+	}
+
+	// By default each engine can have an idle instance for every
+	// game slot waiting for the next job
+	int poolSize = manager->concurrency();
+	QVariant pool = parser.takeOption("-enginepool");
+	if (pool.isValid())
+	{
+		if (pool.toInt() < 0)
+		{
+			qWarning("Invalid engine pool size");
+			return 1;
+		}
+		poolSize = pool.toInt();
+	}
+	manager->setPlayerPoolSize(poolSize);
+
+	QMultiHash<QString, PlayerBuilder*> builders;
+	builderCache = &builders;
+
+	JobServer server(manager, parseMatch);
+	if (!server.listen(parser.takeOption("-serve").toString()))
+	{
+		builderCache = 0;
+		return 1;
+	}
+	QObject::connect(&server, SIGNAL(finished()),
+			 CuteChessCoreApplication::instance(), SLOT(quit()));
+
+	jobServer = &server;
+	int ret = CuteChessCoreApplication::exec();
+	jobServer = 0;
+
+	// The engines have quit, so their builders aren't needed
+	builderCache = 0;
+	qDeleteAll(builders);
+
+	if (TraceLog::isEnabled() && !TraceLog::finish())
+		ret = 1;
+	EngineLog::finish();
+	return ret;
+}
+
+int main(int argc, char* argv[])
+{
+	setvbuf(stdout, NULL, _IONBF, 0);
+	signal(SIGINT, sigintHandler);
+#ifdef Q_OS_UNIX
+	// A write to an engine that has died must not kill the program
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (qstrcmp(argv[i], "-time-startup") == 0)
+			StartupTimer::enable();
+	}
+
+	StartupTimer appTimer("application");
+	CuteChessCoreApplication app(argc, argv);
+	appTimer.stop();
+
+	QStringList arguments = CuteChessCoreApplication::arguments();
+	arguments.takeFirst(); // application name
+	arguments.removeAll("-time-startup");
 
 	// Use trivial command-line parsing for now
 	QTextStream out(stdout);
@@ -594,11 +2605,55 @@ int main(int argc, char* argv[])
 		}
 	}
 
-	match = parseMatch(arguments, &app);
+	if (arguments.contains("-perft"))
+		return runPerft(arguments);
+	if (arguments.contains("-validate"))
+		return runValidate(arguments);
+	if (arguments.contains("-pgnfilter"))
+		return runPgnFilter(arguments);
+	if (arguments.contains("-makebook"))
+		return runMakeBook(arguments);
+	if (arguments.contains("-dedup"))
+		return runDedup(arguments);
+	if (arguments.contains("-endgames"))
+		return runEndgames(arguments);
+	if (arguments.contains("-tbscan"))
+		return runTbScan(arguments);
+	if (arguments.contains("-epdtest"))
+		return runEpdTest(arguments);
+	if (arguments.contains("-annotate"))
+		return runAnnotate(arguments);
+	if (arguments.contains("-balance"))
+		return runBalance(arguments);
+	if (arguments.contains("-unpack"))
+		return runUnpack(arguments);
+	if (arguments.contains("-worker"))
+		return runWorker(arguments);
+	if (arguments.contains("-tournamentfile"))
+		return runTournamentFile(arguments);
+	if (arguments.contains("-mergeshards"))
+		return runMergeShards(arguments);
+	if (arguments.contains("-sprtsim"))
+		return runSprtSim(arguments);
+	if (arguments.contains("-profile-engine"))
+		return runProfileEngine(arguments);
+	if (arguments.contains("-serve"))
+		return runServe(arguments);
+
+	{
+		StartupTimer timer("match setup");
+		match = parseMatch(arguments, &app);
+	}
 	if (match == 0)
 		return 1;
 	QObject::connect(match, SIGNAL(finished()), &app, SLOT(quit()));
 
+	StartupTimer::print();
 	match->start();
-	return app.exec();
+	int ret = app.exec();
+
+	if (TraceLog::isEnabled() && !TraceLog::finish())
+		ret = 1;
+	EngineLog::finish();
+	return ret;
 }
@@ -0,0 +1,67 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "matchrunner.h"
+#include <gamemanager.h>
+#include "enginematch.h"
+
+
+MatchRunner::MatchRunner(GameManager* manager, QObject* parent)
+	: QObject(parent),
+	  m_manager(manager),
+	  m_finishedCount(0)
+{
+	Q_ASSERT(manager != 0);
+}
+
+void MatchRunner::addMatch(EngineMatch* match)
+{
+	Q_ASSERT(match != 0);
+
+	match->setSharedGameManager(true);
+	connect(match, SIGNAL(finished()), this, SLOT(onMatchFinished()));
+	m_matches.append(match);
+}
+
+int MatchRunner::matchCount() const
+{
+	return m_matches.size();
+}
+
+void MatchRunner::start()
+{
+	m_finishedCount = 0;
+	foreach (EngineMatch* match, m_matches)
+		match->start();
+}
+
+void MatchRunner::stop()
+{
+	foreach (EngineMatch* match, m_matches)
+		match->stop();
+}
+
+void MatchRunner::onMatchFinished()
+{
+	if (++m_finishedCount < m_matches.size())
+		return;
+
+	qDebug("Finished all %d matches", m_matches.size());
+	connect(m_manager, SIGNAL(finished()), this, SIGNAL(finished()));
+	m_manager->finish();
+}
@@ -0,0 +1,66 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef MATCHRUNNER_H
+#define MATCHRUNNER_H
+
+#include <QObject>
+#include <QList>
+
+class EngineMatch;
+class GameManager;
+
+/*!
+ * \brief Runs several independent matches at the same time.
+ *
+ * All matches share one GameManager, so they share its concurrency
+ * limit and player pool. Each tournament queues its next game when
+ * the manager has a free game slot, which interleaves the matches'
+ * games and keeps every slot busy until the last match ends.
+ */
+class MatchRunner : public QObject
+{
+	Q_OBJECT
+
+	public:
+		MatchRunner(GameManager* manager, QObject* parent = 0);
+
+		/*! Adds \a match to the runner. */
+		void addMatch(EngineMatch* match);
+		/*! Returns the number of matches. */
+		int matchCount() const;
+
+		/*! Starts all matches. */
+		void start();
+		/*! Stops all matches. */
+		void stop();
+
+	signals:
+		/*! Emitted when all matches have finished. */
+		void finished();
+
+	private slots:
+		void onMatchFinished();
+
+	private:
+		GameManager* m_manager;
+		QList<EngineMatch*> m_matches;
+		int m_finishedCount;
+};
+
+#endif // MATCHRUNNER_H
@@ -0,0 +1,461 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "metricsserver.h"
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <chessgame.h>
+#include <gamemanager.h>
+#include <playerbuilder.h>
+#include <tournament.h>
+#include <sprt.h>
+
+static const int s_maxRequestSize = 8192;
+
+// Fixed-point scale of the SPRT values
+static const int s_sprtScale = 1000;
+
+static int atomicValue(const QAtomicInt& value)
+{
+#if QT_VERSION >= 0x050000
+	return value.load();
+#else
+	return value;
+#endif
+}
+
+struct PlayerMetrics
+{
+	QByteArray label;
+	QAtomicInt wins;
+	QAtomicInt draws;
+	QAtomicInt losses;
+	QAtomicInt forfeits;
+	QAtomicInt crashes;
+	QAtomicInt moveLatency;
+};
+
+struct PlayerTable
+{
+	PlayerTable(int playerCount)
+		: count(playerCount),
+		  players(new PlayerMetrics[playerCount])
+	{
+	}
+	~PlayerTable()
+	{
+		delete [] players;
+	}
+
+	const int count;
+	PlayerMetrics* const players;
+};
+
+struct MatchMetrics
+{
+	QElapsedTimer timer;
+	QAtomicInt gamesStarted;
+	QAtomicInt gamesFinished;
+	QAtomicInt activeGames;
+	QAtomicInt queuedGames;
+	QAtomicInt sprtActive;
+	QAtomicInt sprtLlr;
+	QAtomicInt sprtLowerBound;
+	QAtomicInt sprtUpperBound;
+	QAtomicPointer<PlayerTable> playerTable;
+
+	const PlayerTable* players() const
+	{
+	#if QT_VERSION >= 0x050000
+		return playerTable.loadAcquire();
+	#else
+		return playerTable;
+	#endif
+	}
+
+	QByteArray toText() const;
+};
+
+static void appendMetric(QByteArray& out,
+			 const char* name,
+			 const char* type,
+			 const char* help)
+{
+	out += "# HELP ";
+	out += name;
+	out += ' ';
+	out += help;
+	out += "\n# TYPE ";
+	out += name;
+	out += ' ';
+	out += type;
+	out += '\n';
+}
+
+static void appendSample(QByteArray& out,
+			 const char* name,
+			 const QByteArray& labels,
+			 const QByteArray& value)
+{
+	out += name;
+	if (!labels.isEmpty())
+	{
+		out += '{';
+		out += labels;
+		out += '}';
+	}
+	out += ' ';
+	out += value;
+	out += '\n';
+}
+
+static QByteArray labelValue(const QString& str)
+{
+	QByteArray value(str.toUtf8());
+	value.replace('\\', "\\\\");
+	value.replace('\"', "\\\"");
+	value.replace('\n', "\\n");
+	return "player=\"" + value + '\"';
+}
+
+QByteArray MatchMetrics::toText() const
+{
+	QByteArray out;
+	out.reserve(4096);
+
+	const int finished = atomicValue(gamesFinished);
+	const qint64 elapsed = timer.elapsed();
+
+	appendMetric(out, "cutechess_games_started_total", "counter",
+		     "Number of games started.");
+	appendSample(out, "cutechess_games_started_total", QByteArray(),
+		     QByteArray::number(atomicValue(gamesStarted)));
+	appendMetric(out, "cutechess_games_finished_total", "counter",
+		     "Number of games finished.");
+	appendSample(out, "cutechess_games_finished_total", QByteArray(),
+		     QByteArray::number(finished));
+	appendMetric(out, "cutechess_games_per_second", "gauge",
+		     "Average number of games finished per second.");
+	appendSample(out, "cutechess_games_per_second", QByteArray(),
+		     QByteArray::number(elapsed > 0 ? finished * 1000.0 / elapsed : 0.0,
+					'g', 6));
+	appendMetric(out, "cutechess_active_games", "gauge",
+		     "Number of games being played.");
+	appendSample(out, "cutechess_active_games", QByteArray(),
+		     QByteArray::number(atomicValue(activeGames)));
+	appendMetric(out, "cutechess_queued_games", "gauge",
+		     "Number of games waiting for a free game slot.");
+	appendSample(out, "cutechess_queued_games", QByteArray(),
+		     QByteArray::number(atomicValue(queuedGames)));
+
+	const PlayerTable* table = players();
+	if (table != 0 && table->count > 0)
+	{
+		appendMetric(out, "cutechess_player_games_total", "counter",
+			     "Number of finished games by player and result.");
+		for (int i = 0; i < table->count; i++)
+		{
+			const PlayerMetrics& p = table->players[i];
+			appendSample(out, "cutechess_player_games_total",
+				     p.label + ",result=\"win\"",
+				     QByteArray::number(atomicValue(p.wins)));
+			appendSample(out, "cutechess_player_games_total",
+				     p.label + ",result=\"draw\"",
+				     QByteArray::number(atomicValue(p.draws)));
+			appendSample(out, "cutechess_player_games_total",
+				     p.label + ",result=\"loss\"",
+				     QByteArray::number(atomicValue(p.losses)));
+		}
+
+		appendMetric(out, "cutechess_player_time_forfeits_total", "counter",
+			     "Number of games lost on time.");
+		for (int i = 0; i < table->count; i++)
+			appendSample(out, "cutechess_player_time_forfeits_total",
+				     table->players[i].label,
+				     QByteArray::number(atomicValue(table->players[i].forfeits)));
+
+		appendMetric(out, "cutechess_player_crashes_total", "counter",
+			     "Number of engine restarts after a crash.");
+		for (int i = 0; i < table->count; i++)
+			appendSample(out, "cutechess_player_crashes_total",
+				     table->players[i].label,
+				     QByteArray::number(atomicValue(table->players[i].crashes)));
+
+		appendMetric(out, "cutechess_player_move_latency_ms", "gauge",
+			     "Average delay between the end of the thinking "
+			     "time and the move in milliseconds.");
+		for (int i = 0; i < table->count; i++)
+			appendSample(out, "cutechess_player_move_latency_ms",
+				     table->players[i].label,
+				     QByteArray::number(atomicValue(table->players[i].moveLatency)));
+	}
+
+	if (atomicValue(sprtActive))
+	{
+		appendMetric(out, "cutechess_sprt_llr", "gauge",
+			     "SPRT log-likelihood ratio.");
+		appendSample(out, "cutechess_sprt_llr", QByteArray(),
+			     QByteArray::number(double(atomicValue(sprtLlr)) / s_sprtScale));
+		appendMetric(out, "cutechess_sprt_lower_bound", "gauge",
+			     "SPRT lower bound.");
+		appendSample(out, "cutechess_sprt_lower_bound", QByteArray(),
+			     QByteArray::number(double(atomicValue(sprtLowerBound)) / s_sprtScale));
+		appendMetric(out, "cutechess_sprt_upper_bound", "gauge",
+			     "SPRT upper bound.");
+		appendSample(out, "cutechess_sprt_upper_bound", QByteArray(),
+			     QByteArray::number(double(atomicValue(sprtUpperBound)) / s_sprtScale));
+	}
+
+	return out;
+}
+
+
+class MetricsHttpServer : public QObject
+{
+	Q_OBJECT
+
+	public:
+		MetricsHttpServer(const MatchMetrics* metrics)
+			: m_metrics(metrics),
+			  m_server(0)
+		{
+		}
+
+	public slots:
+		bool listen(const QString& host, int port)
+		{
+			QHostAddress address(QHostAddress::LocalHost);
+			if (!host.isEmpty() && host != "localhost"
+			&&  !address.setAddress(host))
+			{
+				qWarning("Invalid metrics server address: %s",
+					 qPrintable(host));
+				return false;
+			}
+
+			m_server = new QTcpServer(this);
+			connect(m_server, SIGNAL(newConnection()),
+				this, SLOT(onNewConnection()));
+			if (!m_server->listen(address, quint16(port)))
+			{
+				qWarning("Can't start the metrics server: %s",
+					 qPrintable(m_server->errorString()));
+				return false;
+			}
+			return true;
+		}
+
+		void close()
+		{
+			delete m_server;
+			m_server = 0;
+		}
+
+	private slots:
+		void onNewConnection()
+		{
+			while (QTcpSocket* socket = m_server->nextPendingConnection())
+			{
+				connect(socket, SIGNAL(readyRead()),
+					this, SLOT(onReadyRead()));
+				connect(socket, SIGNAL(disconnected()),
+					socket, SLOT(deleteLater()));
+			}
+		}
+
+		void onReadyRead()
+		{
+			QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+			Q_ASSERT(socket != 0);
+
+			if (!socket->canReadLine())
+			{
+				if (socket->bytesAvailable() > s_maxRequestSize)
+					socket->abort();
+				return;
+			}
+
+			// Only the request line matters because the connection
+			// is closed after the response
+			const QList<QByteArray> request(socket->readLine().split(' '));
+			disconnect(socket, SIGNAL(readyRead()),
+				   this, SLOT(onReadyRead()));
+
+			QByteArray status("200 OK");
+			QByteArray body;
+			if (request.size() < 2 || request.at(0) != "GET")
+			{
+				status = "405 Method Not Allowed";
+				body = "Method not allowed\n";
+			}
+			else if (request.at(1) == "/metrics" || request.at(1) == "/")
+				body = m_metrics->toText();
+			else
+			{
+				status = "404 Not Found";
+				body = "Not found\n";
+			}
+
+			QByteArray response("HTTP/1.0 ");
+			response += status;
+			response += "\r\nContent-Type: text/plain; version=0.0.4"
+				    "\r\nContent-Length: ";
+			response += QByteArray::number(body.size());
+			response += "\r\nConnection: close\r\n\r\n";
+			response += body;
+
+			socket->write(response);
+			socket->disconnectFromHost();
+		}
+
+	private:
+		const MatchMetrics* m_metrics;
+		QTcpServer* m_server;
+};
+
+
+MetricsServer::MetricsServer(Tournament* tournament, QObject* parent)
+	: QObject(parent),
+	  m_tournament(tournament),
+	  m_metrics(new MatchMetrics),
+	  m_http(0)
+{
+	Q_ASSERT(tournament != 0);
+
+	m_metrics->timer.start();
+}
+
+MetricsServer::~MetricsServer()
+{
+	if (m_thread.isRunning())
+	{
+		QMetaObject::invokeMethod(m_http, "close",
+					  Qt::BlockingQueuedConnection);
+		m_thread.quit();
+		m_thread.wait();
+	}
+	delete m_http;
+	delete m_metrics->players();
+	delete m_metrics;
+}
+
+bool MetricsServer::listen(const QString& address)
+{
+	Q_ASSERT(m_http == 0);
+
+	const int colon = address.lastIndexOf(':');
+	bool ok = false;
+	const int port = address.mid(colon + 1).toInt(&ok);
+	if (!ok || port <= 0 || port > 65535)
+	{
+		qWarning("Invalid metrics server port: %s", qPrintable(address));
+		return false;
+	}
+
+	m_http = new MetricsHttpServer(m_metrics);
+	m_http->moveToThread(&m_thread);
+	m_thread.start();
+
+	QMetaObject::invokeMethod(m_http, "listen",
+				  Qt::BlockingQueuedConnection,
+				  Q_RETURN_ARG(bool, ok),
+				  Q_ARG(QString, address.left(qMax(colon, 0))),
+				  Q_ARG(int, port));
+	return ok;
+}
+
+void MetricsServer::start()
+{
+	const int count = m_tournament->playerCount();
+	PlayerTable* table = new PlayerTable(count);
+	for (int i = 0; i < count; i++)
+		table->players[i].label = labelValue(
+			m_tournament->playerAt(i).builder->name());
+	m_metrics->playerTable.fetchAndStoreOrdered(table);
+
+	GameManager* manager = m_tournament->gameManager();
+	connect(manager, SIGNAL(gameStarted(ChessGame*)),
+		this, SLOT(onGameStarted()));
+	connect(manager, SIGNAL(gameDestroyed(ChessGame*)),
+		this, SLOT(onGameDestroyed()));
+	connect(m_tournament, SIGNAL(gameFinished(ChessGame*, int, int, int)),
+		this, SLOT(onGameFinished(ChessGame*, int, int, int)));
+}
+
+void MetricsServer::onGameStarted()
+{
+	m_metrics->gamesStarted.fetchAndAddRelaxed(1);
+	m_metrics->activeGames.fetchAndAddRelaxed(1);
+	m_metrics->queuedGames.fetchAndStoreRelaxed(
+		m_tournament->gameManager()->queuedGameCount());
+}
+
+void MetricsServer::onGameDestroyed()
+{
+	m_metrics->activeGames.fetchAndAddRelaxed(-1);
+	m_metrics->queuedGames.fetchAndStoreRelaxed(
+		m_tournament->gameManager()->queuedGameCount());
+}
+
+void MetricsServer::updatePlayer(int index)
+{
+	const PlayerTable* table = m_metrics->players();
+	if (table == 0 || index < 0 || index >= table->count)
+		return;
+
+	const Tournament::PlayerData data(m_tournament->playerAt(index));
+	PlayerMetrics& player = table->players[index];
+	player.wins.fetchAndStoreRelaxed(data.wins);
+	player.draws.fetchAndStoreRelaxed(data.draws);
+	player.losses.fetchAndStoreRelaxed(data.losses);
+	player.forfeits.fetchAndStoreRelaxed(data.timeUsage.forfeits());
+	player.crashes.fetchAndStoreRelaxed(data.builder->restartCount());
+	player.moveLatency.fetchAndStoreRelaxed(data.responseStats.average());
+}
+
+void MetricsServer::onGameFinished(ChessGame* game,
+				   int number,
+				   int whiteIndex,
+				   int blackIndex)
+{
+	Q_UNUSED(game);
+	Q_UNUSED(number);
+
+	m_metrics->gamesFinished.fetchAndAddRelaxed(1);
+	updatePlayer(whiteIndex);
+	updatePlayer(blackIndex);
+
+	const Sprt* sprt = m_tournament->sprt();
+	if (!sprt->isNull())
+	{
+		const Sprt::Status status(sprt->status());
+		m_metrics->sprtLlr.fetchAndStoreRelaxed(
+			qRound(status.llr * s_sprtScale));
+		m_metrics->sprtLowerBound.fetchAndStoreRelaxed(
+			qRound(status.lBound * s_sprtScale));
+		m_metrics->sprtUpperBound.fetchAndStoreRelaxed(
+			qRound(status.uBound * s_sprtScale));
+		m_metrics->sprtActive.fetchAndStoreRelease(1);
+	}
+}
+
+#include "metricsserver.moc"
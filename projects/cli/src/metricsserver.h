@@ -0,0 +1,82 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QObject>
+#include <QThread>
+
+class ChessGame;
+class Tournament;
+struct MatchMetrics;
+class MetricsHttpServer;
+
+/*!
+ * \brief An HTTP endpoint for live match metrics.
+ *
+ * MetricsServer serves the match's progress at "/metrics" in the
+ * Prometheus text format: games started and finished, games per
+ * second, active and queued games, each player's wins, draws,
+ * losses, time forfeits, crashes and average move latency, and the
+ * SPRT log-likelihood ratio.
+ *
+ * The counters are atomic integers updated by the tournament's and
+ * game manager's signals, and the HTTP server runs in its own thread,
+ * so a scrape never blocks the game scheduling.
+ */
+class MetricsServer : public QObject
+{
+	Q_OBJECT
+
+	public:
+		MetricsServer(Tournament* tournament, QObject* parent = 0);
+		virtual ~MetricsServer();
+
+		/*!
+		 * Starts listening for HTTP connections at \a address,
+		 * which is "[HOST:]PORT". The default host is localhost.
+		 * Returns false on failure.
+		 */
+		bool listen(const QString& address);
+		/*!
+		 * Registers the tournament's players.
+		 *
+		 * Must be called after all players have been added and
+		 * before the tournament starts.
+		 */
+		void start();
+
+	private slots:
+		void onGameStarted();
+		void onGameDestroyed();
+		void onGameFinished(ChessGame* game,
+				    int number,
+				    int whiteIndex,
+				    int blackIndex);
+
+	private:
+		void updatePlayer(int index);
+
+		Tournament* m_tournament;
+		MatchMetrics* m_metrics;
+		QThread m_thread;
+		MetricsHttpServer* m_http;
+};
+
+#endif // METRICSSERVER_H
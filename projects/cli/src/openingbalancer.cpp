@@ -0,0 +1,404 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "openingbalancer.h"
+#include <climits>
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QSet>
+#include <QMutexLocker>
+#include <board/board.h>
+#include <board/boardfactory.h>
+#include <chessgame.h>
+#include <chessplayer.h>
+#include <pgngame.h>
+#include <gamemanager.h>
+#include <enginebuilder.h>
+#include <humanbuilder.h>
+
+
+OpeningBalancer::OpeningBalancer(GameManager* manager, QObject* parent)
+	: QObject(parent),
+	  m_manager(manager),
+	  m_engine(0),
+	  m_opponent(new HumanBuilder("Opening balancer")),
+	  m_suite(0),
+	  m_minScore(-50),
+	  m_maxScore(50),
+	  m_debug(false),
+	  m_stopping(false),
+	  m_nextPosition(0),
+	  m_finishedPositions(0),
+	  m_cachedPositions(0)
+{
+	Q_ASSERT(manager != 0);
+
+	m_startTime.start();
+}
+
+OpeningBalancer::~OpeningBalancer()
+{
+	delete m_engine;
+	delete m_opponent;
+	delete m_suite;
+}
+
+bool OpeningBalancer::load(const QString& fileName, OpeningSuite::Format format)
+{
+	delete m_suite;
+	m_suite = new OpeningSuite(fileName, format);
+	if (!m_suite->initialize())
+	{
+		qWarning("Can't open opening suite %s", qPrintable(fileName));
+		return false;
+	}
+
+	m_openingKeys.clear();
+	m_validOpenings.clear();
+	m_positions.clear();
+
+	// The final positions of the openings are evaluated once, even
+	// if several openings transpose to them
+	QSet<quint64> keys;
+	forever
+	{
+		PgnGame game(m_suite->nextGame(INT_MAX));
+		int index = m_suite->lastIndex();
+		if (index < m_openingKeys.size())
+			break;
+
+		// Openings that the suite can't read are skipped
+		m_openingKeys.resize(index);
+		m_validOpenings.resize(index);
+
+		Chess::Board* board = game.createBoard();
+		bool ok = (board != 0);
+		foreach (const PgnGame::MoveData& md, game.moves())
+		{
+			if (!ok)
+				break;
+			Chess::Move move(board->moveFromGenericMove(md.move));
+			ok = !move.isNull();
+			if (ok)
+				board->makeMove(move);
+		}
+
+		m_validOpenings.append(ok);
+		m_openingKeys.append(ok ? board->key() : 0);
+		if (ok && !keys.contains(board->key()))
+		{
+			Position position;
+			position.variant = board->variant();
+			position.fen = board->fenString();
+			position.key = board->key();
+			position.side = board->sideToMove();
+			keys.insert(position.key);
+			m_positions.append(position);
+		}
+		if (board != 0)
+			Chess::BoardFactory::release(board);
+	}
+
+	int skipped = m_validOpenings.count(false);
+	if (skipped > 0)
+		qWarning("Skipped %d openings that can't be replayed", skipped);
+	if (m_positions.isEmpty())
+	{
+		qWarning("No openings in %s", qPrintable(fileName));
+		return false;
+	}
+	return true;
+}
+
+void OpeningBalancer::setEngine(const EngineConfiguration& config,
+				const TimeControl& timeControl)
+{
+	delete m_engine;
+	m_engine = new EngineBuilder(config);
+	m_timeControl = timeControl;
+}
+
+void OpeningBalancer::setWindow(int minScore, int maxScore)
+{
+	Q_ASSERT(minScore <= maxScore);
+
+	m_minScore = minScore;
+	m_maxScore = maxScore;
+}
+
+bool OpeningBalancer::setCacheFile(const QString& fileName)
+{
+	m_cacheFile = fileName;
+
+	QFile file(fileName);
+	if (!file.exists())
+		return true;
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		qWarning("Can't open evaluation cache %s", qPrintable(fileName));
+		return false;
+	}
+
+	// Each line has a position key in hex and a score
+	QTextStream in(&file);
+	while (!in.atEnd())
+	{
+		QStringList fields(in.readLine().split(' ', QString::SkipEmptyParts));
+		if (fields.size() != 2)
+			continue;
+
+		bool keyOk = false;
+		bool scoreOk = false;
+		quint64 key = fields.at(0).toULongLong(&keyOk, 16);
+		int score = fields.at(1).toInt(&scoreOk);
+		if (keyOk && scoreOk)
+			m_scores.insert(key, score);
+	}
+
+	return true;
+}
+
+void OpeningBalancer::setDebugMode(bool debug)
+{
+	m_debug = debug;
+}
+
+bool OpeningBalancer::start(const QString& outFileName)
+{
+	Q_ASSERT(m_suite != 0);
+
+	m_outFileName = outFileName;
+	m_stopping = false;
+	m_nextPosition = 0;
+	m_finishedPositions = 0;
+	m_startTime.start();
+
+	// Only the positions without a cached score are searched
+	QVector<Position> positions;
+	foreach (const Position& position, m_positions)
+	{
+		if (!m_scores.contains(position.key))
+			positions.append(position);
+	}
+	m_cachedPositions = m_positions.size() - positions.size();
+	m_positions = positions;
+
+	if (!m_positions.isEmpty() && m_engine == 0)
+	{
+		qWarning("%d positions aren't in the evaluation cache, "
+			 "and there's no engine to evaluate them",
+			 m_positions.size());
+		return false;
+	}
+
+	if (m_debug)
+		connect(m_manager, SIGNAL(debugMessage(QString)),
+			this, SLOT(print(QString)));
+	connect(m_manager, SIGNAL(ready()),
+		this, SLOT(startNextPosition()));
+
+	qDebug("Evaluating %d positions, %d positions are cached",
+	       m_positions.size(), m_cachedPositions);
+	if (m_positions.isEmpty())
+	{
+		// The event loop isn't running yet
+		QMetaObject::invokeMethod(this, "stop", Qt::QueuedConnection);
+		return true;
+	}
+
+	startNextPosition();
+	return true;
+}
+
+void OpeningBalancer::stop()
+{
+	if (m_stopping)
+		return;
+
+	m_stopping = true;
+	disconnect(m_manager, SIGNAL(ready()),
+		   this, SLOT(startNextPosition()));
+
+	if (m_games.isEmpty())
+	{
+		if (!m_cacheFile.isEmpty() && !writeCache())
+			qWarning("Can't write evaluation cache %s",
+				 qPrintable(m_cacheFile));
+		if (m_finishedPositions >= m_positions.size()
+		&&  !m_outFileName.isEmpty())
+			writeSuite();
+
+		connect(m_manager, SIGNAL(finished()),
+			this, SIGNAL(finished()));
+		m_manager->finish();
+		return;
+	}
+
+	foreach (ChessGame* game, m_games)
+		QMetaObject::invokeMethod(game, "stop", Qt::QueuedConnection);
+}
+
+void OpeningBalancer::startNextPosition()
+{
+	if (m_stopping || m_nextPosition >= m_positions.size())
+		return;
+
+	int index = m_nextPosition++;
+	const Position& position = m_positions.at(index);
+
+	Chess::Board* board = Chess::BoardFactory::create(position.variant);
+	Q_ASSERT(board != 0);
+	ChessGame* game = new ChessGame(board, new PgnGame());
+	game->setProperty("balancerPosition", index);
+	game->setStartingFen(position.fen);
+	game->setTimeControl(m_timeControl);
+	m_games.append(game);
+
+	// The engine's score is recorded in the game thread, and the
+	// game is stopped before the opponent has to move.
+	connect(game, SIGNAL(moveMade(Chess::GenericMove, QString, QString)),
+		this, SLOT(onMoveMade(Chess::GenericMove, QString, QString)),
+		Qt::DirectConnection);
+	connect(game, SIGNAL(finished(ChessGame*)),
+		this, SLOT(onGameFinished(ChessGame*)));
+	connect(game, SIGNAL(startFailed(ChessGame*)),
+		this, SLOT(onGameStartFailed(ChessGame*)));
+
+	if (position.side == Chess::Side::White)
+		m_manager->newGame(game, m_engine, m_opponent,
+				   GameManager::Enqueue, GameManager::ReusePlayers);
+	else
+		m_manager->newGame(game, m_opponent, m_engine,
+				   GameManager::Enqueue, GameManager::ReusePlayers);
+}
+
+void OpeningBalancer::onMoveMade(const Chess::GenericMove& move,
+				 const QString& sanString,
+				 const QString& comment)
+{
+	Q_UNUSED(move);
+	Q_UNUSED(sanString);
+	Q_UNUSED(comment);
+
+	ChessGame* game = qobject_cast<ChessGame*>(QObject::sender());
+	Q_ASSERT(game != 0);
+
+	int index = game->property("balancerPosition").toInt();
+	const Position& position = m_positions.at(index);
+	const MoveEvaluation& eval(game->player(position.side)->evaluation());
+	if (eval.depth() > 0)
+	{
+		int score = eval.score();
+		if (position.side == Chess::Side::Black)
+			score = -score;
+
+		QMutexLocker locker(&m_mutex);
+		m_scores.insert(position.key, score);
+	}
+
+	QMetaObject::invokeMethod(game, "stop", Qt::QueuedConnection);
+}
+
+void OpeningBalancer::onGameFinished(ChessGame* game)
+{
+	finishPosition(game);
+}
+
+void OpeningBalancer::onGameStartFailed(ChessGame* game)
+{
+	qWarning("%s", qPrintable(game->errorString()));
+	finishPosition(game);
+	stop();
+}
+
+void OpeningBalancer::finishPosition(ChessGame* game)
+{
+	if (!m_games.removeOne(game))
+		return;
+
+	delete game->pgn();
+	game->deleteLater();
+	m_finishedPositions++;
+
+	if (m_finishedPositions % 100 == 0
+	||  m_finishedPositions == m_positions.size())
+		qDebug("%d/%d positions evaluated",
+		       m_finishedPositions, m_positions.size());
+
+	if (m_finishedPositions >= m_positions.size()
+	||  (m_stopping && m_games.isEmpty()))
+	{
+		m_stopping = false;
+		stop();
+	}
+}
+
+bool OpeningBalancer::writeCache() const
+{
+	QFile file(m_cacheFile);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+		return false;
+
+	QTextStream out(&file);
+	QHash<quint64, int>::const_iterator it;
+	for (it = m_scores.constBegin(); it != m_scores.constEnd(); ++it)
+		out << QString::number(it.key(), 16) << ' ' << it.value() << '\n';
+	out.flush();
+
+	return out.status() == QTextStream::Ok;
+}
+
+void OpeningBalancer::writeSuite()
+{
+	QSet<int> excluded;
+	int invalid = 0;
+	int unscored = 0;
+	int unbalanced = 0;
+	for (int i = 0; i < m_openingKeys.size(); i++)
+	{
+		QHash<quint64, int>::const_iterator it =
+			m_scores.constFind(m_openingKeys.at(i));
+		if (!m_validOpenings.at(i))
+			invalid++;
+		else if (it == m_scores.constEnd())
+			unscored++;
+		else if (it.value() < m_minScore || it.value() > m_maxScore)
+			unbalanced++;
+		else
+			continue;
+		excluded.insert(i);
+	}
+
+	int count = m_suite->writeSubset(m_outFileName, excluded);
+	if (count < 0)
+	{
+		qWarning("Can't write opening suite %s", qPrintable(m_outFileName));
+		return;
+	}
+
+	qDebug("Kept %d of %d openings in %lld ms",
+	       count, m_openingKeys.size(), m_startTime.elapsed());
+	qDebug("Unbalanced: %d, without a score: %d, invalid: %d",
+	       unbalanced, unscored, invalid);
+}
+
+void OpeningBalancer::print(const QString& msg)
+{
+	qDebug("%lld %s", m_startTime.elapsed(), qPrintable(msg));
+}
@@ -0,0 +1,161 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef OPENINGBALANCER_H
+#define OPENINGBALANCER_H
+
+#include <QObject>
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QString>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <timecontrol.h>
+#include <openingsuite.h>
+#include <board/genericmove.h>
+#include <board/side.h>
+
+class ChessGame;
+class GameManager;
+class EngineConfiguration;
+class PlayerBuilder;
+
+
+/*!
+ * \brief Drops the unbalanced openings of an opening suite.
+ *
+ * OpeningBalancer replays every opening of a suite, lets an engine
+ * evaluate the final position, and writes the openings whose score
+ * from white's point of view is within a window to a new suite.
+ *
+ * Each position is evaluated in its own game, so the positions are
+ * distributed over GameManager::concurrency() engine instances that
+ * are reused for every position. The engine's time control should
+ * have a node limit, so that the evaluations are reproducible.
+ *
+ * The scores are cached by the Zobrist keys of the positions, and the
+ * cache can be saved to a file. Filtering the suite again with another
+ * window only searches the positions that aren't in the cache.
+ */
+class OpeningBalancer : public QObject
+{
+	Q_OBJECT
+
+	public:
+		/*! Creates a new balancer that plays in \a manager. */
+		OpeningBalancer(GameManager* manager, QObject* parent = 0);
+		/*! Destroys the balancer. */
+		virtual ~OpeningBalancer();
+
+		/*!
+		 * Reads the openings of the suite \a fileName in \a format
+		 * format. Returns true if any openings were read.
+		 */
+		bool load(const QString& fileName, OpeningSuite::Format format);
+		/*!
+		 * Sets the engine to \a config and its time control for
+		 * each position to \a timeControl.
+		 */
+		void setEngine(const EngineConfiguration& config,
+			       const TimeControl& timeControl);
+		/*!
+		 * Sets the window of accepted scores to \a minScore ...
+		 * \a maxScore centipawns from white's point of view.
+		 * The default is -50 ... 50.
+		 */
+		void setWindow(int minScore, int maxScore);
+		/*!
+		 * Sets the evaluation cache file to \a fileName and reads
+		 * the scores that are already in it.
+		 *
+		 * The new scores are written to the file when the openings
+		 * are filtered. Returns false if the file exists but can't
+		 * be read.
+		 */
+		bool setCacheFile(const QString& fileName);
+		/*! Enables the engines' debug output if \a debug is true. */
+		void setDebugMode(bool debug);
+
+		/*!
+		 * Starts evaluating the positions that aren't in the cache.
+		 * When they're done, the balanced openings are written to
+		 * \a outFileName.
+		 *
+		 * Returns false if some positions aren't in the cache and
+		 * no engine is set.
+		 */
+		bool start(const QString& outFileName);
+
+	public slots:
+		/*!
+		 * Stops evaluating after the current positions. The
+		 * scores found so far are saved, but no suite is written.
+		 */
+		void stop();
+
+	signals:
+		/*! Emitted when the balancer is finished or stopped. */
+		void finished();
+
+	private slots:
+		void startNextPosition();
+		void onMoveMade(const Chess::GenericMove& move,
+				const QString& sanString,
+				const QString& comment);
+		void onGameFinished(ChessGame* game);
+		void onGameStartFailed(ChessGame* game);
+		void print(const QString& msg);
+
+	private:
+		struct Position
+		{
+			QString variant;
+			QString fen;
+			quint64 key;
+			Chess::Side side;
+		};
+
+		void finishPosition(ChessGame* game);
+		bool writeCache() const;
+		void writeSuite();
+
+		GameManager* m_manager;
+		PlayerBuilder* m_engine;
+		PlayerBuilder* m_opponent;
+		TimeControl m_timeControl;
+		OpeningSuite* m_suite;
+		QString m_outFileName;
+		QString m_cacheFile;
+		int m_minScore;
+		int m_maxScore;
+		bool m_debug;
+		bool m_stopping;
+		QVector<quint64> m_openingKeys;
+		QVector<bool> m_validOpenings;
+		QVector<Position> m_positions;
+		int m_nextPosition;
+		int m_finishedPositions;
+		int m_cachedPositions;
+		QHash<quint64, int> m_scores;
+		QList<ChessGame*> m_games;
+		QMutex m_mutex;
+		QElapsedTimer m_startTime;
+};
+
+#endif // OPENINGBALANCER_H
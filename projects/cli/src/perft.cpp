@@ -0,0 +1,201 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "perft.h"
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <board/board.h>
+
+
+/*
+ * A lockless hash table for perft subtree counts.
+ *
+ * Each entry stores the key xored with the data, so an entry
+ * that was torn by two threads writing at the same time simply
+ * fails to match on the next probe.
+ */
+class PerftHash
+{
+	public:
+		PerftHash(int megabytes);
+		~PerftHash();
+
+		bool probe(quint64 key, int depth, quint64* nodes) const;
+		void store(quint64 key, int depth, quint64 nodes);
+
+	private:
+		struct Entry
+		{
+			quint64 key;
+			quint64 data;
+		};
+
+		Entry* m_entries;
+		quint64 m_mask;
+};
+
+PerftHash::PerftHash(int megabytes)
+	: m_entries(0),
+	  m_mask(0)
+{
+	Q_ASSERT(megabytes > 0);
+
+	// Use the largest power of two that fits in the given size
+	quint64 size = (quint64(megabytes) << 20) / sizeof(Entry);
+	quint64 count = 1;
+	while (count * 2 <= size)
+		count *= 2;
+
+	m_entries = new Entry[count];
+	m_mask = count - 1;
+	for (quint64 i = 0; i < count; i++)
+	{
+		m_entries[i].key = 0;
+		m_entries[i].data = 0;
+	}
+}
+
+PerftHash::~PerftHash()
+{
+	delete [] m_entries;
+}
+
+bool PerftHash::probe(quint64 key, int depth, quint64* nodes) const
+{
+	const Entry& entry = m_entries[key & m_mask];
+	quint64 data = entry.data;
+
+	if ((entry.key ^ data) != key || int(data & 0xFF) != depth)
+		return false;
+
+	*nodes = data >> 8;
+	return true;
+}
+
+void PerftHash::store(quint64 key, int depth, quint64 nodes)
+{
+	Entry& entry = m_entries[key & m_mask];
+	quint64 data = (nodes << 8) | quint64(depth & 0xFF);
+
+	entry.key = key ^ data;
+	entry.data = data;
+}
+
+
+Perft::Perft(const Chess::Board* board, int depth)
+	: m_board(board),
+	  m_depth(depth),
+	  m_hashSize(0),
+	  m_divide(false),
+	  m_hash(0)
+{
+	Q_ASSERT(board != 0);
+	Q_ASSERT(depth > 0);
+}
+
+Perft::~Perft()
+{
+	delete m_hash;
+}
+
+void Perft::setHashSize(int megabytes)
+{
+	Q_ASSERT(megabytes >= 0);
+	m_hashSize = megabytes;
+}
+
+void Perft::setDivide(bool enabled)
+{
+	m_divide = enabled;
+}
+
+void Perft::runJob(int index)
+{
+	// Each root move is searched with a board of its own
+	Chess::Board* board = m_board->copy();
+	board->makeMove(m_rootMoves.at(index));
+	quint64 nodes = (m_depth > 1) ? perft(board, m_depth - 1) : 1;
+	delete board;
+
+	QMutexLocker locker(&m_mutex);
+	m_rootCounts[index] = nodes;
+}
+
+quint64 Perft::perft(Chess::Board* board, int depth) const
+{
+	QVarLengthArray<Chess::Move> moves;
+	board->legalMoves(moves);
+	if (depth <= 1)
+		return moves.size();
+
+	quint64 key = board->key();
+	quint64 nodes = 0;
+	if (m_hash != 0 && m_hash->probe(key, depth, &nodes))
+		return nodes;
+
+	for (int i = 0; i < moves.size(); i++)
+	{
+		board->makeMove(moves[i]);
+		nodes += perft(board, depth - 1);
+		board->undoMove();
+	}
+
+	if (m_hash != 0)
+		m_hash->store(key, depth, nodes);
+
+	return nodes;
+}
+
+quint64 Perft::run(QTextStream& out)
+{
+	delete m_hash;
+	m_hash = (m_hashSize > 0) ? new PerftHash(m_hashSize) : 0;
+
+	Chess::Board* board = m_board->copy();
+	m_rootMoves = board->legalMoves();
+	m_rootCounts.fill(0, m_rootMoves.size());
+
+	QElapsedTimer timer;
+	timer.start();
+	runJobs(m_rootMoves.size());
+
+	qint64 elapsed = timer.elapsed();
+
+	quint64 nodes = 0;
+	for (int i = 0; i < m_rootMoves.size(); i++)
+	{
+		nodes += m_rootCounts.at(i);
+		if (m_divide)
+		{
+			Chess::Move move(m_rootMoves.at(i));
+			out << board->moveString(move, Chess::Board::LongAlgebraic)
+			    << ' ' << m_rootCounts.at(i) << endl;
+		}
+	}
+	delete board;
+
+	if (m_divide)
+		out << endl;
+	out << "Nodes: " << nodes << endl;
+	out << "Time: " << elapsed << " ms" << endl;
+	if (elapsed > 0)
+		out << "Nodes/second: " << nodes * 1000 / elapsed << endl;
+
+	return nodes;
+}
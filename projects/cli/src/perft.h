@@ -0,0 +1,90 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PERFT_H
+#define PERFT_H
+
+#include <QVector>
+#include <QMutex>
+#include <board/move.h>
+#include "workerpool.h"
+class QTextStream;
+namespace Chess { class Board; }
+class PerftHash;
+
+/*!
+ * \brief A multithreaded perft (performance test) runner.
+ *
+ * Perft counts the leaf nodes of the legal move tree of a position
+ * down to a fixed depth. The node counts are well known for many
+ * positions, which makes perft useful for verifying and benchmarking
+ * the move generators of Chess::Board subclasses.
+ *
+ * The root moves are distributed between worker threads, each of
+ * which searches with its own copy of the board. Optionally the
+ * subtree counts are stored in a hash table shared by all threads
+ * so that transpositions are only counted once.
+ */
+class Perft : public WorkerPool
+{
+	public:
+		/*!
+		 * Creates a new Perft object for the position in \a board.
+		 *
+		 * \a board is not modified, and it must stay valid until
+		 * run() returns.
+		 */
+		Perft(const Chess::Board* board, int depth);
+		/*! Destroys the Perft object. */
+		~Perft();
+
+		/*!
+		 * Sets the size of the transposition hash table to
+		 * \a megabytes. A value of 0 (the default) disables hashing.
+		 */
+		void setHashSize(int megabytes);
+		/*!
+		 * If \a enabled is true, the node count of each root move
+		 * is reported separately.
+		 */
+		void setDivide(bool enabled);
+
+		/*!
+		 * Runs the test and writes the results to \a out.
+		 * Returns the total node count.
+		 */
+		quint64 run(QTextStream& out);
+
+	protected:
+		// Inherited from WorkerPool
+		virtual void runJob(int index);
+
+	private:
+		quint64 perft(Chess::Board* board, int depth) const;
+
+		const Chess::Board* m_board;
+		int m_depth;
+		int m_hashSize;
+		bool m_divide;
+		PerftHash* m_hash;
+		QVector<Chess::Move> m_rootMoves;
+		QVector<quint64> m_rootCounts;
+		QMutex m_mutex;
+};
+
+#endif // PERFT_H
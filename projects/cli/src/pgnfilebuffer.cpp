@@ -0,0 +1,185 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "pgnfilebuffer.h"
+#include <cctype>
+#include <gzipdevice.h>
+
+// The number of chunks per worker thread. Games vary in length, so
+// a few chunks per thread keep the threads busy until the end.
+static const int s_chunksPerThread = 8;
+// The maximum size of a chunk in bytes
+static const qint64 s_maxChunkSize = 256 << 20;
+
+
+// Returns true if the last non-blank line before \a pos is a tag.
+static bool followsTag(const char* data, qint64 pos)
+{
+	qint64 end = pos - 1;
+	while (end > 0)
+	{
+		qint64 start = end;
+		while (start > 0 && data[start - 1] != '\n')
+			start--;
+
+		for (qint64 i = start; i < end; i++)
+		{
+			if (!isspace(data[i]))
+				return data[i] == '[';
+		}
+		end = start - 1;
+	}
+
+	return false;
+}
+
+/*
+ * Returns the position of the first game that starts at or after
+ * \a pos. A game starts with a line that begins with a tag, and the
+ * previous non-blank line isn't a tag.
+ */
+static qint64 nextGameStart(const char* data, qint64 size, qint64 pos)
+{
+	if (pos <= 0)
+		return 0;
+
+	while (pos < size && data[pos - 1] != '\n')
+		pos++;
+
+	bool isTag = followsTag(data, pos);
+	while (pos < size)
+	{
+		qint64 end = pos;
+		char first = 0;
+		while (end < size && data[end] != '\n')
+		{
+			if (first == 0 && !isspace(data[end]))
+				first = data[end];
+			end++;
+		}
+
+		if (first == '[' && !isTag)
+			return pos;
+		if (first != 0)
+			isTag = (first == '[');
+		pos = end + 1;
+	}
+
+	return size;
+}
+
+
+PgnFileBuffer::PgnFileBuffer(const QString& fileName)
+	: m_file(fileName),
+	  m_data(0),
+	  m_size(0)
+{
+}
+
+QString PgnFileBuffer::fileName() const
+{
+	return m_file.fileName();
+}
+
+bool PgnFileBuffer::open(QString* error)
+{
+	Q_ASSERT(error != 0);
+
+	if (!m_file.open(QIODevice::ReadOnly))
+	{
+		*error = QString("Can't open PGN file %1").arg(m_file.fileName());
+		return false;
+	}
+
+	// Compressed files have to be decompressed to memory before
+	// they can be split into chunks.
+	m_size = m_file.size();
+	m_data = 0;
+	if (GzipDevice::isCompressed(&m_file))
+	{
+		GzipDevice gzip(&m_file);
+		if (!gzip.open(QIODevice::ReadOnly))
+		{
+			*error = QString("Can't decompress PGN file %1: %2")
+				 .arg(m_file.fileName()).arg(gzip.errorString());
+			m_file.close();
+			return false;
+		}
+		m_buffer = gzip.readAll();
+		m_data = m_buffer.constData();
+		m_size = m_buffer.size();
+	}
+	else if (m_size > 0)
+		m_data = (const char*)m_file.map(0, m_size);
+	if (m_data == 0)
+	{
+		m_buffer = m_file.readAll();
+		m_data = m_buffer.constData();
+		m_size = m_buffer.size();
+	}
+
+	return true;
+}
+
+void PgnFileBuffer::close()
+{
+	m_buffer.clear();
+	m_file.close();
+	m_data = 0;
+	m_size = 0;
+}
+
+const char* PgnFileBuffer::data() const
+{
+	return m_data;
+}
+
+qint64 PgnFileBuffer::size() const
+{
+	return m_size;
+}
+
+QVector<PgnFileBuffer::Chunk> PgnFileBuffer::split(int threadCount,
+						    Boundary boundary) const
+{
+	Q_ASSERT(threadCount > 0);
+
+	QVector<Chunk> chunks;
+	int chunkCount = int(qMax(qint64(threadCount * s_chunksPerThread),
+				  m_size / s_maxChunkSize + 1));
+	qint64 start = 0;
+	for (int i = 1; i <= chunkCount && start < m_size; i++)
+	{
+		qint64 end = m_size * i / chunkCount;
+		if (boundary == GameBoundary)
+			end = nextGameStart(m_data, m_size, end);
+		else
+		{
+			while (end > 0 && end < m_size && m_data[end - 1] != '\n')
+				end++;
+		}
+		if (end <= start)
+			continue;
+
+		Chunk chunk = { start, end - start };
+		chunks.append(chunk);
+		start = end;
+	}
+
+	return chunks;
+}
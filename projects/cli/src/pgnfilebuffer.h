@@ -0,0 +1,85 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PGNFILEBUFFER_H
+#define PGNFILEBUFFER_H
+
+#include <QString>
+#include <QVector>
+#include <QFile>
+#include <QByteArray>
+
+/*!
+ * \brief The contents of a PGN file, split into chunks of whole games.
+ *
+ * PgnFileBuffer maps a PGN file to memory if possible, so that huge
+ * archives don't have to be copied. Compressed files are decompressed
+ * to memory. The contents can then be split into chunks that start
+ * and end at game boundaries, to be parsed by separate threads.
+ */
+class PgnFileBuffer
+{
+	public:
+		/*! Where the contents can be split. */
+		enum Boundary
+		{
+			GameBoundary,	//!< At the start of a PGN game
+			LineBoundary	//!< At the start of a line, eg. in EPD files
+		};
+
+		/*! A range of whole games within the buffer. */
+		struct Chunk
+		{
+			qint64 start;	//!< The position of the first game
+			qint64 size;	//!< The size of the chunk in bytes
+		};
+
+		/*! Creates a new PgnFileBuffer for the PGN file \a fileName. */
+		PgnFileBuffer(const QString& fileName);
+
+		/*! Returns the name of the PGN file. */
+		QString fileName() const;
+		/*!
+		 * Opens the file and makes its contents available.
+		 * Returns true if successful; otherwise sets \a error
+		 * and returns false.
+		 */
+		bool open(QString* error);
+		/*! Closes the file and releases the contents. */
+		void close();
+
+		/*! Returns the contents of the file. */
+		const char* data() const;
+		/*! Returns the size of the contents in bytes. */
+		qint64 size() const;
+
+		/*!
+		 * Splits the contents into chunks for \a threadCount
+		 * threads. Each chunk begins at \a boundary.
+		 */
+		QVector<Chunk> split(int threadCount,
+				     Boundary boundary = GameBoundary) const;
+
+	private:
+		QFile m_file;
+		QByteArray m_buffer;
+		const char* m_data;
+		qint64 m_size;
+};
+
+#endif // PGNFILEBUFFER_H
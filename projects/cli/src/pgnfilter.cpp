@@ -0,0 +1,218 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pgnfilter.h"
+#include <QFile>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <pgnstream.h>
+#include <pgngameentry.h>
+
+// The number of chunks per thread that can wait to be written
+static const int s_pendingChunksPerThread = 4;
+
+PgnFilter::PgnFilter(const QString& fileName, const QString& outFileName)
+	: m_file(fileName),
+	  m_outFileName(outFileName),
+	  m_minPlies(0),
+	  m_maxPlies(0),
+	  m_mode(PgnGame::Verbose),
+	  m_stripComments(false),
+	  m_writtenChunks(0)
+{
+}
+
+PgnFilter::~PgnFilter()
+{
+}
+
+void PgnFilter::setFilter(const PgnGameFilter& filter)
+{
+	m_filter = filter;
+}
+
+void PgnFilter::setVariant(const QString& variant)
+{
+	m_variant = variant;
+}
+
+void PgnFilter::setPlyRange(int minPlies, int maxPlies)
+{
+	m_minPlies = qMax(minPlies, 0);
+	m_maxPlies = qMax(maxPlies, 0);
+}
+
+void PgnFilter::setPgnMode(PgnGame::PgnMode mode)
+{
+	m_mode = mode;
+}
+
+void PgnFilter::setCommentsStripped(bool strip)
+{
+	m_stripComments = strip;
+}
+
+void PgnFilter::runJob(int index)
+{
+	Chunk* chunk = &m_chunks[index];
+	waitForWriter(index);
+	filterChunk(chunk);
+	finishChunk(chunk);
+}
+
+void PgnFilter::waitForWriter(int index)
+{
+	QMutexLocker locker(&m_mutex);
+
+	// Don't get too far ahead of the writer, or the output
+	// of a huge file could fill the memory
+	int maxPending = threadCount() * s_pendingChunksPerThread;
+	while (index - m_writtenChunks >= maxPending)
+		m_chunkWritten.wait(&m_mutex);
+}
+
+void PgnFilter::finishChunk(Chunk* chunk)
+{
+	QMutexLocker locker(&m_mutex);
+	chunk->done = true;
+	m_chunkDone.wakeAll();
+}
+
+void PgnFilter::filterChunk(Chunk* chunk) const
+{
+	// The chunk is read in place, without copying it
+	const QByteArray data(QByteArray::fromRawData(m_file.data() + chunk->start,
+						      int(chunk->size)));
+	PgnStream in(&data);
+	PgnGameEntry entry;
+	PgnGame game;
+
+	// Only the tags are read for the games that don't match
+	while (entry.read(in))
+	{
+		chunk->games++;
+		if (!entry.match(m_filter))
+			continue;
+
+		QString variant(entry.tagValue(PgnGameEntry::VariantTag));
+		if (variant.isEmpty())
+			variant = "standard";
+		if (!m_variant.isEmpty() && variant != m_variant)
+			continue;
+
+		// Parse the whole game, starting with a board of the right
+		// variant because the stream keeps the previous game's board
+		if (!in.setVariant(variant)
+		||  !in.seek(entry.pos(), entry.lineNumber())
+		||  !game.read(in))
+		{
+			chunk->invalidGames++;
+			continue;
+		}
+
+		int plies = game.moves().size();
+		if ((m_minPlies > 0 && plies < m_minPlies)
+		||  (m_maxPlies > 0 && plies > m_maxPlies))
+			continue;
+
+		if (m_stripComments)
+		{
+			for (int i = 0; i < plies; i++)
+				game.setMoveComment(i, QString());
+		}
+
+		game.write(chunk->output, m_mode);
+		chunk->matches++;
+	}
+}
+
+bool PgnFilter::run(QTextStream& out)
+{
+	QString error;
+	if (!m_file.open(&error))
+	{
+		out << error << endl;
+		return false;
+	}
+
+	QFile outFile(m_outFileName);
+	if (!outFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		out << "Can't open PGN file " << m_outFileName << endl;
+		m_file.close();
+		return false;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+
+	m_chunks.clear();
+	m_writtenChunks = 0;
+	foreach (const PgnFileBuffer::Chunk& range, m_file.split(threadCount()))
+	{
+		Chunk chunk = { range.start, range.size, 0, 0, 0, false, QByteArray() };
+		m_chunks.append(chunk);
+	}
+
+	startJobs(m_chunks.size());
+
+	// Write the chunks in order as soon as they're ready
+	bool ok = true;
+	int games = 0;
+	int matches = 0;
+	int invalidGames = 0;
+	for (int i = 0; i < m_chunks.size(); i++)
+	{
+		Chunk& chunk = m_chunks[i];
+		{
+			QMutexLocker locker(&m_mutex);
+			while (!chunk.done)
+				m_chunkDone.wait(&m_mutex);
+		}
+
+		if (ok && outFile.write(chunk.output) != chunk.output.size())
+		{
+			out << "Can't write to PGN file " << m_outFileName << endl;
+			ok = false;
+		}
+		games += chunk.games;
+		matches += chunk.matches;
+		invalidGames += chunk.invalidGames;
+		chunk.output.clear();
+
+		QMutexLocker locker(&m_mutex);
+		m_writtenChunks++;
+		m_chunkWritten.wakeAll();
+	}
+
+	waitForJobs();
+	outFile.close();
+
+	qint64 elapsed = timer.elapsed();
+	out << "Games: " << games << endl;
+	out << "Matching games: " << matches << endl;
+	out << "Invalid games: " << invalidGames << endl;
+	out << "Time: " << elapsed << " ms" << endl;
+	if (elapsed > 0)
+		out << "Games/second: " << qint64(games) * 1000 / elapsed << endl;
+
+	m_chunks.clear();
+	m_file.close();
+
+	return ok;
+}
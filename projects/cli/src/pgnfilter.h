@@ -0,0 +1,115 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PGNFILTER_H
+#define PGNFILTER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QMutex>
+#include <QWaitCondition>
+#include <pgngame.h>
+#include <pgngamefilter.h>
+#include "pgnfilebuffer.h"
+#include "workerpool.h"
+class QTextStream;
+
+/*!
+ * \brief A multithreaded filter for PGN files.
+ *
+ * PgnFilter copies the games of a PGN file that match a
+ * PgnGameFilter, a variant and a length range to a new PGN file.
+ * The games are re-serialized with PgnGame::write(), so they can be
+ * converted to the minimal PGN format or stripped of comments.
+ *
+ * The file is split into chunks at game boundaries. Worker threads
+ * parse and filter the chunks, and the main thread writes their
+ * output in the original order of the games.
+ */
+class PgnFilter : public WorkerPool
+{
+	public:
+		/*!
+		 * Creates a new PgnFilter that copies games from the PGN
+		 * file \a fileName to \a outFileName.
+		 */
+		PgnFilter(const QString& fileName, const QString& outFileName);
+		/*! Destroys the PgnFilter object. */
+		~PgnFilter();
+
+		/*! Sets the filter for the games' tags to \a filter. */
+		void setFilter(const PgnGameFilter& filter);
+		/*!
+		 * Keeps only the games of chess variant \a variant.
+		 * Games without a Variant tag are standard games.
+		 * By default games of all variants are kept.
+		 */
+		void setVariant(const QString& variant);
+		/*!
+		 * Keeps only the games that are at least \a minPlies and
+		 * at most \a maxPlies plies long. A zero value disables
+		 * that limit.
+		 */
+		void setPlyRange(int minPlies, int maxPlies);
+		/*! Sets the mode for writing the games to \a mode. */
+		void setPgnMode(PgnGame::PgnMode mode);
+		/*! If \a strip is true, the move comments are left out. */
+		void setCommentsStripped(bool strip);
+
+		/*!
+		 * Filters the games and writes the statistics to \a out.
+		 * Returns true if successful.
+		 */
+		bool run(QTextStream& out);
+
+	protected:
+		// Inherited from WorkerPool
+		virtual void runJob(int index);
+
+	private:
+		struct Chunk
+		{
+			qint64 start;
+			qint64 size;
+			int games;
+			int matches;
+			int invalidGames;
+			bool done;
+			QByteArray output;
+		};
+
+		void waitForWriter(int index);
+		void filterChunk(Chunk* chunk) const;
+		void finishChunk(Chunk* chunk);
+
+		PgnFileBuffer m_file;
+		QString m_outFileName;
+		PgnGameFilter m_filter;
+		QString m_variant;
+		int m_minPlies;
+		int m_maxPlies;
+		PgnGame::PgnMode m_mode;
+		bool m_stripComments;
+		QVector<Chunk> m_chunks;
+		int m_writtenChunks;
+		QMutex m_mutex;
+		QWaitCondition m_chunkDone;
+		QWaitCondition m_chunkWritten;
+};
+
+#endif // PGNFILTER_H
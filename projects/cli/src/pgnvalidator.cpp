@@ -0,0 +1,221 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pgnvalidator.h"
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <board/board.h>
+#include <pgnstream.h>
+
+PgnValidator::PgnValidator(const QString& fileName)
+	: m_file(fileName),
+	  m_variant("standard")
+{
+}
+
+PgnValidator::~PgnValidator()
+{
+}
+
+void PgnValidator::setVariant(const QString& variant)
+{
+	m_variant = variant;
+}
+
+void PgnValidator::runJob(int index)
+{
+	validateChunk(&m_chunks[index]);
+}
+
+void PgnValidator::validateChunk(Chunk* chunk) const
+{
+	// The chunk is read in place, without copying it
+	const QByteArray data(QByteArray::fromRawData(m_file.data() + chunk->start,
+						      int(chunk->size)));
+	PgnStream in(&data, m_variant);
+
+	while (in.nextGame())
+	{
+		chunk->games++;
+		Error error = { chunk->games, in.lineNumber(), QString() };
+
+		QString variant(m_variant);
+		QString fen;
+		QString resultTag;
+		QString resultToken;
+		Chess::Board* board = 0;
+		int ply = 0;
+		bool done = false;
+
+		while (!done && in.status() == PgnStream::Ok)
+		{
+			switch (in.readNext())
+			{
+			case PgnStream::PgnTag:
+				if (in.tagName() == "Variant")
+					variant = in.tagValue();
+				else if (in.tagName() == "FEN")
+					fen = in.tagValue();
+				else if (in.tagName() == "Result")
+					resultTag = in.tagValue();
+				break;
+			case PgnStream::PgnMove:
+				if (!error.message.isEmpty())
+					break;
+				if (board == 0)
+				{
+					board = setupBoard(&in, variant, fen, &error.message);
+					if (board == 0)
+						break;
+				}
+				{
+					const QString str(in.tokenString());
+					Chess::Move move(board->moveFromString(str));
+					if (move.isNull())
+					{
+						error.message = QString("Illegal move %1 at ply %2")
+							.arg(str).arg(ply + 1);
+						break;
+					}
+					board->makeMove(move);
+					ply++;
+				}
+				break;
+			case PgnStream::PgnResult:
+				resultToken = in.tokenString();
+				done = true;
+				break;
+			case PgnStream::NoToken:
+				done = true;
+				break;
+			default:
+				break;
+			}
+		}
+
+		if (board == 0 && error.message.isEmpty())
+			board = setupBoard(&in, variant, fen, &error.message);
+		if (error.message.isEmpty())
+		{
+			if (resultToken.isEmpty())
+				resultToken = resultTag;
+			Chess::Result result(board->result());
+
+			if (!resultTag.isEmpty() && resultToken != resultTag)
+				error.message = QString("The termination marker %1 "
+							"differs from the Result tag %2")
+					.arg(resultToken).arg(resultTag);
+			else if (!result.isNone()
+			     &&  result.toShortString() != resultToken)
+				error.message = QString("Wrong result %1, the final "
+							"position is %2")
+					.arg(resultToken)
+					.arg(result.toVerboseString());
+		}
+
+		chunk->plies += ply;
+		if (!error.message.isEmpty())
+		{
+			chunk->invalidGames++;
+			chunk->errors.append(error);
+		}
+	}
+
+	chunk->lines = data.count('\n');
+}
+
+Chess::Board* PgnValidator::setupBoard(PgnStream* in,
+				       const QString& variant,
+				       const QString& fen,
+				       QString* error)
+{
+	if (!in->setVariant(variant))
+	{
+		*error = QString("Unknown variant: %1").arg(variant);
+		return 0;
+	}
+
+	Chess::Board* board = in->board();
+	if (fen.isEmpty() && board->isRandomVariant())
+	{
+		*error = "Missing FEN tag";
+		return 0;
+	}
+	if (!board->setFenString(fen.isEmpty() ? board->defaultFenString() : fen))
+	{
+		*error = QString("Invalid FEN string: %1").arg(fen);
+		return 0;
+	}
+
+	return board;
+}
+
+bool PgnValidator::run(QTextStream& out)
+{
+	QString error;
+	if (!m_file.open(&error))
+	{
+		out << error << endl;
+		return false;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+
+	m_chunks.clear();
+	foreach (const PgnFileBuffer::Chunk& range, m_file.split(threadCount()))
+	{
+		Chunk chunk = { range.start, range.size, 0, 0, 0, 0, QList<Error>() };
+		m_chunks.append(chunk);
+	}
+
+	runJobs(m_chunks.size());
+
+	qint64 elapsed = timer.elapsed();
+
+	int games = 0;
+	int invalidGames = 0;
+	qint64 plies = 0;
+	qint64 lines = 0;
+	foreach (const Chunk& chunk, m_chunks)
+	{
+		foreach (const Error& error, chunk.errors)
+		{
+			out << "Game " << games + error.game
+			    << " (line " << lines + error.line << "): "
+			    << error.message << endl;
+		}
+		games += chunk.games;
+		invalidGames += chunk.invalidGames;
+		plies += chunk.plies;
+		lines += chunk.lines;
+	}
+
+	if (invalidGames > 0)
+		out << endl;
+	out << "Games: " << games << endl;
+	out << "Invalid games: " << invalidGames << endl;
+	out << "Plies: " << plies << endl;
+	out << "Time: " << elapsed << " ms" << endl;
+	if (elapsed > 0)
+		out << "Games/second: " << qint64(games) * 1000 / elapsed << endl;
+
+	m_chunks.clear();
+	m_file.close();
+
+	return invalidGames == 0;
+}
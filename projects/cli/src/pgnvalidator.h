@@ -0,0 +1,93 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PGNVALIDATOR_H
+#define PGNVALIDATOR_H
+
+#include <QString>
+#include <QList>
+#include <QVector>
+#include "pgnfilebuffer.h"
+#include "workerpool.h"
+class QTextStream;
+class PgnStream;
+namespace Chess { class Board; }
+
+/*!
+ * \brief A multithreaded validator for PGN archives.
+ *
+ * PgnValidator replays every game of a PGN file move by move through
+ * a Chess::Board, and reports illegal moves, invalid setups, and
+ * results that contradict the final position.
+ *
+ * The file is split into chunks at game boundaries, and the chunks
+ * are validated by worker threads, each of which has its own boards.
+ */
+class PgnValidator : public WorkerPool
+{
+	public:
+		/*! Creates a new PgnValidator for the PGN file \a fileName. */
+		PgnValidator(const QString& fileName);
+		/*! Destroys the PgnValidator object. */
+		~PgnValidator();
+
+		/*!
+		 * Sets the chess variant of the games that don't have
+		 * a Variant tag to \a variant. The default is "standard".
+		 */
+		void setVariant(const QString& variant);
+
+		/*!
+		 * Validates the games and writes the errors and statistics
+		 * to \a out. Returns true if all the games are valid.
+		 */
+		bool run(QTextStream& out);
+
+	protected:
+		// Inherited from WorkerPool
+		virtual void runJob(int index);
+
+	private:
+		struct Error
+		{
+			int game;
+			qint64 line;
+			QString message;
+		};
+		struct Chunk
+		{
+			qint64 start;
+			qint64 size;
+			int games;
+			int invalidGames;
+			qint64 plies;
+			qint64 lines;
+			QList<Error> errors;
+		};
+
+		void validateChunk(Chunk* chunk) const;
+		static Chess::Board* setupBoard(PgnStream* in,
+						const QString& variant,
+						const QString& fen,
+						QString* error);
+
+		PgnFileBuffer m_file;
+		QString m_variant;
+		QVector<Chunk> m_chunks;
+};
+
+#endif // PGNVALIDATOR_H
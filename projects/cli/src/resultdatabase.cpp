@@ -0,0 +1,250 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "resultdatabase.h"
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QTimer>
+#include <chessgame.h>
+#include <chessplayer.h>
+#include <tournament.h>
+
+// The number of pending rows that are committed right away
+static const int s_batchSize = 256;
+// The longest time in msec a row waits for its commit
+static const int s_commitDelay = 1000;
+
+static const char s_connectionName[] = "cutechess-resultdb";
+
+static const char* const s_schema[] =
+{
+	"CREATE TABLE IF NOT EXISTS games ("
+	"id INTEGER PRIMARY KEY,"
+	"event TEXT,"
+	"match_start TEXT,"
+	"number INTEGER,"
+	"finished TEXT,"
+	"white TEXT,"
+	"black TEXT,"
+	"opening INTEGER,"
+	"result TEXT,"
+	"termination TEXT,"
+	"plies INTEGER,"
+	"white_time INTEGER,"
+	"black_time INTEGER,"
+	"white_nodes INTEGER,"
+	"black_nodes INTEGER)",
+	"CREATE INDEX IF NOT EXISTS games_players ON games (white, black)",
+	"CREATE INDEX IF NOT EXISTS games_match ON games (event, match_start)",
+	0
+};
+
+static const char s_insert[] =
+	"INSERT INTO games (event, match_start, number, finished, white,"
+	" black, opening, result, termination, plies, white_time,"
+	" black_time, white_nodes, black_nodes)"
+	" VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+
+
+class ResultDatabaseWriter : public QObject
+{
+	Q_OBJECT
+
+	public:
+		ResultDatabaseWriter()
+			: m_insert(0),
+			  m_timer(0),
+			  m_failed(false)
+		{
+		}
+
+	public slots:
+		bool open(const QString& fileName)
+		{
+			QSqlDatabase db(QSqlDatabase::addDatabase("QSQLITE",
+								  s_connectionName));
+			db.setDatabaseName(fileName);
+			if (!db.open())
+			{
+				qWarning("Can't open result database %s: %s",
+					 qPrintable(fileName),
+					 qPrintable(db.lastError().text()));
+				return false;
+			}
+
+			// A crash can lose the latest batch but never
+			// corrupt the database
+			QSqlQuery query(db);
+			query.exec("PRAGMA journal_mode=WAL");
+			query.exec("PRAGMA synchronous=NORMAL");
+			for (int i = 0; s_schema[i] != 0; i++)
+			{
+				if (!query.exec(s_schema[i]))
+				{
+					qWarning("Can't create the result database "
+						 "tables: %s",
+						 qPrintable(query.lastError().text()));
+					return false;
+				}
+			}
+
+			m_insert = new QSqlQuery(db);
+			if (!m_insert->prepare(s_insert))
+			{
+				qWarning("Invalid result database %s: %s",
+					 qPrintable(fileName),
+					 qPrintable(m_insert->lastError().text()));
+				return false;
+			}
+
+			m_timer = new QTimer(this);
+			m_timer->setSingleShot(true);
+			m_timer->setInterval(s_commitDelay);
+			connect(m_timer, SIGNAL(timeout()), this, SLOT(commit()));
+			return true;
+		}
+
+		void write(const QVariantList& row)
+		{
+			if (m_insert == 0 || m_failed)
+				return;
+
+			m_pending.append(row);
+			if (m_pending.size() >= s_batchSize)
+				commit();
+			else if (!m_timer->isActive())
+				m_timer->start();
+		}
+
+		void close()
+		{
+			commit();
+			delete m_insert;
+			m_insert = 0;
+			delete m_timer;
+			m_timer = 0;
+
+			QSqlDatabase::database(s_connectionName, false).close();
+			QSqlDatabase::removeDatabase(s_connectionName);
+		}
+
+	private slots:
+		void commit()
+		{
+			if (m_timer != 0)
+				m_timer->stop();
+			if (m_pending.isEmpty() || m_insert == 0 || m_failed)
+				return;
+
+			QSqlDatabase db(QSqlDatabase::database(s_connectionName, false));
+			db.transaction();
+			foreach (const QVariantList& row, m_pending)
+			{
+				for (int i = 0; i < row.size(); i++)
+					m_insert->bindValue(i, row.at(i));
+				if (!m_insert->exec())
+				{
+					qWarning("Can't write to the result database: %s",
+						 qPrintable(m_insert->lastError().text()));
+					db.rollback();
+					m_failed = true;
+					return;
+				}
+			}
+			if (!db.commit())
+			{
+				qWarning("Can't write to the result database: %s",
+					 qPrintable(db.lastError().text()));
+				m_failed = true;
+			}
+			m_pending.clear();
+		}
+
+	private:
+		QSqlQuery* m_insert;
+		QTimer* m_timer;
+		QList<QVariantList> m_pending;
+		bool m_failed;
+};
+
+
+ResultDatabase::ResultDatabase(QObject* parent)
+	: QObject(parent),
+	  m_startTime(QDateTime::currentDateTimeUtc()),
+	  m_writer(new ResultDatabaseWriter)
+{
+	m_writer->moveToThread(&m_thread);
+}
+
+ResultDatabase::~ResultDatabase()
+{
+	if (m_thread.isRunning())
+	{
+		QMetaObject::invokeMethod(m_writer, "close",
+					  Qt::BlockingQueuedConnection);
+		m_thread.quit();
+		m_thread.wait();
+	}
+	delete m_writer;
+}
+
+bool ResultDatabase::open(const QString& fileName)
+{
+	if (!m_thread.isRunning())
+		m_thread.start();
+
+	bool ok = false;
+	QMetaObject::invokeMethod(m_writer, "open",
+				  Qt::BlockingQueuedConnection,
+				  Q_RETURN_ARG(bool, ok),
+				  Q_ARG(QString, fileName));
+	return ok;
+}
+
+void ResultDatabase::writeGame(const Tournament* tournament,
+			       const ChessGame* game,
+			       int number)
+{
+	const Chess::Result result(game->result());
+	const ChessPlayer* white = game->player(Chess::Side::White);
+	const ChessPlayer* black = game->player(Chess::Side::Black);
+
+	QVariantList row;
+	row.reserve(14);
+	row << tournament->name()
+	    << m_startTime.toString(Qt::ISODate)
+	    << number
+	    << QDateTime::currentDateTimeUtc().toString(Qt::ISODate)
+	    << white->name()
+	    << black->name()
+	    << tournament->openingNumber(number)
+	    << result.toShortString()
+	    << result.description()
+	    << game->moves().size()
+	    << white->gameTime()
+	    << black->gameTime()
+	    << qint64(white->gameNodeCount())
+	    << qint64(black->gameNodeCount());
+
+	QMetaObject::invokeMethod(m_writer, "write", Qt::QueuedConnection,
+				  Q_ARG(QVariantList, row));
+}
+
+#include "resultdatabase.moc"
@@ -0,0 +1,72 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef RESULTDATABASE_H
+#define RESULTDATABASE_H
+
+#include <QObject>
+#include <QThread>
+#include <QDateTime>
+
+class ChessGame;
+class Tournament;
+class ResultDatabaseWriter;
+
+/*!
+ * \brief An SQLite database of finished games.
+ *
+ * ResultDatabase adds a row to the "games" table for each finished
+ * game. The row holds the players, the opening number, the result
+ * and its description, the number of plies, and each side's
+ * thinking time and node count. Games of several matches can be
+ * stored in the same database; they are told apart by the event
+ * name and the time the match was started.
+ *
+ * The rows are inserted by a worker thread with a prepared
+ * statement, and they're committed in batches: when enough of them
+ * are pending, or a second after the first pending row.
+ */
+class ResultDatabase : public QObject
+{
+	Q_OBJECT
+
+	public:
+		explicit ResultDatabase(QObject* parent = 0);
+		virtual ~ResultDatabase();
+
+		/*!
+		 * Opens or creates the database \a fileName.
+		 * Returns false on failure.
+		 */
+		bool open(const QString& fileName);
+
+		/*!
+		 * Writes a row of \a game, which is game \a number of
+		 * \a tournament.
+		 */
+		void writeGame(const Tournament* tournament,
+			       const ChessGame* game,
+			       int number);
+
+	private:
+		QDateTime m_startTime;
+		QThread m_thread;
+		ResultDatabaseWriter* m_writer;
+};
+
+#endif // RESULTDATABASE_H
@@ -0,0 +1,284 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "resultstream.h"
+#include <QFile>
+#include <QTcpSocket>
+#include <chessgame.h>
+#include <chessplayer.h>
+#include <playerbuilder.h>
+#include <tournament.h>
+
+static const int s_connectTimeout = 5000;
+
+
+class ResultSink : public QObject
+{
+	Q_OBJECT
+
+	public:
+		ResultSink()
+			: m_device(0),
+			  m_socket(0),
+			  m_failed(false)
+		{
+		}
+
+	public slots:
+		bool open(const QString& target)
+		{
+			if (target.startsWith("tcp:"))
+			{
+				const int colon = target.lastIndexOf(':');
+				bool ok = false;
+				const quint16 port = target.mid(colon + 1).toUShort(&ok);
+				const QString host(target.mid(4, colon - 4));
+				if (!ok || host.isEmpty())
+				{
+					qWarning("Invalid result stream address: %s",
+						 qPrintable(target));
+					return false;
+				}
+
+				m_socket = new QTcpSocket(this);
+				m_socket->connectToHost(host, port);
+				if (!m_socket->waitForConnected(s_connectTimeout))
+				{
+					qWarning("Can't connect to %s: %s",
+						 qPrintable(target),
+						 qPrintable(m_socket->errorString()));
+					return false;
+				}
+				m_device = m_socket;
+				return true;
+			}
+
+			QFile* file = new QFile(target, this);
+			if (!file->open(QIODevice::WriteOnly | QIODevice::Append))
+			{
+				qWarning("Can't open result stream file %s: %s",
+					 qPrintable(target),
+					 qPrintable(file->errorString()));
+				return false;
+			}
+			m_device = file;
+			return true;
+		}
+
+		void write(const QByteArray& data)
+		{
+			if (m_device == 0 || m_failed)
+				return;
+
+			if (m_device->write(data) != data.size())
+			{
+				qWarning("Can't write to the result stream: %s",
+					 qPrintable(m_device->errorString()));
+				m_failed = true;
+				return;
+			}
+
+			// Records are flushed right away so that they reach
+			// the dashboard while the match is running
+			if (m_socket != 0)
+				m_socket->flush();
+			else
+				static_cast<QFile*>(m_device)->flush();
+		}
+
+		void close()
+		{
+			if (m_socket != 0
+			&&  m_socket->state() == QAbstractSocket::ConnectedState)
+			{
+				m_socket->waitForBytesWritten(s_connectTimeout);
+				m_socket->disconnectFromHost();
+			}
+			delete m_device;
+			m_device = 0;
+			m_socket = 0;
+		}
+
+	private:
+		QIODevice* m_device;
+		QTcpSocket* m_socket;
+		bool m_failed;
+};
+
+
+ResultStream::ResultStream(QObject* parent)
+	: QObject(parent),
+	  m_sink(new ResultSink)
+{
+	m_sink->moveToThread(&m_thread);
+}
+
+ResultStream::~ResultStream()
+{
+	if (m_thread.isRunning())
+	{
+		QMetaObject::invokeMethod(m_sink, "close",
+					  Qt::BlockingQueuedConnection);
+		m_thread.quit();
+		m_thread.wait();
+	}
+	delete m_sink;
+}
+
+bool ResultStream::open(const QString& target)
+{
+	if (!m_thread.isRunning())
+		m_thread.start();
+
+	bool ok = false;
+	QMetaObject::invokeMethod(m_sink, "open",
+				  Qt::BlockingQueuedConnection,
+				  Q_RETURN_ARG(bool, ok),
+				  Q_ARG(QString, target));
+	return ok;
+}
+
+void ResultStream::send()
+{
+	// A deep copy of the record is handed over to the worker thread,
+	// which leaves the writer's buffer unshared for the next record
+	const QByteArray& data = m_writer.data();
+	QMetaObject::invokeMethod(m_sink, "write", Qt::QueuedConnection,
+				  Q_ARG(QByteArray, QByteArray(data.constData(),
+							       data.size())));
+	m_writer.clear();
+}
+
+void ResultStream::writeGame(const Tournament* tournament,
+			     const ChessGame* game,
+			     int number,
+			     qint64 elapsed)
+{
+	const Chess::Result result(game->result());
+
+	m_writer.beginObject();
+	m_writer.writeName("type");
+	m_writer.writeValue("game");
+	m_writer.writeName("game");
+	m_writer.writeValue(number);
+	m_writer.writeName("time");
+	m_writer.writeValue(elapsed);
+	m_writer.writeName("white");
+	m_writer.writeValue(game->player(Chess::Side::White)->name());
+	m_writer.writeName("black");
+	m_writer.writeValue(game->player(Chess::Side::Black)->name());
+	m_writer.writeName("result");
+	m_writer.writeValue(result.toShortString());
+	m_writer.writeName("termination");
+	m_writer.writeValue(result.description());
+	m_writer.writeName("plies");
+	m_writer.writeValue(game->moves().size());
+
+	if (tournament->playerCount() == 2)
+	{
+		const Tournament::PlayerData player(tournament->playerAt(0));
+		m_writer.writeName("score");
+		m_writer.beginObject();
+		m_writer.writeName("wins");
+		m_writer.writeValue(player.wins);
+		m_writer.writeName("losses");
+		m_writer.writeValue(player.losses);
+		m_writer.writeName("draws");
+		m_writer.writeValue(player.draws);
+		m_writer.endObject();
+	}
+
+	m_writer.endObject();
+	send();
+}
+
+void ResultStream::writeSprt(const Sprt::Status& status, int gameCount)
+{
+	m_writer.beginObject();
+	m_writer.writeName("type");
+	m_writer.writeValue("sprt");
+	m_writer.writeName("games");
+	m_writer.writeValue(gameCount);
+	m_writer.writeName("llr");
+	m_writer.writeValue(status.llr);
+	m_writer.writeName("lbound");
+	m_writer.writeValue(status.lBound);
+	m_writer.writeName("ubound");
+	m_writer.writeValue(status.uBound);
+	m_writer.writeName("result");
+	switch (status.result)
+	{
+	case Sprt::AcceptH0:
+		m_writer.writeValue("H0");
+		break;
+	case Sprt::AcceptH1:
+		m_writer.writeValue("H1");
+		break;
+	default:
+		m_writer.writeNull();
+		break;
+	}
+	m_writer.endObject();
+	send();
+}
+
+void ResultStream::writeSearchStats(const Tournament* tournament)
+{
+	m_writer.beginObject();
+	m_writer.writeName("type");
+	m_writer.writeValue("search");
+	m_writer.writeName("players");
+	m_writer.beginArray();
+	for (int i = 0; i < tournament->playerCount(); i++)
+	{
+		const Tournament::PlayerData player(tournament->playerAt(i));
+		const SearchStats& stats = player.searchStats;
+
+		m_writer.beginObject();
+		m_writer.writeName("name");
+		m_writer.writeValue(player.builder->name());
+		m_writer.writeName("moves");
+		m_writer.writeValue(stats.count());
+		m_writer.writeName("nps");
+		m_writer.writeValue(qint64(stats.nps()));
+		m_writer.writeName("movetime");
+		m_writer.writeValue(player.timeUsage.moveTimes().average());
+		m_writer.writeName("depth");
+		m_writer.beginObject();
+		m_writer.writeName("opening");
+		m_writer.writeValue(stats.depth(SearchStats::Opening));
+		m_writer.writeName("middlegame");
+		m_writer.writeValue(stats.depth(SearchStats::Middlegame));
+		m_writer.writeName("endgame");
+		m_writer.writeValue(stats.depth(SearchStats::Endgame));
+		m_writer.endObject();
+		m_writer.writeName("hashfull");
+		if (stats.hashUsage() < 0)
+			m_writer.writeNull();
+		else
+			m_writer.writeValue(stats.hashUsage());
+		m_writer.writeName("tbhits");
+		m_writer.writeValue(qint64(stats.tbHits()));
+		m_writer.endObject();
+	}
+	m_writer.endArray();
+	m_writer.endObject();
+	send();
+}
+
+#include "resultstream.moc"
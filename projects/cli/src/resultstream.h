@@ -0,0 +1,78 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef RESULTSTREAM_H
+#define RESULTSTREAM_H
+
+#include <QObject>
+#include <QThread>
+#include <jsonwriter.h>
+#include <sprt.h>
+
+class ChessGame;
+class Tournament;
+class ResultSink;
+
+/*!
+ * \brief A stream of machine-readable match results.
+ *
+ * ResultStream emits one compact JSON record (JSON Lines) per finished
+ * game, per SPRT update and for the engines' search statistics at
+ * the end of the match to a file or a TCP socket, for dashboards
+ * that follow a running match. The records are built with a reusable
+ * JsonWriter buffer, and the file or socket is written by a worker
+ * thread so slow consumers never delay the game scheduling.
+ */
+class ResultStream : public QObject
+{
+	Q_OBJECT
+
+	public:
+		explicit ResultStream(QObject* parent = 0);
+		virtual ~ResultStream();
+
+		/*!
+		 * Opens the stream.
+		 *
+		 * \a target is either a file name, which is appended to,
+		 * or "tcp:HOST:PORT". Returns false on failure.
+		 */
+		bool open(const QString& target);
+
+		/*! Writes a record of \a game, which is game \a number. */
+		void writeGame(const Tournament* tournament,
+			       const ChessGame* game,
+			       int number,
+			       qint64 elapsed);
+		/*! Writes the SPRT \a status after \a gameCount games. */
+		void writeSprt(const Sprt::Status& status, int gameCount);
+		/*!
+		 * Writes a record of the search statistics of each player
+		 * in \a tournament.
+		 */
+		void writeSearchStats(const Tournament* tournament);
+
+	private:
+		void send();
+
+		JsonWriter m_writer;
+		QThread m_thread;
+		ResultSink* m_sink;
+};
+
+#endif // RESULTSTREAM_H
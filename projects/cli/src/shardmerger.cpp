@@ -0,0 +1,271 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "shardmerger.h"
+#include <cmath>
+#include <QFile>
+#include <QTextStream>
+#include <QMultiMap>
+#include <jsonparser.h>
+
+ShardMerger::ShardMerger()
+	: m_games(0),
+	  m_shardCount(0)
+{
+}
+
+QString ShardMerger::errorString() const
+{
+	return m_error;
+}
+
+bool ShardMerger::addFile(const QString& fileName)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		m_error = QString("Can't open summary file %1").arg(fileName);
+		return false;
+	}
+
+	QTextStream in(&file);
+	JsonParser parser(in);
+	const QVariantMap summary(parser.parse().toMap());
+	if (parser.hasError())
+	{
+		m_error = QString("Invalid summary file %1, line %2: %3")
+			  .arg(fileName)
+			  .arg(parser.errorLineNumber())
+			  .arg(parser.errorString());
+		return false;
+	}
+
+	if (!addSummary(summary))
+	{
+		m_error = QString("%1: %2").arg(fileName).arg(m_error);
+		return false;
+	}
+	return true;
+}
+
+bool ShardMerger::addSummary(const QVariantMap& summary)
+{
+	const QVariantList players(summary.value("players").toList());
+	if (players.size() < 2)
+	{
+		m_error = "Not enough players";
+		return false;
+	}
+
+	// The players must be the same and in the same order in every
+	// shard, because the pairs refer to them by index
+	const bool first = m_players.isEmpty();
+	if (first)
+	{
+		m_players.resize(players.size());
+		m_ratings.setPlayerCount(players.size());
+	}
+	else if (players.size() != m_players.size())
+	{
+		m_error = "The number of players doesn't match";
+		return false;
+	}
+	for (int i = 0; i < players.size(); i++)
+	{
+		const QVariantMap map(players.at(i).toMap());
+		Player& player = m_players[i];
+		if (first)
+		{
+			player.name = map.value("name").toString();
+			player.wins = 0;
+			player.draws = 0;
+			player.losses = 0;
+		}
+		else if (map.value("name").toString() != player.name)
+		{
+			m_error = QString("Player %1 is not %2")
+				  .arg(i + 1).arg(player.name);
+			return false;
+		}
+	}
+
+	foreach (const QVariant& var, summary.value("pairs").toList())
+	{
+		const QVariantList pair(var.toList());
+		if (pair.size() != 4)
+			continue;
+		const int white = pair.at(0).toInt();
+		const int black = pair.at(1).toInt();
+		const int games = pair.at(2).toInt();
+		const int halfPoints = pair.at(3).toInt();
+		if (white < 0 || white >= m_players.size()
+		||  black < 0 || black >= m_players.size()
+		||  white == black
+		||  games < 0 || halfPoints < 0 || halfPoints > games * 2)
+		{
+			m_error = "Invalid pair results";
+			return false;
+		}
+		if (games > 0)
+			m_ratings.addResults(white, black, games, halfPoints);
+	}
+
+	for (int i = 0; i < players.size(); i++)
+	{
+		const QVariantMap map(players.at(i).toMap());
+		m_players[i].wins += map.value("wins").toInt();
+		m_players[i].draws += map.value("draws").toInt();
+		m_players[i].losses += map.value("losses").toInt();
+	}
+	m_games += summary.value("games").toInt();
+
+	const QVariantList ptnml(summary.value("ptnml").toList());
+	if (ptnml.size() == 5)
+	{
+		m_ptnml.resize(5);
+		for (int i = 0; i < 5; i++)
+			m_ptnml[i] += ptnml.at(i).toInt();
+	}
+
+	// A merged summary has no shard number of its own
+	if (summary.contains("shard"))
+	{
+		const int shard = summary.value("shard").toInt();
+		m_shardCount = qMax(m_shardCount,
+				    summary.value("shards").toInt());
+		if (m_shards.contains(shard))
+			m_duplicates.append(shard);
+		m_shards.insert(shard);
+	}
+
+	return true;
+}
+
+QVariantMap ShardMerger::summary() const
+{
+	QVariantMap summary;
+	summary["shards"] = m_shardCount;
+	summary["games"] = m_games;
+
+	QVariantList players;
+	foreach (const Player& player, m_players)
+	{
+		QVariantMap map;
+		map["name"] = player.name;
+		map["wins"] = player.wins;
+		map["draws"] = player.draws;
+		map["losses"] = player.losses;
+		players << map;
+	}
+	summary["players"] = players;
+
+	QVariantList pairs;
+	foreach (const RatingSolver::Results& results, m_ratings.results())
+	{
+		QVariantList pair;
+		pair << results.first << results.second
+		     << results.games << results.halfPoints;
+		pairs << QVariant(pair);
+	}
+	summary["pairs"] = pairs;
+
+	if (!m_ptnml.isEmpty())
+	{
+		QVariantList ptnml;
+		foreach (int count, m_ptnml)
+			ptnml << count;
+		summary["ptnml"] = ptnml;
+	}
+
+	return summary;
+}
+
+void ShardMerger::print(QTextStream& out)
+{
+	QStringList missing;
+	for (int i = 1; i <= m_shardCount; i++)
+	{
+		if (!m_shards.contains(i))
+			missing << QString::number(i);
+	}
+	if (!missing.isEmpty())
+		out << "Missing shards: " << missing.join(", ") << "\n";
+	foreach (int shard, m_duplicates)
+		out << "Shard " << shard << " was merged more than once\n";
+
+	out << "Merged " << m_games << " games\n";
+	if (m_players.size() == 2)
+	{
+		const Player& first = m_players.at(0);
+		const int total = first.wins + first.draws + first.losses;
+		if (total == 0)
+			return;
+
+		const qreal ratio = qreal(first.wins * 2 + first.draws)
+				  / qreal(total * 2);
+		out << QString("Score of %1 vs %2: %3 - %4 - %5  [%6] %7\n")
+		       .arg(first.name)
+		       .arg(m_players.at(1).name)
+		       .arg(first.wins)
+		       .arg(first.losses)
+		       .arg(first.draws)
+		       .arg(ratio, 0, 'f', 3)
+		       .arg(total);
+		if (ratio > 0.0 && ratio < 1.0)
+			out << QString("ELO difference: %1\n")
+			       .arg(-400.0 * std::log(1.0 / ratio - 1.0)
+				    / std::log(10.0), 0, 'f', 0);
+		if (!m_ptnml.isEmpty())
+			out << QString("Ptnml(0-2): %1, %2, %3, %4, %5\n")
+			       .arg(m_ptnml.at(0)).arg(m_ptnml.at(1))
+			       .arg(m_ptnml.at(2)).arg(m_ptnml.at(3))
+			       .arg(m_ptnml.at(4));
+		return;
+	}
+
+	m_ratings.solve();
+	QMultiMap<qreal, int> ranking;
+	for (int i = 0; i < m_players.size(); i++)
+	{
+		if (m_ratings.gameCount(i) > 0)
+			ranking.insert(-m_ratings.rating(i), i);
+	}
+	if (ranking.isEmpty())
+		return;
+
+	out << QString("%1 %2 %3 %4 %5 %6\n")
+	       .arg("Rank", 4).arg("Name", -25).arg("ELO", 7)
+	       .arg("+/-", 7).arg("Games", 7).arg("Score", 7);
+	int rank = 0;
+	QMultiMap<qreal, int>::const_iterator it;
+	for (it = ranking.constBegin(); it != ranking.constEnd(); ++it)
+	{
+		const Player& player = m_players.at(it.value());
+		const int games = player.wins + player.draws + player.losses;
+		const qreal score = games > 0
+			? qreal(player.wins * 2 + player.draws) / (games * 2)
+			: 0.0;
+		out << QString("%1 %2 %3 %4 %5 %6%\n")
+		       .arg(++rank, 4)
+		       .arg(player.name.left(25), -25)
+		       .arg(-it.key(), 7, 'f', 0)
+		       .arg(m_ratings.error(it.value()), 7, 'f', 0)
+		       .arg(games, 7)
+		       .arg(score * 100.0, 6, 'f', 0);
+	}
+}
@@ -0,0 +1,86 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SHARDMERGER_H
+#define SHARDMERGER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
+#include <QSet>
+#include <ratingsolver.h>
+class QTextStream;
+
+/*!
+ * \brief Adds up the result summaries of a sharded tournament.
+ *
+ * Each shard of a tournament that was split with the -shard option
+ * writes a summary of its results (see Tournament::summary()).
+ * ShardMerger adds the summaries up and prints the standings of the
+ * complete tournament. The combined results of each pair of players
+ * are merged, so the ratings are the same as if the games had been
+ * played by a single process. The merged summary has the same format
+ * and can be merged again.
+ */
+class ShardMerger
+{
+	public:
+		/*! Creates a new empty ShardMerger object. */
+		ShardMerger();
+
+		/*!
+		 * Adds the summary in file \a fileName.
+		 *
+		 * Returns false and sets errorString() if the file can't
+		 * be read or its players don't match the previous files.
+		 */
+		bool addFile(const QString& fileName);
+		/*! Returns the last error. */
+		QString errorString() const;
+
+		/*! Returns the merged summary. */
+		QVariantMap summary() const;
+		/*!
+		 * Writes the standings to \a out. Missing and duplicate
+		 * shards are reported too.
+		 */
+		void print(QTextStream& out);
+
+	private:
+		struct Player
+		{
+			QString name;
+			int wins;
+			int draws;
+			int losses;
+		};
+
+		bool addSummary(const QVariantMap& summary);
+
+		QString m_error;
+		int m_games;
+		int m_shardCount;
+		QSet<int> m_shards;
+		QList<int> m_duplicates;
+		QVector<Player> m_players;
+		RatingSolver m_ratings;
+		QVector<int> m_ptnml;
+};
+
+#endif // SHARDMERGER_H
@@ -0,0 +1,230 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "sprtsimulator.h"
+#include <cmath>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+
+/*
+ * A small and fast pseudo-random number generator (SplitMix64).
+ *
+ * Mersenne has a single global state, which can't be shared by the
+ * worker threads, so each run gets a generator of its own.
+ */
+class SimulatorRandom
+{
+	public:
+		SimulatorRandom(quint64 seed)
+			: m_state(seed)
+		{
+		}
+
+		// Returns a uniformly distributed number in [0, 1)
+		double next()
+		{
+			quint64 z = (m_state += Q_UINT64_C(0x9E3779B97F4A7C15));
+			z = (z ^ (z >> 30)) * Q_UINT64_C(0xBF58476D1CE4E5B9);
+			z = (z ^ (z >> 27)) * Q_UINT64_C(0x94D049BB133111EB);
+			z ^= z >> 31;
+			return double(z >> 11) / double(Q_UINT64_C(1) << 53);
+		}
+
+	private:
+		quint64 m_state;
+};
+
+
+static double bayesWinProbability(double bayesElo, double drawElo)
+{
+	return 1.0 / (1.0 + std::pow(10.0, (drawElo - bayesElo) / 400.0));
+}
+
+static double bayesScore(double bayesElo, double drawElo)
+{
+	const double pWin = bayesWinProbability(bayesElo, drawElo);
+	const double pLoss = bayesWinProbability(-bayesElo, drawElo);
+	return (1.0 + pWin - pLoss) / 2.0;
+}
+
+SprtSimulator::SprtSimulator(const Sprt& sprt)
+	: m_sprt(sprt),
+	  m_trueElo(0.0),
+	  m_drawElo(200.0),
+	  m_runCount(1000),
+	  m_maxGames(0),
+	  m_seed(1),
+	  m_pWin(0.0),
+	  m_pLoss(0.0)
+{
+	Q_ASSERT(!sprt.isNull());
+}
+
+void SprtSimulator::setTrueElo(double elo)
+{
+	m_trueElo = elo;
+}
+
+void SprtSimulator::setDrawElo(double drawElo)
+{
+	Q_ASSERT(drawElo >= 0.0);
+	m_drawElo = drawElo;
+}
+
+void SprtSimulator::setRunCount(int count)
+{
+	Q_ASSERT(count > 0);
+	m_runCount = count;
+}
+
+void SprtSimulator::setMaxGames(int count)
+{
+	Q_ASSERT(count >= 0);
+	m_maxGames = count;
+}
+
+void SprtSimulator::setSeed(quint32 seed)
+{
+	m_seed = seed;
+}
+
+void SprtSimulator::runJob(int index)
+{
+	RunResult result(simulate(index));
+
+	QMutexLocker locker(&m_mutex);
+	m_results[index] = result;
+}
+
+SprtSimulator::RunResult SprtSimulator::simulate(int index) const
+{
+	SimulatorRandom random((quint64(m_seed) << 32) | quint32(index));
+	Sprt sprt(m_sprt);
+	const bool pairs = (sprt.model() == Sprt::Pentanomial);
+	Sprt::GameResult first = Sprt::NoResult;
+
+	RunResult result = { 0, Sprt::Continue };
+	while (m_maxGames == 0 || result.games < m_maxGames)
+	{
+		const double x = random.next();
+		Sprt::GameResult game = Sprt::Draw;
+		if (x < m_pWin)
+			game = Sprt::Win;
+		else if (x < m_pWin + m_pLoss)
+			game = Sprt::Loss;
+
+		result.games++;
+		sprt.addGameResult(game);
+		if (pairs)
+		{
+			if (result.games % 2 == 0)
+				sprt.addGamePairResult(first, game);
+			else
+				first = game;
+		}
+
+		result.result = sprt.status().result;
+		if (result.result != Sprt::Continue)
+			break;
+	}
+
+	return result;
+}
+
+void SprtSimulator::run(QTextStream& out)
+{
+	// The BayesElo difference with the same expected score as
+	// the true logistic ELO difference
+	const double score = 1.0 / (1.0 + std::pow(10.0, -m_trueElo / 400.0));
+	double low = -2000.0;
+	double high = 2000.0;
+	for (int i = 0; i < 100; i++)
+	{
+		const double mid = (low + high) / 2.0;
+		if (bayesScore(mid, m_drawElo) < score)
+			low = mid;
+		else
+			high = mid;
+	}
+	const double bayesElo = (low + high) / 2.0;
+	m_pWin = bayesWinProbability(bayesElo, m_drawElo);
+	m_pLoss = bayesWinProbability(-bayesElo, m_drawElo);
+
+	m_results.fill(RunResult(), m_runCount);
+
+	QElapsedTimer timer;
+	timer.start();
+
+	runJobs(m_runCount);
+
+	const qint64 elapsed = timer.elapsed();
+
+	int accepted[3] = { 0, 0, 0 };
+	QVector<int> games(m_runCount);
+	double sum = 0.0;
+	double sumSquares = 0.0;
+	for (int i = 0; i < m_runCount; i++)
+	{
+		const RunResult& result = m_results.at(i);
+		accepted[result.result]++;
+		games[i] = result.games;
+		sum += result.games;
+		sumSquares += double(result.games) * result.games;
+	}
+	qSort(games);
+
+	const double mean = sum / m_runCount;
+	const double stdDev = std::sqrt(qMax(0.0, sumSquares / m_runCount - mean * mean));
+
+	out.setRealNumberNotation(QTextStream::FixedNotation);
+	out.setRealNumberPrecision(1);
+	out << "Win/draw/loss probabilities: " << m_pWin * 100.0 << "% / "
+	    << (1.0 - m_pWin - m_pLoss) * 100.0 << "% / "
+	    << m_pLoss * 100.0 << "%" << endl;
+	out << "Runs: " << m_runCount << endl;
+
+	const char* labels[3] = { "Unfinished", "H0 accepted", "H1 accepted" };
+	const Sprt::Result order[3] = { Sprt::AcceptH1, Sprt::AcceptH0, Sprt::Continue };
+	for (int i = 0; i < 3; i++)
+	{
+		const int count = accepted[order[i]];
+		if (order[i] == Sprt::Continue && count == 0)
+			continue;
+
+		// Half-width of the 95% confidence interval
+		const double p = double(count) / m_runCount;
+		const double error = 1.96 * std::sqrt(p * (1.0 - p) / m_runCount);
+		out << labels[order[i]] << ": " << count << " ("
+		    << p * 100.0 << "% +/- " << error * 100.0 << "%)" << endl;
+	}
+
+	out << "Games: " << mean << " average, " << stdDev
+	    << " standard deviation" << endl;
+	const int percentiles[] = { 5, 25, 50, 75, 95 };
+	out << "Percentiles:";
+	for (int i = 0; i < 5; i++)
+	{
+		const int index = qMin(m_runCount - 1,
+				       percentiles[i] * m_runCount / 100);
+		out << ' ' << percentiles[i] << "%=" << games.at(index);
+	}
+	out << " max=" << games.last() << endl;
+	out << "Time: " << elapsed << " ms" << endl;
+}
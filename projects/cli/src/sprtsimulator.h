@@ -0,0 +1,101 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SPRTSIMULATOR_H
+#define SPRTSIMULATOR_H
+
+#include <QVector>
+#include <QMutex>
+#include <sprt.h>
+#include "workerpool.h"
+class QTextStream;
+
+/*!
+ * \brief A Monte Carlo simulator for the cost of an SPRT.
+ *
+ * SprtSimulator plays many simulated matches between two players
+ * whose true strength difference is known, and stops each one when
+ * a copy of the given Sprt accepts H0 or H1. The distribution of the
+ * match lengths and the probability of accepting H1 show how much a
+ * test with the same bounds would cost, before any real games are
+ * played.
+ *
+ * The game results are drawn from the BayesElo model with the given
+ * draw ELO, scaled so that the expected score matches the true
+ * logistic ELO difference. Pentanomial tests are played as game
+ * pairs, just like Tournament does with repeated openings.
+ *
+ * The runs are distributed between worker threads. Each run has its
+ * own random number generator seeded from the run number, so the
+ * results don't depend on the number of threads.
+ */
+class SprtSimulator : public WorkerPool
+{
+	public:
+		/*!
+		 * Creates a new simulator for copies of \a sprt, which
+		 * must be initialized.
+		 */
+		SprtSimulator(const Sprt& sprt);
+
+		/*!
+		 * Sets the true logistic ELO difference between the
+		 * players to \a elo. The default is 0.
+		 */
+		void setTrueElo(double elo);
+		/*! Sets the draw ELO to \a drawElo. The default is 200. */
+		void setDrawElo(double drawElo);
+		/*! Sets the number of simulated matches to \a count. */
+		void setRunCount(int count);
+		/*!
+		 * Stops a run after \a count games if the test hasn't
+		 * finished. A value of 0 (the default) sets no limit.
+		 */
+		void setMaxGames(int count);
+		/*! Sets the seed of the random number generators. */
+		void setSeed(quint32 seed);
+
+		/*! Runs the simulation and writes the results to \a out. */
+		void run(QTextStream& out);
+
+	protected:
+		// Inherited from WorkerPool
+		virtual void runJob(int index);
+
+	private:
+		struct RunResult
+		{
+			int games;
+			Sprt::Result result;
+		};
+
+		RunResult simulate(int index) const;
+
+		Sprt m_sprt;
+		double m_trueElo;
+		double m_drawElo;
+		int m_runCount;
+		int m_maxGames;
+		quint32 m_seed;
+		double m_pWin;
+		double m_pLoss;
+		QVector<RunResult> m_results;
+		QMutex m_mutex;
+};
+
+#endif // SPRTSIMULATOR_H
@@ -1,8 +1,51 @@
 DEPENDPATH += $$PWD
 HEADERS += $$PWD/enginematch.h \
+    $$PWD/bookmaker.h \
+    $$PWD/broadcastserver.h \
     $$PWD/cutechesscoreapp.h \
-    $$PWD/matchparser.h
+    $$PWD/endgamegenerator.h \
+    $$PWD/engineprofiler.h \
+    $$PWD/epdtest.h \
+    $$PWD/jobserver.h \
+    $$PWD/matchparser.h \
+    $$PWD/matchrunner.h \
+    $$PWD/metricsserver.h \
+    $$PWD/openingbalancer.h \
+    $$PWD/perft.h \
+    $$PWD/pgnfilebuffer.h \
+    $$PWD/pgnfilter.h \
+    $$PWD/pgnvalidator.h \
+    $$PWD/resultdatabase.h \
+    $$PWD/resultstream.h \
+    $$PWD/shardmerger.h \
+    $$PWD/sprtsimulator.h \
+    $$PWD/startuptimer.h \
+    $$PWD/suitededuplicator.h \
+    $$PWD/tbscanner.h \
+    $$PWD/workerpool.h
 SOURCES += $$PWD/main.cpp \
+    $$PWD/allocationhooks.cpp \
+    $$PWD/bookmaker.cpp \
+    $$PWD/broadcastserver.cpp \
     $$PWD/cutechesscoreapp.cpp \
     $$PWD/enginematch.cpp \
-    $$PWD/matchparser.cpp
+    $$PWD/endgamegenerator.cpp \
+    $$PWD/engineprofiler.cpp \
+    $$PWD/epdtest.cpp \
+    $$PWD/jobserver.cpp \
+    $$PWD/matchparser.cpp \
+    $$PWD/matchrunner.cpp \
+    $$PWD/metricsserver.cpp \
+    $$PWD/openingbalancer.cpp \
+    $$PWD/perft.cpp \
+    $$PWD/pgnfilebuffer.cpp \
+    $$PWD/pgnfilter.cpp \
+    $$PWD/pgnvalidator.cpp \
+    $$PWD/resultdatabase.cpp \
+    $$PWD/resultstream.cpp \
+    $$PWD/shardmerger.cpp \
+    $$PWD/sprtsimulator.cpp \
+    $$PWD/startuptimer.cpp \
+    $$PWD/suitededuplicator.cpp \
+    $$PWD/tbscanner.cpp \
+    $$PWD/workerpool.cpp
@@ -0,0 +1,77 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "startuptimer.h"
+#include <QElapsedTimer>
+#include <QList>
+#include <QPair>
+
+static bool s_enabled = false;
+static QElapsedTimer s_clock;
+static QList< QPair<QByteArray, qint64> > s_phases;
+
+
+StartupTimer::StartupTimer(const char* phase)
+	: m_start(-1)
+{
+	if (s_enabled)
+	{
+		m_phase = phase;
+		m_start = s_clock.elapsed();
+	}
+}
+
+StartupTimer::~StartupTimer()
+{
+	stop();
+}
+
+void StartupTimer::stop()
+{
+	if (m_start < 0)
+		return;
+
+	s_phases.append(qMakePair(m_phase, s_clock.elapsed() - m_start));
+	m_start = -1;
+}
+
+void StartupTimer::enable()
+{
+	s_enabled = true;
+	s_clock.start();
+}
+
+bool StartupTimer::isEnabled()
+{
+	return s_enabled;
+}
+
+void StartupTimer::print()
+{
+	if (!s_enabled)
+		return;
+
+	qDebug("%-25.25s %7s", "Startup phase", "Time ms");
+	for (int i = 0; i < s_phases.size(); i++)
+		qDebug("%-25.25s %7lld",
+		       s_phases.at(i).first.constData(),
+		       s_phases.at(i).second);
+	qDebug("%-25.25s %7lld", "total", s_clock.elapsed());
+
+	s_phases.clear();
+}
@@ -0,0 +1,59 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef STARTUPTIMER_H
+#define STARTUPTIMER_H
+
+#include <QByteArray>
+
+/*!
+ * \brief Measures the duration of a startup phase.
+ *
+ * A StartupTimer measures the time from its construction to its
+ * destruction, and records it under the phase's name if startup
+ * timing is enabled. When it's disabled, the timers cost nothing.
+ */
+class StartupTimer
+{
+	public:
+		/*! Starts timing the phase \a phase. */
+		explicit StartupTimer(const char* phase);
+		/*! Records the phase's duration unless stop() was called. */
+		~StartupTimer();
+
+		/*! Records the phase's duration now. */
+		void stop();
+
+		/*! Enables startup timing and starts the total clock. */
+		static void enable();
+		/*! Returns true if startup timing is enabled. */
+		static bool isEnabled();
+		/*!
+		 * Prints the recorded phases and the total time since
+		 * enable() was called. Each phase is printed only once.
+		 */
+		static void print();
+
+	private:
+		Q_DISABLE_COPY(StartupTimer)
+
+		QByteArray m_phase;
+		qint64 m_start;
+};
+
+#endif // STARTUPTIMER_H
@@ -0,0 +1,273 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "suitededuplicator.h"
+#include <climits>
+#include <cstring>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSet>
+#include <board/board.h>
+#include <board/boardfactory.h>
+#include <pgnstream.h>
+#include <pgngame.h>
+#include <epdrecord.h>
+
+
+SuiteDeduplicator::SuiteDeduplicator(const QString& fileName,
+				     OpeningSuite::Format format)
+	: m_file(fileName),
+	  m_format(format),
+	  m_depth(INT_MAX - 1),
+	  m_variant("standard")
+{
+}
+
+SuiteDeduplicator::~SuiteDeduplicator()
+{
+}
+
+void SuiteDeduplicator::setDepth(int plies)
+{
+	Q_ASSERT(plies > 0);
+	m_depth = plies;
+}
+
+void SuiteDeduplicator::setVariant(const QString& variant)
+{
+	m_variant = variant;
+}
+
+void SuiteDeduplicator::runJob(int index)
+{
+	// The board is reused for all the openings of the same variant
+	readChunk(&m_chunks[index], &m_boards[workerIndex()]);
+}
+
+Chess::Board* SuiteDeduplicator::setupBoard(Chess::Board** board,
+					    const QString& variant)
+{
+	if (*board != 0 && (*board)->variant() != variant)
+	{
+		Chess::BoardFactory::release(*board);
+		*board = 0;
+	}
+	if (*board == 0)
+		*board = Chess::BoardFactory::create(variant);
+
+	return *board;
+}
+
+void SuiteDeduplicator::readChunk(Chunk* chunk, Chess::Board** board) const
+{
+	// The chunk is read in place, without copying it
+	const QByteArray data(QByteArray::fromRawData(m_file.data() + chunk->start,
+						      int(chunk->size)));
+	if (m_format == OpeningSuite::PgnFormat)
+		readPgnChunk(chunk, data, board);
+	else
+		readEpdChunk(chunk, data, board);
+}
+
+void SuiteDeduplicator::readPgnChunk(Chunk* chunk,
+				     const QByteArray& data,
+				     Chess::Board** board) const
+{
+	PgnStream in(&data, m_variant);
+	PgnGame game;
+
+	// An opening lasts until the next one starts, so that the text
+	// between the games is kept with the openings
+	while (in.nextGame())
+	{
+		Opening opening = { chunk->start + in.pos(), 0, 0, false };
+		if (!chunk->openings.isEmpty())
+		{
+			Opening& last = chunk->openings.last();
+			last.size = opening.start - last.start;
+		}
+
+		if (game.read(in, m_depth))
+		{
+			QString variant(game.tagValue("Variant"));
+			if (variant.isEmpty())
+				variant = m_variant;
+			Chess::Board* b = setupBoard(board, variant);
+
+			QString fen(game.startingFenString());
+			if (b != 0 && fen.isEmpty() && !b->isRandomVariant())
+				fen = b->defaultFenString();
+			opening.isValid = b != 0 && b->setFenString(fen);
+
+			foreach (const PgnGame::MoveData& md, game.moves())
+			{
+				if (!opening.isValid)
+					break;
+
+				Chess::Move move(b->moveFromGenericMove(md.move));
+				opening.isValid = b->isLegalMove(move);
+				if (opening.isValid)
+					b->makeMove(move);
+			}
+			if (opening.isValid)
+				opening.key = b->key();
+		}
+
+		chunk->openings.append(opening);
+	}
+
+	if (!chunk->openings.isEmpty())
+	{
+		Opening& last = chunk->openings.last();
+		last.size = chunk->start + chunk->size - last.start;
+	}
+}
+
+void SuiteDeduplicator::readEpdChunk(Chunk* chunk,
+				     const QByteArray& data,
+				     Chess::Board** board) const
+{
+	const char* begin = data.constData();
+	qint64 size = data.size();
+	qint64 pos = 0;
+
+	while (pos < size)
+	{
+		const char* p = (const char*)memchr(begin + pos, '\n', size - pos);
+		qint64 end = (p != 0) ? p - begin + 1 : size;
+		QString line(QString::fromLatin1(begin + pos, int(end - pos)));
+
+		if (!line.trimmed().isEmpty())
+		{
+			Opening opening = { chunk->start + pos, end - pos, 0, false };
+			QTextStream stream(&line, QIODevice::ReadOnly);
+			EpdRecord epd;
+			Chess::Board* b = setupBoard(board, m_variant);
+
+			opening.isValid = b != 0
+				       && epd.parse(stream)
+				       && b->setFenString(epd.fen());
+			if (opening.isValid)
+				opening.key = b->key();
+			chunk->openings.append(opening);
+		}
+		pos = end;
+	}
+}
+
+bool SuiteDeduplicator::run(const QString& outFileName, QTextStream& out)
+{
+	if (QFileInfo(outFileName).canonicalFilePath()
+	==  QFileInfo(m_file.fileName()).canonicalFilePath())
+	{
+		out << "The output file can't be the opening suite" << endl;
+		return false;
+	}
+
+	QString error;
+	if (!m_file.open(&error))
+	{
+		out << error << endl;
+		return false;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+
+	PgnFileBuffer::Boundary boundary = PgnFileBuffer::GameBoundary;
+	if (m_format == OpeningSuite::EpdFormat)
+		boundary = PgnFileBuffer::LineBoundary;
+
+	m_chunks.clear();
+	foreach (const PgnFileBuffer::Chunk& range,
+		 m_file.split(threadCount(), boundary))
+	{
+		Chunk chunk = { range.start, range.size, QVector<Opening>() };
+		m_chunks.append(chunk);
+	}
+
+	m_boards.fill(0, threadCount());
+	runJobs(m_chunks.size());
+	foreach (Chess::Board* board, m_boards)
+	{
+		if (board != 0)
+			Chess::BoardFactory::release(board);
+	}
+	m_boards.clear();
+
+	QFile file(outFileName);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		out << "Can't open output file " << outFileName << endl;
+		m_chunks.clear();
+		m_file.close();
+		return false;
+	}
+
+	// The first opening that reaches a position is kept
+	QSet<quint64> keys;
+	int openings = 0;
+	int invalidOpenings = 0;
+	int duplicates = 0;
+	foreach (const Chunk& chunk, m_chunks)
+	{
+		foreach (const Opening& opening, chunk.openings)
+		{
+			openings++;
+			if (!opening.isValid)
+			{
+				invalidOpenings++;
+				continue;
+			}
+			if (keys.contains(opening.key))
+			{
+				duplicates++;
+				continue;
+			}
+			keys.insert(opening.key);
+
+			const char* text = m_file.data() + opening.start;
+			file.write(text, opening.size);
+			if (opening.size > 0 && text[opening.size - 1] != '\n')
+				file.write("\n");
+		}
+	}
+
+	m_chunks.clear();
+	m_file.close();
+	file.close();
+	if (file.error() != QFile::NoError)
+	{
+		out << "Can't write output file " << outFileName << endl;
+		return false;
+	}
+
+	OpeningSuite suite(outFileName, m_format, OpeningSuite::RandomOrder);
+	if (!suite.initialize())
+		return false;
+
+	qint64 elapsed = timer.elapsed();
+	out << "Openings: " << openings << endl;
+	out << "Duplicates: " << duplicates << endl;
+	out << "Invalid openings: " << invalidOpenings << endl;
+	out << "Unique openings: " << keys.size() << endl;
+	out << "Time: " << elapsed << " ms" << endl;
+
+	return true;
+}
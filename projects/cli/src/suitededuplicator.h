@@ -0,0 +1,112 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SUITEDEDUPLICATOR_H
+#define SUITEDEDUPLICATOR_H
+
+#include <QString>
+#include <QVector>
+#include <openingsuite.h>
+#include "pgnfilebuffer.h"
+#include "workerpool.h"
+class QTextStream;
+class PgnGame;
+namespace Chess { class Board; }
+
+/*!
+ * \brief A multithreaded duplicate remover for opening suites.
+ *
+ * SuiteDeduplicator replays every opening of an EPD or PGN suite,
+ * and writes the openings whose final positions haven't been reached
+ * by an earlier opening to a new suite. Transpositions are detected
+ * by comparing the Zobrist keys of the final positions. Openings that
+ * can't be replayed are dropped too.
+ *
+ * The suite is split into chunks that are replayed by worker
+ * threads. The openings are kept in their original order and text.
+ */
+class SuiteDeduplicator : public WorkerPool
+{
+	public:
+		/*!
+		 * Creates a new SuiteDeduplicator for the opening suite
+		 * \a fileName in \a format format.
+		 */
+		SuiteDeduplicator(const QString& fileName,
+				  OpeningSuite::Format format);
+		/*! Destroys the SuiteDeduplicator object. */
+		~SuiteDeduplicator();
+
+		/*!
+		 * Sets the opening depth to \a plies. The positions after
+		 * \a plies plies are compared. By default the depth is
+		 * unlimited.
+		 */
+		void setDepth(int plies);
+		/*!
+		 * Sets the chess variant of the openings that don't have
+		 * a Variant tag to \a variant. The default is "standard".
+		 */
+		void setVariant(const QString& variant);
+
+		/*!
+		 * Writes the unique openings to \a outFileName and writes
+		 * statistics to \a out. The new suite is initialized in
+		 * random order, which writes its index file if the suite
+		 * is too big to be preloaded. Returns true if successful.
+		 */
+		bool run(const QString& outFileName, QTextStream& out);
+
+	protected:
+		// Inherited from WorkerPool
+		virtual void runJob(int index);
+
+	private:
+		struct Opening
+		{
+			qint64 start;
+			qint64 size;
+			quint64 key;
+			bool isValid;
+		};
+		struct Chunk
+		{
+			qint64 start;
+			qint64 size;
+			QVector<Opening> openings;
+		};
+
+		void readChunk(Chunk* chunk, Chess::Board** board) const;
+		void readPgnChunk(Chunk* chunk,
+				  const QByteArray& data,
+				  Chess::Board** board) const;
+		void readEpdChunk(Chunk* chunk,
+				  const QByteArray& data,
+				  Chess::Board** board) const;
+		static Chess::Board* setupBoard(Chess::Board** board,
+						const QString& variant);
+
+		PgnFileBuffer m_file;
+		OpeningSuite::Format m_format;
+		int m_depth;
+		QString m_variant;
+		QVector<Chunk> m_chunks;
+		QVector<Chess::Board*> m_boards;
+};
+
+#endif // SUITEDEDUPLICATOR_H
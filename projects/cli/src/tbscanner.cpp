@@ -0,0 +1,230 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "tbscanner.h"
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <board/board.h>
+#include <pgnstream.h>
+#include <pgngame.h>
+
+TbScanner::TbScanner(const QString& fileName)
+	: m_file(fileName),
+	  m_writeGames(false)
+{
+}
+
+TbScanner::~TbScanner()
+{
+}
+
+void TbScanner::runJob(int index)
+{
+	scanChunk(&m_chunks[index]);
+}
+
+int TbScanner::moveTime(const QString& comment)
+{
+	// The time is the last token like "1.4s", eg. "+0.12/14 1.4s"
+	QStringList tokens(comment.split(' ', QString::SkipEmptyParts));
+	for (int i = tokens.size() - 1; i >= 0; i--)
+	{
+		const QString& token = tokens.at(i);
+		if (!token.endsWith('s'))
+			continue;
+
+		bool ok = false;
+		double seconds = token.left(token.size() - 1).toDouble(&ok);
+		if (ok && seconds >= 0.0)
+			return int(seconds * 1000.0 + 0.5);
+	}
+
+	return 0;
+}
+
+void TbScanner::scanChunk(Chunk* chunk) const
+{
+	// The chunk is read in place, without copying it
+	const QByteArray data(QByteArray::fromRawData(m_file.data() + chunk->start,
+						      int(chunk->size)));
+	PgnStream in(&data);
+	PgnGame game;
+
+	// Games that can't be scanned are written unchanged
+	while (in.nextGame())
+	{
+		const int start = int(in.pos());
+		chunk->games++;
+		if (!game.read(in))
+		{
+			// Continue from the next game, like -validate does
+			chunk->invalidGames++;
+			int end = data.indexOf("\n[Event ", start + 1);
+			end = (end == -1) ? data.size() : end + 1;
+			if (m_writeGames)
+			{
+				chunk->output.append(data.constData() + start, end - start);
+				while (!chunk->output.endsWith("\n\n"))
+					chunk->output.append('\n');
+			}
+			if (end >= data.size() || !in.seek(end))
+				break;
+			continue;
+		}
+
+		Chess::Board* board = game.createBoard();
+		if (board == 0)
+		{
+			chunk->invalidGames++;
+			if (m_writeGames)
+				game.write(chunk->output, PgnGame::Verbose);
+			continue;
+		}
+
+		// Probe the starting position and the position after
+		// each move until the tablebases have a result
+		const QVector<PgnGame::MoveData>& moves = game.moves();
+		Chess::Result tbResult(board->tablebaseResult());
+		int ply = 0;
+		while (tbResult.isNone() && ply < moves.size())
+		{
+			Chess::Move move(board->moveFromGenericMove(moves.at(ply).move));
+			if (move.isNull())
+				break;
+			board->makeMove(move);
+			ply++;
+			tbResult = board->tablebaseResult();
+		}
+		delete board;
+		chunk->plies += moves.size();
+
+		if (!tbResult.isNone())
+		{
+			chunk->decidedGames++;
+			chunk->savedPlies += moves.size() - ply;
+			for (int i = ply; i < moves.size(); i++)
+				chunk->savedTime += moveTime(moves.at(i).comment);
+
+			Chess::Result result(game.result());
+			Finding finding = { chunk->games, ply, moves.size(),
+					    tbResult.toShortString(),
+					    result.toShortString() };
+			if (!result.isNone()
+			&&  result.toShortString() != finding.tbResult)
+				chunk->wrongResults++;
+			chunk->findings.append(finding);
+
+			if (m_writeGames)
+			{
+				game.truncateMoves(ply);
+				game.setResult(tbResult);
+				game.setResultDescription(tbResult.description());
+			}
+		}
+
+		if (m_writeGames)
+			game.write(chunk->output, PgnGame::Verbose);
+	}
+}
+
+bool TbScanner::run(const QString& outFileName, QTextStream& out)
+{
+	QString error;
+	if (!m_file.open(&error))
+	{
+		out << error << endl;
+		return false;
+	}
+
+	QFile outFile(outFileName);
+	m_writeGames = !outFileName.isEmpty();
+	if (m_writeGames && !outFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		out << "Can't open output file " << outFileName << endl;
+		m_file.close();
+		return false;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+
+	m_chunks.clear();
+	foreach (const PgnFileBuffer::Chunk& range, m_file.split(threadCount()))
+	{
+		Chunk chunk = { range.start, range.size, 0, 0, 0, 0, 0, 0, 0,
+				QList<Finding>(), QByteArray() };
+		m_chunks.append(chunk);
+	}
+
+	runJobs(m_chunks.size());
+
+	qint64 elapsed = timer.elapsed();
+
+	int games = 0;
+	int invalidGames = 0;
+	int decidedGames = 0;
+	int wrongResults = 0;
+	qint64 plies = 0;
+	qint64 savedPlies = 0;
+	qint64 savedTime = 0;
+	bool ok = true;
+	foreach (const Chunk& chunk, m_chunks)
+	{
+		foreach (const Finding& finding, chunk.findings)
+		{
+			out << "Game " << games + finding.game
+			    << ": " << finding.tbResult
+			    << " at ply " << finding.ply
+			    << " of " << finding.plies;
+			if (finding.result != "*" && finding.result != finding.tbResult)
+				out << ", wrong result " << finding.result;
+			out << endl;
+		}
+		games += chunk.games;
+		invalidGames += chunk.invalidGames;
+		decidedGames += chunk.decidedGames;
+		wrongResults += chunk.wrongResults;
+		plies += chunk.plies;
+		savedPlies += chunk.savedPlies;
+		savedTime += chunk.savedTime;
+
+		if (m_writeGames && outFile.write(chunk.output) != chunk.output.size())
+			ok = false;
+	}
+	if (!ok)
+		out << "Can't write output file " << outFileName << endl;
+
+	if (decidedGames > 0)
+		out << endl;
+	out << "Games: " << games << endl;
+	if (invalidGames > 0)
+		out << "Invalid games: " << invalidGames << endl;
+	out << "Decided by tablebases: " << decidedGames << endl;
+	out << "Wrong results: " << wrongResults << endl;
+	out << "Plies saved: " << savedPlies << " of " << plies << endl;
+	out << "Engine time saved: " << savedTime / 1000 << " s" << endl;
+	out << "Time: " << elapsed << " ms" << endl;
+	if (elapsed > 0)
+		out << "Games/second: " << qint64(games) * 1000 / elapsed << endl;
+
+	m_chunks.clear();
+	m_file.close();
+
+	return ok;
+}
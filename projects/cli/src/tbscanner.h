@@ -0,0 +1,99 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef TBSCANNER_H
+#define TBSCANNER_H
+
+#include <QString>
+#include <QList>
+#include <QVector>
+#include <QByteArray>
+#include "pgnfilebuffer.h"
+#include "workerpool.h"
+class QTextStream;
+class PgnGame;
+
+/*!
+ * \brief Finds the games of a PGN archive that tablebases decide early.
+ *
+ * TbScanner replays every game of a PGN file and probes the loaded
+ * tablebases with Chess::Board::tablebaseResult() after each move.
+ * The first ply with a tablebase result is reported, together with
+ * the plies and the engine time (from the move time comments) that
+ * tablebase adjudication would have saved. Games whose result
+ * contradicts the tablebases are reported as wrong.
+ *
+ * The file is split into chunks at game boundaries, and the chunks
+ * are scanned by worker threads, like in PgnValidator.
+ */
+class TbScanner : public WorkerPool
+{
+	public:
+		/*! Creates a new TbScanner for the PGN file \a fileName. */
+		TbScanner(const QString& fileName);
+		/*! Destroys the TbScanner object. */
+		~TbScanner();
+
+
+		/*!
+		 * Scans the games and writes the findings and statistics
+		 * to \a out.
+		 *
+		 * If \a outFileName isn't empty, the games are written to
+		 * it, and the games decided by the tablebases end at the
+		 * first tablebase result. Returns true if successful.
+		 */
+		bool run(const QString& outFileName, QTextStream& out);
+
+	protected:
+		// Inherited from WorkerPool
+		virtual void runJob(int index);
+
+	private:
+		struct Finding
+		{
+			int game;
+			int ply;
+			int plies;
+			QString tbResult;
+			QString result;
+		};
+		struct Chunk
+		{
+			qint64 start;
+			qint64 size;
+			int games;
+			int invalidGames;
+			int decidedGames;
+			int wrongResults;
+			qint64 plies;
+			qint64 savedPlies;
+			qint64 savedTime;
+			QList<Finding> findings;
+			QByteArray output;
+		};
+
+		void scanChunk(Chunk* chunk) const;
+		static int moveTime(const QString& comment);
+
+		PgnFileBuffer m_file;
+		bool m_writeGames;
+		QVector<Chunk> m_chunks;
+};
+
+#endif // TBSCANNER_H
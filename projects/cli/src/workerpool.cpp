@@ -0,0 +1,128 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "workerpool.h"
+#include <QThread>
+#include <QMutexLocker>
+
+class WorkerPool::Worker : public QThread
+{
+	public:
+		Worker(WorkerPool* pool, int index);
+
+		int index() const;
+
+	protected:
+		virtual void run();
+
+	private:
+		WorkerPool* m_pool;
+		int m_index;
+};
+
+WorkerPool::Worker::Worker(WorkerPool* pool, int index)
+	: m_pool(pool),
+	  m_index(index)
+{
+}
+
+int WorkerPool::Worker::index() const
+{
+	return m_index;
+}
+
+void WorkerPool::Worker::run()
+{
+	int index;
+	while (m_pool->nextJob(&index))
+		m_pool->runJob(index);
+}
+
+
+WorkerPool::WorkerPool()
+	: m_threadCount(1),
+	  m_jobCount(0),
+	  m_nextJob(0)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+	Q_ASSERT(m_workers.isEmpty());
+}
+
+void WorkerPool::setThreadCount(int count)
+{
+	Q_ASSERT(count > 0);
+	m_threadCount = count;
+}
+
+int WorkerPool::threadCount() const
+{
+	return m_threadCount;
+}
+
+void WorkerPool::runJobs(int jobCount)
+{
+	startJobs(jobCount);
+	waitForJobs();
+}
+
+void WorkerPool::startJobs(int jobCount)
+{
+	Q_ASSERT(m_workers.isEmpty());
+
+	m_jobCount = jobCount;
+	m_nextJob = 0;
+
+	int count = qMin(m_threadCount, jobCount);
+	for (int i = 0; i < count; i++)
+	{
+		Worker* worker = new Worker(this, i);
+		m_workers.append(worker);
+		worker->start();
+	}
+}
+
+void WorkerPool::waitForJobs()
+{
+	foreach (Worker* worker, m_workers)
+	{
+		worker->wait();
+		delete worker;
+	}
+	m_workers.clear();
+}
+
+int WorkerPool::workerIndex() const
+{
+	const Worker* worker = static_cast<Worker*>(QThread::currentThread());
+	Q_ASSERT(m_workers.contains(const_cast<Worker*>(worker)));
+
+	return worker->index();
+}
+
+bool WorkerPool::nextJob(int* index)
+{
+	QMutexLocker locker(&m_mutex);
+
+	if (m_nextJob >= m_jobCount)
+		return false;
+	*index = m_nextJob++;
+	return true;
+}
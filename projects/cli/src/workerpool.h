@@ -0,0 +1,93 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <QList>
+#include <QMutex>
+
+/*!
+ * \brief A base class for tools that run their jobs on worker threads.
+ *
+ * The work is divided into jobs indexed from 0, eg. the chunks of a
+ * PGN file or the root moves of a perft test. Each worker thread takes
+ * the next job in index order until all of them are taken. Subclasses
+ * do the actual work in runJob().
+ */
+class WorkerPool
+{
+	public:
+		/*! Creates a new WorkerPool with one thread. */
+		WorkerPool();
+		/*! Destroys the pool. The jobs must be finished. */
+		virtual ~WorkerPool();
+
+		/*! Sets the number of worker threads to \a count. */
+		void setThreadCount(int count);
+		/*! Returns the number of worker threads. */
+		int threadCount() const;
+
+	protected:
+		/*!
+		 * Runs the jobs from 0 to \a jobCount - 1, and returns
+		 * when they're finished. No more threads than jobs are
+		 * started.
+		 */
+		void runJobs(int jobCount);
+		/*!
+		 * Starts running the jobs from 0 to \a jobCount - 1 and
+		 * returns immediately, so that the calling thread can use
+		 * the results of each job as soon as it's finished.
+		 *
+		 * \sa waitForJobs()
+		 */
+		void startJobs(int jobCount);
+		/*! Waits until the jobs started by startJobs() are finished. */
+		void waitForJobs();
+		/*!
+		 * Runs the job \a index.
+		 *
+		 * This function is called from the worker threads, so the
+		 * data shared by the jobs must be protected.
+		 */
+		virtual void runJob(int index) = 0;
+		/*!
+		 * Returns the index of the worker thread that runs the
+		 * current job, from 0 to threadCount() - 1.
+		 *
+		 * Jobs that run on the same worker never run at the same
+		 * time, so they can share per-worker data without locking.
+		 * Must only be called from runJob().
+		 */
+		int workerIndex() const;
+
+	private:
+		class Worker;
+		friend class Worker;
+
+		bool nextJob(int* index);
+
+		int m_threadCount;
+		int m_jobCount;
+		int m_nextJob;
+		QMutex m_mutex;
+		QList<Worker*> m_workers;
+};
+
+#endif // WORKERPOOL_H
@@ -0,0 +1,304 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "analysispanel.h"
+#include <QComboBox>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QHeaderView>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QMessageBox>
+#include <QTimer>
+#include <QStringList>
+#include <chessengine.h>
+#include <enginebuilder.h>
+#include <enginemanager.h>
+#include <board/board.h>
+#include <board/boardfactory.h>
+#include "cutechessapp.h"
+#include "engineconfigurationmodel.h"
+#include "pvconverter.h"
+
+// Minimum time between two updates of the view, in milliseconds
+static const int s_refreshInterval = 250;
+
+AnalysisPanel::AnalysisPanel(QWidget* parent)
+	: QWidget(parent),
+	  m_engineCombo(new QComboBox(this)),
+	  m_addButton(new QPushButton(tr("Add"), this)),
+	  m_removeButton(new QPushButton(tr("Remove"), this)),
+	  m_view(new QTreeWidget(this)),
+	  m_refreshTimer(new QTimer(this)),
+	  m_pvConverter(new PvConverter(this)),
+	  m_nextId(0),
+	  m_sideToMove(Chess::Side::White)
+{
+	EngineManager* manager = CuteChessApplication::instance()->engineManager();
+	m_engineCombo->setModel(new EngineConfigurationModel(manager, this));
+	m_engineCombo->setSizeAdjustPolicy(QComboBox::AdjustToContents);
+
+	m_removeButton->setEnabled(false);
+	connect(m_addButton, SIGNAL(clicked()), this, SLOT(addEngine()));
+	connect(m_removeButton, SIGNAL(clicked()), this, SLOT(removeEngine()));
+
+	m_view->setColumnCount(6);
+	m_view->setHeaderLabels(QStringList() << tr("Engine") << tr("Depth")
+				<< tr("Score") << tr("Time") << tr("Nodes")
+				<< tr("PV"));
+	m_view->setRootIsDecorated(false);
+	m_view->setUniformRowHeights(true);
+	m_view->setAlternatingRowColors(true);
+	m_view->header()->setStretchLastSection(true);
+
+	m_refreshTimer->setSingleShot(true);
+	m_refreshTimer->setInterval(s_refreshInterval);
+	connect(m_refreshTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+	connect(m_pvConverter, SIGNAL(converted(int, QString)),
+		this, SLOT(onPvConverted(int, QString)));
+
+	QHBoxLayout* controls = new QHBoxLayout();
+	controls->addWidget(m_engineCombo);
+	controls->addWidget(m_addButton);
+	controls->addWidget(m_removeButton);
+	controls->addStretch();
+
+	QVBoxLayout* layout = new QVBoxLayout();
+	layout->setContentsMargins(0, 0, 0, 0);
+	layout->addLayout(controls);
+	layout->addWidget(m_view);
+	setLayout(layout);
+}
+
+AnalysisPanel::~AnalysisPanel()
+{
+	foreach (const EngineData& data, m_engines)
+		data.engine->disconnect(this);
+}
+
+void AnalysisPanel::setPosition(const QString& variant,
+				const QString& startingFen,
+				const QVector<Chess::GenericMove>& moves)
+{
+	m_variant = variant;
+	m_startingFen = startingFen;
+	m_moves = moves;
+
+	// The board is only needed for validating the position and
+	// finding out the side to move
+	m_sideToMove = Chess::Side::White;
+	if (!startingFen.isEmpty())
+	{
+		Chess::Board* board = Chess::BoardFactory::create(variant);
+		if (board != 0 && board->setFenString(startingFen))
+		{
+			foreach (const Chess::GenericMove& genericMove, moves)
+			{
+				Chess::Move move(board->moveFromGenericMove(genericMove));
+				if (move.isNull())
+					break;
+				board->makeMove(move);
+			}
+			m_sideToMove = board->sideToMove();
+		}
+		else
+			m_startingFen.clear();
+		delete board;
+	}
+	m_pvConverter->setPosition(m_variant, m_startingFen, m_moves);
+
+	for (int i = 0; i < m_engines.size(); i++)
+	{
+		EngineData& data = m_engines[i];
+		data.eval.clear();
+		data.updated = true;
+
+		if (m_startingFen.isEmpty())
+			data.engine->endAnalysis();
+		else
+			data.engine->analyze(m_variant, m_startingFen, m_moves);
+	}
+	refresh();
+}
+
+void AnalysisPanel::addEngine()
+{
+	int index = m_engineCombo->currentIndex();
+	if (index == -1)
+		return;
+
+	EngineManager* manager = CuteChessApplication::instance()->engineManager();
+	EngineBuilder builder(manager->engineAt(index));
+	QString error;
+	ChessEngine* engine = qobject_cast<ChessEngine*>(
+		builder.create(0, 0, this, &error));
+	if (engine == 0)
+	{
+		QMessageBox::critical(this, tr("Engine Error"), error);
+		return;
+	}
+
+	connect(engine, SIGNAL(analysisUpdated(MoveEvaluation)),
+		this, SLOT(onAnalysisUpdated(MoveEvaluation)));
+	connect(engine, SIGNAL(disconnected()),
+		this, SLOT(onEngineDisconnected()));
+
+	EngineData data;
+	data.id = m_nextId++;
+	data.engine = engine;
+	data.item = new QTreeWidgetItem(m_view);
+	data.item->setText(0, engine->name());
+	data.updated = false;
+	m_engines.append(data);
+
+	m_removeButton->setEnabled(true);
+	if (!m_startingFen.isEmpty())
+		engine->analyze(m_variant, m_startingFen, m_moves);
+}
+
+void AnalysisPanel::removeEngine()
+{
+	QTreeWidgetItem* item = m_view->currentItem();
+	if (item == 0)
+		return;
+
+	for (int i = 0; i < m_engines.size(); i++)
+	{
+		if (m_engines.at(i).item != item)
+			continue;
+
+		ChessEngine* engine = m_engines.at(i).engine;
+		engine->disconnect(this);
+		connect(engine, SIGNAL(disconnected()),
+			engine, SLOT(deleteLater()));
+		engine->endAnalysis();
+		engine->quit();
+
+		delete item;
+		m_engines.removeAt(i);
+		break;
+	}
+
+	m_removeButton->setEnabled(!m_engines.isEmpty());
+}
+
+int AnalysisPanel::engineIndex(const QObject* engine) const
+{
+	for (int i = 0; i < m_engines.size(); i++)
+	{
+		if (m_engines.at(i).engine == engine)
+			return i;
+	}
+
+	return -1;
+}
+
+void AnalysisPanel::onAnalysisUpdated(const MoveEvaluation& eval)
+{
+	int i = engineIndex(sender());
+	if (i == -1)
+		return;
+
+	m_engines[i].eval = eval;
+	m_engines[i].updated = true;
+
+	// Engines can report dozens of lines per second, so the view is
+	// updated in batches
+	if (!m_refreshTimer->isActive())
+		m_refreshTimer->start();
+}
+
+void AnalysisPanel::onEngineDisconnected()
+{
+	int i = engineIndex(sender());
+	if (i == -1)
+		return;
+
+	EngineData data(m_engines.takeAt(i));
+	data.item->setText(5, tr("Disconnected"));
+	data.item->setDisabled(true);
+	data.engine->deleteLater();
+}
+
+void AnalysisPanel::onPvConverted(int id, const QString& pv)
+{
+	for (int i = 0; i < m_engines.size(); i++)
+	{
+		const EngineData& data = m_engines.at(i);
+		if (data.id != id)
+			continue;
+
+		// The engine may have been reset while the PV was converted
+		if (!data.eval.isEmpty())
+			data.item->setText(5, pv);
+		break;
+	}
+}
+
+void AnalysisPanel::refresh()
+{
+	for (int i = 0; i < m_engines.size(); i++)
+	{
+		EngineData& data = m_engines[i];
+		if (!data.updated)
+			continue;
+		data.updated = false;
+
+		const MoveEvaluation& eval = data.eval;
+		QTreeWidgetItem* item = data.item;
+		if (eval.isEmpty())
+		{
+			for (int j = 1; j < 6; j++)
+				item->setText(j, QString());
+			continue;
+		}
+
+		item->setText(1, QString::number(eval.depth()));
+		item->setText(2, scoreString(eval));
+		item->setText(3, QString::number(double(eval.time()) / 1000.0, 'f', 1));
+		item->setText(4, QString::number(eval.nodeCount()));
+
+		// The previous PV is shown until the new one is converted
+		m_pvConverter->convert(data.id, eval.pv());
+	}
+}
+
+QString AnalysisPanel::scoreString(const MoveEvaluation& eval) const
+{
+	// Show the scores from white's point of view so that the
+	// engines are easy to compare
+	int score = eval.score();
+	if (m_sideToMove == Chess::Side::Black)
+		score = -score;
+
+	QString str;
+	if (score > 0)
+		str += "+";
+
+	int absScore = qAbs(score);
+	if (eval.isMateScore())
+	{
+		if (score < 0)
+			str += "-";
+		str += "M" + QString::number((30001 - absScore) / 2);
+	}
+	else
+		str += QString::number(double(score) / 100.0, 'f', 2);
+
+	return str;
+}
@@ -0,0 +1,107 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ANALYSISPANEL_H
+#define ANALYSISPANEL_H
+
+#include <QWidget>
+#include <QList>
+#include <QVector>
+#include <board/genericmove.h>
+#include <board/side.h>
+#include <moveevaluation.h>
+class QComboBox;
+class QPushButton;
+class QTreeWidget;
+class QTreeWidgetItem;
+class QTimer;
+class ChessEngine;
+class PvConverter;
+
+/*!
+ * \brief A panel for analyzing a position with several engines at once.
+ *
+ * The user picks engines from the list of configured engines. Every
+ * engine analyzes the same position with infinite thinking time, and
+ * the engines stay running when the position changes, so browsing a
+ * game only sends the moves that changed.
+ *
+ * Search updates are collected as they arrive and shown in one view
+ * a few times per second. The PVs are converted to SAN in the
+ * background by a PvConverter.
+ *
+ * \sa ChessEngine::analyze()
+ */
+class AnalysisPanel : public QWidget
+{
+	Q_OBJECT
+
+	public:
+		/*! Creates a new analysis panel with the given \a parent. */
+		explicit AnalysisPanel(QWidget* parent = 0);
+		/*! Destroys the panel and its engines. */
+		virtual ~AnalysisPanel();
+
+	public slots:
+		/*!
+		 * Analyzes the position reached by playing \a moves from
+		 * \a startingFen in \a variant with every engine.
+		 *
+		 * If \a startingFen is empty, the analysis is stopped.
+		 */
+		void setPosition(const QString& variant,
+				 const QString& startingFen,
+				 const QVector<Chess::GenericMove>& moves);
+
+	private slots:
+		void addEngine();
+		void removeEngine();
+		void onAnalysisUpdated(const MoveEvaluation& eval);
+		void onEngineDisconnected();
+		void onPvConverted(int id, const QString& pv);
+		void refresh();
+
+	private:
+		struct EngineData
+		{
+			int id;
+			ChessEngine* engine;
+			QTreeWidgetItem* item;
+			MoveEvaluation eval;
+			bool updated;
+		};
+
+		int engineIndex(const QObject* engine) const;
+		QString scoreString(const MoveEvaluation& eval) const;
+
+		QComboBox* m_engineCombo;
+		QPushButton* m_addButton;
+		QPushButton* m_removeButton;
+		QTreeWidget* m_view;
+		QTimer* m_refreshTimer;
+		PvConverter* m_pvConverter;
+		QList<EngineData> m_engines;
+		int m_nextId;
+
+		QString m_variant;
+		QString m_startingFen;
+		QVector<Chess::GenericMove> m_moves;
+		Chess::Side m_sideToMove;
+};
+
+#endif // ANALYSISPANEL_H
@@ -16,7 +16,6 @@
 */
 
 #include "boardscene.h"
-#include <QSvgRenderer>
 #include <QGraphicsSceneMouseEvent>
 #include <QPropertyAnimation>
 #include <QParallelAnimationGroup>
@@ -38,7 +37,6 @@ BoardScene::BoardScene(QObject* parent)
 	  m_reserve(0),
 	  m_chooser(0),
 	  m_anim(0),
-	  m_renderer(new QSvgRenderer(QString(":/default.svg"), this)),
 	  m_highlightPiece(0),
 	  m_moveArrows(0)
 {
@@ -317,7 +315,6 @@ GraphicsPiece* BoardScene::pieceAt(const QPointF& pos) const
 GraphicsPiece* BoardScene::createPiece(const Chess::Piece& piece)
 {
 	Q_ASSERT(m_board != 0);
-	Q_ASSERT(m_renderer != 0);
 	Q_ASSERT(m_squares != 0);
 
 	if (!piece.isValid())
@@ -325,8 +322,7 @@ GraphicsPiece* BoardScene::createPiece(const Chess::Piece& piece)
 
 	return new GraphicsPiece(piece,
 				 s_squareSize,
-				 m_board->pieceSymbol(piece),
-				 m_renderer);
+				 m_board->pieceSymbol(piece));
 }
 
 QPropertyAnimation* BoardScene::pieceAnimation(GraphicsPiece* piece,
@@ -502,9 +498,10 @@ void BoardScene::updateMoves()
 	if (!m_board->result().isNone())
 		return;
 
-	QVector<Chess::Move> moves(m_board->legalMoves());
-	foreach (const Chess::Move& move, moves)
+	Chess::MoveIterator it(m_board);
+	while (it.hasNext())
 	{
+		Chess::Move move(it.next());
 		Chess::GenericMove gmove(m_board->genericMove(move));
 		m_moves << gmove;
 		GraphicsPiece* piece = 0;
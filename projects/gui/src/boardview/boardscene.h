@@ -31,7 +31,6 @@ namespace Chess
 	class Side;
 	class Piece;
 }
-class QSvgRenderer;
 class QAbstractAnimation;
 class QPropertyAnimation;
 class GraphicsBoard;
@@ -141,7 +140,6 @@ class BoardScene : public QGraphicsScene
 		GraphicsPieceReserve* m_reserve;
 		QPointer<PieceChooser> m_chooser;
 		QPointer<QAbstractAnimation> m_anim;
-		QSvgRenderer* m_renderer;
 		QMultiMap<GraphicsPiece*, Chess::Square> m_targets;
 		QList<Chess::GenericMove> m_moves;
 		Chess::GenericMove m_promotionMove;
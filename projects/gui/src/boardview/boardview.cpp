@@ -19,6 +19,18 @@
 #include <QPainter>
 #include <QResizeEvent>
 #include <QTimer>
+#include <QSettings>
+#include <QList>
+#if QT_VERSION >= 0x050400 && !defined(QT_NO_OPENGL)
+#include <QOpenGLWidget>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOffscreenSurface>
+#include <QSurfaceFormat>
+#define BOARDVIEW_OPENGL
+#endif
+
+static QList<BoardView*> s_views;
 
 
 BoardView::BoardView(QGraphicsScene* scene, QWidget* parent)
@@ -42,6 +54,83 @@ BoardView::BoardView(QGraphicsScene* scene, QWidget* parent)
 		this, SLOT(fitToRect()));
 	connect(scene, SIGNAL(sceneRectChanged(QRectF)),
 		this, SLOT(onSceneRectChanged()));
+
+	s_views.append(this);
+	updateViewport();
+}
+
+BoardView::~BoardView()
+{
+	s_views.removeOne(this);
+}
+
+bool BoardView::isOpenGlSupported()
+{
+#ifdef BOARDVIEW_OPENGL
+	static int s_supported = -1;
+	if (s_supported != -1)
+		return s_supported;
+
+	s_supported = 0;
+	QOffscreenSurface surface;
+	surface.create();
+	QOpenGLContext context;
+	if (context.create() && context.makeCurrent(&surface))
+	{
+		QString renderer(reinterpret_cast<const char*>(
+			context.functions()->glGetString(GL_RENDERER)));
+
+		// Software renderers are slower than the raster engine
+		if (!renderer.contains("llvmpipe", Qt::CaseInsensitive)
+		&&  !renderer.contains("softpipe", Qt::CaseInsensitive)
+		&&  !renderer.contains("software", Qt::CaseInsensitive))
+			s_supported = 1;
+		context.doneCurrent();
+	}
+
+	return s_supported;
+#else
+	return false;
+#endif
+}
+
+bool BoardView::isOpenGlEnabled()
+{
+	return QSettings().value("ui/opengl_boards", false).toBool();
+}
+
+void BoardView::setOpenGlEnabled(bool enabled)
+{
+	QSettings().setValue("ui/opengl_boards", enabled);
+
+	foreach (BoardView* view, s_views)
+		view->updateViewport();
+}
+
+void BoardView::updateViewport()
+{
+#ifdef BOARDVIEW_OPENGL
+	bool useOpenGl = isOpenGlEnabled() && isOpenGlSupported();
+	if (useOpenGl == (qobject_cast<QOpenGLWidget*>(viewport()) != 0))
+		return;
+
+	if (useOpenGl)
+	{
+		QOpenGLWidget* widget = new QOpenGLWidget();
+		QSurfaceFormat format(widget->format());
+		format.setSamples(4);
+		widget->setFormat(format);
+		setViewport(widget);
+
+		// Partial updates don't save anything with OpenGL
+		setViewportUpdateMode(FullViewportUpdate);
+	}
+	else
+	{
+		setViewport(new QWidget());
+		setViewportUpdateMode(MinimalViewportUpdate);
+	}
+#endif
 }
 
 QSize BoardView::sizeHint() const
@@ -28,6 +28,11 @@ class QTimer;
  * BoardView is meant for visualizing the contents of a BoardScene.
  * Unlike a pure QGraphicsView, BoardView doesn't use scrollbars and
  * always keeps the view fitted to the entire scene.
+ *
+ * The views can optionally draw with OpenGL, which moves the work of
+ * drawing many big, animated boards from the CPU to the GPU. The
+ * piece images come from PieceCache, so each image is uploaded as a
+ * texture once and reused by every piece and board.
  */
 class BoardView : public QGraphicsView
 {
@@ -36,6 +41,25 @@ class BoardView : public QGraphicsView
 	public:
 		/*! Creates a new BoardView object that displays \a scene. */
 		explicit BoardView(QGraphicsScene* scene, QWidget* parent = 0);
+		/*! Destroys the view. */
+		virtual ~BoardView();
+
+		/*!
+		 * Returns true if the system has a hardware-accelerated
+		 * OpenGL implementation that the views can use.
+		 */
+		static bool isOpenGlSupported();
+		/*! Returns true if the views are set to draw with OpenGL. */
+		static bool isOpenGlEnabled();
+		/*!
+		 * Sets every view to draw with OpenGL if \a enabled is
+		 * true, or with the raster engine otherwise, and saves
+		 * the setting.
+		 *
+		 * The raster engine is always used if isOpenGlSupported()
+		 * returns false.
+		 */
+		static void setOpenGlEnabled(bool enabled);
 
 		// Inherited from QGraphicsView
 		virtual QSize sizeHint() const;
@@ -51,6 +75,8 @@ class BoardView : public QGraphicsView
 		void onSceneRectChanged();
 
 	private:
+		void updateViewport();
+
 		bool m_initialized;
 		QTimer* m_resizeTimer;
 		QPixmap m_resizePixmap;
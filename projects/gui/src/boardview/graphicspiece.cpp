@@ -16,24 +16,24 @@
 */
 
 #include "graphicspiece.h"
-#include <QSvgRenderer>
+#include <QPainter>
+#include "piececache.h"
 
 
 GraphicsPiece::GraphicsPiece(const Chess::Piece& piece,
 			     qreal squareSize,
 			     const QString& elementId,
-			     QSvgRenderer* renderer,
 			     QGraphicsItem* parent)
 	: QGraphicsObject(parent),
 	  m_piece(piece),
 	  m_rect(-squareSize / 2, -squareSize / 2,
 		  squareSize, squareSize),
 	  m_elementId(elementId),
-	  m_renderer(renderer),
 	  m_container(0)
 {
 	setAcceptedMouseButtons(Qt::LeftButton);
-	setCacheMode(DeviceCoordinateCache);
+	connect(PieceCache::instance(), SIGNAL(themeChanged()),
+		this, SLOT(onThemeChanged()));
 }
 
 int GraphicsPiece::type() const
@@ -53,23 +53,15 @@ void GraphicsPiece::paint(QPainter* painter,
 	Q_UNUSED(option);
 	Q_UNUSED(widget);
 
-	QRectF bounds(m_renderer->boundsOnElement(m_elementId));
-	qreal ar = bounds.width() / bounds.height();
-	qreal width = m_rect.width() * 0.8;
+	// Use an image with the same size as the piece on the screen,
+	// so that it's drawn without scaling
+	QRectF target(painter->worldTransform().mapRect(m_rect));
+	int size = qRound(qMax(target.width(), target.height()));
+	if (size <= 0)
+		return;
 
-	if (ar > 1.0)
-	{
-		bounds.setWidth(width);
-		bounds.setHeight(width / ar);
-	}
-	else
-	{
-		bounds.setHeight(width);
-		bounds.setWidth(width * ar);
-	}
-	bounds.moveCenter(m_rect.center());
-
-	m_renderer->render(painter, m_elementId, bounds);
+	QPixmap pixmap(PieceCache::instance()->pixmap(m_elementId, size));
+	painter->drawPixmap(m_rect, pixmap, QRectF(pixmap.rect()));
 }
 
 Chess::Piece GraphicsPiece::pieceType() const
@@ -87,6 +79,11 @@ void GraphicsPiece::setContainer(QGraphicsItem* item)
 	m_container = item;
 }
 
+void GraphicsPiece::onThemeChanged()
+{
+	update();
+}
+
 void GraphicsPiece::restoreParent()
 {
 	if (parentItem() == 0 && m_container != 0)
@@ -20,15 +20,15 @@
 
 #include <QGraphicsObject>
 #include <board/piece.h>
-class QSvgRenderer;
 
 /*!
  * \brief A graphical representation of a chess piece.
  *
  * A GraphicsPiece object is a chess piece that can be easily
- * dragged and animated in a QGraphicsScene. Scalable Vector
- * Graphics (SVG) are used to ensure that the pieces look good
- * at any resolution, and a shared SVG renderer is used.
+ * dragged and animated in a QGraphicsScene. The piece images
+ * are rendered from Scalable Vector Graphics (SVG) in the exact
+ * size they're drawn in, and shared by every piece through
+ * PieceCache.
  *
  * For convenience reasons the boundingRect() of a piece should
  * be equal to that of a square on the chessboard.
@@ -46,13 +46,12 @@ class GraphicsPiece : public QGraphicsObject
 		 *
 		 * The painted image is scaled to fit inside a square that is
 		 * \a squareSize wide and high.
-		 * \a elementId is the XML ID of the piece picture which is
-		 * rendered by \a renderer.
+		 * \a elementId is the XML ID of the piece picture in the
+		 * piece theme.
 		 */
 		GraphicsPiece(const Chess::Piece& piece,
 			      qreal squareSize,
 			      const QString& elementId,
-			      QSvgRenderer* renderer,
 			      QGraphicsItem* parent = 0);
 
 		// Inherited from QGraphicsObject
@@ -86,11 +85,13 @@ class GraphicsPiece : public QGraphicsObject
 		 */
 		void restoreParent();
 
+	private slots:
+		void onThemeChanged();
+
 	private:
 		Chess::Piece m_piece;
 		QRectF m_rect;
 		QString m_elementId;
-		QSvgRenderer* m_renderer;
 		QGraphicsItem* m_container;
 };
 
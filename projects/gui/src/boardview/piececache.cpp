@@ -0,0 +1,90 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "piececache.h"
+#include <QApplication>
+#include <QPainter>
+#include <QPixmapCache>
+#include <QSvgRenderer>
+
+
+PieceCache* PieceCache::instance()
+{
+	static PieceCache* s_instance = 0;
+	if (s_instance == 0)
+		s_instance = new PieceCache(qApp);
+
+	return s_instance;
+}
+
+PieceCache::PieceCache(QObject* parent)
+	: QObject(parent),
+	  m_renderer(new QSvgRenderer(QString(":/default.svg"), this)),
+	  m_themeId(0)
+{
+}
+
+QSvgRenderer* PieceCache::renderer() const
+{
+	return m_renderer;
+}
+
+bool PieceCache::setTheme(const QString& fileName)
+{
+	if (!m_renderer->load(fileName))
+		return false;
+
+	// The theme ID is part of the cache keys, so the images of the
+	// old theme are never used again and get discarded eventually.
+	m_themeId++;
+	emit themeChanged();
+	return true;
+}
+
+QPixmap PieceCache::pixmap(const QString& elementId, int size)
+{
+	Q_ASSERT(size > 0);
+
+	QString key(QString("piece-%1-%2-%3")
+		    .arg(m_themeId).arg(elementId).arg(size));
+	QPixmap pixmap;
+	if (QPixmapCache::find(key, &pixmap))
+		return pixmap;
+
+	pixmap = QPixmap(size, size);
+	pixmap.fill(Qt::transparent);
+
+	if (m_renderer->elementExists(elementId))
+	{
+		QRectF bounds(m_renderer->boundsOnElement(elementId));
+		qreal ar = bounds.width() / bounds.height();
+		qreal width = size * 0.8;
+		if (ar > 1.0)
+			bounds.setSize(QSizeF(width, width / ar));
+		else
+			bounds.setSize(QSizeF(width * ar, width));
+		bounds.moveCenter(QPointF(size / 2.0, size / 2.0));
+
+		QPainter painter(&pixmap);
+		painter.setRenderHint(QPainter::Antialiasing);
+		m_renderer->render(&painter, elementId, bounds);
+	}
+
+	QPixmapCache::insert(key, pixmap);
+	return pixmap;
+}
@@ -0,0 +1,77 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PIECECACHE_H
+#define PIECECACHE_H
+
+#include <QObject>
+#include <QPixmap>
+class QSvgRenderer;
+
+/*!
+ * \brief Shared, pre-rendered images of the chess pieces.
+ *
+ * Rendering the pieces from SVG is slow, so every board in the
+ * application gets its piece images from this cache. An image is
+ * rendered the first time a piece is needed in a given size, after
+ * which drawing the piece is just a pixmap blit no matter how many
+ * boards show it.
+ *
+ * The images are kept in QPixmapCache, which discards the least
+ * recently used images when the cache is full. Changing the piece
+ * theme invalidates every cached image.
+ */
+class PieceCache : public QObject
+{
+	Q_OBJECT
+
+	public:
+		/*! Returns the application-wide piece cache. */
+		static PieceCache* instance();
+
+		/*! Returns the SVG renderer of the current piece theme. */
+		QSvgRenderer* renderer() const;
+		/*!
+		 * Sets the piece theme to the SVG file \a fileName.
+		 *
+		 * Emits themeChanged() if the theme was loaded.
+		 */
+		bool setTheme(const QString& fileName);
+
+		/*!
+		 * Returns the image of the piece \a elementId in a square
+		 * that is \a size pixels wide and high.
+		 *
+		 * The piece is centered in the square and takes 80% of
+		 * its width or height. A transparent image is returned if
+		 * the theme doesn't have the piece.
+		 */
+		QPixmap pixmap(const QString& elementId, int size);
+
+	signals:
+		/*! Emitted when the piece theme changes. */
+		void themeChanged();
+
+	private:
+		explicit PieceCache(QObject* parent = 0);
+
+		QSvgRenderer* m_renderer;
+		int m_themeId;
+};
+
+#endif // PIECECACHE_H
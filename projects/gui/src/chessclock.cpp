@@ -16,15 +16,78 @@
 */
 
 #include "chessclock.h"
+#include <QBasicTimer>
 #include <QTimerEvent>
 #include <QLabel>
 #include <QVBoxLayout>
+#include <QApplication>
+
+// The update interval of the running clocks in milliseconds
+static const int s_tickInterval = 100;
+
+
+/*
+ * Updates all the running clocks with a single timer.
+ *
+ * The timer only runs while at least one clock is running.
+ */
+class ClockTicker : public QObject
+{
+	public:
+		static ClockTicker* instance()
+		{
+			static ClockTicker* ticker = 0;
+			if (ticker == 0)
+				ticker = new ClockTicker(qApp);
+			return ticker;
+		}
+
+		void add(ChessClock* clock)
+		{
+			if (m_clocks.contains(clock))
+				return;
+			m_clocks.append(clock);
+			if (!m_timer.isActive())
+				m_timer.start(s_tickInterval, this);
+		}
+
+		void remove(ChessClock* clock)
+		{
+			m_clocks.removeOne(clock);
+			if (m_clocks.isEmpty())
+				m_timer.stop();
+		}
+
+	protected:
+		virtual void timerEvent(QTimerEvent* event)
+		{
+			if (event->timerId() != m_timer.timerId())
+			{
+				QObject::timerEvent(event);
+				return;
+			}
+			foreach (ChessClock* clock, m_clocks)
+			{
+				if (clock->isVisible())
+					clock->tick();
+			}
+		}
+
+	private:
+		ClockTicker(QObject* parent)
+			: QObject(parent)
+		{
+		}
+
+		QBasicTimer m_timer;
+		QList<ChessClock*> m_clocks;
+};
 
 
 ChessClock::ChessClock(QWidget* parent)
 	: QWidget(parent),
 	  m_totalTime(0),
-	  m_timerId(-1),
+	  m_running(false),
 	  m_infiniteTime(false),
 	  m_nameLabel(new QLabel()),
 	  m_timeLabel(new QLabel())
@@ -44,6 +107,11 @@ ChessClock::ChessClock(QWidget* parent)
 	setLayout(layout);
 }
 
+ChessClock::~ChessClock()
+{
+	stopTimer();
+}
+
 void ChessClock::setPlayerName(const QString& name)
 {
 	if (name.isEmpty())
@@ -59,6 +127,7 @@ void ChessClock::setInfiniteTime(bool infinite)
 		return;
 
 	stopTimer();
+	m_timeText.clear();
 	m_timeLabel->setText(QString::fromUtf8("<h1>\xE2\x88\x9E</h1>"));
 }
 
@@ -80,7 +149,11 @@ void ChessClock::setTime(int totalTime)
 		str.append("-");
 	str.append(timeLeft.toString(format));
 
-	m_timeLabel->setText(QString("<h1>%1</h1>").arg(str));
+	if (str != m_timeText)
+	{
+		m_timeText = str;
+		m_timeLabel->setText(QString("<h1>%1</h1>").arg(str));
+	}
 }
 
 void ChessClock::start(int totalTime)
@@ -96,7 +169,8 @@ void ChessClock::start(int totalTime)
 	{
 		m_time.start();
 		m_totalTime = totalTime;
-		m_timerId = startTimer(1000);
+		m_running = true;
+		ClockTicker::instance()->add(this);
 		setTime(totalTime);
 	}
 }
@@ -110,20 +184,24 @@ void ChessClock::stop()
 		setTime(m_totalTime - m_time.elapsed());
 }
 
-void ChessClock::timerEvent(QTimerEvent* event)
+void ChessClock::showEvent(QShowEvent* event)
 {
-	if (!event)
-		return;
-	
-	if (event->timerId() == m_timerId)
+	// Hidden clocks aren't updated, so catch up right away
+	tick();
+	QWidget::showEvent(event);
+}
+
+void ChessClock::tick()
+{
+	if (m_running)
 		setTime(m_totalTime - m_time.elapsed());
 }
 
 void ChessClock::stopTimer()
 {
-	if (m_timerId != -1)
+	if (m_running)
 	{
-		killTimer(m_timerId);
-		m_timerId = -1;
+		ClockTicker::instance()->remove(this);
+		m_running = false;
 	}
 }
@@ -21,15 +21,26 @@
 #include <QWidget>
 #include <QTime>
 
-class QTimerEvent;
+class QShowEvent;
 class QLabel;
+class ClockTicker;
 
+/*!
+ * \brief A widget that shows a player's name and remaining time.
+ *
+ * The running clocks don't have timers of their own. They are all
+ * updated by a single shared ticker, and each clock computes its
+ * display from the time it was started. A clock's label is only
+ * changed when the displayed time changes, and clocks that aren't
+ * visible are skipped until they are shown again.
+ */
 class ChessClock: public QWidget
 {
 	Q_OBJECT
 	
 	public:
 		ChessClock(QWidget* parent = 0);
+		virtual ~ChessClock();
 	
 	public slots:
 		void setPlayerName(const QString& name);
@@ -39,15 +50,19 @@ class ChessClock: public QWidget
 		void stop();
 	
 	protected:
-		virtual void timerEvent(QTimerEvent* event);
+		virtual void showEvent(QShowEvent* event);
 	
 	private:
+		friend class ClockTicker;
+
+		void tick();
 		void stopTimer();
 
 		int m_totalTime;
-		int m_timerId;
+		bool m_running;
 		bool m_infiniteTime;
 		QTime m_time;
+		QString m_timeText;
 		QLabel* m_nameLabel;
 		QLabel* m_timeLabel;
 		QPalette m_defaultPalette;
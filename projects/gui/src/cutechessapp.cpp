@@ -25,6 +25,7 @@
 
 #include <mersenne.h>
 #include <enginemanager.h>
+#include <engineoptioncache.h>
 #include <gamemanager.h>
 #include <board/boardfactory.h>
 #include <chessgame.h>
@@ -70,6 +71,7 @@ CuteChessApplication::CuteChessApplication(int& argc, char* argv[])
 
 	// Load the engines
 	engineManager()->loadEngines(configPath() + QLatin1String("/engines.json"));
+	EngineOptionCache::setFileName(configPath() + QLatin1String("/engineoptions.json"));
 
 	// Read the game database state
 	gameDatabaseManager()->readState(configPath() + QLatin1String("/gamedb.bin"));
@@ -26,6 +26,7 @@
 
 #include <enginefactory.h>
 #include <engineoption.h>
+#include <engineoptioncache.h>
 #include <chessplayer.h>
 #include <enginebuilder.h>
 
@@ -241,6 +242,21 @@ void EngineConfigurationDialog::detectEngineOptions()
 	m_oldPath = ui->m_workingDirEdit->text();
 	m_oldProtocol = ui->m_protocolCombo->currentText();
 
+	// Reuse what the same engine executable reported earlier
+	// unless the user explicitly asked for a new detection
+	QList<EngineOption*> cachedOptions;
+	if (QObject::sender() != ui->m_detectBtn
+	&&  EngineOptionCache::lookup(engineConfiguration(),
+				      &cachedOptions, &m_variants))
+	{
+		qDeleteAll(m_options);
+		m_options = cachedOptions;
+		m_engineOptionModel->setOptions(m_options);
+		ui->m_restoreBtn->setDisabled(m_options.isEmpty());
+		emit detectionFinished();
+		return;
+	}
+
 	ui->m_detectBtn->setEnabled(false);
 	ui->m_restoreBtn->setEnabled(false);
 	ui->m_progressBar->show();
@@ -287,6 +303,7 @@ void EngineConfigurationDialog::onEngineReady()
 
 	m_engineOptionModel->setOptions(m_options);
 	m_variants = m_engine->variants();
+	EngineOptionCache::store(engineConfiguration(), m_options, m_variants);
 
 	m_engine->quit();
 }
@@ -0,0 +1,382 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "evalgraph.h"
+#include <QPainter>
+#include <QTimer>
+#include <QRegExp>
+#include <QWheelEvent>
+#include <QMouseEvent>
+#include <chessgame.h>
+#include <pgngame.h>
+
+// Scores are clamped to this many centipawns
+static const int s_scoreRange = 600;
+// The smallest number of plies shown on the ply axis
+static const int s_minPlyCount = 40;
+// The space for the score labels in pixels
+static const int s_labelWidth = 28;
+
+static bool scoreFromComment(const QString& comment, int* score)
+{
+	// Eg. "+0.35/12 1.4s" or "-M5/20 0.3s"
+	QRegExp rx("^([+-]?)(M?)(\\d+(?:\\.\\d+)?)/\\d+");
+	if (rx.indexIn(comment) == -1)
+		return false;
+
+	if (!rx.cap(2).isEmpty())
+		*score = s_scoreRange;
+	else
+		*score = qRound(rx.cap(3).toDouble() * 100.0);
+	if (rx.cap(1) == "-")
+		*score = -*score;
+	return true;
+}
+
+EvalGraph::EvalGraph(QWidget* parent)
+	: QWidget(parent),
+	  m_maxSeriesCount(64),
+	  m_colorIndex(0),
+	  m_plyCount(0),
+	  m_firstPly(-1),
+	  m_lastPly(-1),
+	  m_repaintTimer(new QTimer(this))
+{
+	setAttribute(Qt::WA_OpaquePaintEvent);
+
+	m_repaintTimer->setSingleShot(true);
+	m_repaintTimer->setInterval(100);
+	connect(m_repaintTimer, SIGNAL(timeout()), this, SLOT(update()));
+}
+
+EvalGraph::~EvalGraph()
+{
+	qDeleteAll(m_series);
+}
+
+void EvalGraph::setMaxSeriesCount(int count)
+{
+	m_maxSeriesCount = qMax(count, 1);
+}
+
+QSize EvalGraph::sizeHint() const
+{
+	return QSize(400, 150);
+}
+
+void EvalGraph::clear()
+{
+	foreach (Series* series, m_series)
+	{
+		if (series->source != 0)
+			disconnect(series->source, 0, this, 0);
+	}
+	qDeleteAll(m_series);
+	m_series.clear();
+
+	m_colorIndex = 0;
+	m_plyCount = 0;
+	m_firstPly = -1;
+	m_lastPly = -1;
+	update();
+}
+
+void EvalGraph::setGame(ChessGame* game, const PgnGame* pgn)
+{
+	clear();
+
+	Series* series = addSeries(game);
+	if (pgn != 0)
+	{
+		const QVector<PgnGame::MoveData>& moves = pgn->moves();
+		Chess::Side side(pgn->startingSide());
+		for (int i = 0; i < moves.size(); i++)
+		{
+			int score = 0;
+			if (scoreFromComment(moves.at(i).comment, &score))
+				appendPoint(series, i, side == Chess::Side::White
+							   ? score : -score);
+			side = side.opposite();
+		}
+	}
+
+	if (game != 0)
+	{
+		connect(game, SIGNAL(moveEvaluated(int, int)),
+			this, SLOT(onMoveEvaluated(int, int)));
+		connect(game, SIGNAL(destroyed(QObject*)),
+			this, SLOT(onGameDestroyed(QObject*)));
+	}
+}
+
+void EvalGraph::addGame(ChessGame* game)
+{
+	Q_ASSERT(game != 0);
+
+	addSeries(game);
+	connect(game, SIGNAL(moveEvaluated(int, int)),
+		this, SLOT(onMoveEvaluated(int, int)));
+	connect(game, SIGNAL(destroyed(QObject*)),
+		this, SLOT(onGameDestroyed(QObject*)));
+}
+
+EvalGraph::Series* EvalGraph::addSeries(const QObject* source)
+{
+	while (m_series.size() >= m_maxSeriesCount)
+	{
+		Series* oldest = m_series.takeFirst();
+		if (oldest->source != 0)
+			disconnect(oldest->source, 0, this, 0);
+		delete oldest;
+	}
+
+	Series* series = new Series;
+	series->source = source;
+	// Golden angle steps keep the neighbouring hues apart
+	series->color = QColor::fromHsv((m_colorIndex++ * 137) % 360, 200, 200);
+	m_series.append(series);
+	scheduleRepaint();
+
+	return series;
+}
+
+EvalGraph::Series* EvalGraph::series(const QObject* source)
+{
+	foreach (Series* series, m_series)
+	{
+		if (series->source == source)
+			return series;
+	}
+	return 0;
+}
+
+void EvalGraph::onMoveEvaluated(int ply, int score)
+{
+	Series* series = this->series(sender());
+	if (series == 0)
+		return;
+
+	appendPoint(series, ply, score);
+	scheduleRepaint();
+}
+
+void EvalGraph::onGameDestroyed(QObject* game)
+{
+	// Finished games stay in the graph, but a new game may get the
+	// same address
+	Series* series = this->series(game);
+	if (series != 0)
+		series->source = 0;
+}
+
+void EvalGraph::appendPoint(Series* series, int ply, int score)
+{
+	if (!series->points.isEmpty() && ply <= series->points.last().x())
+		return;
+
+	score = qBound(-s_scoreRange, score, s_scoreRange);
+	series->points.append(QPointF(ply, score));
+	m_plyCount = qMax(m_plyCount, ply + 1);
+
+	for (int i = 1; i <= series->levels.size(); i++)
+		updateLevel(series, i);
+}
+
+const QVector<QPointF>& EvalGraph::level(Series* series, int level)
+{
+	Q_ASSERT(level > 0);
+
+	while (series->levels.size() < level)
+	{
+		series->levels.append(QVector<QPointF>());
+		updateLevel(series, series->levels.size());
+	}
+	return series->levels.at(level - 1);
+}
+
+void EvalGraph::updateLevel(Series* series, int level)
+{
+	const QVector<QPointF>& points = series->points;
+	QVector<QPointF>& selected = series->levels[level - 1];
+	const int size = 1 << level;
+
+	// Bucket i holds the points from 1 + i * size. The first point is
+	// always drawn. A bucket is done when the next one is full,
+	// because LTTB compares the points with the next bucket's average.
+	int i = selected.size();
+	while (1 + (i + 2) * size <= points.size())
+	{
+		const QPointF a = (i == 0) ? points.first() : selected.at(i - 1);
+		const int start = 1 + i * size;
+
+		QPointF c;
+		for (int j = start + size; j < start + 2 * size; j++)
+			c += points.at(j);
+		c /= size;
+
+		int best = start;
+		qreal maxArea = -1.0;
+		for (int j = start; j < start + size; j++)
+		{
+			const QPointF& b = points.at(j);
+			qreal area = qAbs((a.x() - c.x()) * (b.y() - a.y())
+					- (a.x() - b.x()) * (c.y() - a.y()));
+			if (area > maxArea)
+			{
+				maxArea = area;
+				best = j;
+			}
+		}
+
+		selected.append(points.at(best));
+		i++;
+	}
+}
+
+QPolygonF EvalGraph::lodPolygon(Series* series, int level)
+{
+	const QVector<QPointF>& points = series->points;
+	if (level == 0 || points.size() < 2)
+		return QPolygonF(points);
+
+	// The first point, the finished buckets and the raw points of
+	// the unfinished buckets
+	const QVector<QPointF>& selected = this->level(series, level);
+	QPolygonF polygon;
+	polygon.reserve(selected.size() + 2 * (1 << level));
+	polygon.append(points.first());
+	polygon += selected;
+	for (int i = 1 + selected.size() * (1 << level); i < points.size(); i++)
+		polygon.append(points.at(i));
+
+	return polygon;
+}
+
+void EvalGraph::scheduleRepaint()
+{
+	if (!m_repaintTimer->isActive())
+		m_repaintTimer->start();
+}
+
+void EvalGraph::paintEvent(QPaintEvent* event)
+{
+	Q_UNUSED(event);
+
+	QPainter painter(this);
+	painter.fillRect(rect(), palette().base());
+
+	const QRectF area(QRectF(rect()).adjusted(s_labelWidth, 4, -4, -4));
+	if (area.width() <= 0 || area.height() <= 0)
+		return;
+
+	int first = 0;
+	int last = qMax(m_plyCount, s_minPlyCount);
+	if (m_firstPly >= 0)
+	{
+		first = m_firstPly;
+		last = m_lastPly;
+	}
+
+	// Data coordinates: plies and centipawns, white up
+	QTransform transform;
+	transform.translate(area.left(), area.center().y());
+	transform.scale(area.width() / (last - first),
+			-area.height() / (2.0 * s_scoreRange));
+	transform.translate(-first, 0);
+
+	// One line per pawn and a label every other pawn
+	QColor gridColor(palette().text().color());
+	gridColor.setAlpha(40);
+	for (int score = -s_scoreRange; score <= s_scoreRange; score += 100)
+	{
+		const qreal y = transform.map(QPointF(first, score)).y();
+		painter.setPen(score == 0 ? palette().text().color() : gridColor);
+		painter.drawLine(QPointF(area.left(), y), QPointF(area.right(), y));
+
+		if (score % 200 == 0)
+		{
+			painter.setPen(palette().text().color());
+			painter.drawText(QRectF(0, y - 8, s_labelWidth - 4, 16),
+					 Qt::AlignRight | Qt::AlignVCenter,
+					 score > 0 ? QString("+%1").arg(score / 100)
+						   : QString::number(score / 100));
+		}
+	}
+
+	// Full moves on the ply axis, about every 60 pixels
+	int step = 2;
+	while (step * area.width() / (last - first) < 60)
+		step *= (QString::number(step).at(0) == '2') ? 5 : 2;
+	painter.setPen(gridColor);
+	for (int ply = (first + step - 1) / step * step; ply <= last; ply += step)
+	{
+		const qreal x = transform.map(QPointF(ply, 0)).x();
+		painter.drawLine(QPointF(x, area.top()), QPointF(x, area.bottom()));
+	}
+
+	// Each bucket of the drawn level covers at most half a pixel
+	const qreal pliesPerPixel = (last - first) / area.width();
+	int level = 0;
+	while ((2 << level) * 2 <= pliesPerPixel)
+		level++;
+
+	painter.setClipRect(area);
+	painter.setRenderHint(QPainter::Antialiasing);
+	foreach (Series* series, m_series)
+	{
+		painter.setPen(QPen(series->color, 1.5));
+		painter.drawPolyline(transform.map(lodPolygon(series, level)));
+	}
+}
+
+void EvalGraph::wheelEvent(QWheelEvent* event)
+{
+	const int fullCount = qMax(m_plyCount, s_minPlyCount);
+	int first = (m_firstPly >= 0) ? m_firstPly : 0;
+	int last = (m_firstPly >= 0) ? m_lastPly : fullCount;
+
+	// Zoom around the ply under the cursor
+	const qreal plotWidth = qMax(width() - s_labelWidth - 4, 1);
+	const qreal pos = first + (event->pos().x() - s_labelWidth)
+			  * (last - first) / plotWidth;
+	const qreal factor = (event->delta() > 0) ? 0.8 : 1.25;
+	const int span = qBound(8, qRound((last - first) * factor), fullCount);
+
+	if (span >= fullCount)
+	{
+		m_firstPly = -1;
+		m_lastPly = -1;
+	}
+	else
+	{
+		first = qRound(pos - (pos - first) * factor);
+		m_firstPly = qBound(0, first, fullCount - span);
+		m_lastPly = m_firstPly + span;
+	}
+
+	event->accept();
+	update();
+}
+
+void EvalGraph::mouseDoubleClickEvent(QMouseEvent* event)
+{
+	m_firstPly = -1;
+	m_lastPly = -1;
+
+	event->accept();
+	update();
+}
@@ -0,0 +1,119 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EVALGRAPH_H
+#define EVALGRAPH_H
+
+#include <QWidget>
+#include <QVector>
+#include <QList>
+#include <QPointF>
+#include <QColor>
+#include <QPolygonF>
+class QTimer;
+class ChessGame;
+class PgnGame;
+
+/*!
+ * \brief A graph of the evaluations of one or more games.
+ *
+ * Each game is a series of scores by ply, from white's point of view.
+ * The scores are appended incrementally from the games'
+ * ChessGame::moveEvaluated() signals, and the graph is repainted a few
+ * times per second at most.
+ *
+ * Long series are drawn with Largest-Triangle-Three-Buckets (LTTB)
+ * downsampling. Every zoom level has its own bucket size, and the
+ * buckets of a level are only computed once, when the following
+ * bucket is full, so appending a score doesn't resample the series.
+ * About two points are drawn per pixel regardless of the game length.
+ *
+ * The mouse wheel zooms the ply axis and a double click shows the
+ * whole games again.
+ */
+class EvalGraph : public QWidget
+{
+	Q_OBJECT
+
+	public:
+		/*! Creates a new empty graph. */
+		explicit EvalGraph(QWidget* parent = 0);
+		/*! Destroys the graph. */
+		virtual ~EvalGraph();
+
+		/*!
+		 * Sets the maximum number of series to \a count.
+		 *
+		 * When a new series would exceed the limit, the oldest
+		 * series is removed. The default value is 64.
+		 */
+		void setMaxSeriesCount(int count);
+
+		// Inherited from QWidget
+		virtual QSize sizeHint() const;
+
+	public slots:
+		/*! Removes all series. */
+		void clear();
+		/*!
+		 * Shows only \a game, with the scores found in the move
+		 * comments of \a pgn so far.
+		 *
+		 * \a game can be null for a finished game that only has
+		 * a PGN record.
+		 */
+		void setGame(ChessGame* game, const PgnGame* pgn);
+		/*! Adds \a game as a new series next to the others. */
+		void addGame(ChessGame* game);
+
+	protected:
+		// Inherited from QWidget
+		virtual void paintEvent(QPaintEvent* event);
+		virtual void wheelEvent(QWheelEvent* event);
+		virtual void mouseDoubleClickEvent(QMouseEvent* event);
+
+	private slots:
+		void onMoveEvaluated(int ply, int score);
+		void onGameDestroyed(QObject* game);
+
+	private:
+		struct Series
+		{
+			const QObject* source;
+			QColor color;
+			QVector<QPointF> points;
+			QVector< QVector<QPointF> > levels;
+		};
+
+		Series* addSeries(const QObject* source);
+		Series* series(const QObject* source);
+		void appendPoint(Series* series, int ply, int score);
+		const QVector<QPointF>& level(Series* series, int level);
+		void updateLevel(Series* series, int level);
+		QPolygonF lodPolygon(Series* series, int level);
+		void scheduleRepaint();
+
+		QList<Series*> m_series;
+		int m_maxSeriesCount;
+		int m_colorIndex;
+		int m_plyCount;
+		int m_firstPly;
+		int m_lastPly;
+		QTimer* m_repaintTimer;
+};
+
+#endif // EVALGRAPH_H
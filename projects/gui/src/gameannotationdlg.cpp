@@ -0,0 +1,191 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "gameannotationdlg.h"
+#include <QComboBox>
+#include <QSpinBox>
+#include <QCheckBox>
+#include <QPushButton>
+#include <QLabel>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QMessageBox>
+#include <QThread>
+#include <gamemanager.h>
+#include <gameannotator.h>
+#include <enginemanager.h>
+#include "cutechessapp.h"
+#include "engineconfigurationmodel.h"
+#include "pathlineedit.h"
+#include "timecontroldlg.h"
+
+GameAnnotationDialog::GameAnnotationDialog(QWidget* parent)
+	: QDialog(parent),
+	  m_inputEdit(new PathLineEdit(PathLineEdit::FilePath, this)),
+	  m_outputEdit(new PathLineEdit(PathLineEdit::FilePath, this)),
+	  m_engineCombo(new QComboBox(this)),
+	  m_instanceSpin(new QSpinBox(this)),
+	  m_timeControlButton(new QPushButton(this)),
+	  m_checkpointCheck(new QCheckBox(tr("Continue from a checkpoint file"), this)),
+	  m_statusLabel(new QLabel(this)),
+	  m_startButton(new QPushButton(tr("Start"), this)),
+	  m_manager(new GameManager(this)),
+	  m_annotator(new GameAnnotator(m_manager, this)),
+	  m_closing(false)
+{
+	setWindowTitle(tr("Annotate Games"));
+
+	EngineManager* engineManager = CuteChessApplication::instance()->engineManager();
+	m_engineCombo->setModel(new EngineConfigurationModel(engineManager, this));
+
+	m_instanceSpin->setRange(1, 256);
+	m_instanceSpin->setValue(qMax(1, QThread::idealThreadCount()));
+
+	m_timeControl.setInfinity(false);
+	m_timeControl.setTimePerMove(1000);
+	m_timeControlButton->setText(m_timeControl.toVerboseString());
+	connect(m_timeControlButton, SIGNAL(clicked()),
+		this, SLOT(changeTimeControl()));
+
+	m_checkpointCheck->setChecked(true);
+	m_checkpointCheck->setToolTip(
+		tr("Save the progress next to the output file, and skip "
+		   "the games that were already annotated"));
+
+	connect(m_startButton, SIGNAL(clicked()), this, SLOT(startOrStop()));
+	connect(m_annotator, SIGNAL(gameAnnotated(int)),
+		this, SLOT(onGameAnnotated(int)));
+	connect(m_annotator, SIGNAL(finished()), this, SLOT(onFinished()));
+
+	QFormLayout* form = new QFormLayout();
+	form->addRow(tr("Games:"), m_inputEdit);
+	form->addRow(tr("Output:"), m_outputEdit);
+	form->addRow(tr("Engine:"), m_engineCombo);
+	form->addRow(tr("Instances:"), m_instanceSpin);
+	form->addRow(tr("Time per position:"), m_timeControlButton);
+	form->addRow(QString(), m_checkpointCheck);
+
+	QHBoxLayout* buttons = new QHBoxLayout();
+	buttons->addWidget(m_statusLabel);
+	buttons->addStretch();
+	buttons->addWidget(m_startButton);
+
+	QVBoxLayout* layout = new QVBoxLayout();
+	layout->addLayout(form);
+	layout->addLayout(buttons);
+	setLayout(layout);
+}
+
+void GameAnnotationDialog::reject()
+{
+	if (m_inputEdit->isEnabled())
+	{
+		QDialog::reject();
+		return;
+	}
+
+	// Wait for the engines to stop before closing
+	m_closing = true;
+	if (m_startButton->isEnabled())
+		startOrStop();
+}
+
+void GameAnnotationDialog::changeTimeControl()
+{
+	TimeControlDialog dlg(m_timeControl, this);
+	if (dlg.exec() == QDialog::Accepted)
+	{
+		m_timeControl = dlg.timeControl();
+		m_timeControlButton->setText(m_timeControl.toVerboseString());
+	}
+}
+
+void GameAnnotationDialog::startOrStop()
+{
+	if (!m_inputEdit->isEnabled())
+	{
+		m_startButton->setEnabled(false);
+		m_statusLabel->setText(tr("Stopping..."));
+		m_annotator->stop();
+		return;
+	}
+
+	int index = m_engineCombo->currentIndex();
+	if (index < 0)
+	{
+		QMessageBox::warning(this, tr("Annotate Games"),
+				     tr("No engine selected"));
+		return;
+	}
+	if (m_timeControl.isInfinite() && m_timeControl.nodeLimit() <= 0)
+	{
+		QMessageBox::warning(this, tr("Annotate Games"),
+				     tr("The positions need a time or node limit"));
+		return;
+	}
+
+	EngineManager* engineManager = CuteChessApplication::instance()->engineManager();
+	m_manager->setConcurrency(m_instanceSpin->value());
+	m_annotator->setEngine(engineManager->engineAt(index), m_timeControl);
+	m_annotator->setCheckpointFile(m_checkpointCheck->isChecked() ?
+				       m_outputEdit->text() + ".checkpoint" :
+				       QString());
+
+	if (!m_annotator->start(m_inputEdit->text(), m_outputEdit->text()))
+	{
+		QMessageBox::critical(this, tr("Annotate Games"),
+				      m_annotator->errorString());
+		return;
+	}
+	setRunning(true);
+	onGameAnnotated(m_annotator->gameCount());
+}
+
+void GameAnnotationDialog::onGameAnnotated(int count)
+{
+	m_statusLabel->setText(tr("%n game(s) annotated", "", count));
+}
+
+void GameAnnotationDialog::onFinished()
+{
+	setRunning(false);
+	onGameAnnotated(m_annotator->gameCount());
+
+	if (m_closing)
+	{
+		m_closing = false;
+		close();
+		return;
+	}
+	if (!m_annotator->errorString().isEmpty())
+		QMessageBox::critical(this, tr("Annotate Games"),
+				      m_annotator->errorString());
+}
+
+void GameAnnotationDialog::setRunning(bool running)
+{
+	m_inputEdit->setEnabled(!running);
+	m_outputEdit->setEnabled(!running);
+	m_engineCombo->setEnabled(!running);
+	m_instanceSpin->setEnabled(!running);
+	m_timeControlButton->setEnabled(!running);
+	m_checkpointCheck->setEnabled(!running);
+	m_startButton->setText(running ? tr("Stop") : tr("Start"));
+	m_startButton->setEnabled(true);
+}
@@ -0,0 +1,78 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GAMEANNOTATIONDIALOG_H
+#define GAMEANNOTATIONDIALOG_H
+
+#include <QDialog>
+#include <timecontrol.h>
+class QComboBox;
+class QSpinBox;
+class QCheckBox;
+class QPushButton;
+class QLabel;
+class PathLineEdit;
+class GameManager;
+class GameAnnotator;
+
+/*!
+ * \brief A dialog for annotating a PGN file with engine evaluations.
+ *
+ * The dialog runs a GameAnnotator in its own GameManager, so the
+ * number of engine instances doesn't affect the concurrency of
+ * tournaments. If the dialog is closed while the annotation is
+ * running, the annotation is stopped before the dialog closes.
+ *
+ * \sa GameAnnotator
+ */
+class GameAnnotationDialog : public QDialog
+{
+	Q_OBJECT
+
+	public:
+		/*! Creates a new annotation dialog. */
+		explicit GameAnnotationDialog(QWidget* parent = 0);
+
+	public slots:
+		// Inherited from QDialog
+		virtual void reject();
+
+	private slots:
+		void changeTimeControl();
+		void startOrStop();
+		void onGameAnnotated(int count);
+		void onFinished();
+
+	private:
+		void setRunning(bool running);
+
+		PathLineEdit* m_inputEdit;
+		PathLineEdit* m_outputEdit;
+		QComboBox* m_engineCombo;
+		QSpinBox* m_instanceSpin;
+		QPushButton* m_timeControlButton;
+		QCheckBox* m_checkpointCheck;
+		QLabel* m_statusLabel;
+		QPushButton* m_startButton;
+		GameManager* m_manager;
+		GameAnnotator* m_annotator;
+		TimeControl m_timeControl;
+		bool m_closing;
+};
+
+#endif // GAMEANNOTATIONDIALOG_H
@@ -24,11 +24,14 @@
 #include <QModelIndex>
 #include <QFileDialog>
 #include <QInputDialog>
+#include <QHeaderView>
+#include <QtConcurrentRun>
 
 #include <pgnstream.h>
 #include <pgngame.h>
 #include <pgngameentry.h>
 #include <polyglotbook.h>
+#include <gzipdevice.h>
 
 #include "pgndatabasemodel.h"
 #include "pgngameentrymodel.h"
@@ -39,6 +42,7 @@
 #include "pgndatabase.h"
 #include "gamedatabasesearchdlg.h"
 #include "threadedtask.h"
+#include "gamehashset.h"
 
 class PgnGameIterator
 {
@@ -47,7 +51,8 @@ class PgnGameIterator
 
 		int count() const;
 		bool hasNext() const;
-		PgnGame next(bool* ok, int depth = INT_MAX - 1);
+		PgnGame next(bool* ok, int depth = INT_MAX - 1, quint64* hash = 0);
+		const PgnDatabase* nextEntry(int* index);
 
 	private:
 		const GameDatabaseDialog* m_dlg;
@@ -76,7 +81,7 @@ bool PgnGameIterator::hasNext() const
 	return m_gameIndex < m_gameCount;
 }
 
-PgnGame PgnGameIterator::next(bool* ok, int depth)
+PgnGame PgnGameIterator::next(bool* ok, int depth, quint64* hash)
 {
 	Q_ASSERT(hasNext());
 
@@ -105,12 +110,22 @@ PgnGame PgnGameIterator::next(bool* ok, int depth)
 		return game;
 	}
 
-	const PgnGameEntry* entry = m_dlg->m_pgnGameEntryModel->entryAt(m_gameIndex++);
-	*ok = m_in.seek(entry->pos(), entry->lineNumber()) && game.read(m_in, depth);
+	int index;
+	const PgnDatabase* db = m_dlg->m_pgnGameEntryModel->databaseAt(m_gameIndex++, &index);
+	if (hash != 0)
+		*hash = db->hasGameHashes() ? db->gameHash(index) : 0;
+	*ok = m_in.seek(db->entryPos(index), db->entryLineNumber(index))
+	      && game.read(m_in, depth);
 
 	return game;
 }
 
+const PgnDatabase* PgnGameIterator::nextEntry(int* index)
+{
+	Q_ASSERT(hasNext());
+	return m_dlg->m_pgnGameEntryModel->databaseAt(m_gameIndex++, index);
+}
+
 
 class BookExportTask : public ThreadedTask
 {
@@ -188,38 +203,69 @@ class PgnExportTask : public ThreadedTask
 	public:
 		PgnExportTask(PgnGameIterator* it,
 			      QFile* file,
+			      bool skipDuplicates,
+			      bool rawCopy,
 			      QWidget* parent);
 
 	protected:
 		virtual void run();
 
 	private:
+		int writeGames();
+		int copyGames();
+		bool copyRange(QFile* in, qint64 start, qint64 end, char* last);
+
 		PgnGameIterator* m_it;
 		QFile* m_file;
+		bool m_skipDuplicates;
+		bool m_rawCopy;
 };
 
+// The maximum size of one read when games are copied
+static const qint64 s_copyChunkSize = 4 * 1024 * 1024;
+
 PgnExportTask::PgnExportTask(PgnGameIterator* it,
 			     QFile* file,
+			     bool skipDuplicates,
+			     bool rawCopy,
 			     QWidget* parent)
 	: ThreadedTask(tr("Export Games"),
 		       tr("Writing %1 games to file").arg(it->count()),
 		       0, it->count(),
 		       parent),
 	  m_it(it),
-	  m_file(file)
+	  m_file(file),
+	  m_skipDuplicates(skipDuplicates),
+	  m_rawCopy(rawCopy)
 {
 	m_file->moveToThread(this);
 }
 
 void PgnExportTask::run()
+{
+	int i = m_rawCopy ? copyGames() : writeGames();
+
+	delete m_it;
+	delete m_file;
+
+	emit progressValueChanged(i);
+}
+
+int PgnExportTask::writeGames()
 {
 	QTextStream out(m_file);
+	GameHashSet hashes(m_skipDuplicates ? m_it->count() : 0);
 
 	int i = 0;
 	while (m_it->hasNext())
 	{
 		bool ok;
-		PgnGame game(m_it->next(&ok));
+		quint64 hash;
+		PgnGame game(m_it->next(&ok, INT_MAX - 1, &hash));
+
+		// Games without a hash are always written
+		if (ok && m_skipDuplicates && hash != 0 && !hashes.insert(hash))
+			continue;
 
 		if (ok)
 		{
@@ -233,16 +279,117 @@ void PgnExportTask::run()
 		}
 	}
 
-	delete m_it;
-	delete m_file;
+	return i;
+}
 
-	emit progressValueChanged(i);
+int PgnExportTask::copyGames()
+{
+	// The games are copied from the database files as they are,
+	// and games that follow each other in the same file are copied
+	// as one range
+	GameHashSet hashes(m_skipDuplicates ? m_it->count() : 0);
+	QFile in;
+	const PgnDatabase* rangeDb = 0;
+	qint64 rangeStart = 0;
+	qint64 rangeEnd = 0;
+	char last[2] = { '\n', '\n' };
+	int i = 0;
+
+	forever
+	{
+		const PgnDatabase* db = 0;
+		qint64 start = 0;
+		qint64 end = 0;
+		if (m_it->hasNext())
+		{
+			int index;
+			db = m_it->nextEntry(&index);
+
+			// Games without a hash are always written
+			quint64 hash = db->hasGameHashes() ? db->gameHash(index) : 0;
+			if (m_skipDuplicates && hash != 0 && !hashes.insert(hash))
+				continue;
+
+			// The last game ends where the import ended
+			start = db->entryPos(index);
+			end = (index + 1 < db->entryCount())
+				? db->entryPos(index + 1) : db->importedSize();
+
+			if (++i % 512 == 0)
+			{
+				if (cancelRequested())
+					break;
+				emit progressValueChanged(i);
+			}
+			if (db == rangeDb && start == rangeEnd)
+			{
+				rangeEnd = end;
+				continue;
+			}
+		}
+
+		if (rangeDb != 0)
+		{
+			if (in.fileName() != rangeDb->fileName())
+			{
+				in.close();
+				in.setFileName(rangeDb->fileName());
+				in.open(QIODevice::ReadOnly);
+			}
+			if (!copyRange(&in, rangeStart, rangeEnd, last))
+				break;
+		}
+		if (db == 0)
+			break;
+
+		rangeDb = db;
+		rangeStart = start;
+		rangeEnd = end;
+	}
+
+	return i;
+}
+
+bool PgnExportTask::copyRange(QFile* in, qint64 start, qint64 end, char* last)
+{
+	if (!in->isOpen() || !in->seek(start))
+		return false;
+	if (end <= start)
+		end = in->size();
+
+	// Games from different files are separated by an empty line
+	if (last[1] != '\n')
+		m_file->write("\n\n", 2);
+	else if (last[0] != '\n')
+		m_file->write("\n", 1);
+
+	QByteArray buffer;
+	while (start < end)
+	{
+		buffer = in->read(qMin(end - start, s_copyChunkSize));
+		if (buffer.isEmpty())
+			return false;
+		if (m_file->write(buffer) != buffer.size())
+			return false;
+		start += buffer.size();
+
+		if (buffer.size() >= 2)
+			last[0] = buffer.at(buffer.size() - 2);
+		else
+			last[0] = last[1];
+		last[1] = buffer.at(buffer.size() - 1);
+	}
+
+	return true;
 }
 
 
 GameDatabaseDialog::GameDatabaseDialog(GameDatabaseManager* dbManager, QWidget* parent)
 	: QDialog(parent, Qt::Window),
 	  m_gameViewer(0),
+	  m_selectedGame(-1),
+	  m_loadingGame(-1),
+	  m_loadingDatabase(-1),
 	  m_dbManager(dbManager),
 	  m_pgnDatabaseModel(0),
 	  m_pgnGameEntryModel(0),
@@ -263,6 +410,8 @@ GameDatabaseDialog::GameDatabaseDialog(GameDatabaseManager* dbManager, QWidget*
 	ui->m_gamesListView->setModel(m_pgnGameEntryModel);
 	ui->m_gamesListView->setAlternatingRowColors(true);
 	ui->m_gamesListView->setUniformRowHeights(true);
+	ui->m_gamesListView->header()->setSortIndicator(-1, Qt::AscendingOrder);
+	ui->m_gamesListView->setSortingEnabled(true);
 
 	m_gameViewer = new GameViewer(Qt::Horizontal);
 	ui->m_viewerLayout->insertWidget(0, m_gameViewer);
@@ -298,12 +447,15 @@ GameDatabaseDialog::GameDatabaseDialog(GameDatabaseManager* dbManager, QWidget*
 	connect(m_pgnGameEntryModel, SIGNAL(rowsInserted(const QModelIndex&, int, int)),
 		this, SLOT(updateUi()));
 
+	connect(&m_gameWatcher, SIGNAL(finished()), this, SLOT(onGameLoaded()));
+
 	m_searchTimer.setSingleShot(true);
 	connect(&m_searchTimer, SIGNAL(timeout()), this, SLOT(onSearchTimeout()));
 }
 
 GameDatabaseDialog::~GameDatabaseDialog()
 {
+	m_gameWatcher.waitForFinished();
 	delete ui;
 }
 
@@ -317,16 +469,16 @@ void GameDatabaseDialog::databaseSelectionChanged(const QItemSelection& selected
 
 	if (m_selectedDatabases.isEmpty())
 	{
-		m_pgnGameEntryModel->setEntries(QList<const PgnGameEntry*>());
+		m_pgnGameEntryModel->setDatabases(QList<const PgnDatabase*>());
 		return;
 	}
 
-	QList<const PgnGameEntry*> entries;
+	QList<const PgnDatabase*> databases;
 	QMap<int, PgnDatabase*>::const_iterator it;
 	for (it = m_selectedDatabases.constBegin(); it != m_selectedDatabases.constEnd(); ++it)
-		entries.append(it.value()->entries());
+		databases.append(it.value());
 
-	m_pgnGameEntryModel->setEntries(entries);
+	m_pgnGameEntryModel->setDatabases(databases);
 	ui->m_advancedSearchBtn->setEnabled(true);
 }
 
@@ -338,17 +490,45 @@ void GameDatabaseDialog::gameSelectionChanged(const QModelIndex& current,
 	if (!current.isValid())
 		return;
 
+	m_selectedGame = current.row();
+	if (m_loadingGame == -1)
+		loadSelectedGame();
+}
+
+void GameDatabaseDialog::loadSelectedGame()
+{
 	int databaseIndex;
-	if ((databaseIndex = databaseIndexFromGame(current.row())) == -1)
+	if ((databaseIndex = databaseIndexFromGame(m_selectedGame)) == -1)
 		return;
 
 	PgnDatabase* selectedDatabase = m_dbManager->databases().at(databaseIndex);
+	int entryIndex;
+	m_pgnGameEntryModel->databaseAt(m_selectedGame, &entryIndex);
+
+	m_loadingGame = m_selectedGame;
+	m_loadingDatabase = databaseIndex;
+	m_gameWatcher.setFuture(QtConcurrent::run(selectedDatabase,
+						  &PgnDatabase::game,
+						  entryIndex,
+						  &m_loadedGame));
+}
 
-	PgnGame game;
-	PgnDatabase::Status status;
-	const PgnGameEntry* entry = m_pgnGameEntryModel->entryAt(current.row());
+void GameDatabaseDialog::onGameLoaded()
+{
+	int loadedGame = m_loadingGame;
+	m_loadingGame = -1;
+	if (loadedGame != m_selectedGame)
+	{
+		loadSelectedGame();
+		return;
+	}
+
+	int databaseIndex = m_loadingDatabase;
+	PgnDatabase* selectedDatabase = m_dbManager->databases().at(databaseIndex);
+	const PgnGame& game = m_loadedGame;
+	PgnDatabase::Status status = m_gameWatcher.result();
 
-	if ((status = selectedDatabase->game(entry, &game)) != PgnDatabase::Ok)
+	if (status != PgnDatabase::Ok)
 	{
 		if (status == PgnDatabase::DoesNotExist)
 		{
@@ -443,7 +623,7 @@ int GameDatabaseDialog::databaseIndexFromGame(int game) const
 	QMap<int, PgnDatabase*>::const_iterator it;
 	for (it = m_selectedDatabases.constBegin(); it != m_selectedDatabases.constEnd(); ++it)
 	{
-		game -= it.value()->entries().count();
+		game -= it.value()->entryCount();
 		if (game < 0)
 			return it.key();
 	}
@@ -484,8 +664,38 @@ void GameDatabaseDialog::exportPgn()
 		return;
 	}
 
+	bool skipDuplicates = false;
+	foreach (const PgnDatabase* db, m_selectedDatabases)
+	{
+		if (db->hasGameHashes())
+		{
+			skipDuplicates = QMessageBox::question(this,
+				tr("Export game collection"),
+				tr("Skip the games that duplicate an earlier "
+				   "exported game?"),
+				QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes;
+			break;
+		}
+	}
+
+	// Unmodified, uncompressed databases are copied without parsing
+	// the games
+	bool rawCopy = true;
+	foreach (const PgnDatabase* db, m_selectedDatabases)
+	{
+		QFile dbFile(db->fileName());
+		if (db->status() != PgnDatabase::Ok
+		||  !dbFile.open(QIODevice::ReadOnly)
+		||  GzipDevice::isCompressed(&dbFile))
+		{
+			rawCopy = false;
+			break;
+		}
+	}
+
 	PgnExportTask* task = new PgnExportTask(new PgnGameIterator(this),
-						file, this);
+						file, skipDuplicates, rawCopy,
+						this);
 	task->start();
 }
 
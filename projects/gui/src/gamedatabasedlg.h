@@ -21,13 +21,14 @@
 #include <QDialog>
 #include <QTimer>
 #include <QItemSelection>
+#include <QFutureWatcher>
 
 #include <pgngame.h>
+#include "pgndatabase.h"
 
 class GameDatabaseManager;
 class PgnDatabaseModel;
 class PgnGameEntryModel;
-class PgnDatabase;
 class GameViewer;
 
 namespace Ui {
@@ -62,15 +63,26 @@ class GameDatabaseDialog : public QDialog
 		void exportPgn();
 		void createOpeningBook();
 		void updateUi();
+		void onGameLoaded();
 
 	private:
 		friend class PgnGameIterator;
 		int databaseIndexFromGame(int game) const;
+		void loadSelectedGame();
 
 		GameViewer* m_gameViewer;
 		QVector<PgnGame::MoveData> m_moves;
 		int m_moveIndex;
 
+		// Games are read on a worker thread, one at a time. If the
+		// selection changes during a read, the latest selected game
+		// is read next and the stale result is discarded.
+		QFutureWatcher<PgnDatabase::Status> m_gameWatcher;
+		PgnGame m_loadedGame;
+		int m_selectedGame;
+		int m_loadingGame;
+		int m_loadingDatabase;
+
 		GameDatabaseManager* m_dbManager;
 		PgnDatabaseModel* m_pgnDatabaseModel;
 		PgnGameEntryModel* m_pgnGameEntryModel;
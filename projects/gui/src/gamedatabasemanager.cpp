@@ -17,24 +17,37 @@
 
 #include "gamedatabasemanager.h"
 
+#include <QCoreApplication>
 #include <QFileInfo>
 #include <QDataStream>
+#include <QDir>
+#include <QSet>
+#include <QCryptographicHash>
 
 #include "pgndatabase.h"
 #include "pgnimporter.h"
+#include "gamehashset.h"
+#include "gamedatabasestatereader.h"
 #include <pgngameentry.h>
 
-#define GAME_DATABASE_STATE_MAGIC   0xDEADD00D
-#define GAME_DATABASE_STATE_VERSION 1
-
 GameDatabaseManager::GameDatabaseManager(QObject* parent)
 	: QObject(parent),
-	  m_modified(false)
+	  m_stateReader(0),
+	  m_modified(false),
+	  m_positionIndex(false),
+	  m_openingTree(false),
+	  m_gameHashes(false)
 {
 }
 
 GameDatabaseManager::~GameDatabaseManager()
 {
+	if (m_stateReader != 0)
+	{
+		m_stateReader->abort();
+		waitForState();
+	}
+
 	foreach (PgnImporter* importer, m_pgnImporters)
 	{
 		importer->disconnect();
@@ -51,6 +64,8 @@ QList<PgnDatabase*> GameDatabaseManager::databases() const
 
 bool GameDatabaseManager::writeState(const QString& fileName)
 {
+	waitForState();
+
 	QFile stateFile(fileName);
 
 	if (!stateFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
@@ -66,16 +81,46 @@ bool GameDatabaseManager::writeState(const QString& fileName)
 	// Write the number of databases
 	out << (qint32)m_databases.count();
 
+	// The game entries are stored in one index file per database
+	QDir indexDir(QFileInfo(fileName).absolutePath() + "/gamedb");
+	if (!indexDir.exists())
+		indexDir.mkpath(".");
+
 	// Write the contents of the databases
-	foreach (const PgnDatabase* db, m_databases)
+	QSet<QString> indexFiles;
+	foreach (PgnDatabase* db, m_databases)
 	{
 		out << db->fileName();
 		out << db->lastModified();
 		out << db->displayName();
-		out << (qint32)db->entries().count();
 
-		foreach (const PgnGameEntry* entry, db->entries())
-			entry->write(out);
+		QString indexFile = db->indexFileName();
+		if (indexFile.isEmpty())
+		{
+			QByteArray hash = QCryptographicHash::hash(
+				db->fileName().toUtf8(), QCryptographicHash::Md5);
+			indexFile = indexDir.absoluteFilePath(
+				QString::fromLatin1(hash.toHex()) + ".index");
+			if (!db->saveIndex(indexFile))
+				indexFile.clear();
+		}
+		out << indexFile;
+
+		// Fall back to storing the entries in the state file
+		if (indexFile.isEmpty())
+		{
+			out << (qint32)db->entryCount();
+			db->writeEntries(out);
+		}
+		else
+			indexFiles.insert(QFileInfo(indexFile).fileName());
+	}
+
+	// Remove the index files of databases that are no longer used
+	foreach (const QString& name, indexDir.entryList(QStringList("*.index"), QDir::Files))
+	{
+		if (!indexFiles.contains(name))
+			indexDir.remove(name);
 	}
 
 	m_modified = false;
@@ -85,99 +130,118 @@ bool GameDatabaseManager::writeState(const QString& fileName)
 
 bool GameDatabaseManager::readState(const QString& fileName)
 {
-	QFile stateFile(fileName);
-
-	if (!stateFile.open(QIODevice::ReadOnly))
+	if (m_stateReader != 0 || !QFile::exists(fileName))
 		return false;
 
-	QDataStream in(&stateFile);
-	in.setVersion(QDataStream::Qt_4_6); // don't change
+	m_stateReader = new GameDatabaseStateReader(fileName, this);
+	connect(m_stateReader, SIGNAL(databaseFound(QString, QString)),
+		this, SLOT(onDatabaseFound(QString, QString)));
+	connect(m_stateReader, SIGNAL(databaseLoaded(PgnDatabase*, int)),
+		this, SLOT(onDatabaseLoaded(PgnDatabase*, int)));
+	connect(m_stateReader, SIGNAL(finished()),
+		this, SLOT(onStateReaderFinished()));
 
-	// Read and verify the magic value
-	quint32 magic;
-	in >> magic;
+	m_stateReader->start();
+	return true;
+}
 
-	if (magic != GAME_DATABASE_STATE_MAGIC)
-	{
-		qWarning("GameDatabaseManager: bad magic value in state file");
-		return false;
-	}
+bool GameDatabaseManager::isLoading(const PgnDatabase* database) const
+{
+	return m_loadingDatabases.contains(const_cast<PgnDatabase*>(database));
+}
+
+void GameDatabaseManager::onDatabaseFound(const QString& fileName,
+					  const QString& displayName)
+{
+	// An empty stand-in is shown until the entries are read
+	PgnDatabase* db = new PgnDatabase(fileName);
+	db->setDisplayName(displayName);
+	m_loadingDatabases << db;
 
-	// Read and verify the version number
-	quint32 version;
-	in >> version;
+	m_databases << db;
+	emit databaseAdded(m_databases.count() - 1);
+}
 
-	if (version < GAME_DATABASE_STATE_VERSION ||
-	    version > GAME_DATABASE_STATE_VERSION)
+void GameDatabaseManager::onDatabaseLoaded(PgnDatabase* database, int result)
+{
+	if (m_loadingDatabases.isEmpty())
 	{
-		// TODO: Add backward compatibility
-		qWarning("GameDatabaseManager: state file version mismatch");
-		return false;
+		delete database;
+		return;
 	}
 
-	// Read the number of databases
-	qint32 dbCount;
-	in >> dbCount;
-
-	// Read the contents of the databases
-	QString dbFileName;
-	QDateTime dbLastModified;
-	QString dbDisplayName;
-	QList<PgnDatabase*> readDatabases;
-
-	for (int i = 0; i < dbCount; i++)
+	PgnDatabase* loading = m_loadingDatabases.takeFirst();
+	const QString fileName = loading->fileName();
+	int index = m_databases.indexOf(loading);
+	if (index != -1)
 	{
-		in >> dbFileName;
-		in >> dbLastModified;
-		in >> dbDisplayName;
-
-		// Check if the database exists
-		QFileInfo fileInfo(dbFileName);
-		if (!fileInfo.exists())
-		{
-			m_modified = true;
-			continue;
-		}
+		emit databaseAboutToBeRemoved(index);
+		m_databases.removeAt(index);
+	}
+	loading->deleteLater();
 
-		// Check if the database has been modified
-		if (fileInfo.lastModified() > dbLastModified)
-		{
-			m_modified = true;
-			importPgnFile(dbFileName);
-			continue;
-		}
+	// The database was removed while it was loading
+	if (index == -1)
+	{
+		delete database;
+		return;
+	}
 
-		qint32 dbEntryCount;
-		in >> dbEntryCount;
+	switch (result)
+	{
+	case GameDatabaseStateReader::Loaded:
+	case GameDatabaseStateReader::Appended:
+		m_databases.insert(index, database);
+		emit databaseAdded(index);
+
+		// Import the games that were appended to the file
+		if (result == GameDatabaseStateReader::Appended)
+			updateDatabase(database);
+		break;
+	case GameDatabaseStateReader::Outdated:
+		importPgnFile(fileName);
+		break;
+	default:
+		delete database;
+		break;
+	}
+}
 
-		// Read the entries
-		QList<const PgnGameEntry*> entries;
-		for (int j = 0; j < dbEntryCount; j++)
+void GameDatabaseManager::onStateReaderFinished()
+{
+	// Databases after a corrupted part of the state file are dropped
+	foreach (PgnDatabase* db, m_loadingDatabases)
+	{
+		int index = m_databases.indexOf(db);
+		if (index != -1)
 		{
-			PgnGameEntry* entry = new PgnGameEntry;
-			entry->read(in);
-			entries << entry;
+			emit databaseAboutToBeRemoved(index);
+			m_databases.removeAt(index);
 		}
-
-		PgnDatabase* db = new PgnDatabase(dbFileName);
-		db->setEntries(entries);
-		db->setLastModified(dbLastModified);
-		db->setDisplayName(dbDisplayName);
-
-		readDatabases << db;
+		db->deleteLater();
 	}
+	m_loadingDatabases.clear();
 
-	m_modified = false;
+	m_stateReader->deleteLater();
+	m_stateReader = 0;
+}
 
-	m_databases = readDatabases;
-	emit databasesReset();
+void GameDatabaseManager::waitForState()
+{
+	if (m_stateReader == 0)
+		return;
 
-	return true;
+	// Deliver the databases that are waiting in the event queue
+	m_stateReader->wait();
+	QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
 }
 
 void GameDatabaseManager::importPgnFile(const QString& fileName)
 {
 	PgnImporter* pgnImporter = new PgnImporter(fileName, this);
+	pgnImporter->setPositionIndexEnabled(m_positionIndex);
+	pgnImporter->setOpeningTreeEnabled(m_openingTree);
+	pgnImporter->setGameHashesEnabled(m_gameHashes);
 	m_pgnImporters << pgnImporter;
 
 	connect(pgnImporter, SIGNAL(databaseRead(PgnDatabase*)),
@@ -202,14 +266,125 @@ void GameDatabaseManager::removeDatabase(int index)
 	m_modified = true;
 }
 
+void GameDatabaseManager::updateDatabase(PgnDatabase* database)
+{
+	PgnImporter* pgnImporter = new PgnImporter(database->fileName(), this);
+	pgnImporter->setStartPosition(database->importedSize(),
+				      database->importedLineNumber());
+	pgnImporter->setPositionIndexEnabled(database->hasPositionIndex());
+	pgnImporter->setOpeningTreeEnabled(database->hasOpeningTree());
+	pgnImporter->setGameHashesEnabled(database->hasGameHashes());
+	m_pgnImporters << pgnImporter;
+	m_updatedDatabases[pgnImporter] = database;
+
+	connect(pgnImporter, SIGNAL(databaseRead(PgnDatabase*)),
+		this, SLOT(onDatabaseUpdated(PgnDatabase*)));
+
+	emit importStarted(pgnImporter);
+
+	pgnImporter->start();
+}
+
+void GameDatabaseManager::onDatabaseUpdated(PgnDatabase* newGames)
+{
+	PgnImporter* importer = qobject_cast<PgnImporter*>(sender());
+	PgnDatabase* db = m_updatedDatabases.take(importer);
+	int index = m_databases.indexOf(db);
+
+	if (db == 0 || index == -1)
+	{
+		delete newGames;
+		return;
+	}
+
+	// Views must let go of the database before its columns change
+	removeDatabase(index);
+	db->append(*newGames);
+	delete newGames;
+	addDatabase(db);
+}
+
 void GameDatabaseManager::importDatabaseAgain(int index)
 {
-	const QString fileName = m_databases.at(index)->fileName();
+	PgnDatabase* db = m_databases.at(index);
+	if (db->status() == PgnDatabase::Modified && db->isAppended())
+	{
+		updateDatabase(db);
+		return;
+	}
+
+	const QString fileName = db->fileName();
 
 	removeDatabase(index);
 	importPgnFile(fileName);
 }
 
+bool GameDatabaseManager::isPositionIndexEnabled() const
+{
+	return m_positionIndex;
+}
+
+void GameDatabaseManager::setPositionIndexEnabled(bool enabled)
+{
+	m_positionIndex = enabled;
+}
+
+bool GameDatabaseManager::isOpeningTreeEnabled() const
+{
+	return m_openingTree;
+}
+
+void GameDatabaseManager::setOpeningTreeEnabled(bool enabled)
+{
+	m_openingTree = enabled;
+}
+
+bool GameDatabaseManager::isGameHashesEnabled() const
+{
+	return m_gameHashes;
+}
+
+void GameDatabaseManager::setGameHashesEnabled(bool enabled)
+{
+	m_gameHashes = enabled;
+}
+
+QList<QBitArray> GameDatabaseManager::findDuplicates(int* count) const
+{
+	int total = 0;
+	foreach (const PgnDatabase* db, m_databases)
+	{
+		if (db->hasGameHashes())
+			total += db->entryCount();
+	}
+
+	GameHashSet hashes(total);
+	QList<QBitArray> duplicates;
+	int duplicateCount = 0;
+
+	foreach (const PgnDatabase* db, m_databases)
+	{
+		QBitArray bits;
+		if (db->hasGameHashes())
+		{
+			bits.resize(db->entryCount());
+			for (int i = 0; i < db->entryCount(); i++)
+			{
+				if (!hashes.insert(db->gameHash(i)))
+				{
+					bits.setBit(i);
+					duplicateCount++;
+				}
+			}
+		}
+		duplicates << bits;
+	}
+
+	if (count != 0)
+		*count = duplicateCount;
+	return duplicates;
+}
+
 bool GameDatabaseManager::isModified() const
 {
 	return m_modified;
@@ -20,9 +20,12 @@
 
 #include <QObject>
 #include <QList>
+#include <QMap>
+#include <QBitArray>
 
 class PgnImporter;
 class PgnDatabase;
+class GameDatabaseStateReader;
 
 /*!
  * \brief Manages chess game databases.
@@ -47,15 +50,33 @@ class GameDatabaseManager : public QObject
 		/*!
 		 * Writes the state to a file pointed by \a fileName.
 		 *
+		 * If the state is still being read, this function waits
+		 * for it first.
+		 *
 		 * \sa readState
 		 */
 		bool writeState(const QString& fileName);
 		/*!
 		 * Reads the state from a file pointed by \a fileName.
 		 *
+		 * This function is asynchronous and thus returns immediately.
+		 * The databases are added right away, and they are loading
+		 * until their entries have been read in a separate thread.
+		 * Returns false if the state file doesn't exist or if a
+		 * state is already being read.
+		 *
+		 * \sa isLoading
 		 * \sa writeState
 		 */
 		bool readState(const QString& fileName);
+		/*!
+		 * Returns true if the entries of \a database are still
+		 * being read from the state file.
+		 *
+		 * A loading database has no entries. When it's loaded it
+		 * is replaced with a new database at the same index.
+		 */
+		bool isLoading(const PgnDatabase* database) const;
 
 		/*!
 		 * Imports a game database pointed by \a fileName in PGN format.
@@ -66,6 +87,63 @@ class GameDatabaseManager : public QObject
 		 */
 		void importPgnFile(const QString& fileName);
 
+		/*!
+		 * Returns true if position indexes are built when
+		 * databases are imported.
+		 *
+		 * \sa PgnDatabase::findPosition()
+		 */
+		bool isPositionIndexEnabled() const;
+		/*!
+		 * Enables or disables building position indexes for the
+		 * databases that are imported from now on.
+		 *
+		 * Position indexes are disabled by default.
+		 */
+		void setPositionIndexEnabled(bool enabled);
+		/*!
+		 * Returns true if opening trees are built when databases
+		 * are imported.
+		 *
+		 * \sa PgnDatabase::openingMoves()
+		 */
+		bool isOpeningTreeEnabled() const;
+		/*!
+		 * Enables or disables building opening trees for the
+		 * databases that are imported from now on.
+		 *
+		 * Opening trees are disabled by default.
+		 */
+		void setOpeningTreeEnabled(bool enabled);
+		/*!
+		 * Returns true if game hashes are computed when databases
+		 * are imported.
+		 *
+		 * \sa findDuplicates()
+		 */
+		bool isGameHashesEnabled() const;
+		/*!
+		 * Enables or disables computing game hashes for the
+		 * databases that are imported from now on.
+		 *
+		 * Game hashes are disabled by default.
+		 */
+		void setGameHashesEnabled(bool enabled);
+		/*!
+		 * Finds the duplicate games in the managed databases.
+		 *
+		 * Returns a bit array for each database, in which a set bit
+		 * marks a game with the same starting position and moves as
+		 * an earlier game. Games are in database order, and then in
+		 * file order. Databases without game hashes get an empty
+		 * array and are skipped. If \a count is not null, the total
+		 * number of duplicates is stored in it.
+		 *
+		 * Only the hashes of the games are kept in memory.
+		 *
+		 * \sa PgnDatabase::gameHash()
+		 */
+		QList<QBitArray> findDuplicates(int* count = 0) const;
 		/*! Returns true if the current state has been modified. */
 		bool isModified() const;
 
@@ -83,6 +161,9 @@ class GameDatabaseManager : public QObject
 		/*!
 		 * Re-imports database at \a index from the list of managed
 		 * databases.
+		 *
+		 * If games were only appended to the database file, only
+		 * the new games are imported.
 		 */
 		void importDatabaseAgain(int index);
 
@@ -115,10 +196,26 @@ class GameDatabaseManager : public QObject
 		 */
 		void importStarted(PgnImporter* importer);
 
+	private slots:
+		void onDatabaseUpdated(PgnDatabase* newGames);
+		void onDatabaseFound(const QString& fileName,
+				     const QString& displayName);
+		void onDatabaseLoaded(PgnDatabase* database, int result);
+		void onStateReaderFinished();
+
 	private:
+		void updateDatabase(PgnDatabase* database);
+		void waitForState();
+
 		QList<PgnImporter*> m_pgnImporters;
+		QMap<PgnImporter*, PgnDatabase*> m_updatedDatabases;
 		QList<PgnDatabase*> m_databases;
+		GameDatabaseStateReader* m_stateReader;
+		QList<PgnDatabase*> m_loadingDatabases;
 		bool m_modified;
+		bool m_positionIndex;
+		bool m_openingTree;
+		bool m_gameHashes;
 
 };
 
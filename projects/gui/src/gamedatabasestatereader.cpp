@@ -0,0 +1,156 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "gamedatabasestatereader.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QDateTime>
+
+#include "pgndatabase.h"
+
+GameDatabaseStateReader::GameDatabaseStateReader(const QString& fileName,
+						 QObject* parent)
+	: QThread(parent),
+	  m_fileName(fileName),
+	  m_abort(false)
+{
+}
+
+QString GameDatabaseStateReader::fileName() const
+{
+	return m_fileName;
+}
+
+void GameDatabaseStateReader::abort()
+{
+	m_abort = true;
+}
+
+void GameDatabaseStateReader::run()
+{
+	QFile stateFile(m_fileName);
+
+	if (!stateFile.open(QIODevice::ReadOnly))
+		return;
+
+	QDataStream in(&stateFile);
+	in.setVersion(QDataStream::Qt_4_6); // don't change
+
+	// Read and verify the magic value
+	quint32 magic;
+	in >> magic;
+
+	if (magic != GAME_DATABASE_STATE_MAGIC)
+	{
+		qWarning("GameDatabaseManager: bad magic value in state file");
+		return;
+	}
+
+	// Read and verify the version number
+	quint32 version;
+	in >> version;
+
+	if (version < 1 || version > GAME_DATABASE_STATE_VERSION)
+	{
+		qWarning("GameDatabaseManager: state file version mismatch");
+		return;
+	}
+
+	// Read the number of databases
+	qint32 dbCount;
+	in >> dbCount;
+
+	// Read the contents of the databases
+	QString dbFileName;
+	QDateTime dbLastModified;
+	QString dbDisplayName;
+	QString dbIndexFile;
+
+	for (int i = 0; i < dbCount && !m_abort; i++)
+	{
+		in >> dbFileName;
+		in >> dbLastModified;
+		in >> dbDisplayName;
+
+		dbIndexFile.clear();
+		if (version >= 2)
+			in >> dbIndexFile;
+
+		if (in.status() != QDataStream::Ok)
+		{
+			qWarning("GameDatabaseManager: corrupted state file");
+			break;
+		}
+		emit databaseFound(dbFileName, dbDisplayName);
+
+		// Entries stored in the state file itself must be read
+		// even if the database is discarded.
+		PgnDatabase* db = new PgnDatabase(dbFileName);
+		if (dbIndexFile.isEmpty())
+		{
+			qint32 dbEntryCount;
+			in >> dbEntryCount;
+
+			if (!db->readEntries(in, dbEntryCount))
+			{
+				qWarning("GameDatabaseManager: corrupted state file");
+				delete db;
+				emit databaseLoaded(0, Failed);
+				break;
+			}
+		}
+
+		// Check if the database exists
+		QFileInfo fileInfo(dbFileName);
+		if (!fileInfo.exists())
+		{
+			delete db;
+			emit databaseLoaded(0, Missing);
+			continue;
+		}
+
+		// Check if the index is missing or out of date
+		db->setLastModified(dbLastModified);
+		if (!dbIndexFile.isEmpty() && !db->loadIndex(dbIndexFile))
+		{
+			delete db;
+			emit databaseLoaded(0, Outdated);
+			continue;
+		}
+
+		// Check if the database has been modified. Games that were
+		// appended to the file are imported after it's loaded.
+		if (fileInfo.lastModified() > dbLastModified)
+		{
+			if (!db->isAppended())
+			{
+				delete db;
+				emit databaseLoaded(0, Outdated);
+				continue;
+			}
+			db->setDisplayName(dbDisplayName);
+			emit databaseLoaded(db, Appended);
+			continue;
+		}
+
+		db->setDisplayName(dbDisplayName);
+		emit databaseLoaded(db, Loaded);
+	}
+}
@@ -0,0 +1,93 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GAME_DATABASE_STATE_READER_H
+#define GAME_DATABASE_STATE_READER_H
+
+#include <QThread>
+#include <QString>
+
+class PgnDatabase;
+
+#define GAME_DATABASE_STATE_MAGIC   0xDEADD00D
+#define GAME_DATABASE_STATE_VERSION 2
+
+/*!
+ * \brief Reads the game database state file in a separate thread.
+ *
+ * The databases are reported in the order of the state file. Each
+ * database is announced with databaseFound() as soon as its name is
+ * known, and handed over with databaseLoaded() when its entries have
+ * been read.
+ *
+ * \sa GameDatabaseManager::readState()
+ */
+class GameDatabaseStateReader : public QThread
+{
+	Q_OBJECT
+
+	public:
+		/*! The outcome of loading a database. */
+		enum Result
+		{
+			Loaded,		//!< The database is up to date
+			Appended,	//!< Games were appended to the file
+			Outdated,	//!< The database must be imported again
+			Missing,	//!< The database file no longer exists
+			Failed		//!< The state file is corrupted
+		};
+
+		/*!
+		 * Constructs a GameDatabaseStateReader with \a parent and
+		 * \a fileName as the state file to be read.
+		 */
+		GameDatabaseStateReader(const QString& fileName,
+					QObject* parent = 0);
+
+		/*! Returns the file name of the state file. */
+		QString fileName() const;
+
+		// Inherited from QThread
+		virtual void run();
+
+	public slots:
+		/*! Stops reading after the current database. */
+		void abort();
+
+	signals:
+		/*!
+		 * Emitted when a database called \a displayName is found
+		 * in the state file. \a fileName is the PGN file.
+		 */
+		void databaseFound(const QString& fileName,
+				   const QString& displayName);
+		/*!
+		 * Emitted when the entries of the last found database are
+		 * read into \a database.
+		 *
+		 * \a result is a Result value. Unless it is \a Loaded or
+		 * \a Appended, \a database is null.
+		 */
+		void databaseLoaded(PgnDatabase* database, int result);
+
+	private:
+		QString m_fileName;
+		volatile bool m_abort;
+};
+
+#endif // GAME_DATABASE_STATE_READER_H
@@ -0,0 +1,73 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gamehashset.h"
+
+// The table is grown when it's more than 3/4 full
+static int tableSize(int count)
+{
+	return qMax(16, count + count / 3 + 1);
+}
+
+GameHashSet::GameHashSet(int count)
+	: m_table(tableSize(count), 0),
+	  m_size(0)
+{
+}
+
+bool GameHashSet::insert(quint64 hash)
+{
+	// Zero marks an empty slot
+	if (hash == 0)
+		hash = 1;
+
+	if (m_size + 1 > m_table.size() - m_table.size() / 4)
+		grow();
+
+	quint64* table = m_table.data();
+	const int size = m_table.size();
+	int i = int(hash % quint64(size));
+	while (table[i] != 0)
+	{
+		if (table[i] == hash)
+			return false;
+		if (++i == size)
+			i = 0;
+	}
+
+	table[i] = hash;
+	m_size++;
+	return true;
+}
+
+int GameHashSet::size() const
+{
+	return m_size;
+}
+
+void GameHashSet::grow()
+{
+	QVector<quint64> old(m_table);
+	m_table = QVector<quint64>(tableSize(m_size * 2), 0);
+	m_size = 0;
+
+	foreach (quint64 hash, old)
+	{
+		if (hash != 0)
+			insert(hash);
+	}
+}
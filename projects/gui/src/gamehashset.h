@@ -0,0 +1,56 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAME_HASH_SET_H
+#define GAME_HASH_SET_H
+
+#include <QVector>
+
+/*!
+ * \brief A compact set of game hashes.
+ *
+ * GameHashSet is an open addressing hash table of 64-bit game hashes
+ * with linear probing. It stores nothing but the hashes, so finding
+ * duplicates among tens of millions of games takes about 11 bytes
+ * per game, regardless of the length of the games.
+ *
+ * \sa PgnDatabase::gameHash()
+ */
+class GameHashSet
+{
+	public:
+		/*! Creates a set with room for \a count hashes. */
+		explicit GameHashSet(int count);
+
+		/*!
+		 * Inserts \a hash into the set.
+		 *
+		 * Returns false if the set already contains \a hash;
+		 * otherwise returns true.
+		 */
+		bool insert(quint64 hash);
+		/*! Returns the number of hashes in the set. */
+		int size() const;
+
+	private:
+		void grow();
+
+		QVector<quint64> m_table;
+		int m_size;
+};
+
+#endif // GAME_HASH_SET_H
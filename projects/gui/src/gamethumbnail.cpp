@@ -0,0 +1,222 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "gamethumbnail.h"
+#include <QPainter>
+#include <QTime>
+#include <chessgame.h>
+#include <board/board.h>
+#include <board/boardfactory.h>
+#include "boardview/piececache.h"
+
+namespace {
+
+const QColor s_lightColor("#ffce9e");
+const QColor s_darkColor("#d18b47");
+const QColor s_moveColor(255, 255, 0, 90);
+const int s_headerHeight = 18;
+
+} // anonymous namespace
+
+
+GameThumbnail::GameThumbnail(ChessGame* game, QWidget* parent)
+	: QWidget(parent),
+	  m_slot(game->snapshotSlot()),
+	  m_serial(-1),
+	  m_board(0),
+	  m_dirty(true)
+{
+	setAttribute(Qt::WA_OpaquePaintEvent, true);
+	connect(PieceCache::instance(), SIGNAL(themeChanged()),
+		this, SLOT(onThemeChanged()));
+	refresh();
+}
+
+GameThumbnail::~GameThumbnail()
+{
+	delete m_board;
+}
+
+QSize GameThumbnail::sizeHint() const
+{
+	return QSize(200, 200 + s_headerHeight * 2);
+}
+
+QString GameThumbnail::clockText(int index) const
+{
+	if (m_snapshot.infiniteTime[index])
+		return QString::fromUtf8("\xE2\x88\x9E");
+
+	int timeLeft = m_snapshot.timeLeft[index];
+	if (index == m_snapshot.thinkingSide)
+		timeLeft -= int(m_snapshot.thinkingTime.elapsed());
+
+	QTime time = QTime(0, 0).addMSecs(qAbs(timeLeft + 500));
+	QString str(time.toString(time.hour() > 0 ? "hh:mm:ss" : "mm:ss"));
+	if (timeLeft <= -500)
+		str.prepend('-');
+	return str;
+}
+
+void GameThumbnail::updatePosition()
+{
+	if (m_snapshot.fen.isEmpty())
+		return;
+
+	if (m_board != 0 && m_board->variant() != m_snapshot.variant)
+	{
+		delete m_board;
+		m_board = 0;
+	}
+	if (m_board == 0)
+		m_board = Chess::BoardFactory::create(m_snapshot.variant);
+	if (m_board != 0 && !m_board->setFenString(m_snapshot.fen))
+	{
+		delete m_board;
+		m_board = 0;
+	}
+}
+
+void GameThumbnail::refresh()
+{
+	int serial = m_slot->serial();
+	if (serial != m_serial)
+	{
+		QString fen(m_snapshot.fen);
+		m_snapshot = m_slot->snapshot();
+		m_serial = serial;
+
+		if (m_snapshot.fen != fen)
+		{
+			updatePosition();
+			m_dirty = true;
+		}
+		else
+			update();
+	}
+
+	if (m_dirty)
+	{
+		renderBoard();
+		m_dirty = false;
+		update();
+	}
+	// A running clock is repainted on every frame, which is cheap
+	// without a board redraw
+	else if (!m_snapshot.thinkingSide.isNull()
+	     &&  !m_snapshot.infiniteTime[m_snapshot.thinkingSide])
+		update();
+}
+
+void GameThumbnail::onThemeChanged()
+{
+	m_dirty = true;
+}
+
+void GameThumbnail::renderBoard()
+{
+	int side = qMin(width(), height() - s_headerHeight * 2);
+	if (m_board == 0 || side <= 0)
+	{
+		m_image = QImage();
+		return;
+	}
+
+	int files = m_board->width();
+	int ranks = m_board->height();
+	int squareSize = side / qMax(files, ranks);
+	if (squareSize <= 0)
+	{
+		m_image = QImage();
+		return;
+	}
+
+	m_image = QImage(squareSize * files, squareSize * ranks,
+			 QImage::Format_ARGB32_Premultiplied);
+	QPainter painter(&m_image);
+
+	// White is always at the bottom
+	for (int y = 0; y < ranks; y++)
+	{
+		for (int x = 0; x < files; x++)
+		{
+			QRect rect(x * squareSize, (ranks - 1 - y) * squareSize,
+				   squareSize, squareSize);
+			painter.fillRect(rect, (x % 2) != (y % 2) ? s_lightColor
+								  : s_darkColor);
+
+			Chess::Square square(x, y);
+			if (square == m_snapshot.lastMove.sourceSquare()
+			||  square == m_snapshot.lastMove.targetSquare())
+				painter.fillRect(rect, s_moveColor);
+
+			Chess::Piece piece(m_board->pieceAt(square));
+			if (piece.isValid())
+				painter.drawPixmap(rect.topLeft(),
+						   PieceCache::instance()->pixmap(
+							m_board->pieceSymbol(piece),
+							squareSize));
+		}
+	}
+}
+
+void GameThumbnail::paintEvent(QPaintEvent* event)
+{
+	Q_UNUSED(event);
+
+	QPainter painter(this);
+	painter.fillRect(rect(), palette().color(QPalette::Window));
+
+	// Black's name and clock above the board, White's below it
+	QFontMetrics metrics(font());
+	for (int i = 0; i < 2; i++)
+	{
+		int top = (i == Chess::Side::Black) ? 0 : height() - s_headerHeight;
+		QRect rect(2, top, width() - 4, s_headerHeight);
+		QString clock(clockText(i));
+		bool thinking = (i == m_snapshot.thinkingSide);
+		int clockWidth = metrics.width(clock);
+
+		painter.setPen(palette().color(QPalette::WindowText));
+		if (thinking)
+		{
+			painter.fillRect(rect.adjusted(-2, 0, 2, 0),
+					 palette().color(QPalette::Highlight));
+			painter.setPen(palette().color(QPalette::HighlightedText));
+		}
+		painter.drawText(rect.adjusted(0, 0, -clockWidth - 6, 0),
+				 Qt::AlignLeft | Qt::AlignVCenter,
+				 metrics.elidedText(m_snapshot.playerName[i], Qt::ElideRight,
+						    rect.width() - clockWidth - 6));
+		painter.drawText(rect, Qt::AlignRight | Qt::AlignVCenter, clock);
+	}
+
+	if (!m_image.isNull())
+	{
+		int x = (width() - m_image.width()) / 2;
+		int y = s_headerHeight
+		      + (height() - s_headerHeight * 2 - m_image.height()) / 2;
+		painter.drawImage(x, y, m_image);
+	}
+}
+
+void GameThumbnail::resizeEvent(QResizeEvent* event)
+{
+	QWidget::resizeEvent(event);
+	m_dirty = true;
+}
@@ -0,0 +1,82 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GAMETHUMBNAIL_H
+#define GAMETHUMBNAIL_H
+
+#include <QWidget>
+#include <QImage>
+#include <QSharedPointer>
+#include <gamesnapshot.h>
+class ChessGame;
+namespace Chess { class Board; }
+
+/*!
+ * \brief A lightweight live view of a chess game.
+ *
+ * GameThumbnail is a cheap alternative to a BoardView and two
+ * ChessClock widgets for the game wall. It doesn't connect to the
+ * game's signals: the owner calls refresh() at a fixed frame rate,
+ * and the thumbnail polls the game's GameSnapshotSlot. The position
+ * is painted into a single QImage with pieces from the shared
+ * PieceCache, only when it has changed. Moves
+ * aren't animated.
+ */
+class GameThumbnail : public QWidget
+{
+	Q_OBJECT
+
+	public:
+		/*! Creates a new thumbnail of \a game. */
+		explicit GameThumbnail(ChessGame* game, QWidget* parent = 0);
+		/*! Destroys the thumbnail. */
+		virtual ~GameThumbnail();
+
+		// Inherited from QWidget
+		virtual QSize sizeHint() const;
+
+	public slots:
+		/*!
+		 * Fetches the latest snapshot of the game, redraws the
+		 * board image if the position has changed and repaints
+		 * the widget if anything visible has changed.
+		 */
+		void refresh();
+
+	protected:
+		// Inherited from QWidget
+		virtual void paintEvent(QPaintEvent* event);
+		virtual void resizeEvent(QResizeEvent* event);
+
+	private slots:
+		void onThemeChanged();
+
+	private:
+		void updatePosition();
+		void renderBoard();
+		QString clockText(int index) const;
+
+		QSharedPointer<GameSnapshotSlot> m_slot;
+		GameSnapshot m_snapshot;
+		int m_serial;
+		Chess::Board* m_board;
+		QImage m_image;
+		bool m_dirty;
+};
+
+#endif // GAMETHUMBNAIL_H
@@ -23,9 +23,13 @@
 #include <pgngame.h>
 #include <chessgame.h>
 #include <chessplayer.h>
+#include <board/board.h>
 #include "boardview/boardscene.h"
 #include "boardview/boardview.h"
 
+// Number of plies between position snapshots
+static const int s_snapshotInterval = 16;
+
 GameViewer::GameViewer(Qt::Orientation orientation, QWidget* parent)
 	: QWidget(parent),
 	  m_moveNumberSlider(new QSlider(Qt::Horizontal)),
@@ -33,7 +37,9 @@ GameViewer::GameViewer(Qt::Orientation orientation, QWidget* parent)
 	  m_viewPreviousMoveBtn(new QToolButton),
 	  m_viewNextMoveBtn(new QToolButton),
 	  m_viewLastMoveBtn(new QToolButton),
-	  m_moveIndex(0)
+	  m_moveIndex(0),
+	  m_board(0),
+	  m_baseIndex(0)
 {
 	#ifdef Q_OS_MAC
 	setStyleSheet("QToolButton:!hover { border: none; }");
@@ -108,6 +114,11 @@ GameViewer::GameViewer(Qt::Orientation orientation, QWidget* parent)
 	setLayout(layout);
 }
 
+GameViewer::~GameViewer()
+{
+	delete m_board;
+}
+
 void GameViewer::setGame(ChessGame* game)
 {
 	Q_ASSERT(game != 0);
@@ -146,19 +157,27 @@ void GameViewer::setGame(const PgnGame* pgn)
 	m_boardScene->setBoard(pgn->createBoard());
 	m_boardScene->populate();
 	m_moveIndex = 0;
+	m_baseIndex = 0;
+
+	delete m_board;
+	m_board = pgn->createBoard();
+	m_variant = pgn->variant();
+	m_startingFen.clear();
+	m_snapshots.clear();
+	if (m_board != 0)
+	{
+		m_startingFen = m_board->fenString();
+		m_snapshots.append(m_startingFen);
+	}
 
 	m_moves.clear();
 	foreach (const PgnGame::MoveData& md, pgn->moves())
-		m_moves.append(md.move);
-
-	m_viewFirstMoveBtn->setEnabled(false);
-	m_viewPreviousMoveBtn->setEnabled(false);
-	m_viewNextMoveBtn->setEnabled(!m_moves.isEmpty());
-	m_viewLastMoveBtn->setEnabled(!m_moves.isEmpty());
+		appendMove(md.move);
 
 	m_moveNumberSlider->setEnabled(!m_moves.isEmpty());
 	m_moveNumberSlider->setMaximum(m_moves.count());
 	m_moveNumberSlider->setValue(0);
+	updateControls();
 }
 
 void GameViewer::disconnectGame()
@@ -181,6 +200,46 @@ void GameViewer::disconnectGame()
 	m_game = 0;
 }
 
+void GameViewer::appendMove(const Chess::GenericMove& move)
+{
+	m_moves.append(move);
+	if (m_board == 0)
+		return;
+
+	Chess::Move boardMove(m_board->moveFromGenericMove(move));
+	if (boardMove.isNull())
+	{
+		// Stop taking snapshots. The positions after an illegal
+		// move can still be reached one move at a time.
+		delete m_board;
+		m_board = 0;
+		return;
+	}
+
+	m_board->makeMove(boardMove);
+	if (m_moves.count() % s_snapshotInterval == 0)
+		m_snapshots.append(m_board->fenString());
+}
+
+void GameViewer::updateControls()
+{
+	bool atStart = (m_moveIndex == 0);
+	bool atEnd = (m_moveIndex >= m_moves.count());
+
+	m_viewFirstMoveBtn->setEnabled(!atStart);
+	m_viewPreviousMoveBtn->setEnabled(!atStart);
+	m_viewNextMoveBtn->setEnabled(!atEnd);
+	m_viewLastMoveBtn->setEnabled(!atEnd);
+
+	m_boardView->setEnabled(atEnd && !m_game.isNull()
+				&& !m_game->isFinished()
+				&& m_game->playerToMove()->isHuman());
+
+	m_moveNumberSlider->setSliderPosition(m_moveIndex);
+
+	emit positionChanged(m_variant, m_startingFen, m_moves.mid(0, m_moveIndex));
+}
+
 void GameViewer::viewFirstMoveClicked()
 {
 	viewFirstMove();
@@ -189,8 +248,7 @@ void GameViewer::viewFirstMoveClicked()
 
 void GameViewer::viewFirstMove()
 {
-	while (m_moveIndex > 0)
-		viewPreviousMove();
+	viewPosition(0);
 }
 
 void GameViewer::viewPreviousMoveClicked()
@@ -201,21 +259,7 @@ void GameViewer::viewPreviousMoveClicked()
 
 void GameViewer::viewPreviousMove()
 {
-	m_moveIndex--;
-
-	if (m_moveIndex == 0)
-	{
-		m_viewPreviousMoveBtn->setEnabled(false);
-		m_viewFirstMoveBtn->setEnabled(false);
-	}
-
-	m_boardScene->undoMove();
-
-	m_viewNextMoveBtn->setEnabled(true);
-	m_viewLastMoveBtn->setEnabled(true);
-	m_boardView->setEnabled(false);
-
-	m_moveNumberSlider->setSliderPosition(m_moveIndex);
+	viewPosition(m_moveIndex - 1);
 }
 
 void GameViewer::viewNextMoveClicked()
@@ -226,22 +270,7 @@ void GameViewer::viewNextMoveClicked()
 
 void GameViewer::viewNextMove()
 {
-	m_boardScene->makeMove(m_moves.at(m_moveIndex++));
-
-	m_viewPreviousMoveBtn->setEnabled(true);
-	m_viewFirstMoveBtn->setEnabled(true);
-
-	if (m_moveIndex >= m_moves.count())
-	{
-		m_viewNextMoveBtn->setEnabled(false);
-		m_viewLastMoveBtn->setEnabled(false);
-
-		if (!m_game.isNull()
-		&&  !m_game->isFinished() && m_game->playerToMove()->isHuman())
-			m_boardView->setEnabled(true);
-	}
-
-	m_moveNumberSlider->setSliderPosition(m_moveIndex);
+	viewPosition(m_moveIndex + 1);
 }
 
 void GameViewer::viewLastMoveClicked()
@@ -252,8 +281,7 @@ void GameViewer::viewLastMoveClicked()
 
 void GameViewer::viewLastMove()
 {
-	while (m_moveIndex < m_moves.count())
-		viewNextMove();
+	viewPosition(m_moves.count());
 }
 
 void GameViewer::viewPositionClicked(int index)
@@ -262,40 +290,66 @@ void GameViewer::viewPositionClicked(int index)
 	emit moveSelected(m_moveIndex - 1);
 }
 
+void GameViewer::viewSnapshot(int index)
+{
+	if (m_snapshots.isEmpty())
+		return;
+
+	// Use the last snapshot before the position so that at least
+	// one move is made on the scene and the last move is highlighted
+	int i = index > 0 ? (index - 1) / s_snapshotInterval : 0;
+	i = qMin(i, m_snapshots.count() - 1);
+
+	m_boardScene->setFenString(m_snapshots.at(i));
+	m_baseIndex = i * s_snapshotInterval;
+	m_moveIndex = m_baseIndex;
+}
+
 void GameViewer::viewPosition(int index)
 {
-	if (m_moves.isEmpty())
+	if (m_moves.isEmpty() || index == m_moveIndex)
 		return;
+	Q_ASSERT(index >= 0 && index <= m_moves.count());
+
+	if (index < m_baseIndex
+	||  qAbs(index - m_moveIndex) > s_snapshotInterval)
+		viewSnapshot(index);
 
 	while (index < m_moveIndex)
-		viewPreviousMove();
+	{
+		m_boardScene->undoMove();
+		m_moveIndex--;
+	}
 	while (index > m_moveIndex)
-		viewNextMove();
+		m_boardScene->makeMove(m_moves.at(m_moveIndex++));
+
+	updateControls();
 }
 
 void GameViewer::viewMove(int index)
 {
 	Q_ASSERT(!m_moves.isEmpty());
 
+	// We backtrack one move too far and then make one
+	// move forward to highlight the correct move
 	if (index < m_moveIndex)
-	{
-		// We backtrack one move too far and then make one
-		// move forward to highlight the correct move
-		while (index < m_moveIndex)
-			viewPreviousMove();
-		viewNextMove();
-	}
-	else
-	{
-		while (index + 1 > m_moveIndex)
-			viewNextMove();
-	}
+		viewPosition(index);
+	viewPosition(index + 1);
 }
 
 void GameViewer::onFenChanged(const QString& fen)
 {
 	m_moves.clear();
 	m_moveIndex = 0;
+	m_baseIndex = 0;
+
+	m_snapshots.clear();
+	m_startingFen.clear();
+	if (m_board != 0 && m_board->setFenString(fen))
+	{
+		m_startingFen = fen;
+		m_snapshots.append(fen);
+	}
 
 	m_viewFirstMoveBtn->setEnabled(false);
 	m_viewPreviousMoveBtn->setEnabled(false);
@@ -305,11 +359,12 @@ void GameViewer::onFenChanged(const QString& fen)
 	m_moveNumberSlider->setMaximum(0);
 
 	m_boardScene->setFenString(fen);
+	emit positionChanged(m_variant, m_startingFen, m_moves);
 }
 
 void GameViewer::onMoveMade(const Chess::GenericMove& move)
 {
-	m_moves.append(move);
+	appendMove(move);
 
 	m_moveNumberSlider->setEnabled(true);
 	m_moveNumberSlider->setMaximum(m_moves.count());
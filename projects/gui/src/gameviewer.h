@@ -28,6 +28,7 @@ class ChessGame;
 class PgnGame;
 class BoardScene;
 class BoardView;
+namespace Chess { class Board; }
 
 class GameViewer : public QWidget
 {
@@ -36,6 +37,7 @@ class GameViewer : public QWidget
 	public:
 		explicit GameViewer(Qt::Orientation orientation = Qt::Horizontal,
 				    QWidget* parent = 0);
+		virtual ~GameViewer();
 
 		void setGame(ChessGame* game);
 		void setGame(const PgnGame* pgn);
@@ -46,6 +48,16 @@ class GameViewer : public QWidget
 
 	signals:
 		void moveSelected(int moveNumber);
+		/*!
+		 * Emitted when the viewed position changes.
+		 *
+		 * The position is reached by playing \a moves from
+		 * \a startingFen in \a variant. \a startingFen is empty if
+		 * the game can't be replayed.
+		 */
+		void positionChanged(const QString& variant,
+				     const QString& startingFen,
+				     const QVector<Chess::GenericMove>& moves);
 
 	private slots:
 		void viewFirstMoveClicked();
@@ -63,6 +75,9 @@ class GameViewer : public QWidget
 		void viewNextMove();
 		void viewLastMove();
 		void viewPosition(int index);
+		void viewSnapshot(int index);
+		void updateControls();
+		void appendMove(const Chess::GenericMove& move);
 
 		BoardScene* m_boardScene;
 		BoardView* m_boardView;
@@ -76,6 +91,16 @@ class GameViewer : public QWidget
 		QPointer<ChessGame> m_game;
 		QVector<Chess::GenericMove> m_moves;
 		int m_moveIndex;
+
+		// Positions (FEN strings) at every Nth ply of the game. They
+		// let the viewer jump to any move without replaying the whole
+		// game on the scene. Moves before m_baseIndex can't be undone
+		// on the scene; they're reached through a snapshot instead.
+		Chess::Board* m_board;
+		QVector<QString> m_snapshots;
+		int m_baseIndex;
+		QString m_variant;
+		QString m_startingFen;
 };
 
 #endif // GAMEVIEWER_H
@@ -18,6 +18,7 @@
 #include "gamewall.h"
 
 #include <QTimer>
+#include <QAction>
 
 #include <chessplayer.h>
 #include <chessgame.h>
@@ -27,15 +28,35 @@
 #include "boardview/boardscene.h"
 #include "boardview/boardview.h"
 #include "chessclock.h"
+#include "gamethumbnail.h"
+
+// Thumbnails are used by default when a wall is opened with more
+// active games than this
+static const int s_thumbnailThreshold = 16;
+// Thumbnail redraw interval in milliseconds
+static const int s_frameInterval = 200;
 
 GameWall::GameWall(GameManager* manager, QWidget *parent)
 	: QWidget(parent),
-	  m_timer(new QTimer(this))
+	  m_timer(new QTimer(this)),
+	  m_frameTimer(new QTimer(this)),
+	  m_thumbnailAct(new QAction(tr("Thumbnails"), this)),
+	  m_thumbnails(false)
 {
 	setAttribute(Qt::WA_DeleteOnClose, true);
 	setWindowTitle(tr("Game Wall"));
 	setLayout(new TileLayout());
 
+	m_thumbnails = manager->activeGames().size() > s_thumbnailThreshold;
+	m_thumbnailAct->setCheckable(true);
+	m_thumbnailAct->setChecked(m_thumbnails);
+	connect(m_thumbnailAct, SIGNAL(toggled(bool)),
+		this, SLOT(setThumbnailMode(bool)));
+	addAction(m_thumbnailAct);
+	setContextMenuPolicy(Qt::ActionsContextMenu);
+
+	m_frameTimer->setInterval(s_frameInterval);
+
 	foreach (ChessGame* game, manager->activeGames())
 		addGame(game);
 
@@ -53,9 +74,48 @@ void GameWall::addGame(ChessGame* game)
 {
 	Q_ASSERT(game != 0);
 
+	QWidget* widget;
+	if (m_thumbnails)
+	{
+		GameThumbnail* thumbnail = new GameThumbnail(game, this);
+		connect(m_frameTimer, SIGNAL(timeout()),
+			thumbnail, SLOT(refresh()));
+		if (!m_frameTimer->isActive())
+			m_frameTimer->start();
+		widget = thumbnail;
+	}
+	else
+		widget = createBoardWidget(game);
+
+	layout()->addWidget(widget);
+	m_games[game] = widget;
+
+	cleanupWidgets();
+}
+
+void GameWall::setThumbnailMode(bool enabled)
+{
+	if (enabled == m_thumbnails)
+		return;
+
+	m_thumbnails = enabled;
+	m_thumbnailAct->setChecked(enabled);
+	if (!enabled)
+		m_frameTimer->stop();
+
+	QList<ChessGame*> games(m_games.keys());
+	foreach (ChessGame* game, games)
+	{
+		delete m_games.take(game);
+		addGame(game);
+	}
+}
+
+QWidget* GameWall::createBoardWidget(ChessGame* game)
+{
 	QWidget* widget = new QWidget(this);
 
-	ChessClock* clock[2] = { new ChessClock(), new ChessClock() };
+	ChessClock* clock[2];
 	QHBoxLayout* clockLayout = new QHBoxLayout();
 	for (int i = 0; i < 2; i++)
 	{
@@ -76,7 +136,6 @@ void GameWall::addGame(ChessGame* game)
 	mainLayout->setContentsMargins(0, 0, 0, 0);
 
 	widget->setLayout(mainLayout);
-	layout()->addWidget(widget);
 
 	game->lockThread();
 	connect(game, SIGNAL(fenChanged(QString)),
@@ -121,9 +180,8 @@ void GameWall::addGame(ChessGame* game)
 
 	view->setEnabled(!game->isFinished() &&
 			 game->playerToMove()->isHuman());
-	m_games[game] = widget;
 
-	cleanupWidgets();
+	return widget;
 }
 
 void GameWall::removeGame(ChessGame* game)
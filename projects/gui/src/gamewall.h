@@ -22,6 +22,7 @@
 #include <QMap>
 #include <QList>
 class QTimer;
+class QAction;
 class ChessGame;
 class GameManager;
 
@@ -36,14 +37,27 @@ class GameWall : public QWidget
 	public slots:
 		void addGame(ChessGame* game);
 		void removeGame(ChessGame* game);
+		/*!
+		 * Shows the games as lightweight thumbnails if \a enabled
+		 * is true, or as full board views otherwise.
+		 *
+		 * Thumbnails are redrawn at a fixed frame rate without
+		 * animations, so the wall scales to hundreds of games.
+		 */
+		void setThumbnailMode(bool enabled);
 
 	private slots:
 		void cleanupWidgets();
 
 	private:
+		QWidget* createBoardWidget(ChessGame* game);
+
 		QMap<ChessGame*, QWidget*> m_games;
 		QList<QWidget*> m_gamesToRemove;
 		QTimer* m_timer;
+		QTimer* m_frameTimer;
+		QAction* m_thumbnailAct;
+		bool m_thumbnails;
 };
 
 #endif // GAMEWALL_H
@@ -0,0 +1,200 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "logmodel.h"
+#include <QTimer>
+
+// Time between two batches of new messages, in milliseconds
+static const int s_flushInterval = 100;
+
+LogModel::LogModel(int capacity, QObject* parent)
+	: QAbstractListModel(parent),
+	  m_capacity(qMax(1, capacity)),
+	  m_entries(m_capacity),
+	  m_firstSeq(0),
+	  m_count(0),
+	  m_flushTimer(new QTimer(this))
+{
+	m_flushTimer->setSingleShot(true);
+	m_flushTimer->setInterval(s_flushInterval);
+	connect(m_flushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+int LogModel::capacity() const
+{
+	return m_capacity;
+}
+
+QStringList LogModel::sources() const
+{
+	return m_sources;
+}
+
+QStringList LogModel::messages() const
+{
+	QStringList list;
+	for (qint64 seq = m_firstSeq; seq < m_firstSeq + m_count; seq++)
+		list.append(entry(seq).message);
+
+	return list;
+}
+
+void LogModel::setSourceFilter(const QString& source)
+{
+	flush();
+
+	beginResetModel();
+	m_filter = source;
+	m_rows.clear();
+	if (!m_filter.isEmpty())
+	{
+		for (qint64 seq = m_firstSeq; seq < m_firstSeq + m_count; seq++)
+		{
+			if (entry(seq).source == m_filter)
+				m_rows.append(seq);
+		}
+	}
+	endResetModel();
+}
+
+int LogModel::rowCount(const QModelIndex& parent) const
+{
+	if (parent.isValid())
+		return 0;
+	return m_filter.isEmpty() ? m_count : m_rows.size();
+}
+
+QVariant LogModel::data(const QModelIndex& index, int role) const
+{
+	// Long lines are elided, so they're also shown as tool tips
+	if (!index.isValid()
+	||  (role != Qt::DisplayRole && role != Qt::ToolTipRole))
+		return QVariant();
+
+	qint64 seq = m_filter.isEmpty() ? m_firstSeq + index.row()
+					: m_rows.at(index.row());
+	return entry(seq).message;
+}
+
+void LogModel::append(const QString& source, const QString& message)
+{
+	Entry entry = { source, message };
+	m_pending.append(entry);
+
+	if (!m_sources.contains(source))
+	{
+		m_sources.append(source);
+		emit sourceAdded(source);
+	}
+	if (!m_flushTimer->isActive())
+		m_flushTimer->start();
+}
+
+void LogModel::flush()
+{
+	m_flushTimer->stop();
+	if (m_pending.isEmpty())
+		return;
+
+	QStringList batch;
+	foreach (const Entry& entry, m_pending)
+		batch.append(entry.message);
+	emit messagesAdded(batch);
+
+	// Only the newest messages of a big batch fit in the buffer
+	int skip = qMax(0, m_pending.size() - m_capacity);
+	qint64 endSeq = m_firstSeq + m_count + m_pending.size();
+	removeOldRows(qMax(m_firstSeq, endSeq - m_capacity));
+
+	int count = m_pending.size() - skip;
+	qint64 seq = m_firstSeq + m_count;
+	QList<qint64> matches;
+	for (int i = skip; i < m_pending.size(); i++, seq++)
+	{
+		m_entries[int(seq % m_capacity)] = m_pending.at(i);
+		if (!m_filter.isEmpty() && m_pending.at(i).source == m_filter)
+			matches.append(seq);
+	}
+	m_pending.clear();
+
+	if (m_filter.isEmpty())
+	{
+		beginInsertRows(QModelIndex(), m_count, m_count + count - 1);
+		m_count += count;
+		endInsertRows();
+		return;
+	}
+
+	m_count += count;
+	if (!matches.isEmpty())
+	{
+		beginInsertRows(QModelIndex(), m_rows.size(),
+				m_rows.size() + matches.size() - 1);
+		m_rows.append(matches);
+		endInsertRows();
+	}
+}
+
+void LogModel::clear()
+{
+	m_flushTimer->stop();
+
+	beginResetModel();
+	m_entries = QVector<Entry>(m_capacity);
+	m_firstSeq = 0;
+	m_count = 0;
+	m_pending.clear();
+	m_rows.clear();
+	m_sources.clear();
+	endResetModel();
+}
+
+const LogModel::Entry& LogModel::entry(qint64 seq) const
+{
+	return m_entries.at(int(seq % m_capacity));
+}
+
+void LogModel::removeOldRows(qint64 firstSeq)
+{
+	int removed = int(qMin(firstSeq, m_firstSeq + m_count) - m_firstSeq);
+
+	if (m_filter.isEmpty())
+	{
+		if (removed > 0)
+		{
+			beginRemoveRows(QModelIndex(), 0, removed - 1);
+			m_count -= removed;
+			m_firstSeq = firstSeq;
+			endRemoveRows();
+		}
+	}
+	else
+	{
+		int rows = 0;
+		while (rows < m_rows.size() && m_rows.at(rows) < firstSeq)
+			rows++;
+		if (rows > 0)
+		{
+			beginRemoveRows(QModelIndex(), 0, rows - 1);
+			m_rows.erase(m_rows.begin(), m_rows.begin() + rows);
+			endRemoveRows();
+		}
+		m_count -= removed;
+	}
+	m_firstSeq = firstSeq;
+}
@@ -0,0 +1,112 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef LOG_MODEL_H
+#define LOG_MODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+#include <QList>
+#include <QStringList>
+class QTimer;
+
+/*!
+ * \brief A fixed-capacity model of log messages.
+ *
+ * LogModel keeps the newest capacity() messages in a ring buffer, so
+ * its memory use doesn't grow with the length of the log. Each message
+ * has a source, eg. the name of the engine that sent it, and the model
+ * can be restricted to the messages of one source.
+ *
+ * New messages are collected and added to the model in batches a few
+ * times per second, which keeps the cost of updating the views low
+ * even when messages arrive at a very high rate. Every batch is also
+ * reported with the messagesAdded() signal, so that the complete log
+ * can be kept elsewhere.
+ */
+class LogModel : public QAbstractListModel
+{
+	Q_OBJECT
+
+	public:
+		/*!
+		 * Creates a new model that keeps at most \a capacity
+		 * messages.
+		 */
+		explicit LogModel(int capacity, QObject* parent = 0);
+
+		/*! Returns the maximum number of messages in the model. */
+		int capacity() const;
+		/*! Returns the sources of the messages in the order they appeared. */
+		QStringList sources() const;
+		/*!
+		 * Returns the buffered messages of every source, from the
+		 * oldest to the newest.
+		 */
+		QStringList messages() const;
+
+		/*!
+		 * Shows only the messages from \a source. If \a source is
+		 * empty, the messages of every source are shown.
+		 */
+		void setSourceFilter(const QString& source);
+
+		// Inherited from QAbstractListModel
+		virtual int rowCount(const QModelIndex& parent = QModelIndex()) const;
+		virtual QVariant data(const QModelIndex& index, int role) const;
+
+	public slots:
+		/*! Adds \a message from \a source to the model. */
+		void append(const QString& source, const QString& message);
+		/*! Adds the pending messages to the model right away. */
+		void flush();
+		/*! Removes every message and source. */
+		void clear();
+
+	signals:
+		/*! Emitted when a new source sends its first message. */
+		void sourceAdded(const QString& source);
+		/*!
+		 * Emitted when a batch of \a messages is added to the
+		 * model. Unlike the model this contains every message,
+		 * including the ones that didn't fit in the buffer.
+		 */
+		void messagesAdded(const QStringList& messages);
+
+	private:
+		struct Entry
+		{
+			QString source;
+			QString message;
+		};
+
+		const Entry& entry(qint64 seq) const;
+		void removeOldRows(qint64 firstSeq);
+
+		int m_capacity;
+		QVector<Entry> m_entries;
+		qint64 m_firstSeq;
+		int m_count;
+		QVector<Entry> m_pending;
+		QString m_filter;
+		QList<qint64> m_rows;
+		QStringList m_sources;
+		QTimer* m_flushTimer;
+};
+
+#endif // LOG_MODEL_H
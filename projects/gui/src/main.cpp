@@ -17,6 +17,7 @@
 
 #include "cutechessapp.h"
 
+#include <csignal>
 #include <QTextStream>
 #include <QStringList>
 #include <QMetaType>
@@ -32,6 +33,11 @@ int main(int argc, char* argv[])
 	qRegisterMetaType<Chess::Move>("Chess::Move");
 	qRegisterMetaType<Chess::Side>("Chess::Side");
 
+#ifdef Q_OS_UNIX
+	// A write to an engine that has died must not kill the GUI
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
 	CuteChessApplication app(argc, argv);
 
 	QStringList arguments = app.arguments();
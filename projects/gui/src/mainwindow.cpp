@@ -28,6 +28,7 @@
 #include <QTreeView>
 #include <QMessageBox>
 #include <QFileDialog>
+#include <QSortFilterProxyModel>
 
 #include <board/boardfactory.h>
 #include <chessgame.h>
@@ -48,12 +49,17 @@
 #include "newgamedlg.h"
 #include "newtournamentdialog.h"
 #include "chessclock.h"
+#include "evalgraph.h"
 #include "engineconfigurationmodel.h"
 #include "enginemanagementdlg.h"
 #include "plaintextlog.h"
 #include "autoverticalscroller.h"
 #include "gamedatabasemanager.h"
 #include "pgntagsmodel.h"
+#include "tournamentstandingsmodel.h"
+#include "analysispanel.h"
+#include "gameannotationdlg.h"
+#include "boardview/boardview.h"
 
 MainWindow::TabData::TabData(ChessGame* game, Tournament* tournament)
 	: id(game),
@@ -86,6 +92,7 @@ MainWindow::MainWindow(ChessGame* game)
 
 	m_moveList = new MoveList(this);
 	m_tagsModel = new PgnTagsModel(this);
+	m_standingsModel = new TournamentStandingsModel(this);
 
 	QVBoxLayout* mainLayout = new QVBoxLayout();
 	mainLayout->addLayout(clockLayout);
@@ -150,11 +157,17 @@ void MainWindow::createActions()
 	m_stopTournamentAct = new QAction(tr("Stop"), this);
 
 	m_manageEnginesAct = new QAction(tr("Manage..."), this);
+	m_annotateGamesAct = new QAction(tr("Annotate Games..."), this);
 
 	m_showGameDatabaseWindowAct = new QAction(tr("&Game Database"), this);
 
 	m_showGameWallAct = new QAction(tr("Game Wall"), this);
 
+	m_openGlBoardsAct = new QAction(tr("Hardware Accelerated Boards"), this);
+	m_openGlBoardsAct->setCheckable(true);
+	m_openGlBoardsAct->setChecked(BoardView::isOpenGlEnabled());
+	m_openGlBoardsAct->setEnabled(BoardView::isOpenGlSupported());
+
 	connect(m_newGameAct, SIGNAL(triggered(bool)), this, SLOT(newGame()));
 	connect(m_closeGameAct, SIGNAL(triggered(bool)), this, SLOT(closeCurrentGame()));
 	connect(m_saveGameAct, SIGNAL(triggered(bool)), this, SLOT(save()));
@@ -165,12 +178,17 @@ void MainWindow::createActions()
 
 	connect(m_manageEnginesAct, SIGNAL(triggered(bool)), this,
 		SLOT(manageEngines()));
+	connect(m_annotateGamesAct, SIGNAL(triggered()), this,
+		SLOT(annotateGames()));
 
 	connect(m_showGameDatabaseWindowAct, SIGNAL(triggered(bool)),
 		CuteChessApplication::instance(), SLOT(showGameDatabaseDialog()));
 
 	connect(m_showGameWallAct, SIGNAL(triggered()),
 		CuteChessApplication::instance(), SLOT(showGameWall()));
+
+	connect(m_openGlBoardsAct, SIGNAL(toggled(bool)),
+		this, SLOT(setOpenGlBoards(bool)));
 }
 
 void MainWindow::createMenus()
@@ -193,6 +211,7 @@ void MainWindow::createMenus()
 
 	m_enginesMenu = menuBar()->addMenu(tr("En&gines"));
 	m_enginesMenu->addAction(m_manageEnginesAct);
+	m_enginesMenu->addAction(m_annotateGamesAct);
 
 	m_windowMenu = menuBar()->addMenu(tr("&Window"));
 	m_windowMenu->addAction(m_showGameWallAct);
@@ -256,10 +275,63 @@ void MainWindow::createDockWindows()
 	tabifyDockWidget(moveListDock, tagsDock);
 	moveListDock->raise();
 
+	// Analysis
+	QDockWidget* analysisDock = new QDockWidget(tr("Analysis"), this);
+	AnalysisPanel* analysisPanel = new AnalysisPanel(analysisDock);
+	connect(m_gameViewer, SIGNAL(positionChanged(QString, QString, QVector<Chess::GenericMove>)),
+		analysisPanel, SLOT(setPosition(QString, QString, QVector<Chess::GenericMove>)));
+	analysisDock->setWidget(analysisPanel);
+
+	addDockWidget(Qt::BottomDockWidgetArea, analysisDock);
+	tabifyDockWidget(engineDebugDock, analysisDock);
+	engineDebugDock->raise();
+
+	// Evaluation graphs of the current game and the tournament games
+	QDockWidget* evalGraphDock = new QDockWidget(tr("Evaluation"), this);
+	m_evalGraph = new EvalGraph(evalGraphDock);
+	evalGraphDock->setWidget(m_evalGraph);
+
+	addDockWidget(Qt::BottomDockWidgetArea, evalGraphDock);
+	tabifyDockWidget(engineDebugDock, evalGraphDock);
+
+	QDockWidget* tournamentEvalGraphDock =
+		new QDockWidget(tr("Tournament Evaluation"), this);
+	m_tournamentEvalGraph = new EvalGraph(tournamentEvalGraphDock);
+	tournamentEvalGraphDock->setWidget(m_tournamentEvalGraph);
+
+	addDockWidget(Qt::BottomDockWidgetArea, tournamentEvalGraphDock);
+	tabifyDockWidget(engineDebugDock, tournamentEvalGraphDock);
+
+	// Standings of the current tournament
+	QDockWidget* standingsDock = new QDockWidget(tr("Standings"), this);
+	QSortFilterProxyModel* standingsProxy =
+		new QSortFilterProxyModel(standingsDock);
+	standingsProxy->setSourceModel(m_standingsModel);
+	standingsProxy->setDynamicSortFilter(true);
+	QTreeView* standingsView = new QTreeView(standingsDock);
+	standingsView->setModel(standingsProxy);
+	standingsView->setAlternatingRowColors(true);
+	standingsView->setRootIsDecorated(false);
+	standingsView->setUniformRowHeights(true);
+	standingsView->setSortingEnabled(true);
+	standingsView->sortByColumn(TournamentStandingsModel::ScoreColumn,
+				    Qt::DescendingOrder);
+	standingsDock->setWidget(standingsView);
+
+	addDockWidget(Qt::BottomDockWidgetArea, standingsDock);
+	tabifyDockWidget(engineDebugDock, standingsDock);
+	engineDebugDock->raise();
+
 	// Add toggle view actions to the View menu
 	m_viewMenu->addAction(moveListDock->toggleViewAction());
 	m_viewMenu->addAction(tagsDock->toggleViewAction());
 	m_viewMenu->addAction(engineDebugDock->toggleViewAction());
+	m_viewMenu->addAction(analysisDock->toggleViewAction());
+	m_viewMenu->addAction(evalGraphDock->toggleViewAction());
+	m_viewMenu->addAction(tournamentEvalGraphDock->toggleViewAction());
+	m_viewMenu->addAction(standingsDock->toggleViewAction());
+	m_viewMenu->addSeparator();
+	m_viewMenu->addAction(m_openGlBoardsAct);
 }
 
 void MainWindow::addGame(ChessGame* game)
@@ -269,6 +341,8 @@ void MainWindow::addGame(ChessGame* game)
 
 	if (tournament)
 	{
+		m_tournamentEvalGraph->addGame(game);
+
 		int index = tabIndex(tournament, true);
 		if (index != -1)
 		{
@@ -340,6 +414,7 @@ void MainWindow::setCurrentGame(const TabData& gameData)
 		m_game->pgn()->setTagReceiver(0);
 		m_gameViewer->disconnectGame();
 		disconnect(m_game, 0, m_moveList, 0);
+		m_evalGraph->clear();
 
 		ChessGame* tmp = m_game;
 		m_game = 0;
@@ -365,6 +440,7 @@ void MainWindow::setCurrentGame(const TabData& gameData)
 	m_engineDebugLog->clear();
 
 	m_moveList->setGame(m_game, gameData.pgn);
+	m_evalGraph->setGame(m_game, gameData.pgn);
 
 	if (m_game == 0)
 	{
@@ -546,6 +622,7 @@ void MainWindow::newTournament()
 		this, SLOT(onTournamentFinished()));
 	connect(t, SIGNAL(gameStarted(ChessGame*, int, int, int)),
 		this, SLOT(addGame(ChessGame*)));
+	m_standingsModel->setTournament(t);
 	t->start();
 
 	connect(m_stopTournamentAct, SIGNAL(triggered()), t, SLOT(stop()));
@@ -589,6 +666,18 @@ void MainWindow::manageEngines()
 	}
 }
 
+void MainWindow::annotateGames()
+{
+	GameAnnotationDialog* dlg = new GameAnnotationDialog(this);
+	dlg->setAttribute(Qt::WA_DeleteOnClose);
+	dlg->show();
+}
+
+void MainWindow::setOpenGlBoards(bool enabled)
+{
+	BoardView::setOpenGlEnabled(enabled);
+}
+
 void MainWindow::saveLogToFile()
 {
 	PlainTextLog* log = qobject_cast<PlainTextLog*>(QObject::sender());
@@ -647,7 +736,7 @@ void MainWindow::saveLogToFile()
 	}
 
 	QTextStream out(&file);
-	out << log->toPlainText();
+	log->save(out);
 }
 
 void MainWindow::updateWindowTitle()
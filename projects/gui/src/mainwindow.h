@@ -35,7 +35,9 @@ class PgnGame;
 class ChessGame;
 class ChessPlayer;
 class PgnTagsModel;
+class TournamentStandingsModel;
 class Tournament;
+class EvalGraph;
 
 /**
  * MainWindow
@@ -59,6 +61,8 @@ class MainWindow : public QMainWindow
 		void newGame();
 		void newTournament();
 		void manageEngines();
+		void annotateGames();
+		void setOpenGlBoards(bool enabled);
 		void saveLogToFile();
 		void updateWindowTitle();
 		bool save();
@@ -111,6 +115,9 @@ class MainWindow : public QMainWindow
 		MoveList* m_moveList;
 		ChessClock* m_chessClock[2];
 		PgnTagsModel* m_tagsModel;
+		TournamentStandingsModel* m_standingsModel;
+		EvalGraph* m_evalGraph;
+		EvalGraph* m_tournamentEvalGraph;
 
 		QAction* m_quitGameAct;
 		QAction* m_newGameAct;
@@ -120,8 +127,10 @@ class MainWindow : public QMainWindow
 		QAction* m_newTournamentAct;
 		QAction* m_stopTournamentAct;
 		QAction* m_manageEnginesAct;
+		QAction* m_annotateGamesAct;
 		QAction* m_showGameDatabaseWindowAct;
 		QAction* m_showGameWallAct;
+		QAction* m_openGlBoardsAct;
 
 		PlainTextLog* m_engineDebugLog;
 
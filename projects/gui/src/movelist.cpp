@@ -15,30 +15,39 @@
     along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+
 #include "movelist.h"
-#include <QTextBrowser>
+#include <QTreeView>
+#include <QHeaderView>
 #include <QVBoxLayout>
 #include <QScrollBar>
 #include <QTimer>
 #include <chessgame.h>
+#include "movelistmodel.h"
 
 MoveList::MoveList(QWidget* parent)
 	: QWidget(parent),
+	  m_model(new MoveListModel(this)),
 	  m_game(0),
-	  m_moveCount(0),
-	  m_startingSide(0),
 	  m_selectedMove(-1),
 	  m_moveToBeSelected(-1),
 	  m_selectionTimer(new QTimer(this))
 {
-	m_moveList = new QTextBrowser(this);
-	m_moveList->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-	m_moveList->setOpenLinks(false);
-	m_moveList->document()->setDefaultStyleSheet(
-		"a:link { text-decoration: none; } "
-		".comment { color: grey; }");
-	connect(m_moveList, SIGNAL(anchorClicked(const QUrl&)), this,
-	    SLOT(onMoveOrCommentClicked(const QUrl&)));
+	// Uniform row heights let the view skip the layout of rows
+	// that aren't visible
+	m_moveList = new QTreeView(this);
+	m_moveList->setModel(m_model);
+	m_moveList->setRootIsDecorated(false);
+	m_moveList->setUniformRowHeights(true);
+	m_moveList->setAlternatingRowColors(true);
+	m_moveList->setSelectionBehavior(QAbstractItemView::SelectRows);
+	m_moveList->setSelectionMode(QAbstractItemView::SingleSelection);
+	m_moveList->setEditTriggers(QAbstractItemView::NoEditTriggers);
+	m_moveList->setTextElideMode(Qt::ElideRight);
+	m_moveList->header()->setStretchLastSection(true);
+	m_moveList->header()->hide();
+	connect(m_moveList, SIGNAL(clicked(QModelIndex)),
+		this, SLOT(onItemClicked(QModelIndex)));
 
 	QVBoxLayout* layout = new QVBoxLayout();
 	layout->addWidget(m_moveList);
@@ -51,36 +60,6 @@ MoveList::MoveList(QWidget* parent)
 		this, SLOT(selectChosenMove()));
 }
 
-MoveList::HtmlMove MoveList::htmlMove(int moveNum,
-				      int startingSide,
-				      const QString& moveString,
-				      const QString& comment)
-{
-	HtmlMove htmlMove;
-
-	if (moveNum == 0 && startingSide == Chess::Side::Black)
-		htmlMove.number = "<strong>1...</strong> ";
-	else
-	{
-		moveNum += startingSide;
-		if (moveNum % 2 == 0)
-			htmlMove.number = QString("<strong>%1.</strong> ")
-					  .arg(moveNum / 2 + 1);
-	}
-
-	htmlMove.move = QString("<a href=\"move://%1@\">%2</a> ")
-			.arg(moveNum).arg(moveString);
-	#ifndef Q_OS_WIN32
-	htmlMove.move.replace('-', "&#8288;-&#8288;");
-	#endif
-
-	if (!comment.isEmpty())
-		htmlMove.comment = QString("<a class=\"comment\" href=\"comment://%1@\">%2</a> ")
-				   .arg(moveNum).arg(comment);
-
-	return htmlMove;
-}
-
 void MoveList::setGame(ChessGame* game, PgnGame* pgn)
 {
 	if (m_game != 0)
@@ -93,133 +72,90 @@ void MoveList::setGame(ChessGame* game, PgnGame* pgn)
 		pgn = m_game->pgn();
 	}
 
-	m_moveList->clear();
-	m_movePos.clear();
 	m_selectedMove = -1;
 	m_moveToBeSelected = -1;
-
-	m_startingSide = pgn->startingSide();
-	for (m_moveCount = 0; m_moveCount < pgn->moves().size(); m_moveCount++)
-	{
-		const PgnGame::MoveData& md = pgn->moves().at(m_moveCount);
-		insertHtmlMove(htmlMove(m_moveCount, m_startingSide,
-					md.moveString, md.comment));
-	}
+	m_model->setGame(pgn);
 
 	if (m_game != 0)
 		connect(m_game, SIGNAL(moveMade(Chess::GenericMove, QString, QString)),
 			this, SLOT(onMoveMade(Chess::GenericMove, QString, QString)));
 
-	QScrollBar* sb = m_moveList->verticalScrollBar();
-	sb->setValue(sb->maximum());
+	m_moveList->resizeColumnToContents(MoveListModel::NumberColumn);
+	m_moveList->scrollToBottom();
+
+	selectMove(m_model->rowCount() - 1);
+}
 
-	selectMove(m_moveCount - 1);
+bool MoveList::isAtEnd() const
+{
+	QScrollBar* sb = m_moveList->verticalScrollBar();
+	return sb->value() == sb->maximum();
 }
 
 void MoveList::onMoveMade(const Chess::GenericMove& genericMove,
 			  const QString& sanString,
 			  const QString& comment)
 {
-	Q_UNUSED(genericMove);
+	Q_UNUSED(sanString);
 
-	QScrollBar* sb = m_moveList->verticalScrollBar();
-	bool atEnd = sb->value() == sb->maximum();
+	bool atEnd = isAtEnd();
 
-	insertHtmlMove(htmlMove(m_moveCount++, m_startingSide, sanString, comment));
+	PgnGame::MoveData md;
+	md.key = 0;
+	md.move = genericMove;
+	md.comment = comment;
+	m_model->addMove(md);
+	int moveCount = m_model->rowCount();
 
 	bool atLastMove = false;
-	if (m_selectedMove == -1 || m_moveToBeSelected == m_moveCount - 2)
+	if (m_selectedMove == -1 || m_moveToBeSelected == moveCount - 2)
 		atLastMove = true;
-	if (m_moveToBeSelected == -1 && m_selectedMove == m_moveCount - 2)
+	if (m_moveToBeSelected == -1 && m_selectedMove == moveCount - 2)
 		atLastMove = true;
 
 	if (atLastMove)
-		selectMove(m_moveCount - 1);
+		selectMove(moveCount - 1);
 
 	if (atEnd && atLastMove)
-		sb->setValue(sb->maximum());
-}
-
-void MoveList::insertHtmlMove(const HtmlMove& htmlMove)
-{
-	QTextCursor cursor = m_moveList->textCursor();
-	cursor.movePosition(QTextCursor::End);
-
-	cursor.insertHtml(htmlMove.number);
-
-	QPair<int, int> movePos;
-	movePos.first = cursor.position();
-	cursor.insertHtml(htmlMove.move);
-	movePos.second = cursor.position() - 1;
-	if (movePos.second > 0)
-		m_movePos.append(movePos);
-
-	cursor.insertHtml(htmlMove.comment);
+		m_moveList->scrollToBottom();
 }
 
 void MoveList::selectChosenMove()
 {
 	int moveNum = m_moveToBeSelected;
 	m_moveToBeSelected = -1;
-	Q_ASSERT(moveNum >= 0 && moveNum < m_moveCount);
-
-	if (m_selectedMove >= 0)
-	{
-		QTextCursor c = m_moveList->textCursor();
-		c.setPosition(m_movePos.at(m_selectedMove).first);
-		c.setPosition(m_movePos.at(m_selectedMove).second, QTextCursor::KeepAnchor);
-		c.mergeCharFormat(m_defaultTextFormat);
-	}
+	Q_ASSERT(moveNum >= 0 && moveNum < m_model->rowCount());
 
 	m_selectedMove = moveNum;
-	QTextCursor c = m_moveList->textCursor();
-	c.setPosition(m_movePos.at(moveNum).first);
-	c.setPosition(m_movePos.at(moveNum).second, QTextCursor::KeepAnchor);
-
-	QTextCharFormat format(c.charFormat());
-	m_defaultTextFormat = format;
-	m_defaultTextFormat.setBackground(format.background());
-	m_defaultTextFormat.setForeground(format.foreground());
-
-	format.setForeground(Qt::white);
-	format.setBackground(Qt::black);
-	c.mergeCharFormat(format);
+	QModelIndex index(m_model->index(moveNum, MoveListModel::MoveColumn));
+	m_moveList->selectionModel()->select(index,
+		QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
+	m_moveList->scrollTo(index);
 }
 
 void MoveList::selectMove(int moveNum)
 {
 	if (moveNum == -1)
 		moveNum = 0;
-	if (moveNum >= m_moveCount || m_moveCount <= 0)
+	if (moveNum >= m_model->rowCount())
 		return;
 
 	m_moveToBeSelected = moveNum;
 	m_selectionTimer->start();
 }
 
-void MoveList::onMoveOrCommentClicked(const QUrl& url)
+void MoveList::onItemClicked(const QModelIndex& index)
 {
-	bool ok;
-	int moveNum = url.userName().toInt(&ok);
-
-	if (!ok)
-	{
-		qWarning("MoveList: invalid move number: %s",
-		    qPrintable(url.userName()));
-
+	if (!index.isValid())
 		return;
-	}
 
-	if (url.scheme() == "move")
-		emit moveClicked(moveNum);
-	else if (url.scheme() == "comment")
+	int moveNum = index.row();
+	if (index.column() == MoveListModel::CommentColumn)
 	{
 		emit commentClicked(moveNum);
 		return;
 	}
-	else
-		qWarning("MoveList: unknown scheme: %s",
-		    qPrintable(url.scheme()));
 
+	emit moveClicked(moveNum);
 	selectMove(moveNum);
 }
@@ -20,17 +20,23 @@
 
 #include <QWidget>
 #include <QPointer>
-#include <QUrl>
-#include <QPair>
-#include <QList>
-#include <QTextCharFormat>
 
-class QTextBrowser;
+class QTreeView;
+class QModelIndex;
 class PgnGame;
 class ChessGame;
+class MoveListModel;
 namespace Chess { class GenericMove; }
 class QTimer;
 
+/*!
+ * \brief A list of the moves of a game.
+ *
+ * The moves are shown in a view that only lays out the visible rows,
+ * so long games with verbose engine comments load and update quickly.
+ *
+ * \sa MoveListModel
+ */
 class MoveList : public QWidget
 {
 	Q_OBJECT
@@ -61,31 +67,17 @@ class MoveList : public QWidget
 		void onMoveMade(const Chess::GenericMove& genericMove,
 		                const QString& sanString,
 		                const QString& comment);
-		void onMoveOrCommentClicked(const QUrl& url);
+		void onItemClicked(const QModelIndex& index);
 		void selectChosenMove();
 
 	private:
-		struct HtmlMove
-		{
-			QString number;
-			QString move;
-			QString comment;
-		};
+		bool isAtEnd() const;
 
-		static HtmlMove htmlMove(int moveNum,
-					 int startingSide,
-					 const QString& moveString,
-					 const QString& comment);
-		void insertHtmlMove(const HtmlMove& htmlMove);
-
-		QTextBrowser* m_moveList;
+		QTreeView* m_moveList;
+		MoveListModel* m_model;
 		QPointer<ChessGame> m_game;
-		QList< QPair<int, int> > m_movePos;
-		int m_moveCount;
-		int m_startingSide;
 		int m_selectedMove;
 		int m_moveToBeSelected;
-		QTextCharFormat m_defaultTextFormat;
 		QTimer* m_selectionTimer;
 };
 
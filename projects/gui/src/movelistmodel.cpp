@@ -0,0 +1,190 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "movelistmodel.h"
+#include <QColor>
+#include <board/board.h>
+#include <board/boardfactory.h>
+
+MoveListModel::MoveListModel(QObject* parent)
+	: QAbstractItemModel(parent),
+	  m_startingSide(Chess::Side::White),
+	  m_board(0),
+	  m_replayFailed(false)
+{
+}
+
+MoveListModel::~MoveListModel()
+{
+	delete m_board;
+}
+
+void MoveListModel::setGame(const PgnGame* pgn)
+{
+	Q_ASSERT(pgn != 0);
+
+	beginResetModel();
+
+	delete m_board;
+	m_board = 0;
+	m_moveStrings.clear();
+	m_replayFailed = false;
+
+	// The move vector is implicitly shared, so this is cheap
+	m_moves = pgn->moves();
+	m_variant = pgn->variant();
+	m_startingFen = pgn->startingFenString();
+	m_startingSide = pgn->startingSide();
+
+	endResetModel();
+}
+
+void MoveListModel::addMove(const PgnGame::MoveData& move)
+{
+	int row = m_moves.size();
+	beginInsertRows(QModelIndex(), row, row);
+	m_moves.append(move);
+	endInsertRows();
+}
+
+QString MoveListModel::moveNumber(int ply) const
+{
+	int moveNum = ply + m_startingSide;
+	if (moveNum % 2 == 0)
+		return QString("%1.").arg(moveNum / 2 + 1);
+	return QString("%1...").arg(moveNum / 2 + 1);
+}
+
+QString MoveListModel::moveString(int ply) const
+{
+	// Replay the game up to the requested move. The board is kept
+	// at the position after the last converted move.
+	while (m_moveStrings.size() <= ply && !m_replayFailed)
+	{
+		if (m_board == 0)
+		{
+			m_board = Chess::BoardFactory::create(m_variant);
+			if (m_board != 0 && !m_startingFen.isEmpty())
+				m_replayFailed = !m_board->setFenString(m_startingFen);
+			else if (m_board != 0)
+				m_board->reset();
+			if (m_board == 0)
+				m_replayFailed = true;
+			if (m_replayFailed)
+				break;
+		}
+
+		const PgnGame::MoveData& md = m_moves.at(m_moveStrings.size());
+		Chess::Move move(m_board->moveFromGenericMove(md.move));
+		if (move.isNull() || !m_board->isLegalMove(move))
+		{
+			qWarning("Illegal move in game: move %d",
+				 m_moveStrings.size() + 1);
+			m_replayFailed = true;
+			break;
+		}
+
+		m_moveStrings.append(m_board->moveString(move,
+			Chess::Board::StandardAlgebraic));
+		m_board->makeMove(move);
+	}
+
+	if (ply < m_moveStrings.size())
+		return m_moveStrings.at(ply);
+	return QString();
+}
+
+QModelIndex MoveListModel::index(int row, int column,
+				 const QModelIndex& parent) const
+{
+	if (!hasIndex(row, column, parent))
+		return QModelIndex();
+
+	return createIndex(row, column);
+}
+
+QModelIndex MoveListModel::parent(const QModelIndex& index) const
+{
+	Q_UNUSED(index);
+
+	return QModelIndex();
+}
+
+int MoveListModel::rowCount(const QModelIndex& parent) const
+{
+	if (parent.isValid())
+		return 0;
+
+	return m_moves.size();
+}
+
+int MoveListModel::columnCount(const QModelIndex& parent) const
+{
+	if (parent.isValid())
+		return 0;
+
+	return 3;
+}
+
+QVariant MoveListModel::data(const QModelIndex& index, int role) const
+{
+	if (!index.isValid())
+		return QVariant();
+
+	if (role == Qt::DisplayRole)
+	{
+		switch (index.column())
+		{
+		case NumberColumn:
+			return moveNumber(index.row());
+		case MoveColumn:
+			return moveString(index.row());
+		case CommentColumn:
+			return m_moves.at(index.row()).comment;
+		default:
+			return QVariant();
+		}
+	}
+	else if (role == Qt::ForegroundRole && index.column() == CommentColumn)
+		return QColor(Qt::gray);
+	else if (role == Qt::ToolTipRole && index.column() == CommentColumn)
+		return m_moves.at(index.row()).comment;
+
+	return QVariant();
+}
+
+QVariant MoveListModel::headerData(int section, Qt::Orientation orientation,
+				   int role) const
+{
+	if (role == Qt::DisplayRole && orientation == Qt::Horizontal)
+	{
+		switch (section)
+		{
+		case NumberColumn:
+			return tr("No.");
+		case MoveColumn:
+			return tr("Move");
+		case CommentColumn:
+			return tr("Comment");
+		default:
+			return QVariant();
+		}
+	}
+
+	return QVariant();
+}
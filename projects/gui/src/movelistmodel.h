@@ -0,0 +1,85 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef MOVE_LIST_MODEL_H
+#define MOVE_LIST_MODEL_H
+
+#include <QAbstractItemModel>
+#include <QVector>
+#include <QStringList>
+#include <pgngame.h>
+namespace Chess { class Board; }
+
+/*!
+ * \brief Supplies the moves of a game to a move list view.
+ *
+ * Each row is one move (ply), with columns for the move number, the
+ * move in Standard Algebraic Notation and the move's comment. The
+ * moves and comments are read from a copy of PgnGame::moves(), and
+ * the SAN strings are generated lazily by replaying the game only as
+ * far as the view has asked for. Together with a view that only lays
+ * out the visible rows this keeps long, heavily commented games fast
+ * to load and to update.
+ */
+class MoveListModel : public QAbstractItemModel
+{
+	Q_OBJECT
+
+	public:
+		/*! The model's columns. */
+		enum Column
+		{
+			NumberColumn,	//!< Move number
+			MoveColumn,	//!< The move in SAN
+			CommentColumn	//!< The move's comment
+		};
+
+		/*! Constructs an empty model with the given \a parent. */
+		MoveListModel(QObject* parent = 0);
+		/*! Destroys the model. */
+		virtual ~MoveListModel();
+
+		/*! Replaces the moves with the moves of \a pgn. */
+		void setGame(const PgnGame* pgn);
+		/*! Appends \a move to the game. */
+		void addMove(const PgnGame::MoveData& move);
+
+		// Inherited from QAbstractItemModel
+		virtual QModelIndex index(int row, int column,
+					  const QModelIndex& parent = QModelIndex()) const;
+		virtual QModelIndex parent(const QModelIndex& index) const;
+		virtual int rowCount(const QModelIndex& parent = QModelIndex()) const;
+		virtual int columnCount(const QModelIndex& parent = QModelIndex()) const;
+		virtual QVariant data(const QModelIndex& index, int role) const;
+		virtual QVariant headerData(int section, Qt::Orientation orientation,
+					    int role = Qt::DisplayRole) const;
+
+	private:
+		QString moveNumber(int ply) const;
+		QString moveString(int ply) const;
+
+		QVector<PgnGame::MoveData> m_moves;
+		QString m_variant;
+		QString m_startingFen;
+		int m_startingSide;
+		mutable Chess::Board* m_board;
+		mutable QStringList m_moveStrings;
+		mutable bool m_replayFailed;
+};
+
+#endif // MOVE_LIST_MODEL_H
@@ -17,29 +17,1270 @@
 
 #include "pgndatabase.h"
 #include <pgnstream.h>
+#include <pgngamefilter.h>
+#include <QDataStream>
 #include <QFileInfo>
+#include <QCryptographicHash>
+#include <cstring>
+#include <cctype>
+
+// Flags of the date column. A packed date stores the year, month
+// and day in the low bits, with 0 for unknown ("?") fields. Dates in
+// any other format are interned like the other string tags.
+static const quint32 s_packedDate = 0x80000000;
+static const quint32 s_internedDate = 0x40000000;
+
+// Index file header. The header is followed by the columns in the
+// order they are declared in PgnDatabase, each padded to 8 bytes.
+struct IndexHeader
+{
+	quint32 magic;
+	quint32 version;
+	quint32 byteOrder;
+	qint32 entryCount;
+	qint64 importedSize;
+	qint64 importedLineNumber;
+	char tailHash[16];
+	qint64 lastModified;
+	qint32 stringCount;
+	quint32 stringDataSize;
+	// The number of position index entries, or -1 if there's
+	// no position index
+	qint32 positionCount;
+	// The number of opening tree records, or -1 if there's no
+	// opening tree
+	qint32 openingMoveCount;
+	// The number of game hashes, or -1 if there are no game hashes
+	qint32 gameHashCount;
+	qint32 reserved;
+};
+
+static const quint32 s_indexMagic = 0x43435049;
+static const quint32 s_indexVersion = 5;
+static const quint32 s_indexByteOrder = 0x01020304;
+
+// The packed result codes are indexes to this array. Unrecognized
+// results are stored as unfinished games.
+static const char* const s_results[] = { "", "1-0", "0-1", "1/2-1/2", "*" };
+static const int s_resultCount = sizeof(s_results) / sizeof(s_results[0]);
+
+// Returns the value of a date field, 0 if it's unknown, or -1 if the
+// field is invalid.
+static int s_dateField(const char* data, int size)
+{
+	if (data[0] == '?')
+	{
+		for (int i = 1; i < size; i++)
+		{
+			if (data[i] != '?')
+				return -1;
+		}
+		return 0;
+	}
+
+	int value = 0;
+	for (int i = 0; i < size; i++)
+	{
+		if (data[i] < '0' || data[i] > '9')
+			return -1;
+		value = value * 10 + (data[i] - '0');
+	}
+	return value;
+}
+
+static void s_writeDateField(char* buffer, int value, int size)
+{
+	for (int i = size - 1; i >= 0; i--)
+	{
+		buffer[i] = (value == 0) ? '?' : char('0' + value % 10);
+		value /= 10;
+	}
+}
+
+// The number of bytes at the end of the imported data that are hashed
+// to detect if a database file has only been appended to
+static const qint64 s_tailSize = 4096;
+
+static QByteArray s_tailHash(const QString& fileName, qint64 size)
+{
+	QFile file(fileName);
+	if (size <= 0 || !file.open(QIODevice::ReadOnly))
+		return QByteArray();
+
+	qint64 start = qMax(qint64(0), size - s_tailSize);
+	if (!file.seek(start))
+		return QByteArray();
+	QByteArray tail = file.read(size - start);
+	if (tail.size() != size - start)
+		return QByteArray();
+
+	return QCryptographicHash::hash(tail, QCryptographicHash::Md5);
+}
+
+static qint64 s_align(qint64 size)
+{
+	return (size + 7) & ~qint64(7);
+}
+
+static bool s_writeSection(QIODevice* device, const void* data, qint64 size)
+{
+	static const char padding[8] = { 0 };
+
+	if (size > 0 && device->write((const char*)data, size) != size)
+		return false;
+
+	qint64 paddingSize = s_align(size) - size;
+	return paddingSize == 0
+	    || device->write(padding, paddingSize) == paddingSize;
+}
+
+// Returns true if \a str contains \a pattern, ignoring case
+static bool s_contains(const char* str, int size, const char* pattern)
+{
+	int patternSize = int(strlen(pattern));
+
+	for (int i = 0; i + patternSize <= size; i++)
+	{
+		int j = 0;
+		while (j < patternSize && toupper(str[i + j]) == toupper(pattern[j]))
+			j++;
+		if (j == patternSize)
+			return true;
+	}
+
+	return false;
+}
+
+static void s_sortUnique(QVector<int>* values)
+{
+	qSort(*values);
+
+	int count = 0;
+	for (int i = 0; i < values->size(); i++)
+	{
+		if (count == 0 || values->at(i) != values->at(count - 1))
+			(*values)[count++] = values->at(i);
+	}
+	values->resize(count);
+}
+
+// Returns a bit mask of the packed result codes that can match \a result
+static int s_resultCodes(PgnGameFilter::Result result)
+{
+	switch (result)
+	{
+	case PgnGameFilter::WhiteWins:
+		return 1 << 1;
+	case PgnGameFilter::BlackWins:
+		return 1 << 2;
+	case PgnGameFilter::Draw:
+		return 1 << 3;
+	case PgnGameFilter::Unfinished:
+		return (1 << 0) | (1 << 4);
+	case PgnGameFilter::EitherPlayerWins:
+	case PgnGameFilter::FirstPlayerWins:
+	case PgnGameFilter::FirstPlayerLoses:
+		return (1 << 1) | (1 << 2);
+	default:
+		return 0;
+	}
+}
+
+static quint8 s_packResult(const char* data, int size)
+{
+	if (size == 0)
+		return 0;
+
+	for (int i = 1; i < s_resultCount; i++)
+	{
+		if (int(strlen(s_results[i])) == size
+		&&  !memcmp(s_results[i], data, size))
+			return quint8(i);
+	}
+
+	return quint8(s_resultCount - 1);
+}
+
+// Merges the sorted opening trees \a a and \a b, adding up the
+// statistics of moves found in both.
+static QVector<PgnDatabase::OpeningMove> s_mergeOpeningTrees(
+	const PgnDatabase::OpeningMove* a, int n,
+	const PgnDatabase::OpeningMove* b, int m)
+{
+	QVector<PgnDatabase::OpeningMove> moves;
+	moves.reserve(qMax(n, m));
+
+	int i = 0;
+	int j = 0;
+	while (i < n || j < m)
+	{
+		if (j == m || (i < n && a[i] < b[j]))
+			moves.append(a[i++]);
+		else if (i == n || b[j] < a[i])
+			moves.append(b[j++]);
+		else
+		{
+			moves.append(a[i++]);
+			moves.last().add(b[j++]);
+		}
+	}
+
+	return moves;
+}
+
+
+Chess::GenericMove PgnDatabase::OpeningMove::genericMove() const
+{
+	Chess::Square source(int((move >> 26) & 63) - 1,
+			     int((move >> 20) & 63) - 1);
+	Chess::Square target(int((move >> 14) & 63) - 1,
+			     int((move >> 8) & 63) - 1);
+	return Chess::GenericMove(source, target, int(move & 0xff));
+}
+
+qreal PgnDatabase::OpeningMove::score(Chess::Side side) const
+{
+	quint32 finished = whiteWins + draws + blackWins;
+	if (finished == 0)
+		return 0.0;
+
+	quint32 wins = (side == Chess::Side::White) ? whiteWins : blackWins;
+	return (wins + draws / 2.0) / finished;
+}
+
+int PgnDatabase::OpeningMove::meanElo() const
+{
+	if (eloCount == 0)
+		return 0;
+	return int(eloSum / eloCount);
+}
+
+void PgnDatabase::OpeningMove::add(const OpeningMove& other)
+{
+	games += other.games;
+	whiteWins += other.whiteWins;
+	draws += other.draws;
+	blackWins += other.blackWins;
+	eloCount += other.eloCount;
+	eloSum += other.eloSum;
+}
+
+bool PgnDatabase::OpeningMove::operator<(const OpeningMove& other) const
+{
+	if (key != other.key)
+		return key < other.key;
+	return move < other.move;
+}
+
+quint32 PgnDatabase::OpeningMove::packMove(const Chess::GenericMove& move)
+{
+	Chess::Square source = move.sourceSquare();
+	Chess::Square target = move.targetSquare();
+
+	return (quint32((source.file() + 1) & 63) << 26)
+	     | (quint32((source.rank() + 1) & 63) << 20)
+	     | (quint32((target.file() + 1) & 63) << 14)
+	     | (quint32((target.rank() + 1) & 63) << 8)
+	     | quint32(move.promotion() & 0xff);
+}
+
 
 PgnDatabase::PgnDatabase(const QString& fileName, QObject* parent)
 	: QObject(parent),
 	  m_fileName(fileName),
+	  m_hasPositionIndex(false),
+	  m_hasOpeningTree(false),
+	  m_hasGameHashes(false),
+	  m_indexFile(0),
+	  m_importedSize(0),
+	  m_importedLineNumber(1),
+	  m_searchIndexValid(false),
+	  m_gameFile(0),
+	  m_gameStream(0),
 	  m_displayName(QFileInfo(fileName).completeBaseName())
 {
+	// Index 0 is reserved for empty tags
+	m_stringOffsets.append(0);
+	m_stringOffsets.append(0);
 }
 
 PgnDatabase::~PgnDatabase()
 {
-	qDeleteAll(m_entries);
+	closeGameFile();
+	delete m_indexFile;
+}
+
+void PgnDatabase::closeGameFile()
+{
+	delete m_gameStream;
+	m_gameStream = 0;
+	delete m_gameFile;
+	m_gameFile = 0;
+}
+
+void PgnDatabase::clear()
+{
+	m_pos.clear();
+	m_lineNumber.clear();
+	m_event.clear();
+	m_site.clear();
+	m_date.clear();
+	m_round.clear();
+	m_white.clear();
+	m_black.clear();
+	m_result.clear();
+	m_variant.clear();
+
+	m_stringOffsets.clear();
+	m_stringOffsets.append(0);
+	m_stringOffsets.append(0);
+	m_stringData.clear();
+	m_stringIndex.clear();
+
+	m_hasPositionIndex = false;
+	m_positionKeys.clear();
+	m_positionGames.clear();
+	m_hasOpeningTree = false;
+	m_openingTree.clear();
+	m_hasGameHashes = false;
+	m_gameHashes.clear();
+
+	m_importedSize = 0;
+	m_importedLineNumber = 1;
+	m_tailHash.clear();
+	m_searchIndexValid = false;
+
+	// The columns must not refer to the mapped index after this
+	delete m_indexFile;
+	m_indexFile = 0;
+	m_indexFileName.clear();
+}
+
+void PgnDatabase::reserve(int count)
+{
+	m_pos.reserve(count);
+	m_lineNumber.reserve(count);
+	m_event.reserve(count);
+	m_site.reserve(count);
+	m_date.reserve(count);
+	m_round.reserve(count);
+	m_white.reserve(count);
+	m_black.reserve(count);
+	m_result.reserve(count);
+	m_variant.reserve(count);
+}
+
+int PgnDatabase::stringCount() const
+{
+	return m_stringOffsets.size() - 1;
+}
+
+const char* PgnDatabase::stringData(quint32 index, int* size) const
+{
+	quint32 offset = m_stringOffsets.at(index);
+	*size = m_stringOffsets.at(index + 1) - offset;
+	return m_stringData.constData() + offset;
+}
+
+quint32 PgnDatabase::internString(const char* data, int size)
+{
+	if (size == 0)
+		return 0;
+
+	// The lookup table isn't stored in the index file, so it's
+	// rebuilt when new strings are added to a loaded database.
+	if (m_stringIndex.isEmpty())
+	{
+		for (int i = 1; i < stringCount(); i++)
+		{
+			int strSize;
+			const char* str = stringData(i, &strSize);
+			m_stringIndex.insert(qHash(QByteArray::fromRawData(str, strSize)), i);
+		}
+	}
+
+	uint hash = qHash(QByteArray::fromRawData(data, size));
+	QMultiHash<uint, quint32>::const_iterator it = m_stringIndex.constFind(hash);
+	for (; it != m_stringIndex.constEnd() && it.key() == hash; ++it)
+	{
+		int strSize;
+		const char* str = stringData(it.value(), &strSize);
+		if (strSize == size && !memcmp(str, data, size))
+			return it.value();
+	}
+
+	quint32 index = stringCount();
+	m_stringData.append(data, size);
+	m_stringOffsets.append(m_stringData.size());
+	m_stringIndex.insert(hash, index);
+
+	return index;
+}
+
+quint32 PgnDatabase::packDate(const char* data, int size)
+{
+	if (size == 0)
+		return 0;
+
+	if (size == 10 && data[4] == '.' && data[7] == '.')
+	{
+		int year = s_dateField(data, 4);
+		int month = s_dateField(data + 5, 2);
+		int day = s_dateField(data + 8, 2);
+
+		if (year >= 0 && month >= 0 && month <= 12
+		&&  day >= 0 && day <= 31)
+			return s_packedDate | (year << 9) | (month << 5) | day;
+	}
+
+	return s_internedDate | internString(data, size);
+}
+
+void PgnDatabase::addEntry(const PgnGameEntry& entry)
+{
+	const char* tags[8];
+	int sizes[8];
+
+	for (int type = 0; type < 8; type++)
+		tags[type] = entry.tagData(PgnGameEntry::TagType(type), &sizes[type]);
+
+	addEntry(entry.pos(), entry.lineNumber(), tags, sizes);
+}
+
+void PgnDatabase::addEntry(qint64 pos,
+			   qint64 lineNumber,
+			   const char* const* tags,
+			   const int* sizes)
+{
+	m_indexFileName.clear();
+	m_searchIndexValid = false;
+	m_pos.append(pos);
+	m_lineNumber.append(lineNumber);
+
+	m_event.append(internString(tags[PgnGameEntry::EventTag],
+				    sizes[PgnGameEntry::EventTag]));
+	m_site.append(internString(tags[PgnGameEntry::SiteTag],
+				   sizes[PgnGameEntry::SiteTag]));
+	m_date.append(packDate(tags[PgnGameEntry::DateTag],
+			       sizes[PgnGameEntry::DateTag]));
+	m_round.append(internString(tags[PgnGameEntry::RoundTag],
+				    sizes[PgnGameEntry::RoundTag]));
+	m_white.append(internString(tags[PgnGameEntry::WhiteTag],
+				    sizes[PgnGameEntry::WhiteTag]));
+	m_black.append(internString(tags[PgnGameEntry::BlackTag],
+				    sizes[PgnGameEntry::BlackTag]));
+	m_result.append(s_packResult(tags[PgnGameEntry::ResultTag],
+				     sizes[PgnGameEntry::ResultTag]));
+	m_variant.append(internString(tags[PgnGameEntry::VariantTag],
+				      sizes[PgnGameEntry::VariantTag]));
+}
+
+void PgnDatabase::append(const PgnDatabase& other)
+{
+	char dateBuffer[10];
+	const char* tags[8];
+	int sizes[8];
+
+	// Merge the position indexes. The result only has an index if
+	// both databases have one.
+	bool hasPositionIndex = m_hasPositionIndex && other.m_hasPositionIndex;
+	QVector<quint64> keys;
+	QVector<quint32> games;
+	if (hasPositionIndex)
+	{
+		int n = m_positionKeys.size();
+		int m = other.m_positionKeys.size();
+		quint32 base = entryCount();
+		keys.reserve(n + m);
+		games.reserve(n + m);
+
+		int i = 0;
+		int j = 0;
+		while (i < n || j < m)
+		{
+			// Games of this database come first on equal keys
+			if (j == m || (i < n && m_positionKeys.at(i)
+					       <= other.m_positionKeys.at(j)))
+			{
+				keys.append(m_positionKeys.at(i));
+				games.append(m_positionGames.at(i++));
+			}
+			else
+			{
+				keys.append(other.m_positionKeys.at(j));
+				games.append(base + other.m_positionGames.at(j++));
+			}
+		}
+	}
+
+	// The opening trees are combined the same way
+	bool hasOpeningTree = m_hasOpeningTree && other.m_hasOpeningTree;
+	QVector<OpeningMove> openingTree;
+	if (hasOpeningTree)
+		openingTree = s_mergeOpeningTrees(m_openingTree.constData(),
+						  m_openingTree.size(),
+						  other.m_openingTree.constData(),
+						  other.m_openingTree.size());
+
+	// Game hashes are in game order, so they're just concatenated
+	bool hasGameHashes = m_hasGameHashes && other.m_hasGameHashes;
+	QVector<quint64> gameHashes;
+	if (hasGameHashes)
+	{
+		gameHashes.reserve(entryCount() + other.entryCount());
+		for (int i = 0; i < m_gameHashes.size(); i++)
+			gameHashes.append(m_gameHashes.at(i));
+		for (int i = 0; i < other.m_gameHashes.size(); i++)
+			gameHashes.append(other.m_gameHashes.at(i));
+	}
+
+	reserve(entryCount() + other.entryCount());
+	for (int i = 0; i < other.entryCount(); i++)
+	{
+		for (int type = 0; type < 8; type++)
+			tags[type] = other.tagData(i, PgnGameEntry::TagType(type),
+						   dateBuffer, &sizes[type]);
+		addEntry(other.m_pos.at(i), other.m_lineNumber.at(i), tags, sizes);
+	}
+
+	m_importedSize = other.m_importedSize;
+	m_importedLineNumber = other.m_importedLineNumber;
+	m_tailHash = other.m_tailHash;
+	m_lastModified = other.m_lastModified;
+	m_indexFileName.clear();
+
+	if (hasPositionIndex)
+		setPositionIndex(keys, games);
+	else
+	{
+		m_hasPositionIndex = false;
+		m_positionKeys.clear();
+		m_positionGames.clear();
+	}
+
+	if (hasOpeningTree)
+		setOpeningTree(openingTree);
+	else
+	{
+		m_hasOpeningTree = false;
+		m_openingTree.clear();
+	}
+
+	if (hasGameHashes)
+		setGameHashes(gameHashes);
+	else
+	{
+		m_hasGameHashes = false;
+		m_gameHashes.clear();
+	}
+}
+
+bool PgnDatabase::hasPositionIndex() const
+{
+	return m_hasPositionIndex;
+}
+
+void PgnDatabase::setPositionIndex(const QVector<quint64>& keys,
+				   const QVector<quint32>& games)
+{
+	Q_ASSERT(keys.size() == games.size());
+
+	m_positionKeys.clear();
+	m_positionGames.clear();
+	m_positionKeys.reserve(keys.size());
+	m_positionGames.reserve(games.size());
+	for (int i = 0; i < keys.size(); i++)
+	{
+		m_positionKeys.append(keys.at(i));
+		m_positionGames.append(games.at(i));
+	}
+
+	m_hasPositionIndex = true;
+	m_indexFileName.clear();
+}
+
+QVector<int> PgnDatabase::findPosition(quint64 key) const
+{
+	QVector<int> games;
+
+	const quint64* keys = m_positionKeys.constData();
+	const quint64* end = keys + m_positionKeys.size();
+	const quint64* first = qLowerBound(keys, end, key);
+
+	for (const quint64* it = first; it != end && *it == key; ++it)
+		games.append(m_positionGames.at(it - keys));
+
+	return games;
+}
+
+bool PgnDatabase::hasOpeningTree() const
+{
+	return m_hasOpeningTree;
+}
+
+void PgnDatabase::setOpeningTree(const QVector<OpeningMove>& moves)
+{
+	m_openingTree.clear();
+	m_openingTree.reserve(moves.size());
+	foreach (const OpeningMove& move, moves)
+		m_openingTree.append(move);
+
+	m_hasOpeningTree = true;
+	m_indexFileName.clear();
+}
+
+QVector<PgnDatabase::OpeningMove> PgnDatabase::openingMoves(quint64 key) const
+{
+	QVector<OpeningMove> moves;
+
+	// Packed moves are never 0, so this sorts before all moves of
+	// the position.
+	OpeningMove first;
+	first.key = key;
+	first.move = 0;
+
+	const OpeningMove* begin = m_openingTree.constData();
+	const OpeningMove* end = begin + m_openingTree.size();
+	for (const OpeningMove* it = qLowerBound(begin, end, first);
+	     it != end && it->key == key; ++it)
+		moves.append(*it);
+
+	return moves;
+}
+
+bool PgnDatabase::hasGameHashes() const
+{
+	return m_hasGameHashes;
+}
+
+void PgnDatabase::setGameHashes(const QVector<quint64>& hashes)
+{
+	Q_ASSERT(hashes.size() == entryCount());
+
+	m_gameHashes.clear();
+	m_gameHashes.reserve(hashes.size());
+	foreach (quint64 hash, hashes)
+		m_gameHashes.append(hash);
+
+	m_hasGameHashes = true;
+	m_indexFileName.clear();
+}
+
+quint64 PgnDatabase::gameHash(int index) const
+{
+	return m_gameHashes.at(index);
+}
+
+qint64 PgnDatabase::importedSize() const
+{
+	return m_importedSize;
+}
+
+qint64 PgnDatabase::importedLineNumber() const
+{
+	return m_importedLineNumber;
+}
+
+void PgnDatabase::setImported(qint64 size, qint64 lineNumber)
+{
+	m_importedSize = size;
+	m_importedLineNumber = lineNumber;
+	m_tailHash = s_tailHash(m_fileName, size);
+	m_indexFileName.clear();
+}
+
+bool PgnDatabase::isAppended() const
+{
+	if (m_importedSize <= 0 || m_tailHash.isEmpty())
+		return false;
+	if (QFileInfo(m_fileName).size() <= m_importedSize)
+		return false;
+
+	return s_tailHash(m_fileName, m_importedSize) == m_tailHash;
+}
+
+int PgnDatabase::entryCount() const
+{
+	return m_pos.size();
+}
+
+qint64 PgnDatabase::entryPos(int index) const
+{
+	return m_pos.at(index);
+}
+
+qint64 PgnDatabase::entryLineNumber(int index) const
+{
+	return m_lineNumber.at(index);
+}
+
+const char* PgnDatabase::tagData(int index,
+				 PgnGameEntry::TagType type,
+				 char* dateBuffer,
+				 int* size) const
+{
+	quint32 str = 0;
+
+	switch (type)
+	{
+	case PgnGameEntry::EventTag:
+		str = m_event.at(index);
+		break;
+	case PgnGameEntry::SiteTag:
+		str = m_site.at(index);
+		break;
+	case PgnGameEntry::DateTag:
+		{
+			quint32 date = m_date.at(index);
+			if (date & s_packedDate)
+			{
+				s_writeDateField(dateBuffer, (date >> 9) & 0x3fff, 4);
+				dateBuffer[4] = '.';
+				s_writeDateField(dateBuffer + 5, (date >> 5) & 0xf, 2);
+				dateBuffer[7] = '.';
+				s_writeDateField(dateBuffer + 8, date & 0x1f, 2);
+				*size = 10;
+				return dateBuffer;
+			}
+			str = date & ~s_internedDate;
+		}
+		break;
+	case PgnGameEntry::RoundTag:
+		str = m_round.at(index);
+		break;
+	case PgnGameEntry::WhiteTag:
+		str = m_white.at(index);
+		break;
+	case PgnGameEntry::BlackTag:
+		str = m_black.at(index);
+		break;
+	case PgnGameEntry::ResultTag:
+		{
+			const char* result = s_results[m_result.at(index)];
+			*size = int(strlen(result));
+			return result;
+		}
+	case PgnGameEntry::VariantTag:
+		str = m_variant.at(index);
+		break;
+	}
+
+	return stringData(str, size);
+}
+
+QString PgnDatabase::tagValue(int index, PgnGameEntry::TagType type) const
+{
+	char dateBuffer[10];
+	int size;
+	const char* data = tagData(index, type, dateBuffer, &size);
+
+	if (size == 0)
+		return QString();
+	return QByteArray(data, size);
+}
+
+int PgnDatabase::compareTag(int index,
+			    PgnGameEntry::TagType type,
+			    const PgnDatabase* other,
+			    int otherIndex) const
+{
+	Q_ASSERT(other != 0);
+
+	char dateBuffer1[10];
+	char dateBuffer2[10];
+	int size1;
+	int size2;
+	const char* data1 = tagData(index, type, dateBuffer1, &size1);
+	const char* data2 = other->tagData(otherIndex, type, dateBuffer2, &size2);
+
+	int ret = memcmp(data1, data2, qMin(size1, size2));
+	if (ret != 0)
+		return ret;
+	return size1 - size2;
 }
 
-void PgnDatabase::setEntries(const QList<const PgnGameEntry*>& entries)
+bool PgnDatabase::match(int index, const PgnGameFilter& filter) const
 {
-	qDeleteAll(m_entries);
-	m_entries = entries;
+	char dateBuffer[10];
+	const char* tags[8];
+	int sizes[8];
+
+	for (int type = 0; type < 8; type++)
+		tags[type] = tagData(index, PgnGameEntry::TagType(type),
+				     dateBuffer, &sizes[type]);
+
+	return PgnGameEntry::matchTags(filter, tags, sizes);
+}
+
+static void s_buildIndex(const QVector<int>& counts,
+			 QVector<int>* offsets,
+			 QVector<int>* games)
+{
+	offsets->resize(counts.size() + 1);
+	(*offsets)[0] = 0;
+	for (int i = 0; i < counts.size(); i++)
+		(*offsets)[i + 1] = offsets->at(i) + counts.at(i);
+	games->resize(offsets->last());
 }
 
-QList<const PgnGameEntry*> PgnDatabase::entries() const
+void PgnDatabase::buildSearchIndex() const
 {
-	return m_entries;
+	if (m_searchIndexValid)
+		return;
+
+	int n = entryCount();
+	int strings = stringCount();
+
+	// Count the games of each value, then fill the game lists so
+	// that each list is in ascending order
+	QVector<int> players(strings, 0);
+	QVector<int> events(strings, 0);
+	QVector<int> sites(strings, 0);
+	QVector<int> results(s_resultCount, 0);
+	m_unindexedStrings = QBitArray(strings);
+	m_oddDates.clear();
+
+	QVector<quint64> dates;
+	dates.reserve(n);
+	for (int i = 0; i < n; i++)
+	{
+		players[m_white.at(i)]++;
+		if (m_black.at(i) != m_white.at(i))
+			players[m_black.at(i)]++;
+		events[m_event.at(i)]++;
+		sites[m_site.at(i)]++;
+		results[m_result.at(i)]++;
+
+		m_unindexedStrings.setBit(m_round.at(i));
+		m_unindexedStrings.setBit(m_variant.at(i));
+
+		quint32 date = m_date.at(i);
+		if (date & s_packedDate)
+		{
+			// Games without a year never match a date range
+			if ((date >> 9) & 0x3fff)
+				dates.append((quint64(date) << 32) | quint32(i));
+		}
+		else if (date & s_internedDate)
+		{
+			m_unindexedStrings.setBit(date & ~s_internedDate);
+			m_oddDates.append(i);
+		}
+	}
+
+	s_buildIndex(players, &m_playerIndex.offsets, &m_playerIndex.games);
+	s_buildIndex(events, &m_eventIndex.offsets, &m_eventIndex.games);
+	s_buildIndex(sites, &m_siteIndex.offsets, &m_siteIndex.games);
+	s_buildIndex(results, &m_resultIndex.offsets, &m_resultIndex.games);
+
+	QVector<int> playerPos(m_playerIndex.offsets);
+	QVector<int> eventPos(m_eventIndex.offsets);
+	QVector<int> sitePos(m_siteIndex.offsets);
+	QVector<int> resultPos(m_resultIndex.offsets);
+	for (int i = 0; i < n; i++)
+	{
+		m_playerIndex.games[playerPos[m_white.at(i)]++] = i;
+		if (m_black.at(i) != m_white.at(i))
+			m_playerIndex.games[playerPos[m_black.at(i)]++] = i;
+		m_eventIndex.games[eventPos[m_event.at(i)]++] = i;
+		m_siteIndex.games[sitePos[m_site.at(i)]++] = i;
+		m_resultIndex.games[resultPos[m_result.at(i)]++] = i;
+	}
+
+	qSort(dates);
+	m_dateKeys.resize(dates.size());
+	m_dateOrder.resize(dates.size());
+	for (int i = 0; i < dates.size(); i++)
+	{
+		m_dateKeys[i] = quint32(dates.at(i) >> 32);
+		m_dateOrder[i] = int(dates.at(i) & 0xffffffff);
+	}
+
+	m_searchIndexValid = true;
+}
+
+QBitArray PgnDatabase::matchingStrings(const char* pattern) const
+{
+	QBitArray strings(stringCount());
+
+	for (int i = 1; i < stringCount(); i++)
+	{
+		int size;
+		const char* str = stringData(i, &size);
+		if (s_contains(str, size, pattern))
+			strings.setBit(i);
+	}
+
+	return strings;
+}
+
+bool PgnDatabase::addCandidates(const InvertedIndex& index,
+				const QBitArray& values,
+				int limit,
+				QVector<int>* candidates) const
+{
+	for (int i = 0; i < values.size(); i++)
+	{
+		if (!values.testBit(i))
+			continue;
+
+		const int* begin = index.games.constData() + index.offsets.at(i);
+		const int* end = index.games.constData() + index.offsets.at(i + 1);
+		if (candidates->size() + (end - begin) > limit)
+			return false;
+		for (; begin != end; ++begin)
+			candidates->append(*begin);
+	}
+
+	return true;
+}
+
+bool PgnDatabase::dateCandidates(const PgnGameFilter& filter,
+				 int limit,
+				 QVector<int>* candidates) const
+{
+	// Only the year is used here. The exact dates are checked by
+	// match() later.
+	quint32 minKey = 0;
+	quint32 maxKey = 0xffffffff;
+	if (!filter.minDate().isNull())
+		minKey = s_packedDate | (filter.minDate().year() << 9);
+	if (!filter.maxDate().isNull())
+		maxKey = s_packedDate | (filter.maxDate().year() << 9) | 0x1ff;
+
+	const quint32* begin = qLowerBound(m_dateKeys.constBegin(),
+					   m_dateKeys.constEnd(), minKey);
+	const quint32* end = qUpperBound(begin, m_dateKeys.constEnd(), maxKey);
+	if ((end - begin) + m_oddDates.size() > limit)
+		return false;
+
+	const int* games = m_dateOrder.constData() + (begin - m_dateKeys.constBegin());
+	for (; begin != end; ++begin)
+		candidates->append(*games++);
+
+	// Dates in other formats may still look like dates to match()
+	*candidates += m_oddDates;
+
+	return true;
+}
+
+bool PgnDatabase::findCandidates(const PgnGameFilter& filter,
+				 QVector<int>* candidates) const
+{
+	Q_ASSERT(candidates != 0);
+
+	buildSearchIndex();
+
+	// A scan is about as fast as merging large candidate lists
+	int limit = entryCount() / 4;
+	bool found = false;
+
+	if (filter.type() == PgnGameFilter::FixedString)
+	{
+		const char* pattern = filter.pattern();
+		if (!*pattern)
+			return false;
+
+		// The pattern could match a packed date
+		if (strspn(pattern, "0123456789.?") == strlen(pattern))
+			return false;
+
+		QBitArray strings = matchingStrings(pattern);
+		if ((strings & m_unindexedStrings).count(true) > 0)
+			return false;
+
+		QBitArray results(s_resultCount);
+		for (int i = 1; i < s_resultCount; i++)
+		{
+			if (s_contains(s_results[i], int(strlen(s_results[i])), pattern))
+				results.setBit(i);
+		}
+
+		candidates->clear();
+		if (!addCandidates(m_playerIndex, strings, limit, candidates)
+		||  !addCandidates(m_eventIndex, strings, limit, candidates)
+		||  !addCandidates(m_siteIndex, strings, limit, candidates)
+		||  !addCandidates(m_resultIndex, results, limit, candidates))
+			return false;
+
+		s_sortUnique(candidates);
+		return true;
+	}
+
+	// Every criterion must match, so the smallest candidate list
+	// of any indexed criterion is enough.
+	QVector<int> list;
+	const char* names[] = { filter.event(), filter.site(),
+				filter.player(), filter.opponent() };
+	const InvertedIndex* indexes[] = { &m_eventIndex, &m_siteIndex,
+					   &m_playerIndex, &m_playerIndex };
+	for (int i = 0; i < 4; i++)
+	{
+		if (!*names[i])
+			continue;
+
+		list.clear();
+		if (addCandidates(*indexes[i], matchingStrings(names[i]), limit, &list))
+		{
+			*candidates = list;
+			limit = list.size();
+			found = true;
+		}
+	}
+
+	if (!filter.minDate().isNull() || !filter.maxDate().isNull())
+	{
+		list.clear();
+		if (dateCandidates(filter, limit, &list))
+		{
+			*candidates = list;
+			limit = list.size();
+			found = true;
+		}
+	}
+
+	int resultCodes = s_resultCodes(filter.result());
+	if (resultCodes != 0 && !filter.isResultInverted())
+	{
+		QBitArray results(s_resultCount);
+		for (int i = 0; i < s_resultCount; i++)
+		{
+			if (resultCodes & (1 << i))
+				results.setBit(i);
+		}
+
+		list.clear();
+		if (addCandidates(m_resultIndex, results, limit, &list))
+		{
+			*candidates = list;
+			found = true;
+		}
+	}
+
+	if (found)
+		s_sortUnique(candidates);
+	return found;
+}
+
+bool PgnDatabase::readEntries(QDataStream& in, int count)
+{
+	PgnGameEntry entry;
+
+	reserve(entryCount() + count);
+	for (int i = 0; i < count; i++)
+	{
+		if (!entry.read(in))
+			return false;
+		addEntry(entry);
+	}
+
+	return true;
+}
+
+void PgnDatabase::writeEntries(QDataStream& out) const
+{
+	// This must produce the same output as PgnGameEntry::write()
+	char dateBuffer[10];
+	QByteArray data;
+
+	for (int i = 0; i < entryCount(); i++)
+	{
+		data.resize(0);
+		for (int type = 0; type < 8; type++)
+		{
+			int size;
+			const char* tag = tagData(i, PgnGameEntry::TagType(type),
+						  dateBuffer, &size);
+			size = qMin(127, size);
+			data.append(char(size));
+			data.append(tag, size);
+		}
+
+		out << m_pos.at(i);
+		out << m_lineNumber.at(i);
+		out << data;
+	}
+}
+
+bool PgnDatabase::saveIndex(const QString& fileName)
+{
+	if (status() != Ok)
+		return false;
+
+	IndexHeader header;
+	header.magic = s_indexMagic;
+	header.version = s_indexVersion;
+	header.byteOrder = s_indexByteOrder;
+	header.entryCount = entryCount();
+	header.importedSize = m_importedSize;
+	header.importedLineNumber = m_importedLineNumber;
+	memset(header.tailHash, 0, sizeof(header.tailHash));
+	memcpy(header.tailHash, m_tailHash.constData(),
+	       qMin(m_tailHash.size(), int(sizeof(header.tailHash))));
+	header.lastModified = m_lastModified.toTime_t();
+	header.stringCount = stringCount();
+	header.stringDataSize = m_stringData.size();
+	header.positionCount = m_hasPositionIndex ? m_positionKeys.size() : -1;
+	header.openingMoveCount = m_hasOpeningTree ? m_openingTree.size() : -1;
+	header.gameHashCount = m_hasGameHashes ? m_gameHashes.size() : -1;
+	header.reserved = 0;
+
+	// The old index may still be mapped, so it's replaced only
+	// after the new one is complete.
+	QFile file(fileName + ".tmp");
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	int n = entryCount();
+	bool ok = s_writeSection(&file, &header, sizeof(header))
+	       && s_writeSection(&file, m_pos.constData(), n * sizeof(qint64))
+	       && s_writeSection(&file, m_lineNumber.constData(), n * sizeof(qint64))
+	       && s_writeSection(&file, m_event.constData(), n * sizeof(quint32))
+	       && s_writeSection(&file, m_site.constData(), n * sizeof(quint32))
+	       && s_writeSection(&file, m_date.constData(), n * sizeof(quint32))
+	       && s_writeSection(&file, m_round.constData(), n * sizeof(quint32))
+	       && s_writeSection(&file, m_white.constData(), n * sizeof(quint32))
+	       && s_writeSection(&file, m_black.constData(), n * sizeof(quint32))
+	       && s_writeSection(&file, m_variant.constData(), n * sizeof(quint32))
+	       && s_writeSection(&file, m_result.constData(), n * sizeof(quint8))
+	       && s_writeSection(&file, m_stringOffsets.constData(),
+				 m_stringOffsets.size() * sizeof(quint32))
+	       && s_writeSection(&file, m_stringData.constData(), m_stringData.size())
+	       && s_writeSection(&file, m_positionKeys.constData(),
+				 m_positionKeys.size() * sizeof(quint64))
+	       && s_writeSection(&file, m_positionGames.constData(),
+				 m_positionGames.size() * sizeof(quint32))
+	       && s_writeSection(&file, m_openingTree.constData(),
+				 m_openingTree.size() * sizeof(OpeningMove))
+	       && s_writeSection(&file, m_gameHashes.constData(),
+				 m_gameHashes.size() * sizeof(quint64));
+	file.close();
+
+	if (!ok || file.error() != QFile::NoError)
+	{
+		file.remove();
+		return false;
+	}
+
+	QFile::remove(fileName);
+	if (!file.rename(fileName))
+	{
+		file.remove();
+		return false;
+	}
+
+	m_indexFileName = fileName;
+	return true;
+}
+
+bool PgnDatabase::loadIndex(const QString& fileName)
+{
+	QFile* file = new QFile(fileName);
+	if (!file->open(QIODevice::ReadOnly) || file->size() < qint64(sizeof(IndexHeader)))
+	{
+		delete file;
+		return false;
+	}
+
+	qint64 size = file->size();
+	const char* data = (const char*)file->map(0, size);
+	if (data == 0)
+	{
+		delete file;
+		return false;
+	}
+
+	IndexHeader header;
+	memcpy(&header, data, sizeof(header));
+
+	int n = header.entryCount;
+	qint64 expectedSize = s_align(sizeof(header))
+			    + 2 * s_align(qint64(n) * sizeof(qint64))
+			    + 7 * s_align(qint64(n) * sizeof(quint32))
+			    + s_align(qint64(n) * sizeof(quint8))
+			    + s_align((header.stringCount + 1) * sizeof(quint32))
+			    + s_align(header.stringDataSize);
+	qint64 positions = qMax(0, header.positionCount);
+	expectedSize += s_align(positions * sizeof(quint64))
+		      + s_align(positions * sizeof(quint32));
+	qint64 openingMoves = qMax(0, header.openingMoveCount);
+	expectedSize += s_align(openingMoves * sizeof(OpeningMove));
+	qint64 gameHashes = qMax(0, header.gameHashCount);
+	expectedSize += s_align(gameHashes * sizeof(quint64));
+
+	if (header.magic != s_indexMagic
+	||  header.version != s_indexVersion
+	||  header.byteOrder != s_indexByteOrder
+	||  header.entryCount < 0
+	||  header.stringCount < 1
+	||  (header.gameHashCount >= 0 && header.gameHashCount != n)
+	||  header.lastModified != qint64(m_lastModified.toTime_t())
+	||  expectedSize != size)
+	{
+		delete file;
+		return false;
+	}
+
+	clear();
+	m_indexFile = file;
+	m_indexFileName = fileName;
+
+	qint64 pos = s_align(sizeof(header));
+	m_pos.setRawData((const qint64*)(data + pos), n);
+	pos += s_align(n * sizeof(qint64));
+	m_lineNumber.setRawData((const qint64*)(data + pos), n);
+	pos += s_align(n * sizeof(qint64));
+
+	PgnDatabaseColumn<quint32>* tagColumns[] =
+	{
+		&m_event, &m_site, &m_date, &m_round, &m_white, &m_black, &m_variant
+	};
+	for (int i = 0; i < 7; i++)
+	{
+		tagColumns[i]->setRawData((const quint32*)(data + pos), n);
+		pos += s_align(n * sizeof(quint32));
+	}
+
+	m_result.setRawData((const quint8*)(data + pos), n);
+	pos += s_align(n * sizeof(quint8));
+	m_stringOffsets.setRawData((const quint32*)(data + pos),
+				   header.stringCount + 1);
+	pos += s_align((header.stringCount + 1) * sizeof(quint32));
+	m_stringData = QByteArray::fromRawData(data + pos, header.stringDataSize);
+	pos += s_align(header.stringDataSize);
+
+	m_hasPositionIndex = header.positionCount >= 0;
+	m_positionKeys.setRawData((const quint64*)(data + pos), int(positions));
+	pos += s_align(positions * sizeof(quint64));
+	m_positionGames.setRawData((const quint32*)(data + pos), int(positions));
+	pos += s_align(positions * sizeof(quint32));
+
+	m_hasOpeningTree = header.openingMoveCount >= 0;
+	m_openingTree.setRawData((const OpeningMove*)(data + pos), int(openingMoves));
+	pos += s_align(openingMoves * sizeof(OpeningMove));
+
+	m_hasGameHashes = header.gameHashCount >= 0;
+	m_gameHashes.setRawData((const quint64*)(data + pos), int(gameHashes));
+
+	m_importedSize = header.importedSize;
+	m_importedLineNumber = header.importedLineNumber;
+	m_tailHash = QByteArray(header.tailHash, sizeof(header.tailHash));
+	if (m_importedSize <= 0)
+		m_tailHash.clear();
+
+	if (m_stringOffsets.at(0) != 0
+	||  m_stringOffsets.at(header.stringCount) != header.stringDataSize)
+	{
+		clear();
+		return false;
+	}
+
+	return true;
+}
+
+QString PgnDatabase::indexFileName() const
+{
+	return m_indexFileName;
 }
 
 QString PgnDatabase::fileName() const
@@ -81,22 +1322,34 @@ void PgnDatabase::setDisplayName(const QString& displayName)
 	m_displayName = displayName;
 }
 
-PgnDatabase::Status PgnDatabase::game(const PgnGameEntry* entry,
-				      PgnGame* game)
+PgnDatabase::Status PgnDatabase::game(int index, PgnGame* game)
 {
-	Q_ASSERT(entry != 0);
+	Q_ASSERT(index >= 0 && index < entryCount());
 	Q_ASSERT(game != 0);
 
+	QMutexLocker locker(&m_gameMutex);
+
 	Status status = this->status();
 	if (status != Ok)
+	{
+		// The file may have been replaced, so don't keep it mapped
+		closeGameFile();
 		return status;
+	}
 
-	QFile file(m_fileName);
-	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
-		return Unreadable;
+	if (m_gameStream == 0)
+	{
+		m_gameFile = new QFile(m_fileName);
+		if (!m_gameFile->open(QIODevice::ReadOnly | QIODevice::Text))
+		{
+			closeGameFile();
+			return Unreadable;
+		}
+		m_gameStream = new PgnStream(m_gameFile);
+	}
 
-	PgnStream in(&file);
-	if (!in.seek(entry->pos(), entry->lineNumber()) || !game->read(in))
+	if (!m_gameStream->seek(m_pos.at(index), m_lineNumber.at(index))
+	||  !game->read(*m_gameStream))
 		return Corrupted;
 
 	return Ok;
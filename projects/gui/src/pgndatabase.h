@@ -20,15 +20,99 @@
 
 #include <QObject>
 #include <QList>
+#include <QVector>
+#include <QtAlgorithms>
+#include <QMultiHash>
+#include <QByteArray>
+#include <QBitArray>
 #include <QDateTime>
 #include <QFile>
+#include <QMutex>
 #include <pgngame.h>
 #include <pgngameentry.h>
 class PgnStream;
+class PgnGameFilter;
+class QDataStream;
+
+
+/*!
+ * \brief A column of PgnDatabase game entries.
+ *
+ * The column's data is either owned by the column or borrowed from
+ * an external buffer, usually a memory-mapped index file. A borrowed
+ * column is copied to owned storage the first time it's modified.
+ */
+template <typename T>
+class PgnDatabaseColumn
+{
+	public:
+		PgnDatabaseColumn()
+			: m_data(0), m_size(0), m_borrowed(false) {}
+
+		int size() const { return m_size; }
+		const T* constData() const { return m_data; }
+		const T& at(int i) const
+		{
+			Q_ASSERT(i >= 0 && i < m_size);
+			return m_data[i];
+		}
+
+		void setRawData(const T* data, int size)
+		{
+			m_vector.clear();
+			m_data = data;
+			m_size = size;
+			m_borrowed = true;
+		}
+		void append(const T& value)
+		{
+			detach();
+			m_vector.append(value);
+			sync();
+		}
+		void reserve(int size)
+		{
+			detach();
+			m_vector.reserve(size);
+			sync();
+		}
+		void clear()
+		{
+			m_vector.clear();
+			m_borrowed = false;
+			sync();
+		}
+
+	private:
+		void detach()
+		{
+			if (!m_borrowed)
+				return;
+			m_vector.resize(m_size);
+			qCopy(m_data, m_data + m_size, m_vector.begin());
+			m_borrowed = false;
+		}
+		void sync()
+		{
+			m_data = m_vector.constData();
+			m_size = m_vector.size();
+		}
+
+		QVector<T> m_vector;
+		const T* m_data;
+		int m_size;
+		bool m_borrowed;
+};
 
 /*!
  * \brief PGN database
  *
+ * The game entries are stored in columns rather than as individual
+ * PgnGameEntry objects. Player, event, site, round and variant names
+ * are interned, dates and results are packed into integers, and each
+ * column is a single contiguous array. This keeps databases of
+ * millions of games compact.
+ *
  * \sa PgnGame
  * \sa PgnGameEntry
  * \sa PgnImporter
@@ -48,6 +132,57 @@ class PgnDatabase : public QObject
 			Corrupted	//!< Database contains corrupted or invalid data
 		};
 
+		/*!
+		 * \brief Statistics of a move played in a database position.
+		 *
+		 * The opening tree of a database is a table of these records,
+		 * sorted by position key and move.
+		 *
+		 * \sa openingMoves()
+		 */
+		struct OpeningMove
+		{
+			/*! The Zobrist key of the position before the move. */
+			quint64 key;
+			/*! The move, packed by packMove(). */
+			quint32 move;
+			/*! The number of games in which the move was played. */
+			quint32 games;
+			/*! The number of those games won by white. */
+			quint32 whiteWins;
+			/*! The number of those games that were drawn. */
+			quint32 draws;
+			/*! The number of those games won by black. */
+			quint32 blackWins;
+			/*! The number of games with a known Elo of the mover. */
+			quint32 eloCount;
+			/*! The sum of the known Elo ratings of the mover. */
+			quint64 eloSum;
+
+			/*! Returns the move in the generic format. */
+			Chess::GenericMove genericMove() const;
+			/*!
+			 * Returns the score of the move from the point of view
+			 * of \a side, between 0.0 and 1.0.
+			 *
+			 * Unfinished games are not counted. Returns 0.0 if
+			 * none of the games were finished.
+			 */
+			qreal score(Chess::Side side) const;
+			/*!
+			 * Returns the mean Elo rating of the players who
+			 * played the move, or 0 if no ratings are known.
+			 */
+			int meanElo() const;
+			/*! Adds the statistics of \a other to this record. */
+			void add(const OpeningMove& other);
+			/*! Orders the records by position key and move. */
+			bool operator<(const OpeningMove& other) const;
+
+			/*! Packs \a move into 32 bits. */
+			static quint32 packMove(const Chess::GenericMove& move);
+		};
+
 		/*!
 		 * Constructs a new PgnDatabase with \a parent and \a fileName as
 		 * the underlying database.
@@ -56,22 +191,208 @@ class PgnDatabase : public QObject
 		/*! Destroys the database and the game entries it contains. */
 		virtual ~PgnDatabase();
 
+		/*! Removes all game entries from the database. */
+		void clear();
+		/*!
+		 * Reserves space for \a count game entries.
+		 *
+		 * Calling this before adding a known number of entries
+		 * avoids reallocating the columns.
+		 */
+		void reserve(int count);
+		/*!
+		 * Appends a copy of \a entry to the database.
+		 *
+		 * \note Only the data of \a entry is stored. The object
+		 * itself is not needed after this call.
+		 */
+		void addEntry(const PgnGameEntry& entry);
+		/*!
+		 * Appends the game entries of \a other to the database, and
+		 * takes over its import information.
+		 *
+		 * \a other is expected to contain the games that were
+		 * appended to the database file since the last import.
+		 *
+		 * \sa isAppended()
+		 */
+		void append(const PgnDatabase& other);
+		/*! Returns the number of game entries in this database. */
+		int entryCount() const;
+		/*! Returns the stream position of the game at \a index. */
+		qint64 entryPos(int index) const;
+		/*! Returns the line number of the game at \a index. */
+		qint64 entryLineNumber(int index) const;
+		/*! Returns the value of tag \a type of the game at \a index. */
+		QString tagValue(int index, PgnGameEntry::TagType type) const;
+		/*!
+		 * Compares tag \a type of the game at \a index to the same
+		 * tag of the game at \a otherIndex in database \a other.
+		 *
+		 * The tag values are compared byte by byte. Returns a negative
+		 * value, zero or a positive value if this game's value is
+		 * less than, equal to or greater than the other game's value.
+		 */
+		int compareTag(int index,
+			       PgnGameEntry::TagType type,
+			       const PgnDatabase* other,
+			       int otherIndex) const;
+		/*!
+		 * Returns true if the tags of the game at \a index match
+		 * \a filter.
+		 *
+		 * \sa PgnGameEntry::match()
+		 */
+		bool match(int index, const PgnGameFilter& filter) const;
 		/*!
-		 * Set the game entries found in this database to \a entries.
+		 * Stores the indexes of the games that may match \a filter
+		 * in \a candidates, in ascending order.
 		 *
-		 * The database takes ownership of the PgnGameEntry objects
-		 * in \a entries.
+		 * The candidates are selected with inverted indexes of the
+		 * player, event and site names and with sorted date and
+		 * result columns, which are built on first use. The
+		 * candidates still have to be checked with match(). Returns
+		 * false if the indexes can't narrow down the search, in which
+		 * case every game must be matched.
+		 *
+		 * \note This function is not thread-safe.
+		 */
+		bool findCandidates(const PgnGameFilter& filter,
+				    QVector<int>* candidates) const;
+		/*!
+		 * Reads \a count game entries from data stream \a in and
+		 * appends them to the database.
+		 *
+		 * The entries must have been written by writeEntries() or
+		 * PgnGameEntry::write(). Returns true if successful.
+		 */
+		bool readEntries(QDataStream& in, int count);
+		/*!
+		 * Writes all game entries to data stream \a out in the same
+		 * format that PgnGameEntry::write() uses.
 		 */
-		void setEntries(const QList<const PgnGameEntry*>& entries);
+		void writeEntries(QDataStream& out) const;
 		/*!
-		 * Returns the list of game entries in this database.
+		 * Writes the game entries to index file \a fileName.
 		 *
-		 * Game entries are light-weight "pointers" to the database. The game()
-		 * method can be used to read the move information.
+		 * The index is tied to the modification time of the database
+		 * file, and it also stores the import information needed by
+		 * isAppended(). Returns true if successful.
 		 *
-		 * \sa game()
+		 * \sa loadIndex()
 		 */
-		QList<const PgnGameEntry*> entries() const;
+		bool saveIndex(const QString& fileName);
+		/*!
+		 * Replaces the game entries with the ones in index file
+		 * \a fileName.
+		 *
+		 * The index file is memory mapped, so the entries are only
+		 * read from disk when they are accessed. Returns false if
+		 * the index can't be read or if it wasn't saved for the
+		 * database file version given by lastModified().
+		 *
+		 * \sa saveIndex()
+		 */
+		bool loadIndex(const QString& fileName);
+		/*!
+		 * Returns the name of the index file that contains the
+		 * current entries, or an empty string if the entries
+		 * have changed since the index was saved or loaded.
+		 */
+		QString indexFileName() const;
+
+		/*!
+		 * Returns true if the database has a position index.
+		 *
+		 * \sa setPositionIndex(), findPosition()
+		 */
+		bool hasPositionIndex() const;
+		/*!
+		 * Sets the position index to \a keys and \a games.
+		 *
+		 * Each pair of a Zobrist key in \a keys and a game index in
+		 * \a games records that the game reaches that position. The
+		 * pairs must be sorted by key, and then by game index.
+		 */
+		void setPositionIndex(const QVector<quint64>& keys,
+				      const QVector<quint32>& games);
+		/*!
+		 * Returns the indexes of the games that reach the position
+		 * with Zobrist key \a key, in ascending order.
+		 *
+		 * Returns an empty list if there is no position index.
+		 */
+		QVector<int> findPosition(quint64 key) const;
+
+		/*!
+		 * Returns true if the database has an opening tree.
+		 *
+		 * \sa setOpeningTree(), openingMoves()
+		 */
+		bool hasOpeningTree() const;
+		/*!
+		 * Sets the opening tree to \a moves.
+		 *
+		 * The records must be sorted, and each pair of a position
+		 * key and a move must appear only once.
+		 */
+		void setOpeningTree(const QVector<OpeningMove>& moves);
+		/*!
+		 * Returns the statistics of the moves played in the position
+		 * with Zobrist key \a key.
+		 *
+		 * The lookup is a binary search of the opening tree, so it's
+		 * fast enough to be done whenever the position changes.
+		 * Returns an empty list if there is no opening tree.
+		 */
+		QVector<OpeningMove> openingMoves(quint64 key) const;
+
+		/*!
+		 * Returns true if the database has a game hash for each
+		 * game entry.
+		 *
+		 * \sa setGameHashes(), gameHash()
+		 */
+		bool hasGameHashes() const;
+		/*!
+		 * Sets the game hashes to \a hashes, one for each game
+		 * entry in order.
+		 *
+		 * A game hash identifies the starting position and the
+		 * moves of a game, so equal hashes mean duplicate games.
+		 */
+		void setGameHashes(const QVector<quint64>& hashes);
+		/*!
+		 * Returns the hash of the game at \a index.
+		 *
+		 * \sa hasGameHashes()
+		 */
+		quint64 gameHash(int index) const;
+
+		/*! Returns the number of imported bytes of the database file. */
+		qint64 importedSize() const;
+		/*!
+		 * Returns the line number at the end of the imported part
+		 * of the database file.
+		 */
+		qint64 importedLineNumber() const;
+		/*!
+		 * Records that the first \a size bytes of the database file,
+		 * ending at line \a lineNumber, have been imported.
+		 *
+		 * A hash of the end of the imported data is stored, so that
+		 * isAppended() can later tell if the data is still intact.
+		 */
+		void setImported(qint64 size, qint64 lineNumber);
+		/*!
+		 * Returns true if the database file has only grown since it
+		 * was imported, ie. if the imported data is unchanged and new
+		 * data was appended after it.
+		 *
+		 * In that case only the data after importedSize() needs to be
+		 * imported again.
+		 */
+		bool isAppended() const;
 
 		/*! Returns the file name of this database. */
 		QString fileName() const;
@@ -114,14 +435,87 @@ class PgnDatabase : public QObject
 		void setDisplayName(const QString& displayName);
 
 		/*!
-		 * Reads \a game from the database using \a entry.
+		 * Reads \a game from the database using the game entry at
+		 * \a index.
+		 *
+		 * The database file is kept open between calls, so reading
+		 * several games in a row doesn't reopen and remap the file.
+		 * This function is thread-safe, which allows games to be read
+		 * on a worker thread.
 		 *
 		 * \note \a game must be allocated by the caller and must not be NULL.
 		 */
-		Status game(const PgnGameEntry* entry, PgnGame* game);
+		Status game(int index, PgnGame* game);
 
 	private:
-		QList<const PgnGameEntry*> m_entries;
+		// Game indexes grouped by a column's value, in ascending order
+		struct InvertedIndex
+		{
+			QVector<int> offsets;
+			QVector<int> games;
+		};
+
+		void closeGameFile();
+		void buildSearchIndex() const;
+		QBitArray matchingStrings(const char* pattern) const;
+		bool addCandidates(const InvertedIndex& index,
+				   const QBitArray& values,
+				   int limit,
+				   QVector<int>* candidates) const;
+		bool dateCandidates(const PgnGameFilter& filter,
+				    int limit,
+				    QVector<int>* candidates) const;
+		void addEntry(qint64 pos,
+			      qint64 lineNumber,
+			      const char* const* tags,
+			      const int* sizes);
+		int stringCount() const;
+		const char* stringData(quint32 index, int* size) const;
+		quint32 internString(const char* data, int size);
+		quint32 packDate(const char* data, int size);
+		const char* tagData(int index,
+				    PgnGameEntry::TagType type,
+				    char* dateBuffer,
+				    int* size) const;
+
+		PgnDatabaseColumn<qint64> m_pos;
+		PgnDatabaseColumn<qint64> m_lineNumber;
+		PgnDatabaseColumn<quint32> m_event;
+		PgnDatabaseColumn<quint32> m_site;
+		PgnDatabaseColumn<quint32> m_date;
+		PgnDatabaseColumn<quint32> m_round;
+		PgnDatabaseColumn<quint32> m_white;
+		PgnDatabaseColumn<quint32> m_black;
+		PgnDatabaseColumn<quint32> m_variant;
+		PgnDatabaseColumn<quint8> m_result;
+		PgnDatabaseColumn<quint32> m_stringOffsets;
+		bool m_hasPositionIndex;
+		PgnDatabaseColumn<quint64> m_positionKeys;
+		PgnDatabaseColumn<quint32> m_positionGames;
+		bool m_hasOpeningTree;
+		PgnDatabaseColumn<OpeningMove> m_openingTree;
+		bool m_hasGameHashes;
+		PgnDatabaseColumn<quint64> m_gameHashes;
+		QByteArray m_stringData;
+		QMultiHash<uint, quint32> m_stringIndex;
+		QFile* m_indexFile;
+		QString m_indexFileName;
+		qint64 m_importedSize;
+		qint64 m_importedLineNumber;
+		QByteArray m_tailHash;
+
+		mutable bool m_searchIndexValid;
+		mutable InvertedIndex m_playerIndex;
+		mutable InvertedIndex m_eventIndex;
+		mutable InvertedIndex m_siteIndex;
+		mutable InvertedIndex m_resultIndex;
+		mutable QVector<quint32> m_dateKeys;
+		mutable QVector<int> m_dateOrder;
+		mutable QVector<int> m_oddDates;
+		mutable QBitArray m_unindexedStrings;
+		QMutex m_gameMutex;
+		QFile* m_gameFile;
+		PgnStream* m_gameStream;
 		QDateTime m_lastModified;
 		QString m_fileName;
 		QString m_displayName;
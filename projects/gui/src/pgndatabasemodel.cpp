@@ -95,6 +95,9 @@ QVariant PgnDatabaseModel::data(const QModelIndex& index, int role) const
 		switch (index.column())
 		{
 			case 0:
+				if (role == Qt::DisplayRole
+				&&  m_gameDatabaseManager->isLoading(db))
+					return tr("%1 (loading)").arg(db->displayName());
 				return db->displayName();
 
 			default:
@@ -129,6 +132,11 @@ Qt::ItemFlags PgnDatabaseModel::flags(const QModelIndex& index) const
 	if (!index.isValid())
 		return Qt::ItemFlags(Qt::NoItemFlags);
 
+	// A loading database has no games to show yet
+	const PgnDatabase* db = m_gameDatabaseManager->databases().at(index.row());
+	if (m_gameDatabaseManager->isLoading(db))
+		return Qt::ItemFlags(Qt::NoItemFlags);
+
 	Qt::ItemFlags defaultFlags =
 		Qt::ItemFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
 
@@ -16,94 +16,292 @@
 */
 
 #include "pgngameentrymodel.h"
+#include <QtConcurrentRun>
 #include <QtConcurrentFilter>
-#include <pgngameentry.h>
-
+#include <QtAlgorithms>
+#include <QMutex>
+#include <algorithm>
+#include "pgndatabase.h"
+
+// Number of entries that are filtered or sorted between checks
+// for a newer query
+static const int s_chunkSize = 0x10000;
+// Number of rows added to the model by each fetchMore() call
+static const int s_fetchSize = 1024;
+// Number of entries whose decoded tag values are cached
+static const int s_tagCacheSize = 4096;
+// Number of tag columns
+static const int s_columnCount = 7;
+
+// Queries share the databases' lazily built search indexes, so
+// they're run one at a time
+static QMutex s_queryMutex;
+
+// Returns the index of the database that contains the game entry at
+// \a index, given the index of each database's first entry in \a offsets.
+static int s_databaseIndex(const QVector<int>& offsets, int index)
+{
+	return qUpperBound(offsets.constBegin(), offsets.constEnd(), index)
+	       - offsets.constBegin() - 1;
+}
 
 struct EntryContains
 {
-	EntryContains(const QList<const PgnGameEntry*>& entries,
+	EntryContains(const QList<const PgnDatabase*>& databases,
+		      const QVector<int>& offsets,
 		      const PgnGameFilter& filter)
-		: m_entries(entries), m_filter(filter) { }
+		: m_databases(databases), m_offsets(offsets), m_filter(filter) { }
 
 	typedef bool result_type;
 
 	inline bool operator()(int index)
 	{
-		return m_entries.at(index)->match(m_filter);
+		int db = s_databaseIndex(m_offsets, index);
+		return m_databases.at(db)->match(index - m_offsets.at(db), m_filter);
 	}
 
-	const QList<const PgnGameEntry*>& m_entries;
+	QList<const PgnDatabase*> m_databases;
+	QVector<int> m_offsets;
 	PgnGameFilter m_filter;
 };
 
+struct EntryLessThan
+{
+	EntryLessThan(const QList<const PgnDatabase*>& databases,
+		      const QVector<int>& offsets,
+		      PgnGameEntry::TagType type,
+		      Qt::SortOrder order)
+		: m_databases(databases), m_offsets(offsets),
+		  m_type(type), m_order(order) { }
+
+	inline bool operator()(int index1, int index2) const
+	{
+		int db1 = s_databaseIndex(m_offsets, index1);
+		int db2 = s_databaseIndex(m_offsets, index2);
+		int ret = m_databases.at(db1)->compareTag(index1 - m_offsets.at(db1),
+							  m_type,
+							  m_databases.at(db2),
+							  index2 - m_offsets.at(db2));
+		return m_order == Qt::AscendingOrder ? ret < 0 : ret > 0;
+	}
+
+	QList<const PgnDatabase*> m_databases;
+	QVector<int> m_offsets;
+	PgnGameEntry::TagType m_type;
+	Qt::SortOrder m_order;
+};
+
+struct EntryQuery
+{
+	bool isCanceled() const
+	{
+		#if QT_VERSION >= 0x050000
+		return latestId->loadAcquire() != id;
+		#else
+		return *latestId != id;
+		#endif
+	}
+
+	int id;
+	const QAtomicInt* latestId;
+	QList<const PgnDatabase*> databases;
+	QVector<int> offsets;
+	PgnGameFilter filter;
+	int sortColumn;
+	Qt::SortOrder sortOrder;
+};
+
+// Returns the source indexes of the entries that match \a query in
+// display order, or an empty vector if the query was canceled.
+static QVector<int> s_runQuery(const EntryQuery& query)
+{
+	QMutexLocker locker(&s_queryMutex);
+
+	// Let the databases' search indexes select the candidates, and
+	// scan all entries of the databases that can't narrow the search.
+	QVector<int> candidates;
+	for (int i = 0; i < query.databases.size(); i++)
+	{
+		if (query.isCanceled())
+			return QVector<int>();
+
+		const PgnDatabase* db = query.databases.at(i);
+		int offset = query.offsets.at(i);
+		QVector<int> dbCandidates;
+
+		if (db->findCandidates(query.filter, &dbCandidates))
+		{
+			for (int j = 0; j < dbCandidates.size(); j++)
+				candidates.append(offset + dbCandidates.at(j));
+		}
+		else
+		{
+			for (int j = 0; j < db->entryCount(); j++)
+				candidates.append(offset + j);
+		}
+	}
+
+	QVector<int> rows;
+	EntryContains contains(query.databases, query.offsets, query.filter);
+	for (int i = 0; i < candidates.size(); i += s_chunkSize)
+	{
+		if (query.isCanceled())
+			return QVector<int>();
+
+		QVector<int> chunk(candidates.mid(i, s_chunkSize));
+		rows += QtConcurrent::blockingFiltered(chunk, contains);
+	}
+
+	if (query.sortColumn < 0)
+		return rows;
+
+	// Merge sort in chunks so that the sort can be abandoned
+	EntryLessThan lessThan(query.databases,
+			       query.offsets,
+			       PgnGameEntry::TagType(query.sortColumn),
+			       query.sortOrder);
+	QVector<int>::iterator begin = rows.begin();
+	int n = rows.size();
+
+	for (int i = 0; i < n; i += s_chunkSize)
+	{
+		if (query.isCanceled())
+			return QVector<int>();
+		std::stable_sort(begin + i, begin + qMin(i + s_chunkSize, n),
+				 lessThan);
+	}
+	for (int width = s_chunkSize; width < n; width *= 2)
+	{
+		for (int i = 0; i < n - width; i += 2 * width)
+		{
+			if (query.isCanceled())
+				return QVector<int>();
+			std::inplace_merge(begin + i,
+					   begin + i + width,
+					   begin + qMin(i + 2 * width, n),
+					   lessThan);
+		}
+	}
+
+	return rows;
+}
+
 
 PgnGameEntryModel::PgnGameEntryModel(QObject* parent)
 	: QAbstractItemModel(parent),
-	  m_entryCount(0)
+	  m_entryCount(0),
+	  m_sortColumn(-1),
+	  m_sortOrder(Qt::AscendingOrder),
+	  m_tagCache(s_tagCacheSize)
+{
+	connect(&m_watcher, SIGNAL(finished()),
+		this, SLOT(onQueryFinished()));
+}
+
+PgnGameEntryModel::~PgnGameEntryModel()
 {
-	connect(&m_watcher, SIGNAL(resultsReadyAt(int,int)),
-		this, SLOT(onResultsReady()));
+	cancelQueries();
 }
 
-const PgnGameEntry* PgnGameEntryModel::entryAt(int row) const
+const PgnDatabase* PgnGameEntryModel::databaseAt(int row, int* index) const
 {
-	return m_entries.at(m_filtered.resultAt(row));
+	Q_ASSERT(index != 0);
+
+	int source = m_rows.at(row);
+	int db = s_databaseIndex(m_offsets, source);
+	*index = source - m_offsets.at(db);
+
+	return m_databases.at(db);
 }
 
 int PgnGameEntryModel::sourceIndex(int row) const
 {
-	return m_filtered.resultAt(row);
+	return m_rows.at(row);
 }
 
 int PgnGameEntryModel::entryCount() const
 {
-	return m_filtered.resultCount();
+	return m_rows.size();
 }
 
-void PgnGameEntryModel::setEntries(const QList<const PgnGameEntry*>& entries)
+void PgnGameEntryModel::setDatabases(const QList<const PgnDatabase*>& databases)
 {
-	m_watcher.cancel();
-	m_watcher.waitForFinished();
-
-	m_entries = entries;
+	// The old databases may be destroyed after this call, so the
+	// queries that still use them have to stop first
+	cancelQueries();
 
-	if (entries.size() > m_indexes.size())
+	beginResetModel();
+	m_databases = databases;
+	m_offsets.clear();
+	int count = 0;
+	foreach (const PgnDatabase* db, databases)
 	{
-		m_indexes.reserve(entries.size());
-		for (int i = m_indexes.size(); i < entries.size(); i++)
-			m_indexes.append(i);
+		m_offsets.append(count);
+		count += db->entryCount();
 	}
+	m_rows.clear();
+	m_entryCount = 0;
+	m_tagCache.clear();
+	endResetModel();
 
-	applyFilter(m_filter);
+	startQuery();
 }
 
-void PgnGameEntryModel::onResultsReady()
+void PgnGameEntryModel::setFilter(const PgnGameFilter& filter)
 {
-	if (m_entryCount < 1024)
-		fetchMore(QModelIndex());
+	m_filter = filter;
+	startQuery();
 }
 
-void PgnGameEntryModel::applyFilter(const PgnGameFilter& filter)
+void PgnGameEntryModel::sort(int column, Qt::SortOrder order)
 {
-	beginResetModel();
-	m_entryCount = 0;
+	m_sortColumn = column;
+	m_sortOrder = order;
+	startQuery();
+}
 
-	m_filtered = QtConcurrent::filtered(m_indexes.constBegin(),
-					    m_indexes.constBegin() + m_entries.size(),
-					    EntryContains(m_entries, filter));
+void PgnGameEntryModel::startQuery()
+{
+	EntryQuery query;
+	query.id = m_queryId.fetchAndAddOrdered(1) + 1;
+	query.latestId = &m_queryId;
+	query.databases = m_databases;
+	query.offsets = m_offsets;
+	query.filter = m_filter;
+	query.sortColumn = m_sortColumn;
+	query.sortOrder = m_sortOrder;
+
+	for (int i = m_queries.size() - 1; i >= 0; i--)
+	{
+		if (m_queries.at(i).isFinished())
+			m_queries.removeAt(i);
+	}
 
-	m_watcher.setFuture(m_filtered);
-	endResetModel();
+	QFuture< QVector<int> > future(QtConcurrent::run(s_runQuery, query));
+	m_queries.append(future);
+	m_watcher.setFuture(future);
 }
 
-void PgnGameEntryModel::setFilter(const PgnGameFilter& filter)
+void PgnGameEntryModel::cancelQueries()
 {
-	m_watcher.cancel();
-	m_watcher.waitForFinished();
+	m_queryId.fetchAndAddOrdered(1);
+	foreach (QFuture< QVector<int> > future, m_queries)
+		future.waitForFinished();
+	m_queries.clear();
+}
 
-	m_filter = filter;
-	applyFilter(filter);
+void PgnGameEntryModel::onQueryFinished()
+{
+	// The watcher may report a query that was replaced by a newer
+	// one, or report the same query twice
+	if (!m_watcher.isFinished() || m_watcher.future() == m_shownQuery)
+		return;
+	m_shownQuery = m_watcher.future();
+
+	beginResetModel();
+	m_rows = m_watcher.result();
+	m_entryCount = qMin(s_fetchSize, m_rows.size());
+	endResetModel();
 }
 
 QModelIndex PgnGameEntryModel::index(int row, int column,
@@ -135,7 +333,7 @@ int PgnGameEntryModel::columnCount(const QModelIndex& parent) const
 	if (parent.isValid())
 		return 0;
 
-	return 7;
+	return s_columnCount;
 }
 
 QVariant PgnGameEntryModel::data(const QModelIndex& index, int role) const
@@ -145,13 +343,29 @@ QVariant PgnGameEntryModel::data(const QModelIndex& index, int role) const
 
 	if (role == Qt::DisplayRole || role == Qt::EditRole)
 	{
-		PgnGameEntry::TagType tagType = PgnGameEntry::TagType(index.column());
-		return entryAt(index.row())->tagValue(tagType);
+		return tagValues(index.row())->at(index.column());
 	}
 
 	return QVariant();
 }
 
+const QStringList* PgnGameEntryModel::tagValues(int row) const
+{
+	int source = m_rows.at(row);
+	QStringList* values = m_tagCache.object(source);
+	if (values != 0)
+		return values;
+
+	int entryIndex;
+	const PgnDatabase* db = databaseAt(row, &entryIndex);
+	values = new QStringList();
+	for (int i = 0; i < s_columnCount; i++)
+		values->append(db->tagValue(entryIndex, PgnGameEntry::TagType(i)));
+
+	m_tagCache.insert(source, values);
+	return values;
+}
+
 QVariant PgnGameEntryModel::headerData(int section, Qt::Orientation orientation,
 				   int role) const
 {
@@ -185,15 +399,15 @@ bool PgnGameEntryModel::canFetchMore(const QModelIndex& parent) const
 {
 	Q_UNUSED(parent);
 
-	return m_entryCount < m_filtered.resultCount();
+	return m_entryCount < m_rows.size();
 }
 
 void PgnGameEntryModel::fetchMore(const QModelIndex& parent)
 {
 	Q_UNUSED(parent);
 
-	int remainder = m_filtered.resultCount() - m_entryCount;
-	int entriesToFetch = qMin(1024, remainder);
+	int remainder = m_rows.size() - m_entryCount;
+	int entriesToFetch = qMin(s_fetchSize, remainder);
 
 	Q_ASSERT(entriesToFetch >= 0);
 	if (entriesToFetch == 0)
@@ -20,13 +20,28 @@
 
 #include <QAbstractItemModel>
 #include <QList>
+#include <QVector>
+#include <QStringList>
+#include <QCache>
+#include <QAtomicInt>
 #include <QFuture>
 #include <QFutureWatcher>
 #include <pgngamefilter.h>
-class PgnGameEntry;
+class PgnDatabase;
 
 /*!
  * \brief Supplies PGN game entry information to views.
+ *
+ * Filtering and sorting are done on a worker thread, which produces a
+ * vector of source indexes in display order. When the vector is ready
+ * it replaces the model's rows in one reset, and the rows are then
+ * handed to the views in batches through fetchMore(). Until then the
+ * previous rows stay visible.
+ *
+ * A new query cancels the query that's still running.
+ *
+ * The tag values of recently shown entries are kept in a bounded LRU
+ * cache, so that scrolling doesn't decode the same entries again.
  */
 class PgnGameEntryModel : public QAbstractItemModel
 {
@@ -35,9 +50,14 @@ class PgnGameEntryModel : public QAbstractItemModel
 	public:
 		/*! Constructs a PGN game entry model with the given \a parent. */
 		PgnGameEntryModel(QObject* parent = 0);
+		/*! Destroys the model and waits for running queries to stop. */
+		virtual ~PgnGameEntryModel();
 
-		/*! Returns the PGN entry at \a row. */
-		const PgnGameEntry* entryAt(int row) const;
+		/*!
+		 * Returns the database that contains the PGN entry at \a row,
+		 * and stores the entry's index in that database in \a index.
+		 */
+		const PgnDatabase* databaseAt(int row, int* index) const;
 		/*!
 		 * Returns the total number of PGN game entries matching the
 		 * current filter.
@@ -51,8 +71,13 @@ class PgnGameEntryModel : public QAbstractItemModel
 		 * \a row in the model.
 		 */
 		int sourceIndex(int row) const;
-		/*! Associates a list of PGN game entries with this model. */
-		void setEntries(const QList<const PgnGameEntry*>& entries);
+		/*!
+		 * Associates the game entries of \a databases with this model.
+		 *
+		 * The entries of each database follow the entries of the
+		 * previous database in the list.
+		 */
+		void setDatabases(const QList<const PgnDatabase*>& databases);
 
 		// Inherited from QAbstractItemModel
 		virtual QModelIndex index(int row, int column,
@@ -63,6 +88,13 @@ class PgnGameEntryModel : public QAbstractItemModel
 		virtual QVariant data(const QModelIndex& index, int role) const;
 		virtual QVariant headerData(int section, Qt::Orientation orientation,
 					    int role = Qt::DisplayRole) const;
+		/*!
+		 * Sorts the entries by \a column in \a order.
+		 *
+		 * If \a column is -1 the entries are shown in the order
+		 * of the databases.
+		 */
+		virtual void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
 
 	public slots:
 		/*! Sets the filter for filtering the contents of the database. */
@@ -74,17 +106,29 @@ class PgnGameEntryModel : public QAbstractItemModel
 		virtual void fetchMore(const QModelIndex& parent);
 
 	private slots:
-		void onResultsReady();
+		void onQueryFinished();
 
 	private:
-		void applyFilter(const PgnGameFilter& filter);
+		void startQuery();
+		void cancelQueries();
+		const QStringList* tagValues(int row) const;
 
-		QList<const PgnGameEntry*> m_entries;
-		QVector<int> m_indexes;
+		QList<const PgnDatabase*> m_databases;
+		QVector<int> m_offsets;
+		QVector<int> m_rows;
 		int m_entryCount;
-		QFuture<int> m_filtered;
-		QFutureWatcher<int> m_watcher;
 		PgnGameFilter m_filter;
+		int m_sortColumn;
+		Qt::SortOrder m_sortOrder;
+		// Decoded tag values by source index
+		mutable QCache<int, QStringList> m_tagCache;
+
+		// The id of the latest query. Older queries poll it and
+		// stop early when it has changed.
+		QAtomicInt m_queryId;
+		QList< QFuture< QVector<int> > > m_queries;
+		QFutureWatcher< QVector<int> > m_watcher;
+		QFuture< QVector<int> > m_shownQuery;
 };
 
 #endif // PGN_GAME_ENTRY_MODEL_H
@@ -19,13 +19,79 @@
 
 #include <QFile>
 #include <QFileInfo>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+#include <cstring>
 
 #include <pgnstream.h>
 #include <pgngameentry.h>
+#include <pgngame.h>
+#include <board/board.h>
+#include <gzipdevice.h>
 #include "pgndatabase.h"
 
+static const int s_updateInterval = 1024;
+// Files smaller than this are never split
+static const qint64 s_minChunkSize = 16 * 1024 * 1024;
+// The number of plies of each game that are added to the opening tree
+static const int s_openingTreeDepth = 40;
+
+// Returns the position of the first "[Event" tag that starts a line
+// at or after \a pos, or \a size if there is no such tag.
+static qint64 findGameStart(const char* data, qint64 size, qint64 pos)
+{
+	static const char tag[] = "[Event ";
+	static const qint64 tagLength = sizeof(tag) - 1;
+
+	while (pos < size)
+	{
+		const char* nl = (const char*)memchr(data + pos, '\n', size - pos);
+		if (nl == 0)
+			break;
+
+		pos = nl - data + 1;
+		if (size - pos >= tagLength && !memcmp(data + pos, tag, tagLength))
+			return pos;
+	}
+
+	return size;
+}
+
+// FNV-1a hash of \a size bytes of \a data, continued from \a hash
+static quint64 fnv1a(quint64 hash, const char* data, int size)
+{
+	for (int i = 0; i < size; i++)
+	{
+		hash ^= quint8(data[i]);
+		hash *= Q_UINT64_C(0x100000001b3);
+	}
+	return hash;
+}
+
+static qint64 countLines(const char* data, qint64 size)
+{
+	qint64 count = 0;
+	const char* end = data + size;
+
+	while ((data = (const char*)memchr(data, '\n', end - data)) != 0)
+	{
+		count++;
+		data++;
+	}
+
+	return count;
+}
+
 PgnImporter::PgnImporter(const QString& fileName, QObject* parent)
-	: QThread(parent), m_fileName(fileName)
+	: QThread(parent),
+	  m_fileName(fileName),
+	  m_startPos(0),
+	  m_startLineNumber(1),
+	  m_positionIndex(false),
+	  m_openingTree(false),
+	  m_gameHashes(false),
+	  m_numReadGames(0),
+	  m_numReadBytes(0)
 {
 	m_abort = false;
 }
@@ -35,18 +101,332 @@ QString PgnImporter::fileName() const
 	return m_fileName;
 }
 
+void PgnImporter::setStartPosition(qint64 pos, qint64 lineNumber)
+{
+	m_startPos = pos;
+	m_startLineNumber = lineNumber;
+}
+
+void PgnImporter::setPositionIndexEnabled(bool enabled)
+{
+	m_positionIndex = enabled;
+}
+
+void PgnImporter::setOpeningTreeEnabled(bool enabled)
+{
+	m_openingTree = enabled;
+}
+
+void PgnImporter::setGameHashesEnabled(bool enabled)
+{
+	m_gameHashes = enabled;
+}
+
+quint64 PgnImporter::gameHash(PgnStream& stream, const PgnGameEntry& entry)
+{
+	quint64 hash = Q_UINT64_C(0xcbf29ce484222325);
+	if (!stream.seek(entry.pos(), entry.lineNumber())
+	||  !stream.nextGame())
+		return hash;
+
+	// The FEN tag and the move tokens are hashed. Comments,
+	// variations, NAGs and move suffixes like "+" or "!?" don't
+	// make games different.
+	QByteArray fen;
+	QByteArray moves;
+	PgnStream::TokenType type;
+	while ((type = stream.readNext()) != PgnStream::NoToken
+	&&     type != PgnStream::PgnResult)
+	{
+		if (type == PgnStream::PgnTag)
+		{
+			if (stream.tagName() == "FEN")
+				fen = stream.tagValue();
+		}
+		else if (type == PgnStream::PgnMove)
+		{
+			QByteArray move(stream.tokenString());
+			int size = move.size();
+			while (size > 0 && strchr("+#!?", move.at(size - 1)))
+				size--;
+			moves.append(move.constData(), size);
+			moves.append(' ');
+		}
+	}
+
+	hash = fnv1a(hash, fen.constData(), fen.size() + 1);
+	return fnv1a(hash, moves.constData(), moves.size());
+}
+
+void PgnImporter::readGame(PgnStream& stream,
+			   const PgnGameEntry& entry,
+			   quint32 game,
+			   ChunkResult* result) const
+{
+	// Replay the game from its beginning. Afterwards the stream is
+	// at the end of the game, where the next entry is read from.
+	PgnGame pgnGame;
+	if (!stream.seek(entry.pos(), entry.lineNumber())
+	||  !pgnGame.read(stream))
+		return;
+
+	const QVector<PgnGame::MoveData>& moves = pgnGame.moves();
+
+	if (m_positionIndex)
+	{
+		QVector<quint64> keys;
+		keys.reserve(moves.size() + 1);
+		foreach (const PgnGame::MoveData& md, moves)
+			keys.append(md.key);
+		keys.append(stream.board()->key());
+
+		// Repeated positions are stored only once per game
+		qSort(keys);
+		for (int i = 0; i < keys.size(); i++)
+		{
+			if (i > 0 && keys.at(i) == keys.at(i - 1))
+				continue;
+			Position position = { keys.at(i), game };
+			result->positions.append(position);
+		}
+	}
+
+	if (m_openingTree)
+	{
+		Chess::Result gameResult(pgnGame.result());
+		Chess::Side winner(gameResult.winner());
+		int elo[2] =
+		{
+			pgnGame.tagValue("WhiteElo").toInt(),
+			pgnGame.tagValue("BlackElo").toInt()
+		};
+
+		Chess::Side side(pgnGame.startingSide());
+		int plies = qMin(moves.size(), s_openingTreeDepth);
+		for (int i = 0; i < plies && !side.isNull(); i++)
+		{
+			const PgnGame::MoveData& md = moves.at(i);
+			int moverElo = qMax(0, elo[side]);
+			PgnDatabase::OpeningMove move =
+			{
+				md.key,
+				PgnDatabase::OpeningMove::packMove(md.move),
+				1,
+				winner == Chess::Side::White,
+				gameResult.isDraw(),
+				winner == Chess::Side::Black,
+				moverElo > 0,
+				quint64(moverElo)
+			};
+
+			QPair<quint64, quint32> key(move.key, move.move);
+			int index = result->openingMoveIndex.value(key, -1);
+			if (index == -1)
+			{
+				result->openingMoveIndex.insert(key, result->openingMoves.size());
+				result->openingMoves.append(move);
+			}
+			else
+				result->openingMoves[index].add(move);
+
+			side = side.opposite();
+		}
+	}
+}
+
+void PgnImporter::finishChunk(ChunkResult* result)
+{
+	qSort(result->positions);
+	result->openingMoveIndex.clear();
+	qSort(result->openingMoves);
+}
+
+void PgnImporter::setPositionIndex(PgnDatabase* database,
+				   const QList<ChunkResult>& results)
+{
+	// Each result is sorted, so they're merged in one pass. The game
+	// numbers of a chunk follow the games of the previous chunks.
+	QVector<int> next(results.size(), 0);
+	QVector<quint32> base(results.size(), 0);
+	int total = 0;
+	for (int i = 0; i < results.size(); i++)
+	{
+		if (i > 0)
+			base[i] = base[i - 1] + results[i - 1].gameCount;
+		total += results[i].positions.size();
+	}
+
+	QVector<quint64> keys;
+	QVector<quint32> games;
+	keys.reserve(total);
+	games.reserve(total);
+
+	forever
+	{
+		int best = -1;
+		for (int i = 0; i < results.size(); i++)
+		{
+			if (next[i] >= results[i].positions.size())
+				continue;
+			if (best == -1
+			||  results[i].positions.at(next[i]).key
+			    < results[best].positions.at(next[best]).key)
+				best = i;
+		}
+		if (best == -1)
+			break;
+
+		const Position& position = results[best].positions.at(next[best]++);
+		keys.append(position.key);
+		games.append(base[best] + position.game);
+	}
+
+	database->setPositionIndex(keys, games);
+}
+
+void PgnImporter::setOpeningTree(PgnDatabase* database,
+				 const QList<ChunkResult>& results)
+{
+	// The same move may have been played in several chunks, so the
+	// sorted records are combined afterwards.
+	QVector<PgnDatabase::OpeningMove> moves;
+	foreach (const ChunkResult& result, results)
+		moves += result.openingMoves;
+	if (results.size() > 1)
+		qSort(moves);
+
+	int count = 0;
+	for (int i = 0; i < moves.size(); i++)
+	{
+		if (count > 0
+		&&  moves.at(count - 1).key == moves.at(i).key
+		&&  moves.at(count - 1).move == moves.at(i).move)
+			moves[count - 1].add(moves.at(i));
+		else
+			moves[count++] = moves.at(i);
+	}
+	moves.resize(count);
+
+	database->setOpeningTree(moves);
+}
+
 void PgnImporter::abort()
 {
 	m_abort = true;
 }
 
+QList<PgnImporter::Chunk> PgnImporter::splitFile(QFile* file,
+						 qint64* lineNumber) const
+{
+	QList<Chunk> chunks;
+	qint64 size = file->size();
+	int chunkCount = qMin(qint64(QThreadPool::globalInstance()->maxThreadCount()),
+			      size / s_minChunkSize);
+	if (chunkCount <= 1 || GzipDevice::isCompressed(file))
+		return chunks;
+
+	uchar* map = file->map(0, size);
+	if (map == 0)
+		return chunks;
+	const char* data = (const char*)map;
+
+	qint64 start = 0;
+	for (int i = 1; i <= chunkCount && start < size; i++)
+	{
+		qint64 end = size;
+		if (i < chunkCount)
+			end = findGameStart(data, size, qMax(start, size / chunkCount * i));
+
+		Chunk chunk = { start, end, 1 };
+		chunks << chunk;
+		start = end;
+	}
+
+	// Line counting is much cheaper than parsing, so it's done
+	// here to give each chunk its correct starting line number.
+	QList< QFuture<qint64> > lineCounts;
+	for (int i = 0; i < chunks.size(); i++)
+		lineCounts << QtConcurrent::run(countLines,
+						data + chunks[i].start,
+						chunks[i].end - chunks[i].start);
+	for (int i = 1; i < chunks.size(); i++)
+		chunks[i].lineNumber = chunks[i - 1].lineNumber
+				     + lineCounts[i - 1].result();
+	*lineNumber = chunks.last().lineNumber + lineCounts.last().result();
+
+	file->unmap(map);
+	return chunks;
+}
+
+PgnImporter::ChunkResult PgnImporter::readChunk(const Chunk& chunk)
+{
+	ChunkResult result;
+	result.gameCount = 0;
+	QList<const PgnGameEntry*>& games = result.games;
+
+	QFile file(m_fileName);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		return result;
+
+	PgnStream pgnStream(&file);
+	pgnStream.setMappingEnabled(true);
+	if (!pgnStream.seek(chunk.start, chunk.lineNumber))
+		return result;
+
+	int numReadGames = 0;
+	qint64 lastPos = chunk.start;
+
+	forever
+	{
+		PgnGameEntry* game = new PgnGameEntry;
+		if (m_abort || !game->read(pgnStream) || game->pos() >= chunk.end)
+		{
+			delete game;
+			break;
+		}
+
+		if (m_gameHashes)
+			result.gameHashes.append(gameHash(pgnStream, *game));
+		if (m_positionIndex || m_openingTree)
+			readGame(pgnStream, *game, games.size(), &result);
+		games << game;
+		numReadGames++;
+
+		if (numReadGames % s_updateInterval == 0)
+		{
+			qint64 pos = qMin(pgnStream.pos(), chunk.end);
+			addProgress(numReadGames, pos - lastPos);
+			numReadGames = 0;
+			lastPos = pos;
+		}
+	}
+	addProgress(numReadGames, chunk.end - lastPos);
+
+	result.gameCount = games.size();
+	finishChunk(&result);
+	return result;
+}
+
+void PgnImporter::addProgress(int numReadGames, qint64 numReadBytes)
+{
+	QMutexLocker locker(&m_progressMutex);
+
+	int prevUpdate = m_numReadGames / s_updateInterval;
+	m_numReadGames += numReadGames;
+	m_numReadBytes += numReadBytes;
+
+	if (m_numReadGames / s_updateInterval != prevUpdate)
+		emit databaseReadStatus(m_startTime, m_numReadGames,
+		    m_numReadBytes);
+}
+
 void PgnImporter::run()
 {
 	QFile file(m_fileName);
 	QFileInfo fileInfo(m_fileName);
-	const QTime startTime = QTime::currentTime();
-	static const int updateInterval = 1024;
-	int numReadGames = 0;
+	m_startTime = QTime::currentTime();
+	m_numReadGames = 0;
+	m_numReadBytes = 0;
 
 	if (!fileInfo.exists())
 	{
@@ -60,27 +440,91 @@ void PgnImporter::run()
 		return;
 	}
 
-	PgnStream pgnStream(&file);
-	QList<const PgnGameEntry*> games;
+	PgnDatabase* db = new PgnDatabase(m_fileName);
+	QList<Chunk> chunks;
+	qint64 lineNumber = 1;
+	if (m_startPos == 0)
+		chunks = splitFile(&file, &lineNumber);
 
-	forever
+	if (!chunks.isEmpty())
 	{
-		PgnGameEntry* game = new PgnGameEntry;
-		if (m_abort || !game->read(pgnStream))
+		file.close();
+
+		QList< QFuture<ChunkResult> > futures;
+		foreach (const Chunk& chunk, chunks)
+			futures << QtConcurrent::run(this, &PgnImporter::readChunk,
+						     chunk);
+
+		QList<ChunkResult> results;
+		for (int i = 0; i < futures.size(); i++)
 		{
-			delete game;
-			break;
+			results << futures[i].result();
+			const QList<const PgnGameEntry*>& games = results.last().games;
+			db->reserve(db->entryCount() + games.size());
+			foreach (const PgnGameEntry* game, games)
+			{
+				db->addEntry(*game);
+				delete game;
+			}
+			results.last().games.clear();
 		}
 
-		games << game;
-		numReadGames++;
+		if (m_positionIndex)
+			setPositionIndex(db, results);
+		if (m_openingTree)
+			setOpeningTree(db, results);
+		if (m_gameHashes)
+		{
+			QVector<quint64> hashes;
+			hashes.reserve(db->entryCount());
+			foreach (const ChunkResult& result, results)
+				hashes += result.gameHashes;
+			db->setGameHashes(hashes);
+		}
 
-		if (numReadGames % updateInterval == 0)
-			emit databaseReadStatus(startTime, numReadGames,
-			    pgnStream.pos());
+		// An aborted import can't be resumed from the end of a chunk
+		if (!m_abort)
+			db->setImported(chunks.last().end, lineNumber);
 	}
-	PgnDatabase* db = new PgnDatabase(m_fileName);
-	db->setEntries(games);
+	else
+	{
+		PgnStream pgnStream(&file);
+		pgnStream.setMappingEnabled(true);
+		PgnGameEntry game;
+		int numReadGames = 0;
+		ChunkResult result;
+
+		if (m_startPos == 0
+		||  pgnStream.seek(m_startPos, m_startLineNumber))
+		{
+			while (!m_abort && game.read(pgnStream))
+			{
+				if (m_gameHashes)
+					result.gameHashes.append(gameHash(pgnStream, game));
+				if (m_positionIndex || m_openingTree)
+					readGame(pgnStream, game, numReadGames, &result);
+				db->addEntry(game);
+				numReadGames++;
+
+				if (numReadGames % s_updateInterval == 0)
+					emit databaseReadStatus(m_startTime, numReadGames,
+					    pgnStream.pos() - m_startPos);
+			}
+			db->setImported(pgnStream.pos(), pgnStream.lineNumber());
+		}
+		else
+			db->setImported(m_startPos, m_startLineNumber);
+
+		result.gameCount = numReadGames;
+		finishChunk(&result);
+		if (m_positionIndex)
+			setPositionIndex(db, QList<ChunkResult>() << result);
+		if (m_openingTree)
+			setOpeningTree(db, QList<ChunkResult>() << result);
+		if (m_gameHashes)
+			db->setGameHashes(result.gameHashes);
+	}
+
 	db->setLastModified(fileInfo.lastModified());
 
 	emit databaseRead(db);
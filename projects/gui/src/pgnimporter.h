@@ -21,12 +21,24 @@
 #include <QThread>
 #include <QString>
 #include <QTime>
+#include <QList>
+#include <QMutex>
+#include <QVector>
+#include <QHash>
+#include <QPair>
+#include "pgndatabase.h"
 
-class PgnDatabase;
+class QFile;
+class PgnGameEntry;
+class PgnStream;
 
 /*!
  * \brief Reads PGN database in a separate thread.
  *
+ * Large uncompressed databases are split into chunks at game
+ * boundaries, and the chunks are parsed in parallel on the global
+ * thread pool. The entries are merged back in file order.
+ *
  * \sa PgnDatabase
  */
 class PgnImporter : public QThread
@@ -48,6 +60,47 @@ class PgnImporter : public QThread
 		PgnImporter(const QString& fileName, QObject* parent = 0);
 		/*! Returns the file name of the database to be imported. */
 		QString fileName() const;
+		/*!
+		 * Starts the import from position \a pos of the file,
+		 * which is at line \a lineNumber.
+		 *
+		 * This is used for importing only the games that were
+		 * appended to a database since its last import.
+		 */
+		void setStartPosition(qint64 pos, qint64 lineNumber);
+		/*!
+		 * Enables or disables building a position index.
+		 *
+		 * If \a enabled is true, every game is replayed and the
+		 * Zobrist keys of its positions are stored in the database's
+		 * position index. This makes the import considerably slower.
+		 * The default is false.
+		 *
+		 * \sa PgnDatabase::findPosition()
+		 */
+		void setPositionIndexEnabled(bool enabled);
+		/*!
+		 * Enables or disables building an opening tree.
+		 *
+		 * If \a enabled is true, every game is replayed and the
+		 * statistics of its opening moves are stored in the
+		 * database's opening tree. The default is false.
+		 *
+		 * \sa PgnDatabase::openingMoves()
+		 */
+		void setOpeningTreeEnabled(bool enabled);
+		/*!
+		 * Enables or disables computing game hashes.
+		 *
+		 * If \a enabled is true, the starting position and the
+		 * moves of every game are hashed into the database's game
+		 * hashes, which are used to find duplicate games. The moves
+		 * are hashed as text, without replaying the game. The
+		 * default is false.
+		 *
+		 * \sa PgnDatabase::gameHash()
+		 */
+		void setGameHashesEnabled(bool enabled);
 
 		// Inherited from QThread
 		virtual void run();
@@ -74,8 +127,61 @@ class PgnImporter : public QThread
 		void error(int error);
 
 	private:
+		struct Chunk
+		{
+			qint64 start;
+			qint64 end;
+			qint64 lineNumber;
+		};
+
+		struct Position
+		{
+			quint64 key;
+			quint32 game;
+
+			bool operator<(const Position& other) const
+			{
+				if (key != other.key)
+					return key < other.key;
+				return game < other.game;
+			}
+		};
+		struct ChunkResult
+		{
+			QList<const PgnGameEntry*> games;
+			int gameCount;
+			QVector<Position> positions;
+			QVector<PgnDatabase::OpeningMove> openingMoves;
+			QHash<QPair<quint64, quint32>, int> openingMoveIndex;
+			QVector<quint64> gameHashes;
+		};
+
+		void readGame(PgnStream& stream,
+			      const PgnGameEntry& entry,
+			      quint32 game,
+			      ChunkResult* result) const;
+		static quint64 gameHash(PgnStream& stream,
+					const PgnGameEntry& entry);
+		static void finishChunk(ChunkResult* result);
+		static void setPositionIndex(PgnDatabase* database,
+					     const QList<ChunkResult>& results);
+		static void setOpeningTree(PgnDatabase* database,
+					   const QList<ChunkResult>& results);
+		QList<Chunk> splitFile(QFile* file, qint64* lineNumber) const;
+		ChunkResult readChunk(const Chunk& chunk);
+		void addProgress(int numReadGames, qint64 numReadBytes);
+
 		QString m_fileName;
 		bool m_abort;
+		qint64 m_startPos;
+		qint64 m_startLineNumber;
+		bool m_positionIndex;
+		bool m_openingTree;
+		bool m_gameHashes;
+		QTime m_startTime;
+		int m_numReadGames;
+		qint64 m_numReadBytes;
+		QMutex m_progressMutex;
 
 };
 
@@ -15,34 +15,208 @@
     along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+
 #include "plaintextlog.h"
 #include <QContextMenuEvent>
 #include <QMenu>
+#include <QComboBox>
+#include <QTreeView>
+#include <QHeaderView>
+#include <QVBoxLayout>
+#include <QApplication>
+#include <QClipboard>
+#include <QThread>
+#include <QTemporaryFile>
+#include <QTextStream>
+#include <QDir>
+#include <chessplayer.h>
+#include "logmodel.h"
+#include "autoverticalscroller.h"
+
+// Maximum number of messages kept in memory
+static const int s_capacity = 10000;
+// Number of characters copied at a time when the log is saved
+static const int s_chunkSize = 0x10000;
+
+/*!
+ * \brief Writes log messages to a temporary file.
+ *
+ * The writer lives in its own thread, so the GUI doesn't have to wait
+ * for the disk.
+ */
+class LogWriter : public QObject
+{
+	Q_OBJECT
+
+	public:
+		LogWriter()
+			: m_file(QDir::tempPath() + "/cutechess-log-XXXXXX.txt", this)
+		{
+			if (m_file.open())
+				m_fileName = m_file.fileName();
+		}
+
+		// The file name doesn't change after construction, so
+		// this is safe to call from any thread.
+		QString fileName() const
+		{
+			return m_fileName;
+		}
+
+	public slots:
+		void write(const QStringList& messages)
+		{
+			if (!m_file.isOpen())
+				return;
+
+			QTextStream out(&m_file);
+			foreach (const QString& message, messages)
+				out << message << '\n';
+		}
+
+		void clear()
+		{
+			if (!m_file.isOpen())
+				return;
+
+			m_file.resize(0);
+			m_file.seek(0);
+		}
+
+		bool flush()
+		{
+			return m_file.isOpen() && m_file.flush();
+		}
+
+	private:
+		QTemporaryFile m_file;
+		QString m_fileName;
+};
 
 
 PlainTextLog::PlainTextLog(QWidget* parent)
-	: QPlainTextEdit(parent)
+	: QWidget(parent),
+	  m_model(new LogModel(s_capacity, this)),
+	  m_filterCombo(new QComboBox(this)),
+	  m_view(new QTreeView(this)),
+	  m_writerThread(new QThread(this)),
+	  m_writer(new LogWriter())
+{
+	m_filterCombo->addItem(tr("All players"));
+	m_filterCombo->setSizeAdjustPolicy(QComboBox::AdjustToContents);
+	connect(m_model, SIGNAL(sourceAdded(QString)),
+		this, SLOT(onSourceAdded(QString)));
+	connect(m_filterCombo, SIGNAL(currentIndexChanged(int)),
+		this, SLOT(onFilterChanged(int)));
+
+	// Only the visible rows are laid out
+	m_view->setModel(m_model);
+	m_view->setHeaderHidden(true);
+	m_view->setRootIsDecorated(false);
+	m_view->setUniformRowHeights(true);
+	m_view->setSelectionMode(QAbstractItemView::ExtendedSelection);
+	m_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+	m_view->setContextMenuPolicy(Qt::NoContextMenu);
+	new AutoVerticalScroller(m_view, this);
+
+	m_writer->moveToThread(m_writerThread);
+	connect(m_model, SIGNAL(messagesAdded(QStringList)),
+		m_writer, SLOT(write(QStringList)));
+	m_writerThread->start();
+
+	QVBoxLayout* layout = new QVBoxLayout();
+	layout->setContentsMargins(0, 0, 0, 0);
+	layout->addWidget(m_filterCombo, 0, Qt::AlignLeft);
+	layout->addWidget(m_view);
+	setLayout(layout);
+}
+
+PlainTextLog::~PlainTextLog()
 {
-	setReadOnly(true);
+	m_writerThread->quit();
+	m_writerThread->wait();
+	delete m_writer;
 }
 
-PlainTextLog::PlainTextLog(const QString& text, QWidget* parent)
-	: QPlainTextEdit(text, parent)
+void PlainTextLog::save(QTextStream& out)
 {
-	setReadOnly(true);
+	// Every write request is queued before the flush, so the file
+	// is complete when the flush returns.
+	m_model->flush();
+	bool ok = false;
+	QMetaObject::invokeMethod(m_writer, "flush",
+				  Qt::BlockingQueuedConnection,
+				  Q_RETURN_ARG(bool, ok));
+
+	QFile file(m_writer->fileName());
+	if (!ok || !file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		foreach (const QString& message, m_model->messages())
+			out << message << '\n';
+		return;
+	}
+
+	QTextStream in(&file);
+	while (!in.atEnd())
+		out << in.read(s_chunkSize);
+}
+
+void PlainTextLog::appendPlainText(const QString& text)
+{
+	const ChessPlayer* player = qobject_cast<const ChessPlayer*>(sender());
+	m_model->append(player != 0 ? player->name() : QString(), text);
+}
+
+void PlainTextLog::clear()
+{
+	m_model->clear();
+	m_filterCombo->blockSignals(true);
+	while (m_filterCombo->count() > 1)
+		m_filterCombo->removeItem(1);
+	m_filterCombo->setCurrentIndex(0);
+	m_filterCombo->blockSignals(false);
+	m_model->setSourceFilter(QString());
+
+	QMetaObject::invokeMethod(m_writer, "clear", Qt::QueuedConnection);
 }
 
 void PlainTextLog::contextMenuEvent(QContextMenuEvent* event)
 {
-	QMenu* menu = createStandardContextMenu();
+	QMenu menu;
+
+	QAction* copyAction = menu.addAction(tr("Copy"), this, SLOT(copy()));
+	copyAction->setEnabled(m_view->selectionModel()->hasSelection());
+
+	menu.addSeparator();
+	menu.addAction(tr("Clear Log"), this, SLOT(clear()));
+
+	menu.addSeparator();
+	menu.addAction(tr("Save Log to File..."), this, SIGNAL(saveLogToFileRequest()));
 
-	menu->addSeparator();
-	menu->addAction(tr("Clear Log"), this, SLOT(clear()));
+	menu.exec(event->globalPos());
+}
+
+void PlainTextLog::onSourceAdded(const QString& source)
+{
+	if (!source.isEmpty())
+		m_filterCombo->addItem(source, source);
+}
+
+void PlainTextLog::onFilterChanged(int index)
+{
+	m_model->setSourceFilter(m_filterCombo->itemData(index).toString());
+}
+
+void PlainTextLog::copy()
+{
+	QModelIndexList indexes(m_view->selectionModel()->selectedRows());
+	qSort(indexes);
 
-	menu->addSeparator();
-	menu->addAction(tr("Save Log to File..."), this, SIGNAL(saveLogToFileRequest()));
+	QStringList lines;
+	foreach (const QModelIndex& index, indexes)
+		lines.append(index.data().toString());
 
-	menu->exec(event->globalPos());
-	delete menu;
+	QApplication::clipboard()->setText(lines.join("\n"));
 }
 
+#include "plaintextlog.moc"
@@ -15,29 +15,56 @@
     along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+
 #ifndef PLAIN_TEXT_LOG_H
 #define PLAIN_TEXT_LOG_H
 
-#include <QPlainTextEdit>
+#include <QWidget>
 
 class QContextMenuEvent;
-class QAction;
+class QTextStream;
+class QComboBox;
+class QTreeView;
+class QThread;
+class LogModel;
+class LogWriter;
 
 /*!
  * \brief Widget that is used to display log messages in plain text.
+ *
+ * Only the newest messages are kept in memory, and only the visible
+ * lines are laid out, so a busy log doesn't slow down the GUI. The
+ * complete log is written to a temporary file in a background thread,
+ * and it's available for saving with save().
+ *
+ * When the messages come from chess players, the log can be filtered
+ * to show only one player's messages.
+ *
+ * \sa LogModel
  */
-class PlainTextLog : public QPlainTextEdit
+class PlainTextLog : public QWidget
 {
 	Q_OBJECT
 
 	public:
 		/*! Constructs a new plain text log with the given \a parent. */
 		PlainTextLog(QWidget* parent = 0);
+		/*! Destroys the log and its temporary file. */
+		virtual ~PlainTextLog();
+
+		/*! Writes the complete log to \a out. */
+		void save(QTextStream& out);
+
+	public slots:
 		/*!
-		 * Constructs a new plain text log with the initial text \a text and
-		 * given \a parent.
+		 * Appends \a text to the log.
+		 *
+		 * If the sender is a chess player, the player's name is
+		 * used as the source of the message.
 		 */
-		PlainTextLog(const QString& text, QWidget* parent = 0);
+		void appendPlainText(const QString& text);
+		/*! Removes every message from the log. */
+		void clear();
 
 	signals:
 		/*!
@@ -47,10 +74,20 @@ class PlainTextLog : public QPlainTextEdit
 		void saveLogToFileRequest();
 
 	protected:
-		// Inherited from QPlainTextEdit
+		// Inherited from QWidget
 		virtual void contextMenuEvent(QContextMenuEvent* event);
 
+	private slots:
+		void onSourceAdded(const QString& source);
+		void onFilterChanged(int index);
+		void copy();
+
+	private:
+		LogModel* m_model;
+		QComboBox* m_filterCombo;
+		QTreeView* m_view;
+		QThread* m_writerThread;
+		LogWriter* m_writer;
 };
 
 #endif // PLAIN_TEXT_LOG_H
-
@@ -0,0 +1,224 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "pvconverter.h"
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QStringList>
+#include <QThread>
+#include <board/board.h>
+#include <board/boardfactory.h>
+
+// The maximum number of cached moves before the cache is cleared
+static const int s_maxCacheSize = 20000;
+
+/*!
+ * \brief The requests shared by PvConverter and its worker.
+ *
+ * The root position is stored here instead of being sent to the worker
+ * with a queued call, so that the worker always uses the newest one.
+ */
+struct PvQueue
+{
+	QMutex mutex;
+	int generation;
+	QString variant;
+	QString startingFen;
+	QVector<Chess::GenericMove> moves;
+	QMap<int, QString> pending;
+	bool scheduled;
+};
+
+/*!
+ * \brief Converts the queued PVs in the conversion thread.
+ */
+class PvConverterWorker : public QObject
+{
+	Q_OBJECT
+
+	public:
+		explicit PvConverterWorker(PvQueue* queue)
+			: m_queue(queue),
+			  m_generation(-1),
+			  m_board(0)
+		{
+		}
+
+		virtual ~PvConverterWorker()
+		{
+			delete m_board;
+		}
+
+	public slots:
+		void process()
+		{
+			QMutexLocker locker(&m_queue->mutex);
+			m_queue->scheduled = false;
+			if (m_queue->generation != m_generation)
+				setRoot();
+			QMap<int, QString> pending(m_queue->pending);
+			m_queue->pending.clear();
+			int generation = m_generation;
+			locker.unlock();
+
+			QMap<int, QString>::const_iterator it;
+			for (it = pending.constBegin(); it != pending.constEnd(); ++it)
+				emit converted(generation, it.key(), convert(it.value()));
+		}
+
+	signals:
+		void converted(int generation, int id, const QString& san);
+
+	private:
+		struct CacheEntry
+		{
+			Chess::Move move;
+			QString san;
+		};
+
+		// Called with the queue locked
+		void setRoot()
+		{
+			m_generation = m_queue->generation;
+			m_cache.clear();
+			delete m_board;
+			m_board = 0;
+			if (m_queue->startingFen.isEmpty())
+				return;
+
+			m_board = Chess::BoardFactory::create(m_queue->variant);
+			if (m_board == 0 || !m_board->setFenString(m_queue->startingFen))
+			{
+				delete m_board;
+				m_board = 0;
+				return;
+			}
+			foreach (const Chess::GenericMove& genericMove, m_queue->moves)
+			{
+				Chess::Move move(m_board->moveFromGenericMove(genericMove));
+				if (move.isNull())
+					break;
+				m_board->makeMove(move);
+			}
+		}
+
+		QString convert(const QString& pv)
+		{
+			if (m_board == 0)
+				return pv;
+
+			// Convert the moves to SAN until a move can't be parsed,
+			// and keep the rest of the line as it is. The cache key
+			// is the line up to and including the move.
+			QStringList tokens(pv.split(' ', QString::SkipEmptyParts));
+			QString prefix;
+			int plies = 0;
+			for (; plies < tokens.size(); plies++)
+			{
+				prefix += tokens.at(plies);
+				prefix += ' ';
+
+				QHash<QString, CacheEntry>::const_iterator it =
+					m_cache.constFind(prefix);
+				if (it == m_cache.constEnd())
+				{
+					CacheEntry entry;
+					entry.move = m_board->moveFromString(tokens.at(plies));
+					if (entry.move.isNull())
+						break;
+					entry.san = m_board->moveString(entry.move,
+						Chess::Board::StandardAlgebraic);
+
+					if (m_cache.size() >= s_maxCacheSize)
+						m_cache.clear();
+					it = m_cache.insert(prefix, entry);
+				}
+
+				tokens[plies] = it->san;
+				m_board->makeMove(it->move);
+			}
+			for (int i = 0; i < plies; i++)
+				m_board->undoMove();
+
+			return tokens.join(" ");
+		}
+
+		PvQueue* m_queue;
+		int m_generation;
+		Chess::Board* m_board;
+		QHash<QString, CacheEntry> m_cache;
+};
+
+
+PvConverter::PvConverter(QObject* parent)
+	: QObject(parent),
+	  m_queue(new PvQueue),
+	  m_generation(0),
+	  m_thread(new QThread(this)),
+	  m_worker(new PvConverterWorker(m_queue))
+{
+	m_queue->generation = 0;
+	m_queue->scheduled = false;
+
+	m_worker->moveToThread(m_thread);
+	connect(m_worker, SIGNAL(converted(int, int, QString)),
+		this, SLOT(onConverted(int, int, QString)));
+	m_thread->start();
+}
+
+PvConverter::~PvConverter()
+{
+	m_thread->quit();
+	m_thread->wait();
+	delete m_worker;
+	delete m_queue;
+}
+
+void PvConverter::setPosition(const QString& variant,
+			      const QString& startingFen,
+			      const QVector<Chess::GenericMove>& moves)
+{
+	QMutexLocker locker(&m_queue->mutex);
+	m_generation++;
+	m_queue->generation = m_generation;
+	m_queue->variant = variant;
+	m_queue->startingFen = startingFen;
+	m_queue->moves = moves;
+	m_queue->pending.clear();
+}
+
+void PvConverter::convert(int id, const QString& pv)
+{
+	QMutexLocker locker(&m_queue->mutex);
+	m_queue->pending[id] = pv;
+	if (m_queue->scheduled)
+		return;
+
+	m_queue->scheduled = true;
+	QMetaObject::invokeMethod(m_worker, "process", Qt::QueuedConnection);
+}
+
+void PvConverter::onConverted(int generation, int id, const QString& san)
+{
+	// Results for an old position arrive after setPosition()
+	if (generation == m_generation)
+		emit converted(id, san);
+}
+
+#include "pvconverter.moc"
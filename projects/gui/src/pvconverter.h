@@ -0,0 +1,92 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PVCONVERTER_H
+#define PVCONVERTER_H
+
+#include <QObject>
+#include <QVector>
+#include <board/genericmove.h>
+class QThread;
+class PvConverterWorker;
+struct PvQueue;
+
+/*!
+ * \brief Converts engines' principal variations to SAN in the background.
+ *
+ * Converting a PV from the engine's notation to SAN means replaying it
+ * on a board and generating the legal moves of every position on the
+ * line. With several engines reporting dozens of PVs per second that
+ * adds up, so the conversion runs in a thread of its own.
+ *
+ * Successive PVs usually share a long prefix, so the converted moves
+ * are cached by the move prefix that leads to them from the root
+ * position. Only the new tail of each PV has to be converted. The
+ * cache is cleared when the root position changes.
+ *
+ * Each line (eg. each analyzing engine) has an id. If a line gets a
+ * new PV before the previous one was converted, only the newest one
+ * is converted.
+ */
+class PvConverter : public QObject
+{
+	Q_OBJECT
+
+	public:
+		/*! Creates a new converter with the given \a parent. */
+		explicit PvConverter(QObject* parent = 0);
+		/*! Stops the conversion thread and destroys the converter. */
+		virtual ~PvConverter();
+
+		/*!
+		 * Sets the root position of the PVs to the position reached
+		 * by playing \a moves from \a startingFen in \a variant.
+		 *
+		 * PVs that are still waiting for conversion are dropped,
+		 * and no more results for the old position are reported.
+		 * If the position isn't valid, the PVs are reported as
+		 * they are.
+		 */
+		void setPosition(const QString& variant,
+				 const QString& startingFen,
+				 const QVector<Chess::GenericMove>& moves);
+		/*!
+		 * Requests the conversion of \a pv, the newest PV of line
+		 * \a id. The result is reported with converted().
+		 */
+		void convert(int id, const QString& pv);
+
+	signals:
+		/*!
+		 * Emitted when the newest PV of line \a id has been converted
+		 * to \a san. Moves that couldn't be converted are left as
+		 * they were.
+		 */
+		void converted(int id, const QString& san);
+
+	private slots:
+		void onConverted(int generation, int id, const QString& san);
+
+	private:
+		PvQueue* m_queue;
+		int m_generation;
+		QThread* m_thread;
+		PvConverterWorker* m_worker;
+};
+
+#endif // PVCONVERTER_H
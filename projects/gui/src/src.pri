@@ -1,17 +1,20 @@
 include(boardview/boardview.pri)
 DEPENDPATH += $$PWD
-HEADERS += $$PWD/chessclock.h \
+HEADERS += $$PWD/analysispanel.h \
+    $$PWD/chessclock.h \
     $$PWD/engineconfigurationmodel.h \
     $$PWD/engineconfigurationdlg.h \
     $$PWD/enginemanagementdlg.h \
     $$PWD/mainwindow.h \
     $$PWD/plaintextlog.h \
+    $$PWD/logmodel.h \
     $$PWD/newgamedlg.h \
     $$PWD/cutechessapp.h \
     $$PWD/autoverticalscroller.h \
     $$PWD/gamedatabasedlg.h \
     $$PWD/pgnimporter.h \
     $$PWD/gamedatabasemanager.h \
+    $$PWD/gamedatabasestatereader.h \
     $$PWD/importprogressdlg.h \
     $$PWD/pgndatabase.h \
     $$PWD/pgngameentrymodel.h \
@@ -22,28 +25,38 @@ HEADERS += $$PWD/chessclock.h \
     $$PWD/timecontroldlg.h \
     $$PWD/engineconfigproxymodel.h \
     $$PWD/gamewall.h \
+    $$PWD/gamethumbnail.h \
     $$PWD/tilelayout.h \
     $$PWD/movelist.h \
+    $$PWD/movelistmodel.h \
     $$PWD/pgntagsmodel.h \
     $$PWD/newtournamentdialog.h \
     $$PWD/engineselectiondlg.h \
     $$PWD/gameviewer.h \
+    $$PWD/gameannotationdlg.h \
     $$PWD/pathlineedit.h \
     $$PWD/threadedtask.h \
-    $$PWD/stringvalidator.h
+    $$PWD/evalgraph.h \
+    $$PWD/gamehashset.h \
+    $$PWD/stringvalidator.h \
+    $$PWD/pvconverter.h \
+    $$PWD/tournamentstandingsmodel.h
 SOURCES += $$PWD/main.cpp \
+    $$PWD/analysispanel.cpp \
     $$PWD/chessclock.cpp \
     $$PWD/engineconfigurationmodel.cpp \
     $$PWD/engineconfigurationdlg.cpp \
     $$PWD/enginemanagementdlg.cpp \
     $$PWD/mainwindow.cpp \
     $$PWD/plaintextlog.cpp \
+    $$PWD/logmodel.cpp \
     $$PWD/newgamedlg.cpp \
     $$PWD/cutechessapp.cpp \
     $$PWD/autoverticalscroller.cpp \
     $$PWD/gamedatabasedlg.cpp \
     $$PWD/pgnimporter.cpp \
     $$PWD/gamedatabasemanager.cpp \
+    $$PWD/gamedatabasestatereader.cpp \
     $$PWD/importprogressdlg.cpp \
     $$PWD/pgndatabase.cpp \
     $$PWD/pgngameentrymodel.cpp \
@@ -54,12 +67,19 @@ SOURCES += $$PWD/main.cpp \
     $$PWD/timecontroldlg.cpp \
     $$PWD/engineconfigproxymodel.cpp \
     $$PWD/gamewall.cpp \
+    $$PWD/gamethumbnail.cpp \
     $$PWD/tilelayout.cpp \
     $$PWD/movelist.cpp \
+    $$PWD/movelistmodel.cpp \
     $$PWD/pgntagsmodel.cpp \
     $$PWD/newtournamentdialog.cpp \
     $$PWD/engineselectiondlg.cpp \
     $$PWD/gameviewer.cpp \
+    $$PWD/gameannotationdlg.cpp \
     $$PWD/pathlineedit.cpp \
     $$PWD/threadedtask.cpp \
-    $$PWD/stringvalidator.cpp
+    $$PWD/evalgraph.cpp \
+    $$PWD/gamehashset.cpp \
+    $$PWD/stringvalidator.cpp \
+    $$PWD/pvconverter.cpp \
+    $$PWD/tournamentstandingsmodel.cpp
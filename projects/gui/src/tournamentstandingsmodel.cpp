@@ -0,0 +1,271 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "tournamentstandingsmodel.h"
+#include <QTimer>
+#include <tournament.h>
+#include <playerbuilder.h>
+#include <ratingsolver.h>
+
+TournamentStandingsModel::TournamentStandingsModel(QObject* parent)
+	: QAbstractItemModel(parent),
+	  m_ratingTimer(new QTimer(this))
+{
+	m_ratingTimer->setSingleShot(true);
+	m_ratingTimer->setInterval(500);
+	connect(m_ratingTimer, SIGNAL(timeout()),
+		this, SLOT(updateRatings()));
+}
+
+void TournamentStandingsModel::setTournament(Tournament* tournament)
+{
+	if (m_tournament)
+		m_tournament->disconnect(this);
+	m_ratingTimer->stop();
+
+	beginResetModel();
+	m_tournament = tournament;
+	m_rows.clear();
+	if (tournament != 0)
+	{
+		m_rows.resize(tournament->playerCount());
+		for (int i = 0; i < m_rows.size(); i++)
+		{
+			Row& row = m_rows[i];
+			row.name = tournament->playerAt(i).builder->name();
+			row.wins = 0;
+			row.draws = 0;
+			row.losses = 0;
+			row.elo = 0;
+			row.error = 0;
+			row.rated = false;
+		}
+	}
+	endResetModel();
+
+	if (tournament == 0)
+		return;
+
+	connect(tournament, SIGNAL(gameFinished(ChessGame*, int, int, int)),
+		this, SLOT(onGameFinished(ChessGame*, int, int, int)));
+	connect(tournament, SIGNAL(finished()),
+		this, SLOT(onTournamentFinished()));
+
+	// A resumed tournament may already have results
+	for (int i = 0; i < m_rows.size(); i++)
+		updateRow(i);
+	scheduleRatingUpdate();
+}
+
+QModelIndex TournamentStandingsModel::index(int row, int column,
+					    const QModelIndex& parent) const
+{
+	if (!hasIndex(row, column, parent))
+		return QModelIndex();
+
+	return createIndex(row, column);
+}
+
+QModelIndex TournamentStandingsModel::parent(const QModelIndex& index) const
+{
+	Q_UNUSED(index);
+
+	return QModelIndex();
+}
+
+int TournamentStandingsModel::rowCount(const QModelIndex& parent) const
+{
+	if (parent.isValid())
+		return 0;
+
+	return m_rows.size();
+}
+
+int TournamentStandingsModel::columnCount(const QModelIndex& parent) const
+{
+	if (parent.isValid())
+		return 0;
+
+	return ColumnCount;
+}
+
+QVariant TournamentStandingsModel::data(const QModelIndex& index, int role) const
+{
+	if (!index.isValid())
+		return QVariant();
+
+	const Row& row = m_rows.at(index.row());
+	int games = row.wins + row.draws + row.losses;
+
+	if (role == Qt::TextAlignmentRole)
+	{
+		if (index.column() == NameColumn)
+			return QVariant(Qt::AlignLeft | Qt::AlignVCenter);
+		return QVariant(Qt::AlignRight | Qt::AlignVCenter);
+	}
+	if (role != Qt::DisplayRole)
+		return QVariant();
+
+	switch (index.column())
+	{
+	case NameColumn:
+		return row.name;
+	case GamesColumn:
+		return games;
+	case ScoreColumn:
+		return row.wins + row.draws * 0.5;
+	case PercentColumn:
+		if (games == 0)
+			return QVariant();
+		// A number rather than a string so that views sort it right
+		return qRound((row.wins * 2 + row.draws) * 500.0 / games) / 10.0;
+	case WinsColumn:
+		return row.wins;
+	case DrawsColumn:
+		return row.draws;
+	case LossesColumn:
+		return row.losses;
+	case EloColumn:
+		if (!row.rated)
+			return QVariant();
+		return row.elo;
+	case ErrorColumn:
+		if (!row.rated || row.error == 0)
+			return QVariant();
+		return row.error;
+	default:
+		return QVariant();
+	}
+}
+
+QVariant TournamentStandingsModel::headerData(int section,
+					      Qt::Orientation orientation,
+					      int role) const
+{
+	if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+		return QVariant();
+
+	switch (section)
+	{
+	case NameColumn:
+		return tr("Name");
+	case GamesColumn:
+		return tr("Games");
+	case ScoreColumn:
+		return tr("Score");
+	case PercentColumn:
+		return tr("Score %");
+	case WinsColumn:
+		return tr("Wins");
+	case DrawsColumn:
+		return tr("Draws");
+	case LossesColumn:
+		return tr("Losses");
+	case EloColumn:
+		return tr("Elo");
+	case ErrorColumn:
+		return tr("+/-");
+	default:
+		return QVariant();
+	}
+}
+
+void TournamentStandingsModel::onGameFinished(ChessGame* game,
+					      int number,
+					      int whiteIndex,
+					      int blackIndex)
+{
+	Q_UNUSED(game);
+	Q_UNUSED(number);
+
+	updateRow(whiteIndex);
+	updateRow(blackIndex);
+	scheduleRatingUpdate();
+}
+
+void TournamentStandingsModel::onTournamentFinished()
+{
+	// Show the final ratings before the tournament is destroyed
+	m_ratingTimer->stop();
+	updateRatings();
+}
+
+void TournamentStandingsModel::updateRow(int row)
+{
+	if (!m_tournament || row < 0 || row >= m_rows.size())
+		return;
+
+	const Tournament::PlayerData player(m_tournament->playerAt(row));
+	Row& data = m_rows[row];
+	if (player.wins == data.wins
+	&&  player.draws == data.draws
+	&&  player.losses == data.losses)
+		return;
+
+	data.wins = player.wins;
+	data.draws = player.draws;
+	data.losses = player.losses;
+	emit dataChanged(index(row, GamesColumn), index(row, LossesColumn));
+}
+
+void TournamentStandingsModel::scheduleRatingUpdate()
+{
+	if (!m_ratingTimer->isActive())
+		m_ratingTimer->start();
+}
+
+void TournamentStandingsModel::updateRatings()
+{
+	if (!m_tournament)
+		return;
+
+	RatingSolver* ratings = m_tournament->ratings();
+	ratings->solve();
+
+	// Every rating is relative to the average, so one game can move
+	// all of them; only rows whose displayed values changed are
+	// reported, in contiguous ranges.
+	int first = -1;
+	for (int i = 0; i <= m_rows.size(); i++)
+	{
+		bool changed = false;
+		if (i < m_rows.size())
+		{
+			Row& row = m_rows[i];
+			bool rated = ratings->gameCount(i) > 0;
+			int elo = qRound(ratings->rating(i));
+			int error = qRound(ratings->error(i));
+
+			changed = rated != row.rated
+				  || elo != row.elo
+				  || error != row.error;
+			row.rated = rated;
+			row.elo = elo;
+			row.error = error;
+		}
+
+		if (changed && first == -1)
+			first = i;
+		else if (!changed && first != -1)
+		{
+			emit dataChanged(index(first, EloColumn),
+					 index(i - 1, ErrorColumn));
+			first = -1;
+		}
+	}
+}
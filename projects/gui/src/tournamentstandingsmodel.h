@@ -0,0 +1,111 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef TOURNAMENT_STANDINGS_MODEL_H
+#define TOURNAMENT_STANDINGS_MODEL_H
+
+#include <QAbstractItemModel>
+#include <QVector>
+#include <QPointer>
+
+class QTimer;
+class Tournament;
+class ChessGame;
+
+/*!
+ * \brief Supplies the live standings of a tournament to views.
+ *
+ * The model has one row per player, in the tournament's player
+ * order; views can sort it with a QSortFilterProxyModel. A finished
+ * game only touches the rows of its two players. The ratings are
+ * re-solved at most a few times per second, starting from the
+ * previous solution, and rows whose displayed rating didn't change
+ * aren't reported as changed, which keeps large round robins cheap
+ * to follow.
+ */
+class TournamentStandingsModel : public QAbstractItemModel
+{
+	Q_OBJECT
+
+	public:
+		/*! The columns of the model. */
+		enum Column
+		{
+			NameColumn,	//!< Player name
+			GamesColumn,	//!< Number of games played
+			ScoreColumn,	//!< Score in points
+			PercentColumn,	//!< Score percentage
+			WinsColumn,	//!< Number of wins
+			DrawsColumn,	//!< Number of draws
+			LossesColumn,	//!< Number of losses
+			EloColumn,	//!< Relative ELO rating
+			ErrorColumn,	//!< 95% error bar of the rating
+			ColumnCount
+		};
+
+		/*! Constructs a model with the given \a parent. */
+		TournamentStandingsModel(QObject* parent = 0);
+
+		/*!
+		 * Shows the standings of \a tournament.
+		 *
+		 * The rows of the previous tournament are kept until this
+		 * function is called again, even after the tournament is
+		 * destroyed.
+		 */
+		void setTournament(Tournament* tournament);
+
+		// Inherited from QAbstractItemModel
+		virtual QModelIndex index(int row, int column,
+					  const QModelIndex& parent = QModelIndex()) const;
+		virtual QModelIndex parent(const QModelIndex& index) const;
+		virtual int rowCount(const QModelIndex& parent = QModelIndex()) const;
+		virtual int columnCount(const QModelIndex& parent = QModelIndex()) const;
+		virtual QVariant data(const QModelIndex& index, int role) const;
+		virtual QVariant headerData(int section, Qt::Orientation orientation,
+					    int role = Qt::DisplayRole) const;
+
+	private slots:
+		void onGameFinished(ChessGame* game,
+				    int number,
+				    int whiteIndex,
+				    int blackIndex);
+		void onTournamentFinished();
+		void updateRatings();
+
+	private:
+		struct Row
+		{
+			QString name;
+			int wins;
+			int draws;
+			int losses;
+			int elo;
+			int error;
+			bool rated;
+		};
+
+		void updateRow(int row);
+		void scheduleRatingUpdate();
+
+		QPointer<Tournament> m_tournament;
+		QVector<Row> m_rows;
+		QTimer* m_ratingTimer;
+};
+
+#endif // TOURNAMENT_STANDINGS_MODEL_H
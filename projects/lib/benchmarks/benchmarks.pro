@@ -1,2 +1,5 @@
 TEMPLATE = subdirs
-SUBDIRS = pgngame
+SUBDIRS = board \
+          openingbook \
+          pgngame \
+          pgnstream
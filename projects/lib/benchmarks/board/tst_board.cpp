@@ -0,0 +1,185 @@
+#include <QtTest/QtTest>
+#include <board/board.h>
+#include <board/boardfactory.h>
+
+/*
+ * Measures the Board operations that run for every move of a game:
+ * making and undoing moves, move generation, move strings in both
+ * notations and FEN strings. Each benchmark replays the same game.
+ *
+ * Run with -csv or -xml for machine-readable results.
+ */
+class tst_Board: public QObject
+{
+	Q_OBJECT
+
+	public:
+		tst_Board();
+
+	private slots:
+		void initTestCase();
+		void cleanupTestCase();
+
+		void makeUndoMove();
+		void legalMoves();
+		void moveString_data() const;
+		void moveString();
+		void moveFromString_data() const;
+		void moveFromString();
+		void fenString();
+		void setFenString();
+
+	private:
+		Chess::Board* m_board;
+		QVector<Chess::Move> m_moves;
+		QStringList m_fens;
+};
+
+static const char* s_game[] = {
+	"c4", "c6", "e4", "d5", "exd5", "cxd5", "d4", "Nf6", "Nc3", "Nc6",
+	"Nf3", "Bg4", "cxd5", "Nxd5", "Qb3", "Bxf3", "gxf3", "e6", "Qxb7", "Nxd4",
+	"Bb5+", "Nxb5", "Qc6+", "Ke7", "Qxb5", "Qd7", "Nxd5+", "Qxd5", "Bg5+", "f6",
+	"Qxd5", "exd5", "Be3", "Ke6", "O-O-O", "Bb4", "Rd3", "Rhd8", "a3", "Rac8+",
+	"Kb1", "Bc5", "Re1", "Kd6", "Rg1", "g6", "Rgd1", "Ke6", "Re1", "Bxe3",
+	"Rdxe3+", "Kf5", "Re7", "Kf4", "R1e3", "a5", "h3", "h5", "R7e6", "Kg5",
+	"Ra6", "d4", "f4+", "Kf5", "Rxa5+", "Kxf4", "Rd3", "Ke4", "Rd2", "g5",
+	0
+};
+
+tst_Board::tst_Board()
+	: m_board(0)
+{
+}
+
+void tst_Board::initTestCase()
+{
+	m_board = Chess::BoardFactory::create("standard");
+	QVERIFY(m_board != 0);
+	m_board->reset();
+
+	for (int i = 0; s_game[i] != 0; i++)
+	{
+		m_fens << m_board->fenString();
+		Chess::Move move(m_board->moveFromString(s_game[i]));
+		QVERIFY2(!move.isNull(), s_game[i]);
+		m_moves << move;
+		m_board->makeMove(move);
+	}
+	m_board->reset();
+}
+
+void tst_Board::cleanupTestCase()
+{
+	delete m_board;
+}
+
+void tst_Board::makeUndoMove()
+{
+	QBENCHMARK
+	{
+		foreach (const Chess::Move& move, m_moves)
+			m_board->makeMove(move);
+		for (int i = 0; i < m_moves.size(); i++)
+			m_board->undoMove();
+	}
+}
+
+void tst_Board::legalMoves()
+{
+	int count = 0;
+	QBENCHMARK
+	{
+		foreach (const Chess::Move& move, m_moves)
+		{
+			count += m_board->legalMoves().size();
+			m_board->makeMove(move);
+		}
+		for (int i = 0; i < m_moves.size(); i++)
+			m_board->undoMove();
+	}
+	QVERIFY(count > 0);
+}
+
+void tst_Board::moveString_data() const
+{
+	QTest::addColumn<int>("notation");
+
+	QTest::newRow("san") << int(Chess::Board::StandardAlgebraic);
+	QTest::newRow("lan") << int(Chess::Board::LongAlgebraic);
+}
+
+void tst_Board::moveString()
+{
+	QFETCH(int, notation);
+	Chess::Board::MoveNotation type = Chess::Board::MoveNotation(notation);
+
+	QBENCHMARK
+	{
+		foreach (const Chess::Move& move, m_moves)
+		{
+			m_board->moveString(move, type);
+			m_board->makeMove(move);
+		}
+		for (int i = 0; i < m_moves.size(); i++)
+			m_board->undoMove();
+	}
+}
+
+void tst_Board::moveFromString_data() const
+{
+	QTest::addColumn<int>("notation");
+
+	QTest::newRow("san") << int(Chess::Board::StandardAlgebraic);
+	QTest::newRow("lan") << int(Chess::Board::LongAlgebraic);
+}
+
+void tst_Board::moveFromString()
+{
+	QFETCH(int, notation);
+	Chess::Board::MoveNotation type = Chess::Board::MoveNotation(notation);
+
+	QStringList strings;
+	foreach (const Chess::Move& move, m_moves)
+	{
+		strings << m_board->moveString(move, type);
+		m_board->makeMove(move);
+	}
+	for (int i = 0; i < m_moves.size(); i++)
+		m_board->undoMove();
+
+	QBENCHMARK
+	{
+		foreach (const QString& str, strings)
+			m_board->makeMove(m_board->moveFromString(str));
+		for (int i = 0; i < strings.size(); i++)
+			m_board->undoMove();
+	}
+}
+
+void tst_Board::fenString()
+{
+	// Each position is new to the board, so the FEN cache can't help
+	QBENCHMARK
+	{
+		foreach (const Chess::Move& move, m_moves)
+		{
+			m_board->fenString();
+			m_board->makeMove(move);
+		}
+		for (int i = 0; i < m_moves.size(); i++)
+			m_board->undoMove();
+	}
+}
+
+void tst_Board::setFenString()
+{
+	QBENCHMARK
+	{
+		foreach (const QString& fen, m_fens)
+			m_board->setFenString(fen);
+	}
+	m_board->reset();
+}
+
+QTEST_MAIN(tst_Board)
+#include "tst_board.moc"
@@ -0,0 +1,4 @@
+include(../benchmarks.pri)
+
+TARGET = tst_openingbook
+SOURCES += tst_openingbook.cpp
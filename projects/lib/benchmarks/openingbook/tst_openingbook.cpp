@@ -0,0 +1,124 @@
+#include <QtTest/QtTest>
+#include <board/board.h>
+#include <board/boardfactory.h>
+#include <pgnstream.h>
+#include <polyglotbook.h>
+#include <econode.h>
+
+/*
+ * Measures position lookups in an opening book and in the ECO tree,
+ * which happen for every book move and every finished game. The
+ * lookups walk the positions of an opening that is in both.
+ *
+ * Run with -csv or -xml for machine-readable results.
+ */
+class tst_OpeningBook: public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void initTestCase();
+
+		void polyglotLookup_data() const;
+		void polyglotLookup();
+		void ecoFindKey();
+		void ecoFindMoves();
+
+	private:
+		QByteArray m_pgn;
+		QStringList m_sanMoves;
+		QVector<quint64> m_keys;
+};
+
+static const char s_game[] =
+	"[Event \"?\"]\n"
+	"[Result \"1/2-1/2\"]\n\n"
+	"1. c4 c6 2. e4 d5 3. exd5 cxd5 4. d4 Nf6 5. Nc3 Nc6 6. Nf3 Bg4 7. cxd5\n"
+	"Nxd5 8. Qb3 Bxf3 9. gxf3 e6 10. Qxb7 Nxd4 1/2-1/2\n\n";
+
+void tst_OpeningBook::initTestCase()
+{
+	m_pgn = s_game;
+
+	Chess::Board* board = Chess::BoardFactory::create("standard");
+	QVERIFY(board != 0);
+	board->reset();
+
+	PgnStream stream(&m_pgn);
+	QVERIFY(stream.nextGame());
+	while (stream.readNext() != PgnStream::NoToken)
+	{
+		if (stream.tokenType() != PgnStream::PgnMove)
+			continue;
+
+		QString san(QString::fromLatin1(stream.tokenString()));
+		Chess::Move move(board->moveFromString(san));
+		QVERIFY(!move.isNull());
+		m_keys << board->key();
+		m_sanMoves << san;
+		board->makeMove(move);
+	}
+	delete board;
+
+	QVERIFY(!m_keys.isEmpty());
+	QVERIFY(EcoNode::root() != 0);
+}
+
+void tst_OpeningBook::polyglotLookup_data() const
+{
+	QTest::addColumn<int>("mode");
+
+	QTest::newRow("ram") << int(OpeningBook::Ram);
+	QTest::newRow("disk") << int(OpeningBook::Disk);
+}
+
+void tst_OpeningBook::polyglotLookup()
+{
+	QFETCH(int, mode);
+
+	// Write the book to a file and read it back in the wanted mode
+	QTemporaryFile file;
+	QVERIFY(file.open());
+	file.close();
+	{
+		PolyglotBook book;
+		PgnStream stream(&m_pgn);
+		QVERIFY(book.import(stream, 1000) > 0);
+		QVERIFY(book.write(file.fileName()));
+	}
+
+	PolyglotBook book(OpeningBook::AccessMode(mode));
+	QVERIFY(book.read(file.fileName()));
+
+	int found = 0;
+	QBENCHMARK
+	{
+		found = 0;
+		foreach (quint64 key, m_keys)
+		{
+			if (!book.move(key).isNull())
+				found++;
+		}
+	}
+	QCOMPARE(found, m_keys.size());
+}
+
+void tst_OpeningBook::ecoFindKey()
+{
+	QBENCHMARK
+	{
+		foreach (quint64 key, m_keys)
+			EcoNode::find(key);
+	}
+}
+
+void tst_OpeningBook::ecoFindMoves()
+{
+	QBENCHMARK
+	{
+		EcoNode::find(m_sanMoves);
+	}
+}
+
+QTEST_MAIN(tst_OpeningBook)
+#include "tst_openingbook.moc"
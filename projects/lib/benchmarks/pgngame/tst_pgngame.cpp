@@ -12,9 +12,20 @@ class tst_PgnGame: public QObject
 		void parser();
 };
 
+static void addParserRows(const QString& name, const QByteArray& pgn)
+{
+	QTest::newRow(qPrintable(name + "-headers"))
+		<< pgn << int(PgnGame::ReadHeaders);
+	QTest::newRow(qPrintable(name + "-tokens"))
+		<< pgn << int(PgnGame::ReadMoveTokens);
+	QTest::newRow(qPrintable(name + "-full"))
+		<< pgn << int(PgnGame::ReadFull);
+}
+
 void tst_PgnGame::parser_data() const
 {
 	QTest::addColumn<QByteArray>("pgn");
+	QTest::addColumn<int>("mode");
 	QByteArray pgn;
 
 	pgn = "[Event \"?\"]\n"
@@ -43,7 +54,7 @@ void tst_PgnGame::parser_data() const
 	      "85. Rg2 Rf6 86. Rh2 Rh6 87. Rg2 Kf1 88. Rg5 Rf6 89. Rc5 Rd2 90. Rc6 Rf4\n"
 	      "91. Rc1+ Kg2 92. Rbb1 Rf8 93. Ka5 Ra2+ 94. Kb6 Rf6+ 95. Kc5 Rf5+ 96. Kb6\n"
 	      "Re2 97. b5 Re6+ 98. Ka5 Rfe5 99. Ka4 Re4+ 1/2-1/2\n";
-	QTest::newRow("game1") << pgn;
+	addParserRows("game1", pgn);
 
 	pgn = "[Event \"CCRL 40/40\"]\n"
 	      "[Site \"CCRL\"]\n"
@@ -83,18 +94,19 @@ void tst_PgnGame::parser_data() const
 	      "{-10.04/17 38s} Ke3 {+8.12/13 37s} 49. Ka3 {-11.44/18 38s} f4 {+9.40/14 37s}\n"
 	      "50. Rg5 {-12.37/18 38s} Rf1 {+9.91/13 37s} 51. Re5+ {-16.96/17 38s} Kd3\n"
 	      "{+12.91/14 37s 0-1 Adjudication} 0-1\n";
-	QTest::newRow("game2") << pgn;
+	addParserRows("game2", pgn);
 }
 
 void tst_PgnGame::parser()
 {
 	QFETCH(QByteArray, pgn);
+	QFETCH(int, mode);
 
 	PgnStream stream(&pgn);
 	PgnGame game;
 	QBENCHMARK
 	{
-		QVERIFY(game.read(stream));
+		QVERIFY(game.read(stream, INT_MAX - 1, PgnGame::ReadMode(mode)));
 		stream.rewind();
 	}
 }
@@ -0,0 +1,4 @@
+include(../benchmarks.pri)
+
+TARGET = tst_pgnstream
+SOURCES += tst_pgnstream.cpp
@@ -0,0 +1,108 @@
+#include <QtTest/QtTest>
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <pgnstream.h>
+
+/*
+ * Measures the tokenizer throughput of PgnStream. The corpus is read
+ * from the file named by the CUTECHESS_PGN_CORPUS environment variable,
+ * or generated by repeating a sample game if the variable isn't set.
+ *
+ * The "buffer" rows parse an in-memory string, which uses the same
+ * table-driven scanner as memory-mapped files. The "device" rows read
+ * through a QBuffer one character at a time, which is how all input
+ * used to be parsed.
+ */
+class tst_PgnStream: public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void initTestCase();
+		void tokenizer_data() const;
+		void tokenizer();
+
+	private:
+		QByteArray m_corpus;
+};
+
+static const char s_sampleGame[] =
+	"[Event \"CCRL 40/40\"]\n"
+	"[Site \"CCRL\"]\n"
+	"[Date \"2009.03.01\"]\n"
+	"[Round \"164.1.156\"]\n"
+	"[White \"Cheese 1.3\"]\n"
+	"[Black \"Chezzz 1.0.3\"]\n"
+	"[Result \"0-1\"]\n"
+	"[ECO \"C15\"]\n\n"
+	"1. e4 e6 2. d4 d5 3. Nc3 Bb4 4. Qd3 Ne7 5. Ne2 c5 6. Bg5 f6 7. Bd2 Nbc6 8.\n"
+	"O-O-O {-0.23/13 33s} O-O {+0.03/12 45s} 9. a3 {-0.13/13 28s} c4 {+0.11/13 45s}\n"
+	"10. Qg3 {+0.04/13 46s} Ba5 {+0.20/12 45s} 11. f3 {+0.04/13 45s} a6 {+0.05/12\n"
+	"45s} 12. h4 {+0.17/13 37s} b5 {+0.14/13 45s} 13. h5 {+0.26/13 46s} Bxc3\n"
+	"{+0.31/13 45s} 14. Bxc3 (14. bxc3 b4 {a variation}) a5 {+0.33/13 45s} 15. h6\n"
+	"g6 $2 16. Bd2 b4 17. a4 b3 18. c3 Qd7 19. Bf4 Na7 20. Bd6 Rf7 0-1\n\n";
+
+static const int s_sampleCount = 20000;
+
+void tst_PgnStream::initTestCase()
+{
+	QByteArray fileName(qgetenv("CUTECHESS_PGN_CORPUS"));
+	if (!fileName.isEmpty())
+	{
+		QFile file(QString::fromLocal8Bit(fileName));
+		QVERIFY2(file.open(QIODevice::ReadOnly), "Can't open the corpus");
+		m_corpus = file.readAll();
+	}
+	else
+	{
+		m_corpus.reserve(sizeof(s_sampleGame) * s_sampleCount);
+		for (int i = 0; i < s_sampleCount; i++)
+			m_corpus.append(s_sampleGame);
+	}
+}
+
+void tst_PgnStream::tokenizer_data() const
+{
+	QTest::addColumn<bool>("useDevice");
+
+	QTest::newRow("buffer") << false;
+	QTest::newRow("device") << true;
+}
+
+void tst_PgnStream::tokenizer()
+{
+	QFETCH(bool, useDevice);
+
+	QBuffer buffer(&m_corpus);
+	buffer.open(QIODevice::ReadOnly);
+
+	PgnStream stream;
+	qint64 tokens = 0;
+	qint64 elapsed = 0;
+	QElapsedTimer timer;
+
+	QBENCHMARK
+	{
+		timer.start();
+		if (useDevice)
+			stream.setDevice(&buffer);
+		else
+			stream.setString(&m_corpus);
+
+		tokens = 0;
+		while (stream.nextGame())
+		{
+			while (stream.readNext() != PgnStream::NoToken)
+				tokens++;
+		}
+		elapsed = timer.elapsed();
+		buffer.seek(0);
+	}
+
+	if (elapsed > 0)
+		qDebug("%lld tokens in %d bytes, %.0f tokens/sec",
+		       tokens, m_corpus.size(), tokens * 1000.0 / elapsed);
+}
+
+QTEST_MAIN(tst_PgnStream)
+#include "tst_pgnstream.moc"
@@ -1,5 +1,9 @@
 INCLUDEPATH += $$PWD
 HEADERS += $$PWD/jsonparser.h \
-    $$PWD/jsonserializer.h
+    $$PWD/jsonreader.h \
+    $$PWD/jsonserializer.h \
+    $$PWD/jsonwriter.h
 SOURCES += $$PWD/jsonparser.cpp \
-    $$PWD/jsonserializer.cpp
+    $$PWD/jsonreader.cpp \
+    $$PWD/jsonserializer.cpp \
+    $$PWD/jsonwriter.cpp
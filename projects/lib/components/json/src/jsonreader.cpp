@@ -0,0 +1,578 @@
+/*
+    Copyright (c) 2010 Ilari Pihlajisto
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "jsonreader.h"
+#include <QIODevice>
+
+static const int s_chunkSize = 64 * 1024;
+
+
+JsonReader::JsonReader(QIODevice* device)
+	: m_device(device),
+	  m_pos(0),
+	  m_atEnd(false),
+	  m_token(NoToken),
+	  m_state(ExpectValue),
+	  m_bool(false),
+	  m_line(1)
+{
+	Q_ASSERT(device != 0);
+
+	m_buffer.reserve(s_chunkSize);
+	m_text.reserve(256);
+	m_stack.reserve(16);
+}
+
+JsonReader::JsonReader(const QByteArray& data)
+	: m_device(0),
+	  m_buffer(data),
+	  m_pos(0),
+	  m_atEnd(false),
+	  m_token(NoToken),
+	  m_state(ExpectValue),
+	  m_bool(false),
+	  m_line(1)
+{
+	m_text.reserve(256);
+	m_stack.reserve(16);
+}
+
+JsonReader::TokenType JsonReader::tokenType() const
+{
+	return m_token;
+}
+
+int JsonReader::depth() const
+{
+	return m_stack.size();
+}
+
+QString JsonReader::text() const
+{
+	return QString::fromUtf8(m_text.constData(), m_text.size());
+}
+
+const QByteArray& JsonReader::rawText() const
+{
+	return m_text;
+}
+
+bool JsonReader::textEquals(const char* str) const
+{
+	return m_text == str;
+}
+
+qlonglong JsonReader::toLongLong(bool* ok) const
+{
+	return m_text.toLongLong(ok);
+}
+
+double JsonReader::toDouble(bool* ok) const
+{
+	return m_text.toDouble(ok);
+}
+
+bool JsonReader::toBool() const
+{
+	return m_bool;
+}
+
+bool JsonReader::hasError() const
+{
+	return m_token == Invalid;
+}
+
+QString JsonReader::errorString() const
+{
+	return m_errorString;
+}
+
+qint64 JsonReader::lineNumber() const
+{
+	return m_line;
+}
+
+JsonReader::TokenType JsonReader::setError(const QString& message)
+{
+	if (m_token != Invalid)
+	{
+		m_token = Invalid;
+		m_errorString = message;
+	}
+	return Invalid;
+}
+
+bool JsonReader::fillBuffer()
+{
+	if (m_atEnd)
+		return false;
+	if (m_device == 0)
+	{
+		m_atEnd = true;
+		return false;
+	}
+
+	// The buffer's capacity is reserved, so this doesn't reallocate
+	m_buffer.resize(s_chunkSize);
+	qint64 n = m_device->read(m_buffer.data(), s_chunkSize);
+	m_pos = 0;
+	if (n <= 0)
+	{
+		m_buffer.resize(0);
+		m_atEnd = true;
+		return false;
+	}
+
+	m_buffer.resize(int(n));
+	return true;
+}
+
+inline int JsonReader::peekChar()
+{
+	if (m_pos >= m_buffer.size() && !fillBuffer())
+		return -1;
+	return uchar(m_buffer.constData()[m_pos]);
+}
+
+void JsonReader::skipWhitespace()
+{
+	forever
+	{
+		int c = peekChar();
+		if (c == '\n')
+			m_line++;
+		else if (c != ' ' && c != '\t' && c != '\r')
+			return;
+		m_pos++;
+	}
+}
+
+JsonReader::State JsonReader::nextValueState() const
+{
+	return m_stack.isEmpty() ? ExpectEndOfDocument : ExpectCommaOrEnd;
+}
+
+JsonReader::TokenType JsonReader::readNext()
+{
+	if (m_token == Invalid || m_token == EndDocument)
+		return m_token;
+
+	m_text.resize(0);
+
+	// Skip the UTF-8 byte order mark
+	if (m_token == NoToken && peekChar() == 0xEF)
+	{
+		if (m_buffer.startsWith("\xEF\xBB\xBF"))
+			m_pos += 3;
+	}
+
+	skipWhitespace();
+	int c = peekChar();
+	if (c == -1)
+	{
+		if (m_state == ExpectEndOfDocument)
+			return m_token = EndDocument;
+		return setError(tr("Reached EOF unexpectedly"));
+	}
+
+	if (m_state == ExpectCommaOrEnd)
+	{
+		if (c != ',')
+			return endContainer(char(c));
+
+		m_pos++;
+		m_state = (m_stack.last() == '{') ? ExpectName : ExpectValue;
+		skipWhitespace();
+		if ((c = peekChar()) == -1)
+			return setError(tr("Reached EOF unexpectedly"));
+	}
+
+	switch (m_state)
+	{
+	case ExpectNameOrEnd:
+		if (c == '}')
+			return endContainer(char(c));
+		// Fall through
+	case ExpectName:
+		if (c != '\"')
+			return setError(tr("Invalid key: %1").arg(QChar(c)));
+		m_pos++;
+		if (!readString())
+			return Invalid;
+
+		skipWhitespace();
+		if (peekChar() != ':')
+			return setError(tr("Expected colon after key: %1")
+					.arg(text()));
+		m_pos++;
+		m_state = ExpectValue;
+		return m_token = Name;
+	case ExpectValueOrEnd:
+		if (c == ']')
+			return endContainer(char(c));
+		// Fall through
+	case ExpectValue:
+		return readValueToken(char(c));
+	default:
+		return setError(tr("Unexpected data after the end of the document"));
+	}
+}
+
+JsonReader::TokenType JsonReader::endContainer(char c)
+{
+	const char open = m_stack.isEmpty() ? 0 : m_stack.last();
+	if ((c == '}' && open == '{') || (c == ']' && open == '['))
+	{
+		m_pos++;
+		m_stack.resize(m_stack.size() - 1);
+		m_state = nextValueState();
+		return m_token = (c == '}') ? EndObject : EndArray;
+	}
+
+	return setError(tr("Expected comma or closing bracket instead of: %1")
+			.arg(QChar(uchar(c))));
+}
+
+JsonReader::TokenType JsonReader::readValueToken(char c)
+{
+	switch (c)
+	{
+	case '{':
+		m_pos++;
+		m_stack.append(c);
+		m_state = ExpectNameOrEnd;
+		return m_token = BeginObject;
+	case '[':
+		m_pos++;
+		m_stack.append(c);
+		m_state = ExpectValueOrEnd;
+		return m_token = BeginArray;
+	case '\"':
+		m_pos++;
+		if (!readString())
+			return Invalid;
+		m_token = String;
+		break;
+	case 't':
+	case 'f':
+		if (!readLiteral(c == 't' ? "true" : "false"))
+			return Invalid;
+		m_bool = (c == 't');
+		m_token = Bool;
+		break;
+	case 'n':
+		if (!readLiteral("null"))
+			return Invalid;
+		m_token = Null;
+		break;
+	default:
+		if (c != '-' && (c < '0' || c > '9'))
+			return setError(tr("Invalid value: %1")
+					.arg(QChar(uchar(c))));
+		if (!readNumber())
+			return Invalid;
+		m_token = Number;
+		break;
+	}
+
+	m_state = nextValueState();
+	return m_token;
+}
+
+bool JsonReader::readLiteral(const char* literal)
+{
+	for (const char* p = literal; *p != 0; p++)
+	{
+		int c = peekChar();
+		if (c != uchar(*p))
+		{
+			if (c != -1)
+				m_text.append(char(c));
+			setError(tr("Unknown token: %1").arg(text()));
+			return false;
+		}
+		m_text.append(*p);
+		m_pos++;
+	}
+
+	return true;
+}
+
+bool JsonReader::readNumber()
+{
+	forever
+	{
+		int c = peekChar();
+		if ((c < '0' || c > '9')
+		&&  c != '-' && c != '+' && c != '.' && c != 'e' && c != 'E')
+			break;
+		m_text.append(char(c));
+		m_pos++;
+	}
+
+	bool ok = false;
+	m_text.toDouble(&ok);
+	if (!ok)
+	{
+		setError(tr("Invalid number: %1").arg(text()));
+		return false;
+	}
+
+	return true;
+}
+
+bool JsonReader::readString()
+{
+	forever
+	{
+		if (m_pos >= m_buffer.size() && !fillBuffer())
+		{
+			setError(tr("Reached EOF unexpectedly"));
+			return false;
+		}
+
+		// Copy a run of unescaped characters at once
+		const char* data = m_buffer.constData();
+		const int size = m_buffer.size();
+		const int start = m_pos;
+		while (m_pos < size && data[m_pos] != '\"' && data[m_pos] != '\\')
+		{
+			if (data[m_pos] == '\n')
+				m_line++;
+			m_pos++;
+		}
+		m_text.append(data + start, m_pos - start);
+		if (m_pos >= size)
+			continue;
+
+		if (data[m_pos++] == '\"')
+			return true;
+
+		int c = peekChar();
+		if (c == -1)
+			continue;
+		m_pos++;
+
+		switch (c)
+		{
+		case '\"':
+		case '\\':
+		case '/':
+			m_text.append(char(c));
+			break;
+		case 'b':
+			m_text.append('\b');
+			break;
+		case 'f':
+			m_text.append('\f');
+			break;
+		case 'n':
+			m_text.append('\n');
+			break;
+		case 'r':
+			m_text.append('\r');
+			break;
+		case 't':
+			m_text.append('\t');
+			break;
+		case 'u':
+			if (!readUnicodeEscape())
+				return false;
+			break;
+		default:
+			setError(tr("Unknown escape sequence: \\%1").arg(QChar(c)));
+			return false;
+		}
+	}
+}
+
+bool JsonReader::readHexQuad(uint* code)
+{
+	*code = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		int c = peekChar();
+		int digit;
+		if (c >= '0' && c <= '9')
+			digit = c - '0';
+		else if (c >= 'a' && c <= 'f')
+			digit = c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			digit = c - 'A' + 10;
+		else
+		{
+			setError(tr("Invalid unicode digit: %1")
+				 .arg(c == -1 ? QString() : QString(QChar(c))));
+			return false;
+		}
+
+		*code = (*code << 4) | uint(digit);
+		m_pos++;
+	}
+
+	return true;
+}
+
+bool JsonReader::readUnicodeEscape()
+{
+	uint code = 0;
+	if (!readHexQuad(&code))
+		return false;
+
+	if (code >= 0xDC00 && code <= 0xDFFF)
+	{
+		setError(tr("Invalid unicode surrogate pair"));
+		return false;
+	}
+	if (code >= 0xD800 && code <= 0xDBFF)
+	{
+		uint low = 0;
+		if (peekChar() != '\\')
+		{
+			setError(tr("Invalid unicode surrogate pair"));
+			return false;
+		}
+		m_pos++;
+		if (peekChar() != 'u')
+		{
+			setError(tr("Invalid unicode surrogate pair"));
+			return false;
+		}
+		m_pos++;
+		if (!readHexQuad(&low))
+			return false;
+		if (low < 0xDC00 || low > 0xDFFF)
+		{
+			setError(tr("Invalid unicode surrogate pair"));
+			return false;
+		}
+		code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+	}
+
+	appendUtf8(code);
+	return true;
+}
+
+void JsonReader::appendUtf8(uint code)
+{
+	if (code < 0x80)
+		m_text.append(char(code));
+	else if (code < 0x800)
+	{
+		m_text.append(char(0xC0 | (code >> 6)));
+		m_text.append(char(0x80 | (code & 0x3F)));
+	}
+	else if (code < 0x10000)
+	{
+		m_text.append(char(0xE0 | (code >> 12)));
+		m_text.append(char(0x80 | ((code >> 6) & 0x3F)));
+		m_text.append(char(0x80 | (code & 0x3F)));
+	}
+	else
+	{
+		m_text.append(char(0xF0 | (code >> 18)));
+		m_text.append(char(0x80 | ((code >> 12) & 0x3F)));
+		m_text.append(char(0x80 | ((code >> 6) & 0x3F)));
+		m_text.append(char(0x80 | (code & 0x3F)));
+	}
+}
+
+QVariant JsonReader::readValue()
+{
+	switch (m_token)
+	{
+	case Name:
+		readNext();
+		return readValue();
+	case String:
+		return text();
+	case Bool:
+		return m_bool;
+	case Number:
+		{
+			bool ok = false;
+			if (m_text.contains('.')
+			||  m_text.contains('e')
+			||  m_text.contains('E'))
+				return toDouble();
+
+			int val = m_text.toInt(&ok);
+			if (ok)
+				return val;
+			qlonglong longval = m_text.toLongLong(&ok);
+			if (ok)
+				return longval;
+			return toDouble();
+		}
+	case BeginArray:
+		{
+			QVariantList list;
+			while (readNext() != EndArray)
+			{
+				const QVariant value(readValue());
+				if (hasError())
+					return QVariant();
+				list << value;
+			}
+			return list;
+		}
+	case BeginObject:
+		{
+			QVariantMap map;
+			while (readNext() == Name)
+			{
+				const QString name(text());
+				readNext();
+				const QVariant value(readValue());
+				if (hasError())
+					return QVariant();
+				map[name] = value;
+			}
+			if (hasError())
+				return QVariant();
+			return map;
+		}
+	default:
+		return QVariant();
+	}
+}
+
+bool JsonReader::skipValue()
+{
+	if (m_token == Name)
+		readNext();
+
+	if (m_token == BeginObject || m_token == BeginArray)
+	{
+		const int depth = m_stack.size() - 1;
+		while (m_stack.size() > depth)
+		{
+			if (readNext() == Invalid)
+				return false;
+		}
+	}
+
+	return !hasError();
+}
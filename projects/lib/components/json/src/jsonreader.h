@@ -0,0 +1,203 @@
+/*
+    Copyright (c) 2010 Ilari Pihlajisto
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef JSONREADER_H
+#define JSONREADER_H
+
+#include <QByteArray>
+#include <QVariant>
+#include <QVector>
+#include <QCoreApplication>
+
+class QIODevice;
+
+
+/*!
+ * \brief A streaming pull parser for JSON data.
+ *
+ * Unlike JsonParser, which builds the whole document into a QVariant
+ * tree, JsonReader reports the document one token at a time, in the
+ * spirit of QXmlStreamReader. The input is read in fixed-size chunks
+ * from a QIODevice (or taken from an in-memory UTF-8 buffer) and the
+ * text of the current token is kept in a reusable byte buffer, so
+ * large configuration and result files can be scanned with a small,
+ * constant memory footprint.
+ *
+ * Typical usage:
+ * \code
+ * JsonReader reader(&file);
+ * while (reader.readNext() != JsonReader::EndDocument)
+ * {
+ *	if (reader.hasError())
+ *		break;
+ *	if (reader.tokenType() == JsonReader::Name
+ *	&&  reader.textEquals("games"))
+ *		...
+ * }
+ * \endcode
+ *
+ * readValue() can be used to materialize a single subtree (eg. one
+ * array item) as a QVariant, and skipValue() discards a subtree
+ * without decoding it.
+ *
+ * \sa JsonParser
+ */
+class LIB_EXPORT JsonReader
+{
+	Q_DECLARE_TR_FUNCTIONS(JsonReader)
+
+	public:
+		/*! The type of a token. */
+		enum TokenType
+		{
+			NoToken,	//!< readNext() hasn't been called yet
+			Invalid,	//!< A parsing error occured
+			BeginObject,	//!< Start of an object: {
+			EndObject,	//!< End of an object: }
+			BeginArray,	//!< Start of an array: [
+			EndArray,	//!< End of an array: ]
+			Name,		//!< Key of an object member
+			String,		//!< String value
+			Number,		//!< Numeric value
+			Bool,		//!< true or false
+			Null,		//!< null
+			EndDocument	//!< End of the document
+		};
+
+		/*!
+		 * Creates a new reader that reads UTF-8 encoded data
+		 * from \a device.
+		 *
+		 * The device must be open for reading and it must stay
+		 * alive as long as the reader is used.
+		 */
+		explicit JsonReader(QIODevice* device);
+		/*! Creates a new reader for the UTF-8 encoded \a data. */
+		explicit JsonReader(const QByteArray& data);
+
+		/*!
+		 * Reads the next token and returns its type.
+		 *
+		 * Returns Invalid if an error occurs, and EndDocument
+		 * after the top-level value has been read.
+		 */
+		TokenType readNext();
+		/*! Returns the type of the current token. */
+		TokenType tokenType() const;
+		/*! Returns the number of objects and arrays currently open. */
+		int depth() const;
+
+		/*!
+		 * Returns the text of the current Name, String or
+		 * Number token.
+		 */
+		QString text() const;
+		/*!
+		 * Returns the raw UTF-8 text of the current token.
+		 *
+		 * The returned array is overwritten by the next call
+		 * to readNext().
+		 */
+		const QByteArray& rawText() const;
+		/*!
+		 * Returns true if the text of the current token is equal
+		 * to \a str. No memory is allocated.
+		 */
+		bool textEquals(const char* str) const;
+		/*!
+		 * Returns the current Number token as an integer.
+		 * If \a ok is not null, failure is reported by setting
+		 * *ok to false.
+		 */
+		qlonglong toLongLong(bool* ok = 0) const;
+		/*! Returns the current Number token as a double. */
+		double toDouble(bool* ok = 0) const;
+		/*! Returns the value of the current Bool token. */
+		bool toBool() const;
+
+		/*!
+		 * Reads the value that starts with the current token
+		 * and returns it as a QVariant.
+		 *
+		 * If the current token is BeginObject or BeginArray the
+		 * reader advances to the matching end token. Numbers are
+		 * converted the same way as in JsonParser.
+		 */
+		QVariant readValue();
+		/*!
+		 * Skips the value that starts with the current token
+		 * without converting it.
+		 *
+		 * If the current token is Name the member's value is
+		 * skipped as well. Returns false on error.
+		 */
+		bool skipValue();
+
+		/*! Returns true if a parsing error occured. */
+		bool hasError() const;
+		/*! Returns a detailed description of the error. */
+		QString errorString() const;
+		/*! Returns the current line number. */
+		qint64 lineNumber() const;
+
+	private:
+		enum State
+		{
+			ExpectValue,
+			ExpectValueOrEnd,
+			ExpectName,
+			ExpectNameOrEnd,
+			ExpectCommaOrEnd,
+			ExpectEndOfDocument
+		};
+
+		bool fillBuffer();
+		int peekChar();
+		void skipWhitespace();
+		TokenType readValueToken(char c);
+		bool readString();
+		bool readUnicodeEscape();
+		bool readHexQuad(uint* code);
+		void appendUtf8(uint code);
+		bool readNumber();
+		bool readLiteral(const char* literal);
+		TokenType endContainer(char c);
+		State nextValueState() const;
+		TokenType setError(const QString& message);
+
+		QIODevice* m_device;
+		QByteArray m_buffer;
+		int m_pos;
+		bool m_atEnd;
+		TokenType m_token;
+		State m_state;
+		QVector<char> m_stack;
+		QByteArray m_text;
+		bool m_bool;
+		qint64 m_line;
+		QString m_errorString;
+};
+
+#endif // JSONREADER_H
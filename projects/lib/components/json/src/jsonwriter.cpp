@@ -0,0 +1,287 @@
+/*
+    Copyright (c) 2010 Ilari Pihlajisto
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "jsonwriter.h"
+#include <cstdio>
+#include <qnumeric.h>
+#include <QString>
+#include <QIODevice>
+
+static const int s_initialCapacity = 4096;
+
+
+JsonWriter::JsonWriter()
+	: m_afterName(false)
+{
+	m_data.reserve(s_initialCapacity);
+	m_first.reserve(16);
+}
+
+int JsonWriter::depth() const
+{
+	return m_first.size();
+}
+
+const QByteArray& JsonWriter::data() const
+{
+	return m_data;
+}
+
+void JsonWriter::clear()
+{
+	// The capacity is reserved, so this doesn't free the memory
+	m_data.resize(0);
+}
+
+bool JsonWriter::flush(QIODevice* device)
+{
+	Q_ASSERT(device != 0);
+
+	bool ok = (device->write(m_data) == m_data.size());
+	clear();
+	return ok;
+}
+
+void JsonWriter::beginValue()
+{
+	if (m_afterName)
+	{
+		m_afterName = false;
+		return;
+	}
+	if (m_first.isEmpty())
+		return;
+
+	if (m_first.last())
+		m_first.last() = false;
+	else
+		m_data.append(',');
+}
+
+void JsonWriter::endValue()
+{
+	if (m_first.isEmpty())
+		m_data.append('\n');
+}
+
+void JsonWriter::beginObject()
+{
+	beginValue();
+	m_data.append('{');
+	m_first.append(true);
+}
+
+void JsonWriter::endObject()
+{
+	Q_ASSERT(!m_first.isEmpty());
+
+	m_first.resize(m_first.size() - 1);
+	m_data.append('}');
+	endValue();
+}
+
+void JsonWriter::beginArray()
+{
+	beginValue();
+	m_data.append('[');
+	m_first.append(true);
+}
+
+void JsonWriter::endArray()
+{
+	Q_ASSERT(!m_first.isEmpty());
+
+	m_first.resize(m_first.size() - 1);
+	m_data.append(']');
+	endValue();
+}
+
+void JsonWriter::writeName(const char* name)
+{
+	Q_ASSERT(!m_afterName);
+
+	beginValue();
+	m_data.append('\"');
+	m_data.append(name);
+	m_data.append("\":");
+	m_afterName = true;
+}
+
+void JsonWriter::writeName(const QString& name)
+{
+	Q_ASSERT(!m_afterName);
+
+	beginValue();
+	appendString(name);
+	m_data.append(':');
+	m_afterName = true;
+}
+
+void JsonWriter::writeValue(const QString& value)
+{
+	beginValue();
+	appendString(value);
+	endValue();
+}
+
+void JsonWriter::writeValue(const char* value)
+{
+	beginValue();
+	appendLatin1String(value);
+	endValue();
+}
+
+void JsonWriter::writeValue(bool value)
+{
+	beginValue();
+	m_data.append(value ? "true" : "false");
+	endValue();
+}
+
+void JsonWriter::writeValue(int value)
+{
+	writeValue(qint64(value));
+}
+
+void JsonWriter::writeValue(qint64 value)
+{
+	char buf[32];
+	std::snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(value));
+
+	beginValue();
+	m_data.append(buf);
+	endValue();
+}
+
+void JsonWriter::writeValue(double value)
+{
+	if (qIsNaN(value) || qIsInf(value))
+	{
+		writeNull();
+		return;
+	}
+
+	char buf[32];
+	std::snprintf(buf, sizeof(buf), "%.10g", value);
+
+	beginValue();
+	m_data.append(buf);
+	endValue();
+}
+
+void JsonWriter::writeNull()
+{
+	beginValue();
+	m_data.append("null");
+	endValue();
+}
+
+void JsonWriter::appendCodePoint(uint c)
+{
+	static const char hexDigits[] = "0123456789abcdef";
+
+	switch (c)
+	{
+	case '\"':
+		m_data.append("\\\"");
+		return;
+	case '\\':
+		m_data.append("\\\\");
+		return;
+	case '\b':
+		m_data.append("\\b");
+		return;
+	case '\f':
+		m_data.append("\\f");
+		return;
+	case '\n':
+		m_data.append("\\n");
+		return;
+	case '\r':
+		m_data.append("\\r");
+		return;
+	case '\t':
+		m_data.append("\\t");
+		return;
+	default:
+		break;
+	}
+
+	if (c < 0x20)
+	{
+		m_data.append("\\u00");
+		m_data.append(hexDigits[c >> 4]);
+		m_data.append(hexDigits[c & 0xF]);
+	}
+	else if (c < 0x80)
+		m_data.append(char(c));
+	else if (c < 0x800)
+	{
+		m_data.append(char(0xC0 | (c >> 6)));
+		m_data.append(char(0x80 | (c & 0x3F)));
+	}
+	else if (c < 0x10000)
+	{
+		m_data.append(char(0xE0 | (c >> 12)));
+		m_data.append(char(0x80 | ((c >> 6) & 0x3F)));
+		m_data.append(char(0x80 | (c & 0x3F)));
+	}
+	else
+	{
+		m_data.append(char(0xF0 | (c >> 18)));
+		m_data.append(char(0x80 | ((c >> 12) & 0x3F)));
+		m_data.append(char(0x80 | ((c >> 6) & 0x3F)));
+		m_data.append(char(0x80 | (c & 0x3F)));
+	}
+}
+
+void JsonWriter::appendLatin1String(const char* str)
+{
+	m_data.append('\"');
+	for (const char* p = str; *p != 0; p++)
+		appendCodePoint(uchar(*p));
+	m_data.append('\"');
+}
+
+void JsonWriter::appendString(const QString& str)
+{
+	m_data.append('\"');
+
+	const QChar* it = str.constData();
+	const QChar* end = it + str.size();
+	for (; it != end; ++it)
+	{
+		if (it->isHighSurrogate() && it + 1 != end
+		&&  (it + 1)->isLowSurrogate())
+		{
+			appendCodePoint(QChar::surrogateToUcs4(*it, *(it + 1)));
+			++it;
+		}
+		else
+			appendCodePoint(it->unicode());
+	}
+
+	m_data.append('\"');
+}
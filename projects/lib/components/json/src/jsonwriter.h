@@ -0,0 +1,128 @@
+/*
+    Copyright (c) 2010 Ilari Pihlajisto
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+
+#include <QByteArray>
+#include <QVector>
+
+class QString;
+class QIODevice;
+
+
+/*!
+ * \brief An incremental writer for compact JSON records.
+ *
+ * JsonWriter is the streaming counterpart of JsonSerializer: instead
+ * of converting a complete QVariant tree it appends values one at a
+ * time to an internal UTF-8 buffer. The buffer keeps its capacity
+ * when it's cleared, so a writer that's reused for many small records
+ * doesn't allocate memory once it has warmed up.
+ *
+ * The output is compact, and a newline is appended after each
+ * top-level value, which makes a series of records a valid
+ * JSON Lines stream.
+ *
+ * \code
+ * JsonWriter writer;
+ * writer.beginObject();
+ * writer.writeName("result");
+ * writer.writeValue(QString("1-0"));
+ * writer.endObject();
+ * writer.flush(&file);
+ * \endcode
+ *
+ * \sa JsonSerializer, JsonReader
+ */
+class LIB_EXPORT JsonWriter
+{
+	public:
+		/*! Creates a new writer with an empty buffer. */
+		JsonWriter();
+
+		/*! Starts a new object. */
+		void beginObject();
+		/*! Ends the current object. */
+		void endObject();
+		/*! Starts a new array. */
+		void beginArray();
+		/*! Ends the current array. */
+		void endArray();
+
+		/*!
+		 * Writes the key of an object member.
+		 *
+		 * \a name must be Latin-1 text that doesn't need escaping.
+		 */
+		void writeName(const char* name);
+		/*! Writes the key of an object member. */
+		void writeName(const QString& name);
+
+		/*! Writes a string value. */
+		void writeValue(const QString& value);
+		/*! Writes a Latin-1 string value. */
+		void writeValue(const char* value);
+		/*! Writes a boolean value. */
+		void writeValue(bool value);
+		/*! Writes an integer value. */
+		void writeValue(int value);
+		/*! Writes an integer value. */
+		void writeValue(qint64 value);
+		/*!
+		 * Writes a floating-point value.
+		 *
+		 * NaN and infinite values are written as null.
+		 */
+		void writeValue(double value);
+		/*! Writes a null value. */
+		void writeNull();
+
+		/*! Returns the number of objects and arrays currently open. */
+		int depth() const;
+		/*! Returns the contents of the buffer. */
+		const QByteArray& data() const;
+		/*! Empties the buffer without releasing its memory. */
+		void clear();
+		/*!
+		 * Writes the buffer to \a device and clears it.
+		 *
+		 * Returns false if the data couldn't be written.
+		 */
+		bool flush(QIODevice* device);
+
+	private:
+		void beginValue();
+		void endValue();
+		void appendCodePoint(uint c);
+		void appendString(const QString& str);
+		void appendLatin1String(const char* str);
+
+		QByteArray m_data;
+		QVector<bool> m_first;
+		bool m_afterName;
+};
+
+#endif // JSONWRITER_H
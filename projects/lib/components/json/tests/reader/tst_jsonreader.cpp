@@ -0,0 +1,281 @@
+/*
+    Copyright (c) 2010 Ilari Pihlajisto
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <QtTest/QtTest>
+#include <jsonreader.h>
+#include <jsonparser.h>
+
+class tst_JsonReader: public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void initTestCase();
+
+		void tokens() const;
+		void values_data() const;
+		void values() const;
+		void invalid_data() const;
+		void invalid() const;
+		void skipValue() const;
+		void chunkBoundaries() const;
+
+		void benchmarkParser() const;
+		void benchmarkReaderValue() const;
+		void benchmarkReaderTokens() const;
+
+	private:
+		QByteArray m_largeDocument;
+};
+Q_DECLARE_METATYPE(QVariant)
+
+
+void tst_JsonReader::initTestCase()
+{
+	// A results file with 20000 games, about 2 megabytes
+	m_largeDocument = "[\n";
+	for (int i = 0; i < 20000; i++)
+	{
+		if (i > 0)
+			m_largeDocument += ",\n";
+		m_largeDocument += QString(
+			"{\"white\": \"Engine %1\", \"black\": \"Engine %2\", "
+			"\"result\": \"1/2-1/2\", \"plies\": %3, "
+			"\"score\": %4, \"adjudicated\": false, "
+			"\"moves\": [\"e4\", \"e5\", \"Nf3\", \"Nc6\"], "
+			"\"comment\": \"Draw by \\\"3-fold\\\" repetition\"}")
+			.arg(i % 8).arg((i + 1) % 8).arg(i % 200)
+			.arg(double(i) / 100.0).toUtf8();
+	}
+	m_largeDocument += "\n]\n";
+}
+
+void tst_JsonReader::tokens() const
+{
+	JsonReader reader(QByteArray(
+		"{\"a\": [1, -2.5, true, null], \"b\": {}, \"c\": \"x\"}"));
+
+	QCOMPARE(reader.readNext(), JsonReader::BeginObject);
+	QCOMPARE(reader.depth(), 1);
+	QCOMPARE(reader.readNext(), JsonReader::Name);
+	QVERIFY(reader.textEquals("a"));
+	QCOMPARE(reader.readNext(), JsonReader::BeginArray);
+	QCOMPARE(reader.depth(), 2);
+	QCOMPARE(reader.readNext(), JsonReader::Number);
+	QCOMPARE(reader.toLongLong(), Q_INT64_C(1));
+	QCOMPARE(reader.readNext(), JsonReader::Number);
+	QCOMPARE(reader.toDouble(), -2.5);
+	QCOMPARE(reader.readNext(), JsonReader::Bool);
+	QCOMPARE(reader.toBool(), true);
+	QCOMPARE(reader.readNext(), JsonReader::Null);
+	QCOMPARE(reader.readNext(), JsonReader::EndArray);
+	QCOMPARE(reader.readNext(), JsonReader::Name);
+	QCOMPARE(reader.text(), QString("b"));
+	QCOMPARE(reader.readNext(), JsonReader::BeginObject);
+	QCOMPARE(reader.readNext(), JsonReader::EndObject);
+	QCOMPARE(reader.readNext(), JsonReader::Name);
+	QCOMPARE(reader.readNext(), JsonReader::String);
+	QCOMPARE(reader.text(), QString("x"));
+	QCOMPARE(reader.readNext(), JsonReader::EndObject);
+	QCOMPARE(reader.depth(), 0);
+	QCOMPARE(reader.readNext(), JsonReader::EndDocument);
+	QVERIFY(!reader.hasError());
+}
+
+void tst_JsonReader::values_data() const
+{
+	QTest::addColumn<QByteArray>("input");
+	QTest::addColumn<QVariant>("expected");
+
+	QTest::newRow("integer")
+		<< QByteArray("-25")
+		<< QVariant(-25);
+	QTest::newRow("long integer")
+		<< QByteArray("1234567890123")
+		<< QVariant(Q_INT64_C(1234567890123));
+	QTest::newRow("exponent double")
+		<< QByteArray("3.71E-05")
+		<< QVariant(0.0000371);
+	QTest::newRow("escaped string")
+		<< QByteArray("\"Path = \\\"C:\\\\foo\\\"\\/\\b\\f\\n\\r\\t\"")
+		<< QVariant("Path = \"C:\\foo\"/\b\f\n\r\t");
+	QTest::newRow("unicode escapes")
+		<< QByteArray("\"\\u2654\\u00e4\\ud83d\\ude00\"")
+		<< QVariant(QString::fromUtf8("\xe2\x99\x94\xc3\xa4\xf0\x9f\x98\x80"));
+	QTest::newRow("utf-8 with bom")
+		<< QByteArray("\xef\xbb\xbf\"\xc3\xa4\"")
+		<< QVariant(QString::fromUtf8("\xc3\xa4"));
+
+	QVariantMap map;
+	map["foo"] = "bar";
+	map["state"] = QVariant();
+	map["list"] = QVariantList() << 1 << QVariantMap() << false;
+	QTest::newRow("object")
+		<< QByteArray("{\"foo\" : \"bar\", \"state\" : null,\n"
+			      " \"list\" : [1, {}, false]}")
+		<< QVariant(map);
+}
+
+void tst_JsonReader::values() const
+{
+	QFETCH(QByteArray, input);
+	QFETCH(QVariant, expected);
+
+	JsonReader reader(input);
+	reader.readNext();
+	QVariant data(reader.readValue());
+
+	QVERIFY(!reader.hasError());
+	QCOMPARE(data, expected);
+	QCOMPARE(reader.readNext(), JsonReader::EndDocument);
+}
+
+void tst_JsonReader::invalid_data() const
+{
+	QTest::addColumn<QByteArray>("input");
+	QTest::addColumn<qint64>("line");
+
+	QTest::newRow("empty") << QByteArray("") << qint64(1);
+	QTest::newRow("unknown token") << QByteArray("[nul]") << qint64(1);
+	QTest::newRow("missing comma") << QByteArray("[1\n2]") << qint64(2);
+	QTest::newRow("trailing comma") << QByteArray("[1,]") << qint64(1);
+	QTest::newRow("bad key") << QByteArray("{1: 2}") << qint64(1);
+	QTest::newRow("missing colon") << QByteArray("{\"a\" 2}") << qint64(1);
+	QTest::newRow("mismatched bracket") << QByteArray("[1}") << qint64(1);
+	QTest::newRow("bad number") << QByteArray("1.2.3") << qint64(1);
+	QTest::newRow("bad escape") << QByteArray("\"\\x\"") << qint64(1);
+	QTest::newRow("lone surrogate") << QByteArray("\"\\udc00\"") << qint64(1);
+	QTest::newRow("unterminated string")
+		<< QByteArray("[\"abc\n\n") << qint64(3);
+	QTest::newRow("extra data") << QByteArray("{}\n{}") << qint64(2);
+}
+
+void tst_JsonReader::invalid() const
+{
+	QFETCH(QByteArray, input);
+	QFETCH(qint64, line);
+
+	JsonReader reader(input);
+	while (reader.readNext() != JsonReader::EndDocument)
+	{
+		if (reader.hasError())
+			break;
+	}
+
+	QVERIFY(reader.hasError());
+	QVERIFY(!reader.errorString().isEmpty());
+	QCOMPARE(reader.lineNumber(), line);
+}
+
+void tst_JsonReader::skipValue() const
+{
+	JsonReader reader(QByteArray(
+		"{\"skip\": {\"a\": [1, [2, {}]], \"b\": \"}\"}, \"keep\": 5}"));
+
+	QCOMPARE(reader.readNext(), JsonReader::BeginObject);
+	QCOMPARE(reader.readNext(), JsonReader::Name);
+	QVERIFY(reader.skipValue());
+	QCOMPARE(reader.tokenType(), JsonReader::EndObject);
+	QCOMPARE(reader.depth(), 1);
+	QCOMPARE(reader.readNext(), JsonReader::Name);
+	QVERIFY(reader.textEquals("keep"));
+	QCOMPARE(reader.readValue(), QVariant(5));
+}
+
+void tst_JsonReader::chunkBoundaries() const
+{
+	// Strings and numbers span several 64 KB buffer chunks
+	QByteArray input("[\"");
+	input += QByteArray(100000, 'a');
+	input += "\\u00e4\", 0.";
+	input += QByteArray(70000, '1');
+	input += "]";
+
+	QBuffer buffer(&input);
+	QVERIFY(buffer.open(QIODevice::ReadOnly));
+	JsonReader reader(&buffer);
+
+	QCOMPARE(reader.readNext(), JsonReader::BeginArray);
+	QCOMPARE(reader.readNext(), JsonReader::String);
+	QCOMPARE(reader.text().size(), 100001);
+	QCOMPARE(reader.text().at(100000), QChar(0xe4));
+	QCOMPARE(reader.readNext(), JsonReader::Number);
+	QCOMPARE(reader.rawText().size(), 70002);
+	QCOMPARE(reader.readNext(), JsonReader::EndArray);
+	QCOMPARE(reader.readNext(), JsonReader::EndDocument);
+}
+
+void tst_JsonReader::benchmarkParser() const
+{
+	QBENCHMARK
+	{
+		QTextStream stream(m_largeDocument, QIODevice::ReadOnly);
+		JsonParser parser(stream);
+		QVariant data(parser.parse());
+		QCOMPARE(data.toList().size(), 20000);
+	}
+}
+
+void tst_JsonReader::benchmarkReaderValue() const
+{
+	QBENCHMARK
+	{
+		QBuffer buffer;
+		buffer.setData(m_largeDocument);
+		buffer.open(QIODevice::ReadOnly);
+		JsonReader reader(&buffer);
+		reader.readNext();
+		QVariant data(reader.readValue());
+		QCOMPARE(data.toList().size(), 20000);
+	}
+}
+
+void tst_JsonReader::benchmarkReaderTokens() const
+{
+	QBENCHMARK
+	{
+		QBuffer buffer;
+		buffer.setData(m_largeDocument);
+		buffer.open(QIODevice::ReadOnly);
+		JsonReader reader(&buffer);
+
+		int draws = 0;
+		while (reader.readNext() != JsonReader::EndDocument)
+		{
+			QVERIFY(!reader.hasError());
+			if (reader.tokenType() == JsonReader::Name
+			&&  reader.textEquals("result"))
+			{
+				reader.readNext();
+				if (reader.textEquals("1/2-1/2"))
+					draws++;
+			}
+		}
+		QCOMPARE(draws, 20000);
+	}
+}
+
+QTEST_MAIN(tst_JsonReader)
+#include "tst_jsonreader.moc"
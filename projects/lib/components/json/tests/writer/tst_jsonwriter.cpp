@@ -0,0 +1,111 @@
+/*
+    Copyright (c) 2010 Ilari Pihlajisto
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <QtTest/QtTest>
+#include <jsonwriter.h>
+#include <jsonreader.h>
+
+class tst_JsonWriter: public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void records() const;
+		void strings_data() const;
+		void strings() const;
+		void bufferReuse() const;
+};
+
+
+void tst_JsonWriter::records() const
+{
+	JsonWriter writer;
+
+	writer.beginObject();
+	writer.writeName("type");
+	writer.writeValue("game");
+	writer.writeName("game");
+	writer.writeValue(12);
+	writer.writeName("score");
+	writer.writeValue(0.5);
+	writer.writeName("list");
+	writer.beginArray();
+	writer.writeValue(true);
+	writer.writeNull();
+	writer.beginObject();
+	writer.endObject();
+	writer.endArray();
+	writer.endObject();
+	QCOMPARE(writer.depth(), 0);
+
+	writer.beginArray();
+	writer.writeValue(Q_INT64_C(-1234567890123));
+	writer.writeValue(qQNaN());
+	writer.endArray();
+
+	QCOMPARE(writer.data(),
+		 QByteArray("{\"type\":\"game\",\"game\":12,\"score\":0.5,"
+			    "\"list\":[true,null,{}]}\n"
+			    "[-1234567890123,null]\n"));
+}
+
+void tst_JsonWriter::strings_data() const
+{
+	QTest::addColumn<QString>("input");
+
+	QTest::newRow("plain") << QString("Engine 1");
+	QTest::newRow("escapes")
+		<< QString("Path = \"C:\\foo\"/\b\f\n\r\t\x01");
+	QTest::newRow("unicode")
+		<< QString::fromUtf8("\xe2\x99\x94\xc3\xa4\xf0\x9f\x98\x80");
+}
+
+void tst_JsonWriter::strings() const
+{
+	QFETCH(QString, input);
+
+	JsonWriter writer;
+	writer.writeValue(input);
+
+	JsonReader reader(writer.data());
+	QCOMPARE(reader.readNext(), JsonReader::String);
+	QCOMPARE(reader.text(), input);
+	QCOMPARE(reader.readNext(), JsonReader::EndDocument);
+}
+
+void tst_JsonWriter::bufferReuse() const
+{
+	JsonWriter writer;
+	writer.writeValue(QString(1000, 'x'));
+	const char* buffer = writer.data().constData();
+
+	writer.clear();
+	QVERIFY(writer.data().isEmpty());
+	writer.writeValue(QString(500, 'y'));
+	QVERIFY(writer.data().constData() == buffer);
+}
+
+QTEST_MAIN(tst_JsonWriter)
+#include "tst_jsonwriter.moc"
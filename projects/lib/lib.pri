@@ -1,4 +1,5 @@
-INCLUDEPATH += $$PWD/src
+INCLUDEPATH += $$PWD/src \
+    $$PWD/components/json/src
 LIBS += -lcutechess -L$$PWD
 
 win32:!static {
@@ -6,3 +7,8 @@ win32:!static {
 } else {
     DEFINES += LIB_EXPORT=""
 }
+
+# Allocation counting, see AllocationStats
+alloc_stats {
+    DEFINES += CUTECHESS_ALLOC_STATS
+}
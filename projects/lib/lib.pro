@@ -1,6 +1,6 @@
 TEMPLATE = lib
 TARGET = cutechess
-QT = core
+QT = core network
 DESTDIR = $$PWD
 
 win32:!static {
@@ -9,6 +9,11 @@ win32:!static {
     DEFINES += LIB_EXPORT=""
 }
 
+# Allocation counting, see AllocationStats
+alloc_stats {
+    DEFINES += CUTECHESS_ALLOC_STATS
+}
+
 include(src/src.pri)
 include(components/json/src/json.pri)
 include(3rdparty/gtb/src/gtb.pri)
@@ -0,0 +1,141 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "allocationstats.h"
+#include <QAtomicInt>
+
+#ifdef CUTECHESS_ALLOC_STATS
+
+#if defined(_MSC_VER)
+  #define THREAD_LOCAL __declspec(thread)
+#else
+  #define THREAD_LOCAL __thread
+#endif
+
+namespace {
+
+/*
+ * Each thread counts into its own slot, so the counters need no
+ * atomic operations. Everything here is plain static data because
+ * allocations are recorded before any constructors have run. Threads
+ * beyond the last slot share it, which makes its counts approximate.
+ */
+const int MaxSlots = 256;
+
+struct Counters
+{
+	quint64 count[AllocationStats::SubsystemCount];
+	quint64 bytes[AllocationStats::SubsystemCount];
+};
+
+Counters s_slots[MaxSlots];
+QBasicAtomicInt s_slotCount = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+THREAD_LOCAL Counters* t_counters = 0;
+THREAD_LOCAL int t_subsystem = AllocationStats::Other;
+
+} // anonymous namespace
+
+AllocationStats::Scope::Scope(Subsystem subsystem)
+	: m_previous(Subsystem(t_subsystem))
+{
+	t_subsystem = subsystem;
+}
+
+AllocationStats::Scope::~Scope()
+{
+	t_subsystem = m_previous;
+}
+
+bool AllocationStats::isEnabled()
+{
+	return true;
+}
+
+quint64 AllocationStats::count(Subsystem subsystem)
+{
+	quint64 total = 0;
+	int slots = qMin(s_slotCount.fetchAndAddRelaxed(0), MaxSlots);
+	for (int i = 0; i < slots; i++)
+		total += s_slots[i].count[subsystem];
+	return total;
+}
+
+quint64 AllocationStats::bytes(Subsystem subsystem)
+{
+	quint64 total = 0;
+	int slots = qMin(s_slotCount.fetchAndAddRelaxed(0), MaxSlots);
+	for (int i = 0; i < slots; i++)
+		total += s_slots[i].bytes[subsystem];
+	return total;
+}
+
+void AllocationStats::addAllocation(std::size_t size)
+{
+	Counters* counters = t_counters;
+	if (counters == 0)
+	{
+		int slot = s_slotCount.fetchAndAddRelaxed(1);
+		counters = &s_slots[qMin(slot, MaxSlots - 1)];
+		t_counters = counters;
+	}
+
+	counters->count[t_subsystem]++;
+	counters->bytes[t_subsystem] += size;
+}
+
+#else // not CUTECHESS_ALLOC_STATS
+
+AllocationStats::Scope::Scope(Subsystem subsystem)
+	: m_previous(subsystem)
+{
+}
+
+AllocationStats::Scope::~Scope()
+{
+}
+
+bool AllocationStats::isEnabled()
+{
+	return false;
+}
+
+quint64 AllocationStats::count(Subsystem subsystem)
+{
+	Q_UNUSED(subsystem);
+	return 0;
+}
+
+quint64 AllocationStats::bytes(Subsystem subsystem)
+{
+	Q_UNUSED(subsystem);
+	return 0;
+}
+
+void AllocationStats::addAllocation(std::size_t size)
+{
+	Q_UNUSED(size);
+}
+
+#endif // not CUTECHESS_ALLOC_STATS
+
+const char* AllocationStats::name(Subsystem subsystem)
+{
+	static const char* names[] = { "Other", "Board", "Pgn", "Engine" };
+	Q_ASSERT(subsystem >= 0 && subsystem < SubsystemCount);
+	return names[subsystem];
+}
@@ -0,0 +1,94 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ALLOCATIONSTATS_H
+#define ALLOCATIONSTATS_H
+
+#include <QtGlobal>
+#include <cstddef>
+
+/*!
+ * \brief Counts of memory allocations per subsystem.
+ *
+ * Allocation counting is compiled in only when Cute Chess is built
+ * with "CONFIG+=alloc_stats", which defines CUTECHESS_ALLOC_STATS.
+ * The program then hooks the allocation functions and calls
+ * addAllocation() for every allocation. Each allocation is charged
+ * to the subsystem of the innermost ALLOCATION_SCOPE in the calling
+ * thread, or to Other if there is none.
+ *
+ * In normal builds the scopes expand to nothing and the counts are
+ * always zero.
+ */
+class LIB_EXPORT AllocationStats
+{
+	public:
+		/*! A subsystem that allocations are charged to. */
+		enum Subsystem
+		{
+			Other,		//!< Outside any scope
+			Board,		//!< Chess::Board
+			Pgn,		//!< PgnGame and PgnStream
+			Engine,		//!< ChessEngine I/O
+			SubsystemCount	//!< The number of subsystems
+		};
+
+		/*!
+		 * \brief Charges a thread's allocations to a subsystem
+		 * while the Scope exists.
+		 */
+		class LIB_EXPORT Scope
+		{
+			public:
+				/*! Starts charging allocations to \a subsystem. */
+				explicit Scope(Subsystem subsystem);
+				/*! Restores the previous subsystem. */
+				~Scope();
+
+			private:
+				Subsystem m_previous;
+		};
+
+		/*! Returns true if allocation counting is compiled in. */
+		static bool isEnabled();
+		/*! Returns the name of \a subsystem. */
+		static const char* name(Subsystem subsystem);
+		/*! Returns the number of allocations in \a subsystem. */
+		static quint64 count(Subsystem subsystem);
+		/*! Returns the number of bytes allocated in \a subsystem. */
+		static quint64 bytes(Subsystem subsystem);
+
+		/*!
+		 * Records an allocation of \a size bytes.
+		 *
+		 * This function is called by the allocation hooks, so it
+		 * must not allocate memory itself.
+		 */
+		static void addAllocation(std::size_t size);
+
+	private:
+		AllocationStats();
+};
+
+#ifdef CUTECHESS_ALLOC_STATS
+#define ALLOCATION_SCOPE(subsystem) \
+	AllocationStats::Scope allocationScope(AllocationStats::subsystem)
+#else
+#define ALLOCATION_SCOPE(subsystem)
+#endif
+
+#endif // ALLOCATIONSTATS_H
@@ -0,0 +1,93 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bergertournament.h"
+
+BergerTournament::BergerTournament(GameManager* gameManager,
+				   QObject *parent)
+	: Tournament(gameManager, parent),
+	  m_tableRound(0),
+	  m_pairNumber(0),
+	  m_cycle(0)
+{
+}
+
+QString BergerTournament::type() const
+{
+	return "berger";
+}
+
+void BergerTournament::initializePairing()
+{
+	m_tableRound = 0;
+	m_pairNumber = 0;
+	m_cycle = 0;
+}
+
+int BergerTournament::gamesPerCycle() const
+{
+	return (playerCount() * (playerCount() - 1)) / 2;
+}
+
+QPair<int, int> BergerTournament::nextPair()
+{
+	// With an odd number of players the last table position
+	// is a "bye" player, and its opponent sits out the round
+	const int count = playerCount() + (playerCount() % 2);
+	const int rotation = count - 1;
+
+	if (m_pairNumber >= count / 2)
+	{
+		m_pairNumber = 0;
+		if (++m_tableRound >= rotation)
+		{
+			m_tableRound = 0;
+			m_cycle++;
+		}
+		setCurrentRound(currentRound() + 1);
+	}
+
+	// The last player meets a different opponent in each round,
+	// and the other pairs are placed symmetrically around that
+	// opponent in the table
+	const int opponent = (m_tableRound * (count / 2)) % rotation;
+	int white;
+	int black;
+	if (m_pairNumber == 0)
+	{
+		white = opponent;
+		black = count - 1;
+		if (m_tableRound % 2 == 1)
+			qSwap(white, black);
+	}
+	else
+	{
+		white = (opponent + m_pairNumber) % rotation;
+		black = (opponent - m_pairNumber + rotation) % rotation;
+	}
+
+	// Reverse the colors in every other cycle
+	if (m_cycle % 2 == 1)
+		qSwap(white, black);
+
+	m_pairNumber++;
+
+	if (white < playerCount() && black < playerCount())
+		return qMakePair(white, black);
+	else
+		return nextPair();
+}
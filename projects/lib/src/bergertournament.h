@@ -0,0 +1,54 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BERGERTOURNAMENT_H
+#define BERGERTOURNAMENT_H
+
+#include "tournament.h"
+
+/*!
+ * \brief Round-robin chess tournament with Berger tables.
+ *
+ * A Berger tournament is a round-robin tournament that follows the
+ * FIDE Berger tables, which give every player alternating colors
+ * as well as possible. The colors are reversed in every other
+ * cycle of rounds.
+ */
+class LIB_EXPORT BergerTournament : public Tournament
+{
+	Q_OBJECT
+
+	public:
+		/*! Creates a new Berger tournament. */
+		explicit BergerTournament(GameManager* gameManager,
+					  QObject *parent = 0);
+		// Inherited from Tournament
+		virtual QString type() const;
+
+	protected:
+		// Inherited from Tournament
+		virtual void initializePairing();
+		virtual int gamesPerCycle() const;
+		virtual QPair<int, int> nextPair();
+
+	private:
+		int m_tableRound;
+		int m_pairNumber;
+		int m_cycle;
+};
+
+#endif // BERGERTOURNAMENT_H
@@ -23,10 +23,11 @@
 namespace Chess {
 
 AtomicBoard::AtomicBoard()
-	: WesternBoard(new WesternZobrist())
+	: WesternBoard(WesternZobrist::shared("atomic"))
 {
 	for (int i = 0; i < 8; i++)
 		m_offsets[i] = 0;
+	m_arwidth = 0;
 }
 
 Board* AtomicBoard::copy() const
@@ -49,9 +50,15 @@ bool AtomicBoard::kingCanCapture() const
 	return false;
 }
 
+bool AtomicBoard::hasStandardLegality() const
+{
+	return false;
+}
+
 void AtomicBoard::vInitialize()
 {
 	int arwidth = width() + 2;
+	m_arwidth = arwidth;
 	m_offsets[0] = -arwidth - 1;
 	m_offsets[1] = -arwidth;
 	m_offsets[2] = -arwidth + 1;
@@ -66,24 +73,36 @@ void AtomicBoard::vInitialize()
 
 bool AtomicBoard::vSetFenString(const QStringList& fen)
 {
-	m_history.clear();
+	m_history.reserve(HistoryReserve);
+	m_history.resize(0);
 	return WesternBoard::vSetFenString(fen);
 }
 
-bool AtomicBoard::inCheck(Side side, int square) const
+bool AtomicBoard::isNeighbor(int square1, int square2) const
 {
-	if (square == 0)
-	{
-		int kingSq = kingSquare(side);
+	// The wall files keep squares on different board edges
+	// from looking adjacent.
+	int diff = qAbs(square1 - square2);
+	return diff == 1
+	    || (diff >= m_arwidth - 1 && diff <= m_arwidth + 1);
+}
 
-		// If the kings touch, there's no check
-		for (int i = 0; i < 8; i++)
-		{
-			Piece pc = pieceAt(kingSq + m_offsets[i]);
-			if (pc.type() == King)
-				return false;
-		}
-	}
+bool AtomicBoard::kingsTouch() const
+{
+	int whiteKing = kingSquare(Side::White);
+	int blackKing = kingSquare(Side::Black);
+
+	// A king square isn't updated when the king explodes
+	return pieceAt(whiteKing) == Piece(Side::White, King)
+	    && pieceAt(blackKing) == Piece(Side::Black, King)
+	    && isNeighbor(whiteKing, blackKing);
+}
+
+bool AtomicBoard::inCheck(Side side, int square) const
+{
+	// If the kings touch, there's no check
+	if (square == 0 && kingsTouch())
+		return false;
 
 	return WesternBoard::inCheck(side, square);
 }
@@ -94,22 +113,19 @@ bool AtomicBoard::vIsLegalMove(const Move& move)
 
 	if (captureType(move) != Piece::NoPiece)
 	{
-		bool explodeOppKing = false;
+		Side side(sideToMove());
 		int target = move.targetSquare();
-		for (int i = 0; i < 8; i++)
-		{
-			Piece pc = pieceAt(target + m_offsets[i]);
-			if (pc.type() == King)
-			{
-				// Can't explode your own king
-				if (pc.side() == sideToMove())
-					return false;
-				explodeOppKing = true;
-			}
-		}
+
+		// Can't explode your own king
+		int ownKing = kingSquare(side);
+		if (isNeighbor(target, ownKing))
+			return false;
+
 		// The move is always legal if the enemy king
 		// is in the blast zone and own king is safe
-		if (explodeOppKing)
+		int oppKing = kingSquare(side.opposite());
+		if (isNeighbor(target, oppKing)
+		&&  pieceAt(oppKing) == Piece(side.opposite(), King))
 			return true;
 	}
 
@@ -47,6 +47,7 @@ class LIB_EXPORT AtomicBoard : public WesternBoard
 		virtual void vInitialize();
 		virtual bool inCheck(Side side, int square = 0) const;
 		virtual bool kingCanCapture() const;
+		virtual bool hasStandardLegality() const;
 		virtual bool vSetFenString(const QStringList& fen);
 		virtual bool vIsLegalMove(const Move& move);
 		virtual void vMakeMove(const Move& move,
@@ -61,8 +62,12 @@ class LIB_EXPORT AtomicBoard : public WesternBoard
 			Piece captures[8];
 		};
 
+		bool isNeighbor(int square1, int square2) const;
+		bool kingsTouch() const;
+
 		QVector<MoveData> m_history;
 		int m_offsets[8];
+		int m_arwidth;
 };
 
 } // namespace Chess
@@ -0,0 +1,105 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "bitboard.h"
+
+namespace Chess {
+
+int Bitboard::s_fromMailbox[120];
+int Bitboard::s_toMailbox[64];
+quint64 Bitboard::s_knightAttacks[64];
+quint64 Bitboard::s_kingAttacks[64];
+quint64 Bitboard::s_pawnAttacks[2][64];
+quint64 Bitboard::s_rays[8][64];
+bool Bitboard::s_initialized = Bitboard::initialize();
+
+static quint64 stepBit(int file, int rank)
+{
+	if (file < 0 || file >= 8 || rank < 0 || rank >= 8)
+		return 0;
+	return Bitboard::squareBit(rank * 8 + file);
+}
+
+bool Bitboard::initialize()
+{
+	static const int knightSteps[8][2] =
+	{
+		{ 1, 2 }, { 2, 1 }, { 2, -1 }, { 1, -2 },
+		{ -1, -2 }, { -2, -1 }, { -2, 1 }, { -1, 2 }
+	};
+	static const int kingSteps[8][2] =
+	{
+		{ 0, 1 }, { 1, 1 }, { 1, 0 }, { 1, -1 },
+		{ 0, -1 }, { -1, -1 }, { -1, 0 }, { -1, 1 }
+	};
+	// File and rank steps in the same order as enum Direction
+	static const int raySteps[8][2] =
+	{
+		{ 0, 1 }, { 1, 0 }, { 1, 1 }, { -1, 1 },
+		{ 0, -1 }, { -1, 0 }, { 1, -1 }, { -1, -1 }
+	};
+
+	for (int i = 0; i < 120; i++)
+		s_fromMailbox[i] = -1;
+
+	for (int sq = 0; sq < 64; sq++)
+	{
+		int file = sq % 8;
+		int rank = sq / 8;
+
+		// The first two rows of the mailbox array are wall squares,
+		// and rank 8 comes first.
+		int index = (9 - rank) * 10 + 1 + file;
+		s_toMailbox[sq] = index;
+		s_fromMailbox[index] = sq;
+
+		s_knightAttacks[sq] = 0;
+		s_kingAttacks[sq] = 0;
+		for (int i = 0; i < 8; i++)
+		{
+			s_knightAttacks[sq] |= stepBit(file + knightSteps[i][0],
+						       rank + knightSteps[i][1]);
+			s_kingAttacks[sq] |= stepBit(file + kingSteps[i][0],
+						     rank + kingSteps[i][1]);
+		}
+
+		s_pawnAttacks[Side::White][sq] = stepBit(file - 1, rank + 1)
+					       | stepBit(file + 1, rank + 1);
+		s_pawnAttacks[Side::Black][sq] = stepBit(file - 1, rank - 1)
+					       | stepBit(file + 1, rank - 1);
+
+		for (int dir = 0; dir < 8; dir++)
+		{
+			quint64 ray = 0;
+			int f = file + raySteps[dir][0];
+			int r = rank + raySteps[dir][1];
+			quint64 bit;
+			while ((bit = stepBit(f, r)) != 0)
+			{
+				ray |= bit;
+				f += raySteps[dir][0];
+				r += raySteps[dir][1];
+			}
+			s_rays[dir][sq] = ray;
+		}
+	}
+
+	return true;
+}
+
+} // namespace Chess
@@ -0,0 +1,222 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <QtGlobal>
+#include "side.h"
+
+namespace Chess {
+
+/*!
+ * \brief Attack tables and bit operations for 8x8 bitboards.
+ *
+ * A bitboard is an unsigned 64-bit integer where each bit represents
+ * a square on a traditional 8x8 chessboard. Bit 0 is square a1, bit 7
+ * is h1 and bit 63 is h8.
+ *
+ * Chess::Board keeps a bitboard copy of the position for 8x8 variants,
+ * which speeds up piece iteration and attack detection compared to
+ * scanning the mailbox array.
+ *
+ * \note The mailbox functions assume the 10x12 array layout used
+ * by Chess::Board for 8x8 boards.
+ */
+class LIB_EXPORT Bitboard
+{
+	public:
+		/*! Returns a bitboard with only \a square set. */
+		static quint64 squareBit(int square);
+		/*! Returns the index of the least significant set bit. */
+		static int lsb(quint64 bits);
+		/*! Returns the index of the most significant set bit. */
+		static int msb(quint64 bits);
+		/*! Clears the least significant set bit and returns its index. */
+		static int popLsb(quint64& bits);
+		/*! Returns the number of set bits in \a bits. */
+		static int popCount(quint64 bits);
+
+		/*!
+		 * Converts a 10x12 mailbox index into a bitboard square.
+		 * Returns -1 if \a index is a wall square.
+		 */
+		static int fromMailbox(int index);
+		/*! Converts bitboard square \a square into a 10x12 mailbox index. */
+		static int toMailbox(int square);
+
+		/*! Returns the squares attacked by a knight on \a square. */
+		static quint64 knightAttacks(int square);
+		/*! Returns the squares attacked by a king on \a square. */
+		static quint64 kingAttacks(int square);
+		/*! Returns the squares attacked by a pawn of \a side on \a square. */
+		static quint64 pawnAttacks(Side side, int square);
+		/*!
+		 * Returns the squares attacked by a bishop on \a square when
+		 * the squares in \a occupied are occupied.
+		 */
+		static quint64 bishopAttacks(int square, quint64 occupied);
+		/*!
+		 * Returns the squares attacked by a rook on \a square when
+		 * the squares in \a occupied are occupied.
+		 */
+		static quint64 rookAttacks(int square, quint64 occupied);
+
+	private:
+		enum Direction
+		{
+			North,
+			East,
+			NorthEast,
+			NorthWest,
+			South,
+			West,
+			SouthEast,
+			SouthWest
+		};
+
+		Bitboard();
+
+		static bool initialize();
+		static quint64 rayAttacks(int square,
+					  quint64 occupied,
+					  Direction direction);
+
+		static bool s_initialized;
+		static int s_fromMailbox[120];
+		static int s_toMailbox[64];
+		static quint64 s_knightAttacks[64];
+		static quint64 s_kingAttacks[64];
+		static quint64 s_pawnAttacks[2][64];
+		static quint64 s_rays[8][64];
+};
+
+
+inline quint64 Bitboard::squareBit(int square)
+{
+	return Q_UINT64_C(1) << square;
+}
+
+inline int Bitboard::lsb(quint64 bits)
+{
+	Q_ASSERT(bits != 0);
+#ifdef Q_CC_GNU
+	return __builtin_ctzll(bits);
+#else
+	int square = 0;
+	while (!(bits & 1))
+	{
+		bits >>= 1;
+		square++;
+	}
+	return square;
+#endif
+}
+
+inline int Bitboard::msb(quint64 bits)
+{
+	Q_ASSERT(bits != 0);
+#ifdef Q_CC_GNU
+	return 63 - __builtin_clzll(bits);
+#else
+	int square = 0;
+	while (bits >>= 1)
+		square++;
+	return square;
+#endif
+}
+
+inline int Bitboard::popLsb(quint64& bits)
+{
+	int square = lsb(bits);
+	bits &= bits - 1;
+	return square;
+}
+
+inline int Bitboard::popCount(quint64 bits)
+{
+#ifdef Q_CC_GNU
+	return __builtin_popcountll(bits);
+#else
+	int count = 0;
+	for (; bits != 0; count++)
+		bits &= bits - 1;
+	return count;
+#endif
+}
+
+inline int Bitboard::fromMailbox(int index)
+{
+	Q_ASSERT(index >= 0 && index < 120);
+	return s_fromMailbox[index];
+}
+
+inline int Bitboard::toMailbox(int square)
+{
+	Q_ASSERT(square >= 0 && square < 64);
+	return s_toMailbox[square];
+}
+
+inline quint64 Bitboard::knightAttacks(int square)
+{
+	return s_knightAttacks[square];
+}
+
+inline quint64 Bitboard::kingAttacks(int square)
+{
+	return s_kingAttacks[square];
+}
+
+inline quint64 Bitboard::pawnAttacks(Side side, int square)
+{
+	Q_ASSERT(!side.isNull());
+	return s_pawnAttacks[side][square];
+}
+
+inline quint64 Bitboard::rayAttacks(int square,
+				    quint64 occupied,
+				    Direction direction)
+{
+	quint64 attacks = s_rays[direction][square];
+	quint64 blockers = attacks & occupied;
+	if (blockers == 0)
+		return attacks;
+
+	// The first four directions point towards higher bit indexes
+	int blocker = (direction < South) ? lsb(blockers) : msb(blockers);
+	return attacks ^ s_rays[direction][blocker];
+}
+
+inline quint64 Bitboard::bishopAttacks(int square, quint64 occupied)
+{
+	return rayAttacks(square, occupied, NorthEast)
+	     | rayAttacks(square, occupied, NorthWest)
+	     | rayAttacks(square, occupied, SouthEast)
+	     | rayAttacks(square, occupied, SouthWest);
+}
+
+inline quint64 Bitboard::rookAttacks(int square, quint64 occupied)
+{
+	return rayAttacks(square, occupied, North)
+	     | rayAttacks(square, occupied, East)
+	     | rayAttacks(square, occupied, South)
+	     | rayAttacks(square, occupied, West);
+}
+
+} // namespace Chess
+#endif // BITBOARD_H
@@ -17,6 +17,9 @@
 
 #include "board.h"
 #include <QStringList>
+#include <allocationstats.h>
+#include <mersenne.h>
+#include <randomgenerator.h>
 #include "zobrist.h"
 
 
@@ -51,19 +54,32 @@ QDebug operator<<(QDebug dbg, const Board* board)
 }
 
 
-Board::Board(Zobrist* zobrist)
+Board::Board(const QSharedPointer<Zobrist>& zobrist)
 	: m_initialized(false),
+	  m_hasBitboards(false),
+	  m_hasWideBitboards(false),
 	  m_width(0),
 	  m_height(0),
 	  m_side(Side::White),
 	  m_startingSide(Side::White),
 	  m_key(0),
-	  m_zobrist(zobrist),
-	  m_sharedZobrist(zobrist)
+	  m_pieceCount(0),
+	  m_materialKey(0),
+	  m_zobrist(zobrist.data()),
+	  m_sharedZobrist(zobrist),
+	  m_random(0),
+	  m_fenCacheNotation(-1),
+	  m_fenCacheKey(0),
+	  m_fenCachePly(0),
+	  m_fenCacheReversible(0),
+	  m_legalMoveCacheValid(false),
+	  m_legalMoveCacheKey(0),
+	  m_legalMoveCachePly(0)
 {
-	Q_ASSERT(zobrist != 0);
+	Q_ASSERT(!zobrist.isNull());
 
 	setPieceType(Piece::NoPiece, QString(), QString());
+	clearBitboards();
 }
 
 Board::~Board()
@@ -112,11 +128,102 @@ void Board::initialize()
 	m_height = height();
 	for (int i = 0; i < (m_width + 2) * (m_height + 4); i++)
 		m_squares.append(Piece::WallPiece);
+	m_hasBitboards = (m_width == 8 && m_height == 8);
+	m_hasWideBitboards = (m_width == 10 && m_height == 8);
+	m_typeBits.resize(m_pieceData.size());
+	m_wideTypeBits.resize(m_hasWideBitboards ? m_pieceData.size() : 0);
+	m_pieceCounts[Side::White].resize(m_pieceData.size());
+	m_pieceCounts[Side::Black].resize(m_pieceData.size());
+	clearBitboards();
+	clearMaterial();
+
 	vInitialize();
 
+	// The names of the squares in the board array, in slots of
+	// four bytes: up to three characters and their count
+	int arraySize = (m_width + 2) * (m_height + 4);
+	m_squareNames.fill('\0', arraySize * 4);
+	for (int i = 0; i < arraySize; i++)
+	{
+		Square square(chessSquare(i));
+		if (!isValidSquare(square))
+			continue;
+
+		QByteArray name(squareString(square).toLatin1());
+		Q_ASSERT(name.size() <= 3);
+		char* slot = m_squareNames.data() + i * 4;
+		for (int j = 0; j < name.size(); j++)
+			slot[j] = name.at(j);
+		slot[3] = char(name.size());
+	}
+
 	m_zobrist->initialize((m_width + 2) * (m_height + 4), m_pieceData.size());
 }
 
+void Board::clearBitboards()
+{
+	m_sideBits[Side::White] = 0;
+	m_sideBits[Side::Black] = 0;
+	for (int i = 0; i < m_typeBits.size(); i++)
+		m_typeBits[i] = 0;
+	m_wideSideBits[Side::White] = WideBitboard();
+	m_wideSideBits[Side::Black] = WideBitboard();
+	for (int i = 0; i < m_wideTypeBits.size(); i++)
+		m_wideTypeBits[i] = WideBitboard();
+}
+
+void Board::clearMaterial()
+{
+	for (int side = Side::White; side <= Side::Black; side++)
+	{
+		for (int i = 0; i < m_pieceCounts[side].size(); i++)
+			m_pieceCounts[side][i] = 0;
+	}
+	m_pieceCount = 0;
+	m_materialKey = 0;
+}
+
+quint64 Board::materialHash(Piece piece, int count)
+{
+	// A SplitMix64 finalizer gives every (side, type, count) triple
+	// its own pseudo-random key without a key table
+	quint64 x = (quint64(piece.side()) << 48)
+		  | (quint64(piece.type()) << 16)
+		  | quint64(count);
+	x += Q_UINT64_C(0x9E3779B97F4A7C15);
+	x = (x ^ (x >> 30)) * Q_UINT64_C(0xBF58476D1CE4E5B9);
+	x = (x ^ (x >> 27)) * Q_UINT64_C(0x94D049BB133111EB);
+	return x ^ (x >> 31);
+}
+
+quint64 Board::movementBitboard(Side side, unsigned movement) const
+{
+	Q_ASSERT(m_hasBitboards);
+
+	quint64 bits = 0;
+	for (int i = 1; i < m_typeBits.size(); i++)
+	{
+		if (m_pieceData[i].movement & movement)
+			bits |= m_typeBits[i];
+	}
+
+	return bits & m_sideBits[side];
+}
+
+WideBitboard Board::wideMovementBitboard(Side side, unsigned movement) const
+{
+	Q_ASSERT(m_hasWideBitboards);
+
+	WideBitboard bits;
+	for (int i = 1; i < m_wideTypeBits.size(); i++)
+	{
+		if (m_pieceData[i].movement & movement)
+			bits |= m_wideTypeBits[i];
+	}
+
+	return bits & m_wideSideBits[side];
+}
+
 void Board::setPieceType(int type,
 			 const QString& name,
 			 const QString& symbol,
@@ -236,6 +343,12 @@ bool Board::isValidSquare(const Chess::Square& square) const
 
 QString Board::squareString(int index) const
 {
+	if (index >= 0 && index * 4 < m_squareNames.size())
+	{
+		const char* slot = m_squareNames.constData() + index * 4;
+		if (slot[3] != 0)
+			return QString::fromLatin1(slot, int(slot[3]));
+	}
 	return squareString(chessSquare(index));
 }
 
@@ -291,76 +404,163 @@ int Board::squareIndex(const QString& str) const
 	return squareIndex(chessSquare(str));
 }
 
-QString Board::lanMoveString(const Move& move)
+void Board::appendSquare(QByteArray& out, int index) const
 {
-	QString str;
+	Q_ASSERT(index >= 0 && index * 4 < m_squareNames.size());
+
+	const char* slot = m_squareNames.constData() + index * 4;
+	out.append(slot, int(slot[3]));
+}
+
+void Board::appendLanMove(QByteArray& out, const Move& move)
+{
+	Move lan(lanMove(move));
 
 	// Piece drop
-	if (move.sourceSquare() == 0)
+	if (lan.sourceSquare() == 0)
 	{
-		Q_ASSERT(move.promotion() != Piece::NoPiece);
-		str += pieceSymbol(move.promotion()).toUpper() + '@';
-		str += squareString(move.targetSquare());
-		return str;
+		Q_ASSERT(lan.promotion() != Piece::NoPiece);
+		out += pieceSymbol(lan.promotion()).toUpper().toLatin1();
+		out += '@';
+		appendSquare(out, lan.targetSquare());
+		return;
 	}
 
-	str += squareString(move.sourceSquare());
-	str += squareString(move.targetSquare());
-	if (move.promotion() != Piece::NoPiece)
-		str += pieceSymbol(move.promotion()).toLower();
+	appendSquare(out, lan.sourceSquare());
+	appendSquare(out, lan.targetSquare());
+	if (lan.promotion() != Piece::NoPiece)
+		out += pieceSymbol(lan.promotion()).toLower().toLatin1();
+}
 
-	return str;
+QString Board::lanMoveString(const Move& move)
+{
+	QByteArray str;
+	appendLanMove(str, move);
+	return QString::fromLatin1(str.constData(), str.size());
+}
+
+Move Board::lanMove(const Move& move)
+{
+	return move;
+}
+
+Move Board::moveFromLanMove(const Move& move)
+{
+	return move;
 }
 
 QString Board::moveString(const Move& move, MoveNotation notation)
 {
-	if (notation == StandardAlgebraic)
-		return sanMoveString(move);
-	return lanMoveString(move);
+	ALLOCATION_SCOPE(Board);
+
+	if (notation == LongAlgebraic)
+		return lanMoveString(move);
+
+	QString str(sanMoveString(move));
+	makeMove(move);
+	str += sanCheckSuffix();
+	undoMove();
+
+	return str;
+}
+
+QString Board::makeSanMove(const Move& move, BoardTransition* transition)
+{
+	QString str(sanMoveString(move));
+	makeMove(move, transition);
+	str += sanCheckSuffix();
+
+	return str;
 }
 
-Move Board::moveFromLanString(const QString& str)
+QString Board::sanCheckSuffix()
+{
+	return QString();
+}
+
+int Board::parseSquare(const QStringRef& str, int* pos) const
+{
+	// A square is a letter and a number, or a number and a letter,
+	// depending on the coordinate system
+	int i = *pos;
+	int len = str.length();
+	int letter = -1;
+	int number = 0;
+	int digits = 0;
+	bool letterFirst = (coordinateSystem() == NormalCoordinates);
+
+	if (letterFirst && i < len)
+		letter = str.at(i++).unicode() - 'a';
+	while (i < len && digits < 2 && str.at(i).isDigit())
+	{
+		number = number * 10 + (str.at(i++).unicode() - '0');
+		digits++;
+	}
+	if (!letterFirst && i < len)
+		letter = str.at(i++).unicode() - 'a';
+	if (digits == 0 || letter < 0)
+		return 0;
+
+	Square square;
+	if (letterFirst)
+		square = Square(letter, number - 1);
+	else
+		square = Square(m_width - number, m_height - letter - 1);
+	if (!isValidSquare(square))
+		return 0;
+
+	*pos = i;
+	return squareIndex(square);
+}
+
+Move Board::parseLanMove(const QStringRef& str)
 {
 	int len = str.length();
 	if (len < 4)
 		return Move();
 
 	Piece promotion;
+	int pos = 0;
 
 	int drop = str.indexOf('@');
 	if (drop > 0)
 	{
-		promotion = pieceFromSymbol(str.left(drop));
+		promotion = pieceFromSymbol(str.left(drop).toString());
 		if (!promotion.isValid())
 			return Move();
-		
-		Square trg(chessSquare(str.mid(drop + 1)));
-		if (!isValidSquare(trg))
+
+		pos = drop + 1;
+		int target = parseSquare(str, &pos);
+		if (target == 0)
 			return Move();
-		
-		return Move(0, squareIndex(trg), promotion.type());
+
+		return Move(0, target, promotion.type());
 	}
 
-	Square sourceSq(chessSquare(str.mid(0, 2)));
-	Square targetSq(chessSquare(str.mid(2, 2)));
-	if (!isValidSquare(sourceSq) || !isValidSquare(targetSq))
+	int source = parseSquare(str, &pos);
+	int target = parseSquare(str, &pos);
+	if (source == 0 || target == 0)
 		return Move();
 
-	if (len > 4)
+	if (pos < len)
 	{
-		promotion = pieceFromSymbol(str.mid(len-1));
+		promotion = pieceFromSymbol(QString(str.at(len - 1)));
 		if (!promotion.isValid())
 			return Move();
 	}
 
-	int source = squareIndex(sourceSq);
-	int target = squareIndex(targetSq);
+	return moveFromLanMove(Move(source, target, promotion.type()));
+}
 
-	return Move(source, target, promotion.type());
+Move Board::moveFromLanString(const QString& str)
+{
+	return parseLanMove(QStringRef(&str));
 }
 
 Move Board::moveFromString(const QString& str)
 {
+	ALLOCATION_SCOPE(Board);
+
 	Move move = moveFromSanString(str);
 	if (move.isNull())
 	{
@@ -390,8 +590,33 @@ GenericMove Board::genericMove(const Move& move) const
 }
 
 QString Board::fenString(FenNotation notation) const
+{
+	ALLOCATION_SCOPE(Board);
+
+	// Legality checks make and undo moves all the time, so the
+	// cache is tied to the position's key instead of being reset
+	// on every move. The key doesn't include the halfmove clock,
+	// which can differ for the same position at the same ply.
+	const int reversible = reversibleMoveCount();
+	if (m_fenCacheNotation != notation
+	||  m_fenCacheKey != m_key
+	||  m_fenCachePly != m_moveHistory.size()
+	||  m_fenCacheReversible != reversible)
+	{
+		m_fenCache = buildFenString(notation);
+		m_fenCacheNotation = notation;
+		m_fenCacheKey = m_key;
+		m_fenCachePly = m_moveHistory.size();
+		m_fenCacheReversible = reversible;
+	}
+
+	return m_fenCache;
+}
+
+QString Board::buildFenString(FenNotation notation) const
 {
 	QString fen;
+	fen.reserve(m_width * m_height + 32);
 
 	// Squares
 	int i = (m_width + 2) * 2;
@@ -413,7 +638,10 @@ QString Board::fenString(FenNotation notation) const
 			if (nempty > 0
 			&&  (!pc.isEmpty() || x == m_width - 1))
 			{
-				fen += QString::number(nempty);
+				if (nempty < 10)
+					fen += QChar('0' + nempty);
+				else
+					fen += QString::number(nempty);
 				nempty = 0;
 			}
 
@@ -425,7 +653,9 @@ QString Board::fenString(FenNotation notation) const
 	}
 
 	// Side to move
-	fen += QString(" %1 ").arg(m_side.symbol());
+	fen += ' ';
+	fen += m_side.symbol();
+	fen += ' ';
 
 	// Hand pieces
 	if (variantHasDrops())
@@ -447,14 +677,20 @@ QString Board::fenString(FenNotation notation) const
 		}
 		if (str.isEmpty())
 			str = "-";
-		fen += str + " ";
+		fen += str;
+		fen += ' ';
 	}
 
-	return fen + vFenString(notation);
+	fen += vFenString(notation);
+	return fen;
 }
 
 bool Board::setFenString(const QString& fen)
 {
+	ALLOCATION_SCOPE(Board);
+
+	m_fenCacheNotation = -1;
+	m_legalMoveCacheValid = false;
 	QStringList strList = fen.split(' ');
 	if (strList.isEmpty())
 		return false;
@@ -472,6 +708,8 @@ bool Board::setFenString(const QString& fen)
 
 	for (int i = 0; i < m_squares.size(); i++)
 		m_squares[i] = Piece::WallPiece;
+	clearBitboards();
+	clearMaterial();
 	m_key = 0;
 
 	// Get the board contents (squares)
@@ -504,7 +742,8 @@ bool Board::setFenString(const QString& fen)
 			int nempty;
 			if (i < (token->length() - 1) && token->at(i + 1).isDigit())
 			{
-				nempty = token->mid(i, 2).toInt();
+				nempty = c.digitValue() * 10
+				       + token->at(i + 1).digitValue();
 				i++;
 			}
 			else
@@ -573,7 +812,9 @@ bool Board::setFenString(const QString& fen)
 		}
 	}
 
-	m_moveHistory.clear();
+	// Unlike clear(), resizing keeps the reserved storage
+	m_moveHistory.reserve(HistoryReserve);
+	m_moveHistory.resize(0);
 	m_startingFen = fen;
 
 	// Let subclasses handle the rest of the FEN string
@@ -597,8 +838,22 @@ void Board::reset()
 	setFenString(defaultFenString());
 }
 
+void Board::setRandomGenerator(RandomGenerator* generator)
+{
+	m_random = generator;
+}
+
+quint32 Board::randomNumber() const
+{
+	if (m_random != 0)
+		return m_random->random();
+	return Mersenne::random();
+}
+
 void Board::makeMove(const Move& move, BoardTransition* transition)
 {
+	ALLOCATION_SCOPE(Board);
+
 	Q_ASSERT(!m_side.isNull());
 	Q_ASSERT(!move.isNull());
 
@@ -613,6 +868,8 @@ void Board::makeMove(const Move& move, BoardTransition* transition)
 
 void Board::undoMove()
 {
+	ALLOCATION_SCOPE(Board);
+
 	Q_ASSERT(!m_moveHistory.isEmpty());
 	Q_ASSERT(!m_side.isNull());
 
@@ -627,12 +884,55 @@ void Board::generateMoves(QVarLengthArray<Move>& moves, int pieceType) const
 {
 	Q_ASSERT(!m_side.isNull());
 
+	moves.clear();
+	if (m_hasBitboards)
+	{
+		quint64 pieces = m_sideBits[m_side];
+		if (pieceType != Piece::NoPiece)
+			pieces &= typeBitboard(pieceType);
+
+		// Go through the ranks from top to bottom to generate
+		// the moves in the same order as the square array does.
+		for (int rank = 7; rank >= 0 && pieces != 0; rank--)
+		{
+			quint64 rankPieces = pieces & (Q_UINT64_C(0xFF) << (rank * 8));
+			pieces ^= rankPieces;
+			while (rankPieces != 0)
+			{
+				int sq = Bitboard::toMailbox(Bitboard::popLsb(rankPieces));
+				generateMovesForPiece(moves, m_squares[sq].type(), sq);
+			}
+		}
+
+		generateDropMoves(moves, pieceType);
+		return;
+	}
+	if (m_hasWideBitboards)
+	{
+		WideBitboard pieces(m_wideSideBits[m_side]);
+		if (pieceType != Piece::NoPiece)
+			pieces &= wideTypeBitboard(pieceType);
+
+		for (int rank = 7; rank >= 0 && !pieces.isEmpty(); rank--)
+		{
+			WideBitboard rankPieces(pieces & WideBitboard::rankMask(rank));
+			pieces ^= rankPieces;
+			while (!rankPieces.isEmpty())
+			{
+				int sq = WideBitboard::toMailbox(rankPieces.popLsb());
+				generateMovesForPiece(moves, m_squares[sq].type(), sq);
+			}
+		}
+
+		generateDropMoves(moves, pieceType);
+		return;
+	}
+
 	// Cut the wall squares (the ones with a value of WallPiece) off
 	// from the squares to iterate over. It bumps the speed up a bit.
 	unsigned begin = (m_width + 2) * 2;
 	unsigned end = m_squares.size() - begin;
 
-	moves.clear();
 	for (unsigned sq = begin; sq < end; sq++)
 	{
 		Piece tmp = m_squares[sq];
@@ -663,6 +963,58 @@ void Board::generateDropMoves(QVarLengthArray<Move>& moves, int pieceType) const
 		generateMovesForPiece(moves, pieceType, 0);
 }
 
+void Board::generateCaptureMoves(QVarLengthArray<Move>& moves) const
+{
+	Q_ASSERT(!m_side.isNull());
+
+	// Piece drops are never captures
+	moves.clear();
+	if (m_hasBitboards)
+	{
+		quint64 pieces = m_sideBits[m_side];
+		while (pieces != 0)
+		{
+			int sq = Bitboard::toMailbox(Bitboard::popLsb(pieces));
+			generateCapturesForPiece(moves, m_squares[sq].type(), sq);
+		}
+		return;
+	}
+	if (m_hasWideBitboards)
+	{
+		WideBitboard pieces(m_wideSideBits[m_side]);
+		while (!pieces.isEmpty())
+		{
+			int sq = WideBitboard::toMailbox(pieces.popLsb());
+			generateCapturesForPiece(moves, m_squares[sq].type(), sq);
+		}
+		return;
+	}
+
+	unsigned begin = (m_width + 2) * 2;
+	unsigned end = m_squares.size() - begin;
+
+	for (unsigned sq = begin; sq < end; sq++)
+	{
+		Piece tmp = m_squares[sq];
+		if (tmp.side() == m_side)
+			generateCapturesForPiece(moves, tmp.type(), sq);
+	}
+}
+
+void Board::generateCapturesForPiece(QVarLengthArray<Move>& moves,
+				     int pieceType,
+				     int square) const
+{
+	QVarLengthArray<Move> pieceMoves;
+	generateMovesForPiece(pieceMoves, pieceType, square);
+
+	for (int i = 0; i < pieceMoves.size(); i++)
+	{
+		if (captureType(pieceMoves[i]) != Piece::NoPiece)
+			moves.append(pieceMoves[i]);
+	}
+}
+
 void Board::generateHoppingMoves(int sourceSquare,
 				 const QVarLengthArray<int>& offsets,
 				 QVarLengthArray<Move>& moves) const
@@ -698,6 +1050,36 @@ void Board::generateSlidingMoves(int sourceSquare,
 	}
 }
 
+void Board::generateHoppingCaptures(int sourceSquare,
+				    const QVarLengthArray<int>& offsets,
+				    QVarLengthArray<Move>& moves) const
+{
+	Side opSide = sideToMove().opposite();
+	for (int i = 0; i < offsets.size(); i++)
+	{
+		int targetSquare = sourceSquare + offsets[i];
+		if (pieceAt(targetSquare).side() == opSide)
+			moves.append(Move(sourceSquare, targetSquare));
+	}
+}
+
+void Board::generateSlidingCaptures(int sourceSquare,
+				    const QVarLengthArray<int>& offsets,
+				    QVarLengthArray<Move>& moves) const
+{
+	Side opSide = sideToMove().opposite();
+	for (int i = 0; i < offsets.size(); i++)
+	{
+		int offset = offsets[i];
+		int targetSquare = sourceSquare + offset;
+		Piece capture;
+		while ((capture = pieceAt(targetSquare)).isEmpty())
+			targetSquare += offset;
+		if (capture.side() == opSide)
+			moves.append(Move(sourceSquare, targetSquare));
+	}
+}
+
 bool Board::moveExists(const Move& move) const
 {
 	Q_ASSERT(!move.isNull());
@@ -744,9 +1126,52 @@ bool Board::vIsLegalMove(const Move& move)
 	return isLegal;
 }
 
+bool Board::hasLegalMoveCache() const
+{
+	// Like the FEN cache, the legal moves are tied to the
+	// position's key so that make/undo pairs don't reset them
+	return m_legalMoveCacheValid
+	    && m_legalMoveCacheKey == m_key
+	    && m_legalMoveCachePly == m_moveHistory.size();
+}
+
 bool Board::isLegalMove(const Move& move)
 {
-	return !move.isNull() && moveExists(move) && vIsLegalMove(move);
+	ALLOCATION_SCOPE(Board);
+
+	if (move.isNull())
+		return false;
+	if (hasLegalMoveCache())
+	{
+		for (int i = 0; i < m_legalMoveCache.size(); i++)
+		{
+			if (m_legalMoveCache[i] == move)
+				return true;
+		}
+		return false;
+	}
+
+	return moveExists(move) && vIsLegalMove(move);
+}
+
+bool Board::isLegalGeneratedMove(const Move& move)
+{
+	Q_ASSERT(!move.isNull());
+
+	if (!hasLegalMoveCache())
+		return vIsLegalMove(move);
+
+	for (int i = 0; i < m_legalMoveCache.size(); i++)
+	{
+		if (m_legalMoveCache[i] == move)
+			return true;
+	}
+	return false;
+}
+
+int Board::reversibleMoveCount() const
+{
+	return plyCount();
 }
 
 int Board::repeatCount() const
@@ -754,8 +1179,12 @@ int Board::repeatCount() const
 	if (plyCount() < 4)
 		return 0;
 
+	// The zobrist key includes the side to move, so only every
+	// other position needs to be compared. Positions before the
+	// last irreversible move can't match the current one.
+	int first = qMax(0, plyCount() - reversibleMoveCount());
 	int repeatCount = 0;
-	for (int i = plyCount() - 1; i >= 0; i--)
+	for (int i = plyCount() - 2; i >= first; i -= 2)
 	{
 		if (m_moveHistory.at(i).key == m_key)
 			repeatCount++;
@@ -777,33 +1206,63 @@ bool Board::isRepetition(const Chess::Move& move)
 
 bool Board::canMove()
 {
-	QVarLengthArray<Move> moves;
-	generateMoves(moves);
-
-	for (int i = 0; i < moves.size(); i++)
+	if (!hasLegalMoveCache())
 	{
-		if (vIsLegalMove(moves[i]))
-			return true;
+		QVarLengthArray<Move> moves;
+		legalMoves(moves);
 	}
 
-	return false;
+	return !m_legalMoveCache.isEmpty();
 }
 
 QVector<Move> Board::legalMoves()
 {
 	QVarLengthArray<Move> moves;
-	QVector<Move> legalMoves;
+	legalMoves(moves);
+
+	QVector<Move> legalMoves(moves.size());
+	for (int i = 0; i < moves.size(); i++)
+		legalMoves[i] = moves[i];
+
+	return legalMoves;
+}
+
+void Board::legalMoves(QVarLengthArray<Move>& moves)
+{
+	ALLOCATION_SCOPE(Board);
+
+	if (hasLegalMoveCache())
+	{
+		moves = m_legalMoveCache;
+		return;
+	}
 
 	generateMoves(moves);
-	legalMoves.reserve(moves.size());
 
-	for (int i = moves.size() - 1; i >= 0; i--)
+	// Filter out the illegal moves in place. The moves are
+	// validated and returned in reverse order of generation.
+	int size = moves.size();
+	int count = 0;
+	for (int i = size - 1; i >= 0; i--)
 	{
 		if (vIsLegalMove(moves[i]))
-			legalMoves << moves[i];
+			moves[size - ++count] = moves[i];
 	}
 
-	return legalMoves;
+	// Move the legal moves from the end of the array to the beginning
+	int first = size - count;
+	for (int i = 0; i < count / 2; i++)
+		qSwap(moves[first + i], moves[size - 1 - i]);
+	for (int i = 0; i < count; i++)
+		moves[i] = moves[first + i];
+	moves.resize(count);
+
+	// The legality checks above make moves, so the cache is only
+	// updated when they're done
+	m_legalMoveCache = moves;
+	m_legalMoveCacheValid = true;
+	m_legalMoveCacheKey = m_key;
+	m_legalMoveCachePly = m_moveHistory.size();
 }
 
 Result Board::tablebaseResult(unsigned int* dtm) const
@@ -29,8 +29,12 @@
 #include "move.h"
 #include "genericmove.h"
 #include "zobrist.h"
+#include "bitboard.h"
+#include "widebitboard.h"
+#include "moveiterator.h"
 #include "result.h"
 class QStringList;
+class RandomGenerator;
 
 
 namespace Chess {
@@ -52,6 +56,10 @@ class BoardTransition;
  * The board representation is (width + 2) x (height + 4), so a
  * traditional 8x8 board would be 10x12, and stored in a one-dimensional
  * vector with 10 * 12 = 120 elements.
+ *
+ * 8x8 boards also keep a bitboard copy of the position which is
+ * updated by setSquare(). It's used for piece iteration and attack
+ * detection. 10x8 boards keep a WideBitboard copy for the same purpose.
  */
 class LIB_EXPORT Board
 {
@@ -104,13 +112,19 @@ class LIB_EXPORT Board
 		 * Creates a new Board object.
 		 *
 		 * \param zobrist Zobrist keys for quickly identifying
-		 * and comparing positions. The Board class takes ownership of
-		 * the zobrist object and takes care of deleting it.
+		 * and comparing positions. The keys are immutable once
+		 * initialized, so the same zobrist object should be shared
+		 * by all boards of a variant.
 		 */
-		Board(Zobrist* zobrist);
+		Board(const QSharedPointer<Zobrist>& zobrist);
 		/*! Destructs the Board object. */
 		virtual ~Board();
-		/*! Creates and returns a deep copy of this board. */
+		/*!
+		 * Creates and returns a deep copy of this board.
+		 *
+		 * The variant's piece definitions are shared with the
+		 * copy, so copying mostly costs the position itself.
+		 */
 		virtual Board* copy() const = 0;
 
 		/*! Returns the name of the chess variant. */
@@ -140,8 +154,21 @@ class LIB_EXPORT Board
 		virtual int width() const = 0;
 		/*! Returns the height of the board in squares. */
 		virtual int height() const = 0;
-		/*! Returns the variant's default starting FEN string. */
+		/*!
+		 * Returns the variant's default starting FEN string.
+		 *
+		 * The starting positions of random variants are drawn
+		 * from randomNumber().
+		 */
 		virtual QString defaultFenString() const = 0;
+		/*!
+		 * Sets the generator for the random starting positions
+		 * to \a generator. The generator isn't owned by the board.
+		 *
+		 * If \a generator is 0 (the default), Mersenne::random()
+		 * is used.
+		 */
+		void setRandomGenerator(RandomGenerator* generator);
 		/*! Returns the zobrist key for the current position. */
 		quint64 key() const;
 		/*!
@@ -157,6 +184,9 @@ class LIB_EXPORT Board
 		/*!
 		 * Returns the FEN string of the current board position in
 		 * X-Fen or Shredder FEN notation
+		 *
+		 * The string is cached until the position changes, so
+		 * calling this repeatedly for the same ply is cheap.
 		 */
 		QString fenString(FenNotation notation = XFen) const;
 		/*!
@@ -192,9 +222,31 @@ class LIB_EXPORT Board
 		Piece pieceAt(const Square& square) const;
 		/*! Returns the number of halfmoves (plies) played. */
 		int plyCount() const;
+		/*!
+		 * Returns the number of pieces on the board, not counting
+		 * the pieces in reserve.
+		 */
+		int pieceCount() const;
+		/*!
+		 * Returns the number of pieces of type \a pieceType that
+		 * \a side has on the board. If \a pieceType is NoPiece, all
+		 * of the side's pieces are counted.
+		 */
+		int pieceCount(Side side, int pieceType = Piece::NoPiece) const;
+		/*!
+		 * Returns a hash key of the material on the board.
+		 *
+		 * Positions with the same pieces for both sides have the
+		 * same key, regardless of where the pieces are.
+		 */
+		quint64 materialKey() const;
 		/*!
 		 * Returns the number of times the current position was
 		 * reached previously in the game.
+		 *
+		 * Only the positions after the last irreversible move are
+		 * compared, so the cost doesn't grow with the game length.
+		 * \sa reversibleMoveCount()
 		 */
 		int repeatCount() const;
 		/*!
@@ -230,6 +282,16 @@ class LIB_EXPORT Board
 		 * \sa moveFromString()
 		 */
 		QString moveString(const Move& move, MoveNotation notation);
+		/*!
+		 * Makes \a move on the board and returns it as a string in
+		 * Standard Algebraic Notation.
+		 *
+		 * The result is the same as calling moveString() before
+		 * makeMove(), but the check or mate suffix is determined in
+		 * the position after the move, so the move is made only once.
+		 */
+		QString makeSanMove(const Move& move,
+				    BoardTransition* transition = 0);
 		/*!
 		 * Converts a move string into a Move.
 		 *
@@ -239,6 +301,23 @@ class LIB_EXPORT Board
 		 * \sa moveString()
 		 */
 		Move moveFromString(const QString& str);
+		/*!
+		 * Appends \a move to \a out in Long Algebraic Notation.
+		 *
+		 * This is the same as moveString() with the \a LongAlgebraic
+		 * notation, but the square names come from a table and no
+		 * string is allocated for the move. Engines use it to send
+		 * their moves.
+		 */
+		void appendLanMove(QByteArray& out, const Move& move);
+		/*!
+		 * Converts \a str in Long Algebraic Notation into a Move.
+		 *
+		 * Unlike moveFromString() this function doesn't detect the
+		 * notation or check the legality of the move, and doesn't
+		 * allocate strings unless the move is a promotion or a drop.
+		 */
+		Move parseLanMove(const QStringRef& str);
 		/*!
 		 * Converts a GenericMove into a Move.
 		 *
@@ -254,7 +333,12 @@ class LIB_EXPORT Board
 		 */
 		GenericMove genericMove(const Move& move) const;
 
-		/*! Returns true if \a move is legal in the current position. */
+		/*!
+		 * Returns true if \a move is legal in the current position.
+		 *
+		 * If the legal moves of the position are cached, \a move
+		 * is looked up in the cache.
+		 */
 		bool isLegalMove(const Move& move);
 		/*!
 		 * Returns true if \a move repeats a position that was
@@ -263,6 +347,20 @@ class LIB_EXPORT Board
 		bool isRepetition(const Move& move);
 		/*! Returns a vector of legal moves in the current position. */
 		QVector<Move> legalMoves();
+		/*!
+		 * Fills \a moves with the legal moves in the current
+		 * position, in the same order as legalMoves().
+		 *
+		 * Unlike legalMoves() this function doesn't allocate memory
+		 * from the heap unless the preallocated capacity of \a moves
+		 * is exceeded.
+		 *
+		 * The moves are cached until the position changes, so the
+		 * move parsing, SAN notation and result() of the same ply
+		 * share one move generation.
+		 * \sa MoveIterator
+		 */
+		void legalMoves(QVarLengthArray<Move>& moves);
 		/*!
 		 * Returns the result of the game, or Result::NoResult if
 		 * the game is in progress.
@@ -280,6 +378,12 @@ class LIB_EXPORT Board
 		virtual Result tablebaseResult(unsigned int* dtm = 0) const;
 
 	protected:
+		/*!
+		 * The number of plies the move history has room for
+		 * before it grows. A new position reuses the same storage.
+		 */
+		static const int HistoryReserve = 256;
+
 		/*!
 		 * Initializes the variant.
 		 *
@@ -288,6 +392,14 @@ class LIB_EXPORT Board
 		 */
 		virtual void vInitialize() = 0;
 
+		/*!
+		 * Returns a pseudorandom number between 0 and 0xFFFFFFFF
+		 * from the board's random number generator.
+		 *
+		 * \sa setRandomGenerator()
+		 */
+		quint32 randomNumber() const;
+
 		/*!
 		 * Defines a piece type used in the variant.
 		 * If the piece isn't already defined, it's gets added here.
@@ -351,13 +463,34 @@ class LIB_EXPORT Board
 		virtual QString lanMoveString(const Move& move);
 		/*!
 		 * Converts a Move object into a string in Standard
-		 * Algebraic Notation (SAN).
+		 * Algebraic Notation (SAN) without the check or mate
+		 * suffix.
 		 *
 		 * \note Specs: http://en.wikipedia.org/wiki/Algebraic_chess_notation
+		 * \sa sanCheckSuffix()
 		 */
 		virtual QString sanMoveString(const Move& move) = 0;
+		/*!
+		 * Returns the SAN suffix of the move that led to the current
+		 * position: "+" for a check, "#" for a mate, or an empty
+		 * string. The default implementation returns an empty string.
+		 */
+		virtual QString sanCheckSuffix();
 		/*! Converts a string in LAN format into a Move object. */
 		virtual Move moveFromLanString(const QString& str);
+		/*!
+		 * Returns \a move in the form that is written in LAN.
+		 *
+		 * This is a hook for variants whose LAN differs from the
+		 * internal move format, eg. in castling moves. The default
+		 * implementation returns \a move.
+		 */
+		virtual Move lanMove(const Move& move);
+		/*!
+		 * Returns the internal form of \a move, which was read
+		 * from a LAN string. This is the reverse of lanMove().
+		 */
+		virtual Move moveFromLanMove(const Move& move);
 		/*! Converts a string in SAN format into a Move object. */
 		virtual Move moveFromSanString(const QString& str) = 0;
 
@@ -395,6 +528,16 @@ class LIB_EXPORT Board
 		 * \sa generateMoves()
 		 */
 		void generateDropMoves(QVarLengthArray<Move>& moves, int pieceType) const;
+		/*!
+		 * Generates the pseudo-legal captures of the side to move.
+		 *
+		 * This is a faster alternative to filtering the output of
+		 * generateMoves() for variants that only need the captures,
+		 * eg. to enforce compulsory captures.
+		 *
+		 * \sa generateCapturesForPiece()
+		 */
+		void generateCaptureMoves(QVarLengthArray<Move>& moves) const;
 		/*!
 		 * Generates pseudo-legal moves for a piece of \a pieceType
 		 * at square \a square.
@@ -405,6 +548,18 @@ class LIB_EXPORT Board
 		virtual void generateMovesForPiece(QVarLengthArray<Move>& moves,
 						   int pieceType,
 						   int square) const = 0;
+		/*!
+		 * Generates pseudo-legal captures for a piece of \a pieceType
+		 * at square \a square.
+		 *
+		 * The default implementation generates all the moves of the
+		 * piece with generateMovesForPiece() and keeps the ones that
+		 * have a captureType(). Subclasses can reimplement this
+		 * function to skip the other moves.
+		 */
+		virtual void generateCapturesForPiece(QVarLengthArray<Move>& moves,
+						      int pieceType,
+						      int square) const;
 		/*!
 		 * Generates hopping moves for a piece.
 		 *
@@ -425,6 +580,22 @@ class LIB_EXPORT Board
 		void generateSlidingMoves(int sourceSquare,
 					  const QVarLengthArray<int>& offsets,
 					  QVarLengthArray<Move>& moves) const;
+		/*!
+		 * Generates the captures of a hopping piece.
+		 *
+		 * \sa generateHoppingMoves()
+		 */
+		void generateHoppingCaptures(int sourceSquare,
+					     const QVarLengthArray<int>& offsets,
+					     QVarLengthArray<Move>& moves) const;
+		/*!
+		 * Generates the captures of a sliding piece.
+		 *
+		 * \sa generateSlidingMoves()
+		 */
+		void generateSlidingCaptures(int sourceSquare,
+					     const QVarLengthArray<int>& offsets,
+					     QVarLengthArray<Move>& moves) const;
 		/*!
 		 * Returns true if the current position is a legal position.
 		 * If the position isn't legal it usually means that the last
@@ -455,8 +626,22 @@ class LIB_EXPORT Board
 		 * \sa isLegalMove()
 		 */
 		bool moveExists(const Move& move) const;
-		/*! Returns true if the side to move has any legal moves. */
+		/*!
+		 * Returns true if the side to move has any legal moves.
+		 *
+		 * The legal moves are generated and cached, because the
+		 * next move in the position is usually validated and
+		 * converted to a string right after this check.
+		 */
 		bool canMove();
+		/*!
+		 * Returns true if \a move, a pseudo-legal move generated in
+		 * the current position, is legal.
+		 *
+		 * Unlike vIsLegalMove() this function uses the cached legal
+		 * moves if they're available.
+		 */
+		bool isLegalGeneratedMove(const Move& move);
 		/*!
 		 * Returns the size of the board array, including the padding
 		 * (the inaccessible wall squares).
@@ -473,6 +658,15 @@ class LIB_EXPORT Board
 		void setSquare(int square, Piece piece);
 		/*! Returns the last move made in the game. */
 		const Move& lastMove() const;
+		/*!
+		 * Returns the number of consecutive reversible moves made.
+		 *
+		 * A position reached before the last irreversible move can't
+		 * be repeated, so repeatCount() only looks this many plies
+		 * back in the move history. The default implementation
+		 * returns plyCount(), ie. every move is reversible.
+		 */
+		virtual int reversibleMoveCount() const;
 		/*!
 		 * Returns the reserve piece type corresponding to \a pieceType.
 		 *
@@ -488,6 +682,53 @@ class LIB_EXPORT Board
 		/*! Removes a piece of type \a piece from the reserve. */
 		void removeFromReserve(const Piece& piece);
 
+		/*!
+		 * Returns true if the board keeps a bitboard representation
+		 * of the position in addition to the square array.
+		 *
+		 * Bitboards are only available for 8x8 boards.
+		 * \sa Bitboard
+		 */
+		bool hasBitboards() const;
+		/*! Returns a bitboard of all occupied squares. */
+		quint64 occupiedBitboard() const;
+		/*! Returns a bitboard of the squares occupied by \a side. */
+		quint64 sideBitboard(Side side) const;
+		/*!
+		 * Returns a bitboard of the squares occupied by pieces of
+		 * type \a pieceType, regardless of their side.
+		 */
+		quint64 typeBitboard(int pieceType) const;
+		/*!
+		 * Returns a bitboard of the squares occupied by pieces of
+		 * \a side that can move like \a movement.
+		 */
+		quint64 movementBitboard(Side side, unsigned movement) const;
+
+		/*!
+		 * Returns true if the board keeps a 128-bit bitboard
+		 * representation of the position in addition to the
+		 * square array.
+		 *
+		 * Wide bitboards are only available for 10x8 boards.
+		 * \sa WideBitboard
+		 */
+		bool hasWideBitboards() const;
+		/*! Returns a wide bitboard of all occupied squares. */
+		WideBitboard wideOccupiedBitboard() const;
+		/*! Returns a wide bitboard of the squares occupied by \a side. */
+		const WideBitboard& wideSideBitboard(Side side) const;
+		/*!
+		 * Returns a wide bitboard of the squares occupied by pieces
+		 * of type \a pieceType, regardless of their side.
+		 */
+		WideBitboard wideTypeBitboard(int pieceType) const;
+		/*!
+		 * Returns a wide bitboard of the squares occupied by pieces
+		 * of \a side that can move like \a movement.
+		 */
+		WideBitboard wideMovementBitboard(Side side, unsigned movement) const;
+
 	private:
 		struct PieceData
 		{
@@ -501,20 +742,53 @@ class LIB_EXPORT Board
 			quint64 key;
 		};
 		friend LIB_EXPORT QDebug operator<<(QDebug dbg, const Board* board);
+		friend class MoveIterator;
+
+		void clearBitboards();
+		void clearMaterial();
+		void addMaterial(Piece piece);
+		void removeMaterial(Piece piece);
+		static quint64 materialHash(Piece piece, int count);
+		void updateBitboards(int square, Piece oldPiece, Piece newPiece);
+		void updateWideBitboards(int square, Piece oldPiece, Piece newPiece);
+		QString buildFenString(FenNotation notation) const;
+		bool hasLegalMoveCache() const;
+		void appendSquare(QByteArray& out, int index) const;
+		int parseSquare(const QStringRef& str, int* pos) const;
 
 		bool m_initialized;
+		bool m_hasBitboards;
+		bool m_hasWideBitboards;
 		int m_width;
 		int m_height;
 		Side m_side;
 		Side m_startingSide;
 		QString m_startingFen;
 		quint64 m_key;
+		int m_pieceCount;
+		quint64 m_materialKey;
+		QVarLengthArray<int> m_pieceCounts[2];
 		Zobrist* m_zobrist;
 		QSharedPointer<Zobrist> m_sharedZobrist;
-		QVarLengthArray<PieceData> m_pieceData;
+		QVector<PieceData> m_pieceData;
+		RandomGenerator* m_random;
 		QVarLengthArray<Piece> m_squares;
 		QVector<MoveData> m_moveHistory;
 		QVector<int> m_reserve[2];
+		quint64 m_sideBits[2];
+		QVarLengthArray<quint64, 16> m_typeBits;
+		WideBitboard m_wideSideBits[2];
+		QVarLengthArray<WideBitboard, 16> m_wideTypeBits;
+		mutable QString m_fenCache;
+		mutable int m_fenCacheNotation;
+		mutable quint64 m_fenCacheKey;
+		mutable int m_fenCachePly;
+		mutable int m_fenCacheReversible;
+		QByteArray m_squareNames;
+		QVarLengthArray<Move> m_legalMoveCache;
+		bool m_legalMoveCacheValid;
+		quint64 m_legalMoveCacheKey;
+		int m_legalMoveCachePly;
 };
 
 
@@ -550,6 +824,22 @@ inline void Board::xorKey(quint64 key)
 	m_key ^= key;
 }
 
+inline int Board::pieceCount() const
+{
+	return m_pieceCount;
+}
+
+inline int Board::pieceCount(Side side, int pieceType) const
+{
+	Q_ASSERT(!side.isNull());
+	return m_pieceCounts[side][pieceType];
+}
+
+inline quint64 Board::materialKey() const
+{
+	return m_materialKey;
+}
+
 inline Piece Board::pieceAt(int square) const
 {
 	return m_squares[square];
@@ -559,13 +849,123 @@ inline void Board::setSquare(int square, Piece piece)
 {
 	Piece& old = m_squares[square];
 	if (old.isValid())
+	{
 		xorKey(m_zobrist->piece(old, square));
+		removeMaterial(old);
+	}
 	if (piece.isValid())
+	{
 		xorKey(m_zobrist->piece(piece, square));
+		addMaterial(piece);
+	}
+	if (m_hasBitboards)
+		updateBitboards(square, old, piece);
+	else if (m_hasWideBitboards)
+		updateWideBitboards(square, old, piece);
 
 	old = piece;
 }
 
+inline void Board::updateBitboards(int square, Piece oldPiece, Piece newPiece)
+{
+	quint64 bit = Bitboard::squareBit(Bitboard::fromMailbox(square));
+
+	if (oldPiece.isValid())
+	{
+		Q_ASSERT(oldPiece.type() < m_typeBits.size());
+		m_sideBits[oldPiece.side()] &= ~bit;
+		m_typeBits[oldPiece.type()] &= ~bit;
+	}
+	if (newPiece.isValid())
+	{
+		Q_ASSERT(newPiece.type() < m_typeBits.size());
+		m_sideBits[newPiece.side()] |= bit;
+		m_typeBits[newPiece.type()] |= bit;
+	}
+}
+
+inline void Board::updateWideBitboards(int square,
+				       Piece oldPiece,
+				       Piece newPiece)
+{
+	WideBitboard bit(WideBitboard::squareBit(WideBitboard::fromMailbox(square)));
+
+	if (oldPiece.isValid())
+	{
+		Q_ASSERT(oldPiece.type() < m_wideTypeBits.size());
+		m_wideSideBits[oldPiece.side()] &= ~bit;
+		m_wideTypeBits[oldPiece.type()] &= ~bit;
+	}
+	if (newPiece.isValid())
+	{
+		Q_ASSERT(newPiece.type() < m_wideTypeBits.size());
+		m_wideSideBits[newPiece.side()] |= bit;
+		m_wideTypeBits[newPiece.type()] |= bit;
+	}
+}
+
+inline void Board::addMaterial(Piece piece)
+{
+	int& count = m_pieceCounts[piece.side()][piece.type()];
+	m_materialKey ^= materialHash(piece, count++);
+	m_pieceCounts[piece.side()][Piece::NoPiece]++;
+	m_pieceCount++;
+}
+
+inline void Board::removeMaterial(Piece piece)
+{
+	int& count = m_pieceCounts[piece.side()][piece.type()];
+	m_materialKey ^= materialHash(piece, --count);
+	m_pieceCounts[piece.side()][Piece::NoPiece]--;
+	m_pieceCount--;
+}
+
+inline bool Board::hasBitboards() const
+{
+	return m_hasBitboards;
+}
+
+inline quint64 Board::occupiedBitboard() const
+{
+	return m_sideBits[Side::White] | m_sideBits[Side::Black];
+}
+
+inline quint64 Board::sideBitboard(Side side) const
+{
+	Q_ASSERT(!side.isNull());
+	return m_sideBits[side];
+}
+
+inline quint64 Board::typeBitboard(int pieceType) const
+{
+	if (pieceType <= Piece::NoPiece || pieceType >= m_typeBits.size())
+		return 0;
+	return m_typeBits[pieceType];
+}
+
+inline bool Board::hasWideBitboards() const
+{
+	return m_hasWideBitboards;
+}
+
+inline WideBitboard Board::wideOccupiedBitboard() const
+{
+	return m_wideSideBits[Side::White] | m_wideSideBits[Side::Black];
+}
+
+inline const WideBitboard& Board::wideSideBitboard(Side side) const
+{
+	Q_ASSERT(!side.isNull());
+	return m_wideSideBits[side];
+}
+
+inline WideBitboard Board::wideTypeBitboard(int pieceType) const
+{
+	if (pieceType <= Piece::NoPiece || pieceType >= m_wideTypeBits.size())
+		return WideBitboard();
+	return m_wideTypeBits[pieceType];
+}
+
 inline int Board::plyCount() const
 {
 	return m_moveHistory.size();
@@ -17,7 +17,12 @@ SOURCES += $$PWD/board.cpp \
     $$PWD/crazyhouseboard.cpp \
     $$PWD/boardfactory.cpp \
     $$PWD/boardtransition.cpp \
-    $$PWD/gaviotatablebase.cpp
+    $$PWD/gaviotatablebase.cpp \
+    $$PWD/syzygytablebase.cpp \
+    $$PWD/tablebasecache.cpp \
+    $$PWD/bitboard.cpp \
+    $$PWD/widebitboard.cpp \
+    $$PWD/moveiterator.cpp
 HEADERS += $$PWD/board.h \
     $$PWD/move.h \
     $$PWD/piece.h \
@@ -38,4 +43,9 @@ HEADERS += $$PWD/board.h \
     $$PWD/crazyhouseboard.h \
     $$PWD/boardfactory.h \
     $$PWD/boardtransition.h \
-    $$PWD/gaviotatablebase.h
+    $$PWD/gaviotatablebase.h \
+    $$PWD/syzygytablebase.h \
+    $$PWD/tablebasecache.h \
+    $$PWD/bitboard.h \
+    $$PWD/widebitboard.h \
+    $$PWD/moveiterator.h
@@ -16,6 +16,10 @@
 */
 
 #include "boardfactory.h"
+#include <QMap>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
 #include "atomicboard.h"
 #include "capablancaboard.h"
 #include "caparandomboard.h"
@@ -37,6 +41,25 @@ REGISTER_BOARD(LosersBoard, "losers")
 REGISTER_BOARD(StandardBoard, "standard")
 
 
+// The maximum number of released boards kept per variant
+static const int s_maxPoolSize = 32;
+static QMutex s_poolMutex;
+static QMap<QString, Board*> s_prototypes;
+static QMap<QString, QList<Board*> > s_pool;
+
+class BoardPoolDeleter
+{
+	public:
+		~BoardPoolDeleter()
+		{
+			qDeleteAll(s_prototypes);
+			foreach (const QList<Board*>& boards, s_pool)
+				qDeleteAll(boards);
+		}
+};
+static BoardPoolDeleter s_boardPoolDeleter;
+
+
 ClassRegistry<Board>* BoardFactory::registry()
 {
 	static ClassRegistry<Board>* registry = new ClassRegistry<Board>;
@@ -45,7 +68,39 @@ ClassRegistry<Board>* BoardFactory::registry()
 
 Board* BoardFactory::create(const QString& variant)
 {
-	return registry()->create(variant);
+	QMutexLocker locker(&s_poolMutex);
+
+	QList<Board*>& pool = s_pool[variant];
+	if (!pool.isEmpty())
+		return pool.takeLast();
+
+	Board* prototype = s_prototypes.value(variant);
+	if (prototype == 0)
+	{
+		prototype = registry()->create(variant);
+		if (prototype == 0)
+			return 0;
+		prototype->initialize();
+		s_prototypes[variant] = prototype;
+	}
+
+	return prototype->copy();
+}
+
+void BoardFactory::release(Board* board)
+{
+	if (board == 0)
+		return;
+
+	QMutexLocker locker(&s_poolMutex);
+
+	QList<Board*>& pool = s_pool[board->variant()];
+	if (pool.size() >= s_maxPoolSize)
+	{
+		delete board;
+		return;
+	}
+	pool.append(board);
 }
 
 QStringList BoardFactory::variants()
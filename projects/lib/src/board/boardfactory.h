@@ -25,7 +25,13 @@
 
 namespace Chess {
 
-/*! \brief A factory for creating Board objects. */
+/*!
+ * \brief A factory for creating Board objects.
+ *
+ * BoardFactory keeps an initialized prototype of each variant and a
+ * small pool of released boards, so creating a board doesn't have to
+ * set up the piece data and move offsets from scratch every time.
+ */
 class LIB_EXPORT BoardFactory
 {
 	public:
@@ -34,8 +40,20 @@ class LIB_EXPORT BoardFactory
 		/*!
 		 * Creates and returns a new Board of variant \a variant.
 		 * Returns 0 if \a variant is not supported.
+		 *
+		 * The board is either a board that was returned to the pool
+		 * with release(), or a copy of the variant's prototype. The
+		 * caller must set the position with Board::setFenString() or
+		 * Board::reset() before using the board.
 		 */
 		static Board* create(const QString& variant);
+		/*!
+		 * Returns \a board to the pool so that create() can reuse it.
+		 *
+		 * The caller must not use \a board after this call. If the
+		 * pool is full, \a board is deleted.
+		 */
+		static void release(Board* board);
 		/*! Returns a list of supported chess variants. */
 		static QStringList variants();
 
@@ -21,7 +21,7 @@
 namespace Chess {
 
 CapablancaBoard::CapablancaBoard()
-	: WesternBoard(new WesternZobrist())
+	: WesternBoard(WesternZobrist::shared("capablanca"))
 {
 	setPieceType(Archbishop, tr("archbishop"), "A", KnightMovement | BishopMovement);
 	setPieceType(Chancellor, tr("chancellor"), "C", KnightMovement | RookMovement);
@@ -16,7 +16,6 @@
 */
 
 #include "caparandomboard.h"
-#include <mersenne.h>
 
 
 static void addPiece(QVector<int>& pieces,
@@ -105,21 +104,21 @@ QString CaparandomBoard::defaultFenString() const
 	do
 	{
 		pieces.fill(empty);
-		if ((Mersenne::random() % 2) == 0)
+		if ((randomNumber() % 2) == 0)
 		{
-			addPiece(pieces, Queen, Mersenne::random() % 5, 0, 2);
-			addPiece(pieces, Archbishop, Mersenne::random() % 5, 1, 2);
+			addPiece(pieces, Queen, randomNumber() % 5, 0, 2);
+			addPiece(pieces, Archbishop, randomNumber() % 5, 1, 2);
 		}
 		else
 		{
-			addPiece(pieces, Archbishop, Mersenne::random() % 5, 0, 2);
-			addPiece(pieces, Queen, Mersenne::random() % 5, 1, 2);
+			addPiece(pieces, Archbishop, randomNumber() % 5, 0, 2);
+			addPiece(pieces, Queen, randomNumber() % 5, 1, 2);
 		}
-		addPiece(pieces, Bishop, Mersenne::random() % 4, 0, 2);
-		addPiece(pieces, Bishop, Mersenne::random() % 4, 1, 2);
-		addPiece(pieces, Chancellor, Mersenne::random() % 6);
-		addPiece(pieces, Knight, Mersenne::random() % 5);
-		addPiece(pieces, Knight, Mersenne::random() % 4);
+		addPiece(pieces, Bishop, randomNumber() % 4, 0, 2);
+		addPiece(pieces, Bishop, randomNumber() % 4, 1, 2);
+		addPiece(pieces, Chancellor, randomNumber() % 6);
+		addPiece(pieces, Knight, randomNumber() % 5);
+		addPiece(pieces, Knight, randomNumber() % 4);
 		addPiece(pieces, Rook, 0);
 		addPiece(pieces, King, 0);
 		addPiece(pieces, Rook, 0);
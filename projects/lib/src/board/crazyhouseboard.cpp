@@ -18,11 +18,12 @@
 #include "crazyhouseboard.h"
 #include "westernzobrist.h"
 #include "boardtransition.h"
+#include "bitboard.h"
 
 namespace Chess {
 
 CrazyhouseBoard::CrazyhouseBoard()
-	: WesternBoard(new WesternZobrist())
+	: WesternBoard(WesternZobrist::shared("crazyhouse"))
 {
 	setPieceType(PromotedKnight, tr("promoted knight"), "N~", KnightMovement);
 	setPieceType(PromotedBishop, tr("promoted bishop"), "B~", BishopMovement);
@@ -135,6 +136,13 @@ void CrazyhouseBoard::restorePieces(Piece piece, const QVarLengthArray<int>& squ
 		setSquare(squares[i], prom);
 }
 
+int CrazyhouseBoard::reversibleMoveCount() const
+{
+	// Captured pieces go to the reserves and can be dropped back,
+	// so a position can repeat across captures and pawn moves
+	return plyCount();
+}
+
 QString CrazyhouseBoard::sanMoveString(const Move& move)
 {
 	Piece piece(pieceAt(move.sourceSquare()));
@@ -216,7 +224,27 @@ void CrazyhouseBoard::generateMovesForPiece(QVarLengthArray<Move>& moves,
 					    int square) const
 {
 	// Generate drops
-	if (square == 0)
+	if (square == 0 && hasBitboards())
+	{
+		// Every empty square is a drop target, apart from the
+		// first and last ranks for pawns.
+		quint64 targets = ~occupiedBitboard();
+		if (pieceType == Pawn)
+			targets &= Q_UINT64_C(0x00FFFFFFFFFFFF00);
+
+		// Same order as the square array: top rank first
+		for (int rank = 7; rank >= 0 && targets != 0; rank--)
+		{
+			quint64 rankTargets = targets & (Q_UINT64_C(0xFF) << (rank * 8));
+			targets ^= rankTargets;
+			while (rankTargets != 0)
+			{
+				int sq = Bitboard::toMailbox(Bitboard::popLsb(rankTargets));
+				moves.append(Move(0, sq, pieceType));
+			}
+		}
+	}
+	else if (square == 0)
 	{
 		const int size = arraySize();
 		const int maxRank = height() - 2;
@@ -61,6 +61,7 @@ class LIB_EXPORT CrazyhouseBoard : public WesternBoard
 
 		// Inherited from WesternBoard
 		virtual int reserveType(int pieceType) const;
+		virtual int reversibleMoveCount() const;
 		virtual QString sanMoveString(const Move& move);
 		virtual Move moveFromSanString(const QString& str);
 		virtual void vMakeMove(const Move& move,
@@ -17,7 +17,6 @@
 
 #include "frcboard.h"
 #include "piece.h"
-#include <mersenne.h>
 
 
 static void addPiece(QVector<int>& pieces,
@@ -68,11 +67,11 @@ QString FrcBoard::defaultFenString() const
 	const int empty = Piece::NoPiece;
 	QVector<int> pieces(8, empty);
 
-	addPiece(pieces, Bishop, Mersenne::random() % 4, 0, 2);
-	addPiece(pieces, Bishop, Mersenne::random() % 4, 1, 2);
-	addPiece(pieces, Queen, Mersenne::random() % 6);
-	addPiece(pieces, Knight, Mersenne::random() % 5);
-	addPiece(pieces, Knight, Mersenne::random() % 4);
+	addPiece(pieces, Bishop, randomNumber() % 4, 0, 2);
+	addPiece(pieces, Bishop, randomNumber() % 4, 1, 2);
+	addPiece(pieces, Queen, randomNumber() % 6);
+	addPiece(pieces, Knight, randomNumber() % 5);
+	addPiece(pieces, Knight, randomNumber() % 4);
 	addPiece(pieces, Rook, 0);
 	addPiece(pieces, King, 0);
 	addPiece(pieces, Rook, 0);
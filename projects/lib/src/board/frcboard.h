@@ -47,9 +47,9 @@ class LIB_EXPORT FrcBoard : public StandardBoard
 		/*!
 		 * Returns a randomized starting FEN string.
 		 *
-		 * \note Mersenne::random() is used for the randomization,
-		 * so Mersenne::initialize() should be called before calling
-		 * this function.
+		 * \note The position is drawn from randomNumber(), so
+		 * Mersenne::initialize() should be called before calling
+		 * this function unless the board has a generator of its own.
 		 */
 		virtual QString defaultFenString() const;
 };
@@ -16,16 +16,155 @@
 */
 
 #include "gaviotatablebase.h"
+#include <cstring>
 #include <QStringList>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QSet>
+#include <QRunnable>
+#include <QThreadPool>
 #include <gtb-probe.h>
 #include "westernboard.h"
 
+// The maximum number of background reads waiting in the queue
+static const int s_maxPrefetches = 64;
+// The maximum number of remembered positions that aren't in the tables
+static const int s_maxMissing = 4096;
+
 const char** s_paths = 0;
 char* s_initInfo = 0;
+static int s_cacheSize = 32;
+static int s_wdlFraction = 96;
+static QAtomicInt s_probeMode;
+static QAtomicInt s_cacheReady;
+static QMutex s_cacheMutex;
+
+// Positions that are being read in the background, and positions that
+// turned out not to be in the tables
+static QSet<QByteArray> s_prefetches;
+static QSet<QByteArray> s_missing;
+static QMutex s_prefetchMutex;
+static QThreadPool* s_prefetchPool = 0;
+
+// Allocates the probe cache when the tables are first probed, so that
+// programs that never reach a tablebase position don't pay for it
+static void initializeCache()
+{
+#if QT_VERSION >= 0x050000
+	if (s_cacheReady.loadAcquire())
+#else
+	if (s_cacheReady)
+#endif
+		return;
+
+	QMutexLocker locker(&s_cacheMutex);
+	if (s_cacheReady.fetchAndAddRelaxed(0) != 0)
+		return;
+
+	tbcache_init(size_t(s_cacheSize) * 1024 * 1024, s_wdlFraction);
+	tbstats_reset();
+	s_cacheReady.fetchAndStoreRelease(1);
+}
+
+namespace {
+
+// A position in the format expected by the Gaviota probing functions
+struct ProbePosition
+{
+	unsigned stm;
+	unsigned epsq;
+	unsigned castling;
+	unsigned sq[2][17];
+	unsigned char pc[2][17];
+	bool dtm;
+
+	QByteArray key() const
+	{
+		return QByteArray(reinterpret_cast<const char*>(this),
+				  sizeof(*this));
+	}
+};
+
+// Reads the blocks needed by a position into the probe cache
+class PrefetchTask : public QRunnable
+{
+	public:
+		explicit PrefetchTask(const ProbePosition& pos)
+			: m_pos(pos)
+		{
+		}
+
+		virtual void run()
+		{
+			unsigned info = tb_UNKNOWN;
+			unsigned plies = 0;
+			bool ok;
+			if (m_pos.dtm)
+				ok = tb_probe_hard(m_pos.stm, m_pos.epsq,
+						   m_pos.castling,
+						   m_pos.sq[0], m_pos.sq[1],
+						   m_pos.pc[0], m_pos.pc[1],
+						   &info, &plies);
+			else
+				ok = tb_probe_WDL_hard(m_pos.stm, m_pos.epsq,
+						       m_pos.castling,
+						       m_pos.sq[0], m_pos.sq[1],
+						       m_pos.pc[0], m_pos.pc[1],
+						       &info);
+
+			QByteArray key(m_pos.key());
+			QMutexLocker locker(&s_prefetchMutex);
+			s_prefetches.remove(key);
+			if (!ok)
+			{
+				if (s_missing.size() >= s_maxMissing)
+					s_missing.clear();
+				s_missing.insert(key);
+			}
+		}
+
+	private:
+		ProbePosition m_pos;
+};
 
+} // anonymous namespace
 
-bool GaviotaTablebase::initialize(const QStringList& paths)
+// Starts reading the blocks for \a pos in the background. Returns false
+// if the position is already known to be missing from the tables.
+static bool prefetch(const ProbePosition& pos)
 {
+	QByteArray key(pos.key());
+	QMutexLocker locker(&s_prefetchMutex);
+
+	if (s_missing.remove(key))
+		return false;
+	if (s_prefetches.contains(key)
+	||  s_prefetches.size() >= s_maxPrefetches)
+		return true;
+
+	if (s_prefetchPool == 0)
+	{
+		// The blocks are decompressed one at a time anyway, so
+		// more threads would only compete for the disk
+		s_prefetchPool = new QThreadPool;
+		s_prefetchPool->setMaxThreadCount(1);
+	}
+	s_prefetches.insert(key);
+	s_prefetchPool->start(new PrefetchTask(pos));
+	return true;
+}
+
+
+bool GaviotaTablebase::initialize(const QStringList& paths,
+				  int cacheSize,
+				  int wdlFraction)
+{
+	Q_ASSERT(cacheSize > 0);
+	Q_ASSERT(wdlFraction >= 0 && wdlFraction <= 100);
+
+	s_cacheSize = cacheSize;
+	s_wdlFraction = wdlFraction;
+
 	s_paths = tbpaths_init();
 	foreach (const QString& path, paths)
 	{
@@ -35,8 +174,6 @@ bool GaviotaTablebase::initialize(const QStringList& paths)
 	}
 
 	s_initInfo = tb_init(1, tb_CP4, s_paths);
-	tbcache_init(32*1024*1024, 96);
-	tbstats_reset();
 
 	return s_initInfo != 0;
 }
@@ -46,7 +183,14 @@ void GaviotaTablebase::cleanup()
 	if (s_initInfo == 0)
 		return;
 
-	tbcache_done();
+	// Waits for the background reads to finish
+	delete s_prefetchPool;
+	s_prefetchPool = 0;
+	s_prefetches.clear();
+	s_missing.clear();
+
+	if (s_cacheReady.fetchAndStoreAcquire(0) != 0)
+		tbcache_done();
 	tb_done();
 	s_paths = tbpaths_done(s_paths);
 	s_initInfo = 0;
@@ -58,6 +202,15 @@ bool GaviotaTablebase::tbAvailable(int pieces)
 	return tb_availability() & (1 << bit);
 }
 
+void GaviotaTablebase::setProbeMode(ProbeMode mode)
+{
+	s_probeMode.fetchAndStoreRelaxed(mode);
+}
+
+GaviotaTablebase::ProbeMode GaviotaTablebase::probeMode()
+{
+	return ProbeMode(s_probeMode.fetchAndAddRelaxed(0));
+}
 static TB_squares tbSquare(const Chess::Square& square)
 {
 	if (!square.isValid())
@@ -90,17 +243,24 @@ Chess::Result GaviotaTablebase::result(const Chess::Side& side,
 				       const Chess::Square& enpassantSq,
 				       Castling castling,
 				       const PieceList& pieces,
-				       unsigned int* dtm)
+				       unsigned int* dtm,
+				       bool* pending)
 {
 	Q_ASSERT(pieces.size() <= 5);
 
+	if (pending != 0)
+		*pending = false;
 	if (s_initInfo == 0)
 		return Chess::Result();
+	initializeCache();
 
-	TB_sides stm = (side == Chess::Side::White) ? tb_WHITE_TO_MOVE : tb_BLACK_TO_MOVE;
-	TB_squares epsq = tbSquare(enpassantSq);
-	unsigned int sq[2][17];
-	unsigned char pc[2][17];
+	// Zero the whole struct so that it can be used as a hash key
+	ProbePosition pos;
+	std::memset(&pos, 0, sizeof(pos));
+	pos.stm = (side == Chess::Side::White) ? tb_WHITE_TO_MOVE : tb_BLACK_TO_MOVE;
+	pos.epsq = tbSquare(enpassantSq);
+	pos.castling = castling;
+	pos.dtm = (dtm != 0);
 
 	typedef QPair<Chess::Square, Chess::Piece> PcSq;
 	int pcIndex[2] = { 0, 0 };
@@ -108,23 +268,44 @@ Chess::Result GaviotaTablebase::result(const Chess::Side& side,
 	{
 		Chess::Side pcSide = item.second.side();
 		int i = pcIndex[pcSide]++;
-		sq[pcSide][i] = tbSquare(item.first);
-		pc[pcSide][i] = tbPiece(item.second.type());
+		pos.sq[pcSide][i] = tbSquare(item.first);
+		pos.pc[pcSide][i] = tbPiece(item.second.type());
 	}
-	sq[0][pcIndex[0]] = tb_NOSQUARE;
-	sq[1][pcIndex[1]] = tb_NOSQUARE;
-	pc[0][pcIndex[0]] = tb_NOPIECE;
-	pc[1][pcIndex[1]] = tb_NOPIECE;
+	pos.sq[0][pcIndex[0]] = tb_NOSQUARE;
+	pos.sq[1][pcIndex[1]] = tb_NOSQUARE;
+	pos.pc[0][pcIndex[0]] = tb_NOPIECE;
+	pos.pc[1][pcIndex[1]] = tb_NOPIECE;
 
 	unsigned info = tb_UNKNOWN;
 	bool ok = false;
-	if (dtm == 0)
-		ok = tb_probe_WDL_hard(stm, epsq, castling,
-				       sq[0], sq[1], pc[0], pc[1],
+	if (pending != 0 && probeMode() == SoftProbe)
+	{
+		if (dtm == 0)
+			ok = tb_probe_WDL_soft(pos.stm, pos.epsq, pos.castling,
+					       pos.sq[0], pos.sq[1],
+					       pos.pc[0], pos.pc[1],
+					       &info);
+		else
+			ok = tb_probe_soft(pos.stm, pos.epsq, pos.castling,
+					   pos.sq[0], pos.sq[1],
+					   pos.pc[0], pos.pc[1],
+					   &info, dtm);
+
+		if (!ok)
+		{
+			*pending = prefetch(pos);
+			return Chess::Result();
+		}
+	}
+	else if (dtm == 0)
+		ok = tb_probe_WDL_hard(pos.stm, pos.epsq, pos.castling,
+				       pos.sq[0], pos.sq[1],
+				       pos.pc[0], pos.pc[1],
 				       &info);
 	else
-		ok = tb_probe_hard(stm, epsq, castling,
-				   sq[0], sq[1], pc[0], pc[1],
+		ok = tb_probe_hard(pos.stm, pos.epsq, pos.castling,
+				   pos.sq[0], pos.sq[1],
+				   pos.pc[0], pos.pc[1],
 				   &info, dtm);
 
 	if (ok)
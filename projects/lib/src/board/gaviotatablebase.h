@@ -50,6 +50,18 @@ class LIB_EXPORT GaviotaTablebase
 		};
 		Q_DECLARE_FLAGS(Castling, CastlingFlag)
 
+		/*! Strategy for positions that aren't in the probe cache. */
+		enum ProbeMode
+		{
+			/*! Read the missing blocks from the table files. */
+			HardProbe,
+			/*!
+			 * Probe only the cache, and read the missing blocks
+			 * from the table files in a background thread.
+			 */
+			SoftProbe
+		};
+
 		/*! Synonym for QList< QPair<Chess::Square, Chess::Piece> >. */
 		typedef QList< QPair<Chess::Square, Chess::Piece> > PieceList;
 
@@ -59,9 +71,14 @@ class LIB_EXPORT GaviotaTablebase
 		 * Returns true if successfull; otherwise returns false.
 		 *
 		 * The tablebases should be located in the directories listed
-		 * in \a paths.
+		 * in \a paths. \a cacheSize is the size of the probe cache
+		 * in megabytes, and \a wdlFraction is the percentage of the
+		 * cache reserved for win/draw/loss information. The cache
+		 * is allocated when the tables are first probed.
 		 */
-		static bool initialize(const QStringList& paths);
+		static bool initialize(const QStringList& paths,
+				       int cacheSize = 32,
+				       int wdlFraction = 96);
 		/*! Cleans up when the tablebases aren't needed any more. */
 		static void cleanup();
 		/*!
@@ -69,6 +86,14 @@ class LIB_EXPORT GaviotaTablebase
 		 * available; otherwise returns false.
 		 */
 		static bool tbAvailable(int pieces);
+		/*!
+		 * Sets the probe mode to \a mode.
+		 *
+		 * The default mode is HardProbe.
+		 */
+		static void setProbeMode(ProbeMode mode);
+		/*! Returns the probe mode. */
+		static ProbeMode probeMode();
 		/*!
 		 * Returns the expected game result for the positions specified
 		 * by \a side, \a enpassantSq, \a castling and \a pieces.
@@ -80,13 +105,21 @@ class LIB_EXPORT GaviotaTablebase
 		 * If the position isn't found in the tablebases, a null result
 		 * is returned.
 		 *
+		 * In SoftProbe mode, if \a pending is not null and the
+		 * position isn't in the probe cache, a background read of
+		 * the table files is started, \a pending is set to true and
+		 * a null result is returned. The caller should try again
+		 * later. When \a pending is null the tables are always read
+		 * before returning.
+		 *
 		 * \sa Chess::Board::tablebaseResult()
 		 */
 		static Chess::Result result(const Chess::Side& side,
 					    const Chess::Square& enpassantSq,
 					    Castling castling,
 					    const PieceList& pieces,
-					    unsigned int* dtm = 0);
+					    unsigned int* dtm = 0,
+					    bool* pending = 0);
 
 	private:
 		GaviotaTablebase();
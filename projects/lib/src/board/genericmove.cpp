@@ -19,71 +19,89 @@
 
 namespace Chess {
 
+/*
+ * Layout of the packed move:
+ * - bits 0-11: source square
+ * - bits 12-23: target square
+ * - bits 24-31: promotion type
+ *
+ * A square is stored as (file + 1) | ((rank + 1) << 6), so an
+ * invalid square (-1, -1) takes the value 0.
+ */
+
+quint32 GenericMove::packSquare(const Square& square)
+{
+	int file = qMax(square.file(), -1);
+	int rank = qMax(square.rank(), -1);
+	Q_ASSERT(file < 63 && rank < 63);
+
+	return quint32(file + 1) | (quint32(rank + 1) << 6);
+}
+
+Square GenericMove::unpackSquare(quint32 data)
+{
+	return Square(int(data & 0x3F) - 1, int((data >> 6) & 0x3F) - 1);
+}
+
 GenericMove::GenericMove()
-	: m_promotion(0)
+	: m_data(0)
 {
 }
 
 GenericMove::GenericMove(const Square& sourceSquare,
 			 const Square& targetSquare,
 			 int promotion)
-	: m_sourceSquare(sourceSquare),
-	  m_targetSquare(targetSquare),
-	  m_promotion(promotion)
+	: m_data(packSquare(sourceSquare) |
+		 (packSquare(targetSquare) << 12) |
+		 (quint32(promotion) << 24))
 {
+	Q_ASSERT(promotion >= 0 && promotion <= 0xFF);
 }
 
 bool GenericMove::operator==(const GenericMove& other) const
 {
-	if (m_sourceSquare == other.m_sourceSquare
-	&&  m_targetSquare == other.m_targetSquare
-	&&  m_promotion == other.m_promotion)
-		return true;
-	return false;
+	return (m_data == other.m_data);
 }
 
 bool GenericMove::operator!=(const GenericMove& other) const
 {
-	if (m_sourceSquare != other.m_sourceSquare
-	||  m_targetSquare != other.m_targetSquare
-	||  m_promotion != other.m_promotion)
-		return true;
-	return false;
+	return (m_data != other.m_data);
 }
 
 bool GenericMove::isNull() const
 {
-	return !(m_sourceSquare.isValid() && m_targetSquare.isValid());
+	return !(sourceSquare().isValid() && targetSquare().isValid());
 }
 
 Square GenericMove::sourceSquare() const
 {
-	return m_sourceSquare;
+	return unpackSquare(m_data);
 }
 
 Square GenericMove::targetSquare() const
 {
-	return m_targetSquare;
+	return unpackSquare(m_data >> 12);
 }
 
 int GenericMove::promotion() const
 {
-	return m_promotion;
+	return m_data >> 24;
 }
 
 void GenericMove::setSourceSquare(const Square& square)
 {
-	m_sourceSquare = square;
+	m_data = (m_data & ~0xFFFu) | packSquare(square);
 }
 
 void GenericMove::setTargetSquare(const Square& square)
 {
-	m_targetSquare = square;
+	m_data = (m_data & ~(0xFFFu << 12)) | (packSquare(square) << 12);
 }
 
 void GenericMove::setPromotion(int pieceType)
 {
-	m_promotion = pieceType;
+	Q_ASSERT(pieceType >= 0 && pieceType <= 0xFF);
+	m_data = (m_data & 0xFFFFFFu) | (quint32(pieceType) << 24);
 }
 
 } // namespace Chess
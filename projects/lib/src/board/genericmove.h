@@ -29,6 +29,11 @@ namespace Chess {
  * When a move is made by a human or retrieved from an opening book of any
  * kind, it will be in this format. Later it can be converted to Chess::Move
  * by a Chess::Board object.
+ *
+ * The move is packed into 32 bits, so it's cheap to copy and store in
+ * large numbers, eg. in the move lists of finished games. The files
+ * and ranks of the squares can range from -1 (invalid) to 62, and the
+ * promotion type from 0 to 255.
  */
 class LIB_EXPORT GenericMove
 {
@@ -63,13 +68,15 @@ class LIB_EXPORT GenericMove
 		void setPromotion(int pieceType);
 
 	private:
-		Square m_sourceSquare;
-		Square m_targetSquare;
-		int m_promotion;
+		static quint32 packSquare(const Square& square);
+		static Square unpackSquare(quint32 data);
+
+		quint32 m_data;
 };
 
 } // namespace Chess
 
+Q_DECLARE_TYPEINFO(Chess::GenericMove, Q_PRIMITIVE_TYPE);
 Q_DECLARE_METATYPE(Chess::GenericMove)
 
 #endif // GENERICMOVE_H
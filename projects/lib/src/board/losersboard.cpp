@@ -21,7 +21,7 @@
 namespace Chess {
 
 LosersBoard::LosersBoard()
-	: WesternBoard(new WesternZobrist()),
+	: WesternBoard(WesternZobrist::shared("losers")),
 	  m_canCapture(false),
 	  m_captureKey(0)
 {
@@ -59,12 +59,11 @@ bool LosersBoard::vIsLegalMove(const Move& move)
 		m_canCapture = false;
 
 		QVarLengthArray<Move> moves;
-		generateMoves(moves);
+		generateCaptureMoves(moves);
 
 		for (int i = 0; i < moves.size(); i++)
 		{
-			if (captureType(moves[i]) != Piece::NoPiece
-			&&  WesternBoard::vIsLegalMove(moves[i]))
+			if (WesternBoard::vIsLegalMove(moves[i]))
 			{
 				m_canCapture = true;
 				break;
@@ -0,0 +1,93 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "moveiterator.h"
+#include "board.h"
+
+namespace Chess {
+
+MoveIterator::MoveIterator(Board* board)
+	: m_board(board),
+	  m_side(board->sideToMove()),
+	  m_square((board->m_width + 2) * 2),
+	  m_endSquare(board->m_squares.size() - m_square),
+	  m_dropType(1),
+	  m_index(0),
+	  m_hasNext(false)
+{
+	Q_ASSERT(!m_side.isNull());
+}
+
+bool MoveIterator::fill()
+{
+	m_moves.clear();
+	m_index = 0;
+
+	// Pieces on the board
+	while (m_square < m_endSquare)
+	{
+		int sq = m_square++;
+		Piece piece = m_board->m_squares[sq];
+		if (piece.side() != m_side)
+			continue;
+
+		m_board->generateMovesForPiece(m_moves, piece.type(), sq);
+		if (!m_moves.isEmpty())
+			return true;
+	}
+
+	// Piece drops
+	const QVector<int>& reserve(m_board->m_reserve[m_side]);
+	while (m_dropType < reserve.size())
+	{
+		int type = m_dropType++;
+		if (reserve.at(type) <= 0)
+			continue;
+
+		m_board->generateMovesForPiece(m_moves, type, 0);
+		if (!m_moves.isEmpty())
+			return true;
+	}
+
+	return false;
+}
+
+bool MoveIterator::hasNext()
+{
+	while (!m_hasNext)
+	{
+		if (m_index >= m_moves.size() && !fill())
+			return false;
+
+		m_hasNext = m_board->vIsLegalMove(m_moves[m_index]);
+		if (!m_hasNext)
+			m_index++;
+	}
+
+	return true;
+}
+
+Move MoveIterator::next()
+{
+	Q_ASSERT(m_hasNext);
+
+	m_hasNext = false;
+	return m_moves[m_index++];
+}
+
+} // namespace Chess
@@ -0,0 +1,78 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef MOVEITERATOR_H
+#define MOVEITERATOR_H
+
+#include <QVarLengthArray>
+#include "move.h"
+#include "side.h"
+
+namespace Chess {
+
+class Board;
+
+/*!
+ * \brief An iterator over the legal moves of a position.
+ *
+ * MoveIterator generates the moves lazily, one piece at a time,
+ * so a caller that stops early (eg. to find out if the side to
+ * move has any legal moves) doesn't pay for generating and
+ * validating every move. All the state lives in the iterator
+ * itself, so iterating doesn't allocate memory from the heap.
+ *
+ * Example:
+ * \code
+ * MoveIterator it(board);
+ * while (it.hasNext())
+ *     qDebug() << board->moveString(it.next(), Board::LongAlgebraic);
+ * \endcode
+ *
+ * \note The board must not be modified while it's iterated over.
+ * \sa Board::legalMoves()
+ */
+class LIB_EXPORT MoveIterator
+{
+	public:
+		/*! Creates a new iterator for the legal moves of \a board. */
+		MoveIterator(Board* board);
+
+		/*! Returns true if there are more legal moves. */
+		bool hasNext();
+		/*!
+		 * Returns the next legal move and advances the iterator.
+		 *
+		 * \note hasNext() must return true before calling this.
+		 */
+		Move next();
+
+	private:
+		bool fill();
+
+		Board* m_board;
+		Side m_side;
+		int m_square;
+		int m_endSquare;
+		int m_dropType;
+		int m_index;
+		bool m_hasNext;
+		QVarLengthArray<Move> m_moves;
+};
+
+} // namespace Chess
+#endif // MOVEITERATOR_H
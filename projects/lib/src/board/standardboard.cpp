@@ -17,7 +17,9 @@
 
 #include "standardboard.h"
 #include "westernzobrist.h"
+#include <QScopedPointer>
 #include "gaviotatablebase.h"
+#include "tablebasecache.h"
 
 
 // Zobrist keys for Polyglot opening book compatibility
@@ -1050,7 +1052,7 @@ static const quint64 s_keys[] = {
 namespace Chess {
 
 StandardBoard::StandardBoard()
-	: WesternBoard(new WesternZobrist(s_keys))
+	: WesternBoard(WesternZobrist::shared("standard", s_keys))
 {
 }
 
@@ -1069,19 +1071,256 @@ QString StandardBoard::defaultFenString() const
 	return "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 }
 
-Result StandardBoard::tablebaseResult(unsigned int* dtm) const
+SyzygyTablebase::PieceList StandardBoard::tablebasePieces() const
 {
-	GaviotaTablebase::PieceList pieces;
+	SyzygyTablebase::PieceList pieces;
 
 	for (int i = 0; i < arraySize(); i++)
 	{
 		Piece piece(pieceAt(i));
 		if (piece.isValid())
+			pieces.append(qMakePair(chessSquare(i), piece));
+	}
+
+	return pieces;
+}
+
+// Probe results are shared by every game, and a position always has
+// the same result regardless of how it was reached
+static TablebaseCache s_gaviotaCache;
+static TablebaseCache s_syzygyWdlCache;
+static TablebaseCache s_syzygyDtzCache;
+static const int TablebaseProbeFailed = -1000;
+
+static int dtzBeforeZeroing(int wdl)
+{
+	switch (wdl)
+	{
+	case SyzygyTablebase::Win:
+		return 1;
+	case SyzygyTablebase::CursedWin:
+		return 101;
+	case SyzygyTablebase::BlessedLoss:
+		return -101;
+	case SyzygyTablebase::Loss:
+		return -1;
+	default:
+		return 0;
+	}
+}
+
+static int sign(int value)
+{
+	return (value > 0) - (value < 0);
+}
+
+int StandardBoard::syzygyWdl(bool checkZeroingMoves,
+			     SyzygyTablebase::ProbeStatus* status,
+			     bool* zeroing)
+{
+	*status = SyzygyTablebase::ProbeOk;
+	*zeroing = false;
+
+	QVarLengthArray<Move> moves;
+	legalMoves(moves);
+
+	// The stored values may be wrong if the best move is a capture,
+	// so captures (and pawn moves if needed) are searched first
+	int bestValue = SyzygyTablebase::Loss;
+	int moveCount = 0;
+	for (int i = 0; i < moves.size(); i++)
+	{
+		const Move& move = moves[i];
+		if (captureType(move) == Piece::NoPiece
+		&&  (!checkZeroingMoves
+		     || pieceAt(move.sourceSquare()).type() != Pawn))
+			continue;
+
+		moveCount++;
+		bool childZeroing;
+		makeMove(move);
+		int value = -syzygyWdl(false, status, &childZeroing);
+		undoMove();
+
+		if (*status == SyzygyTablebase::ProbeFailed)
+			return SyzygyTablebase::Draw;
+		if (value > bestValue)
+		{
+			bestValue = value;
+			if (value >= SyzygyTablebase::Win)
+			{
+				*zeroing = true;
+				return value;
+			}
+		}
+	}
+
+	// If every legal move was searched the table isn't needed, which
+	// also covers positions where the only move is en-passant
+	bool noMoreMoves = (moveCount > 0 && moveCount == moves.size());
+	int value = bestValue;
+	if (!noMoreMoves)
+	{
+		SyzygyTablebase::WdlScore wdl;
+		*status = SyzygyTablebase::probeWdl(sideToMove(),
+						    tablebasePieces(),
+						    &wdl);
+		if (*status == SyzygyTablebase::ProbeFailed)
+			return SyzygyTablebase::Draw;
+		value = wdl;
+	}
+
+	if (bestValue >= value)
+	{
+		*zeroing = (bestValue > SyzygyTablebase::Draw || noMoreMoves);
+		return bestValue;
+	}
+	return value;
+}
+
+int StandardBoard::syzygyDtz(SyzygyTablebase::ProbeStatus* status)
+{
+	bool zeroing;
+	int wdl = syzygyWdl(true, status, &zeroing);
+	if (*status == SyzygyTablebase::ProbeFailed
+	||  wdl == SyzygyTablebase::Draw)
+		return 0;
+	if (zeroing)
+		return dtzBeforeZeroing(wdl);
+
+	int dtz = 0;
+	*status = SyzygyTablebase::probeDtz(sideToMove(),
+					    tablebasePieces(),
+					    SyzygyTablebase::WdlScore(wdl),
+					    &dtz);
+	if (*status == SyzygyTablebase::ProbeFailed)
+		return 0;
+	if (*status == SyzygyTablebase::ProbeOk)
+	{
+		if (wdl == SyzygyTablebase::BlessedLoss
+		||  wdl == SyzygyTablebase::CursedWin)
+			dtz += 100;
+		return dtz * sign(wdl);
+	}
+
+	// The DTZ table has the other side to move, so the distance
+	// comes from a 1-ply search
+	*status = SyzygyTablebase::ProbeOk;
+	int minDtz = 0xFFFF;
+	QVarLengthArray<Move> moves;
+	legalMoves(moves);
+
+	for (int i = 0; i < moves.size(); i++)
+	{
+		const Move& move = moves[i];
+		bool zeroingMove = captureType(move) != Piece::NoPiece
+				|| pieceAt(move.sourceSquare()).type() == Pawn;
+
+		makeMove(move);
+		int value;
+		if (zeroingMove)
+		{
+			bool childZeroing;
+			value = -dtzBeforeZeroing(syzygyWdl(false, status, &childZeroing));
+		}
+		else
+			value = -syzygyDtz(status);
+
+		// A mating move
+		if (value == 1 && inCheck(sideToMove()))
+		{
+			QVarLengthArray<Move> replies;
+			legalMoves(replies);
+			if (replies.isEmpty())
+				minDtz = 1;
+		}
+		undoMove();
+
+		if (*status == SyzygyTablebase::ProbeFailed)
+			return 0;
+		if (!zeroingMove)
+			value += sign(value);
+		if (value < minDtz && sign(value) == sign(wdl))
+			minDtz = value;
+	}
+
+	return minDtz == 0xFFFF ? -1 : minDtz;
+}
+
+Result StandardBoard::syzygyResult() const
+{
+	// The capture search needs to make moves, so it's done on a copy
+	// of the board that's only created on a cache miss
+	QScopedPointer<StandardBoard> board;
+	SyzygyTablebase::ProbeStatus status;
+
+	int wdl;
+	if (!s_syzygyWdlCache.probe(key(), &wdl))
+	{
+		board.reset(static_cast<StandardBoard*>(copy()));
+		bool zeroing;
+		wdl = board->syzygyWdl(false, &status, &zeroing);
+		if (status == SyzygyTablebase::ProbeFailed)
+			wdl = TablebaseProbeFailed;
+		s_syzygyWdlCache.store(key(), wdl);
+	}
+	if (wdl == TablebaseProbeFailed)
+		return Result();
+
+	// Cursed wins and blessed losses are draws under the 50-move
+	// rule. A real win is still a draw if the reversible moves
+	// already played don't leave enough time for a zeroing move.
+	Side winner;
+	if (wdl == SyzygyTablebase::Win || wdl == SyzygyTablebase::Loss)
+	{
+		int played = reversibleMoveCount();
+		if (played > 0)
 		{
-			if (pieces.size() >= 5)
+			int dtz;
+			if (!s_syzygyDtzCache.probe(key(), &dtz))
+			{
+				if (board.isNull())
+					board.reset(static_cast<StandardBoard*>(copy()));
+				dtz = board->syzygyDtz(&status);
+				if (status == SyzygyTablebase::ProbeFailed)
+					dtz = TablebaseProbeFailed;
+				s_syzygyDtzCache.store(key(), dtz);
+			}
+			if (dtz == TablebaseProbeFailed)
 				return Result();
-			pieces.append(qMakePair(chessSquare(i), piece));
+			if (qAbs(dtz) + played > 100)
+				return Result(Result::Adjudication, Side(), "SyzygyTB");
 		}
+		winner = (wdl > 0) ? sideToMove() : sideToMove().opposite();
+	}
+
+	return Result(Result::Adjudication, winner, "SyzygyTB");
+}
+
+Result StandardBoard::gaviotaResult(unsigned int* dtm) const
+{
+	// The cached value has the winner in the lowest two bits, a flag
+	// for a known distance to mate in the third bit, and the distance
+	// to mate in the remaining bits
+	int value;
+	if (s_gaviotaCache.probe(key(), &value)
+	&&  (dtm == 0 || value == TablebaseProbeFailed || (value & 4)))
+	{
+		if (value == TablebaseProbeFailed)
+			return Result();
+		if (dtm != 0)
+			*dtm = value >> 3;
+		return Result(Result::Adjudication,
+			      Side(Side::Type(value & 3)),
+			      "GTB");
+	}
+
+	GaviotaTablebase::PieceList pieces;
+	for (int i = 0; i < arraySize(); i++)
+	{
+		Piece piece(pieceAt(i));
+		if (piece.isValid())
+			pieces.append(qMakePair(chessSquare(i), piece));
 	}
 
 	GaviotaTablebase::Castling castling = 0;
@@ -1094,11 +1333,70 @@ Result StandardBoard::tablebaseResult(unsigned int* dtm) const
 	if (hasCastlingRight(Chess::Side::Black, QueenSide))
 		castling |= GaviotaTablebase::BlackQueenSide;
 
-	return GaviotaTablebase::result(sideToMove(),
-					chessSquare(enpassantSquare()),
-					castling,
-					pieces,
-					dtm);
+	unsigned int tbDtm = 0;
+	bool pending = false;
+	Result result(GaviotaTablebase::result(sideToMove(),
+					       chessSquare(enpassantSquare()),
+					       castling,
+					       pieces,
+					       dtm ? &tbDtm : 0,
+					       &pending));
+	// The tables are still being read in the background, so the
+	// position will be probed again later
+	if (pending)
+		return result;
+
+	if (result.isNone())
+		value = TablebaseProbeFailed;
+	else
+	{
+		value = result.winner();
+		if (dtm != 0)
+		{
+			value |= 4 | (tbDtm << 3);
+			*dtm = tbDtm;
+		}
+	}
+	s_gaviotaCache.store(key(), value);
+
+	return result;
+}
+
+bool StandardBoard::shareTablebaseCache(const QString& name, int megabytes)
+{
+	// Half of the memory goes to the Gaviota results, and a quarter
+	// to each of the Syzygy tables
+	qint64 entries = qint64(megabytes) * 1024 * 1024 / 16;
+	int size = int(qMin(entries / 4, qint64(0x4000000)));
+
+	return s_gaviotaCache.attach(name + ".gtb", 2 * size)
+	    && s_syzygyWdlCache.attach(name + ".wdl", size)
+	    && s_syzygyDtzCache.attach(name + ".dtz", size);
+}
+
+Result StandardBoard::tablebaseResult(unsigned int* dtm) const
+{
+	int count = pieceCount();
+	if (count > 5 && count > SyzygyTablebase::largest())
+		return Result();
+
+	// Syzygy tablebases don't have the distance to mate, so they're
+	// only used when it isn't needed
+	if (dtm == 0
+	&&  count <= SyzygyTablebase::largest()
+	&&  !hasCastlingRight(Chess::Side::White, KingSide)
+	&&  !hasCastlingRight(Chess::Side::White, QueenSide)
+	&&  !hasCastlingRight(Chess::Side::Black, KingSide)
+	&&  !hasCastlingRight(Chess::Side::Black, QueenSide))
+	{
+		Result result(syzygyResult());
+		if (!result.isNone())
+			return result;
+	}
+
+	if (count > 5)
+		return Result();
+	return gaviotaResult(dtm);
 }
 
 } // namespace Chess
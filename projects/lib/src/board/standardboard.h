@@ -19,6 +19,7 @@
 #define STANDARDBOARD_H
 
 #include "westernboard.h"
+#include "syzygytablebase.h"
 
 namespace Chess {
 
@@ -45,6 +46,29 @@ class LIB_EXPORT StandardBoard : public WesternBoard
 		virtual QString variant() const;
 		virtual QString defaultFenString() const;
 		virtual Result tablebaseResult(unsigned int* dtm = 0) const;
+
+		/*!
+		 * Shares the tablebase probe results with the other
+		 * processes on the host that use the same \a name.
+		 *
+		 * The shared caches take about \a megabytes megabytes
+		 * in total. Processes that share the results should use
+		 * the same tablebases, because positions that can't be
+		 * probed are cached too.
+		 *
+		 * Returns true if successful.
+		 */
+		static bool shareTablebaseCache(const QString& name,
+						int megabytes);
+
+	private:
+		SyzygyTablebase::PieceList tablebasePieces() const;
+		Result syzygyResult() const;
+		Result gaviotaResult(unsigned int* dtm) const;
+		int syzygyWdl(bool checkZeroingMoves,
+			      SyzygyTablebase::ProbeStatus* status,
+			      bool* zeroing);
+		int syzygyDtz(SyzygyTablebase::ProbeStatus* status);
 };
 
 } // namespace Chess
@@ -0,0 +1,1011 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * The table format and the position encoding follow the probing code
+ * written by Ronald de Man, the author of the Syzygy tablebases.
+ */
+
+#include "syzygytablebase.h"
+#include <algorithm>
+#include <QStringList>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QVector>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QAtomicPointer>
+#include <QtEndian>
+#include "westernboard.h"
+
+namespace {
+
+const int MaxPieces = 7;
+
+enum TableFlag
+{
+	StmFlag = 1,
+	MappedFlag = 2,
+	WinPliesFlag = 4,
+	LossPliesFlag = 8,
+	WideFlag = 16,
+	SingleValueFlag = 128
+};
+
+int s_mapPawns[64];
+int s_mapB1H1H7[64];
+int s_mapA1D1D4[64];
+int s_mapKK[10][64];
+quint64 s_binomial[6][64];
+quint64 s_leadPawnIdx[6][64];
+quint64 s_leadPawnsSize[6][4];
+
+inline int fileOf(int square) { return square & 7; }
+inline int rankOf(int square) { return square >> 3; }
+inline int offA1H8(int square) { return rankOf(square) - fileOf(square); }
+
+bool pawnsLessThan(int a, int b)
+{
+	return s_mapPawns[a] < s_mapPawns[b];
+}
+
+// Decompression data of one table (one side to move and one file of
+// the leading pawn)
+struct PairsData
+{
+	PairsData()
+		: flags(0),
+		  maxSymLen(0),
+		  minSymLen(0),
+		  blockCount(0),
+		  blockSize(0),
+		  span(0),
+		  lowestSym(0),
+		  btree(0),
+		  blockLength(0),
+		  blockLengthSize(0),
+		  sparseIndex(0),
+		  sparseIndexSize(0),
+		  data(0)
+	{
+		for (int i = 0; i < MaxPieces; i++)
+			pieces[i] = 0;
+		for (int i = 0; i <= MaxPieces; i++)
+		{
+			groupIdx[i] = 0;
+			groupLen[i] = 0;
+		}
+		for (int i = 0; i < 4; i++)
+			mapIdx[i] = 0;
+	}
+
+	int flags;
+	int maxSymLen;
+	int minSymLen;
+	quint32 blockCount;
+	quint64 blockSize;
+	quint64 span;
+	const uchar* lowestSym;
+	const uchar* btree;
+	const uchar* blockLength;
+	quint32 blockLengthSize;
+	const uchar* sparseIndex;
+	quint64 sparseIndexSize;
+	const uchar* data;
+	QVector<quint64> base64;
+	QVector<quint8> symLen;
+	int pieces[MaxPieces];
+	quint64 groupIdx[MaxPieces + 1];
+	int groupLen[MaxPieces + 1];
+	quint16 mapIdx[4];
+};
+
+// A memory-mapped WDL or DTZ file. A table without a file marks a
+// file that couldn't be mapped, so that it isn't retried.
+struct TableFile
+{
+	TableFile()
+		: file(0),
+		  sides(1),
+		  map(0)
+	{
+	}
+	~TableFile()
+	{
+		// Closing the file releases the mapping
+		delete file;
+	}
+
+	PairsData* pairs(int stm, int tbFile)
+	{
+		return &items[stm % sides][tbFile];
+	}
+
+	QFile* file;
+	int sides;
+	const uchar* map;
+	PairsData items[2][4];
+};
+
+struct TableEntry
+{
+	QString name;
+	quint64 key;
+	quint64 key2;
+	int pieceCount;
+	bool hasPawns;
+	bool hasUniquePieces;
+	int pawnCount[2];
+	// The files are published only after they're fully initialized,
+	// so they can be probed by any thread without locking.
+	QAtomicPointer<TableFile> wdl;
+	QAtomicPointer<TableFile> dtz;
+};
+
+QStringList s_paths;
+QHash<quint64, TableEntry*> s_tables;
+QList<TableEntry*> s_entries;
+QMutex s_mapMutex;
+int s_largest = 0;
+
+TableFile* publishedTable(QAtomicPointer<TableFile>& ptr)
+{
+#if QT_VERSION >= 0x050000
+	return ptr.loadAcquire();
+#else
+	return ptr;
+#endif
+}
+
+// Material key with 4 bits for the count of each piece type
+quint64 materialKey(const int counts[2][7], bool flip)
+{
+	quint64 key = 0;
+	for (int side = 0; side < 2; side++)
+	{
+		int keySide = flip ? 1 - side : side;
+		for (int type = 1; type < 7; type++)
+			key |= quint64(counts[side][type]) << ((keySide * 6 + type - 1) * 4);
+	}
+	return key;
+}
+
+int pieceTypeFromChar(QChar c)
+{
+	switch (c.toLatin1())
+	{
+	case 'P':
+		return Chess::WesternBoard::Pawn;
+	case 'N':
+		return Chess::WesternBoard::Knight;
+	case 'B':
+		return Chess::WesternBoard::Bishop;
+	case 'R':
+		return Chess::WesternBoard::Rook;
+	case 'Q':
+		return Chess::WesternBoard::Queen;
+	case 'K':
+		return Chess::WesternBoard::King;
+	default:
+		return 0;
+	}
+}
+
+// Creates a table entry from a table name like "KRPvKR"
+TableEntry* createEntry(const QString& name)
+{
+	int counts[2][7] = { { 0 }, { 0 } };
+	int side = 0;
+	int pieceCount = 0;
+
+	foreach (const QChar& c, name)
+	{
+		if (c == 'v' && side == 0)
+		{
+			side = 1;
+			continue;
+		}
+		int type = pieceTypeFromChar(c);
+		if (type == 0)
+			return 0;
+		counts[side][type]++;
+		pieceCount++;
+	}
+	if (side != 1 || pieceCount > MaxPieces
+	||  counts[0][Chess::WesternBoard::King] != 1
+	||  counts[1][Chess::WesternBoard::King] != 1)
+		return 0;
+
+	const int pawn = Chess::WesternBoard::Pawn;
+	TableEntry* entry = new TableEntry;
+	entry->name = name;
+	entry->key = materialKey(counts, false);
+	entry->key2 = materialKey(counts, true);
+	entry->pieceCount = pieceCount;
+	entry->hasPawns = counts[0][pawn] + counts[1][pawn] > 0;
+	entry->hasUniquePieces = false;
+	for (int i = 0; i < 2; i++)
+	{
+		for (int type = pawn; type < Chess::WesternBoard::King; type++)
+		{
+			if (counts[i][type] == 1)
+				entry->hasUniquePieces = true;
+		}
+	}
+
+	// The leading color is the one with less pawns, because it
+	// compresses better
+	bool c = !counts[1][pawn]
+	      || (counts[0][pawn] && counts[1][pawn] >= counts[0][pawn]);
+	entry->pawnCount[0] = counts[c ? 0 : 1][pawn];
+	entry->pawnCount[1] = counts[c ? 1 : 0][pawn];
+
+	return entry;
+}
+
+void initEncoding()
+{
+	static bool initialized = false;
+	if (initialized)
+		return;
+	initialized = true;
+
+	// s_mapB1H1H7 maps a square below the a1-h8 diagonal to 0..27
+	int code = 0;
+	for (int sq = 0; sq < 64; sq++)
+	{
+		if (offA1H8(sq) < 0)
+			s_mapB1H1H7[sq] = code++;
+	}
+
+	// s_mapA1D1D4 maps a square in the a1-d1-d4 triangle to 0..9,
+	// with the diagonal squares last
+	QList<int> diagonal;
+	code = 0;
+	for (int sq = 0; sq <= 27; sq++)
+	{
+		if (offA1H8(sq) < 0 && fileOf(sq) <= 3)
+			s_mapA1D1D4[sq] = code++;
+		else if (offA1H8(sq) == 0 && fileOf(sq) <= 3)
+			diagonal.append(sq);
+	}
+	foreach (int sq, diagonal)
+		s_mapA1D1D4[sq] = code++;
+
+	// s_mapKK maps the 462 legal king pairs where the first king
+	// is in the a1-d1-d4 triangle. If the first king is on the
+	// diagonal, the other one can't be above it.
+	QList< QPair<int, int> > bothOnDiagonal;
+	code = 0;
+	for (int idx = 0; idx < 10; idx++)
+	{
+		for (int s1 = 0; s1 <= 27; s1++)
+		{
+			if (s_mapA1D1D4[s1] != idx || (idx == 0 && s1 != 1))
+				continue;
+			for (int s2 = 0; s2 < 64; s2++)
+			{
+				if (qAbs(fileOf(s1) - fileOf(s2)) <= 1
+				&&  qAbs(rankOf(s1) - rankOf(s2)) <= 1)
+					continue;
+				if (offA1H8(s1) == 0 && offA1H8(s2) > 0)
+					continue;
+				if (offA1H8(s1) == 0 && offA1H8(s2) == 0)
+					bothOnDiagonal.append(qMakePair(idx, s2));
+				else
+					s_mapKK[idx][s2] = code++;
+			}
+		}
+	}
+	for (int i = 0; i < bothOnDiagonal.size(); i++)
+	{
+		const QPair<int, int>& p = bothOnDiagonal.at(i);
+		s_mapKK[p.first][p.second] = code++;
+	}
+
+	// s_binomial[k][n] is the number of ways to choose k elements
+	// from a set of n elements
+	s_binomial[0][0] = 1;
+	for (int n = 1; n < 64; n++)
+	{
+		for (int k = 0; k < 6 && k <= n; k++)
+		{
+			s_binomial[k][n] = (k > 0 ? s_binomial[k - 1][n - 1] : 0)
+					 + (k < n ? s_binomial[k][n - 1] : 0);
+		}
+	}
+
+	// s_mapPawns maps squares a2-h7 to 0..47, so that the leading
+	// pawn is the one with the highest value: the one nearest to the
+	// edge and, among pawns on the same file, the one with the
+	// lowest rank.
+	int available = 47;
+	for (int leadPawns = 1; leadPawns <= 5; leadPawns++)
+	{
+		for (int file = 0; file <= 3; file++)
+		{
+			quint64 idx = 0;
+			for (int rank = 1; rank <= 6; rank++)
+			{
+				int sq = rank * 8 + file;
+				if (leadPawns == 1)
+				{
+					s_mapPawns[sq] = available--;
+					s_mapPawns[sq ^ 7] = available--;
+				}
+				s_leadPawnIdx[leadPawns][sq] = idx;
+				idx += s_binomial[leadPawns - 1][s_mapPawns[sq]];
+			}
+			s_leadPawnsSize[leadPawns][file] = idx;
+		}
+	}
+}
+
+void setGroups(const TableEntry* e, PairsData* d, const int order[2], int tbFile)
+{
+	int n = 0;
+	int firstLen = e->hasPawns ? 0 : (e->hasUniquePieces ? 3 : 2);
+	d->groupLen[n] = 1;
+
+	// Pieces of the same type form a group, and the first group
+	// has the leading pawns, three unique pieces or the kings
+	for (int i = 1; i < e->pieceCount; i++)
+	{
+		if (--firstLen > 0 || d->pieces[i] == d->pieces[i - 1])
+			d->groupLen[n]++;
+		else
+			d->groupLen[++n] = 1;
+	}
+	d->groupLen[++n] = 0;
+
+	// The groups are encoded in the order given by the table
+	bool pp = e->hasPawns && e->pawnCount[1];
+	int next = pp ? 2 : 1;
+	int freeSquares = 64 - d->groupLen[0] - (pp ? d->groupLen[1] : 0);
+	quint64 idx = 1;
+
+	for (int k = 0; next < n || k == order[0] || k == order[1]; k++)
+	{
+		if (k == order[0])
+		{
+			d->groupIdx[0] = idx;
+			if (e->hasPawns)
+				idx *= s_leadPawnsSize[d->groupLen[0]][tbFile];
+			else
+				idx *= e->hasUniquePieces ? 31332 : 462;
+		}
+		else if (k == order[1])
+		{
+			d->groupIdx[1] = idx;
+			idx *= s_binomial[d->groupLen[1]][48 - d->groupLen[0]];
+		}
+		else
+		{
+			d->groupIdx[next] = idx;
+			idx *= s_binomial[d->groupLen[next]][freeSquares];
+			freeSquares -= d->groupLen[next++];
+		}
+	}
+	d->groupIdx[n] = idx;
+}
+
+inline int lrLeft(const uchar* btree, int sym)
+{
+	const uchar* lr = btree + sym * 3;
+	return ((lr[1] & 0xF) << 8) | lr[0];
+}
+
+inline int lrRight(const uchar* btree, int sym)
+{
+	const uchar* lr = btree + sym * 3;
+	return (lr[2] << 4) | (lr[1] >> 4);
+}
+
+int setSymLen(PairsData* d, int sym, QVector<bool>& visited)
+{
+	visited[sym] = true;
+	int sr = lrRight(d->btree, sym);
+	if (sr == 0xFFF)
+		return 0;
+
+	int sl = lrLeft(d->btree, sym);
+	if (!visited[sl])
+		d->symLen[sl] = setSymLen(d, sl, visited);
+	if (!visited[sr])
+		d->symLen[sr] = setSymLen(d, sr, visited);
+
+	return d->symLen[sl] + d->symLen[sr] + 1;
+}
+
+const uchar* setSizes(PairsData* d, const uchar* data)
+{
+	d->flags = *data++;
+	if (d->flags & SingleValueFlag)
+	{
+		// The single value is stored as the minimum symbol length
+		d->minSymLen = *data++;
+		return data;
+	}
+
+	int groups = 0;
+	while (d->groupLen[groups] != 0)
+		groups++;
+	quint64 tbSize = d->groupIdx[groups];
+
+	d->blockSize = Q_UINT64_C(1) << *data++;
+	d->span = Q_UINT64_C(1) << *data++;
+	d->sparseIndexSize = (tbSize + d->span - 1) / d->span;
+	int padding = *data++;
+	d->blockCount = qFromLittleEndian<quint32>(data);
+	data += 4;
+	d->blockLengthSize = d->blockCount + padding;
+	d->maxSymLen = *data++;
+	d->minSymLen = *data++;
+	d->lowestSym = data;
+
+	// Canonical Huffman code: longer symbols have lower values
+	int count = d->maxSymLen - d->minSymLen + 1;
+	d->base64.fill(0, count);
+	for (int i = count - 2; i >= 0; i--)
+	{
+		quint64 sym = qFromLittleEndian<quint16>(d->lowestSym + i * 2);
+		quint64 nextSym = qFromLittleEndian<quint16>(d->lowestSym + (i + 1) * 2);
+		d->base64[i] = (d->base64[i + 1] + sym - nextSym) / 2;
+	}
+	for (int i = 0; i < count; i++)
+		d->base64[i] <<= 64 - i - d->minSymLen;
+
+	data += count * 2;
+	int symCount = qFromLittleEndian<quint16>(data);
+	data += 2;
+	d->btree = data;
+
+	// Each symbol expands to a pair of symbols until the leaves,
+	// which are the stored values
+	d->symLen.fill(0, symCount);
+	QVector<bool> visited(symCount, false);
+	for (int sym = 0; sym < symCount; sym++)
+	{
+		if (!visited[sym])
+			d->symLen[sym] = setSymLen(d, sym, visited);
+	}
+
+	return data + symCount * 3 + (symCount & 1);
+}
+
+const uchar* setDtzMap(TableFile* t, const uchar* data, int maxFile)
+{
+	t->map = data;
+	for (int f = 0; f <= maxFile; f++)
+	{
+		PairsData* d = t->pairs(0, f);
+		if (!(d->flags & MappedFlag))
+			continue;
+
+		if (d->flags & WideFlag)
+		{
+			data += quintptr(data) & 1;
+			for (int i = 0; i < 4; i++)
+			{
+				d->mapIdx[i] = quint16((data - t->map) / 2 + 1);
+				data += 2 * qFromLittleEndian<quint16>(data) + 2;
+			}
+		}
+		else
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				d->mapIdx[i] = quint16(data - t->map + 1);
+				data += *data + 1;
+			}
+		}
+	}
+
+	return data + (quintptr(data) & 1);
+}
+
+void initTable(const TableEntry* e, TableFile* t, const uchar* data, bool isDtz)
+{
+	// The first byte stores flags
+	data++;
+
+	t->sides = (!isDtz && e->key != e->key2) ? 2 : 1;
+	const int maxFile = e->hasPawns ? 3 : 0;
+	const bool pp = e->hasPawns && e->pawnCount[1];
+
+	for (int f = 0; f <= maxFile; f++)
+	{
+		int order[2][2] = {
+			{ data[0] & 0xF, pp ? data[1] & 0xF : 0xF },
+			{ data[0] >> 4, pp ? data[1] >> 4 : 0xF }
+		};
+		data += 1 + pp;
+
+		for (int k = 0; k < e->pieceCount; k++, data++)
+		{
+			for (int i = 0; i < t->sides; i++)
+				t->items[i][f].pieces[k] = i ? *data >> 4 : *data & 0xF;
+		}
+		for (int i = 0; i < t->sides; i++)
+			setGroups(e, &t->items[i][f], order[i], f);
+	}
+	data += quintptr(data) & 1;
+
+	for (int f = 0; f <= maxFile; f++)
+	{
+		for (int i = 0; i < t->sides; i++)
+			data = setSizes(&t->items[i][f], data);
+	}
+	if (isDtz)
+		data = setDtzMap(t, data, maxFile);
+
+	for (int f = 0; f <= maxFile; f++)
+	{
+		for (int i = 0; i < t->sides; i++)
+		{
+			PairsData* d = &t->items[i][f];
+			d->sparseIndex = data;
+			data += d->sparseIndexSize * 6;
+		}
+	}
+	for (int f = 0; f <= maxFile; f++)
+	{
+		for (int i = 0; i < t->sides; i++)
+		{
+			PairsData* d = &t->items[i][f];
+			d->blockLength = data;
+			data += d->blockLengthSize * 2;
+		}
+	}
+	for (int f = 0; f <= maxFile; f++)
+	{
+		for (int i = 0; i < t->sides; i++)
+		{
+			data = (const uchar*)((quintptr(data) + 0x3F) & ~quintptr(0x3F));
+			PairsData* d = &t->items[i][f];
+			d->data = data;
+			data += d->blockCount * d->blockSize;
+		}
+	}
+}
+
+TableFile* mapTable(const TableEntry* entry, bool isDtz)
+{
+	static const uchar wdlMagic[] = { 0x71, 0xE8, 0x23, 0x5D };
+	static const uchar dtzMagic[] = { 0xD7, 0x66, 0x0C, 0xA5 };
+	const uchar* magic = isDtz ? dtzMagic : wdlMagic;
+	QString fileName = entry->name + (isDtz ? ".rtbz" : ".rtbw");
+
+	TableFile* table = new TableFile;
+	foreach (const QString& path, s_paths)
+	{
+		QFile* file = new QFile(QDir(path).filePath(fileName));
+		if (!file->open(QIODevice::ReadOnly))
+		{
+			delete file;
+			continue;
+		}
+
+		// The file size is a multiple of 64 plus the 16-byte header
+		qint64 size = file->size();
+		const uchar* data = 0;
+		if (size >= 16 && size % 64 == 16)
+			data = file->map(0, size);
+		if (data == 0 || !std::equal(magic, magic + 4, data))
+		{
+			qWarning("Invalid Syzygy table file: %s",
+				 qPrintable(file->fileName()));
+			delete file;
+			continue;
+		}
+
+		table->file = file;
+		initTable(entry, table, data + 4, isDtz);
+		break;
+	}
+
+	return table;
+}
+
+// Returns the table file of \a entry, mapping it if needed
+TableFile* loadTable(TableEntry* entry, bool isDtz)
+{
+	QAtomicPointer<TableFile>& ptr = isDtz ? entry->dtz : entry->wdl;
+	TableFile* table = publishedTable(ptr);
+	if (table != 0)
+		return table;
+
+	QMutexLocker locker(&s_mapMutex);
+	table = publishedTable(ptr);
+	if (table == 0)
+	{
+		table = mapTable(entry, isDtz);
+		ptr.fetchAndStoreRelease(table);
+	}
+	return table;
+}
+
+int decompressPairs(PairsData* d, quint64 idx)
+{
+	if (d->flags & SingleValueFlag)
+		return d->minSymLen;
+
+	// Find the block and the offset within it from the sparse
+	// index, which has an entry for every "span" values
+	quint32 k = quint32(idx / d->span);
+	const uchar* sparse = d->sparseIndex + k * 6;
+	quint32 block = qFromLittleEndian<quint32>(sparse);
+	int offset = qFromLittleEndian<quint16>(sparse + 4);
+
+	offset += int(idx % d->span) - int(d->span / 2);
+	while (offset < 0)
+		offset += qFromLittleEndian<quint16>(d->blockLength + --block * 2) + 1;
+	while (offset > qFromLittleEndian<quint16>(d->blockLength + block * 2))
+		offset -= qFromLittleEndian<quint16>(d->blockLength + block++ * 2) + 1;
+
+	const uchar* ptr = d->data + quint64(block) * d->blockSize;
+	quint64 buf64 = qFromBigEndian<quint64>(ptr);
+	ptr += 8;
+	int buf64Size = 64;
+	int sym;
+
+	for (;;)
+	{
+		int len = 0;
+		while (buf64 < d->base64[len])
+			len++;
+		sym = int((buf64 - d->base64[len]) >> (64 - len - d->minSymLen));
+		sym += qFromLittleEndian<quint16>(d->lowestSym + len * 2);
+
+		if (offset < d->symLen[sym] + 1)
+			break;
+		offset -= d->symLen[sym] + 1;
+		len += d->minSymLen;
+		buf64 <<= len;
+		buf64Size -= len;
+		if (buf64Size <= 32)
+		{
+			buf64Size += 32;
+			buf64 |= quint64(qFromBigEndian<quint32>(ptr)) << (64 - buf64Size);
+			ptr += 4;
+		}
+	}
+
+	// Expand the symbol until the value at the offset is found
+	while (d->symLen[sym])
+	{
+		int left = lrLeft(d->btree, sym);
+		if (offset < d->symLen[left] + 1)
+			sym = left;
+		else
+		{
+			offset -= d->symLen[left] + 1;
+			sym = lrRight(d->btree, sym);
+		}
+	}
+
+	return lrLeft(d->btree, sym);
+}
+
+int mapDtzScore(TableFile* t, int tbFile, int value, int wdl)
+{
+	static const int wdlMap[] = { 1, 3, 0, 2, 0 };
+	PairsData* d = t->pairs(0, tbFile);
+
+	if (d->flags & MappedFlag)
+	{
+		int idx = d->mapIdx[wdlMap[wdl + 2]] + value;
+		if (d->flags & WideFlag)
+			value = qFromLittleEndian<quint16>(t->map + idx * 2);
+		else
+			value = t->map[idx];
+	}
+
+	// Convert moves to plies
+	if ((wdl == SyzygyTablebase::Win && !(d->flags & WinPliesFlag))
+	||  (wdl == SyzygyTablebase::Loss && !(d->flags & LossPliesFlag))
+	||  wdl == SyzygyTablebase::CursedWin
+	||  wdl == SyzygyTablebase::BlessedLoss)
+		value *= 2;
+
+	return value + 1;
+}
+
+SyzygyTablebase::ProbeStatus probeTable(const Chess::Side& side,
+					const SyzygyTablebase::PieceList& pieces,
+					bool isDtz,
+					int wdl,
+					int* value)
+{
+	Q_ASSERT(pieces.size() <= MaxPieces);
+
+	int count = pieces.size();
+	int codes[MaxPieces];
+	int boardSquares[MaxPieces];
+	int counts[2][7] = { { 0 }, { 0 } };
+
+	for (int i = 0; i < count; i++)
+	{
+		const Chess::Square& square = pieces.at(i).first;
+		const Chess::Piece& piece = pieces.at(i).second;
+		int pcSide = piece.side();
+		codes[i] = pcSide * 8 + piece.type();
+		boardSquares[i] = square.rank() * 8 + square.file();
+		counts[pcSide][piece.type()]++;
+	}
+
+	TableEntry* entry = s_tables.value(materialKey(counts, false));
+	if (entry == 0)
+		return SyzygyTablebase::ProbeFailed;
+	TableFile* t = loadTable(entry, isDtz);
+	if (t->file == 0)
+		return SyzygyTablebase::ProbeFailed;
+
+	// The tables are calculated with White as the stronger side, and
+	// symmetric tables only have White to move. Otherwise the colors
+	// and the squares are flipped.
+	bool flip = (entry->key == entry->key2 && side == Chess::Side::Black)
+		 || materialKey(counts, false) != entry->key;
+	int flipColor = flip ? 8 : 0;
+	int flipSquares = flip ? 56 : 0;
+	int stm = int(flip) ^ int(side);
+
+	int squares[MaxPieces];
+	int pcs[MaxPieces];
+	bool used[MaxPieces] = { false };
+	int size = 0;
+	int leadPawnsCnt = 0;
+	int tbFile = 0;
+
+	// Tables with pawns are split by the file of the leading pawn
+	if (entry->hasPawns)
+	{
+		int leadCode = t->pairs(0, 0)->pieces[0] ^ flipColor;
+		for (int i = 0; i < count; i++)
+		{
+			if (codes[i] != leadCode)
+				continue;
+			squares[size++] = boardSquares[i] ^ flipSquares;
+			used[i] = true;
+		}
+		leadPawnsCnt = size;
+
+		std::swap(squares[0], *std::max_element(squares,
+							squares + leadPawnsCnt,
+							pawnsLessThan));
+		tbFile = fileOf(squares[0]);
+		if (tbFile > 3)
+			tbFile = fileOf(squares[0] ^ 7);
+	}
+
+	// DTZ tables have only one side to move
+	if (isDtz)
+	{
+		int flags = t->pairs(0, tbFile)->flags;
+		if ((flags & StmFlag) != stm
+		&&  (entry->key != entry->key2 || entry->hasPawns))
+			return SyzygyTablebase::ProbeChangeSide;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		if (used[i])
+			continue;
+		squares[size] = boardSquares[i] ^ flipSquares;
+		pcs[size++] = codes[i] ^ flipColor;
+	}
+	Q_ASSERT(size >= 2);
+
+	PairsData* d = t->pairs(stm, tbFile);
+
+	// Order the pieces like in the table
+	for (int i = leadPawnsCnt; i < size - 1; i++)
+	{
+		for (int j = i + 1; j < size; j++)
+		{
+			if (d->pieces[i] == pcs[j])
+			{
+				std::swap(pcs[i], pcs[j]);
+				std::swap(squares[i], squares[j]);
+				break;
+			}
+		}
+	}
+
+	// Mirror the leading piece to files a-d
+	if (fileOf(squares[0]) > 3)
+	{
+		for (int i = 0; i < size; i++)
+			squares[i] ^= 7;
+	}
+
+	quint64 idx;
+	if (entry->hasPawns)
+	{
+		idx = s_leadPawnIdx[leadPawnsCnt][squares[0]];
+		std::stable_sort(squares + 1, squares + leadPawnsCnt, pawnsLessThan);
+		for (int i = 1; i < leadPawnsCnt; i++)
+			idx += s_binomial[i][s_mapPawns[squares[i]]];
+	}
+	else
+	{
+		// Mirror the leading piece to ranks 1-4, and below the
+		// a1-h8 diagonal
+		if (rankOf(squares[0]) > 3)
+		{
+			for (int i = 0; i < size; i++)
+				squares[i] ^= 56;
+		}
+		for (int i = 0; i < d->groupLen[0]; i++)
+		{
+			if (offA1H8(squares[i]) == 0)
+				continue;
+			if (offA1H8(squares[i]) > 0)
+			{
+				for (int j = i; j < size; j++)
+					squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+			}
+			break;
+		}
+
+		if (entry->hasUniquePieces)
+		{
+			int adjust1 = squares[1] > squares[0];
+			int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+			if (offA1H8(squares[0]))
+				idx = (s_mapA1D1D4[squares[0]] * 63
+				       + (squares[1] - adjust1)) * 62
+				      + squares[2] - adjust2;
+			else if (offA1H8(squares[1]))
+				idx = (6 * 63 + rankOf(squares[0]) * 28
+				       + s_mapB1H1H7[squares[1]]) * 62
+				      + squares[2] - adjust2;
+			else if (offA1H8(squares[2]))
+				idx = 6 * 63 * 62 + 4 * 28 * 62
+				      + rankOf(squares[0]) * 7 * 28
+				      + (rankOf(squares[1]) - adjust1) * 28
+				      + s_mapB1H1H7[squares[2]];
+			else
+				idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28
+				      + rankOf(squares[0]) * 7 * 6
+				      + (rankOf(squares[1]) - adjust1) * 6
+				      + (rankOf(squares[2]) - adjust2);
+		}
+		else
+			idx = s_mapKK[s_mapA1D1D4[squares[0]]][squares[1]];
+	}
+
+	// Encode the remaining groups in ascending square order
+	idx *= d->groupIdx[0];
+	int* groupSq = squares + d->groupLen[0];
+	bool remainingPawns = entry->hasPawns && entry->pawnCount[1];
+
+	for (int next = 1; d->groupLen[next]; next++)
+	{
+		int len = d->groupLen[next];
+		std::stable_sort(groupSq, groupSq + len);
+
+		quint64 n = 0;
+		for (int i = 0; i < len; i++)
+		{
+			int adjust = 0;
+			for (int* sq = squares; sq < groupSq; sq++)
+			{
+				if (groupSq[i] > *sq)
+					adjust++;
+			}
+			n += s_binomial[i + 1][groupSq[i] - adjust - 8 * remainingPawns];
+		}
+
+		remainingPawns = false;
+		idx += n * d->groupIdx[next];
+		groupSq += len;
+	}
+
+	int stored = decompressPairs(d, idx);
+	if (isDtz)
+		*value = mapDtzScore(t, tbFile, stored, wdl);
+	else
+		*value = stored - 2;
+
+	return SyzygyTablebase::ProbeOk;
+}
+
+} // anonymous namespace
+
+
+bool SyzygyTablebase::initialize(const QStringList& paths)
+{
+	cleanup();
+	initEncoding();
+
+	foreach (const QString& path, paths)
+	{
+		QDir dir(path);
+		if (!dir.exists())
+			continue;
+		s_paths.append(path);
+
+		QStringList files = dir.entryList(QStringList() << "*.rtbw",
+						  QDir::Files);
+		foreach (const QString& file, files)
+		{
+			QString name = file.left(file.length() - 5);
+			TableEntry* entry = createEntry(name);
+			if (entry == 0 || s_tables.contains(entry->key))
+			{
+				delete entry;
+				continue;
+			}
+
+			s_entries.append(entry);
+			s_tables.insert(entry->key, entry);
+			s_tables.insert(entry->key2, entry);
+			s_largest = qMax(s_largest, entry->pieceCount);
+		}
+	}
+
+	return !s_entries.isEmpty();
+}
+
+void SyzygyTablebase::cleanup()
+{
+	foreach (TableEntry* entry, s_entries)
+	{
+		delete publishedTable(entry->wdl);
+		delete publishedTable(entry->dtz);
+		delete entry;
+	}
+	s_entries.clear();
+	s_tables.clear();
+	s_paths.clear();
+	s_largest = 0;
+}
+
+int SyzygyTablebase::largest()
+{
+	return s_largest;
+}
+
+SyzygyTablebase::ProbeStatus SyzygyTablebase::probeWdl(const Chess::Side& side,
+						       const PieceList& pieces,
+						       WdlScore* wdl)
+{
+	// Bare kings
+	if (pieces.size() == 2)
+	{
+		*wdl = Draw;
+		return ProbeOk;
+	}
+
+	int value = 0;
+	ProbeStatus status = probeTable(side, pieces, false, 0, &value);
+	if (status == ProbeOk)
+		*wdl = WdlScore(value);
+	return status;
+}
+
+SyzygyTablebase::ProbeStatus SyzygyTablebase::probeDtz(const Chess::Side& side,
+						       const PieceList& pieces,
+						       WdlScore wdl,
+						       int* dtz)
+{
+	Q_ASSERT(wdl != Draw);
+	return probeTable(side, pieces, true, wdl, dtz);
+}
@@ -0,0 +1,121 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SYZYGYTABLEBASE_H
+#define SYZYGYTABLEBASE_H
+
+#include <QList>
+#include <QPair>
+#include "square.h"
+#include "piece.h"
+#include "side.h"
+class QStringList;
+
+/*!
+ * \brief A prober for Syzygy endgame tablebases.
+ *
+ * Syzygy tablebases contain win/draw/loss (WDL) and "distance to
+ * zeroing move" (DTZ) information for positions with up to 7 pieces.
+ * The WDL values take the 50-move rule into account, which makes them
+ * well suited for adjudicating games.
+ *
+ * The table files are memory-mapped when they're probed for the first
+ * time, and the same mapping is shared by every thread. All functions
+ * except initialize() and cleanup() are thread-safe.
+ *
+ * Only the table lookups are done here. The tables don't contain
+ * positions with castling rights and the stored values may be wrong
+ * when the best move is a capture, so the caller has to resolve
+ * captures and en-passant moves itself.
+ *
+ * \sa Chess::StandardBoard::tablebaseResult()
+ */
+class LIB_EXPORT SyzygyTablebase
+{
+	public:
+		/*! Win/draw/loss score from the side to move's perspective. */
+		enum WdlScore
+		{
+			Loss = -2,		//!< Loss
+			BlessedLoss = -1,	//!< Loss saved by the 50-move rule
+			Draw = 0,		//!< Draw
+			CursedWin = 1,		//!< Win spoiled by the 50-move rule
+			Win = 2			//!< Win
+		};
+
+		/*! The status of a table probe. */
+		enum ProbeStatus
+		{
+			ProbeFailed,	//!< Missing table or unreadable file
+			ProbeOk,	//!< Successful probe
+			/*!
+			 * The DTZ table only contains positions where the
+			 * other side is to move.
+			 */
+			ProbeChangeSide
+		};
+
+		/*! Synonym for QList< QPair<Chess::Square, Chess::Piece> >. */
+		typedef QList< QPair<Chess::Square, Chess::Piece> > PieceList;
+
+		/*!
+		 * Initializes the tablebases.
+		 *
+		 * The directories listed in \a paths are scanned for WDL
+		 * table files (.rtbw). Returns true if at least one table
+		 * was found; otherwise returns false.
+		 */
+		static bool initialize(const QStringList& paths);
+		/*!
+		 * Cleans up when the tablebases aren't needed any more.
+		 *
+		 * No other thread may be probing the tables at this point.
+		 */
+		static void cleanup();
+		/*!
+		 * Returns the number of pieces in the largest available
+		 * tables, or 0 if the tablebases are uninitialized.
+		 */
+		static int largest();
+
+		/*!
+		 * Looks up the WDL table for the position specified by
+		 * \a side and \a pieces, and stores the value in \a wdl.
+		 *
+		 * The position must not have castling rights.
+		 */
+		static ProbeStatus probeWdl(const Chess::Side& side,
+					    const PieceList& pieces,
+					    WdlScore* wdl);
+		/*!
+		 * Looks up the DTZ table for the position specified by
+		 * \a side and \a pieces, and stores the distance to the
+		 * next zeroing move in plies in \a dtz.
+		 *
+		 * \a wdl is the WDL value of the position, and it must not
+		 * be Draw. The returned distance is always positive.
+		 */
+		static ProbeStatus probeDtz(const Chess::Side& side,
+					    const PieceList& pieces,
+					    WdlScore wdl,
+					    int* dtz);
+
+	private:
+		SyzygyTablebase();
+};
+
+#endif // SYZYGYTABLEBASE_H
@@ -0,0 +1,217 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tablebasecache.h"
+#include <QMutexLocker>
+#include <QSharedMemory>
+#include <QSystemSemaphore>
+#include <cstring>
+#include <climits>
+
+// The header of a shared cache table
+struct TablebaseCacheHeader
+{
+	quint32 magic;
+	quint32 version;
+	qint32 count;
+	qint32 reserved;
+};
+
+static const quint32 s_sharedMagic = 0x43435442;
+static const quint32 s_sharedVersion = 1;
+
+
+TablebaseCache::TablebaseCache(int size)
+	: m_sharedMemory(0),
+	  m_sharedEntries(0),
+	  m_sharedMask(0)
+{
+	int count = StripeCount;
+	while (count < size)
+		count *= 2;
+
+	Entry empty = { 0, 0, false };
+	m_entries.fill(empty, count);
+}
+
+TablebaseCache::~TablebaseCache()
+{
+	delete m_sharedMemory;
+}
+
+bool TablebaseCache::attach(const QString& name, int size)
+{
+	if (m_sharedMemory != 0 && name == m_sharedName)
+		return true;
+
+	// The sizes are computed in 64 bits because QSharedMemory
+	// takes an int, and a big table would overflow it
+	qint64 count = 1;
+	while (count < size)
+		count *= 2;
+	const qint64 headerSize = sizeof(TablebaseCacheHeader);
+	const qint64 tableSize = headerSize + count * qint64(sizeof(SharedEntry));
+	if (tableSize > INT_MAX)
+	{
+		qWarning("Shared tablebase cache %s is too big: %d entries",
+			 qPrintable(name), size);
+		return false;
+	}
+
+	// Processes that start together must not both create the table,
+	// or see it before it's initialized
+	QSystemSemaphore guard(name + ".lock", 1);
+	if (!guard.acquire())
+	{
+		qWarning("Can't lock shared tablebase cache %s: %s",
+			 qPrintable(name), qPrintable(guard.errorString()));
+		return false;
+	}
+
+	QSharedMemory* memory = new QSharedMemory(name);
+	bool ok = memory->attach();
+	if (ok)
+	{
+		ok = memory->size() >= headerSize;
+		if (ok)
+		{
+			const TablebaseCacheHeader* header =
+				static_cast<const TablebaseCacheHeader*>(memory->constData());
+			const qint64 sharedCount = header->count;
+			ok = header->magic == s_sharedMagic
+			  && header->version == s_sharedVersion
+			  && sharedCount > 0
+			  && (sharedCount & (sharedCount - 1)) == 0
+			  && memory->size() >= headerSize
+					       + sharedCount * qint64(sizeof(SharedEntry));
+			if (ok)
+				count = sharedCount;
+		}
+
+		// The table was left by a crashed process before it was
+		// initialized, or it's of another version. On Unix the
+		// table outlives its processes, but detaching removes it
+		// if no other process uses it, so a new one can be created.
+		if (!ok)
+			memory->detach();
+	}
+	if (!ok && memory->create(int(tableSize)))
+	{
+		ok = true;
+		memset(memory->data(), 0, memory->size());
+		TablebaseCacheHeader* header =
+			static_cast<TablebaseCacheHeader*>(memory->data());
+		header->magic = s_sharedMagic;
+		header->version = s_sharedVersion;
+		header->count = qint32(count);
+		header->reserved = 0;
+	}
+	guard.release();
+
+	if (!ok)
+	{
+		qWarning("Can't share tablebase cache %s: %s",
+			 qPrintable(name), qPrintable(memory->errorString()));
+		delete memory;
+		return false;
+	}
+
+	delete m_sharedMemory;
+	m_sharedName = name;
+	m_sharedMemory = memory;
+	m_sharedEntries = reinterpret_cast<SharedEntry*>(
+		static_cast<char*>(memory->data()) + headerSize);
+	m_sharedMask = quint64(count - 1);
+
+	m_entries.clear();
+	return true;
+}
+
+bool TablebaseCache::isShared() const
+{
+	return m_sharedEntries != 0;
+}
+
+int TablebaseCache::index(quint64 key) const
+{
+	return int(key & quint64(m_entries.size() - 1));
+}
+
+bool TablebaseCache::probe(quint64 key, int* value) const
+{
+	if (m_sharedEntries != 0)
+	{
+		const volatile SharedEntry& entry = m_sharedEntries[key & m_sharedMask];
+		quint64 data = entry.data;
+		quint64 check = entry.check;
+		if ((data & 1) == 0 || (check ^ data) != key)
+			return false;
+
+		*value = int(quint32(data >> 1));
+		return true;
+	}
+
+	int i = index(key);
+	QMutexLocker locker(&m_mutex[i % StripeCount]);
+
+	const Entry& entry = m_entries.at(i);
+	if (!entry.valid || entry.key != key)
+		return false;
+
+	*value = entry.value;
+	return true;
+}
+
+void TablebaseCache::store(quint64 key, int value)
+{
+	if (m_sharedEntries != 0)
+	{
+		// The lowest bit marks a used entry
+		quint64 data = (quint64(quint32(value)) << 1) | 1;
+		volatile SharedEntry& entry = m_sharedEntries[key & m_sharedMask];
+		entry.check = key ^ data;
+		entry.data = data;
+		return;
+	}
+
+	int i = index(key);
+	QMutexLocker locker(&m_mutex[i % StripeCount]);
+
+	Entry& entry = m_entries[i];
+	entry.key = key;
+	entry.value = value;
+	entry.valid = true;
+}
+
+void TablebaseCache::clear()
+{
+	if (m_sharedEntries != 0)
+	{
+		for (quint64 i = 0; i <= m_sharedMask; i++)
+		{
+			m_sharedEntries[i].check = 0;
+			m_sharedEntries[i].data = 0;
+		}
+		return;
+	}
+
+	for (int i = 0; i < m_entries.size(); i++)
+	{
+		QMutexLocker locker(&m_mutex[i % StripeCount]);
+		m_entries[i].valid = false;
+	}
+}
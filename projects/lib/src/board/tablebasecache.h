@@ -0,0 +1,116 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TABLEBASECACHE_H
+#define TABLEBASECACHE_H
+
+#include <QVector>
+#include <QMutex>
+#include <QString>
+class QSharedMemory;
+
+/*!
+ * \brief A thread-safe cache for tablebase probe results.
+ *
+ * TablebaseCache maps zobrist position keys to integer values in a
+ * fixed-size table where a new entry replaces the old one in the same
+ * slot. The table is split into stripes that have their own locks, so
+ * games running in different threads rarely wait for each other.
+ *
+ * The cache can also be moved to shared memory with attach(), so that
+ * every process on the host that attaches to the same name uses the
+ * same results. The shared table has no locks: each entry stores its
+ * key XOR'ed with its data, so an entry that's being written by
+ * another process reads as a miss.
+ */
+class LIB_EXPORT TablebaseCache
+{
+	public:
+		/*!
+		 * Creates a new cache with at least \a size entries.
+		 *
+		 * The size is rounded up to a power of two.
+		 */
+		explicit TablebaseCache(int size = 0x10000);
+		/*! Detaches from the shared table and destroys the cache. */
+		~TablebaseCache();
+
+		/*!
+		 * Shares the cache with the other processes on the host
+		 * that attach to \a name.
+		 *
+		 * The first process creates a shared table of at least
+		 * \a size entries, and the others use it as it is. The
+		 * entries of the private table are dropped. Attaching
+		 * again to the same name does nothing.
+		 *
+		 * Returns true if successful; otherwise the cache stays
+		 * private and returns false. A table too big for shared
+		 * memory (2 GB) can't be created.
+		 *
+		 * \note On Unix the shared table and its lock outlive the
+		 * processes. A table left by processes that crashed is
+		 * reused as it is because its entries are still valid, or
+		 * replaced if it's invalid and unused. The lock is released
+		 * by the system when a process crashes. A table that is
+		 * invalid but still in use, eg. by an older version, makes
+		 * attach() fail until it's removed with \c ipcrm.
+		 */
+		bool attach(const QString& name, int size);
+		/*! Returns true if the cache is shared with other processes. */
+		bool isShared() const;
+
+		/*!
+		 * Looks up \a key and stores the cached value in \a value.
+		 *
+		 * Returns true if the key was found; otherwise returns false.
+		 */
+		bool probe(quint64 key, int* value) const;
+		/*! Stores \a value for \a key. */
+		void store(quint64 key, int value);
+		/*! Removes all entries from the cache. */
+		void clear();
+
+	private:
+		Q_DISABLE_COPY(TablebaseCache)
+
+		enum { StripeCount = 64 };
+
+		struct Entry
+		{
+			quint64 key;
+			int value;
+			bool valid;
+		};
+
+		struct SharedEntry
+		{
+			quint64 check;
+			quint64 data;
+		};
+
+		int index(quint64 key) const;
+
+		QVector<Entry> m_entries;
+		mutable QMutex m_mutex[StripeCount];
+		QString m_sharedName;
+		QSharedMemory* m_sharedMemory;
+		volatile SharedEntry* m_sharedEntries;
+		quint64 m_sharedMask;
+};
+
+#endif // TABLEBASECACHE_H
@@ -23,14 +23,15 @@
 
 namespace Chess {
 
-WesternBoard::WesternBoard(WesternZobrist* zobrist)
+WesternBoard::WesternBoard(const QSharedPointer<WesternZobrist>& zobrist)
 	: Board(zobrist),
 	  m_arwidth(0),
 	  m_sign(1),
 	  m_enpassantSquare(0),
 	  m_reversibleMoveCount(0),
 	  m_kingCanCapture(true),
-	  m_zobrist(zobrist)
+	  m_fastLegality(false),
+	  m_zobrist(zobrist.data())
 {
 	setPieceType(Pawn, tr("pawn"), "P");
 	setPieceType(Knight, tr("knight"), "N", KnightMovement);
@@ -55,9 +56,16 @@ bool WesternBoard::kingCanCapture() const
 	return true;
 }
 
+bool WesternBoard::hasStandardLegality() const
+{
+	return true;
+}
+
 void WesternBoard::vInitialize()
 {
 	m_kingCanCapture = kingCanCapture();
+	m_fastLegality = (hasBitboards() || hasWideBitboards())
+		      && hasStandardLegality();
 	m_arwidth = width() + 2;
 
 	m_castlingRights.rookSquare[Side::White][QueenSide] = 0;
@@ -94,6 +102,56 @@ void WesternBoard::vInitialize()
 	m_rookOffsets[1] = -1;
 	m_rookOffsets[2] = 1;
 	m_rookOffsets[3] = m_arwidth;
+
+	initAttackTable();
+}
+
+void WesternBoard::initAttackTable()
+{
+	m_attackIndex.clear();
+	m_attackTable.clear();
+	if (hasBitboards() || hasWideBitboards())
+		return;
+
+	// Squares in the wall point to an entry with no attack squares
+	int size = (height() + 4) * m_arwidth;
+	m_attackIndex.fill(0, size);
+	m_attackTable.fill(0, 1 + m_bishopOffsets.size() + m_rookOffsets.size());
+
+	for (int square = 0; square < size; square++)
+	{
+		if (!isValidSquare(chessSquare(square)))
+			continue;
+		m_attackIndex[square] = m_attackTable.size();
+
+		int lengthIndex = m_attackTable.size();
+		m_attackTable.append(0);
+		for (int i = 0; i < m_knightOffsets.size(); i++)
+		{
+			int target = square + m_knightOffsets[i];
+			if (!isValidSquare(chessSquare(target)))
+				continue;
+			m_attackTable.append(target);
+			m_attackTable[lengthIndex]++;
+		}
+
+		for (int i = 0; i < m_bishopOffsets.size() + m_rookOffsets.size(); i++)
+		{
+			int offset = (i < m_bishopOffsets.size()) ?
+				m_bishopOffsets[i] :
+				m_rookOffsets[i - m_bishopOffsets.size()];
+
+			lengthIndex = m_attackTable.size();
+			m_attackTable.append(0);
+			for (int target = square + offset;
+			     isValidSquare(chessSquare(target));
+			     target += offset)
+			{
+				m_attackTable.append(target);
+				m_attackTable[lengthIndex]++;
+			}
+		}
+	}
 }
 
 int WesternBoard::captureType(const Move& move) const
@@ -117,17 +175,14 @@ WesternBoard::CastlingSide WesternBoard::castlingSide(const Move& move) const
 	return NoCastlingSide;
 }
 
-QString WesternBoard::lanMoveString(const Move& move)
+Move WesternBoard::lanMove(const Move& move)
 {
 	CastlingSide cside = castlingSide(move);
 	if (cside != NoCastlingSide && !isRandomVariant())
-	{
-		Move tmp(move.sourceSquare(),
-			 m_castleTarget[sideToMove()][cside]);
-		return Board::lanMoveString(tmp);
-	}
+		return Move(move.sourceSquare(),
+			    m_castleTarget[sideToMove()][cside]);
 
-	return Board::lanMoveString(move);
+	return move;
 }
 
 QString WesternBoard::sanMoveString(const Move& move)
@@ -139,24 +194,10 @@ QString WesternBoard::sanMoveString(const Move& move)
 	Piece capture = pieceAt(target);
 	Square square = chessSquare(source);
 
-	char checkOrMate = 0;
-	makeMove(move);
-	if (inCheck(sideToMove()))
-	{
-		if (canMove())
-			checkOrMate = '+';
-		else
-			checkOrMate = '#';
-	}
-	undoMove();
-
 	// drop move
 	if (source == 0 && move.promotion() != Piece::NoPiece)
 	{
-		str = lanMoveString(move);
-		if (checkOrMate != 0)
-			str += checkOrMate;
-		return str;
+		return lanMoveString(move);
 	}
 
 	bool needRank = false;
@@ -179,8 +220,6 @@ QString WesternBoard::sanMoveString(const Move& move)
 				str = "O-O-O";
 			else
 				str = "O-O";
-			if (checkOrMate != 0)
-				str += checkOrMate;
 			return str;
 		}
 		else
@@ -200,7 +239,7 @@ QString WesternBoard::sanMoveString(const Move& move)
 			||  move2.targetSquare() != target)
 				continue;
 
-			if (!vIsLegalMove(move2))
+			if (!isLegalGeneratedMove(move2))
 				continue;
 
 			Square square2(chessSquare(move2.sourceSquare()));
@@ -223,16 +262,18 @@ QString WesternBoard::sanMoveString(const Move& move)
 	if (move.promotion() != Piece::NoPiece)
 		str += "=" + pieceSymbol(move.promotion()).toUpper();
 
-	if (checkOrMate != 0)
-		str += checkOrMate;
-
 	return str;
 }
 
-Move WesternBoard::moveFromLanString(const QString& str)
+QString WesternBoard::sanCheckSuffix()
 {
-	Move move(Board::moveFromLanString(str));
+	if (!inCheck(sideToMove()))
+		return QString();
+	return canMove() ? "+" : "#";
+}
 
+Move WesternBoard::moveFromLanMove(const Move& move)
+{
 	Side side = sideToMove();
 	int source = move.sourceSquare();
 	int target = move.targetSquare();
@@ -253,6 +294,66 @@ Move WesternBoard::moveFromLanString(const QString& str)
 	return move;
 }
 
+void WesternBoard::generateMovesTo(QVarLengthArray<Move>& moves,
+				   int pieceType,
+				   int target,
+				   const Square& source) const
+{
+	Side side = sideToMove();
+	int file = source.file();
+	int rank = source.rank();
+
+	// A pawn that doesn't capture stays on the target's file
+	if (pieceType == Pawn && file == -1)
+		file = chessSquare(target).file();
+
+	if (!hasBitboards())
+	{
+		for (int sq = 0; sq < arraySize(); sq++)
+		{
+			if (pieceAt(sq) != Piece(side, pieceType))
+				continue;
+			Square square(chessSquare(sq));
+			if ((file == -1 || square.file() == file)
+			&&  (rank == -1 || square.rank() == rank))
+				generateMovesForPiece(moves, pieceType, sq);
+		}
+		return;
+	}
+
+	quint64 pieces = sideBitboard(side) & typeBitboard(pieceType);
+	if (file != -1)
+		pieces &= Q_UINT64_C(0x0101010101010101) << file;
+	if (rank != -1)
+		pieces &= Q_UINT64_C(0xFF) << (rank * 8);
+
+	// Only the pieces that can reach the target square are needed.
+	// They're found by looking from the target square outward.
+	int sq = Bitboard::fromMailbox(target);
+	const unsigned sliders = KnightMovement | BishopMovement | RookMovement;
+	if (pieceType == King)
+		pieces &= Bitboard::kingAttacks(sq);
+	else if (pieceHasMovement(pieceType, sliders)
+	     &&  !pieceHasMovement(pieceType, ~sliders))
+	{
+		quint64 occupied = occupiedBitboard();
+		quint64 reach = 0;
+		if (pieceHasMovement(pieceType, KnightMovement))
+			reach |= Bitboard::knightAttacks(sq);
+		if (pieceHasMovement(pieceType, BishopMovement))
+			reach |= Bitboard::bishopAttacks(sq, occupied);
+		if (pieceHasMovement(pieceType, RookMovement))
+			reach |= Bitboard::rookAttacks(sq, occupied);
+		pieces &= reach;
+	}
+
+	while (pieces != 0)
+	{
+		int source = Bitboard::toMailbox(Bitboard::popLsb(pieces));
+		generateMovesForPiece(moves, pieceType, source);
+	}
+}
+
 Move WesternBoard::moveFromSanString(const QString& str)
 {
 	if (str.length() < 2)
@@ -406,21 +507,18 @@ Move WesternBoard::moveFromSanString(const QString& str)
 			return Move();
 	}
 
+	// Only generate the moves of the pieces that match the source
+	// square and could possibly reach the target square.
 	QVarLengthArray<Move> moves;
-	generateMoves(moves, piece.type());
+	generateMovesTo(moves, piece.type(), target, sourceSq);
 	const Move* match = 0;
 
-	// Loop through all legal moves to find a move that matches
+	// Loop through the moves to find a legal move that matches
 	// the data we got from the move string.
 	for (int i = 0; i < moves.size(); i++)
 	{
 		const Move& move = moves[i];
-		if (move.sourceSquare() == 0 || move.targetSquare() != target)
-			continue;
-		Square sourceSq2 = chessSquare(move.sourceSquare());
-		if (sourceSq.rank() != -1 && sourceSq2.rank() != sourceSq.rank())
-			continue;
-		if (sourceSq.file() != -1 && sourceSq2.file() != sourceSq.file())
+		if (move.targetSquare() != target)
 			continue;
 		// Castling moves were handled earlier
 		if (pieceAt(target) == Piece(side, Rook))
@@ -499,7 +597,9 @@ QString WesternBoard::castlingRightsString(FenNotation notation) const
 QString WesternBoard::vFenString(FenNotation notation) const
 {
 	// Castling rights
-	QString fen = castlingRightsString(notation) + ' ';
+	QString fen = castlingRightsString(notation);
+	fen.reserve(fen.size() + 16);
+	fen += ' ';
 
 	// En-passant square
 	if (m_enpassantSquare != 0)
@@ -659,7 +759,8 @@ bool WesternBoard::vSetFenString(const QStringList& fen)
 
 	// The full move number is ignored. It's rarely useful
 
-	m_history.clear();
+	m_history.reserve(HistoryReserve);
+	m_history.resize(0);
 	return true;
 }
 
@@ -803,7 +904,8 @@ void WesternBoard::vMakeMove(const Move& move, BoardTransition* transition)
 		}
 	}
 
-	if (captureType(move) != Piece::NoPiece)
+	// En-passant captures are already irreversible pawn moves
+	if (capture.side() == side.opposite())
 	{
 		removeCastlingRights(target);
 		isReversible = false;
@@ -887,14 +989,34 @@ void WesternBoard::generateMovesForPiece(QVarLengthArray<Move>& moves,
 					 int pieceType,
 					 int square) const
 {
-	if (pieceType == Pawn)
-		return generatePawnMoves(square, moves);
-	if (pieceType == King)
+	// The standard pieces move the same way in every western
+	// variant, so only the variant's own pieces need a lookup
+	// of their movement masks.
+	switch (pieceType)
 	{
+	case Pawn:
+		generatePawnMoves(square, moves);
+		return;
+	case Knight:
+		generateHoppingMoves(square, m_knightOffsets, moves);
+		return;
+	case Bishop:
+		generateSlidingMoves(square, m_bishopOffsets, moves);
+		return;
+	case Rook:
+		generateSlidingMoves(square, m_rookOffsets, moves);
+		return;
+	case Queen:
+		generateSlidingMoves(square, m_bishopOffsets, moves);
+		generateSlidingMoves(square, m_rookOffsets, moves);
+		return;
+	case King:
 		generateHoppingMoves(square, m_bishopOffsets, moves);
 		generateHoppingMoves(square, m_rookOffsets, moves);
 		generateCastlingMoves(moves);
 		return;
+	default:
+		break;
 	}
 
 	if (pieceHasMovement(pieceType, KnightMovement))
@@ -905,12 +1027,58 @@ void WesternBoard::generateMovesForPiece(QVarLengthArray<Move>& moves,
 		generateSlidingMoves(square, m_rookOffsets, moves);
 }
 
+void WesternBoard::generateCapturesForPiece(QVarLengthArray<Move>& moves,
+					    int pieceType,
+					    int square) const
+{
+	// Castling moves are never captures
+	switch (pieceType)
+	{
+	case Pawn:
+		generatePawnCaptures(square, moves);
+		return;
+	case Knight:
+		generateHoppingCaptures(square, m_knightOffsets, moves);
+		return;
+	case Bishop:
+		generateSlidingCaptures(square, m_bishopOffsets, moves);
+		return;
+	case Rook:
+		generateSlidingCaptures(square, m_rookOffsets, moves);
+		return;
+	case Queen:
+		generateSlidingCaptures(square, m_bishopOffsets, moves);
+		generateSlidingCaptures(square, m_rookOffsets, moves);
+		return;
+	case King:
+		generateHoppingCaptures(square, m_bishopOffsets, moves);
+		generateHoppingCaptures(square, m_rookOffsets, moves);
+		return;
+	default:
+		break;
+	}
+
+	if (pieceHasMovement(pieceType, KnightMovement))
+		generateHoppingCaptures(square, m_knightOffsets, moves);
+	if (pieceHasMovement(pieceType, BishopMovement))
+		generateSlidingCaptures(square, m_bishopOffsets, moves);
+	if (pieceHasMovement(pieceType, RookMovement))
+		generateSlidingCaptures(square, m_rookOffsets, moves);
+}
+
 bool WesternBoard::inCheck(Side side, int square) const
 {
 	Side opSide = side.opposite();
 	if (square == 0)
 		square = m_kingSquare[side];
-	
+
+	if (hasBitboards())
+		return isAttacked(Bitboard::fromMailbox(square), opSide,
+				  occupiedBitboard(), 0);
+	if (hasWideBitboards())
+		return isAttackedWide(WideBitboard::fromMailbox(square), opSide,
+				      wideOccupiedBitboard(), WideBitboard());
+
 	// Pawn attacks
 	int step = (side == Side::White) ? -m_arwidth : m_arwidth;
 	// Left side
@@ -921,56 +1089,188 @@ bool WesternBoard::inCheck(Side side, int square) const
 		return true;
 
 	Piece piece;
-	
+	const int* entry = m_attackTable.constData() + m_attackIndex.at(square);
+	const int* end = entry + 1 + *entry;
+
 	// Knight, archbishop, chancellor attacks
-	for (int i = 0; i < m_knightOffsets.size(); i++)
+	for (++entry; entry != end; ++entry)
 	{
-		piece = pieceAt(square + m_knightOffsets[i]);
+		piece = pieceAt(*entry);
 		if (piece.side() == opSide && pieceHasMovement(piece.type(), KnightMovement))
 			return true;
 	}
-	
-	// Bishop, queen, archbishop, king attacks
-	for (int i = 0; i < m_bishopOffsets.size(); i++)
+
+	// Bishop, queen, archbishop, king attacks, followed by
+	// rook, queen, chancellor, king attacks
+	int rayCount = m_bishopOffsets.size() + m_rookOffsets.size();
+	for (int i = 0; i < rayCount; i++)
 	{
-		int offset = m_bishopOffsets[i];
-		int targetSquare = square + offset;
-		if (m_kingCanCapture && targetSquare == m_kingSquare[opSide])
+		int length = *entry++;
+		end = entry + length;
+		if (length > 0 && m_kingCanCapture && *entry == m_kingSquare[opSide])
 			return true;
-		while ((piece = pieceAt(targetSquare)).isEmpty()
-		||     piece.side() == opSide)
+
+		int movement = (i < m_bishopOffsets.size()) ?
+			BishopMovement : RookMovement;
+		for (; entry != end; ++entry)
 		{
-			if (!piece.isEmpty())
-			{
-				if (pieceHasMovement(piece.type(), BishopMovement))
-					return true;
-				break;
-			}
-			targetSquare += offset;
+			piece = pieceAt(*entry);
+			if (piece.isEmpty())
+				continue;
+			if (piece.side() == opSide
+			&&  pieceHasMovement(piece.type(), movement))
+				return true;
+			break;
+		}
+		entry = end;
+	}
+
+	return false;
+}
+
+bool WesternBoard::isAttacked(int square,
+			      Side attacker,
+			      quint64 occupied,
+			      quint64 removed) const
+{
+	Q_ASSERT(hasBitboards());
+	Q_ASSERT(square >= 0 && square < 64);
+
+	quint64 opBits = sideBitboard(attacker) & ~removed;
+
+	// Pawn attacks
+	if (Bitboard::pawnAttacks(attacker.opposite(), square)
+	&   opBits & typeBitboard(Pawn))
+		return true;
+
+	// Knight, archbishop, chancellor attacks
+	if (Bitboard::knightAttacks(square)
+	&   opBits & movementBitboard(attacker, KnightMovement))
+		return true;
+
+	// King attacks
+	int opKingSq = Bitboard::fromMailbox(m_kingSquare[attacker]);
+	if (m_kingCanCapture && opKingSq != -1
+	&&  (Bitboard::kingAttacks(square) & opBits
+	     & Bitboard::squareBit(opKingSq)))
+		return true;
+
+	// Bishop, queen, archbishop attacks
+	if (Bitboard::bishopAttacks(square, occupied)
+	&   opBits & movementBitboard(attacker, BishopMovement))
+		return true;
+
+	// Rook, queen, chancellor attacks
+	if (Bitboard::rookAttacks(square, occupied)
+	&   opBits & movementBitboard(attacker, RookMovement))
+		return true;
+
+	return false;
+}
+
+bool WesternBoard::isAttackedWide(int square,
+				  Side attacker,
+				  const WideBitboard& occupied,
+				  const WideBitboard& removed) const
+{
+	Q_ASSERT(hasWideBitboards());
+	Q_ASSERT(square >= 0 && square < WideBitboard::SquareCount);
+
+	WideBitboard opBits(wideSideBitboard(attacker) & ~removed);
+
+	// Pawn attacks
+	if (!(WideBitboard::pawnAttacks(attacker.opposite(), square)
+	      & opBits & wideTypeBitboard(Pawn)).isEmpty())
+		return true;
+
+	// Knight, archbishop, chancellor attacks
+	if (!(WideBitboard::knightAttacks(square)
+	      & opBits & wideMovementBitboard(attacker, KnightMovement)).isEmpty())
+		return true;
+
+	// King attacks
+	int opKingSq = WideBitboard::fromMailbox(m_kingSquare[attacker]);
+	if (m_kingCanCapture && opKingSq != -1
+	&&  WideBitboard::kingAttacks(square).contains(opKingSq)
+	&&  opBits.contains(opKingSq))
+		return true;
+
+	// Bishop, queen, archbishop attacks
+	if (!(WideBitboard::bishopAttacks(square, occupied)
+	      & opBits & wideMovementBitboard(attacker, BishopMovement)).isEmpty())
+		return true;
+
+	// Rook, queen, chancellor attacks
+	if (!(WideBitboard::rookAttacks(square, occupied)
+	      & opBits & wideMovementBitboard(attacker, RookMovement)).isEmpty())
+		return true;
+
+	return false;
+}
+
+bool WesternBoard::isLegalWithoutCheck(const Move& move) const
+{
+	if (hasWideBitboards())
+		return isLegalWithoutCheckWide(move);
+
+	Side side = sideToMove();
+	int source = move.sourceSquare();
+	int target = move.targetSquare();
+	int kingSq = Bitboard::fromMailbox(m_kingSquare[side]);
+	quint64 targetBit = Bitboard::squareBit(Bitboard::fromMailbox(target));
+	quint64 occupied = occupiedBitboard();
+	quint64 removed = targetBit;
+
+	if (source != 0)
+	{
+		int sourceSq = Bitboard::fromMailbox(source);
+		occupied &= ~Bitboard::squareBit(sourceSq);
+		if (sourceSq == kingSq)
+			kingSq = Bitboard::fromMailbox(target);
+
+		// The pawn captured by an en-passant move isn't on the
+		// target square
+		if (target == m_enpassantSquare
+		&&  pieceAt(source).type() == Pawn)
+		{
+			int epSq = target + m_arwidth * m_sign;
+			removed = Bitboard::squareBit(Bitboard::fromMailbox(epSq));
+			occupied &= ~removed;
 		}
 	}
-	
-	// Rook, queen, chancellor, king attacks
-	for (int i = 0; i < m_rookOffsets.size(); i++)
+
+	return !isAttacked(kingSq, side.opposite(), occupied | targetBit, removed);
+}
+
+bool WesternBoard::isLegalWithoutCheckWide(const Move& move) const
+{
+	Side side = sideToMove();
+	int source = move.sourceSquare();
+	int target = move.targetSquare();
+	int kingSq = WideBitboard::fromMailbox(m_kingSquare[side]);
+	WideBitboard targetBit(WideBitboard::squareBit(WideBitboard::fromMailbox(target)));
+	WideBitboard occupied(wideOccupiedBitboard());
+	WideBitboard removed(targetBit);
+
+	if (source != 0)
 	{
-		int offset = m_rookOffsets[i];
-		int targetSquare = square + offset;
-		if (m_kingCanCapture && targetSquare == m_kingSquare[opSide])
-			return true;
-		while ((piece = pieceAt(targetSquare)).isEmpty()
-		||     piece.side() == opSide)
+		int sourceSq = WideBitboard::fromMailbox(source);
+		occupied &= ~WideBitboard::squareBit(sourceSq);
+		if (sourceSq == kingSq)
+			kingSq = WideBitboard::fromMailbox(target);
+
+		// The pawn captured by an en-passant move isn't on the
+		// target square
+		if (target == m_enpassantSquare
+		&&  pieceAt(source).type() == Pawn)
 		{
-			if (!piece.isEmpty())
-			{
-				if (pieceHasMovement(piece.type(), RookMovement))
-					return true;
-				break;
-			}
-			targetSquare += offset;
+			int epSq = target + m_arwidth * m_sign;
+			removed = WideBitboard::squareBit(WideBitboard::fromMailbox(epSq));
+			occupied &= ~removed;
 		}
 	}
-	
-	return false;
+
+	return !isAttackedWide(kingSq, side.opposite(), occupied | targetBit, removed);
 }
 
 bool WesternBoard::isLegalPosition()
@@ -1027,9 +1327,16 @@ bool WesternBoard::vIsLegalMove(const Move& move)
 
 	if (!m_kingCanCapture
 	&&  move.sourceSquare() == m_kingSquare[sideToMove()]
-	&&  captureType(move) != Piece::NoPiece)
+	&&  WesternBoard::captureType(move) != Piece::NoPiece)
 		return false;
 
+	// Castling moves need the whole path of the king to be
+	// checked, so they go through isLegalPosition()
+	if (m_fastLegality
+	&&  (move.sourceSquare() != m_kingSquare[sideToMove()]
+	     || castlingSide(move) == NoCastlingSide))
+		return isLegalWithoutCheck(move);
+
 	return Board::vIsLegalMove(move);
 }
 
@@ -1073,12 +1380,21 @@ void WesternBoard::generatePawnMoves(int sourceSquare,
 		}
 	}
 
+	generatePawnCaptures(sourceSquare, moves);
+}
+
+void WesternBoard::generatePawnCaptures(int sourceSquare,
+					QVarLengthArray<Move>& moves) const
+{
+	int step = m_sign * m_arwidth;
+	bool isPromotion = pieceAt(sourceSquare - step * 2).isWall();
+
 	// Captures, including en-passant moves
 	Side opSide(sideToMove().opposite());
 	for (int i = -1; i <= 1; i += 2)
 	{
-		targetSquare = sourceSquare - step + i;
-		capture = pieceAt(targetSquare);
+		int targetSquare = sourceSquare - step + i;
+		Piece capture = pieceAt(targetSquare);
 		if (capture.side() == opSide
 		||  targetSquare == m_enpassantSquare)
 		{
@@ -1202,17 +1518,14 @@ Result WesternBoard::result()
 	}
 
 	// Insufficient mating material
-	int material[2] = { 0, 0 };
-	for (int i = 0; i < arraySize(); i++)
+	// Knights and bishops are worth 1 point, everything else 2 points
+	int material[2];
+	for (int side = Side::White; side <= Side::Black; side++)
 	{
-		const Piece& piece = pieceAt(i);
-		if (!piece.isValid())
-			continue;
-
-		if (piece.type() == Knight || piece.type() == Bishop)
-			material[piece.side()] += 1;
-		else
-			material[piece.side()] += 2;
+		Side s = Side::Type(side);
+		material[side] = 2 * pieceCount(s)
+			       - pieceCount(s, Knight)
+			       - pieceCount(s, Bishop);
 	}
 	if (material[Side::White] <= 3 && material[Side::Black] <= 3)
 	{
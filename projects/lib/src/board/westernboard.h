@@ -52,7 +52,7 @@ class LIB_EXPORT WesternBoard : public Board
 		};
 
 		/*! Creates a new WesternBoard object. */
-		WesternBoard(WesternZobrist* zobrist);
+		WesternBoard(const QSharedPointer<WesternZobrist>& zobrist);
 
 		// Inherited from Board
 		virtual int width() const;
@@ -81,6 +81,17 @@ class LIB_EXPORT WesternBoard : public Board
 		 * \sa AtomicBoard
 		 */
 		virtual bool kingCanCapture() const;
+		/*!
+		 * Returns true if a move is legal exactly when it doesn't leave
+		 * the player's king under attack, as in standard chess.
+		 *
+		 * If true, legality of most moves is decided directly from the
+		 * bitboards without making and undoing the move. Variants that
+		 * reimplement inCheck() or isLegalPosition() with different
+		 * rules must return false. The default value is true.
+		 * \sa AtomicBoard
+		 */
+		virtual bool hasStandardLegality() const;
 		/*!
 		 * Adds pawn promotions to a move list.
 		 *
@@ -105,7 +116,7 @@ class LIB_EXPORT WesternBoard : public Board
 		 */
 		bool hasCastlingRight(Side side, CastlingSide castlingSide) const;
 		/*! Returns the number of consecutive reversible moves made. */
-		int reversibleMoveCount() const;
+		virtual int reversibleMoveCount() const;
 		/*!
 		 * Removes castling rights at \a square.
 		 *
@@ -124,9 +135,10 @@ class LIB_EXPORT WesternBoard : public Board
 		virtual void vInitialize();
 		virtual QString vFenString(FenNotation notation) const;
 		virtual bool vSetFenString(const QStringList& fen);
-		virtual QString lanMoveString(const Move& move);
+		virtual Move lanMove(const Move& move);
 		virtual QString sanMoveString(const Move& move);
-		virtual Move moveFromLanString(const QString& str);
+		virtual QString sanCheckSuffix();
+		virtual Move moveFromLanMove(const Move& move);
 		virtual Move moveFromSanString(const QString& str);
 		virtual void vMakeMove(const Move& move,
 				       BoardTransition* transition);
@@ -134,6 +146,9 @@ class LIB_EXPORT WesternBoard : public Board
 		virtual void generateMovesForPiece(QVarLengthArray<Move>& moves,
 						   int pieceType,
 						   int square) const;
+		virtual void generateCapturesForPiece(QVarLengthArray<Move>& moves,
+						      int pieceType,
+						      int square) const;
 		virtual bool vIsLegalMove(const Move& move);
 		virtual bool isLegalPosition();
 		virtual int captureType(const Move& move) const;
@@ -159,11 +174,28 @@ class LIB_EXPORT WesternBoard : public Board
 		void generateCastlingMoves(QVarLengthArray<Move>& moves) const;
 		void generatePawnMoves(int sourceSquare,
 				       QVarLengthArray<Move>& moves) const;
+		void generatePawnCaptures(int sourceSquare,
+					  QVarLengthArray<Move>& moves) const;
+		void generateMovesTo(QVarLengthArray<Move>& moves,
+				     int pieceType,
+				     int target,
+				     const Square& source) const;
 
 		bool canCastle(CastlingSide castlingSide) const;
 		QString castlingRightsString(FenNotation notation) const;
 		bool parseCastlingRights(QChar c);
 		CastlingSide castlingSide(const Move& move) const;
+		bool isAttacked(int square,
+				Side attacker,
+				quint64 occupied,
+				quint64 removed) const;
+		bool isAttackedWide(int square,
+				    Side attacker,
+				    const WideBitboard& occupied,
+				    const WideBitboard& removed) const;
+		bool isLegalWithoutCheck(const Move& move) const;
+		bool isLegalWithoutCheckWide(const Move& move) const;
+		void initAttackTable();
 		void setEnpassantSquare(int square);
 		void setCastlingSquare(Side side,
 				       CastlingSide cside,
@@ -175,6 +207,7 @@ class LIB_EXPORT WesternBoard : public Board
 		int m_enpassantSquare;
 		int m_reversibleMoveCount;
 		bool m_kingCanCapture;
+		bool m_fastLegality;
 		QVector<MoveData> m_history;
 		CastlingRights m_castlingRights;
 		int m_castleTarget[2][2];
@@ -183,6 +216,16 @@ class LIB_EXPORT WesternBoard : public Board
 		QVarLengthArray<int> m_knightOffsets;
 		QVarLengthArray<int> m_bishopOffsets;
 		QVarLengthArray<int> m_rookOffsets;
+
+		/*
+		 * Precomputed attack table for boards without (wide) bitboards.
+		 * For each square the table has the knight squares, then
+		 * one ray per bishop offset and one per rook offset. Each
+		 * list is stored as its length followed by the squares, so
+		 * no walls need to be tested when looking for attackers.
+		 */
+		QVector<int> m_attackIndex;
+		QVector<int> m_attackTable;
 };
 
 
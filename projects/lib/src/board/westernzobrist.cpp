@@ -17,11 +17,15 @@
 
 #include "westernzobrist.h"
 #include <QMutexLocker>
+#include <QHash>
 #include "piece.h"
 
 
 namespace Chess {
 
+static QMutex s_sharedMutex;
+static QHash< QString, QSharedPointer<WesternZobrist> > s_shared;
+
 WesternZobrist::WesternZobrist(const quint64* keys)
 	: Zobrist(keys),
 	  m_castlingIndex(0),
@@ -29,13 +33,28 @@ WesternZobrist::WesternZobrist(const quint64* keys)
 {
 }
 
+QSharedPointer<WesternZobrist> WesternZobrist::shared(const QString& variant,
+						     const quint64* keys)
+{
+	QMutexLocker locker(&s_sharedMutex);
+
+	QSharedPointer<WesternZobrist>& zobrist = s_shared[variant];
+	if (zobrist.isNull())
+		zobrist = QSharedPointer<WesternZobrist>(new WesternZobrist(keys));
+	return zobrist;
+}
+
 void WesternZobrist::initialize(int squareCount,
 				int pieceTypeCount)
 {
 	QMutexLocker locker(&m_mutex);
 
 	if (isInitialized())
+	{
+		Q_ASSERT(squareCount == this->squareCount());
+		Q_ASSERT(pieceTypeCount == this->pieceTypeCount());
 		return;
+	}
 
 	Zobrist::initialize(squareCount, pieceTypeCount);
 
@@ -20,6 +20,7 @@
 
 #include "zobrist.h"
 #include <QMutex>
+#include <QSharedPointer>
 
 namespace Chess {
 
@@ -36,6 +37,18 @@ class LIB_EXPORT WesternZobrist : public Zobrist
 		 */
 		WesternZobrist(const quint64* keys = 0);
 
+		/*!
+		 * Returns the zobrist keys shared by all boards of
+		 * \a variant.
+		 *
+		 * The keys are created on the first call, with \a keys as
+		 * the array of zobrist keys. Sharing them saves every new
+		 * board from initializing its own. This function is
+		 * thread-safe.
+		 */
+		static QSharedPointer<WesternZobrist> shared(const QString& variant,
+							     const quint64* keys = 0);
+
 		// Inherited from Zobrist
 		virtual void initialize(int squareCount,
 					int pieceTypeCount);
@@ -0,0 +1,107 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "widebitboard.h"
+
+namespace Chess {
+
+// The tables are defined before 's_initialized' so that they are
+// constructed before initialize() fills them
+int WideBitboard::s_fromMailbox[144];
+int WideBitboard::s_toMailbox[80];
+WideBitboard WideBitboard::s_knightAttacks[80];
+WideBitboard WideBitboard::s_kingAttacks[80];
+WideBitboard WideBitboard::s_pawnAttacks[2][80];
+WideBitboard WideBitboard::s_rays[8][80];
+bool WideBitboard::s_initialized = WideBitboard::initialize();
+
+static WideBitboard stepBit(int file, int rank)
+{
+	if (file < 0 || file >= 10 || rank < 0 || rank >= 8)
+		return WideBitboard();
+	return WideBitboard::squareBit(rank * 10 + file);
+}
+
+bool WideBitboard::initialize()
+{
+	static const int knightSteps[8][2] =
+	{
+		{ 1, 2 }, { 2, 1 }, { 2, -1 }, { 1, -2 },
+		{ -1, -2 }, { -2, -1 }, { -2, 1 }, { -1, 2 }
+	};
+	static const int kingSteps[8][2] =
+	{
+		{ 0, 1 }, { 1, 1 }, { 1, 0 }, { 1, -1 },
+		{ 0, -1 }, { -1, -1 }, { -1, 0 }, { -1, 1 }
+	};
+	// File and rank steps in the same order as enum Direction
+	static const int raySteps[8][2] =
+	{
+		{ 0, 1 }, { 1, 0 }, { 1, 1 }, { -1, 1 },
+		{ 0, -1 }, { -1, 0 }, { 1, -1 }, { -1, -1 }
+	};
+
+	for (int i = 0; i < 144; i++)
+		s_fromMailbox[i] = -1;
+
+	for (int sq = 0; sq < SquareCount; sq++)
+	{
+		int file = sq % 10;
+		int rank = sq / 10;
+
+		// The first two rows of the mailbox array are wall squares,
+		// and rank 8 comes first.
+		int index = (9 - rank) * 12 + 1 + file;
+		s_toMailbox[sq] = index;
+		s_fromMailbox[index] = sq;
+
+		s_knightAttacks[sq] = WideBitboard();
+		s_kingAttacks[sq] = WideBitboard();
+		for (int i = 0; i < 8; i++)
+		{
+			s_knightAttacks[sq] |= stepBit(file + knightSteps[i][0],
+						       rank + knightSteps[i][1]);
+			s_kingAttacks[sq] |= stepBit(file + kingSteps[i][0],
+						     rank + kingSteps[i][1]);
+		}
+
+		s_pawnAttacks[Side::White][sq] = stepBit(file - 1, rank + 1)
+					       | stepBit(file + 1, rank + 1);
+		s_pawnAttacks[Side::Black][sq] = stepBit(file - 1, rank - 1)
+					       | stepBit(file + 1, rank - 1);
+
+		for (int dir = 0; dir < 8; dir++)
+		{
+			WideBitboard ray;
+			int f = file + raySteps[dir][0];
+			int r = rank + raySteps[dir][1];
+			WideBitboard bit;
+			while (!(bit = stepBit(f, r)).isEmpty())
+			{
+				ray |= bit;
+				f += raySteps[dir][0];
+				r += raySteps[dir][1];
+			}
+			s_rays[dir][sq] = ray;
+		}
+	}
+
+	return true;
+}
+
+} // namespace Chess
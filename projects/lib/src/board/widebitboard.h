@@ -0,0 +1,342 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef WIDEBITBOARD_H
+#define WIDEBITBOARD_H
+
+#include <QtGlobal>
+#include "side.h"
+#include "bitboard.h"
+
+namespace Chess {
+
+/*!
+ * \brief A 128-bit bitboard and its attack tables for 10x8 boards.
+ *
+ * WideBitboard is the 10x8 counterpart of Bitboard, used by
+ * Capablanca chess and its relatives. The 80 squares don't fit in a
+ * 64-bit integer, so the bits are stored in two of them: bit 0 is
+ * square a1, bit 9 is j1 and bit 79 is j8. The lower integer has
+ * squares 0 to 63 and the upper integer squares 64 to 79.
+ *
+ * Chess::Board keeps a WideBitboard copy of the position for 10x8
+ * variants, just like it keeps a Bitboard copy for 8x8 variants.
+ *
+ * \note The mailbox functions assume the 12x12 array layout used
+ * by Chess::Board for 10x8 boards.
+ */
+class LIB_EXPORT WideBitboard
+{
+	public:
+		/*! The number of squares on the board. */
+		enum { SquareCount = 80 };
+
+		/*! Creates a new empty bitboard. */
+		WideBitboard();
+		/*!
+		 * Creates a new bitboard with squares 0 to 63 in \a low
+		 * and squares 64 to 79 in \a high.
+		 */
+		WideBitboard(quint64 low, quint64 high);
+
+		/*! Returns a bitboard with only \a square set. */
+		static WideBitboard squareBit(int square);
+		/*! Returns a bitboard with all squares of rank \a rank set. */
+		static WideBitboard rankMask(int rank);
+		/*! Returns a bitboard with all squares of file \a file set. */
+		static WideBitboard fileMask(int file);
+
+		/*! Returns true if no bits are set. */
+		bool isEmpty() const;
+		/*! Returns true if \a square is set. */
+		bool contains(int square) const;
+		/*! Returns the index of the least significant set bit. */
+		int lsb() const;
+		/*! Returns the index of the most significant set bit. */
+		int msb() const;
+		/*! Clears the least significant set bit and returns its index. */
+		int popLsb();
+		/*! Returns the number of set bits. */
+		int popCount() const;
+
+		WideBitboard operator&(const WideBitboard& other) const;
+		WideBitboard operator|(const WideBitboard& other) const;
+		WideBitboard operator^(const WideBitboard& other) const;
+		WideBitboard operator~() const;
+		WideBitboard& operator&=(const WideBitboard& other);
+		WideBitboard& operator|=(const WideBitboard& other);
+		WideBitboard& operator^=(const WideBitboard& other);
+		bool operator==(const WideBitboard& other) const;
+		bool operator!=(const WideBitboard& other) const;
+
+		/*!
+		 * Converts a 12x12 mailbox index into a bitboard square.
+		 * Returns -1 if \a index is a wall square.
+		 */
+		static int fromMailbox(int index);
+		/*! Converts bitboard square \a square into a 12x12 mailbox index. */
+		static int toMailbox(int square);
+
+		/*! Returns the squares attacked by a knight on \a square. */
+		static const WideBitboard& knightAttacks(int square);
+		/*! Returns the squares attacked by a king on \a square. */
+		static const WideBitboard& kingAttacks(int square);
+		/*! Returns the squares attacked by a pawn of \a side on \a square. */
+		static const WideBitboard& pawnAttacks(Side side, int square);
+		/*!
+		 * Returns the squares attacked by a bishop on \a square when
+		 * the squares in \a occupied are occupied.
+		 */
+		static WideBitboard bishopAttacks(int square,
+						  const WideBitboard& occupied);
+		/*!
+		 * Returns the squares attacked by a rook on \a square when
+		 * the squares in \a occupied are occupied.
+		 */
+		static WideBitboard rookAttacks(int square,
+						const WideBitboard& occupied);
+
+	private:
+		enum Direction
+		{
+			North,
+			East,
+			NorthEast,
+			NorthWest,
+			South,
+			West,
+			SouthEast,
+			SouthWest
+		};
+
+		static bool initialize();
+		static WideBitboard rayAttacks(int square,
+					       const WideBitboard& occupied,
+					       Direction direction);
+
+		quint64 m_low;
+		quint64 m_high;
+
+		static int s_fromMailbox[144];
+		static int s_toMailbox[80];
+		static WideBitboard s_knightAttacks[80];
+		static WideBitboard s_kingAttacks[80];
+		static WideBitboard s_pawnAttacks[2][80];
+		static WideBitboard s_rays[8][80];
+		static bool s_initialized;
+};
+
+
+inline WideBitboard::WideBitboard()
+	: m_low(0),
+	  m_high(0)
+{
+}
+
+inline WideBitboard::WideBitboard(quint64 low, quint64 high)
+	: m_low(low),
+	  m_high(high)
+{
+}
+
+inline WideBitboard WideBitboard::squareBit(int square)
+{
+	Q_ASSERT(square >= 0 && square < SquareCount);
+	if (square < 64)
+		return WideBitboard(Q_UINT64_C(1) << square, 0);
+	return WideBitboard(0, Q_UINT64_C(1) << (square - 64));
+}
+
+inline WideBitboard WideBitboard::rankMask(int rank)
+{
+	Q_ASSERT(rank >= 0 && rank < 8);
+	// The seventh rank (squares 60 to 69) straddles the two integers
+	const quint64 bits = Q_UINT64_C(0x3FF);
+	int shift = rank * 10;
+	if (shift + 10 <= 64)
+		return WideBitboard(bits << shift, 0);
+	if (shift >= 64)
+		return WideBitboard(0, bits << (shift - 64));
+	return WideBitboard(bits << shift, bits >> (64 - shift));
+}
+
+inline WideBitboard WideBitboard::fileMask(int file)
+{
+	Q_ASSERT(file >= 0 && file < 10);
+	// Squares file, file + 10, ..., file + 70
+	WideBitboard mask;
+	for (int rank = 0; rank < 8; rank++)
+		mask |= squareBit(rank * 10 + file);
+	return mask;
+}
+
+inline bool WideBitboard::isEmpty() const
+{
+	return (m_low | m_high) == 0;
+}
+
+inline bool WideBitboard::contains(int square) const
+{
+	return !(*this & squareBit(square)).isEmpty();
+}
+
+inline int WideBitboard::lsb() const
+{
+	Q_ASSERT(!isEmpty());
+	if (m_low != 0)
+		return Bitboard::lsb(m_low);
+	return 64 + Bitboard::lsb(m_high);
+}
+
+inline int WideBitboard::msb() const
+{
+	Q_ASSERT(!isEmpty());
+	if (m_high != 0)
+		return 64 + Bitboard::msb(m_high);
+	return Bitboard::msb(m_low);
+}
+
+inline int WideBitboard::popLsb()
+{
+	if (m_low != 0)
+		return Bitboard::popLsb(m_low);
+	return 64 + Bitboard::popLsb(m_high);
+}
+
+inline int WideBitboard::popCount() const
+{
+	return Bitboard::popCount(m_low) + Bitboard::popCount(m_high);
+}
+
+inline WideBitboard WideBitboard::operator&(const WideBitboard& other) const
+{
+	return WideBitboard(m_low & other.m_low, m_high & other.m_high);
+}
+
+inline WideBitboard WideBitboard::operator|(const WideBitboard& other) const
+{
+	return WideBitboard(m_low | other.m_low, m_high | other.m_high);
+}
+
+inline WideBitboard WideBitboard::operator^(const WideBitboard& other) const
+{
+	return WideBitboard(m_low ^ other.m_low, m_high ^ other.m_high);
+}
+
+inline WideBitboard WideBitboard::operator~() const
+{
+	// The bits above square 79 stay clear
+	return WideBitboard(~m_low, ~m_high & Q_UINT64_C(0xFFFF));
+}
+
+inline WideBitboard& WideBitboard::operator&=(const WideBitboard& other)
+{
+	m_low &= other.m_low;
+	m_high &= other.m_high;
+	return *this;
+}
+
+inline WideBitboard& WideBitboard::operator|=(const WideBitboard& other)
+{
+	m_low |= other.m_low;
+	m_high |= other.m_high;
+	return *this;
+}
+
+inline WideBitboard& WideBitboard::operator^=(const WideBitboard& other)
+{
+	m_low ^= other.m_low;
+	m_high ^= other.m_high;
+	return *this;
+}
+
+inline bool WideBitboard::operator==(const WideBitboard& other) const
+{
+	return m_low == other.m_low && m_high == other.m_high;
+}
+
+inline bool WideBitboard::operator!=(const WideBitboard& other) const
+{
+	return !(*this == other);
+}
+
+inline int WideBitboard::fromMailbox(int index)
+{
+	Q_ASSERT(index >= 0 && index < 144);
+	return s_fromMailbox[index];
+}
+
+inline int WideBitboard::toMailbox(int square)
+{
+	Q_ASSERT(square >= 0 && square < SquareCount);
+	return s_toMailbox[square];
+}
+
+inline const WideBitboard& WideBitboard::knightAttacks(int square)
+{
+	return s_knightAttacks[square];
+}
+
+inline const WideBitboard& WideBitboard::kingAttacks(int square)
+{
+	return s_kingAttacks[square];
+}
+
+inline const WideBitboard& WideBitboard::pawnAttacks(Side side, int square)
+{
+	Q_ASSERT(!side.isNull());
+	return s_pawnAttacks[side][square];
+}
+
+inline WideBitboard WideBitboard::rayAttacks(int square,
+					     const WideBitboard& occupied,
+					     Direction direction)
+{
+	const WideBitboard& attacks = s_rays[direction][square];
+	WideBitboard blockers(attacks & occupied);
+	if (blockers.isEmpty())
+		return attacks;
+
+	// The first four directions point towards higher bit indexes
+	int blocker = (direction < South) ? blockers.lsb() : blockers.msb();
+	return attacks ^ s_rays[direction][blocker];
+}
+
+inline WideBitboard WideBitboard::bishopAttacks(int square,
+						const WideBitboard& occupied)
+{
+	return rayAttacks(square, occupied, NorthEast)
+	     | rayAttacks(square, occupied, NorthWest)
+	     | rayAttacks(square, occupied, SouthEast)
+	     | rayAttacks(square, occupied, SouthWest);
+}
+
+inline WideBitboard WideBitboard::rookAttacks(int square,
+					      const WideBitboard& occupied)
+{
+	return rayAttacks(square, occupied, North)
+	     | rayAttacks(square, occupied, East)
+	     | rayAttacks(square, occupied, South)
+	     | rayAttacks(square, occupied, West);
+}
+
+} // namespace Chess
+
+Q_DECLARE_TYPEINFO(Chess::WideBitboard, Q_PRIMITIVE_TYPE);
+
+#endif // WIDEBITBOARD_H
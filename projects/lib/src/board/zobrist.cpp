@@ -77,7 +77,12 @@ void Zobrist::initialize(int squareCount,
 	QMutexLocker locker(&s_mutex);
 
 	if (m_initialized)
+	{
+		// Shared keys must always be used with the same geometry
+		Q_ASSERT(squareCount == m_squareCount);
+		Q_ASSERT(pieceTypeCount == m_pieceTypeCount);
 		return;
+	}
 
 	m_squareCount = squareCount;
 	m_pieceTypeCount = pieceTypeCount;
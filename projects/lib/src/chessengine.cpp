@@ -17,10 +17,15 @@
 
 #include "chessengine.h"
 #include <QIODevice>
-#include <QTimer>
 #include <QStringRef>
 #include <QtAlgorithms>
+#include "allocationstats.h"
 #include "engineoption.h"
+#include "engineprocess.h"
+#include "board/boardfactory.h"
+#include "clocktimer.h"
+#include "enginelog.h"
+#include "tracelog.h"
 
 
 int ChessEngine::s_count = 0;
@@ -74,28 +79,40 @@ ChessEngine::ChessEngine(QObject* parent)
 	  m_pingState(NotStarted),
 	  m_pinging(false),
 	  m_whiteEvalPov(false),
-	  m_pingTimer(new QTimer(this)),
-	  m_quitTimer(new QTimer(this)),
-	  m_idleTimer(new QTimer(this)),
+	  m_pondering(false),
+	  m_remote(false),
+	  m_roundTripTime(0),
+	  m_pingTimer(new ClockTimer(this)),
+	  m_quitTimer(new ClockTimer(this)),
+	  m_idleTimer(new ClockTimer(this)),
 	  m_ioDevice(0),
-	  m_restartMode(EngineConfiguration::RestartAuto)
+	  m_outFlushPending(false),
+	  m_bytesWritten(0),
+	  m_bytesRead(0),
+	  m_readPos(0),
+	  m_goDelay(0),
+	  m_firstReadDelay(0),
+	  m_clockPending(false),
+	  m_waitingForResponse(false),
+	  m_restartMode(EngineConfiguration::RestartAuto),
+	  m_analysisBoard(0)
 {
-	m_pingTimer->setSingleShot(true);
 	m_pingTimer->setInterval(10000);
 	connect(m_pingTimer, SIGNAL(timeout()), this, SLOT(onPingTimeout()));
 
-	m_quitTimer->setSingleShot(true);
 	m_quitTimer->setInterval(2000);
 	connect(m_quitTimer, SIGNAL(timeout()), this, SLOT(onQuitTimeout()));
 
-	m_idleTimer->setSingleShot(true);
 	m_idleTimer->setInterval(10000);
 	connect(m_idleTimer, SIGNAL(timeout()), this, SLOT(onIdleTimeout()));
 }
 
 ChessEngine::~ChessEngine()
 {
+	if (EngineLog::isEnabled())
+		EngineLog::close(m_id);
 	qDeleteAll(m_options);
+	delete m_analysisBoard;
 }
 
 QIODevice* ChessEngine::device() const
@@ -109,11 +126,30 @@ void ChessEngine::setDevice(QIODevice* device)
 
 	m_ioDevice = device;
 	m_ioDevice->setParent(this);
+	m_readBuffer.clear();
+	m_readPos = 0;
 
 	connect(m_ioDevice, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
 	connect(m_ioDevice, SIGNAL(readChannelFinished()), this, SLOT(onCrashed()));
 }
 
+bool ChessEngine::isRemote() const
+{
+	return m_remote;
+}
+
+void ChessEngine::setRemote(bool remote)
+{
+	m_remote = remote;
+	if (!remote)
+		m_roundTripTime = 0;
+}
+
+int ChessEngine::roundTripTime() const
+{
+	return m_roundTripTime;
+}
+
 void ChessEngine::applyConfiguration(const EngineConfiguration& configuration)
 {
 	if (!configuration.name().isEmpty())
@@ -126,6 +162,7 @@ void ChessEngine::applyConfiguration(const EngineConfiguration& configuration)
 		setOption(option->name(), option->value());
 
 	m_whiteEvalPov = configuration.whiteEvalPov();
+	m_pondering = configuration.pondering();
 	m_restartMode = configuration.restartMode();
 	setClaimsValidated(configuration.areClaimsValidated());
 }
@@ -173,6 +210,22 @@ void ChessEngine::setOption(const QString& name, const QVariant& value)
 	sendOption(option->name(), option->value());
 }
 
+void ChessEngine::applyOptions(const QMap<QString, QVariant>& options)
+{
+	QMap<QString, QVariant>::const_iterator i;
+	for (i = options.constBegin(); i != options.constEnd(); ++i)
+	{
+		// The values of a starting engine are still buffered
+		if (state() != Starting && state() != NotStarted)
+		{
+			EngineOption* option = getOption(i.key());
+			if (option != 0 && option->value() == i.value())
+				continue;
+		}
+		setOption(i.key(), i.value());
+	}
+}
+
 QList<EngineOption*> ChessEngine::options() const
 {
 	return m_options;
@@ -227,9 +280,18 @@ void ChessEngine::onProtocolStart()
 
 void ChessEngine::go()
 {
+	sampleResources();
 	if (state() == Observing)
 		ping();
 	ChessPlayer::go();
+
+	// The "go" command reaches the engine when the output is flushed,
+	// so the clock is restarted in flushOutput().
+	if (state() == Thinking && isReady())
+	{
+		m_clockPending = true;
+		m_goTime.start();
+	}
 }
 
 EngineConfiguration::RestartMode ChessEngine::restartMode() const
@@ -247,9 +309,17 @@ bool ChessEngine::whiteEvalPov() const
 	return m_whiteEvalPov;
 }
 
+bool ChessEngine::pondering() const
+{
+	return m_pondering;
+}
+
 void ChessEngine::endGame(const Chess::Result& result)
 {
+	sampleResources();
 	ChessPlayer::endGame(result);
+	m_clockPending = false;
+	m_waitingForResponse = false;
 
 	if (restartsBetweenGames())
 		quit();
@@ -302,15 +372,35 @@ void ChessEngine::kill()
 
 	m_pinging = false;
 	m_pingTimer->stop();
+	m_quitTimer->stop();
 	m_writeBuffer.clear();
+	m_outBuffer.clear();
 
 	disconnect(m_ioDevice, SIGNAL(readChannelFinished()),
 		   this, SLOT(onCrashed()));
+	disconnect(m_ioDevice, SIGNAL(readChannelFinished()),
+		   this, SLOT(onQuitTimeout()));
 	m_ioDevice->close();
 
 	ChessPlayer::kill();
 }
 
+void ChessEngine::onCrashed()
+{
+#if defined(Q_OS_WIN32) || defined(Q_OS_UNIX)
+	// The end of the error output may tell why the engine crashed
+	EngineProcess* process = qobject_cast<EngineProcess*>(m_ioDevice);
+	if (process != 0)
+	{
+		QByteArray tail(process->standardErrorTail().trimmed());
+		if (!tail.isEmpty())
+			qWarning("%s crashed, its last error output was:\n%s",
+				 qPrintable(name()), tail.constData());
+	}
+#endif
+	ChessPlayer::onCrashed();
+}
+
 void ChessEngine::onTimeout()
 {
 	stopThinking();
@@ -327,6 +417,7 @@ void ChessEngine::ping()
 	m_pinging = true;
 	m_pingState = state();
 	m_pingTimer->start();
+	m_pingTime.start();
 }
 
 void ChessEngine::pong()
@@ -336,6 +427,18 @@ void ChessEngine::pong()
 
 	m_pingTimer->stop();
 	m_pinging = false;
+	if (m_pingTime.isValid())
+	{
+		int elapsed = int(m_pingTime.elapsed());
+		m_pingTime.invalidate();
+
+		if (m_remote
+		&&  (m_roundTripTime == 0 || elapsed < m_roundTripTime))
+			m_roundTripTime = qMax(elapsed, 1);
+
+		QMutexLocker locker(&m_statsMutex);
+		m_pingStats.addSample(elapsed);
+	}
 	flushWriteBuffer();
 
 	if (state() == FinishingGame)
@@ -370,6 +473,18 @@ void ChessEngine::onPingTimeout()
 
 void ChessEngine::write(const QString& data, WriteMode mode)
 {
+	write(data.toLatin1(), mode);
+}
+
+void ChessEngine::write(const char* data, WriteMode mode)
+{
+	write(QByteArray(data), mode);
+}
+
+void ChessEngine::write(const QByteArray& data, WriteMode mode)
+{
+	ALLOCATION_SCOPE(Engine);
+
 	if (state() == Disconnected)
 		return;
 	if (state() == NotStarted
@@ -380,31 +495,215 @@ void ChessEngine::write(const QString& data, WriteMode mode)
 	}
 
 	Q_ASSERT(m_ioDevice->isWritable());
-	emit debugMessage(QString(">%1(%2): %3")
-			  .arg(name())
-			  .arg(m_id)
-			  .arg(data));
+	if (receivers(SIGNAL(debugMessage(QString))) > 0)
+		emit debugMessage(QString(">%1(%2): %3")
+				  .arg(name())
+				  .arg(m_id)
+				  .arg(QString::fromLatin1(data)));
+	if (EngineLog::isEnabled())
+		EngineLog::write(m_id, name(), '>', data);
+
+	if (TraceLog::isEnabled())
+	{
+		QVariantMap args;
+		args["engine"] = name();
+		args["line"] = QString::fromLatin1(data);
+		TraceLog::instant("engine", "write", args);
+	}
+
+	m_outBuffer += data;
+	m_outBuffer += '\n';
+	m_bytesWritten += data.size() + 1;
+
+	// Every write to the device is a system call on an unbuffered
+	// pipe, so the lines are sent together once control returns to
+	// the event loop.
+	if (!m_outFlushPending)
+	{
+		m_outFlushPending = true;
+		QMetaObject::invokeMethod(this, "flushOutput", Qt::QueuedConnection);
+	}
+}
+
+void ChessEngine::flushOutput()
+{
+	ALLOCATION_SCOPE(Engine);
+
+	m_outFlushPending = false;
+	if (m_outBuffer.isEmpty())
+		return;
+
+	if (state() != Disconnected && m_ioDevice->isWritable())
+		m_ioDevice->write(m_outBuffer);
+	m_outBuffer.clear();
+
+	if (m_clockPending)
+	{
+		m_clockPending = false;
+		m_goDelay = m_goTime.nsecsElapsed();
+		restartClock();
+		m_firstReadDelay = 0;
+
+		m_waitingForResponse = true;
+		m_responseTime.start();
+	}
+}
+
+qint64 ChessEngine::moveDelay() const
+{
+	if (!m_readTime.isValid())
+		return 0;
+	return m_readTime.nsecsElapsed() + qint64(m_roundTripTime) * 1000000;
+}
 
-	m_ioDevice->write(data.toLatin1() + "\n");
+qint64 ChessEngine::moveOverhead() const
+{
+	// The first output after "go" waits in the pipe and in the event
+	// queue about as long as the move does, and the engine rarely
+	// needs long to say something. It's an upper bound that grows
+	// with the load of the host, which is what the refund is for.
+	return m_firstReadDelay;
+}
+
+int ChessEngine::id() const
+{
+	return m_id;
+}
+
+quint64 ChessEngine::bytesWritten() const
+{
+	return m_bytesWritten;
+}
+
+quint64 ChessEngine::bytesRead() const
+{
+	return m_bytesRead;
+}
+
+LatencyStats ChessEngine::pingStats() const
+{
+	QMutexLocker locker(&m_statsMutex);
+	return m_pingStats;
+}
+
+LatencyStats ChessEngine::responseStats() const
+{
+	QMutexLocker locker(&m_statsMutex);
+	return m_responseStats;
+}
+
+ResourceStats ChessEngine::resourceStats() const
+{
+	QMutexLocker locker(&m_statsMutex);
+	return m_resourceStats;
+}
+
+void ChessEngine::sampleResources()
+{
+#if defined(Q_OS_WIN32) || defined(Q_OS_UNIX)
+	EngineProcess* process = qobject_cast<EngineProcess*>(m_ioDevice);
+	qint64 cpuTime;
+	qint64 memory;
+	int threads;
+	if (process == 0 || !process->resourceUsage(&cpuTime, &memory, &threads))
+		return;
+	qint64 throttledTime;
+	int throttleCount;
+	int memoryEvents;
+	bool throttled = process->throttleStats(&throttledTime, &throttleCount,
+						&memoryEvents);
+
+	QMutexLocker locker(&m_statsMutex);
+	m_resourceStats.addSample(cpuTime, memory, threads);
+	if (throttled)
+		m_resourceStats.setThrottling(throttledTime, throttleCount,
+					      memoryEvents);
+#endif
 }
 
 void ChessEngine::onReadyRead()
 {
-	while (m_ioDevice->isReadable() && m_ioDevice->canReadLine())
+	ALLOCATION_SCOPE(Engine);
+
+	if (!m_ioDevice->isReadable())
+		return;
+
+	QByteArray data(m_ioDevice->readAll());
+	m_readTime.start();
+	m_bytesRead += data.size();
+	m_readBuffer += data;
+
+	if (m_waitingForResponse && !data.isEmpty())
 	{
-		QString line = QString(m_ioDevice->readLine());
-		if (line.endsWith('\n'))
-			line.chop(1);
-		if (line.endsWith('\r'))
-			line.chop(1);
-		if (line.isEmpty())
+		m_firstReadDelay = m_responseTime.nsecsElapsed();
+		int elapsed = int(m_firstReadDelay / 1000000);
+		m_waitingForResponse = false;
+		m_responseTime.invalidate();
+
+		QMutexLocker locker(&m_statsMutex);
+		m_responseStats.addSample(elapsed);
+	}
+
+	// Lines are sliced out of the persistent read buffer. 'm_readPos'
+	// is a member so that the buffer stays consistent if parseLine()
+	// ends up calling this function again.
+	int end;
+	while ((end = m_readBuffer.indexOf('\n', m_readPos)) != -1)
+	{
+		int start = m_readPos;
+		int length = end - start;
+		m_readPos = end + 1;
+
+		if (length > 0 && m_readBuffer.at(end - 1) == '\r')
+			length--;
+		if (length == 0)
 			continue;
 
-		emit debugMessage(QString("<%1(%2): %3")
-				  .arg(name())
-				  .arg(m_id)
-				  .arg(line));
+		// Decode the line like QString(QByteArray) does: as UTF-8
+		// on Qt 5, and with the codec for C strings on Qt 4
+#if QT_VERSION >= 0x050000
+		QString line(QString::fromUtf8(m_readBuffer.constData() + start,
+					       length));
+#else
+		QString line(QString::fromAscii(m_readBuffer.constData() + start,
+						length));
+#endif
+		if (EngineLog::isEnabled())
+			EngineLog::write(m_id, name(), '<',
+					 QByteArray(m_readBuffer.constData() + start,
+						    length));
+
+		// Formatting the debug message is expensive for verbose
+		// engines, so only do it if someone is listening.
+		if (receivers(SIGNAL(debugMessage(QString))) > 0)
+			emit debugMessage(QString("<%1(%2): %3")
+					  .arg(name())
+					  .arg(m_id)
+					  .arg(line));
+		if (TraceLog::isEnabled())
+		{
+			QVariantMap args;
+			args["engine"] = name();
+			args["line"] = line;
+			TraceLog::instant("engine", "read", args);
+		}
+
+		bool thinking = (state() == Thinking);
 		parseLine(line);
+		if (thinking && state() == Observing
+		&&  receivers(SIGNAL(debugMessage(QString))) > 0)
+			emit debugMessage(QString("*%1(%2): move time %3 ms "
+						  "(%4 ms raw), %5 us to send go, "
+						  "%6 us to process the move")
+					  .arg(name())
+					  .arg(m_id)
+					  .arg(timeControl()->lastMoveTimeNsecs() / 1000000.0, 0, 'f', 3)
+					  .arg(timeControl()->lastRawMoveTime())
+					  .arg(m_goDelay / 1000)
+					  .arg(m_readTime.nsecsElapsed() / 1000));
+
+		if (!m_ioDevice->isReadable())
+			break;
 
 		if (m_idleTimer->isActive())
 		{
@@ -414,6 +713,10 @@ void ChessEngine::onReadyRead()
 				m_idleTimer->stop();
 		}
 	}
+
+	m_readBuffer.remove(0, m_readPos);
+	m_readPos = 0;
+	m_readTime.invalidate();
 }
 
 void ChessEngine::flushWriteBuffer()
@@ -421,7 +724,7 @@ void ChessEngine::flushWriteBuffer()
 	if (m_pinging || state() == NotStarted)
 		return;
 
-	foreach (const QString& line, m_writeBuffer)
+	foreach (const QByteArray& line, m_writeBuffer)
 		write(line);
 	m_writeBuffer.clear();
 }
@@ -440,6 +743,106 @@ void ChessEngine::onQuitTimeout()
 	ChessPlayer::quit();
 }
 
+void ChessEngine::analyze(const QString& variant,
+			  const QString& startingFen,
+			  const QVector<Chess::GenericMove>& moves)
+{
+	m_analysisVariant = variant;
+	m_analysisFen = startingFen;
+	m_analysisRequest = moves;
+
+	updateAnalysis();
+}
+
+void ChessEngine::updateAnalysis()
+{
+	disconnect(this, SIGNAL(ready()), this, SLOT(updateAnalysis()));
+	State s = state();
+	if (s == Disconnected)
+		return;
+	if (!isReady() || (s != Idle && s != Analyzing))
+	{
+		connect(this, SIGNAL(ready()), this, SLOT(updateAnalysis()));
+		return;
+	}
+	if (!supportsVariant(m_analysisVariant))
+	{
+		endAnalysis();
+		return;
+	}
+
+	if (s != Analyzing
+	||  m_analysisBoard->variant() != m_analysisVariant
+	||  m_analysisStartFen != m_analysisFen)
+	{
+		Chess::Board* board = Chess::BoardFactory::create(m_analysisVariant);
+		if (board == 0 || !board->setFenString(m_analysisFen))
+		{
+			qWarning("Invalid analysis position: %s",
+				 qPrintable(m_analysisFen));
+			delete board;
+			return;
+		}
+
+		setBoard(board);
+		delete m_analysisBoard;
+		m_analysisBoard = board;
+		m_analysisStartFen = m_analysisFen;
+		m_analysisMoves.clear();
+		setState(Analyzing);
+		sendAnalysisStart();
+	}
+	else if (m_analysisMoves == m_analysisRequest)
+		return;
+
+	// Only send the moves that differ from the previous position
+	int common = 0;
+	while (common < m_analysisMoves.size()
+	&&     common < m_analysisRequest.size()
+	&&     m_analysisMoves.at(common) == m_analysisRequest.at(common))
+		common++;
+
+	while (m_analysisMoves.size() > common)
+	{
+		sendAnalysisUndo();
+		m_analysisBoard->undoMove();
+		m_analysisMoves.removeLast();
+	}
+	for (int i = common; i < m_analysisRequest.size(); i++)
+	{
+		const Chess::GenericMove& genericMove = m_analysisRequest.at(i);
+		Chess::Move move(m_analysisBoard->moveFromGenericMove(genericMove));
+		if (move.isNull())
+		{
+			qWarning("Illegal analysis move at ply %d", i + 1);
+			break;
+		}
+
+		sendAnalysisMove(move);
+		m_analysisBoard->makeMove(move);
+		m_analysisMoves.append(genericMove);
+	}
+
+	setBoard(m_analysisBoard);
+	m_eval.clear();
+	sendAnalysisGo();
+}
+
+void ChessEngine::endAnalysis()
+{
+	disconnect(this, SIGNAL(ready()), this, SLOT(updateAnalysis()));
+	if (state() != Analyzing)
+		return;
+
+	sendAnalysisEnd();
+	setBoard(0);
+	delete m_analysisBoard;
+	m_analysisBoard = 0;
+	m_analysisStartFen.clear();
+	m_analysisMoves.clear();
+	setState(Idle);
+}
+
 void ChessEngine::quit()
 {
 	if (!m_ioDevice || !m_ioDevice->isOpen() || state() == Disconnected)
@@ -21,7 +21,13 @@
 #include "chessplayer.h"
 #include <QVariant>
 #include <QStringList>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QVector>
 #include "engineconfiguration.h"
+#include "latencystats.h"
+#include "resourcestats.h"
+#include "board/genericmove.h"
 
 class QIODevice;
 class EngineOption;
@@ -61,6 +67,26 @@ class LIB_EXPORT ChessEngine : public ChessPlayer
 		QIODevice* device() const;
 		/*! Sets the current device to \a device. */
 		void setDevice(QIODevice* device);
+		/*!
+		 * Returns true if the engine runs on a remote worker node.
+		 *
+		 * \sa setRemote()
+		 */
+		bool isRemote() const;
+		/*!
+		 * Marks the engine as remote if \a remote is true.
+		 *
+		 * The moves of a remote engine are not charged the network
+		 * round-trip time, which is estimated by the fastest ping
+		 * reply (see roundTripTime()).
+		 */
+		void setRemote(bool remote);
+		/*!
+		 * Returns the estimated network round-trip time in
+		 * milliseconds, or 0 if the engine isn't remote or it
+		 * hasn't replied to a ping yet.
+		 */
+		int roundTripTime() const;
 
 		// Inherited from ChessPlayer
 		virtual void endGame(const Chess::Result& result);
@@ -88,6 +114,14 @@ class LIB_EXPORT ChessEngine : public ChessPlayer
 		 */
 		void ping();
 		
+		/*!
+		 * Returns the engine's unique id number.
+		 *
+		 * The id stays valid for the lifetime of the program, even
+		 * after the engine object is destroyed.
+		 */
+		int id() const;
+
 		/*! Returns the engine's chess protocol. */
 		virtual QString protocol() const = 0;
 
@@ -95,9 +129,50 @@ class LIB_EXPORT ChessEngine : public ChessPlayer
 		 * Writes text data to the chess engine.
 		 *
 		 * If \a mode is \a Unbuffered, the data will be written to
-		 * the device immediately even if the engine is being pinged.
+		 * the device even if the engine is being pinged.
+		 *
+		 * \note Lines written during one event loop iteration are
+		 * coalesced and sent to the device in a single write when
+		 * control returns to the event loop.
 		 */
 		void write(const QString& data, WriteMode mode = Buffered);
+		/*!
+		 * Writes Latin-1 encoded \a data to the chess engine.
+		 *
+		 * This overload lets protocols that keep their commands in
+		 * byte buffers skip the QString conversion.
+		 */
+		void write(const QByteArray& data, WriteMode mode = Buffered);
+		/*! Writes the null-terminated Latin-1 string \a data. */
+		void write(const char* data, WriteMode mode = Buffered);
+
+		/*! Returns the number of bytes written to the engine. */
+		quint64 bytesWritten() const;
+		/*! Returns the number of bytes read from the engine. */
+		quint64 bytesRead() const;
+		/*!
+		 * Returns the round-trip times of the pings sent to the
+		 * engine during its lifetime.
+		 *
+		 * \note This function is thread-safe.
+		 */
+		LatencyStats pingStats() const;
+		/*!
+		 * Returns the delays between telling the engine to start
+		 * thinking and receiving its first output.
+		 *
+		 * \note This function is thread-safe.
+		 */
+		LatencyStats responseStats() const;
+		/*!
+		 * Returns the resource usage of the engine process, sampled
+		 * when the engine starts thinking and when a game ends.
+		 * The statistics are empty if the engine doesn't run as a
+		 * local process.
+		 *
+		 * \note This function is thread-safe.
+		 */
+		ResourceStats resourceStats() const;
 
 		/*!
 		 * Sets an option with the name \a name to \a value.
@@ -106,12 +181,51 @@ class LIB_EXPORT ChessEngine : public ChessPlayer
 		 * nothing happens.
 		 */
 		void setOption(const QString& name, const QVariant& value);
+		/*!
+		 * Sets the options in \a options, which maps option names
+		 * to values.
+		 *
+		 * Unlike setOption(), only the options whose values differ
+		 * from the engine's current values are sent, so a reused
+		 * engine doesn't redo eg. an expensive hash table resize.
+		 */
+		void applyOptions(const QMap<QString, QVariant>& options);
 
 		/*! Returns a list of supported options and their values. */
 		QList<EngineOption*> options() const;
 
 		/*! Returns a list of supported chess variants. */
 		QStringList variants() const;
+
+		/*!
+		 * Analyzes the position reached by playing \a moves from
+		 * \a startingFen in \a variant, with infinite thinking time.
+		 *
+		 * The engine must not be playing a game. If it isn't ready
+		 * yet, the analysis starts when it is. If the engine is
+		 * already analyzing a position of the same variant and
+		 * starting position, only the moves that differ from the
+		 * previous position are sent to it, and the engine doesn't
+		 * start a new game. This keeps the engine's hash tables and
+		 * makes browsing a game fast.
+		 *
+		 * The analysis is reported with the analysisUpdated() signal.
+		 */
+		void analyze(const QString& variant,
+			     const QString& startingFen,
+			     const QVector<Chess::GenericMove>& moves);
+		/*! Stops the analysis and returns the engine to Idle state. */
+		void endAnalysis();
+
+	signals:
+		/*!
+		 * This signal is emitted when the engine reports new search
+		 * information while analyzing.
+		 *
+		 * The score of \a eval is from the point of view of the
+		 * side to move.
+		 */
+		void analysisUpdated(const MoveEvaluation& eval);
 		
 	public slots:
 		// Inherited from ChessPlayer
@@ -172,6 +286,24 @@ class LIB_EXPORT ChessEngine : public ChessPlayer
 		/*! Sends the quit command to the engine. */
 		virtual void sendQuit() = 0;
 
+		/*!
+		 * Prepares the engine for analyzing positions that start
+		 * from board()'s current position.
+		 */
+		virtual void sendAnalysisStart() = 0;
+		/*! Takes back the last move sent with sendAnalysisMove(). */
+		virtual void sendAnalysisUndo() = 0;
+		/*!
+		 * Sends \a move to the engine during analysis.
+		 *
+		 * board() is in the position before \a move.
+		 */
+		virtual void sendAnalysisMove(const Chess::Move& move) = 0;
+		/*! Tells the engine to analyze board()'s current position. */
+		virtual void sendAnalysisGo() = 0;
+		/*! Tells the engine to stop analyzing. */
+		virtual void sendAnalysisEnd() = 0;
+
 		/*! Tells the engine to stop thinking and move now. */
 		void stopThinking();
 
@@ -203,9 +335,16 @@ class LIB_EXPORT ChessEngine : public ChessPlayer
 
 		/*! Are evaluation scores from white's point of view? */
 		bool whiteEvalPov() const;
+		/*! Is the engine allowed to ponder? */
+		bool pondering() const;
+
+		// Inherited from ChessPlayer
+		virtual qint64 moveDelay() const;
+		virtual qint64 moveOverhead() const;
 
 	protected slots:
 		// Inherited from ChessPlayer
+		virtual void onCrashed();
 		virtual void onTimeout();
 
 		/*! Reads input from the engine. */
@@ -235,23 +374,54 @@ class LIB_EXPORT ChessEngine : public ChessPlayer
 
 	private slots:
 		void onQuitTimeout();
+		void flushOutput();
+		void updateAnalysis();
 
 	private:
+		void sampleResources();
+
 		static int s_count;
 
 		int m_id;
 		State m_pingState;
 		bool m_pinging;
 		bool m_whiteEvalPov;
-		QTimer* m_pingTimer;
-		QTimer* m_quitTimer;
-		QTimer* m_idleTimer;
+		bool m_pondering;
+		bool m_remote;
+		int m_roundTripTime;
+		ClockTimer* m_pingTimer;
+		ClockTimer* m_quitTimer;
+		ClockTimer* m_idleTimer;
 		QIODevice *m_ioDevice;
-		QStringList m_writeBuffer;
+		QList<QByteArray> m_writeBuffer;
+		QByteArray m_outBuffer;
+		bool m_outFlushPending;
+		quint64 m_bytesWritten;
+		quint64 m_bytesRead;
+		QByteArray m_readBuffer;
+		int m_readPos;
+		QElapsedTimer m_pingTime;
+		QElapsedTimer m_responseTime;
+		QElapsedTimer m_goTime;
+		QElapsedTimer m_readTime;
+		qint64 m_goDelay;
+		qint64 m_firstReadDelay;
+		bool m_clockPending;
+		bool m_waitingForResponse;
+		mutable QMutex m_statsMutex;
+		LatencyStats m_pingStats;
+		LatencyStats m_responseStats;
+		ResourceStats m_resourceStats;
 		QStringList m_variants;
 		QList<EngineOption*> m_options;
 		QMap<QString, QVariant> m_optionBuffer;
 		EngineConfiguration::RestartMode m_restartMode;
+		QString m_analysisVariant;
+		QString m_analysisFen;
+		QString m_analysisStartFen;
+		QVector<Chess::GenericMove> m_analysisRequest;
+		QVector<Chess::GenericMove> m_analysisMoves;
+		Chess::Board* m_analysisBoard;
 };
 
 #endif // CHESSENGINE_H
@@ -19,8 +19,11 @@
 #include <QThread>
 #include <QTimer>
 #include "board/board.h"
+#include "board/boardfactory.h"
 #include "chessplayer.h"
 #include "openingbook.h"
+#include "randomgenerator.h"
+#include "tracelog.h"
 
 
 ChessGame::ChessGame(Chess::Board* board, PgnGame* pgn, QObject* parent)
@@ -30,7 +33,10 @@ ChessGame::ChessGame(Chess::Board* board, PgnGame* pgn, QObject* parent)
 	  m_finished(false),
 	  m_gameInProgress(false),
 	  m_paused(false),
-	  m_pgn(pgn)
+	  m_collapseOpening(false),
+	  m_pgn(pgn),
+	  m_snapshotSlot(new GameSnapshotSlot),
+	  m_random(0)
 {
 	Q_ASSERT(pgn != 0);
 
@@ -39,12 +45,16 @@ ChessGame::ChessGame(Chess::Board* board, PgnGame* pgn, QObject* parent)
 		m_player[i] = 0;
 		m_book[i] = 0;
 		m_bookDepth[i] = 0;
+		m_bookMoveCount[i] = 0;
+		m_leftBookEarly[i] = false;
 	}
 }
 
 ChessGame::~ChessGame()
 {
-	delete m_board;
+	m_board->setRandomGenerator(0);
+	Chess::BoardFactory::release(m_board);
+	delete m_random;
 }
 
 QString ChessGame::errorString() const
@@ -88,6 +98,16 @@ Chess::Result ChessGame::result() const
 	return m_result;
 }
 
+QSharedPointer<GameSnapshotSlot> ChessGame::snapshotSlot() const
+{
+	return m_snapshotSlot;
+}
+
+void ChessGame::publishSnapshot()
+{
+	m_snapshotSlot->publish(m_snapshot);
+}
+
 ChessPlayer* ChessGame::playerToMove() const
 {
 	if (m_board->sideToMove().isNull())
@@ -109,6 +129,11 @@ void ChessGame::stop()
 
 	m_finished = true;
 	emit humanEnabled(false);
+
+	m_snapshot.result = m_result;
+	m_snapshot.thinkingSide = Chess::Side();
+	publishSnapshot();
+
 	if (!m_gameInProgress)
 	{
 		m_result = Chess::Result();
@@ -196,21 +221,39 @@ static QString evalString(const MoveEvaluation& eval)
 	return str;
 }
 
-void ChessGame::addPgnMove(const Chess::Move& move, const QString& comment)
+bool ChessGame::needsMoveStrings() const
+{
+	return m_pgn->isFollowingOpening()
+	    || TraceLog::isEnabled()
+	    || receivers(SIGNAL(moveMade(Chess::GenericMove, QString, QString))) > 0;
+}
+
+QString ChessGame::makePgnMove(const Chess::Move& move, const QString& comment)
 {
 	PgnGame::MoveData md;
 	md.key = m_board->key();
 	md.move = m_board->genericMove(move);
-	md.moveString = m_board->moveString(move, Chess::Board::StandardAlgebraic);
 	md.comment = comment;
 
-	m_pgn->addMove(md);
+	// The PGN output generates the move strings when the game is
+	// written, so they're only needed here if someone is listening
+	if (!needsMoveStrings())
+	{
+		m_board->makeMove(move);
+		m_pgn->addMove(md);
+		return QString();
+	}
+
+	QString moveString(m_board->makeSanMove(move));
+	m_pgn->addMove(md, moveString);
+
+	return moveString;
 }
 
-void ChessGame::emitLastMove()
+void ChessGame::emitLastMove(const QString& moveString)
 {
 	PgnGame::MoveData md(m_pgn->moves().last());
-	emit moveMade(md.move, md.moveString, md.comment);
+	emit moveMade(md.move, moveString, md.comment);
 }
 
 void ChessGame::onMoveMade(const Chess::Move& move)
@@ -227,28 +270,55 @@ void ChessGame::onMoveMade(const Chess::Move& move)
 	}
 
 	m_moves.append(move);
-	addPgnMove(move, evalString(sender->evaluation()));
 
-	// Get the result before sending the move to the opponent
-	m_board->makeMove(move);
+	// The opponent converts the move with the position before the
+	// move, so it gets the move before the board is updated. The
+	// opponent is told about the move even if it ends the game.
+	playerToWait()->makeMove(move);
+
+	// The move is made on the board once, and the result and the
+	// adjudication are based on the new position
+	const MoveEvaluation& eval(sender->evaluation());
+	QString moveString(makePgnMove(move, evalString(eval)));
+	if (eval.depth() > 0 && !eval.isBookEval())
+	{
+		int score = eval.score();
+		emit moveEvaluated(m_pgn->moves().size() - 1,
+				   sender->side() == Chess::Side::White ? score : -score);
+	}
 	m_result = m_board->result();
 	if (m_result.isNone())
 	{
 		m_adjudicator.addEval(m_board, sender->evaluation());
 		m_result = m_adjudicator.result();
+
+		if (!m_result.isNone() && TraceLog::isEnabled())
+		{
+			QVariantMap args;
+			args["result"] = m_result.toVerboseString();
+			TraceLog::instant("game", "adjudication", args);
+		}
+	}
+
+	if (TraceLog::isEnabled())
+	{
+		QVariantMap args;
+		args["player"] = sender->name();
+		args["move"] = moveString;
+		TraceLog::instant("game", "move", args);
 	}
-	m_board->undoMove();
 
-	ChessPlayer* player = playerToWait();
-	player->makeMove(move);
-	m_board->makeMove(move);
+	m_snapshot.fen = m_board->fenString();
+	m_snapshot.lastMove = m_pgn->moves().last().move;
+	m_snapshot.timeLeft[sender->side()] = sender->timeControl()->timeLeft();
+	m_snapshot.thinkingSide = Chess::Side();
 
 	if (m_result.isNone())
 		startTurn();
 	else
 		stop();
 
-	emitLastMove();
+	emitLastMove(moveString);
 }
 
 void ChessGame::startTurn()
@@ -260,6 +330,17 @@ void ChessGame::startTurn()
 	Q_ASSERT(!side.isNull());
 
 	emit humanEnabled(m_player[side]->isHuman());
+	if (TraceLog::isEnabled())
+	{
+		QVariantMap args;
+		args["player"] = m_player[side]->name();
+		TraceLog::instant("game", "turn", args);
+	}
+
+	m_snapshot.thinkingSide = side;
+	m_snapshot.timeLeft[side] = m_player[side]->timeControl()->timeLeft();
+	m_snapshot.thinkingTime.start();
+	publishSnapshot();
 
 	Chess::Move move(bookMove(side));
 	if (move.isNull())
@@ -305,21 +386,22 @@ Chess::Move ChessGame::bookMove(Chess::Side side)
 	||  m_moves.size() >= m_bookDepth[side] * 2)
 		return Chess::Move();
 
-	Chess::GenericMove bookMove = m_book[side]->move(m_board->key());
+	Chess::GenericMove bookMove = m_book[side]->move(m_board->key(), m_random);
 	Chess::Move move = m_board->moveFromGenericMove(bookMove);
-	if (move.isNull())
-		return Chess::Move();
-
-	if (!m_board->isLegalMove(move))
+	if (!move.isNull() && !m_board->isLegalMove(move))
 	{
 		qWarning("Illegal opening book move for %s: %s",
 			 qPrintable(side.toString()),
 			 qPrintable(m_board->moveString(move, Chess::Board::LongAlgebraic)));
-		return Chess::Move();
+		move = Chess::Move();
 	}
+	else if (!move.isNull() && m_board->isRepetition(move))
+		move = Chess::Move();
 
-	if (m_board->isRepetition(move))
-		return Chess::Move();
+	if (move.isNull())
+		m_leftBookEarly[side] = true;
+	else
+		m_bookMoveCount[side]++;
 
 	return move;
 }
@@ -395,16 +477,42 @@ void ChessGame::setOpeningBook(const OpeningBook* book,
 	}
 }
 
+int ChessGame::bookMoveCount(Chess::Side side) const
+{
+	Q_ASSERT(!side.isNull());
+	return m_bookMoveCount[side];
+}
+
+bool ChessGame::leftBookEarly(Chess::Side side) const
+{
+	Q_ASSERT(!side.isNull());
+	return m_leftBookEarly[side];
+}
+
 void ChessGame::setAdjudicator(const GameAdjudicator& adjudicator)
 {
 	m_adjudicator = adjudicator;
 }
 
+void ChessGame::setRandomGenerator(const RandomGenerator& generator)
+{
+	Q_ASSERT(!m_gameInProgress);
+
+	if (m_random == 0)
+		m_random = new RandomGenerator(generator);
+	else
+		*m_random = generator;
+	m_board->setRandomGenerator(m_random);
+}
+
 void ChessGame::generateOpening()
 {
+	// A random starting position is picked here even without
+	// books, so that it's drawn by the caller in game order and
+	// not by the game's thread when the game happens to start
+	resetBoard();
 	if (m_book[Chess::Side::White] == 0 || m_book[Chess::Side::Black] == 0)
 		return;
-	resetBoard();
 
 	// First play moves that are already in the opening
 	foreach (const Chess::Move& move, m_moves)
@@ -442,6 +550,12 @@ void ChessGame::setStartDelay(int time)
 	m_startDelay = time;
 }
 
+void ChessGame::setOpeningCollapsed(bool enabled)
+{
+	Q_ASSERT(!m_gameInProgress);
+	m_collapseOpening = enabled;
+}
+
 void ChessGame::pauseThread()
 {
 	m_pauseSem.release();
@@ -572,6 +686,20 @@ void ChessGame::initializePgn()
 		m_pgn->setTag("WhiteTimeControl", m_timeControl[Chess::Side::White].toString());
 		m_pgn->setTag("BlackTimeControl", m_timeControl[Chess::Side::Black].toString());
 	}
+
+	// The clock times above are already scaled
+	double whiteScale = m_timeControl[Chess::Side::White].timeScale();
+	double blackScale = m_timeControl[Chess::Side::Black].timeScale();
+	if (qFuzzyCompare(whiteScale, blackScale))
+	{
+		if (!qFuzzyCompare(whiteScale, 1.0))
+			m_pgn->setTag("TimeScale", QString::number(whiteScale, 'f', 3));
+	}
+	else
+	{
+		m_pgn->setTag("WhiteTimeScale", QString::number(whiteScale, 'f', 3));
+		m_pgn->setTag("BlackTimeScale", QString::number(blackScale, 'f', 3));
+	}
 }
 
 void ChessGame::startGame()
@@ -604,6 +732,26 @@ void ChessGame::startGame()
 
 	resetBoard();
 	initializePgn();
+
+	// Play the forced opening moves on our own and start the
+	// players from the final position, so that they don't have
+	// to replay the whole opening.
+	int firstMove = 0;
+	if (m_collapseOpening && !m_moves.isEmpty())
+	{
+		foreach (const Chess::Move& move, m_moves)
+		{
+			Q_ASSERT(m_board->isLegalMove(move));
+			makePgnMove(move, "book");
+		}
+		firstMove = m_moves.size();
+
+		QString fen(m_board->fenString());
+		if (!m_board->setFenString(fen))
+			qFatal("Invalid FEN string: %s", qPrintable(fen));
+		m_snapshot.lastMove = m_pgn->moves().last().move;
+	}
+
 	emit started(this);
 	emit fenChanged(m_board->startingFenString());
 
@@ -614,21 +762,35 @@ void ChessGame::startGame()
 		Q_ASSERT(m_timeControl[side].isValid());
 		m_player[side]->setTimeControl(m_timeControl[side]);
 		m_player[side]->newGame(side, m_player[side.opposite()], m_board);
+
+		m_snapshot.playerName[side] = m_player[side]->name();
+		m_snapshot.timeLeft[side] = m_timeControl[side].timeLeft();
+		m_snapshot.infiniteTime[side] = m_timeControl[side].isInfinite();
+	}
+	m_snapshot.variant = m_board->variant();
+	m_snapshot.fen = m_board->startingFenString();
+
+	if (firstMove > 0 && !m_board->result().isNone())
+	{
+		qDebug("Every move was played from the book");
+		m_result = m_board->result();
+		stop();
+		return;
 	}
 
 	// Play the forced opening moves first
-	for (int i = 0; i < m_moves.size(); i++)
+	for (int i = firstMove; i < m_moves.size(); i++)
 	{
 		Chess::Move move(m_moves.at(i));
 		Q_ASSERT(m_board->isLegalMove(move));
 		
-		addPgnMove(move, "book");
-
 		playerToMove()->makeBookMove(move);
 		playerToWait()->makeMove(move);
-		m_board->makeMove(move);
+		QString moveString(makePgnMove(move, "book"));
+		m_snapshot.fen = m_board->fenString();
+		m_snapshot.lastMove = m_pgn->moves().last().move;
 		
-		emitLastMove();
+		emitLastMove(moveString);
 
 		if (!m_board->result().isNone())
 		{
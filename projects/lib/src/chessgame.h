@@ -22,15 +22,18 @@
 #include <QVector>
 #include <QStringList>
 #include <QSemaphore>
+#include <QSharedPointer>
 #include "pgngame.h"
 #include "board/result.h"
 #include "board/move.h"
 #include "timecontrol.h"
 #include "gameadjudicator.h"
+#include "gamesnapshot.h"
 
 namespace Chess { class Board; }
 class ChessPlayer;
 class OpeningBook;
+class RandomGenerator;
 class MoveEvaluation;
 
 
@@ -53,6 +56,13 @@ class LIB_EXPORT ChessGame : public QObject
 		QString startingFen() const;
 		const QVector<Chess::Move>& moves() const;
 		Chess::Result result() const;
+		/*!
+		 * Returns the slot where the game publishes its state.
+		 *
+		 * Polling the slot is a cheaper way to follow a game than
+		 * connecting to its signals.
+		 */
+		QSharedPointer<GameSnapshotSlot> snapshotSlot() const;
 
 		void setError(const QString& message);
 		void setPlayer(Chess::Side side, ChessPlayer* player);
@@ -64,8 +74,35 @@ class LIB_EXPORT ChessGame : public QObject
 		void setOpeningBook(const OpeningBook* book,
 				    Chess::Side side = Chess::Side(),
 				    int depth = 1000);
+		/*! Returns the number of book moves played by \a side. */
+		int bookMoveCount(Chess::Side side) const;
+		/*!
+		 * Returns true if \a side's book ran out of moves before
+		 * the maximum book depth was reached.
+		 */
+		bool leftBookEarly(Chess::Side side) const;
 		void setAdjudicator(const GameAdjudicator& adjudicator);
 		void setStartDelay(int time);
+		/*!
+		 * Sets the opening collapse mode to \a enabled.
+		 *
+		 * If \a enabled is true, the forced opening moves are played
+		 * before the players join the game, and the players get the
+		 * resulting position as their starting position. The moves
+		 * are still saved in the PGN, but the players can't see
+		 * repetitions of positions from the opening.
+		 * The default value is false.
+		 */
+		void setOpeningCollapsed(bool enabled);
+		/*!
+		 * Gives the game a random number generator of its own,
+		 * a copy of \a generator. It's used for the random
+		 * starting position and the book moves, so that they
+		 * don't depend on the other games.
+		 *
+		 * By default Mersenne::random() is used.
+		 */
+		void setRandomGenerator(const RandomGenerator& generator);
 
 		void generateOpening();
 
@@ -87,6 +124,13 @@ class LIB_EXPORT ChessGame : public QObject
 		void moveMade(const Chess::GenericMove& move,
 			      const QString& sanString,
 			      const QString& comment);
+		/*!
+		 * This signal is emitted when a move that came with a search
+		 * score is added to the game. \a ply is the index of the move
+		 * in the PGN game and \a score is the player's evaluation in
+		 * centipawns from white's point of view.
+		 */
+		void moveEvaluated(int ply, int score);
 		void started(ChessGame* game = 0);
 		void finished(ChessGame* game = 0);
 		void startFailed(ChessGame* game = 0);
@@ -105,18 +149,23 @@ class LIB_EXPORT ChessGame : public QObject
 		Chess::Move bookMove(Chess::Side side);
 		void resetBoard();
 		void initializePgn();
-		void addPgnMove(const Chess::Move& move, const QString& comment);
-		void emitLastMove();
+		bool needsMoveStrings() const;
+		QString makePgnMove(const Chess::Move& move, const QString& comment);
+		void emitLastMove(const QString& moveString);
+		void publishSnapshot();
 		
 		Chess::Board* m_board;
 		ChessPlayer* m_player[2];
 		TimeControl m_timeControl[2];
                 const OpeningBook* m_book[2];
 		int m_bookDepth[2];
+		int m_bookMoveCount[2];
+		bool m_leftBookEarly[2];
 		int m_startDelay;
 		bool m_finished;
 		bool m_gameInProgress;
 		bool m_paused;
+		bool m_collapseOpening;
 		QString m_error;
 		QString m_startingFen;
 		Chess::Result m_result;
@@ -125,6 +174,9 @@ class LIB_EXPORT ChessGame : public QObject
 		QSemaphore m_pauseSem;
 		QSemaphore m_resumeSem;
 		GameAdjudicator m_adjudicator;
+		GameSnapshot m_snapshot;
+		QSharedPointer<GameSnapshotSlot> m_snapshotSlot;
+		RandomGenerator* m_random;
 };
 
 #endif // CHESSGAME_H
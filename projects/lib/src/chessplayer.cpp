@@ -16,20 +16,24 @@
 */
 
 #include "chessplayer.h"
-#include <QTimer>
+#include <QMutexLocker>
+#include <QStringList>
 #include "board/board.h"
+#include "clocktimer.h"
+#include "tracelog.h"
 
 
 ChessPlayer::ChessPlayer(QObject* parent)
 	: QObject(parent),
 	  m_state(NotStarted),
-	  m_timer(new QTimer(this)),
+	  m_timer(new ClockTimer(this)),
 	  m_claimedResult(false),
 	  m_validateClaims(true),
 	  m_board(0),
-	  m_opponent(0)
+	  m_opponent(0),
+	  m_gameTime(0),
+	  m_gameNodeCount(0)
 {
-	m_timer->setSingleShot(true);
 	connect(m_timer, SIGNAL(timeout()), this, SLOT(onTimeout()));
 }
 
@@ -44,6 +48,7 @@ bool ChessPlayer::isReady() const
 	case Idle:
 	case Observing:
 	case Thinking:
+	case Analyzing:
 	case Disconnected:
 		return true;
 	default:
@@ -64,6 +69,12 @@ void ChessPlayer::newGame(Chess::Side side, ChessPlayer* opponent, Chess::Board*
 	m_board = board;
 	m_side = side;
 	m_timeControl.initialize();
+	m_moveTimings.clear();
+	{
+		QMutexLocker locker(&m_timeUsageMutex);
+		m_gameTime = 0;
+		m_gameNodeCount = 0;
+	}
 
 	setState(Observing);
 	startGame();
@@ -124,10 +135,13 @@ void ChessPlayer::startClock()
 		emit startedThinking(m_timeControl.timeLeft());
 
 	m_timeControl.startTimer();
+	if (TraceLog::isEnabled())
+		traceClock("clock start");
 
 	if (!m_timeControl.isInfinite())
 	{
-		int t = m_timeControl.timeLeft() + m_timeControl.expiryMargin();
+		int t = m_timeControl.timeLeft() + m_timeControl.expiryMargin()
+			+ m_timeControl.latencyCreditLeft();
 		m_timer->start(qMax(t, 0) + 200);
 	}
 }
@@ -162,6 +176,12 @@ Chess::Board* ChessPlayer::board()
 	return m_board;
 }
 
+void ChessPlayer::setBoard(Chess::Board* board)
+{
+	m_board = board;
+	m_side = board ? board->sideToMove() : Chess::Side::NoSide;
+}
+
 const ChessPlayer* ChessPlayer::opponent() const
 {
 	return m_opponent;
@@ -232,19 +252,94 @@ void ChessPlayer::emitMove(const Chess::Move& move)
 	if (m_state == Thinking)
 		setState(Observing);
 
-	m_timeControl.update();
-	m_eval.setTime(m_timeControl.lastMoveTime());
+	int reportedTime = m_eval.time();
+	int timeLeft = m_timeControl.isInfinite() ? -1 : m_timeControl.timeLeft();
+	qint64 delay = moveDelay();
+	qint64 overhead = 0;
+	if (m_timeControl.latencyCredit() > 0 && reportedTime > 0)
+	{
+		qint64 unreported = m_timeControl.elapsedNsecs() - delay
+				    - qint64(reportedTime) * 1000000;
+		overhead = qMin(moveOverhead(), unreported);
+	}
+	m_timeControl.update(delay, overhead);
+	int moveTime = m_timeControl.lastMoveTime();
+	int refund = m_timeControl.lastRawMoveTime() - moveTime;
+	m_eval.setTime(moveTime);
+	emit moveTimed(moveTime, reportedTime);
+
+	MoveTiming timing = { moveTime, reportedTime, timeLeft };
+	m_moveTimings.append(timing);
+	{
+		QMutexLocker locker(&m_timeUsageMutex);
+		m_timeUsage.addMove(moveTime, reportedTime, timeLeft,
+				    m_timeControl.expiryMargin(), refund);
+		m_searchStats.addSearch(m_eval, m_board->plyCount());
+		m_gameTime += moveTime;
+		m_gameNodeCount += m_eval.nodeCount();
+	}
+
+	if (TraceLog::isEnabled())
+	{
+		QVariantMap args;
+		args["player"] = name();
+		args["timeLeft"] = m_timeControl.timeLeft();
+		if (refund > 0)
+			args["refund"] = refund;
+		TraceLog::complete("clock", "think",
+				   m_timeControl.lastMoveTimeNsecs() / 1000, args);
+	}
 
 	m_timer->stop();
 	if (m_timeControl.expired())
 	{
+		reportTimeForfeit(moveTime, timeLeft);
 		forfeit(Chess::Result::Timeout);
 		return;
 	}
+	if (!m_eval.isBookEval()
+	&&  !m_timeControl.isWithinLimits(m_eval.depth(), m_eval.nodeCount()))
+	{
+		QString str(tr("%1 exceeds the search limits (depth %2, %3 nodes)")
+			    .arg(side().toString())
+			    .arg(m_eval.depth())
+			    .arg(m_eval.nodeCount()));
+		qWarning("%s: %s", qPrintable(name()), qPrintable(str));
+		forfeit(Chess::Result::Adjudication, str);
+		return;
+	}
 
 	emit moveMade(move);
 }
 
+qint64 ChessPlayer::moveDelay() const
+{
+	return 0;
+}
+
+qint64 ChessPlayer::moveOverhead() const
+{
+	return 0;
+}
+
+void ChessPlayer::restartClock()
+{
+	if (m_state != Thinking)
+		return;
+
+	m_timeControl.startTimer();
+	if (TraceLog::isEnabled())
+		traceClock("clock restart");
+}
+
+void ChessPlayer::traceClock(const QString& event) const
+{
+	QVariantMap args;
+	args["player"] = name();
+	args["timeLeft"] = m_timeControl.timeLeft();
+	TraceLog::instant("clock", event, args);
+}
+
 void ChessPlayer::kill()
 {
 	setState(Disconnected);
@@ -257,7 +352,60 @@ void ChessPlayer::onCrashed()
 	forfeit(Chess::Result::Disconnection);
 }
 
+void ChessPlayer::reportTimeForfeit(int moveTime, int timeLeft)
+{
+	{
+		QMutexLocker locker(&m_timeUsageMutex);
+		m_timeUsage.addForfeit();
+	}
+
+	// The timings of the last few moves tell a sudden delay (eg. an
+	// overloaded host) apart from a clock that ran down gradually
+	QStringList moves;
+	for (int i = qMax(0, m_moveTimings.size() - 5); i < m_moveTimings.size(); i++)
+	{
+		const MoveTiming& timing = m_moveTimings.at(i);
+		moves << QString("%1/%2/%3")
+			 .arg(timing.moveTime)
+			 .arg(timing.reportedTime)
+			 .arg(timing.timeLeft);
+	}
+	qWarning("%s loses on time after %d ms with %d ms left "
+		 "(%d ms margin); last moves (used/reported/left ms): %s",
+		 qPrintable(name()),
+		 moveTime,
+		 timeLeft,
+		 m_timeControl.expiryMargin(),
+		 qPrintable(moves.join(" ")));
+}
+
+TimeUsageStats ChessPlayer::timeUsage() const
+{
+	QMutexLocker locker(&m_timeUsageMutex);
+	return m_timeUsage;
+}
+
+SearchStats ChessPlayer::searchStats() const
+{
+	QMutexLocker locker(&m_timeUsageMutex);
+	return m_searchStats;
+}
+
+qint64 ChessPlayer::gameTime() const
+{
+	QMutexLocker locker(&m_timeUsageMutex);
+	return m_gameTime;
+}
+
+quint64 ChessPlayer::gameNodeCount() const
+{
+	QMutexLocker locker(&m_timeUsageMutex);
+	return m_gameNodeCount;
+}
+
 void ChessPlayer::onTimeout()
 {
+	int timeLeft = m_timeControl.timeLeft();
+	reportTimeForfeit(timeLeft - m_timeControl.activeTimeLeft(), timeLeft);
 	forfeit(Chess::Result::Timeout);
 }
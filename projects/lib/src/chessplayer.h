@@ -21,11 +21,14 @@
 #include <QObject>
 #include <QString>
 #include <QVector>
+#include <QMutex>
 #include "board/result.h"
 #include "board/move.h"
 #include "timecontrol.h"
 #include "moveevaluation.h"
-class QTimer;
+#include "timeusagestats.h"
+#include "searchstats.h"
+class ClockTimer;
 namespace Chess { class Board; }
 
 
@@ -48,6 +51,7 @@ class LIB_EXPORT ChessPlayer : public QObject
 			Observing,	//!< Observing a game, or waiting for turn
 			Thinking,	//!< Thinking of the next move
 			FinishingGame,	//!< Finishing or cleaning up after a game
+			Analyzing,	//!< Analyzing a position outside of a game
 			Disconnected	//!< Disconnected or terminated
 		};
 
@@ -135,6 +139,34 @@ class LIB_EXPORT ChessPlayer : public QObject
 		/*! Sets result claim validation mode to \a validate. */
 		void setClaimsValidated(bool validate);
 
+		/*!
+		 * Returns the cumulative time usage statistics of the player.
+		 *
+		 * This function is thread-safe.
+		 */
+		TimeUsageStats timeUsage() const;
+		/*!
+		 * Returns the cumulative statistics of the searches that
+		 * the player reported for its moves.
+		 *
+		 * This function is thread-safe.
+		 */
+		SearchStats searchStats() const;
+		/*!
+		 * Returns the time in milliseconds the player has spent
+		 * thinking in the current (or latest) game.
+		 *
+		 * This function is thread-safe.
+		 */
+		qint64 gameTime() const;
+		/*!
+		 * Returns the number of nodes the player reported searching
+		 * in the current (or latest) game.
+		 *
+		 * This function is thread-safe.
+		 */
+		quint64 gameNodeCount() const;
+
 	public slots:
 		/*!
 		 * Waits (without blocking) until the player is ready,
@@ -184,6 +216,15 @@ class LIB_EXPORT ChessPlayer : public QObject
 
 		/*! Signals the player's move. */
 		void moveMade(const Chess::Move& move) const;
+		/*!
+		 * This signal is emitted when the player makes a move.
+		 *
+		 * \a moveTime is the move time charged to the player, and
+		 * \a reportedTime is the search time reported by the player
+		 * itself, or 0 if it didn't report one. Both are in
+		 * milliseconds.
+		 */
+		void moveTimed(int moveTime, int reportedTime) const;
 		
 		/*!
 		 * Emitted when the player claims the game to end
@@ -215,6 +256,14 @@ class LIB_EXPORT ChessPlayer : public QObject
 	protected:
 		/*! Returns the chessboard on which the player is playing. */
 		Chess::Board* board();
+		/*!
+		 * Sets the player's board to \a board outside of a game, and
+		 * the player's side to the side to move on \a board.
+		 *
+		 * This is used for analysis, where the player isn't given a
+		 * board by newGame().
+		 */
+		void setBoard(Chess::Board* board);
 
 		/*! Starts the chess game set up by newGame(). */
 		virtual void startGame() = 0;
@@ -242,6 +291,32 @@ class LIB_EXPORT ChessPlayer : public QObject
 		 * move came too late.
 		 */
 		void emitMove(const Chess::Move& move);
+		/*!
+		 * Returns the time in nanoseconds that has passed since the
+		 * player's move was received.
+		 *
+		 * emitMove() doesn't charge this time to the player. The
+		 * default implementation returns 0.
+		 */
+		virtual qint64 moveDelay() const;
+		/*!
+		 * Returns the estimated harness overhead of the player's
+		 * move in nanoseconds, eg. the time it spent waiting in a
+		 * pipe or an event queue.
+		 *
+		 * With a latency credit emitMove() refunds the overhead, but
+		 * never more than the part of the move time the player
+		 * didn't report as thinking time. The default implementation
+		 * returns 0.
+		 */
+		virtual qint64 moveOverhead() const;
+		/*!
+		 * Restarts the player's clock without changing the time left.
+		 *
+		 * Players that can't start thinking right away can call this
+		 * to measure their move time from the actual start.
+		 */
+		void restartClock();
 		
 		/*! Returns the opposing player. */
 		const ChessPlayer* opponent() const;
@@ -254,16 +329,31 @@ class LIB_EXPORT ChessPlayer : public QObject
 
 	private:
 		void startClock();
+		void traceClock(const QString& event) const;
+		void reportTimeForfeit(int moveTime, int timeLeft);
+
+		struct MoveTiming
+		{
+			int moveTime;
+			int reportedTime;
+			int timeLeft;
+		};
 
 		QString m_name;
 		State m_state;
 		TimeControl m_timeControl;
-		QTimer* m_timer;
+		ClockTimer* m_timer;
 		bool m_claimedResult;
 		bool m_validateClaims;
 		Chess::Side m_side;
 		Chess::Board* m_board;
 		ChessPlayer* m_opponent;
+		QVector<MoveTiming> m_moveTimings;
+		TimeUsageStats m_timeUsage;
+		SearchStats m_searchStats;
+		qint64 m_gameTime;
+		quint64 m_gameNodeCount;
+		mutable QMutex m_timeUsageMutex;
 };
 
 #endif // CHESSPLAYER_H
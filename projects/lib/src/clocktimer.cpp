@@ -0,0 +1,248 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "clocktimer.h"
+#include <QMap>
+#include <QPair>
+#include <QEvent>
+#include <QBasicTimer>
+#include <QElapsedTimer>
+#include <QThreadStorage>
+#include <QTimerEvent>
+
+
+/*
+ * The deadline queue of one thread. The timers are ordered by their
+ * deadline in nanoseconds, and a sequence number keeps timers with the
+ * same deadline in the order they were started.
+ */
+class ClockScheduler : public QObject
+{
+	public:
+		ClockScheduler();
+		virtual ~ClockScheduler();
+
+		static ClockScheduler* current();
+
+		qint64 now() const;
+		void add(ClockTimer* timer, int msec);
+		void remove(ClockTimer* timer);
+
+	protected:
+		virtual void timerEvent(QTimerEvent* event);
+
+	private:
+		typedef QPair<qint64, quint64> Key;
+
+		void rearm();
+
+		QMap<Key, ClockTimer*> m_queue;
+		QBasicTimer m_timer;
+		QElapsedTimer m_clock;
+		qint64 m_armedDeadline;
+		quint64 m_sequence;
+};
+
+static QThreadStorage<ClockScheduler*> s_schedulers;
+
+ClockScheduler::ClockScheduler()
+	: m_armedDeadline(-1),
+	  m_sequence(0)
+{
+	m_clock.start();
+}
+
+ClockScheduler::~ClockScheduler()
+{
+	QMap<Key, ClockTimer*>::const_iterator it;
+	for (it = m_queue.constBegin(); it != m_queue.constEnd(); ++it)
+		it.value()->m_scheduler = 0;
+}
+
+ClockScheduler* ClockScheduler::current()
+{
+	if (!s_schedulers.hasLocalData())
+		s_schedulers.setLocalData(new ClockScheduler);
+	return s_schedulers.localData();
+}
+
+qint64 ClockScheduler::now() const
+{
+	return m_clock.nsecsElapsed();
+}
+
+void ClockScheduler::add(ClockTimer* timer, int msec)
+{
+	Q_ASSERT(timer->m_scheduler == 0);
+
+	timer->m_scheduler = this;
+	timer->m_deadline = now() + qint64(qMax(msec, 0)) * 1000000;
+	timer->m_sequence = m_sequence++;
+	m_queue.insert(Key(timer->m_deadline, timer->m_sequence), timer);
+
+	if (m_armedDeadline < 0 || timer->m_deadline < m_armedDeadline)
+		rearm();
+}
+
+void ClockScheduler::remove(ClockTimer* timer)
+{
+	Q_ASSERT(timer->m_scheduler == this);
+
+	m_queue.remove(Key(timer->m_deadline, timer->m_sequence));
+	timer->m_scheduler = 0;
+
+	// A timer that fires early with nothing to do is harmless, so
+	// the dispatcher timer is only touched when the queue runs dry
+	if (m_queue.isEmpty())
+		rearm();
+}
+
+void ClockScheduler::rearm()
+{
+	if (m_queue.isEmpty())
+	{
+		m_timer.stop();
+		m_armedDeadline = -1;
+		return;
+	}
+
+	qint64 deadline = m_queue.constBegin().key().first;
+	qint64 msec = (deadline - now() + 999999) / 1000000;
+	m_armedDeadline = deadline;
+
+	#if QT_VERSION >= 0x050000
+	m_timer.start(int(qMax(msec, qint64(0))), Qt::PreciseTimer, this);
+	#else
+	m_timer.start(int(qMax(msec, qint64(0))), this);
+	#endif
+}
+
+void ClockScheduler::timerEvent(QTimerEvent* event)
+{
+	if (event->timerId() != m_timer.timerId())
+	{
+		QObject::timerEvent(event);
+		return;
+	}
+
+	/*
+	 * Expire the due timers one at a time: a timeout() handler may
+	 * start or stop other timers of this thread.
+	 */
+	while (!m_queue.isEmpty())
+	{
+		QMap<Key, ClockTimer*>::iterator it = m_queue.begin();
+		if (it.key().first > now())
+			break;
+
+		ClockTimer* timer = it.value();
+		m_queue.erase(it);
+		timer->m_scheduler = 0;
+		emit timer->timeout();
+	}
+
+	rearm();
+}
+
+
+ClockTimer::ClockTimer(QObject* parent)
+	: QObject(parent),
+	  m_interval(0),
+	  m_resumePending(false),
+	  m_scheduler(0),
+	  m_deadline(0),
+	  m_sequence(0)
+{
+}
+
+ClockTimer::~ClockTimer()
+{
+	stop();
+}
+
+int ClockTimer::interval() const
+{
+	return m_interval;
+}
+
+void ClockTimer::setInterval(int msec)
+{
+	m_interval = msec;
+}
+
+bool ClockTimer::isActive() const
+{
+	return m_scheduler != 0 || m_resumePending;
+}
+
+int ClockTimer::remainingTime() const
+{
+	if (m_scheduler == 0)
+		return -1;
+
+	qint64 left = m_deadline - m_scheduler->now();
+	return int(qMax(left, qint64(0)) / 1000000);
+}
+
+void ClockTimer::start()
+{
+	start(m_interval);
+}
+
+void ClockTimer::start(int msec)
+{
+	stop();
+	m_interval = msec;
+	ClockScheduler::current()->add(this, msec);
+}
+
+void ClockTimer::stop()
+{
+	m_resumePending = false;
+	if (m_scheduler != 0)
+		m_scheduler->remove(this);
+}
+
+void ClockTimer::resume(int msec)
+{
+	if (!m_resumePending)
+		return;
+
+	m_resumePending = false;
+	ClockScheduler::current()->add(this, msec);
+}
+
+bool ClockTimer::event(QEvent* event)
+{
+	/*
+	 * The queue belongs to the old thread, so an active timer is
+	 * restarted in the new thread with the time it has left. The
+	 * queued call is delivered in the thread the object lives in
+	 * by then.
+	 */
+	if (event->type() == QEvent::ThreadChange && m_scheduler != 0)
+	{
+		int left = remainingTime();
+		stop();
+		m_resumePending = true;
+		QMetaObject::invokeMethod(this, "resume", Qt::QueuedConnection,
+					  Q_ARG(int, left));
+	}
+
+	return QObject::event(event);
+}
@@ -0,0 +1,91 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CLOCKTIMER_H
+#define CLOCKTIMER_H
+
+#include <QObject>
+class ClockScheduler;
+
+/*!
+ * \brief A lightweight single-shot timer for chess clocks.
+ *
+ * ClockTimer has the same interface as a single-shot QTimer, but it
+ * doesn't register a timer with the event dispatcher. Instead, all
+ * the active ClockTimer objects of a thread are kept in a deadline
+ * queue that is serviced by a single precise timer, which is always
+ * armed for the earliest deadline. With hundreds of concurrent games
+ * this replaces thousands of dispatcher timers (clock expiry, pings,
+ * quit and idle timeouts) with one timer per thread.
+ *
+ * Like QTimer, a ClockTimer object must only be used from the thread
+ * it lives in. An active timer keeps its remaining time if the object
+ * is moved to another thread.
+ */
+class LIB_EXPORT ClockTimer : public QObject
+{
+	Q_OBJECT
+
+	public:
+		/*! Creates a new inactive timer. */
+		explicit ClockTimer(QObject* parent = 0);
+		/*! Destroys the timer. */
+		virtual ~ClockTimer();
+
+		/*! Returns the timeout interval in milliseconds. */
+		int interval() const;
+		/*! Sets the timeout interval to \a msec milliseconds. */
+		void setInterval(int msec);
+		/*! Returns true if the timer is running. */
+		bool isActive() const;
+		/*!
+		 * Returns the time left before the timeout in milliseconds,
+		 * or -1 if the timer is inactive.
+		 */
+		int remainingTime() const;
+
+	public slots:
+		/*! Starts or restarts the timer with interval(). */
+		void start();
+		/*! Starts or restarts the timer with a \a msec timeout. */
+		void start(int msec);
+		/*! Stops the timer. */
+		void stop();
+
+	signals:
+		/*! This signal is emitted when the timer expires. */
+		void timeout();
+
+	protected:
+		// Inherited from QObject
+		virtual bool event(QEvent* event);
+
+	private slots:
+		void resume(int msec);
+
+	private:
+		friend class ClockScheduler;
+
+		int m_interval;
+		bool m_resumePending;
+		ClockScheduler* m_scheduler;
+		qint64 m_deadline;
+		quint64 m_sequence;
+};
+
+#endif // CLOCKTIMER_H
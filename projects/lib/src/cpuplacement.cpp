@@ -0,0 +1,170 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "cpuplacement.h"
+#include <QMap>
+#include <QStringList>
+#include <QThread>
+#ifdef Q_OS_LINUX
+#include <QDir>
+#include <QFile>
+#endif
+
+
+// A physical core: the logical CPUs (SMT siblings) that share it
+typedef QList<int> Core;
+
+#ifdef Q_OS_LINUX
+static QString readLine(const QString& fileName)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		return QString();
+	return QString::fromLatin1(file.readLine()).trimmed();
+}
+
+// Parses a sysfs CPU list like "0-3,8,10-11"
+static QList<int> parseCpuList(const QString& str)
+{
+	QList<int> cpus;
+	foreach (const QString& range, str.split(',', QString::SkipEmptyParts))
+	{
+		QStringList bounds(range.split('-'));
+		int first = bounds.first().toInt();
+		int last = bounds.last().toInt();
+		for (int i = first; i <= last; i++)
+			cpus << i;
+	}
+	return cpus;
+}
+#endif // Q_OS_LINUX
+
+// Returns the physical cores of each NUMA node
+static QList< QList<Core> > topology()
+{
+	QMap<int, QList<Core> > nodes;
+
+#ifdef Q_OS_LINUX
+	QDir cpuDir("/sys/devices/system/cpu");
+	QStringList cpuNames(cpuDir.entryList(QStringList() << "cpu[0-9]*",
+					      QDir::Dirs));
+	foreach (const QString& cpuName, cpuNames)
+	{
+		QString path(cpuDir.filePath(cpuName));
+		int cpu = cpuName.mid(3).toInt();
+
+		// Offline CPUs have no topology information. Each core is
+		// added only once, by its first sibling.
+		QString list(readLine(path + "/topology/thread_siblings_list"));
+		if (list.isEmpty() || readLine(path + "/online") == "0")
+			continue;
+		if (parseCpuList(list).first() != cpu)
+			continue;
+
+		int node = 0;
+		QStringList nodeNames(QDir(path).entryList(QStringList() << "node[0-9]*"));
+		if (!nodeNames.isEmpty())
+			node = nodeNames.first().mid(4).toInt();
+		else
+			node = readLine(path + "/topology/physical_package_id").toInt();
+
+		nodes[node] << parseCpuList(list);
+	}
+#endif // Q_OS_LINUX
+
+	if (nodes.isEmpty())
+	{
+		int count = qMax(1, QThread::idealThreadCount());
+		for (int i = 0; i < count; i++)
+			nodes[0] << (Core() << i);
+	}
+
+	return nodes.values();
+}
+
+
+CpuPlacement::CpuPlacement()
+	: m_coresPerPlayer(0)
+{
+}
+
+bool CpuPlacement::isNull() const
+{
+	return m_coresPerPlayer <= 0;
+}
+
+int CpuPlacement::coresPerPlayer() const
+{
+	return m_coresPerPlayer;
+}
+
+void CpuPlacement::setCoresPerPlayer(int count)
+{
+	m_coresPerPlayer = qMax(count, 0);
+	m_cpuSets.clear();
+	if (m_coresPerPlayer == 0)
+		return;
+
+	// Split each node into game slots of two core sets
+	QList< QList< QList<int> > > nodeSlots;
+	foreach (const QList<Core>& cores, topology())
+	{
+		QList< QList<int> > cpuSets;
+		int used = 0;
+		while (cores.size() - used >= m_coresPerPlayer * 2)
+		{
+			for (int side = 0; side < 2; side++)
+			{
+				QList<int> cpus;
+				for (int i = 0; i < m_coresPerPlayer; i++)
+					cpus << cores.at(used++);
+				cpuSets << cpus;
+			}
+		}
+		nodeSlots << cpuSets;
+	}
+
+	// Alternate between the nodes so that a few concurrent games
+	// don't compete for one node's memory bandwidth.
+	for (bool done = false; !done; )
+	{
+		done = true;
+		for (int i = 0; i < nodeSlots.size(); i++)
+		{
+			if (nodeSlots[i].isEmpty())
+				continue;
+			m_cpuSets << nodeSlots[i].takeFirst();
+			m_cpuSets << nodeSlots[i].takeFirst();
+			done = false;
+		}
+	}
+}
+
+int CpuPlacement::slotCount() const
+{
+	return m_cpuSets.size() / 2;
+}
+
+QList<int> CpuPlacement::cpus(int slot, int side) const
+{
+	Q_ASSERT(side == 0 || side == 1);
+
+	if (slot < 0 || slot >= slotCount())
+		return QList<int>();
+	return m_cpuSets.at(slot * 2 + side);
+}
@@ -0,0 +1,69 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CPUPLACEMENT_H
+#define CPUPLACEMENT_H
+
+#include <QList>
+
+/*!
+ * \brief Assigns dedicated CPU cores to the players of concurrent games.
+ *
+ * CpuPlacement reads the processor topology of the host and splits its
+ * physical cores into sets of coresPerPlayer() cores, two sets per game
+ * slot. The SMT siblings of a core always belong to the same set, and
+ * both sets of a game slot are taken from the same NUMA node. Game
+ * slots alternate between the NUMA nodes.
+ *
+ * On Linux the topology is read from sysfs. On other systems each
+ * logical CPU is treated as a separate core, all in one node.
+ *
+ * \sa GameManager::setCpuPlacement()
+ */
+class LIB_EXPORT CpuPlacement
+{
+	public:
+		/*! Creates a new disabled CpuPlacement object. */
+		CpuPlacement();
+
+		/*! Returns true if CPU placement is disabled. */
+		bool isNull() const;
+		/*! Returns the number of physical cores per player. */
+		int coresPerPlayer() const;
+		/*!
+		 * Sets the number of physical cores per player to \a count,
+		 * and assigns the host's cores to game slots.
+		 *
+		 * A \a count of 0 disables CPU placement.
+		 */
+		void setCoresPerPlayer(int count);
+
+		/*! Returns the number of game slots that have dedicated cores. */
+		int slotCount() const;
+		/*!
+		 * Returns the logical CPUs of player \a side in game slot
+		 * \a slot, or an empty list if the slot has no dedicated cores.
+		 */
+		QList<int> cpus(int slot, int side) const;
+
+	private:
+		int m_coresPerPlayer;
+		QList< QList<int> > m_cpuSets;
+};
+
+#endif // CPUPLACEMENT_H
@@ -0,0 +1,111 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUTECHESSPLUGIN_H
+#define CUTECHESSPLUGIN_H
+
+/*
+ * C interface for engines loaded as shared libraries.
+ *
+ * A plugin exports a function named "cutechess_plugin" of type
+ * CuteChessPluginEntry that returns a CuteChessPlugin table. Cute Chess
+ * calls the table's functions directly from the game's thread, so the
+ * positions and moves are passed as plain structs instead of text, and
+ * there's no engine process to start or to talk to through pipes.
+ *
+ * This header must stay valid C, and a plugin built against an older
+ * version number is rejected.
+ */
+
+#define CUTECHESS_PLUGIN_VERSION 1
+#define CUTECHESS_PLUGIN_ENTRY "cutechess_plugin"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A move in coordinate form. Files and ranks start from 0. The source
+ * file and rank are -1 for piece drops, and the promotion field holds
+ * the promoted or dropped piece type (eg. 2 = knight ... 5 = queen in
+ * western variants), or 0 if there is none.
+ */
+typedef struct CuteChessPluginMove
+{
+	int sourceFile;
+	int sourceRank;
+	int targetFile;
+	int targetRank;
+	int promotion;
+} CuteChessPluginMove;
+
+/*
+ * Search limits for one move. Times are in milliseconds. A zero value
+ * means "no limit", except that timeLeft is -1 for infinite time.
+ */
+typedef struct CuteChessPluginLimits
+{
+	int timeLeft;
+	int opponentTimeLeft;
+	int increment;
+	int movesLeft;
+	int moveTime;
+	int depth;
+	unsigned long long nodes;
+} CuteChessPluginLimits;
+
+typedef struct CuteChessPlugin
+{
+	/* Must be CUTECHESS_PLUGIN_VERSION */
+	int version;
+	/* The engine's name */
+	const char* name;
+
+	/* Returns non-zero if the engine can play variant */
+	int (*supportsVariant)(const char* variant);
+	/* Creates a new engine instance; returns NULL on failure */
+	void* (*create)(void);
+	/* Destroys an engine instance */
+	void (*destroy)(void* engine);
+	/* Sets option name to value; may be NULL */
+	void (*setOption)(void* engine, const char* name, const char* value);
+	/* Prepares the engine for a new game of variant */
+	void (*newGame)(void* engine, const char* variant);
+	/*
+	 * Sets the position to fen followed by moveCount moves.
+	 * The FEN string is X-FEN, or Shredder FEN in random variants.
+	 */
+	void (*setPosition)(void* engine,
+			    const char* fen,
+			    const CuteChessPluginMove* moves,
+			    int moveCount);
+	/*
+	 * Searches the current position within limits and stores the
+	 * best move in bestMove. Returns 0 on success.
+	 */
+	int (*go)(void* engine,
+		  const CuteChessPluginLimits* limits,
+		  CuteChessPluginMove* bestMove);
+} CuteChessPlugin;
+
+typedef const CuteChessPlugin* (*CuteChessPluginEntry)(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CUTECHESSPLUGIN_H */
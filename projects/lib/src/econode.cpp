@@ -20,18 +20,54 @@
 #include <QFile>
 #include <QDataStream>
 #include <QMutex>
+#include <QMutexLocker>
+#include <QAtomicPointer>
+#include <QVector>
+#include <QtAlgorithms>
 #include "pgngame.h"
 #include "pgnstream.h"
+#include "board/board.h"
+#include "board/boardfactory.h"
+
+// A leaf node of the ECO tree and the position it leads to
+struct EcoPosition
+{
+	quint64 key;
+	int depth;
+	const EcoNode* node;
+};
+
+static bool ecoPositionLessThan(const EcoPosition& a, const EcoPosition& b)
+{
+	if (a.key != b.key)
+		return a.key < b.key;
+	return a.depth < b.depth;
+}
 
 static QStringList s_openings;
-static EcoNode* s_root = 0;
+// The tree and the position table are never modified after the root
+// is published, so they can be read by any thread without locking.
+static QAtomicPointer<EcoNode> s_root;
+static QMutex s_initMutex;
+static QVector<EcoPosition> s_positions;
+static int s_maxDepth = 0;
+
+// Returns the published root node, or 0 if the tree is uninitialized
+static EcoNode* publishedRoot()
+{
+#if QT_VERSION >= 0x050000
+	return s_root.loadAcquire();
+#else
+	return s_root;
+#endif
+}
 
 class EcoDeleter
 {
 	public:
 		~EcoDeleter()
 		{
-			delete s_root;
+			delete publishedRoot();
 		}
 };
 static EcoDeleter s_ecoDeleter;
@@ -76,12 +112,11 @@ static int ecoFromString(const QString& ecoString)
 
 void EcoNode::initialize()
 {
-	static QMutex mutex;
-	if (s_root)
+	if (publishedRoot() != 0)
 		return;
 
-	mutex.lock();
-	if (!s_root)
+	QMutexLocker locker(&s_initMutex);
+	if (publishedRoot() == 0)
 	{
 		Q_INIT_RESOURCE(eco);
 
@@ -92,15 +127,21 @@ void EcoNode::initialize()
 		{
 			QDataStream in(&file);
 			in.setVersion(QDataStream::Qt_4_6);
-			in >> s_openings >> s_root;
+			EcoNode* root = 0;
+			in >> s_openings >> root;
+
+			// The tree is published only after the table is
+			// ready, because root() doesn't lock the mutex
+			createPositionTable(root);
+			s_root.fetchAndStoreRelease(root);
 		}
 	}
-	mutex.unlock();
 }
 
 void EcoNode::initialize(PgnStream& in)
 {
-	if (s_root)
+	QMutexLocker locker(&s_initMutex);
+	if (publishedRoot() != 0)
 		return;
 
 	if (!in.isOpen())
@@ -109,17 +150,19 @@ void EcoNode::initialize(PgnStream& in)
 		return;
 	}
 
-	s_root = new EcoNode;
-	EcoNode* current = s_root;
+	EcoNode* root = new EcoNode;
+	EcoNode* current = root;
 	QMap<QString, int> tmpOpenings;
 
 	PgnGame game;
-	while (game.read(in))
+	// The tree is keyed by the SAN strings of the ECO file, which are
+	// the same PGN tokens that addMove() looks up, so the moves don't
+	// need to be verified on a board.
+	while (game.read(in, INT_MAX - 1, PgnGame::ReadMoveTokens))
 	{
-		current = s_root;
-		foreach (const PgnGame::MoveData& move, game.moves())
+		current = root;
+		foreach (const QString& san, game.moveTokens())
 		{
-			QString san = move.moveString;
 			EcoNode* node = current->child(san);
 			if (node == 0)
 			{
@@ -128,7 +171,7 @@ void EcoNode::initialize(PgnStream& in)
 			}
 			current = node;
 		}
-		if (current == s_root)
+		if (current == root)
 			continue;
 
 		current->m_ecoCode = ecoFromString(game.tagValue("ECO"));
@@ -148,26 +191,101 @@ void EcoNode::initialize(PgnStream& in)
 
 		current->m_variation = game.tagValue("Variation");
 	}
+
+	createPositionTable(root);
+	s_root.fetchAndStoreRelease(root);
+}
+
+void EcoNode::createPositionTable(const EcoNode* root)
+{
+	s_positions.clear();
+	s_maxDepth = 0;
+
+	Chess::Board* board = Chess::BoardFactory::create("standard");
+	if (board == 0)
+		return;
+	board->reset();
+
+	// Traverse the tree depth-first. The board is kept in the
+	// position of the node on top of the stack.
+	typedef QMap<QString, EcoNode*>::const_iterator ChildIterator;
+	QVector<const EcoNode*> nodes;
+	QVector<ChildIterator> children;
+	nodes.append(root);
+	children.append(root->m_children.constBegin());
+	while (!nodes.isEmpty())
+	{
+		const EcoNode* node = nodes.last();
+		ChildIterator& it = children.last();
+		if (it == node->m_children.constEnd())
+		{
+			nodes.pop_back();
+			children.pop_back();
+			if (!nodes.isEmpty())
+				board->undoMove();
+			continue;
+		}
+
+		const QString san(it.key());
+		const EcoNode* child = it.value();
+		++it;
+
+		Chess::Move move(board->moveFromString(san));
+		if (move.isNull())
+		{
+			qWarning("Illegal move in the ECO tree: %s",
+				 qPrintable(san));
+			continue;
+		}
+		board->makeMove(move);
+
+		if (child->isLeaf())
+		{
+			EcoPosition pos = { board->key(), nodes.size(), child };
+			s_positions.append(pos);
+		}
+		nodes.append(child);
+		children.append(child->m_children.constBegin());
+	}
+	Chess::BoardFactory::release(board);
+
+	// Only the shortest opening of each position is kept
+	qSort(s_positions.begin(), s_positions.end(), ecoPositionLessThan);
+	int count = 0;
+	for (int i = 0; i < s_positions.size(); i++)
+	{
+		const EcoPosition pos = s_positions.at(i);
+		if (count > 0 && s_positions.at(count - 1).key == pos.key)
+			continue;
+		s_maxDepth = qMax(s_maxDepth, pos.depth);
+		s_positions[count++] = pos;
+	}
+	s_positions.resize(count);
+	s_positions.squeeze();
 }
 
 const EcoNode* EcoNode::root()
 {
-	if (!s_root)
+	EcoNode* root = publishedRoot();
+	if (root == 0)
+	{
 		initialize();
-	return s_root;
+		root = publishedRoot();
+	}
+	return root;
 }
 
-const EcoNode* EcoNode::find(const QVector<PgnGame::MoveData>& moves)
+const EcoNode* EcoNode::find(const QStringList& sanMoves)
 {
-	if (!s_root)
+	EcoNode* current = publishedRoot();
+	if (current == 0)
 		return 0;
 
-	EcoNode* current = s_root;
 	EcoNode* valid = 0;
 
-	foreach (const PgnGame::MoveData& move, moves)
+	foreach (const QString& move, sanMoves)
 	{
-		EcoNode* node = current->child(move.moveString);
+		EcoNode* node = current->child(move);
 		if (node == 0)
 			return valid;
 		if (!node->opening().isEmpty())
@@ -178,9 +296,31 @@ const EcoNode* EcoNode::find(const QVector<PgnGame::MoveData>& moves)
 	return 0;
 }
 
+const EcoNode* EcoNode::find(quint64 key)
+{
+	if (publishedRoot() == 0)
+		return 0;
+
+	EcoPosition value = { key, 0, 0 };
+	QVector<EcoPosition>::const_iterator it;
+	it = qLowerBound(s_positions.constBegin(), s_positions.constEnd(),
+			 value, ecoPositionLessThan);
+	if (it == s_positions.constEnd() || it->key != key)
+		return 0;
+	return it->node;
+}
+
+int EcoNode::maxDepth()
+{
+	if (publishedRoot() == 0)
+		return 0;
+	return s_maxDepth;
+}
+
 void EcoNode::write(const QString& fileName)
 {
-	if (!s_root)
+	const EcoNode* root = publishedRoot();
+	if (root == 0)
 		return;
 
 	QFile file(fileName);
@@ -192,7 +332,7 @@ void EcoNode::write(const QString& fileName)
 
 	QDataStream out(&file);
 	out.setVersion(QDataStream::Qt_4_6);
-	out << s_openings << s_root;
+	out << s_openings << root;
 }
 
 EcoNode::EcoNode()
@@ -36,6 +36,11 @@ class PgnStream;
  * to a PgnGame can be found by traversing the ECO tree as new moves are added
  * to the game, or by passing all the moves at once to the find() function.
  *
+ * When the tree is initialized its openings are also replayed on a board
+ * once, to create a table of the positions of the leaf nodes, sorted by
+ * Zobrist key. A position can then be classified with a binary search,
+ * which also finds openings that were reached by transposition.
+ *
  * \note The Encyclopaedia of Chess Openings only applies to games of standard
  * chess that start from the default starting position.
  */
@@ -83,9 +88,25 @@ class LIB_EXPORT EcoNode
 		static const EcoNode* root();
 		/*!
 		 * Returns the deepest node (closest to the leaves) that matches the
-		 * opening sequence in \a moves.
+		 * opening sequence in \a sanMoves.
+		 *
+		 * \sa PgnGame::moveStrings()
+		 */
+		static const EcoNode* find(const QStringList& sanMoves);
+		/*!
+		 * Returns the leaf node whose opening sequence leads to the
+		 * position with Zobrist key \a key, or 0 if there's no such
+		 * node. If several openings lead to the same position, the
+		 * shortest one is returned.
+		 *
+		 * \note The search doesn't allocate memory.
+		 */
+		static const EcoNode* find(quint64 key);
+		/*!
+		 * Returns the number of plies in the longest opening of the
+		 * ECO tree. Deeper positions can't be found by find().
 		 */
-		static const EcoNode* find(const QVector<PgnGame::MoveData>& moves);
+		static int maxDepth();
 		/*! Writes the ECO tree in binary format to \a fileName. */
 		static void write(const QString& fileName);
 
@@ -95,6 +116,7 @@ class LIB_EXPORT EcoNode
 
 		EcoNode();
 		void addChild(const QString& sanMove, EcoNode* child);
+		static void createPositionTable(const EcoNode* root);
 
 		qint16 m_ecoCode;
 		qint32 m_opening;
@@ -17,8 +17,46 @@
 
 #include "enginebuilder.h"
 #include <QDir>
+#include <QFile>
+#include <QTcpSocket>
+#include <QMutex>
+#include <QMap>
+#include <QRegExp>
 #include "engineprocess.h"
 #include "enginefactory.h"
+#include "chessengine.h"
+#include "engineoption.h"
+#include "engineserver.h"
+#include "enginerecorder.h"
+#include "enginereplayer.h"
+
+// Engines are created in the game threads, so access to the
+// remote hosts is serialized
+static QMutex s_remoteMutex;
+static QStringList s_remoteHosts;
+static QString s_remoteSecret;
+static int s_nextRemoteHost = 0;
+
+// Engine I/O logs; the engines are numbered per log name
+static QMutex s_logMutex;
+static QString s_recordDir;
+static QString s_replayDir;
+static QMap<QString, int> s_logCounts;
+static int s_stderrSize = 0;
+static QString s_stderrDir;
+static QString s_cgroupParent;
+static int s_cgroupCpu = 0;
+static int s_cgroupMemory = 0;
+
+static QString nextRemoteHost()
+{
+	QMutexLocker locker(&s_remoteMutex);
+	if (s_remoteHosts.isEmpty())
+		return QString();
+
+	s_nextRemoteHost %= s_remoteHosts.size();
+	return s_remoteHosts.at(s_nextRemoteHost++);
+}
 
 EngineBuilder::EngineBuilder(const EngineConfiguration& config)
 	: PlayerBuilder(config.name()),
@@ -31,10 +69,16 @@ ChessPlayer* EngineBuilder::create(QObject* receiver,
 				   QObject* parent,
 				   QString* error) const
 {
-	QString workDir = m_config.workingDirectory();
-	QString cmd = m_config.command().trimmed();
+	return createWithAffinity(receiver, method, parent, error, QList<int>());
+}
 
-	if (cmd.isEmpty())
+ChessPlayer* EngineBuilder::createWithAffinity(QObject* receiver,
+					       const char* method,
+					       QObject* parent,
+					       QString* error,
+					       const QList<int>& cpus) const
+{
+	if (m_config.command().trimmed().isEmpty())
 	{
 		setError(error, tr("Empty engine command"));
 		return 0;
@@ -47,8 +91,109 @@ ChessPlayer* EngineBuilder::create(QObject* receiver,
 		return 0;
 	}
 
+	s_logMutex.lock();
+	QString recordDir(s_recordDir);
+	QString replayDir(s_replayDir);
+	s_logMutex.unlock();
+
+	QIODevice* device = 0;
+	QString host;
+	if (!replayDir.isEmpty())
+		device = startReplay(replayDir, error);
+	else
+	{
+		host = m_config.host();
+		if (host.isEmpty())
+			host = nextRemoteHost();
+		if (host.isEmpty())
+			device = startProcess(cpus, error);
+		else
+			device = connectRemote(host, error);
+		if (device != 0 && !recordDir.isEmpty())
+			device = startRecording(device, recordDir, error);
+	}
+	if (device == 0)
+		return 0;
+
+	ChessEngine* engine = EngineFactory::create(m_config.protocol());
+	Q_ASSERT(engine != 0);
+
+	engine->setParent(parent);
+	if (receiver != 0 && method != 0)
+		QObject::connect(engine, SIGNAL(debugMessage(QString)),
+				 receiver, method);
+	engine->setDevice(device);
+	engine->setRemote(!host.isEmpty());
+	engine->applyConfiguration(m_config);
+	engine->applyOptions(gameOptions());
+
+	engine->start();
+	return engine;
+}
+
+void EngineBuilder::reconfigure(ChessPlayer* player) const
+{
+	ChessEngine* engine = qobject_cast<ChessEngine*>(player);
+	Q_ASSERT(engine != 0);
+
+	// Options that are no longer overridden go back to their
+	// configured values
+	QMap<QString, QVariant> options;
+	foreach (const EngineOption* option, m_config.options())
+		options[option->name()] = option->value();
+	QMap<QString, QVariant> gameOptions(this->gameOptions());
+	QMap<QString, QVariant>::const_iterator i;
+	for (i = gameOptions.constBegin(); i != gameOptions.constEnd(); ++i)
+		options[i.key()] = i.value();
+
+	engine->applyOptions(options);
+}
+
+void EngineBuilder::setGameOption(const QString& name, const QVariant& value)
+{
+	QMutexLocker locker(&m_optionMutex);
+	m_gameOptions[name] = value;
+}
+
+void EngineBuilder::clearGameOptions()
+{
+	QMutexLocker locker(&m_optionMutex);
+	m_gameOptions.clear();
+}
+
+QMap<QString, QVariant> EngineBuilder::gameOptions() const
+{
+	QMutexLocker locker(&m_optionMutex);
+	return m_gameOptions;
+}
+
+QIODevice* EngineBuilder::startProcess(const QList<int>& cpus,
+				       QString* error) const
+{
+	QString workDir = m_config.workingDirectory();
+	QString cmd = m_config.command().trimmed();
 	QString path(QDir::currentPath());
 	EngineProcess* process = new EngineProcess();
+#if defined(Q_OS_WIN32) || defined(Q_OS_UNIX)
+	process->setCpuAffinity(cpus);
+
+	s_logMutex.lock();
+	int stderrSize = s_stderrSize;
+	QString stderrDir(s_stderrDir);
+	QString cgroupParent(s_cgroupParent);
+	int cgroupCpu = s_cgroupCpu;
+	int cgroupMemory = s_cgroupMemory;
+	s_logMutex.unlock();
+	if (!stderrDir.isEmpty())
+		process->setStandardErrorCapture(stderrSize,
+						 nextLogFile(stderrDir, ".stderr"));
+	else
+		process->setStandardErrorCapture(stderrSize);
+	process->setCgroup(cgroupParent, cgroupCpu,
+			   qint64(cgroupMemory) * 1024 * 1024);
+#else
+	Q_UNUSED(cpus);
+#endif
 
 	if (workDir.isEmpty())
 	{
@@ -88,18 +233,155 @@ ChessPlayer* EngineBuilder::create(QObject* receiver,
 		return 0;
 	}
 
-	ChessEngine* engine = EngineFactory::create(m_config.protocol());
-	Q_ASSERT(engine != 0);
+	return process;
+}
 
-	engine->setParent(parent);
-	if (receiver != 0 && method != 0)
-		QObject::connect(engine, SIGNAL(debugMessage(QString)),
-				 receiver, method);
-	engine->setDevice(process);
-	engine->applyConfiguration(m_config);
+QIODevice* EngineBuilder::connectRemote(const QString& host,
+					QString* error) const
+{
+	int sep = host.lastIndexOf(':');
+	bool ok = false;
+	quint16 port = host.mid(sep + 1).toUShort(&ok);
+	if (sep <= 0 || !ok)
+	{
+		setError(error, tr("Invalid worker address: %1").arg(host));
+		return 0;
+	}
 
-	engine->start();
-	return engine;
+	// The remote node starts the engine with the same name from its
+	// own configuration, and it has its own CPU topology, so
+	// affinity settings are not forwarded
+	QTcpSocket* socket = new QTcpSocket();
+	socket->connectToHost(host.left(sep), port);
+	if (!socket->waitForConnected())
+	{
+		setError(error, tr("Cannot connect to worker %1: %2")
+			 .arg(host).arg(socket->errorString()));
+		delete socket;
+		return 0;
+	}
+	socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+	s_remoteMutex.lock();
+	const QString secret(s_remoteSecret);
+	s_remoteMutex.unlock();
+	socket->write(EngineServer::request(secret, m_config.name()));
+	while (!socket->canReadLine())
+	{
+		if (!socket->waitForReadyRead())
+		{
+			setError(error, tr("No response from worker %1")
+				 .arg(host));
+			delete socket;
+			return 0;
+		}
+	}
+
+	QString reply(QString::fromUtf8(socket->readLine().trimmed()));
+	if (reply != "ok")
+	{
+		setError(error, tr("Worker %1: %2")
+			 .arg(host).arg(reply.section(' ', 1)));
+		delete socket;
+		return 0;
+	}
+
+	return socket;
+}
+
+void EngineBuilder::setRemoteHosts(const QStringList& hosts)
+{
+	QMutexLocker locker(&s_remoteMutex);
+	s_remoteHosts = hosts;
+	s_nextRemoteHost = 0;
+}
+
+QStringList EngineBuilder::remoteHosts()
+{
+	QMutexLocker locker(&s_remoteMutex);
+	return s_remoteHosts;
+}
+
+void EngineBuilder::setRemoteSecret(const QString& secret)
+{
+	QMutexLocker locker(&s_remoteMutex);
+	s_remoteSecret = secret;
+}
+
+QString EngineBuilder::nextLogFile(const QString& dir,
+				   const QString& suffix) const
+{
+	QString logName(name());
+	if (logName.isEmpty())
+		logName = QFileInfo(m_config.command().trimmed()).completeBaseName();
+	logName.replace(QRegExp("[^A-Za-z0-9_.-]"), "_");
+
+	QMutexLocker locker(&s_logMutex);
+	int number = ++s_logCounts[logName + suffix];
+	return QDir(dir).filePath(QString("%1-%2%3")
+				  .arg(logName).arg(number).arg(suffix));
+}
+
+QIODevice* EngineBuilder::startRecording(QIODevice* device,
+					 const QString& dir,
+					 QString* error) const
+{
+	QFile* log = new QFile(nextLogFile(dir, ".log"));
+	if (!log->open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		setError(error, tr("Cannot open engine log %1: %2")
+			 .arg(log->fileName()).arg(log->errorString()));
+		delete log;
+		delete device;
+		return 0;
+	}
+
+	return new EngineRecorder(device, log);
+}
+
+QIODevice* EngineBuilder::startReplay(const QString& dir,
+				      QString* error) const
+{
+	QFile log(nextLogFile(dir, ".log"));
+	if (!log.open(QIODevice::ReadOnly))
+	{
+		setError(error, tr("Cannot open engine log %1: %2")
+			 .arg(log.fileName()).arg(log.errorString()));
+		return 0;
+	}
+
+	return new EngineReplayer(&log);
+}
+
+void EngineBuilder::setRecordDirectory(const QString& dir)
+{
+	QMutexLocker locker(&s_logMutex);
+	s_recordDir = dir;
+	s_logCounts.clear();
+}
+
+void EngineBuilder::setReplayDirectory(const QString& dir)
+{
+	QMutexLocker locker(&s_logMutex);
+	s_replayDir = dir;
+	s_logCounts.clear();
+}
+
+void EngineBuilder::setStandardErrorCapture(int size, const QString& dir)
+{
+	QMutexLocker locker(&s_logMutex);
+	s_stderrSize = qMax(size, 0);
+	s_stderrDir = dir;
+}
+
+void EngineBuilder::setCgroup(const QString& parent,
+			      int cpuPercent,
+			      int memoryLimit)
+{
+	QMutexLocker locker(&s_logMutex);
+	s_cgroupParent = parent;
+	s_cgroupCpu = qMax(cpuPercent, 0);
+	s_cgroupMemory = qMax(memoryLimit, 0);
 }
 
 void EngineBuilder::setError(QString* error, const QString& message) const
@@ -20,10 +20,21 @@
 
 #include "playerbuilder.h"
 #include <QCoreApplication>
+#include <QStringList>
+#include <QMap>
+#include <QVariant>
+#include <QMutex>
 #include "engineconfiguration.h"
+class QIODevice;
 
 
-/*! \brief A class for constructing local chess engines. */
+/*!
+ * \brief A class for constructing chess engines.
+ *
+ * The engines run as local processes, or on remote worker nodes
+ * (see EngineServer) if the configuration names a host or remote
+ * hosts have been set.
+ */
 class LIB_EXPORT EngineBuilder : public PlayerBuilder
 {
 	Q_DECLARE_TR_FUNCTIONS(EngineBuilder)
@@ -37,11 +48,112 @@ class LIB_EXPORT EngineBuilder : public PlayerBuilder
 					    const char* method,
 					    QObject* parent,
 					    QString* error) const;
+		virtual ChessPlayer* createWithAffinity(QObject* receiver,
+							const char* method,
+							QObject* parent,
+							QString* error,
+							const QList<int>& cpus) const;
+		virtual void reconfigure(ChessPlayer* player) const;
+
+		/*!
+		 * Sets option \a name to \a value for the following games,
+		 * overriding the value in the engine configuration.
+		 *
+		 * New engines get the value at startup, and reused engines
+		 * get it before their next game. Only the options that
+		 * changed are sent to a reused engine, so it doesn't have to
+		 * be restarted to change a parameter. This function is
+		 * thread-safe.
+		 */
+		void setGameOption(const QString& name, const QVariant& value);
+		/*!
+		 * Removes the options set with setGameOption(), so that the
+		 * following games use the values in the engine configuration.
+		 */
+		void clearGameOptions();
+
+		/*!
+		 * Sets the worker nodes that run the engines to \a hosts.
+		 *
+		 * Each host is given as "address:port" of an EngineServer.
+		 * New engines are assigned to the hosts in turn. An empty
+		 * list (the default) runs the engines locally.
+		 */
+		static void setRemoteHosts(const QStringList& hosts);
+		/*! Returns the worker nodes that run the engines. */
+		static QStringList remoteHosts();
+		/*!
+		 * Sets the secret shared with the worker nodes to \a secret.
+		 *
+		 * The workers start the engine with the same name from their
+		 * own configuration, and only if the secret matches.
+		 */
+		static void setRemoteSecret(const QString& secret);
+		/*!
+		 * Records the I/O of every new engine into a log file in
+		 * directory \a dir. An empty \a dir (the default) disables
+		 * recording.
+		 *
+		 * The logs are named after the engine and numbered in the
+		 * order the engines are started.
+		 *
+		 * \sa EngineRecorder
+		 */
+		static void setRecordDirectory(const QString& dir);
+		/*!
+		 * Replays the engines from the logs in directory \a dir
+		 * instead of starting them. An empty \a dir (the default)
+		 * disables replaying.
+		 *
+		 * The engines must be started in the same order as when
+		 * the logs were recorded, eg. with a concurrency of 1.
+		 *
+		 * \sa EngineReplayer
+		 */
+		static void setReplayDirectory(const QString& dir);
+		/*!
+		 * Keeps the last \a size bytes of the standard error output
+		 * of every new local engine, and writes all of it to a file
+		 * in directory \a dir unless \a dir is empty. By default
+		 * the output is discarded.
+		 *
+		 * The kept output is reported if the engine crashes. The
+		 * files are named like the I/O logs, with a ".stderr"
+		 * extension.
+		 *
+		 * \sa EngineProcess::setStandardErrorCapture()
+		 */
+		static void setStandardErrorCapture(int size, const QString& dir);
+		/*!
+		 * Runs every new local engine in a cgroup of its own under
+		 * the delegated cgroup v2 group \a parent, with a CPU quota
+		 * of \a cpuPercent percent of one CPU and a memory limit of
+		 * \a memoryLimit megabytes. A limit of 0 means no limit,
+		 * and an empty \a parent (the default) disables cgroups.
+		 *
+		 * \sa EngineProcess::setCgroup()
+		 */
+		static void setCgroup(const QString& parent,
+				      int cpuPercent,
+				      int memoryLimit);
 
 	private:
+		QIODevice* startProcess(const QList<int>& cpus,
+					QString* error) const;
+		QIODevice* connectRemote(const QString& host,
+					 QString* error) const;
+		QString nextLogFile(const QString& dir,
+				    const QString& suffix) const;
+		QIODevice* startRecording(QIODevice* device,
+					  const QString& dir,
+					  QString* error) const;
+		QIODevice* startReplay(const QString& dir, QString* error) const;
 		void setError(QString* error, const QString& message) const;
+		QMap<QString, QVariant> gameOptions() const;
 
 		EngineConfiguration m_config;
+		mutable QMutex m_optionMutex;
+		QMap<QString, QVariant> m_gameOptions;
 };
 
 #endif // ENGINEBUILDER_H
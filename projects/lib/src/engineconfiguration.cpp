@@ -16,6 +16,8 @@
 */
 
 #include "engineconfiguration.h"
+#include <QDir>
+#include <QFileInfo>
 
 #include "engineoption.h"
 #include "enginetextoption.h"
@@ -24,6 +26,7 @@
 EngineConfiguration::EngineConfiguration()
 	: m_variants(QStringList() << "standard"),
 	  m_whiteEvalPov(false),
+	  m_pondering(false),
 	  m_validateClaims(true),
 	  m_restartMode(RestartAuto)
 {
@@ -37,6 +40,7 @@ EngineConfiguration::EngineConfiguration(const QString& name,
 	  m_protocol(protocol),
 	  m_variants(QStringList() << "standard"),
 	  m_whiteEvalPov(false),
+	  m_pondering(false),
 	  m_validateClaims(true),
 	  m_restartMode(RestartAuto)
 {
@@ -45,6 +49,7 @@ EngineConfiguration::EngineConfiguration(const QString& name,
 EngineConfiguration::EngineConfiguration(const QVariant& variant)
 	: m_variants(QStringList() << "standard"),
 	  m_whiteEvalPov(false),
+	  m_pondering(false),
 	  m_validateClaims(true),
 	  m_restartMode(RestartAuto)
 {
@@ -55,10 +60,17 @@ EngineConfiguration::EngineConfiguration(const QVariant& variant)
 	setWorkingDirectory(map["workingDirectory"].toString());
 	setProtocol(map["protocol"].toString());
 
+	if (map.contains("host"))
+		setHost(map["host"].toString());
+
 	if (map.contains("initStrings"))
 		setInitStrings(map["initStrings"].toStringList());
+	if (map.contains("dataFiles"))
+		setDataFiles(map["dataFiles"].toStringList());
 	if (map.contains("whitepov"))
 		setWhiteEvalPov(map["whitepov"].toBool());
+	if (map.contains("ponder"))
+		setPondering(map["ponder"].toBool());
 
 	if (map.contains("restart"))
 	{
@@ -94,11 +106,14 @@ EngineConfiguration::EngineConfiguration(const EngineConfiguration& other)
 	: m_name(other.m_name),
 	  m_command(other.m_command),
 	  m_workingDirectory(other.m_workingDirectory),
+	  m_host(other.m_host),
 	  m_protocol(other.m_protocol),
 	  m_arguments(other.m_arguments),
 	  m_initStrings(other.m_initStrings),
+	  m_dataFiles(other.m_dataFiles),
 	  m_variants(other.m_variants),
 	  m_whiteEvalPov(other.m_whiteEvalPov),
+	  m_pondering(other.m_pondering),
 	  m_validateClaims(other.m_validateClaims),
 	  m_restartMode(other.m_restartMode)
 {
@@ -120,10 +135,17 @@ QVariant EngineConfiguration::toVariant() const
 	map.insert("workingDirectory", m_workingDirectory);
 	map.insert("protocol", m_protocol);
 
+	if (!m_host.isEmpty())
+		map.insert("host", m_host);
+
 	if (!m_initStrings.isEmpty())
 		map.insert("initStrings", m_initStrings);
+	if (!m_dataFiles.isEmpty())
+		map.insert("dataFiles", m_dataFiles);
 	if (m_whiteEvalPov)
 		map.insert("whitepov", true);
+	if (m_pondering)
+		map.insert("ponder", true);
 
 	if (m_restartMode == RestartOn)
 		map.insert("restart", "on");
@@ -168,6 +190,11 @@ void EngineConfiguration::setWorkingDirectory(const QString& workingDir)
 	m_workingDirectory = workingDir;
 }
 
+void EngineConfiguration::setHost(const QString& host)
+{
+	m_host = host;
+}
+
 QString EngineConfiguration::name() const
 {
 	return m_name;
@@ -183,6 +210,11 @@ QString EngineConfiguration::workingDirectory() const
 	return m_workingDirectory;
 }
 
+QString EngineConfiguration::host() const
+{
+	return m_host;
+}
+
 QString EngineConfiguration::protocol() const
 {
 	return m_protocol;
@@ -218,6 +250,71 @@ void EngineConfiguration::addInitString(const QString& initString)
 	m_initStrings << initString.split('\n');
 }
 
+QStringList EngineConfiguration::dataFiles() const
+{
+	return m_dataFiles;
+}
+
+void EngineConfiguration::setDataFiles(const QStringList& files)
+{
+	m_dataFiles = files;
+}
+
+void EngineConfiguration::addDataFile(const QString& file)
+{
+	m_dataFiles << file;
+}
+
+QStringList EngineConfiguration::resolvedDataFiles() const
+{
+	QStringList candidates(m_dataFiles);
+	foreach (const EngineOption* option, m_options)
+	{
+		if (option->valueType() != QVariant::String)
+			continue;
+		QString value(option->value().toString());
+		if (!value.isEmpty() && value.size() < 1024)
+			candidates << value;
+	}
+
+	// Same lookup as EngineBuilder: an empty working directory
+	// means the engine runs in the temp directory
+	QStringList dirs;
+	dirs << (m_workingDirectory.isEmpty() ?
+		 QDir::tempPath() : m_workingDirectory);
+	QString program(m_command.trimmed().section(' ', 0, 0).remove('"'));
+	if (!program.isEmpty())
+	{
+		QFileInfo info(program);
+		if (info.isRelative() && !m_workingDirectory.isEmpty())
+			info.setFile(QDir(m_workingDirectory), program);
+		dirs << info.absolutePath();
+	}
+
+	QStringList files;
+	foreach (const QString& candidate, candidates)
+	{
+		QFileInfo info(candidate);
+		if (info.isRelative())
+		{
+			foreach (const QString& dir, dirs)
+			{
+				info.setFile(QDir(dir), candidate);
+				if (info.isFile())
+					break;
+			}
+		}
+		if (!info.isFile())
+			continue;
+
+		QString path(info.absoluteFilePath());
+		if (!files.contains(path))
+			files << path;
+	}
+
+	return files;
+}
+
 QStringList EngineConfiguration::supportedVariants() const
 {
 	return m_variants;
@@ -278,6 +375,16 @@ void EngineConfiguration::setWhiteEvalPov(bool whiteEvalPov)
 	m_whiteEvalPov = whiteEvalPov;
 }
 
+bool EngineConfiguration::pondering() const
+{
+	return m_pondering;
+}
+
+void EngineConfiguration::setPondering(bool enabled)
+{
+	m_pondering = enabled;
+}
+
 EngineConfiguration::RestartMode EngineConfiguration::restartMode() const
 {
 	return m_restartMode;
@@ -305,11 +412,14 @@ EngineConfiguration& EngineConfiguration::operator=(const EngineConfiguration& o
 		m_name = other.m_name;
 		m_command = other.m_command;
 		m_workingDirectory = other.m_workingDirectory;
+		m_host = other.m_host;
 		m_protocol = other.m_protocol;
 		m_arguments = other.m_arguments;
 		m_initStrings = other.m_initStrings;
+		m_dataFiles = other.m_dataFiles;
 		m_variants = other.m_variants;
 		m_whiteEvalPov = other.m_whiteEvalPov;
+		m_pondering = other.m_pondering;
 		m_validateClaims = other.m_validateClaims;
 		m_restartMode = other.m_restartMode;
 
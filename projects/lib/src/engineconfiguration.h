@@ -85,6 +85,13 @@ class LIB_EXPORT EngineConfiguration
 		 * \sa workingDirectory()
 		 */
 		void setWorkingDirectory(const QString& workingDir);
+		/*!
+		 * Sets the worker node that runs the engine to \a host,
+		 * given as "HOST:PORT".
+		 *
+		 * \sa host()
+		 */
+		void setHost(const QString& host);
 		/*!
 		 * Sets the communication protocol the engine uses.
 		 *
@@ -110,6 +117,13 @@ class LIB_EXPORT EngineConfiguration
 		 * \sa setWorkingDirectory()
 		 */
 		QString workingDirectory() const;
+		/*!
+		 * Returns the worker node that runs the engine, or an empty
+		 * string if the engine isn't tied to a specific node.
+		 *
+		 * \sa setHost(), EngineBuilder::setRemoteHosts()
+		 */
+		QString host() const;
 		/*!
 		 * Returns the communication protocol the engine uses.
 		 *
@@ -131,6 +145,28 @@ class LIB_EXPORT EngineConfiguration
 		/*! Adds new initialization string. */
 		void addInitString(const QString& initString);
 
+		/*!
+		 * Returns the data files (eg. neural networks) that the
+		 * engine reads when it starts.
+		 *
+		 * \sa resolvedDataFiles()
+		 */
+		QStringList dataFiles() const;
+		/*! Sets the engine's data files to \a files. */
+		void setDataFiles(const QStringList& files);
+		/*! Adds \a file to the engine's data files. */
+		void addDataFile(const QString& file);
+		/*!
+		 * Returns the absolute paths of the engine's data files
+		 * that exist.
+		 *
+		 * Besides dataFiles(), the values of text options that name
+		 * existing files (eg. "EvalFile") are included. Relative
+		 * paths are looked up in the engine's working directory
+		 * and in the directory of the engine's executable.
+		 */
+		QStringList resolvedDataFiles() const;
+
 		/*!
 		 * Returns a list of the chess variants the engine can play.
 		 *
@@ -159,6 +195,14 @@ class LIB_EXPORT EngineConfiguration
 		/*! Sets white evaluation point of view. */
 		void setWhiteEvalPov(bool whiteEvalPov);
 
+		/*!
+		 * Returns true if the engine is allowed to ponder.
+		 * The default value is false.
+		 */
+		bool pondering() const;
+		/*! Sets pondering mode to \a enabled. */
+		void setPondering(bool enabled);
+
 		/*!
 		 * Returns the restart mode.
 		 * The default value is \a RestartAuto.
@@ -188,12 +232,15 @@ class LIB_EXPORT EngineConfiguration
 		QString m_name;
 		QString m_command;
 		QString m_workingDirectory;
+		QString m_host;
 		QString m_protocol;
 		QStringList m_arguments;
 		QStringList m_initStrings;
+		QStringList m_dataFiles;
 		QStringList m_variants;
 		QList<EngineOption*> m_options;
 		bool m_whiteEvalPov;
+		bool m_pondering;
 		bool m_validateClaims;
 		RestartMode m_restartMode;
 };
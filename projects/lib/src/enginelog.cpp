@@ -0,0 +1,209 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "enginelog.h"
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QHash>
+#include <QFile>
+#include <QDir>
+#include <QRegExp>
+
+namespace {
+
+struct LogEntry
+{
+	int engine;
+	qint64 time;
+	char direction;		// Zero closes the engine's file
+	QString name;
+	QByteArray line;
+};
+
+class LogWriter : public QThread
+{
+	protected:
+		virtual void run();
+};
+
+// The maximum number of lines waiting to be written
+const int s_maxQueueSize = 100000;
+
+QMutex s_mutex;
+QWaitCondition s_queueNotEmpty;
+QVector<LogEntry> s_queue;
+QElapsedTimer s_clock;
+QString s_dir;
+LogWriter* s_writer = 0;
+bool s_stopping = false;
+int s_dropped = 0;
+
+QFile* openLog(const LogEntry& entry)
+{
+	QString name(entry.name);
+	name.replace(QRegExp("[^A-Za-z0-9_.-]"), "_");
+	QFile* file = new QFile(QDir(s_dir).filePath(QString("%1-%2.log")
+						    .arg(name).arg(entry.engine)));
+	if (!file->open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		qWarning("Cannot open engine log %s", qPrintable(file->fileName()));
+		delete file;
+		return 0;
+	}
+
+	return file;
+}
+
+void LogWriter::run()
+{
+	QHash<int, QFile*> files;
+	QVector<LogEntry> batch;
+	QByteArray buffer;
+
+	forever
+	{
+		{
+			QMutexLocker locker(&s_mutex);
+			while (s_queue.isEmpty() && !s_stopping)
+				s_queueNotEmpty.wait(&s_mutex);
+			if (s_queue.isEmpty())
+				break;
+			batch = s_queue;
+			s_queue.clear();
+		}
+
+		foreach (const LogEntry& entry, batch)
+		{
+			if (entry.direction == 0)
+			{
+				delete files.take(entry.engine);
+				continue;
+			}
+
+			// A file that can't be opened is only reported once
+			if (!files.contains(entry.engine))
+				files[entry.engine] = openLog(entry);
+			QFile* file = files.value(entry.engine);
+			if (file == 0)
+				continue;
+
+			buffer.resize(0);
+			buffer += QByteArray::number(entry.time);
+			buffer += ' ';
+			buffer += entry.direction;
+			buffer += ' ';
+			buffer += entry.line;
+			buffer += '\n';
+			file->write(buffer);
+		}
+		batch.clear();
+
+		foreach (QFile* file, files)
+		{
+			if (file != 0)
+				file->flush();
+		}
+	}
+
+	qDeleteAll(files);
+}
+
+} // anonymous namespace
+
+bool EngineLog::s_enabled = false;
+
+bool EngineLog::start(const QString& dir)
+{
+	if (!QDir().mkpath(dir))
+		return false;
+
+	QMutexLocker locker(&s_mutex);
+	if (s_writer != 0)
+		return false;
+
+	s_dir = dir;
+	s_queue.clear();
+	s_stopping = false;
+	s_dropped = 0;
+	s_clock.start();
+	s_writer = new LogWriter;
+	s_writer->start(QThread::LowPriority);
+	s_enabled = true;
+	return true;
+}
+
+void EngineLog::finish()
+{
+	LogWriter* writer;
+	int dropped;
+	{
+		QMutexLocker locker(&s_mutex);
+		if (s_writer == 0)
+			return;
+		s_enabled = false;
+		s_stopping = true;
+		s_queueNotEmpty.wakeOne();
+		writer = s_writer;
+		s_writer = 0;
+		dropped = s_dropped;
+	}
+
+	writer->wait();
+	delete writer;
+
+	if (dropped > 0)
+		qWarning("%d lines were left out of the engine logs because "
+			 "the disk couldn't keep up", dropped);
+}
+
+void EngineLog::write(int engineId,
+		      const QString& engineName,
+		      char direction,
+		      const QByteArray& line)
+{
+	LogEntry entry = { engineId, s_clock.elapsed(), direction,
+			   engineName, line };
+
+	QMutexLocker locker(&s_mutex);
+	if (!s_enabled)
+		return;
+	if (s_queue.size() >= s_maxQueueSize)
+	{
+		s_dropped++;
+		return;
+	}
+
+	if (s_queue.isEmpty())
+		s_queueNotEmpty.wakeOne();
+	s_queue.append(entry);
+}
+
+void EngineLog::close(int engineId)
+{
+	LogEntry entry = { engineId, 0, 0, QString(), QByteArray() };
+
+	QMutexLocker locker(&s_mutex);
+	if (!s_enabled)
+		return;
+
+	if (s_queue.isEmpty())
+		s_queueNotEmpty.wakeOne();
+	s_queue.append(entry);
+}
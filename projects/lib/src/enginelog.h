@@ -0,0 +1,75 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ENGINELOG_H
+#define ENGINELOG_H
+
+#include <QString>
+#include <QByteArray>
+
+/*!
+ * \brief Per-engine debug log files written by a background thread.
+ *
+ * When the log is enabled, every line sent to and received from an
+ * engine is written, with a timestamp in milliseconds, to a file
+ * named after the engine in the log directory. Each engine instance
+ * gets its own file.
+ *
+ * The engines only append their lines to a queue, and a background
+ * thread writes them in batches through buffered files. The queue is
+ * bounded: if the disk can't keep up, new lines are dropped instead
+ * of slowing the games down, and the number of dropped lines is
+ * reported by finish().
+ *
+ * The logging functions are thread-safe. The callers should check
+ * isEnabled() before doing any work for the log.
+ */
+class LIB_EXPORT EngineLog
+{
+	public:
+		/*! Returns true if the engines' I/O is being logged. */
+		static bool isEnabled() { return s_enabled; }
+
+		/*!
+		 * Starts logging the engines' I/O to directory \a dir.
+		 * This should be called before any engines are started.
+		 * Returns true if successful.
+		 */
+		static bool start(const QString& dir);
+		/*!
+		 * Writes the queued lines, closes the files and stops
+		 * logging.
+		 */
+		static void finish();
+
+		/*!
+		 * Logs the line \a line of engine \a engineId, whose name
+		 * is \a engineName. \a direction is '>' for lines sent to
+		 * the engine and '<' for lines received from it.
+		 */
+		static void write(int engineId,
+				  const QString& engineName,
+				  char direction,
+				  const QByteArray& line);
+		/*! Closes the log file of engine \a engineId. */
+		static void close(int engineId);
+
+	private:
+		static bool s_enabled;
+};
+
+#endif // ENGINELOG_H
@@ -19,7 +19,7 @@
 #include <QSettings>
 #include <QFile>
 #include <QTextStream>
-#include <jsonparser.h>
+#include <jsonreader.h>
 #include <jsonserializer.h>
 
 
@@ -81,26 +81,40 @@ void EngineManager::loadEngines(const QString& fileName)
 		return;
 
 	QFile input(fileName);
-	if (!input.open(QIODevice::ReadOnly | QIODevice::Text))
+	if (!input.open(QIODevice::ReadOnly))
 	{
 		qWarning("cannot open engine configuration file: %s", qPrintable(fileName));
 		return;
 	}
 
-	QTextStream stream(&input);
-	JsonParser parser(stream);
-	const QVariantList engines(parser.parse().toList());
+	// Read the engines one at a time instead of building the
+	// whole document in memory
+	QList<EngineConfiguration> engines;
+	JsonReader reader(&input);
+	if (reader.readNext() == JsonReader::BeginArray)
+	{
+		while (reader.readNext() != JsonReader::EndArray
+		   &&  !reader.hasError())
+		{
+			const QVariant engine(reader.readValue());
+			if (!reader.hasError())
+				engines << EngineConfiguration(engine);
+		}
+	}
+	else
+		reader.skipValue();
+	reader.readNext();
 
-	if (parser.hasError())
+	if (reader.hasError())
 	{
 		qWarning("%s", qPrintable(QString("bad engine configuration file line %1 in %2: %3")
-			.arg(parser.errorLineNumber()).arg(fileName)
-			.arg(parser.errorString())));
+			.arg(reader.lineNumber()).arg(fileName)
+			.arg(reader.errorString())));
 		return;
 	}
 
-	foreach(const QVariant& engine, engines)
-		addEngine(EngineConfiguration(engine));
+	foreach (const EngineConfiguration& engine, engines)
+		addEngine(engine);
 }
 
 void EngineManager::saveEngines(const QString& fileName)
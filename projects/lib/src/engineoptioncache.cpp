@@ -0,0 +1,225 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "engineoptioncache.h"
+#include <QHash>
+#include <QMutex>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QTextStream>
+#if QT_VERSION >= 0x050100
+#include <QStandardPaths>
+#endif
+#include <jsonreader.h>
+#include <jsonserializer.h>
+#include "engineconfiguration.h"
+#include "engineoption.h"
+#include "engineoptionfactory.h"
+
+struct OptionCacheEntry
+{
+	QVariantList options;
+	QStringList variants;
+};
+
+static QMutex s_mutex;
+static QString s_fileName;
+static bool s_loaded = false;
+static QHash<QString, OptionCacheEntry> s_entries;
+
+// Returns the engine's executable, or an empty string if it can't
+// be found
+static QString executablePath(const EngineConfiguration& engine)
+{
+	QString cmd(engine.command().trimmed());
+	if (engine.arguments().isEmpty() && !QFileInfo(cmd).isFile())
+	{
+		// The program is the first token of the command line
+		if (cmd.startsWith('\"'))
+			cmd = cmd.mid(1, cmd.indexOf('\"', 1) - 1);
+		else
+			cmd = cmd.section(' ', 0, 0);
+	}
+	if (cmd.isEmpty())
+		return QString();
+
+	QDir dir(engine.workingDirectory().isEmpty() ?
+		 QDir::current() : QDir(engine.workingDirectory()));
+	QFileInfo info(dir, cmd);
+	if (info.isFile())
+		return info.canonicalFilePath();
+
+#if QT_VERSION >= 0x050100
+	if (!cmd.contains('/') && !cmd.contains('\\'))
+	{
+		QString path(QStandardPaths::findExecutable(cmd));
+		if (!path.isEmpty())
+			return QFileInfo(path).canonicalFilePath();
+	}
+#endif
+	return QString();
+}
+
+static QString cacheKey(const EngineConfiguration& engine)
+{
+	QString path(executablePath(engine));
+	if (path.isEmpty())
+		return QString();
+
+	QFileInfo info(path);
+	return QString("%1|%2|%3|%4|%5|%6|%7")
+		.arg(engine.protocol())
+		.arg(engine.command())
+		.arg(engine.arguments().join(" "))
+		.arg(engine.workingDirectory())
+		.arg(path)
+		.arg(info.size())
+		.arg(info.lastModified().toMSecsSinceEpoch());
+}
+
+static void loadEntries()
+{
+	s_loaded = true;
+	if (s_fileName.isEmpty())
+		return;
+
+	QFile file(s_fileName);
+	if (!file.open(QIODevice::ReadOnly))
+		return;
+
+	JsonReader reader(&file);
+	const QVariantMap map(reader.readNext() == JsonReader::BeginObject ?
+			      reader.readValue().toMap() : QVariantMap());
+	if (reader.hasError())
+	{
+		qWarning("bad engine option cache file %s: %s",
+			 qPrintable(s_fileName),
+			 qPrintable(reader.errorString()));
+		return;
+	}
+
+	QVariantMap::const_iterator it;
+	for (it = map.constBegin(); it != map.constEnd(); ++it)
+	{
+		const QVariantMap value(it.value().toMap());
+		OptionCacheEntry entry;
+		entry.options = value.value("options").toList();
+		entry.variants = value.value("variants").toStringList();
+		s_entries[it.key()] = entry;
+	}
+}
+
+static void saveEntries()
+{
+	if (s_fileName.isEmpty())
+		return;
+
+	QVariantMap map;
+	QHash<QString, OptionCacheEntry>::const_iterator it;
+	for (it = s_entries.constBegin(); it != s_entries.constEnd(); ++it)
+	{
+		QVariantMap value;
+		value["options"] = it.value().options;
+		value["variants"] = it.value().variants;
+		map[it.key()] = value;
+	}
+
+	QFile file(s_fileName);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+	{
+		qWarning("cannot write engine option cache file: %s",
+			 qPrintable(s_fileName));
+		return;
+	}
+
+	QTextStream out(&file);
+	JsonSerializer serializer(map);
+	serializer.serialize(out);
+}
+
+void EngineOptionCache::setFileName(const QString& fileName)
+{
+	QMutexLocker locker(&s_mutex);
+
+	s_fileName = fileName;
+	s_loaded = false;
+	s_entries.clear();
+}
+
+bool EngineOptionCache::lookup(const EngineConfiguration& engine,
+			       QList<EngineOption*>* options,
+			       QStringList* variants)
+{
+	Q_ASSERT(options != 0);
+	Q_ASSERT(variants != 0);
+
+	const QString key(cacheKey(engine));
+	if (key.isEmpty())
+		return false;
+
+	QMutexLocker locker(&s_mutex);
+	if (!s_loaded)
+		loadEntries();
+
+	QHash<QString, OptionCacheEntry>::const_iterator it(s_entries.constFind(key));
+	if (it == s_entries.constEnd())
+		return false;
+
+	foreach (const QVariant& value, it.value().options)
+	{
+		EngineOption* option = EngineOptionFactory::create(value.toMap());
+		if (option != 0)
+			options->append(option);
+	}
+	*variants = it.value().variants;
+	return true;
+}
+
+void EngineOptionCache::store(const EngineConfiguration& engine,
+			      const QList<EngineOption*>& options,
+			      const QStringList& variants)
+{
+	const QString key(cacheKey(engine));
+	if (key.isEmpty())
+		return;
+
+	OptionCacheEntry entry;
+	foreach (const EngineOption* option, options)
+		entry.options << option->toVariant();
+	entry.variants = variants;
+
+	QMutexLocker locker(&s_mutex);
+	if (!s_loaded)
+		loadEntries();
+
+	// Forget older versions of the same executable
+	const QString prefix(key.left(key.lastIndexOf('|', key.lastIndexOf('|') - 1) + 1));
+	QHash<QString, OptionCacheEntry>::iterator it;
+	for (it = s_entries.begin(); it != s_entries.end(); )
+	{
+		if (it.key().startsWith(prefix))
+			it = s_entries.erase(it);
+		else
+			++it;
+	}
+
+	s_entries[key] = entry;
+	saveEntries();
+}
@@ -0,0 +1,79 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ENGINE_OPTION_CACHE_H
+#define ENGINE_OPTION_CACHE_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+class EngineConfiguration;
+class EngineOption;
+
+/*!
+ * \brief A persistent cache of the options and variants engines report.
+ *
+ * Finding out which options and variants an engine supports requires
+ * starting the engine and completing the protocol handshake, which
+ * can take seconds. The cache remembers what each engine reported,
+ * so the information can be reused without starting the engine.
+ *
+ * An engine is identified by its protocol, command line and working
+ * directory, and by the canonical path, size and modification time of
+ * its executable. When the executable is replaced, the cached entry
+ * no longer matches and the engine must be queried again. Engines
+ * whose executable can't be resolved are never cached.
+ *
+ * The entries are kept in a JSON file which is read when the cache
+ * is first used. All functions of this class are thread-safe.
+ */
+class LIB_EXPORT EngineOptionCache
+{
+	public:
+		/*!
+		 * Sets the file where the cache is stored to \a fileName.
+		 *
+		 * An empty \a fileName (the default) keeps the cache in
+		 * memory only.
+		 */
+		static void setFileName(const QString& fileName);
+
+		/*!
+		 * Looks up the cached options and variants of \a engine.
+		 *
+		 * Returns true and stores new option objects, which are
+		 * owned by the caller, in \a options and the variants in
+		 * \a variants if the cache has a valid entry for
+		 * \a engine. Otherwise returns false.
+		 */
+		static bool lookup(const EngineConfiguration& engine,
+				   QList<EngineOption*>* options,
+				   QStringList* variants);
+		/*!
+		 * Stores the \a options and \a variants reported by
+		 * \a engine in the cache.
+		 */
+		static void store(const EngineConfiguration& engine,
+				  const QList<EngineOption*>& options,
+				  const QStringList& variants);
+
+	private:
+		EngineOptionCache();
+};
+
+#endif // ENGINE_OPTION_CACHE_H
@@ -20,11 +20,13 @@
 
 #include <QtGlobal>
 
-#ifdef Q_OS_WIN32
+#if defined(Q_OS_WIN32)
   #include "engineprocess_win.h"
-#else // not Q_OS_WIN32
+#elif defined(Q_OS_UNIX)
+  #include "engineprocess_unix.h"
+#else // not Q_OS_WIN32 or Q_OS_UNIX
   #include <QProcess>
   #define EngineProcess QProcess
-#endif // not Q_OS_WIN32
+#endif // not Q_OS_WIN32 or Q_OS_UNIX
 
 #endif // ENGINEPROCESS_H
@@ -0,0 +1,819 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "engineprocess_unix.h"
+#include <QAtomicInt>
+#include <QDir>
+#include <QFile>
+#include <QRegExp>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <QTime>
+#include <QVarLengthArray>
+#include <sys/wait.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <climits>
+
+// The maximum number of bytes of standard error output read at a
+// time, so that a flood of it can't starve the standard output
+static const int s_maxErrorRead = 0x10000;
+
+// Creates a pipe whose both ends are closed in child processes, so
+// that engines started from other threads don't inherit them.
+static bool createPipe(int fds[2])
+{
+#ifdef Q_OS_LINUX
+	return ::pipe2(fds, O_CLOEXEC) == 0;
+#else // not Q_OS_LINUX
+	if (::pipe(fds) != 0)
+		return false;
+	::fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+	::fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+	return true;
+#endif // not Q_OS_LINUX
+}
+
+#ifdef Q_OS_LINUX
+static bool writeCgroupFile(const QString& path, const QByteArray& data)
+{
+	QFile file(path);
+	return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+
+// Returns the value of \a key in a "key value" file like cpu.stat
+static qint64 cgroupStat(const QByteArray& data, const QByteArray& key)
+{
+	foreach (const QByteArray& line, data.split('\n'))
+	{
+		if (line.startsWith(key + ' '))
+			return line.mid(key.size() + 1).trimmed().toLongLong();
+	}
+	return 0;
+}
+#endif // Q_OS_LINUX
+
+
+EngineProcess::EngineProcess(QObject* parent)
+	: QIODevice(parent),
+	  m_started(false),
+	  m_finished(false),
+	  m_exitCode(0),
+	  m_exitStatus(EngineProcess::NormalExit),
+	  m_cgroupCpu(0),
+	  m_cgroupMemory(0),
+	  m_pid(-1),
+	  m_inWrite(-1),
+	  m_outRead(-1),
+	  m_notifier(0),
+	  m_writeNotifier(0),
+	  m_errRead(-1),
+	  m_errFile(-1),
+	  m_errCaptureSize(0),
+	  m_errNotifier(0),
+	  m_reapTimer(new QTimer(this))
+{
+	m_reapTimer->setSingleShot(true);
+	m_reapTimer->setInterval(10);
+	connect(m_reapTimer, SIGNAL(timeout()), this, SLOT(onFinished()));
+}
+
+EngineProcess::~EngineProcess()
+{
+	if (m_started)
+	{
+		qWarning("EngineProcess: Destroyed while process is still running.");
+		kill();
+		waitForFinished();
+	}
+	cleanup();
+}
+
+int EngineProcess::exitCode() const
+{
+	return m_exitCode;
+}
+
+EngineProcess::ExitStatus EngineProcess::exitStatus() const
+{
+	return m_exitStatus;
+}
+
+qint64 EngineProcess::bytesAvailable() const
+{
+	return m_buffer.size() + QIODevice::bytesAvailable();
+}
+
+qint64 EngineProcess::bytesToWrite() const
+{
+	return m_writeBuffer.size();
+}
+
+bool EngineProcess::canReadLine() const
+{
+	return m_buffer.contains('\n') || QIODevice::canReadLine();
+}
+
+void EngineProcess::closeFd(int* fd)
+{
+	if (*fd == -1)
+		return;
+	::close(*fd);
+	*fd = -1;
+}
+
+void EngineProcess::cleanup()
+{
+	if (m_notifier != 0)
+	{
+		// The notifier may be in the middle of emitting its
+		// activated() signal, so it can't be deleted right away.
+		m_notifier->setEnabled(false);
+		m_notifier->deleteLater();
+		m_notifier = 0;
+	}
+	if (m_writeNotifier != 0)
+	{
+		m_writeNotifier->setEnabled(false);
+		m_writeNotifier->deleteLater();
+		m_writeNotifier = 0;
+	}
+	m_reapTimer->stop();
+
+	// Keep the last error output, which may explain a crash
+	if (m_errRead != -1)
+		readErrorPipe(INT_MAX);
+	if (m_errNotifier != 0)
+	{
+		m_errNotifier->setEnabled(false);
+		m_errNotifier->deleteLater();
+		m_errNotifier = 0;
+	}
+
+	closeFd(&m_inWrite);
+	closeFd(&m_outRead);
+	closeFd(&m_errRead);
+	closeFd(&m_errFile);
+	m_buffer.clear();
+	m_writeBuffer.clear();
+	if (m_pid == -1)
+		removeCgroup();
+
+	m_started = false;
+}
+
+QString EngineProcess::createCgroup() const
+{
+#ifdef Q_OS_LINUX
+	static QAtomicInt s_count;
+
+	// The CPU and memory controllers must be enabled for the children
+	// of the parent group. That fails if the parent has processes of
+	// its own, which is why a dedicated parent group is needed.
+	QDir parent(m_cgroupParent);
+	QFile control(parent.filePath("cgroup.subtree_control"));
+	if (control.open(QIODevice::ReadOnly))
+	{
+		QList<QByteArray> enabled(control.readAll().simplified().split(' '));
+		control.close();
+		QByteArray missing;
+		if (m_cgroupCpu > 0 && !enabled.contains("cpu"))
+			missing += "+cpu ";
+		if (m_cgroupMemory > 0 && !enabled.contains("memory"))
+			missing += "+memory ";
+		if (!missing.isEmpty()
+		&&  !writeCgroupFile(control.fileName(), missing.trimmed()))
+			qWarning("Cannot enable the cgroup controllers in %s",
+				 qPrintable(parent.path()));
+	}
+
+	QString name(QString("cutechess-%1-%2")
+		     .arg(::getpid()).arg(s_count.fetchAndAddRelaxed(1) + 1));
+	if (!parent.mkdir(name))
+	{
+		qWarning("Cannot create cgroup %s", qPrintable(parent.filePath(name)));
+		return QString();
+	}
+	QString path(parent.filePath(name));
+
+	// The quota is given per 100 ms scheduling period
+	if (m_cgroupCpu > 0
+	&&  !writeCgroupFile(path + "/cpu.max",
+			     QByteArray::number(m_cgroupCpu * 1000) + " 100000"))
+		qWarning("Cannot set the CPU quota of cgroup %s", qPrintable(path));
+	if (m_cgroupMemory > 0
+	&&  !writeCgroupFile(path + "/memory.max",
+			     QByteArray::number(m_cgroupMemory)))
+		qWarning("Cannot set the memory limit of cgroup %s", qPrintable(path));
+
+	return path;
+#else // not Q_OS_LINUX
+	return QString();
+#endif // not Q_OS_LINUX
+}
+
+void EngineProcess::removeCgroup()
+{
+	if (m_cgroup.isEmpty())
+		return;
+
+#ifdef Q_OS_LINUX
+	// Processes that the engine left behind keep the group alive
+	writeCgroupFile(m_cgroup + "/cgroup.kill", "1");
+	QDir dir(m_cgroup);
+	if (!dir.rmdir(dir.path()))
+	{
+		::usleep(10000);
+		if (!dir.rmdir(dir.path()))
+			qWarning("Cannot remove cgroup %s", qPrintable(m_cgroup));
+	}
+#endif // Q_OS_LINUX
+	m_cgroup.clear();
+}
+
+void EngineProcess::close()
+{
+	if (!m_started)
+		return;
+
+	emit aboutToClose();
+	kill();
+	waitForFinished(-1);
+	cleanup();
+	QIODevice::close();
+}
+
+bool EngineProcess::isSequential() const
+{
+	return true;
+}
+
+void EngineProcess::setWorkingDirectory(const QString& dir)
+{
+	m_workDir = dir;
+}
+
+void EngineProcess::setCpuAffinity(const QList<int>& cpus)
+{
+	m_cpus = cpus;
+}
+
+void EngineProcess::setCgroup(const QString& parent,
+			      int cpuPercent,
+			      qint64 memoryLimit)
+{
+	m_cgroupParent = parent;
+	m_cgroupCpu = qMax(cpuPercent, 0);
+	m_cgroupMemory = qMax(memoryLimit, qint64(0));
+}
+
+void EngineProcess::setStandardErrorCapture(int size, const QString& fileName)
+{
+	m_errCaptureSize = qMax(size, 0);
+	m_errFileName = fileName;
+}
+
+QByteArray EngineProcess::standardErrorTail() const
+{
+	return m_errBuffer.right(m_errCaptureSize);
+}
+
+bool EngineProcess::resourceUsage(qint64* cpuTime,
+				  qint64* memory,
+				  int* threads) const
+{
+	*cpuTime = -1;
+	*memory = -1;
+	*threads = -1;
+	if (!m_started || m_finished || m_pid == -1)
+		return false;
+
+#ifdef Q_OS_LINUX
+	QFile file(QString("/proc/%1/stat").arg(m_pid));
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+	QByteArray stat(file.readAll());
+
+	// The command name is in parentheses and may contain spaces,
+	// so the fields are counted from the last closing parenthesis
+	int pos = stat.lastIndexOf(')');
+	if (pos == -1)
+		return false;
+	QList<QByteArray> fields(stat.mid(pos + 2).split(' '));
+	if (fields.size() < 22)
+		return false;
+
+	// Fields 14 and 15 (utime, stime), 20 (num_threads) and 24 (rss)
+	// of proc(5), counted from field 3 (state)
+	qint64 ticks = fields.at(11).toLongLong() + fields.at(12).toLongLong();
+	*cpuTime = ticks * 1000 / sysconf(_SC_CLK_TCK);
+	*threads = fields.at(17).toInt();
+	*memory = fields.at(21).toLongLong() * sysconf(_SC_PAGESIZE);
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool EngineProcess::throttleStats(qint64* throttledTime,
+				  int* throttleCount,
+				  int* memoryEvents) const
+{
+	*throttledTime = -1;
+	*throttleCount = -1;
+	*memoryEvents = -1;
+	if (m_cgroup.isEmpty())
+		return false;
+
+#ifdef Q_OS_LINUX
+	QFile cpuStat(m_cgroup + "/cpu.stat");
+	if (!cpuStat.open(QIODevice::ReadOnly))
+		return false;
+	QByteArray stat(cpuStat.readAll());
+	*throttledTime = cgroupStat(stat, "throttled_usec") / 1000;
+	*throttleCount = int(cgroupStat(stat, "nr_throttled"));
+
+	// "max" counts the times the usage hit the limit and had to be
+	// reclaimed, "oom_kill" the processes killed for it
+	QFile events(m_cgroup + "/memory.events");
+	if (events.open(QIODevice::ReadOnly))
+	{
+		QByteArray data(events.readAll());
+		*memoryEvents = int(cgroupStat(data, "max")
+				  + cgroupStat(data, "oom_kill"));
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+void EngineProcess::start(const QString& program,
+			  const QStringList& arguments,
+			  OpenMode mode)
+{
+	if (m_started)
+		close();
+
+	m_started = false;
+	m_finished = false;
+	m_exitCode = 0;
+	m_exitStatus = NormalExit;
+	m_buffer.clear();
+	m_writeBuffer.clear();
+	m_errBuffer.clear();
+
+	// Everything the child needs is prepared before forking because
+	// the child shares our memory until it calls exec.
+	QList<QByteArray> args;
+	args << QFile::encodeName(program);
+	foreach (const QString& arg, arguments)
+		args << arg.toLocal8Bit();
+
+	QVarLengthArray<char*> argv;
+	for (int i = 0; i < args.size(); i++)
+		argv.append(args[i].data());
+	argv.append(0);
+
+	QByteArray workDir(QFile::encodeName(m_workDir));
+
+#ifdef Q_OS_LINUX
+	// The child joins the cgroup before exec, so that the engine's
+	// threads are never started outside of it
+	QByteArray cgroupProcs;
+	removeCgroup();
+	if (!m_cgroupParent.isEmpty())
+	{
+		m_cgroup = createCgroup();
+		if (!m_cgroup.isEmpty())
+			cgroupProcs = QFile::encodeName(m_cgroup + "/cgroup.procs");
+	}
+
+	bool setAffinity = !m_cpus.isEmpty();
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	foreach (int cpu, m_cpus)
+	{
+		if (cpu >= 0 && cpu < CPU_SETSIZE)
+			CPU_SET(cpu, &cpuSet);
+	}
+#endif // Q_OS_LINUX
+
+	int inPipe[2] = { -1, -1 };
+	int outPipe[2] = { -1, -1 };
+	int errPipe[2] = { -1, -1 };
+	if (!createPipe(inPipe) || !createPipe(outPipe) || !createPipe(errPipe))
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			closeFd(&inPipe[i]);
+			closeFd(&outPipe[i]);
+			closeFd(&errPipe[i]);
+		}
+		removeCgroup();
+		return;
+	}
+	int devNull = ::open("/dev/null", O_WRONLY);
+	if (devNull != -1)
+		::fcntl(devNull, F_SETFD, FD_CLOEXEC);
+
+	// The standard error output goes through a pipe if it's kept in
+	// memory, otherwise straight to the log file or to /dev/null
+	int stderrPipe[2] = { -1, -1 };
+	if (m_errCaptureSize > 0)
+		createPipe(stderrPipe);
+	int errFile = -1;
+	if (!m_errFileName.isEmpty())
+	{
+		errFile = ::open(QFile::encodeName(m_errFileName).constData(),
+				 O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (errFile != -1)
+			::fcntl(errFile, F_SETFD, FD_CLOEXEC);
+		else
+			qWarning("Cannot open engine error log %s",
+				 qPrintable(m_errFileName));
+	}
+	int childErr = devNull;
+	if (stderrPipe[1] != -1)
+		childErr = stderrPipe[1];
+	else if (errFile != -1)
+		childErr = errFile;
+
+	pid_t pid = ::vfork();
+	if (pid == 0)
+	{
+		// Child process: only async-signal-safe calls from here on.
+		// If anything fails, errno is reported through 'errPipe',
+		// which is closed automatically by a successful exec.
+		::dup2(inPipe[0], STDIN_FILENO);
+		::dup2(outPipe[1], STDOUT_FILENO);
+		if (childErr != -1)
+			::dup2(childErr, STDERR_FILENO);
+#ifdef Q_OS_LINUX
+		if (setAffinity)
+			::sched_setaffinity(0, sizeof(cpuSet), &cpuSet);
+		if (!cgroupProcs.isEmpty())
+		{
+			// "0" moves the writing process
+			int fd = ::open(cgroupProcs.constData(), O_WRONLY);
+			if (fd != -1)
+			{
+				ssize_t ret = ::write(fd, "0", 1);
+				Q_UNUSED(ret);
+				::close(fd);
+			}
+		}
+#endif // Q_OS_LINUX
+
+		if (workDir.isEmpty() || ::chdir(workDir.constData()) == 0)
+			::execvp(argv[0], argv.data());
+
+		int error = errno;
+		ssize_t ret = ::write(errPipe[1], &error, sizeof(error));
+		Q_UNUSED(ret);
+		::_exit(127);
+	}
+
+	closeFd(&inPipe[0]);
+	closeFd(&outPipe[1]);
+	closeFd(&errPipe[1]);
+	closeFd(&devNull);
+	closeFd(&stderrPipe[1]);
+
+	// Without a pipe the log file is written by the child only
+	if (stderrPipe[0] == -1)
+		closeFd(&errFile);
+
+	int error = 0;
+	ssize_t n = -1;
+	if (pid != -1)
+	{
+		do
+			n = ::read(errPipe[0], &error, sizeof(error));
+		while (n == -1 && errno == EINTR);
+	}
+	closeFd(&errPipe[0]);
+
+	if (pid == -1 || n > 0)
+	{
+		if (pid != -1)
+			::waitpid(pid, 0, 0);
+		closeFd(&inPipe[1]);
+		closeFd(&outPipe[0]);
+		closeFd(&stderrPipe[0]);
+		closeFd(&errFile);
+		removeCgroup();
+		return;
+	}
+
+	m_pid = pid;
+	m_inWrite = inPipe[1];
+	m_outRead = outPipe[0];
+	::fcntl(m_outRead, F_SETFL, ::fcntl(m_outRead, F_GETFL) | O_NONBLOCK);
+	::fcntl(m_inWrite, F_SETFL, ::fcntl(m_inWrite, F_GETFL) | O_NONBLOCK);
+
+	// Start reading input from the child
+	m_notifier = new QSocketNotifier(m_outRead, QSocketNotifier::Read, this);
+	connect(m_notifier, SIGNAL(activated(int)), this, SLOT(onReadyRead()));
+
+	// The write notifier is only enabled while there's pending data
+	m_writeNotifier = new QSocketNotifier(m_inWrite, QSocketNotifier::Write, this);
+	m_writeNotifier->setEnabled(false);
+	connect(m_writeNotifier, SIGNAL(activated(int)), this, SLOT(onWriteReady()));
+
+	if (stderrPipe[0] != -1)
+	{
+		m_errRead = stderrPipe[0];
+		m_errFile = errFile;
+		::fcntl(m_errRead, F_SETFL, ::fcntl(m_errRead, F_GETFL) | O_NONBLOCK);
+		m_errNotifier = new QSocketNotifier(m_errRead, QSocketNotifier::Read, this);
+		connect(m_errNotifier, SIGNAL(activated(int)),
+			this, SLOT(onErrorReadyRead()));
+	}
+	m_started = true;
+
+	// Make QIODevice aware that the device is now open
+	QIODevice::open(mode);
+}
+
+void EngineProcess::start(const QString& program,
+			  OpenMode mode)
+{
+	QStringList args;
+
+	QRegExp rx("((?:[^\\s\"]+)|(?:\"(?:\\\\\"|[^\"])*\"))");
+	int pos = 0;
+	while ((pos = rx.indexIn(program, pos)) != -1)
+	{
+		QString arg(rx.cap());
+		if (arg.size() > 1 && arg.startsWith('\"') && arg.endsWith('\"'))
+			arg = arg.mid(1, arg.size() - 2);
+		args << arg;
+		pos += rx.matchedLength();
+	}
+	if (args.isEmpty())
+		return;
+
+	QString prog = args.first();
+	args.removeFirst();
+	start(prog, args, mode);
+}
+
+void EngineProcess::kill()
+{
+	if (m_started && m_pid != -1)
+		::kill(m_pid, SIGKILL);
+}
+
+bool EngineProcess::readPipe()
+{
+	char buf[0x4000];
+	for (;;)
+	{
+		ssize_t n = ::read(m_outRead, buf, sizeof(buf));
+		if (n > 0)
+			m_buffer.append(buf, int(n));
+		else if (n == 0)
+			return false;
+		else if (errno == EINTR)
+			continue;
+		else
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+	}
+}
+
+bool EngineProcess::readErrorPipe(int maxSize)
+{
+	char buf[0x1000];
+	int total = 0;
+	while (total < maxSize)
+	{
+		ssize_t n = ::read(m_errRead, buf, sizeof(buf));
+		if (n > 0)
+		{
+			total += int(n);
+			if (m_errFile != -1
+			&&  ::write(m_errFile, buf, size_t(n)) != n)
+				closeFd(&m_errFile);
+
+			// Trim the buffer only when it's twice the capture size
+			m_errBuffer.append(buf, int(n));
+			if (m_errBuffer.size() > 2 * m_errCaptureSize)
+				m_errBuffer.remove(0, m_errBuffer.size() - m_errCaptureSize);
+		}
+		else if (n == 0)
+			return false;
+		else if (errno == EINTR)
+			continue;
+		else
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+	}
+	return true;
+}
+
+bool EngineProcess::writePipe()
+{
+	while (!m_writeBuffer.isEmpty())
+	{
+		ssize_t n = ::write(m_inWrite, m_writeBuffer.constData(),
+				    size_t(m_writeBuffer.size()));
+		if (n > 0)
+			m_writeBuffer.remove(0, int(n));
+		else if (n == -1 && errno == EINTR)
+			continue;
+		else
+			return n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+	}
+	return true;
+}
+
+void EngineProcess::onWriteReady()
+{
+	if (m_inWrite == -1)
+		return;
+
+	qint64 oldSize = m_writeBuffer.size();
+	if (!writePipe())
+	{
+		// The engine closed its input; the read side reports
+		// when it finishes
+		m_writeBuffer.clear();
+		closeFd(&m_inWrite);
+	}
+	if (m_writeBuffer.isEmpty())
+		m_writeNotifier->setEnabled(false);
+	if (m_writeBuffer.size() < oldSize)
+		emit bytesWritten(oldSize - m_writeBuffer.size());
+}
+
+void EngineProcess::onErrorReadyRead()
+{
+	if (m_errRead == -1)
+		return;
+
+	if (!readErrorPipe(s_maxErrorRead))
+		m_errNotifier->setEnabled(false);
+}
+
+void EngineProcess::onReadyRead()
+{
+	if (!m_started)
+		return;
+
+	int oldSize = m_buffer.size();
+	bool open = readPipe();
+
+	if (m_buffer.size() > oldSize)
+	{
+		emit readyRead();
+		// The process may have been closed by a readyRead() slot
+		if (!m_started)
+			return;
+	}
+
+	if (!open)
+	{
+		m_notifier->setEnabled(false);
+		if (m_errRead != -1)
+			readErrorPipe(INT_MAX);
+		emit readChannelFinished();
+		onFinished();
+	}
+}
+
+bool EngineProcess::reap(bool block)
+{
+	if (m_pid == -1)
+		return true;
+
+	int status = 0;
+	pid_t ret;
+	do
+		ret = ::waitpid(m_pid, &status, block ? 0 : WNOHANG);
+	while (ret == -1 && errno == EINTR);
+
+	if (ret == 0)
+		return false;
+
+	m_pid = -1;
+	if (ret == -1)
+	{
+		m_exitCode = 0;
+		m_exitStatus = CrashExit;
+	}
+	else if (WIFEXITED(status))
+	{
+		m_exitCode = WEXITSTATUS(status);
+		m_exitStatus = NormalExit;
+	}
+	else
+	{
+		m_exitCode = 0;
+		m_exitStatus = CrashExit;
+	}
+	return true;
+}
+
+void EngineProcess::onFinished()
+{
+	if (!m_started || m_finished)
+		return;
+
+	// The output pipe can close slightly before the process exits
+	if (!reap(false))
+	{
+		m_reapTimer->start();
+		return;
+	}
+
+	m_finished = true;
+	cleanup();
+	emit finished(m_exitCode, m_exitStatus);
+}
+
+bool EngineProcess::waitForFinished(int msecs)
+{
+	if (!m_started)
+		return true;
+
+	if (msecs == -1)
+		reap(true);
+	else
+	{
+		QTime timer;
+		timer.start();
+		while (!reap(false))
+		{
+			if (timer.elapsed() >= msecs)
+				return false;
+			::usleep(1000);
+		}
+	}
+
+	onFinished();
+	return true;
+}
+
+bool EngineProcess::waitForStarted(int msecs)
+{
+	// Don't wait here because start() already did the waiting
+	Q_UNUSED(msecs);
+	return m_started;
+}
+
+QString EngineProcess::workingDirectory() const
+{
+	return m_workDir;
+}
+
+qint64 EngineProcess::readData(char* data, qint64 maxSize)
+{
+	if (!m_started)
+		return -1;
+
+	int n = int(qMin(maxSize, qint64(m_buffer.size())));
+	memcpy(data, m_buffer.constData(), n);
+	m_buffer.remove(0, n);
+	return n;
+}
+
+qint64 EngineProcess::writeData(const char* data, qint64 maxSize)
+{
+	if (!m_started || m_inWrite == -1)
+		return -1;
+
+	// New data goes after the pending data, which is written first
+	bool pending = !m_writeBuffer.isEmpty();
+	m_writeBuffer.append(data, int(maxSize));
+	if (pending)
+		return maxSize;
+
+	if (!writePipe())
+	{
+		m_writeBuffer.clear();
+		closeFd(&m_inWrite);
+		return -1;
+	}
+	if (!m_writeBuffer.isEmpty())
+		m_writeNotifier->setEnabled(true);
+	return maxSize;
+}
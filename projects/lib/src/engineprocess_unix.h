@@ -0,0 +1,253 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ENGINEPROCESS_UNIX_H
+#define ENGINEPROCESS_UNIX_H
+
+#include <sys/types.h>
+#include <QIODevice>
+#include <QStringList>
+#include <QByteArray>
+class QSocketNotifier;
+class QTimer;
+
+
+/*!
+ * \brief A replacement for QProcess on Unix
+ *
+ * QProcess forks the whole parent process and sets up several helper
+ * objects, notifiers and pipes for every child. With hundreds of
+ * concurrent chess engines that becomes a measurable cost. EngineProcess
+ * starts the engine with vfork() and exec, talks to it through two
+ * pipes, and reads the engine's output with a single socket notifier in
+ * the owning thread's event loop. The interface is the same as QProcess'
+ * with some unneeded features left out.
+ *
+ * The engine's standard error output is discarded unless it's
+ * captured with setStandardErrorCapture().
+ *
+ * Writes never block: data that doesn't fit in the pipe is buffered
+ * and written when the engine reads its input, so an engine that stops
+ * reading can't hang the thread that runs it. The application must
+ * ignore SIGPIPE.
+ *
+ * \sa QProcess
+ */
+class LIB_EXPORT EngineProcess : public QIODevice
+{
+	Q_OBJECT
+
+	public:
+		/*! The process' exit status. */
+		enum ExitStatus
+		{
+			NormalExit,	//!< The process exited normally
+			CrashExit	//!< The process crashed
+		};
+
+		/*! Creates a new EngineProcess. */
+		explicit EngineProcess(QObject* parent = 0);
+		/*!
+		 * Destructs the EngineProcess and frees all resources.
+		 * If the process is still running, it is killed.
+		 */
+		virtual ~EngineProcess();
+
+		// Inherited from QIODevice
+		virtual qint64 bytesAvailable() const;
+		virtual qint64 bytesToWrite() const;
+		virtual bool canReadLine() const;
+		virtual void close();
+		virtual bool isSequential() const;
+
+		/*! Returns the exit code of the last process that finished. */
+		int exitCode() const;
+		/*! Returns the exit status of the last process that finished. */
+		ExitStatus exitStatus() const;
+
+		/*!
+		 * Returns the process' working directory.
+		 * Returns an empty string if the working directory wasn't
+		 * set with setWorkingDirectory().
+		 */
+		QString workingDirectory() const;
+		/*!
+		 * Sets the working directory to dir.
+		 * EngineProcess will start the process in this directory.
+		 */
+		void setWorkingDirectory(const QString& dir);
+		/*!
+		 * Restricts the process to the logical CPUs in \a cpus.
+		 * An empty list means no restriction.
+		 *
+		 * \note The affinity is applied when the process is started.
+		 */
+		void setCpuAffinity(const QList<int>& cpus);
+		/*!
+		 * Runs the process in a cgroup v2 group of its own, created
+		 * under the delegated group \a parent, with a CPU quota of
+		 * \a cpuPercent percent of one CPU and a memory limit of
+		 * \a memoryLimit bytes. A limit of 0 means no limit, and an
+		 * empty \a parent (the default) disables the group.
+		 *
+		 * \note The group is created when the process is started
+		 * and removed when it finishes. Only Linux has cgroups.
+		 */
+		void setCgroup(const QString& parent, int cpuPercent, qint64 memoryLimit);
+		/*!
+		 * Reads the resource usage of the running process: the CPU
+		 * time used in milliseconds to \a cpuTime, the resident
+		 * memory in bytes to \a memory, and the number of threads
+		 * to \a threads. Values that can't be read on this platform
+		 * are set to -1.
+		 *
+		 * Returns false if the process isn't running or its usage
+		 * can't be read.
+		 */
+		bool resourceUsage(qint64* cpuTime, qint64* memory, int* threads) const;
+		/*!
+		 * Reads how much the process' cgroup was throttled: the time
+		 * the process' threads were stopped by the CPU quota in
+		 * milliseconds to \a throttledTime, the number of throttled
+		 * scheduling periods to \a throttleCount, and the number of
+		 * times the memory limit was reached to \a memoryEvents.
+		 *
+		 * Returns false if the process doesn't run in a cgroup.
+		 *
+		 * \sa setCgroup()
+		 */
+		bool throttleStats(qint64* throttledTime,
+				   int* throttleCount,
+				   int* memoryEvents) const;
+		/*!
+		 * Keeps the last \a size bytes of the process' standard error
+		 * output in memory, and writes all of it to the file
+		 * \a fileName unless \a fileName is empty. By default the
+		 * output is discarded.
+		 *
+		 * The output is drained in the event loop as soon as it
+		 * arrives, so a process that writes a lot of it never blocks
+		 * on a full pipe. If \a size is 0, the process writes to the
+		 * file directly.
+		 *
+		 * \note The settings are applied when the process is started.
+		 */
+		void setStandardErrorCapture(int size,
+					     const QString& fileName = QString());
+		/*!
+		 * Returns the last bytes of the standard error output, at
+		 * most as many as set with setStandardErrorCapture().
+		 */
+		QByteArray standardErrorTail() const;
+
+		/*!
+		 * Starts the program \a program in a new process, passing the
+		 * command line arguments in \a arguments. The OpenMode is set
+		 * to \a mode.
+		 *
+		 * \note Unlike the same function in QProcess, this one will
+		 * block until the program has been executed.
+		 *
+		 * \note To check if the process started successfully, call
+		 * the waitForStarted() method.
+		 */
+		void start(const QString& program,
+			   const QStringList& arguments,
+			   OpenMode mode = ReadWrite);
+		/*! Starts the program \a program with OpenMode \a mode. */
+		void start(const QString& program,
+			   OpenMode mode = ReadWrite);
+
+		/*!
+		 * Blocks until the process has finished and the finished()
+		 * signal has been emitted.
+		 *
+		 * Times out after \a msecs milliseconds. If \a msecs is -1
+		 * the function will not time out.
+		 *
+		 * \return true if the process finished.
+		 */
+		bool waitForFinished(int msecs = 30000);
+
+		/*!
+		 * Returns true if the process started successfully.
+		 * Doesn't really wait for anything since the start() method
+		 * already did the waiting.
+		 */
+		bool waitForStarted(int msecs = 30000);
+
+	public slots:
+		/*! Kills the process, causing it to exit immediately. */
+		void kill();
+
+	signals:
+		/*!
+		 * Emitted when the process finishes.
+		 * \param exitCode exit code of the process
+		 * \param exitStatus exit status of the process
+		 */
+		void finished(int exitCode, ExitStatus exitStatus);
+
+	protected:
+		// Inherited from QIODevice
+		virtual qint64 readData(char* data, qint64 maxSize);
+		virtual qint64 writeData(const char* data, qint64 maxSize);
+
+	private slots:
+		void onReadyRead();
+		void onErrorReadyRead();
+		void onWriteReady();
+		void onFinished();
+
+	private:
+		bool readPipe();
+		bool readErrorPipe(int maxSize);
+		bool writePipe();
+		bool reap(bool block);
+		void cleanup();
+		QString createCgroup() const;
+		void removeCgroup();
+		static void closeFd(int* fd);
+
+		bool m_started;
+		bool m_finished;
+		int m_exitCode;
+		ExitStatus m_exitStatus;
+		QString m_workDir;
+		QList<int> m_cpus;
+		QString m_cgroupParent;
+		int m_cgroupCpu;
+		qint64 m_cgroupMemory;
+		QString m_cgroup;
+		pid_t m_pid;
+		int m_inWrite;
+		int m_outRead;
+		QByteArray m_buffer;
+		QSocketNotifier* m_notifier;
+		QByteArray m_writeBuffer;
+		QSocketNotifier* m_writeNotifier;
+		int m_errRead;
+		int m_errFile;
+		int m_errCaptureSize;
+		QString m_errFileName;
+		QByteArray m_errBuffer;
+		QSocketNotifier* m_errNotifier;
+		QTimer* m_reapTimer;
+};
+
+#endif // ENGINEPROCESS_UNIX_H
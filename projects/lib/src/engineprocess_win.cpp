@@ -18,8 +18,11 @@
 #include "engineprocess_win.h"
 #include <QDir>
 #include <QRegExp>
+#include <QAtomicInt>
+#include <psapi.h>
 #include "pipereader_win.h"
 
+static QAtomicInt s_pipeCount;
 
 EngineProcess::EngineProcess(QObject* parent)
 	: QIODevice(parent),
@@ -82,13 +85,10 @@ void EngineProcess::cleanup()
 {
 	if (m_reader != 0)
 	{
-		if (m_reader->isRunning())
-		{
-			qWarning("EngineProcess: pipe reader was terminated");
-			m_reader->terminate();
-		}
+		// The reader owns the read end of the output pipe
 		delete m_reader;
 		m_reader = 0;
+		m_outRead = INVALID_HANDLE_VALUE;
 	}
 
 	killHandle(&m_inWrite);
@@ -122,6 +122,41 @@ void EngineProcess::setWorkingDirectory(const QString& dir)
 	m_workDir = dir;
 }
 
+void EngineProcess::setCpuAffinity(const QList<int>& cpus)
+{
+	m_cpus = cpus;
+}
+
+void EngineProcess::setCgroup(const QString& parent,
+			      int cpuPercent,
+			      qint64 memoryLimit)
+{
+	Q_UNUSED(parent);
+	Q_UNUSED(cpuPercent);
+	Q_UNUSED(memoryLimit);
+}
+
+bool EngineProcess::throttleStats(qint64* throttledTime,
+				  int* throttleCount,
+				  int* memoryEvents) const
+{
+	*throttledTime = -1;
+	*throttleCount = -1;
+	*memoryEvents = -1;
+	return false;
+}
+
+void EngineProcess::setStandardErrorCapture(int size, const QString& fileName)
+{
+	Q_UNUSED(size);
+	m_errFileName = fileName;
+}
+
+QByteArray EngineProcess::standardErrorTail() const
+{
+	return QByteArray();
+}
+
 static QString quoteString(QString str)
 {
 	if (!str.contains(' '))
@@ -144,6 +179,40 @@ static QString commandLine(const QString& prog, const QStringList& args)
 	return cmd;
 }
 
+bool EngineProcess::resourceUsage(qint64* cpuTime,
+				  qint64* memory,
+				  int* threads) const
+{
+	*cpuTime = -1;
+	*memory = -1;
+	// Counting the threads needs a snapshot of the whole system,
+	// which is too slow to take for every move
+	*threads = -1;
+	if (!m_started || m_finished)
+		return false;
+
+	HANDLE process = m_processInfo.hProcess;
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if (GetProcessTimes(process, &creationTime, &exitTime,
+			    &kernelTime, &userTime))
+	{
+		ULARGE_INTEGER kernel, user;
+		kernel.LowPart = kernelTime.dwLowDateTime;
+		kernel.HighPart = kernelTime.dwHighDateTime;
+		user.LowPart = userTime.dwLowDateTime;
+		user.HighPart = userTime.dwHighDateTime;
+
+		// FILETIME values are in 100 nanosecond units
+		*cpuTime = qint64((kernel.QuadPart + user.QuadPart) / 10000);
+	}
+
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(process, &counters, sizeof(counters)))
+		*memory = qint64(counters.WorkingSetSize);
+
+	return *cpuTime != -1 || *memory != -1;
+}
+
 void EngineProcess::start(const QString& program,
 			  const QStringList& arguments,
 			  OpenMode mode)
@@ -166,26 +235,57 @@ void EngineProcess::start(const QString& program,
 	saAttr.bInheritHandle = TRUE;
 	saAttr.lpSecurityDescriptor = NULL;
 
-	CreatePipe(&m_outRead, &outWrite, &saAttr, 0);
+	// The output pipe is a named pipe because anonymous pipes don't
+	// support the overlapped reads that PipeReader needs. Only the
+	// child's end of it is inheritable.
+	QString pipeName = QString("\\\\.\\pipe\\cutechess-%1-%2")
+		.arg(GetCurrentProcessId())
+		.arg(s_pipeCount.fetchAndAddRelaxed(1));
+	m_outRead = CreateNamedPipeW((const WCHAR*)pipeName.utf16(),
+				     PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED
+				     | FILE_FLAG_FIRST_PIPE_INSTANCE,
+				     PIPE_TYPE_BYTE | PIPE_WAIT,
+				     1,		// max. instances
+				     0,		// output buffer size
+				     0x8000,	// input buffer size
+				     0,		// default timeout
+				     NULL);	// not inheritable
+	outWrite = CreateFileW((const WCHAR*)pipeName.utf16(),
+			       GENERIC_WRITE,
+			       0,		// no sharing
+			       &saAttr,
+			       OPEN_EXISTING,
+			       FILE_ATTRIBUTE_NORMAL,
+			       NULL);
 	CreatePipe(&inRead, &m_inWrite, &saAttr, 0);
 
+	// The child writes its error log directly, so it can't block
+	// on a pipe that nobody reads
+	HANDLE errWrite = INVALID_HANDLE_VALUE;
+	if (!m_errFileName.isEmpty())
+	{
+		errWrite = CreateFileW((const WCHAR*)m_errFileName.utf16(),
+				       GENERIC_WRITE,
+				       FILE_SHARE_READ,
+				       &saAttr,
+				       CREATE_ALWAYS,
+				       FILE_ATTRIBUTE_NORMAL,
+				       NULL);
+		if (errWrite == INVALID_HANDLE_VALUE)
+			qWarning("Cannot open engine error log %s",
+				 qPrintable(m_errFileName));
+	}
+
 	STARTUPINFO startupInfo;
 	ZeroMemory(&startupInfo, sizeof(startupInfo));
 	startupInfo.cb = sizeof(startupInfo);
-	startupInfo.hStdError = outWrite;
+	startupInfo.hStdError = (errWrite != INVALID_HANDLE_VALUE) ? errWrite : outWrite;
 	startupInfo.hStdOutput = outWrite;
 	startupInfo.hStdInput = inRead;
 	startupInfo.dwFlags |= STARTF_USESTDHANDLES;
 
 	// Call DuplicateHandle with a NULL target to get non-inheritable
 	// handles for the parent process' ends of the pipes
-	DuplicateHandle(GetCurrentProcess(),
-			m_outRead,		// child's stdout read end
-			GetCurrentProcess(),
-			NULL,			// no target
-			0,			// flags
-			FALSE,			// not inheritable
-			DUPLICATE_SAME_ACCESS);	// same handle access
 	DuplicateHandle(GetCurrentProcess(),
 			m_inWrite,		// child's stdin write end
 			GetCurrentProcess(),
@@ -224,6 +324,7 @@ void EngineProcess::start(const QString& program,
 #endif // not UNICODE
 
 	m_started = (bool)ok;
+	killHandle(&errWrite);
 	if (ok)
 	{
 		// Close the child process' ends of the pipes to make sure
@@ -232,6 +333,16 @@ void EngineProcess::start(const QString& program,
 		killHandle(&outWrite);
 		killHandle(&inRead);
 
+		// Only the first processor group is supported
+		DWORD_PTR affinity = 0;
+		foreach (int cpu, m_cpus)
+		{
+			if (cpu >= 0 && cpu < int(sizeof(DWORD_PTR) * 8))
+				affinity |= DWORD_PTR(1) << cpu;
+		}
+		if (affinity != 0)
+			SetProcessAffinityMask(m_processInfo.hProcess, affinity);
+
 		// Start reading input from the child
 		m_reader = new PipeReader(m_outRead, this);
 		connect(m_reader, SIGNAL(finished()), this, SLOT(onFinished()));
@@ -21,6 +21,7 @@
 #include <windows.h>
 #include <QIODevice>
 #include <QString>
+#include <QList>
 class PipeReader;
 
 
@@ -32,7 +33,8 @@ class PipeReader;
  * new data immediately (no polling) when it's available. The interface is
  * the same as QProcess' with some unneeded features left out.
  *
- * On non-Windows platforms EngineProcess is just a typedef to QProcess.
+ * On Unix EngineProcess is implemented in engineprocess_unix.h, and on
+ * other platforms it's just a typedef to QProcess.
  *
  * \sa QProcess
  * \sa PipeReader
@@ -79,6 +81,65 @@ class LIB_EXPORT EngineProcess : public QIODevice
 		 * EngineProcess will start the process in this directory.
 		 */
 		void setWorkingDirectory(const QString& dir);
+		/*!
+		 * Restricts the process to the logical CPUs in \a cpus.
+		 * An empty list means no restriction.
+		 *
+		 * \note The affinity is applied when the process is started.
+		 */
+		void setCpuAffinity(const QList<int>& cpus);
+		/*!
+		 * Runs the process in a cgroup v2 group of its own, created
+		 * under the delegated group \a parent, with a CPU quota of
+		 * \a cpuPercent percent of one CPU and a memory limit of
+		 * \a memoryLimit bytes. A limit of 0 means no limit, and an
+		 * empty \a parent (the default) disables the group.
+		 *
+		 * \note The group is created when the process is started
+		 * and removed when it finishes. Only Linux has cgroups.
+		 */
+		void setCgroup(const QString& parent, int cpuPercent, qint64 memoryLimit);
+		/*!
+		 * Reads the resource usage of the running process: the CPU
+		 * time used in milliseconds to \a cpuTime, the resident
+		 * memory in bytes to \a memory, and the number of threads
+		 * to \a threads. Values that can't be read on this platform
+		 * are set to -1.
+		 *
+		 * Returns false if the process isn't running or its usage
+		 * can't be read.
+		 */
+		bool resourceUsage(qint64* cpuTime, qint64* memory, int* threads) const;
+		/*!
+		 * Reads how much the process' cgroup was throttled: the time
+		 * the process' threads were stopped by the CPU quota in
+		 * milliseconds to \a throttledTime, the number of throttled
+		 * scheduling periods to \a throttleCount, and the number of
+		 * times the memory limit was reached to \a memoryEvents.
+		 *
+		 * Returns false if the process doesn't run in a cgroup.
+		 *
+		 * \sa setCgroup()
+		 */
+		bool throttleStats(qint64* throttledTime,
+				   int* throttleCount,
+				   int* memoryEvents) const;
+		/*!
+		 * Writes the process' standard error output to the file
+		 * \a fileName unless \a fileName is empty. By default the
+		 * standard error output is merged with the standard output.
+		 *
+		 * \note Unlike on Unix, the output isn't kept in memory, so
+		 * \a size is ignored.
+		 * \note The settings are applied when the process is started.
+		 */
+		void setStandardErrorCapture(int size,
+					     const QString& fileName = QString());
+		/*!
+		 * Returns the last bytes of the standard error output.
+		 * Always returns an empty array on Windows.
+		 */
+		QByteArray standardErrorTail() const;
 
 		/*!
 		 * Starts the program \a program in a new process, passing the
@@ -145,6 +206,8 @@ class LIB_EXPORT EngineProcess : public QIODevice
 		DWORD m_exitCode;
 		ExitStatus m_exitStatus;
 		QString m_workDir;
+		QList<int> m_cpus;
+		QString m_errFileName;
 		PROCESS_INFORMATION m_processInfo;
 		HANDLE m_inWrite;
 		HANDLE m_outRead;
@@ -0,0 +1,134 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "enginerecorder.h"
+
+EngineRecorder::EngineRecorder(QIODevice* device,
+			       QIODevice* log,
+			       QObject* parent)
+	: QIODevice(parent),
+	  m_device(device),
+	  m_log(log)
+{
+	Q_ASSERT(device != 0 && device->isOpen());
+	Q_ASSERT(log != 0 && log->isWritable());
+
+	m_device->setParent(this);
+	m_log->setParent(this);
+	m_clock.start();
+
+	connect(m_device, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+	connect(m_device, SIGNAL(readChannelFinished()),
+		this, SLOT(onReadChannelFinished()));
+
+	QIODevice::open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+}
+
+EngineRecorder::~EngineRecorder()
+{
+	close();
+}
+
+void EngineRecorder::close()
+{
+	if (!isOpen())
+		return;
+
+	QIODevice::close();
+	m_device->close();
+	m_log->close();
+}
+
+bool EngineRecorder::isSequential() const
+{
+	return true;
+}
+
+qint64 EngineRecorder::bytesAvailable() const
+{
+	return m_buffer.size() + QIODevice::bytesAvailable();
+}
+
+bool EngineRecorder::canReadLine() const
+{
+	return m_buffer.contains('\n') || QIODevice::canReadLine();
+}
+
+qint64 EngineRecorder::readData(char* data, qint64 maxSize)
+{
+	int n = int(qMin(maxSize, qint64(m_buffer.size())));
+	memcpy(data, m_buffer.constData(), n);
+	m_buffer.remove(0, n);
+	return n;
+}
+
+qint64 EngineRecorder::writeData(const char* data, qint64 maxSize)
+{
+	qint64 n = m_device->write(data, maxSize);
+	if (n > 0)
+		logLines('>', m_pendingIn, data, n);
+	return n;
+}
+
+void EngineRecorder::onReadyRead()
+{
+	QByteArray data(m_device->readAll());
+	if (data.isEmpty())
+		return;
+
+	logLines('<', m_pendingOut, data.constData(), data.size());
+	m_buffer += data;
+	emit readyRead();
+}
+
+void EngineRecorder::onReadChannelFinished()
+{
+	m_log->write(QByteArray::number(m_clock.elapsed()) + " x\n");
+	emit readChannelFinished();
+}
+
+void EngineRecorder::logLines(char direction,
+			      QByteArray& pending,
+			      const char* data,
+			      qint64 size)
+{
+	pending.append(data, int(size));
+
+	int start = 0;
+	int end;
+	while ((end = pending.indexOf('\n', start)) != -1)
+	{
+		int length = end - start;
+		if (length > 0 && pending.at(end - 1) == '\r')
+			length--;
+		logLine(direction, pending.mid(start, length));
+		start = end + 1;
+	}
+	pending.remove(0, start);
+}
+
+void EngineRecorder::logLine(char direction, const QByteArray& line)
+{
+	QByteArray entry(QByteArray::number(m_clock.elapsed()));
+	entry += ' ';
+	entry += direction;
+	entry += ' ';
+	entry += line;
+	entry += '\n';
+
+	m_log->write(entry);
+}
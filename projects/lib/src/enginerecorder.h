@@ -0,0 +1,91 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ENGINERECORDER_H
+#define ENGINERECORDER_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QElapsedTimer>
+
+/*!
+ * \brief A QIODevice that logs the lines exchanged with an engine.
+ *
+ * EngineRecorder is placed between a ChessEngine and the engine's
+ * device (eg. an EngineProcess). It passes the data through unchanged
+ * and writes every complete line to a log device with a timestamp, so
+ * that EngineReplayer can later play the engine's part back with the
+ * same timings.
+ *
+ * Each log line is made of the time in milliseconds since the recorder
+ * was created, a direction and the engine line:
+ * \code
+ * 12 > uci
+ * 15 < id name Stockfish
+ * \endcode
+ * '>' marks a line sent to the engine and '<' a line received from
+ * it. A line with just the time and 'x' marks the end of the engine's
+ * output.
+ *
+ * The recorder takes ownership of both devices.
+ */
+class LIB_EXPORT EngineRecorder : public QIODevice
+{
+	Q_OBJECT
+
+	public:
+		/*!
+		 * Creates a new recorder that passes data to and from
+		 * \a device and writes the log to \a log.
+		 *
+		 * Both devices must be open.
+		 */
+		EngineRecorder(QIODevice* device,
+			       QIODevice* log,
+			       QObject* parent = 0);
+		/*! Closes the devices and destroys the recorder. */
+		virtual ~EngineRecorder();
+
+		// Inherited from QIODevice
+		virtual void close();
+		virtual bool isSequential() const;
+		virtual qint64 bytesAvailable() const;
+		virtual bool canReadLine() const;
+
+	protected:
+		// Inherited from QIODevice
+		virtual qint64 readData(char* data, qint64 maxSize);
+		virtual qint64 writeData(const char* data, qint64 maxSize);
+
+	private slots:
+		void onReadyRead();
+		void onReadChannelFinished();
+
+	private:
+		void logLines(char direction, QByteArray& pending,
+			      const char* data, qint64 size);
+		void logLine(char direction, const QByteArray& line);
+
+		QIODevice* m_device;
+		QIODevice* m_log;
+		QElapsedTimer m_clock;
+		QByteArray m_buffer;
+		QByteArray m_pendingIn;
+		QByteArray m_pendingOut;
+};
+
+#endif // ENGINERECORDER_H
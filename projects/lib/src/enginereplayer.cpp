@@ -0,0 +1,190 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "enginereplayer.h"
+#include <QTimer>
+
+EngineReplayer::EngineReplayer(QIODevice* log, QObject* parent)
+	: QIODevice(parent),
+	  m_next(0),
+	  m_inputTime(0),
+	  m_timer(new QTimer(this)),
+	  m_hasOutput(false),
+	  m_finished(false),
+	  m_diverged(false)
+{
+	Q_ASSERT(log != 0 && log->isReadable());
+
+	while (!log->atEnd())
+	{
+		QByteArray line(log->readLine());
+		if (line.endsWith('\n'))
+			line.chop(1);
+
+		// "<time> <direction>[ <engine line>]"
+		int sep = line.indexOf(' ');
+		if (sep <= 0 || sep + 1 >= line.size())
+			continue;
+
+		Event event;
+		bool ok = false;
+		event.time = line.left(sep).toLongLong(&ok);
+		event.direction = line.at(sep + 1);
+		event.line = line.mid(sep + 3);
+		if (ok)
+			m_events.append(event);
+	}
+
+	m_timer->setSingleShot(true);
+	connect(m_timer, SIGNAL(timeout()), this, SLOT(onTimeout()));
+
+	QIODevice::open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+	m_clock.start();
+	scheduleOutput();
+}
+
+bool EngineReplayer::isSequential() const
+{
+	return true;
+}
+
+qint64 EngineReplayer::bytesAvailable() const
+{
+	return m_buffer.size() + QIODevice::bytesAvailable();
+}
+
+bool EngineReplayer::canReadLine() const
+{
+	return m_buffer.contains('\n') || QIODevice::canReadLine();
+}
+
+qint64 EngineReplayer::readData(char* data, qint64 maxSize)
+{
+	int n = int(qMin(maxSize, qint64(m_buffer.size())));
+	memcpy(data, m_buffer.constData(), n);
+	m_buffer.remove(0, n);
+	return n;
+}
+
+qint64 EngineReplayer::writeData(const char* data, qint64 maxSize)
+{
+	m_pendingIn.append(data, int(maxSize));
+
+	int start = 0;
+	int end;
+	while ((end = m_pendingIn.indexOf('\n', start)) != -1)
+	{
+		int length = end - start;
+		if (length > 0 && m_pendingIn.at(end - 1) == '\r')
+			length--;
+		consumeInput(m_pendingIn.mid(start, length));
+		start = end + 1;
+	}
+	m_pendingIn.remove(0, start);
+
+	// The output is delivered from the event loop, like the
+	// output of a real engine
+	scheduleOutput();
+	return maxSize;
+}
+
+void EngineReplayer::consumeInput(const QByteArray& line)
+{
+	// Output recorded before this input is overdue, so it's
+	// released without waiting
+	if (releaseOutput(false))
+		m_hasOutput = true;
+
+	if (m_next >= m_events.size())
+	{
+		if (!m_diverged)
+			qWarning("Engine replay ended before input: %s",
+				 line.constData());
+		m_diverged = true;
+		return;
+	}
+
+	const Event& event = m_events.at(m_next++);
+	if (event.line != line && !m_diverged)
+	{
+		qWarning("Engine replay diverged: expected \"%s\", got \"%s\"",
+			 event.line.constData(), line.constData());
+		m_diverged = true;
+	}
+
+	m_inputTime = event.time;
+	m_clock.restart();
+}
+
+bool EngineReplayer::releaseOutput(bool waitForTime)
+{
+	bool released = false;
+	while (m_next < m_events.size())
+	{
+		const Event& event = m_events.at(m_next);
+		if (event.direction == '>')
+			break;
+		if (waitForTime && event.time - m_inputTime > m_clock.elapsed())
+			break;
+
+		if (event.direction == '<')
+		{
+			m_buffer += event.line;
+			m_buffer += '\n';
+			released = true;
+		}
+		else
+			m_finished = true;
+		m_next++;
+	}
+
+	return released;
+}
+
+void EngineReplayer::scheduleOutput()
+{
+	if (m_hasOutput || m_finished)
+	{
+		m_timer->start(0);
+		return;
+	}
+	if (m_next >= m_events.size() || m_events.at(m_next).direction == '>')
+	{
+		m_timer->stop();
+		return;
+	}
+
+	qint64 delay = m_events.at(m_next).time - m_inputTime - m_clock.elapsed();
+	m_timer->start(int(qMax(delay, qint64(0))));
+}
+
+void EngineReplayer::onTimeout()
+{
+	bool hasOutput = releaseOutput(true) || m_hasOutput;
+	m_hasOutput = false;
+
+	if (hasOutput)
+		emit readyRead();
+	if (m_finished)
+	{
+		m_finished = false;
+		emit readChannelFinished();
+		return;
+	}
+
+	scheduleOutput();
+}
@@ -0,0 +1,91 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ENGINEREPLAYER_H
+#define ENGINEREPLAYER_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QVector>
+#include <QElapsedTimer>
+class QTimer;
+
+/*!
+ * \brief A QIODevice that plays back a recorded engine.
+ *
+ * EngineReplayer reads a log written by EngineRecorder and acts like
+ * the recorded engine: each line received from the engine is made
+ * available after the same delay it had in the recording, measured
+ * from the line that was last sent to the engine before it. No engine
+ * runs, so a tournament can be rerun with the same workload to
+ * measure the overhead of Cute Chess itself.
+ *
+ * The lines written to the device are expected to match the recorded
+ * input. If they don't, the replay goes on but a warning is printed,
+ * because the rest of the replay may not be meaningful.
+ */
+class LIB_EXPORT EngineReplayer : public QIODevice
+{
+	Q_OBJECT
+
+	public:
+		/*!
+		 * Creates a new replayer for the log in \a log.
+		 *
+		 * The whole log is read at construction, and the
+		 * replayer doesn't take ownership of \a log.
+		 */
+		explicit EngineReplayer(QIODevice* log, QObject* parent = 0);
+
+		// Inherited from QIODevice
+		virtual bool isSequential() const;
+		virtual qint64 bytesAvailable() const;
+		virtual bool canReadLine() const;
+
+	protected:
+		// Inherited from QIODevice
+		virtual qint64 readData(char* data, qint64 maxSize);
+		virtual qint64 writeData(const char* data, qint64 maxSize);
+
+	private slots:
+		void onTimeout();
+
+	private:
+		struct Event
+		{
+			qint64 time;
+			char direction;
+			QByteArray line;
+		};
+
+		void consumeInput(const QByteArray& line);
+		bool releaseOutput(bool waitForTime);
+		void scheduleOutput();
+
+		QVector<Event> m_events;
+		int m_next;
+		qint64 m_inputTime;
+		QElapsedTimer m_clock;
+		QTimer* m_timer;
+		QByteArray m_buffer;
+		QByteArray m_pendingIn;
+		bool m_hasOutput;
+		bool m_finished;
+		bool m_diverged;
+};
+
+#endif // ENGINEREPLAYER_H
@@ -0,0 +1,275 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "engineserver.h"
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QDir>
+#include <QFileInfo>
+#include <QUrl>
+#include "engineprocess.h"
+
+static const char s_requestTag[] = "cutechess-engine";
+
+// The maximum length of a request line. Longer requests are rejected
+// without buffering them.
+static const int s_maxRequestSize = 4096;
+
+// Compares \a a and \a b in a time that depends only on their lengths
+static bool isSameSecret(const QByteArray& a, const QByteArray& b)
+{
+	if (a.size() != b.size())
+		return false;
+
+	char diff = 0;
+	for (int i = 0; i < a.size(); i++)
+		diff |= a.at(i) ^ b.at(i);
+	return diff == 0;
+}
+
+EngineServer::EngineServer(QObject* parent)
+	: QObject(parent),
+	  m_server(new QTcpServer(this))
+{
+	connect(m_server, SIGNAL(newConnection()),
+		this, SLOT(onNewConnection()));
+}
+
+void EngineServer::setEngines(const QList<EngineConfiguration>& engines)
+{
+	m_configs.clear();
+	foreach (const EngineConfiguration& config, engines)
+		m_configs[config.name()] = config;
+}
+
+void EngineServer::setSecret(const QString& secret)
+{
+	m_secret = secret.toUtf8();
+}
+
+bool EngineServer::listen(quint16 port, const QHostAddress& address)
+{
+	if (m_secret.isEmpty())
+	{
+		qWarning("Cannot listen on port %d: no secret", port);
+		return false;
+	}
+	if (!m_server->listen(address, port))
+	{
+		qWarning("Cannot listen on port %d: %s", port,
+			 qPrintable(m_server->errorString()));
+		return false;
+	}
+	return true;
+}
+
+QByteArray EngineServer::request(const QString& secret,
+				 const QString& engineName)
+{
+	// Every field is percent-encoded so that the request stays
+	// on one line and splits cleanly at the spaces
+	QByteArray line(s_requestTag);
+	line += ' ' + QUrl::toPercentEncoding(secret);
+	line += ' ' + QUrl::toPercentEncoding(engineName);
+
+	return line + '\n';
+}
+
+void EngineServer::onNewConnection()
+{
+	while (m_server->hasPendingConnections())
+	{
+		QTcpSocket* socket = m_server->nextPendingConnection();
+		socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+		connect(socket, SIGNAL(readyRead()),
+			this, SLOT(onRequestReady()));
+		connect(socket, SIGNAL(disconnected()),
+			this, SLOT(onSocketClosed()));
+	}
+}
+
+void EngineServer::onRequestReady()
+{
+	QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+	Q_ASSERT(socket != 0);
+
+	if (!socket->canReadLine())
+	{
+		if (socket->bytesAvailable() > s_maxRequestSize)
+		{
+			qWarning("Too long engine request from %s",
+				 qPrintable(socket->peerAddress().toString()));
+			closeConnection(socket);
+		}
+		return;
+	}
+
+	disconnect(socket, SIGNAL(readyRead()),
+		   this, SLOT(onRequestReady()));
+
+	QString error;
+	QIODevice* engine = startEngine(socket->readLine().trimmed(), &error);
+	if (engine == 0)
+	{
+		qWarning("%s", qPrintable(error));
+		socket->write("error " + error.toUtf8() + '\n');
+		socket->disconnectFromHost();
+		return;
+	}
+
+	m_engines[socket] = engine;
+	m_sockets[engine] = socket;
+	connect(engine, SIGNAL(readyRead()),
+		this, SLOT(onEngineReadyRead()));
+	connect(engine, SIGNAL(readChannelFinished()),
+		this, SLOT(onEngineClosed()));
+	connect(socket, SIGNAL(readyRead()),
+		this, SLOT(onSocketReadyRead()));
+
+	socket->write("ok\n");
+
+	// Relay anything the client sent right after the request
+	if (socket->bytesAvailable() > 0)
+		engine->write(socket->readAll());
+}
+
+QIODevice* EngineServer::startEngine(const QByteArray& request,
+				     QString* error) const
+{
+	QList<QByteArray> fields = request.split(' ');
+	if (fields.size() != 3 || fields.takeFirst() != s_requestTag)
+	{
+		*error = "Invalid engine request";
+		return 0;
+	}
+
+	// The secret is checked before anything else in the request
+	// is looked at
+	if (!isSameSecret(QUrl::fromPercentEncoding(fields.takeFirst()).toUtf8(),
+			  m_secret))
+	{
+		*error = "Invalid secret";
+		return 0;
+	}
+
+	const QString name(QUrl::fromPercentEncoding(fields.takeFirst()));
+	if (!m_configs.contains(name))
+	{
+		*error = "Unknown engine: " + name;
+		return 0;
+	}
+
+	const EngineConfiguration config(m_configs.value(name));
+	QString cmd(config.command().trimmed());
+	QString workDir(config.workingDirectory());
+	QDir dir;
+
+	// The working directory is given to the process instead of
+	// changing the server's own directory, which would affect
+	// every other engine being started at the same time
+	if (workDir.isEmpty())
+		workDir = QDir::tempPath();
+	else
+	{
+		dir.setPath(workDir);
+		if (!dir.exists())
+		{
+			*error = "Invalid working directory: " + workDir;
+			return 0;
+		}
+		workDir = dir.absolutePath();
+	}
+
+	QFileInfo cmdInfo(dir, cmd);
+	if (cmdInfo.isFile())
+		cmd = cmdInfo.absoluteFilePath();
+
+	EngineProcess* process = new EngineProcess();
+	process->setWorkingDirectory(workDir);
+	if (!config.arguments().isEmpty())
+		process->start(cmd, config.arguments());
+	else
+		process->start(cmd);
+	if (!process->waitForStarted())
+	{
+		*error = "Cannot execute command: " + cmd;
+		delete process;
+		return 0;
+	}
+
+	return process;
+}
+
+void EngineServer::onSocketReadyRead()
+{
+	QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+	Q_ASSERT(socket != 0);
+
+	QIODevice* engine = m_engines.value(socket);
+	if (engine != 0)
+		engine->write(socket->readAll());
+}
+
+void EngineServer::onEngineReadyRead()
+{
+	QIODevice* engine = qobject_cast<QIODevice*>(sender());
+	Q_ASSERT(engine != 0);
+
+	QTcpSocket* socket = m_sockets.value(engine);
+	if (socket != 0)
+		socket->write(engine->readAll());
+}
+
+void EngineServer::onSocketClosed()
+{
+	QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+	Q_ASSERT(socket != 0);
+
+	closeConnection(socket);
+}
+
+void EngineServer::onEngineClosed()
+{
+	QIODevice* engine = qobject_cast<QIODevice*>(sender());
+	Q_ASSERT(engine != 0);
+
+	QTcpSocket* socket = m_sockets.value(engine);
+	if (socket == 0)
+		return;
+
+	// Flush the engine's last words before hanging up
+	if (engine->bytesAvailable() > 0)
+		socket->write(engine->readAll());
+	closeConnection(socket);
+}
+
+void EngineServer::closeConnection(QTcpSocket* socket)
+{
+	QIODevice* engine = m_engines.take(socket);
+	if (engine != 0)
+	{
+		m_sockets.remove(engine);
+		engine->disconnect(this);
+		engine->close();
+		engine->deleteLater();
+	}
+
+	socket->disconnect(this);
+	socket->disconnectFromHost();
+	socket->deleteLater();
+}
@@ -0,0 +1,105 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ENGINESERVER_H
+#define ENGINESERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QHostAddress>
+#include "engineconfiguration.h"
+class QTcpServer;
+class QTcpSocket;
+class QIODevice;
+
+/*!
+ * \brief A server that runs chess engines for remote cutechess instances.
+ *
+ * EngineServer is the worker side of a distributed tournament. Each
+ * incoming connection starts with a single request line with the
+ * shared secret and the name of the engine. The server starts that
+ * engine locally and relays the connection to the engine's standard
+ * input and output until either side closes.
+ *
+ * Only the engines given to setEngines() can be started, with the
+ * command, arguments and working directory of their configuration on
+ * this node. A client never sends a command of its own, and requests
+ * without the right secret are rejected.
+ *
+ * The coordinating instance keeps running the tournament itself, so
+ * pairings, openings, adjudication and result tracking work exactly as
+ * with local engines.
+ *
+ * \sa EngineBuilder::setRemoteHosts()
+ */
+class LIB_EXPORT EngineServer : public QObject
+{
+	Q_OBJECT
+
+	public:
+		/*! Creates a new EngineServer. */
+		explicit EngineServer(QObject* parent = 0);
+
+		/*!
+		 * Sets the engines that clients can start to \a engines.
+		 * The engines are identified by their names.
+		 */
+		void setEngines(const QList<EngineConfiguration>& engines);
+		/*!
+		 * Sets the secret that clients must send with their
+		 * requests to \a secret.
+		 */
+		void setSecret(const QString& secret);
+
+		/*!
+		 * Starts listening for connections on \a port of \a address.
+		 * Returns true if successful.
+		 *
+		 * By default only local connections are accepted. The
+		 * secret must be set before calling this function.
+		 */
+		bool listen(quint16 port,
+			    const QHostAddress& address = QHostAddress::LocalHost);
+
+		/*!
+		 * Returns a request line for starting the engine named
+		 * \a engineName with the shared secret \a secret.
+		 */
+		static QByteArray request(const QString& secret,
+					  const QString& engineName);
+
+	private slots:
+		void onNewConnection();
+		void onRequestReady();
+		void onSocketReadyRead();
+		void onSocketClosed();
+		void onEngineReadyRead();
+		void onEngineClosed();
+
+	private:
+		QIODevice* startEngine(const QByteArray& request,
+				       QString* error) const;
+		void closeConnection(QTcpSocket* socket);
+
+		QTcpServer* m_server;
+		QByteArray m_secret;
+		QHash<QString, EngineConfiguration> m_configs;
+		QHash<QTcpSocket*, QIODevice*> m_engines;
+		QHash<QIODevice*, QTcpSocket*> m_sockets;
+};
+
+#endif // ENGINESERVER_H
@@ -0,0 +1,83 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "fileprefetcher.h"
+#include <QStringList>
+#include <QFile>
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QThreadPool>
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+namespace {
+
+// The size of the chunks when the files are read through
+static const qint64 s_chunkSize = 1024 * 1024;
+
+class PrefetchTask : public QRunnable
+{
+	public:
+		PrefetchTask(const QString& fileName, QAtomicInt* kilobytes)
+			: m_fileName(fileName),
+			  m_kilobytes(kilobytes)
+		{
+		}
+
+		virtual void run()
+		{
+			QFile file(m_fileName);
+			if (!file.open(QIODevice::ReadOnly))
+				return;
+			qint64 size = file.size();
+			m_kilobytes->fetchAndAddOrdered(int((size + 1023) / 1024));
+
+#ifdef Q_OS_LINUX
+			// The advice starts the reads and returns at once,
+			// so the page cache fills up while the engines start
+			if (posix_fadvise(file.handle(), 0, 0,
+					  POSIX_FADV_WILLNEED) == 0)
+				return;
+#endif
+
+			QByteArray buffer(int(s_chunkSize), '\0');
+			while (file.read(buffer.data(), s_chunkSize) > 0)
+				;
+		}
+
+	private:
+		QString m_fileName;
+		QAtomicInt* m_kilobytes;
+};
+
+} // anonymous namespace
+
+qint64 FilePrefetcher::prefetch(const QStringList& files)
+{
+	// Counted in kilobytes to fit multi-gigabyte files into an int
+	QAtomicInt kilobytes(0);
+	QThreadPool pool;
+	pool.setMaxThreadCount(qBound(1, files.size(), 8));
+
+	foreach (const QString& file, files)
+		pool.start(new PrefetchTask(file, &kilobytes));
+	pool.waitForDone();
+
+	return qint64(kilobytes.fetchAndAddOrdered(0)) * 1024;
+}
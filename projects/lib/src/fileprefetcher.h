@@ -0,0 +1,55 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef FILEPREFETCHER_H
+#define FILEPREFETCHER_H
+
+#include <QtGlobal>
+class QStringList;
+
+/*!
+ * \brief Reads files into the operating system's page cache.
+ *
+ * Engines that load large data files (eg. neural networks) at startup
+ * all hit a cold disk at once when a tournament starts. FilePrefetcher
+ * warms the page cache up front so that the engines' first reads are
+ * served from memory.
+ *
+ * On Linux the kernel is asked to read the files ahead with
+ * posix_fadvise(). On other systems, or if the advice fails, the files
+ * are read through in chunks.
+ */
+class LIB_EXPORT FilePrefetcher
+{
+	public:
+		/*!
+		 * Reads \a files into the page cache in parallel.
+		 *
+		 * Returns when the files have been read, or on Linux when
+		 * the kernel has been asked to read them ahead.
+		 *
+		 * Returns the total size of the files in bytes. Files that
+		 * can't be opened are skipped.
+		 */
+		static qint64 prefetch(const QStringList& files);
+
+	private:
+		FilePrefetcher();
+};
+
+#endif // FILEPREFETCHER_H
@@ -26,10 +26,20 @@ GameAdjudicator::GameAdjudicator()
 	  m_drawScoreCount(0),
 	  m_resignMoveCount(0),
 	  m_resignScore(0),
+	  m_winMoveCount(0),
+	  m_winScore(0),
+	  m_winHysteresis(0),
+	  m_mateEnabled(false),
+	  m_maxLength(0),
 	  m_tbEnabled(false)
 {
-	m_resignScoreCount[0] = 0;
-	m_resignScoreCount[1] = 0;
+	for (int i = 0; i < 2; i++)
+	{
+		m_resignScoreCount[i] = 0;
+		m_winScoreCount[i] = 0;
+		m_lossScoreCount[i] = 0;
+		m_mateScore[i] = 0;
+	}
 }
 
 void GameAdjudicator::setDrawThreshold(int moveNumber, int moveCount, int score)
@@ -53,6 +63,34 @@ void GameAdjudicator::setResignThreshold(int moveCount, int score)
 	m_resignScoreCount[1] = 0;
 }
 
+void GameAdjudicator::setWinThreshold(int moveCount, int score, int hysteresis)
+{
+	Q_ASSERT(moveCount >= 0);
+	Q_ASSERT(hysteresis >= 0);
+
+	m_winMoveCount = moveCount;
+	m_winScore = score;
+	m_winHysteresis = hysteresis;
+	for (int i = 0; i < 2; i++)
+	{
+		m_winScoreCount[i] = 0;
+		m_lossScoreCount[i] = 0;
+	}
+}
+
+void GameAdjudicator::setMateAdjudication(bool enable)
+{
+	m_mateEnabled = enable;
+	m_mateScore[0] = 0;
+	m_mateScore[1] = 0;
+}
+
+void GameAdjudicator::setMaximumLength(int moveCount)
+{
+	Q_ASSERT(moveCount >= 0);
+	m_maxLength = moveCount;
+}
+
 void GameAdjudicator::setTablebaseAdjudication(bool enable)
 {
 	m_tbEnabled = enable;
@@ -70,14 +108,73 @@ void GameAdjudicator::addEval(const Chess::Board* board, const MoveEvaluation& e
 			return;
 	}
 
+	// Maximum game length
+	if (m_maxLength > 0 && board->plyCount() / 2 >= m_maxLength)
+	{
+		m_result = Chess::Result(Chess::Result::Adjudication,
+					 Chess::Side::NoSide,
+					 "maximum game length");
+		return;
+	}
+
 	// Moves forced by the user (eg. from opening book or played by user)
 	if (eval.depth() <= 0)
 	{
 		m_drawScoreCount = 0;
 		m_resignScoreCount[side] = 0;
+		m_winScoreCount[side] = 0;
+		m_lossScoreCount[side] = 0;
+		m_mateScore[side] = 0;
 		return;
 	}
 
+	// Mate score adjudication: the players' latest scores must be
+	// mate scores for the same winner
+	if (m_mateEnabled)
+	{
+		m_mateScore[side] = eval.isMateScore() ? eval.score() : 0;
+		int other = m_mateScore[side.opposite()];
+		if (m_mateScore[side] != 0 && other != 0
+		&&  (m_mateScore[side] > 0) != (other > 0))
+		{
+			Chess::Side winner = (m_mateScore[side] > 0) ? side : side.opposite();
+			m_result = Chess::Result(Chess::Result::Adjudication,
+						 winner,
+						 "mate score");
+			return;
+		}
+	}
+
+	// Win adjudication
+	if (m_winMoveCount > 0)
+	{
+		int& winCount = m_winScoreCount[side];
+		if (eval.score() >= m_winScore)
+			winCount++;
+		else if (winCount == 0
+		     ||  eval.score() < m_winScore - m_winHysteresis)
+			winCount = 0;
+
+		int& lossCount = m_lossScoreCount[side];
+		if (eval.score() <= -m_winScore)
+			lossCount++;
+		else if (lossCount == 0
+		     ||  eval.score() > -m_winScore + m_winHysteresis)
+			lossCount = 0;
+
+		for (int i = 0; i < 2; i++)
+		{
+			Chess::Side winner = Chess::Side::Type(i);
+			if (m_winScoreCount[winner] >= m_winMoveCount
+			&&  m_lossScoreCount[winner.opposite()] >= m_winMoveCount)
+			{
+				m_result = Chess::Result(Chess::Result::Adjudication,
+							 winner);
+				return;
+			}
+		}
+	}
+
 	// Draw adjudication
 	if (m_drawMoveNum > 0)
 	{
@@ -56,6 +56,36 @@ class LIB_EXPORT GameAdjudicator
 		 * consecutive moves.
 		 */
 		void setResignThreshold(int moveCount, int score);
+		/*!
+		 * Sets the win adjudication threshold for each game.
+		 *
+		 * A game will be adjudicated as a win if both players agree
+		 * on the winner for at least \a moveCount consecutive moves:
+		 * the winning player reports a score of at least \a score
+		 * centipawns, and the losing player a score of at least
+		 * \a score centipawns below zero.
+		 *
+		 * Once a player's streak has started, a score that falls
+		 * short of the threshold by at most \a hysteresis centipawns
+		 * doesn't end the streak, but it isn't counted either. This
+		 * keeps small fluctuations from restarting the count.
+		 */
+		void setWinThreshold(int moveCount, int score, int hysteresis = 0);
+		/*!
+		 * Sets mate score adjudication to \a enable.
+		 *
+		 * If \a enable is true then a game is adjudicated as a win
+		 * when both players report a mate score for the same side
+		 * on consecutive moves.
+		 */
+		void setMateAdjudication(bool enable);
+		/*!
+		 * Sets the maximum game length to \a moveCount full moves.
+		 *
+		 * A game that reaches \a moveCount moves without a result is
+		 * adjudicated as a draw. A value of 0 disables this rule.
+		 */
+		void setMaximumLength(int moveCount);
 		/*!
 		 * Sets tablebase adjudication to \a enable.
 		 *
@@ -90,6 +120,14 @@ class LIB_EXPORT GameAdjudicator
 		int m_resignMoveCount;
 		int m_resignScore;
 		int m_resignScoreCount[2];
+		int m_winMoveCount;
+		int m_winScore;
+		int m_winHysteresis;
+		int m_winScoreCount[2];
+		int m_lossScoreCount[2];
+		bool m_mateEnabled;
+		int m_mateScore[2];
+		int m_maxLength;
 		bool m_tbEnabled;
 		Chess::Result m_result;
 };
@@ -0,0 +1,399 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "gameannotator.h"
+#include <climits>
+#include <QVariant>
+#include "board/board.h"
+#include "board/boardfactory.h"
+#include "chessgame.h"
+#include "pgngame.h"
+#include "gamemanager.h"
+#include "enginebuilder.h"
+#include "humanbuilder.h"
+
+
+GameAnnotator::GameAnnotator(GameManager* manager, QObject* parent)
+	: QObject(parent),
+	  m_manager(manager),
+	  m_engine(0),
+	  m_opponent(new HumanBuilder("Annotator")),
+	  m_running(false),
+	  m_stopping(false),
+	  m_inputFinished(false),
+	  m_readCount(0),
+	  m_writeCount(0)
+{
+	Q_ASSERT(manager != 0);
+}
+
+GameAnnotator::~GameAnnotator()
+{
+	foreach (const Job& job, m_jobs)
+		delete job.pgn;
+
+	delete m_engine;
+	delete m_opponent;
+}
+
+void GameAnnotator::setEngine(const EngineConfiguration& config,
+			      const TimeControl& timeControl)
+{
+	Q_ASSERT(!m_running);
+
+	delete m_engine;
+	m_engine = new EngineBuilder(config);
+	m_timeControl = timeControl;
+}
+
+void GameAnnotator::setCheckpointFile(const QString& fileName)
+{
+	m_checkpointFile = fileName;
+}
+
+int GameAnnotator::gameCount() const
+{
+	return m_writeCount;
+}
+
+QString GameAnnotator::errorString() const
+{
+	return m_error;
+}
+
+bool GameAnnotator::start(const QString& inputFile, const QString& outputFile)
+{
+	Q_ASSERT(m_engine != 0);
+	Q_ASSERT(!m_running);
+
+	m_error.clear();
+	m_input.setFileName(inputFile);
+	if (!m_input.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		m_error = tr("Can't open PGN file %1").arg(inputFile);
+		return false;
+	}
+	m_stream.setDevice(&m_input);
+
+	m_readCount = 0;
+	m_writeCount = 0;
+	if (!m_checkpointFile.isEmpty())
+	{
+		QFile file(m_checkpointFile);
+		if (file.open(QIODevice::ReadOnly | QIODevice::Text))
+			m_writeCount = qMax(0, QString(file.readAll()).trimmed().toInt());
+	}
+
+	// Skip the games that were written before the checkpoint
+	PgnGame skipped;
+	while (m_readCount < m_writeCount
+	&&     skipped.read(m_stream, INT_MAX - 1, PgnGame::ReadHeaders))
+		m_readCount++;
+	m_writeCount = m_readCount;
+
+	QIODevice::OpenMode mode = QIODevice::WriteOnly | QIODevice::Text;
+	mode |= (m_writeCount > 0) ? QIODevice::Append : QIODevice::Truncate;
+	m_output.setFileName(outputFile);
+	if (!m_output.open(mode))
+	{
+		m_error = tr("Can't open PGN file %1").arg(outputFile);
+		m_stream.reset();
+		m_input.close();
+		return false;
+	}
+	m_out.setDevice(&m_output);
+
+	m_running = true;
+	m_stopping = false;
+	m_inputFinished = false;
+	connect(m_manager, SIGNAL(ready()),
+		this, SLOT(startNextPosition()));
+
+	startNextPosition();
+	return true;
+}
+
+void GameAnnotator::stop()
+{
+	if (!m_running || m_stopping)
+		return;
+
+	m_stopping = true;
+	disconnect(m_manager, SIGNAL(ready()),
+		   this, SLOT(startNextPosition()));
+
+	if (m_games.isEmpty())
+	{
+		finish();
+		return;
+	}
+
+	foreach (ChessGame* game, m_games)
+		QMetaObject::invokeMethod(game, "stop", Qt::QueuedConnection);
+}
+
+bool GameAnnotator::readGame()
+{
+	PgnGame* pgn = new PgnGame();
+	if (!pgn->read(m_stream))
+	{
+		delete pgn;
+		m_inputFinished = true;
+		return false;
+	}
+
+	Job job;
+	job.pgn = pgn;
+	job.nextPly = 0;
+
+	// Games that can't be replayed are written without annotations
+	Chess::Board* board = pgn->createBoard();
+	if (board != 0)
+	{
+		foreach (const PgnGame::MoveData& md, pgn->moves())
+		{
+			Chess::Move move(board->moveFromGenericMove(md.move));
+			if (move.isNull())
+				break;
+
+			job.moves.append(move);
+			board->makeMove(move);
+		}
+		delete board;
+	}
+	job.pendingPositions = job.moves.size();
+	m_jobs[m_readCount++] = job;
+
+	return true;
+}
+
+bool GameAnnotator::takeNextPosition(Position* position)
+{
+	if (!m_retries.isEmpty())
+	{
+		*position = m_retries.takeFirst();
+		return true;
+	}
+
+	forever
+	{
+		if (!m_jobs.isEmpty())
+		{
+			QMap<int, Job>::iterator it = m_jobs.end() - 1;
+			if (it->nextPly < it->moves.size())
+			{
+				position->game = it.key();
+				position->ply = it->nextPly++;
+				position->retry = false;
+				return true;
+			}
+		}
+
+		if (m_inputFinished || !readGame())
+			return false;
+
+		// Games without moves can be written right away
+		writeGames();
+	}
+}
+
+void GameAnnotator::startNextPosition()
+{
+	if (!m_running || m_stopping)
+		return;
+
+	Position position;
+	if (!takeNextPosition(&position))
+	{
+		if (m_games.isEmpty())
+			finish();
+		return;
+	}
+
+	const Job& job = m_jobs[position.game];
+	Chess::Board* board = Chess::BoardFactory::create(job.pgn->variant());
+	Q_ASSERT(board != 0);
+
+	ChessGame* game = new ChessGame(board, new PgnGame());
+	game->setProperty("annotatorGame", position.game);
+	game->setProperty("annotatorPly", position.ply);
+	game->setProperty("annotatorRetry", position.retry);
+	game->setStartingFen(job.pgn->startingFenString());
+	game->setMoves(job.moves.mid(0, position.ply));
+	game->setTimeControl(m_timeControl);
+	m_games.append(game);
+
+	// The engine's evaluation is recorded in the game thread, and
+	// the game is stopped before the opponent has to move.
+	connect(game, SIGNAL(moveMade(Chess::GenericMove, QString, QString)),
+		this, SLOT(onMoveMade(Chess::GenericMove, QString, QString)),
+		Qt::DirectConnection);
+	connect(game, SIGNAL(finished(ChessGame*)),
+		this, SLOT(onGameFinished(ChessGame*)));
+	connect(game, SIGNAL(startFailed(ChessGame*)),
+		this, SLOT(onGameStartFailed(ChessGame*)));
+
+	Chess::Side side = job.pgn->startingSide();
+	if (position.ply % 2 != 0)
+		side = side.opposite();
+
+	if (side == Chess::Side::White)
+		m_manager->newGame(game, m_engine, m_opponent,
+				   GameManager::Enqueue, GameManager::ReusePlayers);
+	else
+		m_manager->newGame(game, m_opponent, m_engine,
+				   GameManager::Enqueue, GameManager::ReusePlayers);
+}
+
+void GameAnnotator::onMoveMade(const Chess::GenericMove& move,
+			       const QString& sanString,
+			       const QString& comment)
+{
+	Q_UNUSED(move);
+	Q_UNUSED(sanString);
+
+	ChessGame* game = qobject_cast<ChessGame*>(QObject::sender());
+	Q_ASSERT(game != 0);
+
+	// Skip the forced moves that lead to the position
+	if (game->pgn()->moves().size() <= game->property("annotatorPly").toInt()
+	||  game->property("annotation").isValid())
+		return;
+
+	game->setProperty("annotation", comment);
+	QMetaObject::invokeMethod(game, "stop", Qt::QueuedConnection);
+}
+
+void GameAnnotator::onGameFinished(ChessGame* game)
+{
+	finishPosition(game);
+
+	if (m_games.isEmpty()
+	&&  (m_stopping || (m_inputFinished && m_jobs.isEmpty())))
+		finish();
+}
+
+void GameAnnotator::onGameStartFailed(ChessGame* game)
+{
+	m_error = game->errorString();
+	qWarning("%s", qPrintable(m_error));
+
+	finishPosition(game);
+	stop();
+}
+
+void GameAnnotator::finishPosition(ChessGame* game)
+{
+	if (!m_games.removeOne(game))
+		return;
+
+	int index = game->property("annotatorGame").toInt();
+	int ply = game->property("annotatorPly").toInt();
+	bool retry = game->property("annotatorRetry").toBool();
+	QVariant annotation(game->property("annotation"));
+	Chess::Result::Type resultType = game->result().type();
+
+	delete game->pgn();
+	game->deleteLater();
+
+	QMap<int, Job>::iterator it = m_jobs.find(index);
+	Q_ASSERT(it != m_jobs.end());
+
+	if (annotation.isValid())
+	{
+		if (!annotation.toString().isEmpty())
+			it->pgn->setMoveComment(ply, annotation.toString());
+	}
+	else if (!m_stopping && !retry
+	     &&  (resultType == Chess::Result::Disconnection
+	     ||   resultType == Chess::Result::StalledConnection))
+	{
+		// The game manager replaces the lost engine, so the
+		// position is given one more chance.
+		Position position = { index, ply, true };
+		m_retries.append(position);
+		return;
+	}
+
+	it->pendingPositions--;
+	writeGames();
+}
+
+void GameAnnotator::writeGames()
+{
+	while (!m_jobs.isEmpty())
+	{
+		QMap<int, Job>::iterator it = m_jobs.begin();
+		if (it->nextPly < it->moves.size() || it->pendingPositions > 0)
+			break;
+
+		it->pgn->write(m_out);
+		m_out.flush();
+		delete it->pgn;
+		m_jobs.erase(it);
+
+		m_writeCount++;
+		writeCheckpoint();
+		emit gameAnnotated(m_writeCount);
+	}
+}
+
+void GameAnnotator::writeCheckpoint()
+{
+	if (m_checkpointFile.isEmpty())
+		return;
+
+	QFile file(m_checkpointFile);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+	{
+		qWarning("Can't write checkpoint file %s",
+			 qPrintable(m_checkpointFile));
+		return;
+	}
+	QTextStream(&file) << m_writeCount << '\n';
+}
+
+void GameAnnotator::finish()
+{
+	if (!m_running)
+		return;
+
+	// The checkpoint is only needed for continuing an unfinished run
+	if (!m_stopping && m_inputFinished && m_jobs.isEmpty()
+	&&  !m_checkpointFile.isEmpty())
+		QFile::remove(m_checkpointFile);
+
+	m_running = false;
+	m_stopping = false;
+	disconnect(m_manager, SIGNAL(ready()),
+		   this, SLOT(startNextPosition()));
+
+	foreach (const Job& job, m_jobs)
+		delete job.pgn;
+	m_jobs.clear();
+	m_retries.clear();
+
+	m_stream.reset();
+	m_input.close();
+	m_out.flush();
+	m_out.setDevice(0);
+	m_output.close();
+
+	m_manager->cleanupIdleThreads();
+	emit finished();
+}
@@ -0,0 +1,169 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GAMEANNOTATOR_H
+#define GAMEANNOTATOR_H
+
+#include <QObject>
+#include <QMap>
+#include <QList>
+#include <QVector>
+#include <QFile>
+#include <QTextStream>
+#include "board/move.h"
+#include "board/genericmove.h"
+#include "timecontrol.h"
+#include "pgnstream.h"
+class GameManager;
+class ChessGame;
+class PgnGame;
+class EngineConfiguration;
+class PlayerBuilder;
+
+/*!
+ * \brief Annotates the games of a PGN file with engine evaluations.
+ *
+ * GameAnnotator reads the games of a PGN file one at a time, lets an
+ * engine analyze the position before each move, and writes the games
+ * to another PGN file with the evaluations as move comments in the
+ * same format as cutechess uses for its own games, eg. "+0.35/12 1.2s".
+ *
+ * Each position is analyzed in its own game in \a manager, so the
+ * positions are distributed over GameManager::concurrency() engine
+ * instances. The engines are reused for every position, and the
+ * moves leading to the position are sent to them as forced moves so
+ * that the engines know the game history. Each position is searched
+ * with the same time control, which should have a node limit or a
+ * fixed time per move.
+ *
+ * The games are written in the same order as they were read. If a
+ * checkpoint file is set, the number of written games is saved in it
+ * after every game, and an interrupted run can be continued by
+ * starting again with the same files.
+ */
+class LIB_EXPORT GameAnnotator : public QObject
+{
+	Q_OBJECT
+
+	public:
+		/*! Creates a new annotator that plays in \a manager. */
+		GameAnnotator(GameManager* manager, QObject* parent = 0);
+		/*! Destroys the annotator. */
+		virtual ~GameAnnotator();
+
+		/*!
+		 * Sets the engine to \a config and its time control for
+		 * each position to \a timeControl.
+		 */
+		void setEngine(const EngineConfiguration& config,
+			       const TimeControl& timeControl);
+		/*!
+		 * Sets the checkpoint file to \a fileName.
+		 *
+		 * The file is removed when every game has been written.
+		 * By default no checkpoints are saved.
+		 */
+		void setCheckpointFile(const QString& fileName);
+
+		/*!
+		 * Returns the number of games written to the output file,
+		 * including the games written before the last checkpoint.
+		 */
+		int gameCount() const;
+		/*! Returns a detailed description of the last error. */
+		QString errorString() const;
+
+		/*!
+		 * Starts annotating the games of \a inputFile and writing
+		 * them to \a outputFile.
+		 *
+		 * If the checkpoint file exists, the games that were
+		 * already written are skipped and the rest are appended
+		 * to \a outputFile. Otherwise \a outputFile is overwritten.
+		 *
+		 * Returns false if the files can't be opened.
+		 */
+		bool start(const QString& inputFile, const QString& outputFile);
+
+	public slots:
+		/*!
+		 * Stops annotating. The unfinished games aren't written,
+		 * so they are annotated again when the run is continued.
+		 */
+		void stop();
+
+	signals:
+		/*!
+		 * Emitted when a game is written to the output file.
+		 * \a count is the value of gameCount().
+		 */
+		void gameAnnotated(int count);
+		/*! Emitted when every game is written, or after stop(). */
+		void finished();
+
+	private slots:
+		void startNextPosition();
+		void onMoveMade(const Chess::GenericMove& move,
+				const QString& sanString,
+				const QString& comment);
+		void onGameFinished(ChessGame* game);
+		void onGameStartFailed(ChessGame* game);
+
+	private:
+		struct Job
+		{
+			PgnGame* pgn;
+			QVector<Chess::Move> moves;
+			int nextPly;
+			int pendingPositions;
+		};
+		struct Position
+		{
+			int game;
+			int ply;
+			bool retry;
+		};
+
+		bool takeNextPosition(Position* position);
+		bool readGame();
+		void finishPosition(ChessGame* game);
+		void writeGames();
+		void writeCheckpoint();
+		void finish();
+
+		GameManager* m_manager;
+		PlayerBuilder* m_engine;
+		PlayerBuilder* m_opponent;
+		TimeControl m_timeControl;
+		QString m_checkpointFile;
+		QString m_error;
+		QFile m_input;
+		QFile m_output;
+		PgnStream m_stream;
+		QTextStream m_out;
+		bool m_running;
+		bool m_stopping;
+		bool m_inputFinished;
+		int m_readCount;
+		int m_writeCount;
+		QMap<int, Job> m_jobs;
+		QList<Position> m_retries;
+		QList<ChessGame*> m_games;
+};
+
+#endif // GAMEANNOTATOR_H
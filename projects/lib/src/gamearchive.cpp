@@ -0,0 +1,603 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gamearchive.h"
+#include <QStringList>
+#include "pgngame.h"
+#include "board/board.h"
+
+/*
+ * File layout (all integers are unsigned LEB128 varints unless noted):
+ *
+ * header:    "CCGA", version byte
+ * record:    size, payload
+ * payload:   tag count, tags (name, value), starting side byte,
+ *            move count, moves
+ * move:      source byte, target byte, promotion byte, flags byte,
+ *            [zigzag score, depth], [time in ms], [comment text]
+ * string:    size, UTF-8 data
+ * index:     game count, record offsets (delta-coded)
+ * trailer:   index offset (8 bytes, little endian), "CCGI"
+ *
+ * A square is packed into one byte: file + 1 in the low nibble and
+ * rank + 1 in the high nibble, so a null square is 0.
+ */
+
+static const char s_magic[] = "CCGA";
+static const char s_indexMagic[] = "CCGI";
+static const char s_version = 1;
+static const qint64 s_headerSize = 5;
+static const qint64 s_trailerSize = 12;
+
+// Flags for the different parts of a move comment
+enum CommentFlag
+{
+	BookComment = 0x01,
+	TimeComment = 0x02,
+	ScoreComment = 0x04,
+	MateComment = 0x08,
+	TextComment = 0x10
+};
+
+static void putVarint(QByteArray& out, quint64 value)
+{
+	while (value >= 0x80)
+	{
+		out.append(char((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+	out.append(char(value));
+}
+
+static bool getVarint(const char*& p, const char* end, quint64* value)
+{
+	quint64 tmp = 0;
+	for (int shift = 0; p < end && shift < 64; shift += 7)
+	{
+		quint8 c = quint8(*p++);
+		tmp |= quint64(c & 0x7F) << shift;
+		if (!(c & 0x80))
+		{
+			*value = tmp;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static quint64 zigzag(qint64 value)
+{
+	return (quint64(value) << 1) ^ quint64(value >> 63);
+}
+
+static qint64 unzigzag(quint64 value)
+{
+	return qint64(value >> 1) ^ -qint64(value & 1);
+}
+
+static void putString(QByteArray& out, const QString& str)
+{
+	const QByteArray data(str.toUtf8());
+	putVarint(out, data.size());
+	out.append(data);
+}
+
+static bool getString(const char*& p, const char* end, QString* str)
+{
+	quint64 size;
+	if (!getVarint(p, end, &size) || size > quint64(end - p))
+		return false;
+
+	*str = QString::fromUtf8(p, int(size));
+	p += size;
+	return true;
+}
+
+static bool packSquare(const Chess::Square& square, quint8* data)
+{
+	int file = qMax(square.file(), -1) + 1;
+	int rank = qMax(square.rank(), -1) + 1;
+	if (file > 0xF || rank > 0xF)
+		return false;
+
+	*data = quint8(file | (rank << 4));
+	return true;
+}
+
+static Chess::Square unpackSquare(quint8 data)
+{
+	return Chess::Square(int(data & 0xF) - 1, int(data >> 4) - 1);
+}
+
+// The move time in the same format that ChessGame uses
+static QString timeString(quint64 t)
+{
+	if (t == 0)
+		return "0s";
+
+	int precision = 0;
+	if (t < 100)
+		precision = 3;
+	else if (t < 1000)
+		precision = 2;
+	else if (t < 10000)
+		precision = 1;
+	return QString::number(double(t / 1000.0), 'f', precision) + 's';
+}
+
+static QString evalComment(int flags, qint64 score, quint64 depth, quint64 time)
+{
+	if (flags & BookComment)
+		return "book";
+
+	QString str;
+	if (flags & MateComment)
+	{
+		str += (score > 0) ? "+M" : "-M";
+		str += QString::number(qAbs(score));
+	}
+	else if (flags & ScoreComment)
+	{
+		if (score > 0)
+			str += "+";
+		str += QString::number(double(score) / 100.0, 'f', 2);
+	}
+	if (flags & (MateComment | ScoreComment))
+		str += "/" + QString::number(depth) + " ";
+
+	return str + timeString(time);
+}
+
+/*
+ * Converts an evaluation comment into numbers. Returns TextComment
+ * if the comment can't be reproduced exactly from the numbers.
+ */
+static int parseComment(const QString& comment,
+			qint64* score,
+			quint64* depth,
+			quint64* time)
+{
+	if (comment.isEmpty())
+		return 0;
+	if (comment == "book")
+		return BookComment;
+
+	const QStringList parts(comment.split(' '));
+	if (parts.size() > 2 || !parts.last().endsWith('s'))
+		return TextComment;
+
+	bool ok;
+	const QString& timeStr(parts.last());
+	double seconds = timeStr.left(timeStr.size() - 1).toDouble(&ok);
+	if (!ok || seconds < 0.0)
+		return TextComment;
+	*time = quint64(qRound64(seconds * 1000.0));
+
+	int flags = TimeComment;
+	if (parts.size() == 2)
+	{
+		const QStringList eval(parts.first().split('/'));
+		if (eval.size() != 2)
+			return TextComment;
+
+		*depth = eval.last().toULongLong(&ok);
+		if (!ok || *depth == 0)
+			return TextComment;
+
+		const QString& scoreStr(eval.first());
+		if (scoreStr.startsWith("+M") || scoreStr.startsWith("-M"))
+		{
+			*score = scoreStr.mid(2).toLongLong(&ok);
+			if (scoreStr.startsWith('-'))
+				*score = -*score;
+			flags |= MateComment;
+		}
+		else
+		{
+			*score = qRound64(scoreStr.toDouble(&ok) * 100.0);
+			flags |= ScoreComment;
+		}
+		if (!ok)
+			return TextComment;
+	}
+
+	if (evalComment(flags, *score, *depth, *time) != comment)
+		return TextComment;
+	return flags;
+}
+
+
+GameArchive::GameArchive()
+	: m_mode(ReadOnly)
+{
+}
+
+GameArchive::~GameArchive()
+{
+	close();
+}
+
+bool GameArchive::setError(const QString& message)
+{
+	m_error = message;
+	return false;
+}
+
+bool GameArchive::open(const QString& fileName, OpenMode mode)
+{
+	close();
+	m_mode = mode;
+	m_file.setFileName(fileName);
+
+	QIODevice::OpenMode fileMode = QIODevice::ReadOnly;
+	if (mode == Append)
+		fileMode = QIODevice::ReadWrite;
+	if (!m_file.open(fileMode))
+		return setError(QString("Can't open file %1: %2")
+				.arg(fileName).arg(m_file.errorString()));
+
+	if (mode == Append && m_file.size() == 0)
+	{
+		QByteArray header(s_magic, 4);
+		header.append(s_version);
+		if (m_file.write(header) != header.size())
+		{
+			setError(m_file.errorString());
+			m_file.close();
+			return false;
+		}
+		return true;
+	}
+
+	qint64 end = loadIndex();
+	if (end < 0)
+	{
+		m_file.close();
+		m_offsets.clear();
+		return false;
+	}
+
+	// Drop the old index and any partially written record. A new
+	// index is written when the archive is closed.
+	if (mode == Append && (!m_file.resize(end) || !m_file.seek(end)))
+	{
+		setError(m_file.errorString());
+		m_file.close();
+		m_offsets.clear();
+		return false;
+	}
+
+	return true;
+}
+
+void GameArchive::close()
+{
+	if (!m_file.isOpen())
+		return;
+
+	if (m_mode == Append)
+	{
+		qint64 indexOffset = m_file.pos();
+		QByteArray data;
+
+		putVarint(data, m_offsets.size());
+		qint64 prev = s_headerSize;
+		foreach (qint64 offset, m_offsets)
+		{
+			putVarint(data, quint64(offset - prev));
+			prev = offset;
+		}
+
+		for (int i = 0; i < 8; i++)
+			data.append(char((quint64(indexOffset) >> (i * 8)) & 0xFF));
+		data.append(s_indexMagic, 4);
+
+		if (m_file.write(data) != data.size())
+			qWarning("Can't write the index of game archive %s",
+				 qPrintable(m_file.fileName()));
+	}
+
+	m_file.close();
+	m_offsets.clear();
+}
+
+bool GameArchive::isOpen() const
+{
+	return m_file.isOpen();
+}
+
+QString GameArchive::errorString() const
+{
+	return m_error;
+}
+
+int GameArchive::gameCount() const
+{
+	return m_offsets.size();
+}
+
+QFile* GameArchive::file()
+{
+	return &m_file;
+}
+
+qint64 GameArchive::loadIndex()
+{
+	m_offsets.clear();
+
+	const qint64 size = m_file.size();
+	QByteArray header(m_file.read(s_headerSize));
+	if (header.size() != s_headerSize
+	||  !header.startsWith(s_magic)
+	||  header.at(4) != s_version)
+	{
+		setError(QString("%1 is not a game archive")
+			 .arg(m_file.fileName()));
+		return -1;
+	}
+
+	if (size < s_headerSize + s_trailerSize
+	||  !m_file.seek(size - s_trailerSize))
+		return scanRecords(s_headerSize);
+
+	const QByteArray trailer(m_file.read(s_trailerSize));
+	if (trailer.size() != s_trailerSize || !trailer.endsWith(s_indexMagic))
+		return scanRecords(s_headerSize);
+
+	quint64 indexOffset = 0;
+	for (int i = 0; i < 8; i++)
+		indexOffset |= quint64(quint8(trailer.at(i))) << (i * 8);
+	if (indexOffset < quint64(s_headerSize)
+	||  indexOffset > quint64(size - s_trailerSize)
+	||  !m_file.seek(qint64(indexOffset)))
+		return scanRecords(s_headerSize);
+
+	const QByteArray data(m_file.read(size - s_trailerSize - indexOffset));
+	const char* p = data.constData();
+	const char* end = p + data.size();
+
+	quint64 count;
+	bool ok = getVarint(p, end, &count) && count <= quint64(data.size());
+	qint64 offset = s_headerSize;
+	for (quint64 i = 0; ok && i < count; i++)
+	{
+		quint64 delta;
+		ok = getVarint(p, end, &delta);
+		offset += qint64(delta);
+		ok = ok && offset < qint64(indexOffset);
+		m_offsets.append(offset);
+	}
+	if (!ok || p != end)
+		return scanRecords(s_headerSize);
+
+	return qint64(indexOffset);
+}
+
+qint64 GameArchive::scanRecords(qint64 start)
+{
+	m_offsets.clear();
+
+	const qint64 size = m_file.size();
+	qint64 pos = start;
+	while (pos < size && m_file.seek(pos))
+	{
+		qint64 recordSize;
+		if (!readRecordSize(&recordSize))
+			break;
+
+		qint64 next = m_file.pos() + recordSize;
+		if (next > size)
+			break;
+
+		m_offsets.append(pos);
+		pos = next;
+	}
+
+	return pos;
+}
+
+bool GameArchive::readRecordSize(qint64* size)
+{
+	quint64 value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		char c;
+		if (!m_file.getChar(&c))
+			return false;
+
+		value |= quint64(quint8(c) & 0x7F) << shift;
+		if (!(quint8(c) & 0x80))
+		{
+			*size = qint64(value);
+			return *size >= 0;
+		}
+	}
+
+	return false;
+}
+
+bool GameArchive::writeGame(const PgnGame& game)
+{
+	Q_ASSERT(m_file.isOpen() && m_mode == Append);
+
+	static const QStringList roster = QStringList()
+		<< "Event" << "Site" << "Date" << "Round"
+		<< "White" << "Black" << "Result";
+
+	QByteArray payload;
+
+	// Don't store the placeholder values of missing roster tags
+	QList< QPair<QString, QString> > tags = game.tags();
+	for (int i = tags.size() - 1; i >= 0; i--)
+	{
+		if (tags.at(i).second == "?" && roster.contains(tags.at(i).first))
+			tags.removeAt(i);
+	}
+	putVarint(payload, tags.size());
+	for (int i = 0; i < tags.size(); i++)
+	{
+		putString(payload, tags.at(i).first);
+		putString(payload, tags.at(i).second);
+	}
+
+	payload.append(char(game.startingSide()));
+
+	const QVector<PgnGame::MoveData>& moves = game.moves();
+	putVarint(payload, moves.size());
+	foreach (const PgnGame::MoveData& md, moves)
+	{
+		quint8 source;
+		quint8 target;
+		if (!packSquare(md.move.sourceSquare(), &source)
+		||  !packSquare(md.move.targetSquare(), &target))
+			return setError("The board is too large for a game archive");
+
+		qint64 score = 0;
+		quint64 depth = 0;
+		quint64 time = 0;
+		int flags = parseComment(md.comment, &score, &depth, &time);
+
+		payload.append(char(source));
+		payload.append(char(target));
+		payload.append(char(md.move.promotion()));
+		payload.append(char(flags));
+		if (flags & (ScoreComment | MateComment))
+		{
+			putVarint(payload, zigzag(score));
+			putVarint(payload, depth);
+		}
+		if (flags & TimeComment)
+			putVarint(payload, time);
+		if (flags & TextComment)
+			putString(payload, md.comment);
+	}
+
+	QByteArray record;
+	putVarint(record, payload.size());
+	record.append(payload);
+
+	qint64 offset = m_file.pos();
+	if (m_file.write(record) != record.size())
+		return setError(m_file.errorString());
+
+	m_offsets.append(offset);
+	return true;
+}
+
+bool GameArchive::readGame(int index, PgnGame& game)
+{
+	Q_ASSERT(m_file.isOpen() && m_mode == ReadOnly);
+
+	if (index < 0 || index >= m_offsets.size())
+		return setError(QString("Invalid game index: %1").arg(index));
+
+	qint64 size;
+	if (!m_file.seek(m_offsets.at(index)) || !readRecordSize(&size))
+		return setError(m_file.errorString());
+	const QByteArray payload(m_file.read(size));
+	if (payload.size() != size)
+		return setError(QString("Game %1 is truncated").arg(index + 1));
+
+	const QString corrupted(QString("Game %1 is corrupted").arg(index + 1));
+	const char* p = payload.constData();
+	const char* end = p + payload.size();
+
+	game.clear();
+
+	quint64 tagCount;
+	if (!getVarint(p, end, &tagCount))
+		return setError(corrupted);
+	for (quint64 i = 0; i < tagCount; i++)
+	{
+		QString tag;
+		QString value;
+		if (!getString(p, end, &tag) || !getString(p, end, &value))
+			return setError(corrupted);
+		game.setTag(tag, value);
+	}
+
+	if (p >= end || quint8(*p) > Chess::Side::NoSide)
+		return setError(corrupted);
+	game.setStartingSide(Chess::Side::Type(*p++));
+
+	quint64 moveCount;
+	if (!getVarint(p, end, &moveCount) || moveCount > quint64(end - p))
+		return setError(corrupted);
+
+	QVector<PgnGame::MoveData> moves;
+	moves.reserve(int(moveCount));
+	for (quint64 i = 0; i < moveCount; i++)
+	{
+		if (end - p < 4)
+			return setError(corrupted);
+
+		PgnGame::MoveData md;
+		md.key = 0;
+		md.move = Chess::GenericMove(unpackSquare(quint8(p[0])),
+					     unpackSquare(quint8(p[1])),
+					     quint8(p[2]));
+		int flags = quint8(p[3]);
+		p += 4;
+
+		quint64 score = 0;
+		quint64 depth = 0;
+		quint64 time = 0;
+		if ((flags & (ScoreComment | MateComment))
+		&&  (!getVarint(p, end, &score) || !getVarint(p, end, &depth)))
+			return setError(corrupted);
+		if ((flags & TimeComment) && !getVarint(p, end, &time))
+			return setError(corrupted);
+
+		if (flags & TextComment)
+		{
+			if (!getString(p, end, &md.comment))
+				return setError(corrupted);
+		}
+		else if (flags != 0)
+			md.comment = evalComment(flags, unzigzag(score), depth, time);
+
+		moves.append(md);
+	}
+	if (p != end)
+		return setError(corrupted);
+
+	// Replay the game to get the position keys and SAN moves
+	Chess::Board* board = game.createBoard();
+	if (board == 0)
+		return setError(QString("Can't create a board for game %1")
+				.arg(index + 1));
+
+	for (int i = 0; i < moves.size(); i++)
+	{
+		PgnGame::MoveData& md = moves[i];
+		Chess::Move move(board->moveFromGenericMove(md.move));
+		if (!board->isLegalMove(move))
+		{
+			delete board;
+			return setError(QString("Illegal move in game %1")
+					.arg(index + 1));
+		}
+
+		md.key = board->key();
+		game.addMove(md, board->moveString(move, Chess::Board::StandardAlgebraic));
+		board->makeMove(move);
+	}
+
+	delete board;
+	return true;
+}
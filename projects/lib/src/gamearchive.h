@@ -0,0 +1,115 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMEARCHIVE_H
+#define GAMEARCHIVE_H
+
+#include <QFile>
+#include <QVector>
+#include <QString>
+class PgnGame;
+
+/*!
+ * \brief A compact binary container for chess games.
+ *
+ * GameArchive stores the same data as a PGN file: the tags (including
+ * the starting FEN and the result), the moves and the move comments.
+ * The moves are packed into a few bytes each, and the evaluation
+ * comments written by ChessGame (score, depth and time) are stored as
+ * numbers. Any other comment is stored as text, so converting a game
+ * back to PGN doesn't lose information.
+ *
+ * Games are appended to the archive one record at a time, and an
+ * index of the records is written to the end of the file when the
+ * archive is closed. If the index is missing, eg. because the program
+ * crashed, it is rebuilt by scanning the records when the archive is
+ * opened.
+ *
+ * The games are read back with readGame(), which replays the moves
+ * and fills in a normal PgnGame object.
+ */
+class LIB_EXPORT GameArchive
+{
+	public:
+		/*! The mode in which the archive is opened. */
+		enum OpenMode
+		{
+			ReadOnly,	//!< Read existing games
+			Append		//!< Add games to the end of the archive
+		};
+
+		/*! Creates a new, closed GameArchive. */
+		GameArchive();
+		/*! Closes the archive and destroys it. */
+		~GameArchive();
+
+		/*!
+		 * Opens the archive \a fileName in mode \a mode.
+		 *
+		 * In Append mode a missing file is created. Returns true
+		 * if successfull; otherwise returns false and sets the
+		 * error string.
+		 */
+		bool open(const QString& fileName, OpenMode mode);
+		/*!
+		 * Closes the archive.
+		 *
+		 * In Append mode the index is written before closing.
+		 */
+		void close();
+		/*! Returns true if the archive is open. */
+		bool isOpen() const;
+		/*! Returns a description of the last error. */
+		QString errorString() const;
+
+		/*! Returns the number of games in the archive. */
+		int gameCount() const;
+		/*!
+		 * Reads game number \a index (starting from 0) to \a game.
+		 *
+		 * The archive must be open in ReadOnly mode.
+		 * Returns true if successfull.
+		 */
+		bool readGame(int index, PgnGame& game);
+		/*!
+		 * Appends \a game to the end of the archive.
+		 *
+		 * The archive must be open in Append mode.
+		 * Returns true if successfull.
+		 */
+		bool writeGame(const PgnGame& game);
+
+		/*!
+		 * Returns the archive's file.
+		 *
+		 * Can be used for flushing and syncing the written data.
+		 */
+		QFile* file();
+
+	private:
+		bool setError(const QString& message);
+		qint64 loadIndex();
+		qint64 scanRecords(qint64 start);
+		bool readRecordSize(qint64* size);
+
+		QFile m_file;
+		OpenMode m_mode;
+		QString m_error;
+		QVector<qint64> m_offsets;
+};
+
+#endif // GAMEARCHIVE_H
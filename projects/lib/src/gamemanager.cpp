@@ -17,9 +17,16 @@
 
 #include "gamemanager.h"
 #include <QThread>
+#include <QTimer>
+#include <QFile>
+#include <QTextStream>
+#ifdef Q_OS_UNIX
+#include <stdlib.h>
+#endif
 #include "playerbuilder.h"
 #include "chessgame.h"
 #include "chessplayer.h"
+#include "tracelog.h"
 
 class GameInitializer : public QObject
 {
@@ -32,12 +39,17 @@ class GameInitializer : public QObject
 
 		const PlayerBuilder* whiteBuilder() const;
 		const PlayerBuilder* blackBuilder() const;
+		ChessPlayer* player(int side) const;
 		void swapPlayers();
 		void setGame(ChessGame* game);
+		void setCpus(int side, const QList<int>& cpus);
 
 	public slots:
 		void initializeGame();
-		void finish();
+		void finish(int quitTimeout = 0);
+		void adoptPlayer(int side, QObject* object);
+		void releasePlayer(int side);
+		void moveToWorker(QObject* worker);
 
 	signals:
 		void gameInitialized(bool success);
@@ -45,12 +57,16 @@ class GameInitializer : public QObject
 
 	private slots:
 		void onPlayerQuit();
+		void killPlayers();
 
 	private:
+		void failGame(int side);
+
 		int m_playerCount;
 		bool m_finishing;
 		const PlayerBuilder* m_builder[2];
 		ChessPlayer* m_player[2];
+		QList<int> m_cpus[2];
 		ChessGame* m_game;
 };
 
@@ -91,10 +107,16 @@ const PlayerBuilder* GameInitializer::blackBuilder() const
 	return m_builder[Chess::Side::Black];
 }
 
+ChessPlayer* GameInitializer::player(int side) const
+{
+	return m_player[side];
+}
+
 void GameInitializer::swapPlayers()
 {
 	qSwap(m_builder[0], m_builder[1]);
 	qSwap(m_player[0], m_player[1]);
+	qSwap(m_cpus[0], m_cpus[1]);
 }
 
 void GameInitializer::setGame(ChessGame* game)
@@ -102,8 +124,16 @@ void GameInitializer::setGame(ChessGame* game)
 	m_game = game;
 }
 
+void GameInitializer::setCpus(int side, const QList<int>& cpus)
+{
+	m_cpus[side] = cpus;
+}
+
 void GameInitializer::initializeGame()
 {
+	if (m_finishing)
+		return;
+
 	for (int i = 0; i < 2; i++)
 	{
 		// Delete a disconnected player (crashed engine) so that
@@ -113,29 +143,41 @@ void GameInitializer::initializeGame()
 		{
 			m_player[i]->deleteLater();
 			m_player[i] = 0;
+			if (m_playerCount > 0)
+				m_playerCount--;
+
+			// Back off if the player keeps crashing, so that it
+			// doesn't take CPU time from the healthy games.
+			int delay = m_builder[i]->requestRestart();
+			if (delay < 0)
+			{
+				m_game->setError(QString("Cannot restart %1: "
+							 "too many crashes")
+						 .arg(m_builder[i]->name()));
+				failGame(i);
+				return;
+			}
+			if (delay > 0)
+			{
+				QTimer::singleShot(delay, this, SLOT(initializeGame()));
+				return;
+			}
 		}
 
-		if (m_player[i] == 0)
+		if (m_player[i] != 0)
+			m_builder[i]->reconfigure(m_player[i]);
+		else
 		{
 			QString error;
-			m_player[i] = m_builder[i]->create(thread()->parent(),
-							   SIGNAL(debugMessage(QString)),
-							   this, &error);
+			m_player[i] = m_builder[i]->createWithAffinity(
+				thread()->parent(),
+				SIGNAL(debugMessage(QString)),
+				this, &error, m_cpus[i]);
 			m_game->setError(error);
 
 			if (m_player[i] == 0)
 			{
-				m_playerCount = 0;
-
-				int j = !i;
-				if (m_player[j] != 0)
-				{
-					m_player[j]->kill();
-					delete m_player[j];
-					m_player[j] = 0;
-				}
-
-				emit gameInitialized(false);
+				failGame(i);
 				return;
 			}
 		}
@@ -146,7 +188,22 @@ void GameInitializer::initializeGame()
 	emit gameInitialized(true);
 }
 
-void GameInitializer::finish()
+void GameInitializer::failGame(int side)
+{
+	m_playerCount = 0;
+
+	int j = !side;
+	if (m_player[j] != 0)
+	{
+		m_player[j]->kill();
+		delete m_player[j];
+		m_player[j] = 0;
+	}
+
+	emit gameInitialized(false);
+}
+
+void GameInitializer::finish(int quitTimeout)
 {
 	if (m_finishing)
 		return;
@@ -168,6 +225,40 @@ void GameInitializer::finish()
 			Qt::QueuedConnection);
 		m_player[i]->quit();
 	}
+
+	if (quitTimeout > 0)
+		QTimer::singleShot(quitTimeout, this, SLOT(killPlayers()));
+}
+
+void GameInitializer::adoptPlayer(int side, QObject* object)
+{
+	ChessPlayer* player = qobject_cast<ChessPlayer*>(object);
+	Q_ASSERT(player != 0);
+	Q_ASSERT(m_player[side] == 0);
+
+	player->setParent(this);
+	m_player[side] = player;
+}
+
+void GameInitializer::releasePlayer(int side)
+{
+	ChessPlayer* player = m_player[side];
+	if (player == 0)
+		return;
+
+	// Hand the player over to the game manager's thread
+	m_player[side] = 0;
+	m_playerCount--;
+	player->setParent(0);
+	player->moveToThread(thread()->parent()->thread());
+}
+
+void GameInitializer::moveToWorker(QObject* worker)
+{
+	QThread* thread = qobject_cast<QThread*>(worker);
+	Q_ASSERT(thread != 0);
+
+	moveToThread(thread);
 }
 
 void GameInitializer::onPlayerQuit()
@@ -176,22 +267,138 @@ void GameInitializer::onPlayerQuit()
 		emit finished();
 }
 
+void GameInitializer::killPlayers()
+{
+	for (int i = 0; i < 2; i++)
+	{
+		if (m_player[i] != 0
+		&&  m_player[i]->state() != ChessPlayer::Disconnected)
+			m_player[i]->kill();
+	}
+}
+
+
+/*
+ * Starts a player in a worker thread ahead of the game that needs it.
+ *
+ * The player is handed over to the game manager's thread as soon as
+ * it's created, so that it can go to the player pool. The protocol
+ * handshake continues in the background.
+ */
+class PlayerWarmer : public QObject
+{
+	Q_OBJECT
+
+	public:
+		PlayerWarmer(const PlayerBuilder* builder, QObject* manager);
+
+		const PlayerBuilder* builder() const;
+
+	public slots:
+		void createPlayer();
+
+	signals:
+		void playerCreated(QObject* player);
+
+	private:
+		const PlayerBuilder* m_builder;
+		QObject* m_manager;
+};
+
+PlayerWarmer::PlayerWarmer(const PlayerBuilder* builder, QObject* manager)
+	: m_builder(builder),
+	  m_manager(manager)
+{
+	Q_ASSERT(builder != 0);
+	Q_ASSERT(manager != 0);
+}
+
+const PlayerBuilder* PlayerWarmer::builder() const
+{
+	return m_builder;
+}
+
+void PlayerWarmer::createPlayer()
+{
+	QString error;
+	ChessPlayer* player = m_builder->create(m_manager,
+						SIGNAL(debugMessage(QString)),
+						0, &error);
+	if (player == 0)
+		qWarning("%s", qPrintable(error));
+	else
+		player->moveToThread(m_manager->thread());
+
+	emit playerCreated(player);
+}
+
+
+/*
+ * Measures the event loop latency of a worker thread.
+ *
+ * The probe lives in the worker thread, and reports how long a probe
+ * event posted by the game manager waited before it was delivered.
+ */
+class LoopProbe : public QObject
+{
+	Q_OBJECT
+
+	public:
+		LoopProbe(int worker, const QElapsedTimer* clock);
+
+	public slots:
+		void probe(qint64 sent);
+
+	signals:
+		void probed(int worker, int msecs);
+
+	private:
+		int m_worker;
+		const QElapsedTimer* m_clock;
+};
+
+LoopProbe::LoopProbe(int worker, const QElapsedTimer* clock)
+	: m_worker(worker),
+	  m_clock(clock)
+{
+}
+
+void LoopProbe::probe(qint64 sent)
+{
+	emit probed(m_worker, int(m_clock->elapsed() - sent));
+}
 
-class GameThread : public QThread
+
+/*
+ * A logical game thread: a game slot with its own pair of players.
+ *
+ * The game and the players live in one of the game manager's worker
+ * threads, which is shared by many game threads. Games are mostly
+ * waiting for engine output, so a few event loops can serve a large
+ * number of games.
+ */
+class GameThread : public QObject
 {
 	Q_OBJECT
 
 	public:
 		GameThread(const PlayerBuilder* white,
 			   const PlayerBuilder* black,
+			   QThread* worker,
 			   QObject* parent);
 		virtual ~GameThread();
 
 		bool isReady() const;
+		bool isRunning() const;
+		void start();
 		void newGame(ChessGame* game);
-		void finish();
+		void finish(int quitTimeout = 0);
 		void finishAndDelete();
 
+		QThread* worker() const;
+		void setWorker(QThread* worker);
+		int cpuSlot() const;
+		void setCpuSlot(int slot, const CpuPlacement& placement);
 		GameInitializer* initializer() const;
 		ChessGame* game() const;
 		GameManager::StartMode startMode() const;
@@ -203,37 +410,48 @@ class GameThread : public QThread
 	signals:
 		void gameInitialized(bool success);
 		void ready();
+		void finished();
 
 	private slots:
 		void onGameDestroyed();
+		void onInitializerDestroyed();
 
 	private:
 		bool m_ready;
+		bool m_running;
 		GameManager::StartMode m_startMode;
 		GameManager::CleanupMode m_cleanupMode;
 		ChessGame* m_game;
 		GameInitializer* m_initializer;
+		QThread* m_worker;
+		int m_cpuSlot;
 };
 
 GameThread::GameThread(const PlayerBuilder* white,
 		       const PlayerBuilder* black,
+		       QThread* worker,
 		       QObject* parent)
-	: QThread(parent),
+	: QObject(parent),
 	  m_ready(true),
+	  m_running(false),
 	  m_startMode(GameManager::StartImmediately),
 	  m_cleanupMode(GameManager::DeletePlayers),
 	  m_game(0),
-	  m_initializer(new GameInitializer(white, black))
+	  m_initializer(new GameInitializer(white, black)),
+	  m_worker(worker),
+	  m_cpuSlot(-1)
 {
+	Q_ASSERT(worker != 0);
+
 	connect(m_initializer, SIGNAL(gameInitialized(bool)),
 		this, SIGNAL(gameInitialized(bool)));
 	connect(m_initializer, SIGNAL(finished()),
 		m_initializer, SLOT(deleteLater()),
 		Qt::QueuedConnection);
 	connect(m_initializer, SIGNAL(destroyed()),
-		this, SLOT(quit()),
+		this, SLOT(onInitializerDestroyed()),
 		Qt::QueuedConnection);
-	m_initializer->moveToThread(this);
+	m_initializer->moveToThread(m_worker);
 }
 
 GameThread::~GameThread()
@@ -245,6 +463,16 @@ bool GameThread::isReady() const
 	return m_ready;
 }
 
+bool GameThread::isRunning() const
+{
+	return m_running;
+}
+
+void GameThread::start()
+{
+	m_running = true;
+}
+
 void GameThread::newGame(ChessGame* game)
 {
 	m_ready = false;
@@ -258,7 +486,7 @@ void GameThread::newGame(ChessGame* game)
 				  Qt::QueuedConnection);
 }
 
-void GameThread::finish()
+void GameThread::finish(int quitTimeout)
 {
 	if (m_initializer == 0)
 		return;
@@ -270,7 +498,8 @@ void GameThread::finish()
 	}
 
 	QMetaObject::invokeMethod(m_initializer, "finish",
-				  Qt::QueuedConnection);
+				  Qt::QueuedConnection,
+				  Q_ARG(int, quitTimeout));
 	m_initializer = 0;
 }
 
@@ -280,6 +509,43 @@ void GameThread::finishAndDelete()
 	finish();
 }
 
+QThread* GameThread::worker() const
+{
+	return m_worker;
+}
+
+void GameThread::setWorker(QThread* worker)
+{
+	Q_ASSERT(worker != 0);
+	Q_ASSERT(m_ready);
+
+	if (worker == m_worker || m_initializer == 0)
+		return;
+
+	// The initializer owns the players, so they move with it
+	QMetaObject::invokeMethod(m_initializer, "moveToWorker",
+				  Qt::BlockingQueuedConnection,
+				  Q_ARG(QObject*, worker));
+	m_worker = worker;
+}
+
+int GameThread::cpuSlot() const
+{
+	return m_cpuSlot;
+}
+
+void GameThread::setCpuSlot(int slot, const CpuPlacement& placement)
+{
+	Q_ASSERT(m_initializer != 0);
+	Q_ASSERT(m_initializer->player(0) == 0 && m_initializer->player(1) == 0);
+
+	// This is only called before the initializer gets any events,
+	// so it's safe to modify it from this thread.
+	m_cpuSlot = slot;
+	for (int i = 0; i < 2; i++)
+		m_initializer->setCpus(i, placement.cpus(slot, i));
+}
+
 GameInitializer* GameThread::initializer() const
 {
 	return m_initializer;
@@ -316,13 +582,54 @@ void GameThread::onGameDestroyed()
 	emit ready();
 }
 
+void GameThread::onInitializerDestroyed()
+{
+	m_running = false;
+	emit finished();
+}
+
 
 GameManager::GameManager(QObject* parent)
 	: QObject(parent),
 	  m_finishing(false),
+	  m_cleaningUp(false),
 	  m_concurrency(1),
-	  m_activeQueuedGameCount(0)
+	  m_concurrencyLimit(1),
+	  m_maxTimingOverhead(0),
+	  m_overheadCount(0),
+	  m_overheadTotal(0),
+	  m_activeQueuedGameCount(0),
+	  m_playerPoolSize(0),
+	  m_quittingPlayerCount(0),
+	  m_quitTimeout(0),
+	  m_quitDeadline(0),
+	  m_warmupCount(0),
+	  m_warmingPlayerCount(0),
+	  m_workerCount(qMax(1, QThread::idealThreadCount())),
+	  m_lastProbeTime(0),
+	  m_probeTimer(new QTimer(this)),
+	  m_quitTimer(new QTimer(this)),
+	  m_traceFile(0),
+	  m_trace(0)
+{
+	m_stats.gamesStarted = 0;
+	m_stats.threadsCreated = 0;
+	m_stats.threadsFinished = 0;
+	m_clock.start();
+
+	m_probeTimer->setInterval(1000);
+	connect(m_probeTimer, SIGNAL(timeout()),
+		this, SLOT(onProbeTimeout()));
+
+	m_quitTimer->setSingleShot(true);
+	connect(m_quitTimer, SIGNAL(timeout()),
+		this, SLOT(onQuitDeadline()));
+}
+
+GameManager::~GameManager()
 {
+	stopWorkers();
+	setTraceFile(QString());
 }
 
 QList<ChessGame*> GameManager::activeGames() const
@@ -330,6 +637,19 @@ QList<ChessGame*> GameManager::activeGames() const
 	return m_activeGames;
 }
 
+int GameManager::queuedGameCount() const
+{
+	return m_gameEntries.size();
+}
+
+int GameManager::freeSlotCount() const
+{
+	// The games taken from the queue hold their slots from the
+	// start of their initialization
+	int used = m_gameOwners.size() + m_gameEntries.size();
+	return qMax(m_concurrencyLimit - used, 0);
+}
+
 int GameManager::concurrency() const
 {
 	return m_concurrency;
@@ -338,6 +658,96 @@ int GameManager::concurrency() const
 void GameManager::setConcurrency(int concurrency)
 {
 	m_concurrency = concurrency;
+	m_concurrencyLimit = concurrency;
+}
+
+int GameManager::maxTimingOverhead() const
+{
+	return m_maxTimingOverhead;
+}
+
+void GameManager::setMaxTimingOverhead(int msecs)
+{
+	m_maxTimingOverhead = qMax(msecs, 0);
+	m_concurrencyLimit = m_concurrency;
+	m_overheadCount = 0;
+	m_overheadTotal = 0;
+}
+
+int GameManager::playerPoolSize() const
+{
+	return m_playerPoolSize;
+}
+
+void GameManager::setPlayerPoolSize(int size)
+{
+	m_playerPoolSize = size;
+}
+
+int GameManager::warmupCount() const
+{
+	return m_warmupCount;
+}
+
+void GameManager::setWarmupCount(int count)
+{
+	m_warmupCount = qMax(count, 0);
+}
+
+int GameManager::quitTimeout() const
+{
+	return m_quitTimeout;
+}
+
+void GameManager::setQuitTimeout(int msecs)
+{
+	m_quitTimeout = qMax(msecs, 0);
+}
+
+GameManager::Statistics GameManager::statistics() const
+{
+	return m_stats;
+}
+
+bool GameManager::setTraceFile(const QString& fileName)
+{
+	delete m_trace;
+	m_trace = 0;
+	delete m_traceFile;
+	m_traceFile = 0;
+
+	if (fileName.isEmpty())
+		return true;
+
+	m_traceFile = new QFile(fileName);
+	if (!m_traceFile->open(QIODevice::WriteOnly | QIODevice::Text))
+	{
+		qWarning("Can't open trace file %s", qPrintable(fileName));
+		delete m_traceFile;
+		m_traceFile = 0;
+		return false;
+	}
+	m_trace = new QTextStream(m_traceFile);
+
+	return true;
+}
+
+void GameManager::trace(const QString& event)
+{
+	if (m_trace != 0)
+		*m_trace << m_clock.elapsed() << ' ' << event << '\n';
+	if (TraceLog::isEnabled())
+		TraceLog::instant("manager", event);
+}
+
+CpuPlacement GameManager::cpuPlacement() const
+{
+	return m_cpuPlacement;
+}
+
+void GameManager::setCpuPlacement(const CpuPlacement& placement)
+{
+	m_cpuPlacement = placement;
 }
 
 void GameManager::cleanupIdleThreads()
@@ -351,6 +761,7 @@ void GameManager::cleanupIdleThreads()
 		if (thread->isReady())
 		{
 			it = m_activeThreads.erase(it);
+			releasePlayers(thread);
 			thread->finishAndDelete();
 		}
 		else
@@ -358,9 +769,89 @@ void GameManager::cleanupIdleThreads()
 	}
 }
 
+void GameManager::releasePlayers(GameThread* thread)
+{
+	GameInitializer* initializer = thread->initializer();
+	if (m_playerPoolSize <= 0
+	||  !m_cpuPlacement.isNull()
+	||  initializer == 0
+	||  thread->cleanupMode() != ReusePlayers)
+		return;
+
+	for (int i = 0; i < 2; i++)
+	{
+		ChessPlayer* player = initializer->player(i);
+		const PlayerBuilder* builder = (i == Chess::Side::White) ?
+			initializer->whiteBuilder() : initializer->blackBuilder();
+
+		if (player == 0
+		||  player->state() == ChessPlayer::Disconnected
+		||  m_idlePlayers.count(builder) >= m_playerPoolSize)
+			continue;
+
+		// The thread is idle, so it can move the player to this
+		// thread right away.
+		QMetaObject::invokeMethod(initializer, "releasePlayer",
+					  Qt::BlockingQueuedConnection,
+					  Q_ARG(int, i));
+		player->setParent(this);
+		m_idlePlayers.insert(builder, player);
+	}
+}
+
+void GameManager::quitPlayer(ChessPlayer* player)
+{
+	m_quittingPlayerCount++;
+	m_quittingPlayers.append(player);
+	connect(player, SIGNAL(disconnected()),
+		this, SLOT(onPlayerQuit()),
+		Qt::QueuedConnection);
+	player->quit();
+}
+
+void GameManager::onPlayerQuit()
+{
+	ChessPlayer* player = qobject_cast<ChessPlayer*>(sender());
+	Q_ASSERT(player != 0);
+	m_quittingPlayers.removeOne(player);
+	player->deleteLater();
+
+	if (--m_quittingPlayerCount <= 0
+	&&  m_warmingPlayerCount <= 0
+	&&  m_cleaningUp
+	&&  m_threads.isEmpty())
+	{
+		m_cleaningUp = false;
+		m_quitTimer->stop();
+		stopWorkers();
+		emit finished();
+	}
+}
+
 void GameManager::cleanup()
 {
 	m_finishing = false;
+	m_cleaningUp = true;
+
+	// All the players share one deadline, counted from the first
+	// cleanup, after which the stragglers are killed together
+	int quitTimeout = 0;
+	if (m_quitTimeout > 0)
+	{
+		if (!m_quitTimer->isActive())
+		{
+			m_quitDeadline = m_clock.elapsed() + m_quitTimeout;
+			m_quitTimer->start(m_quitTimeout);
+		}
+		quitTimeout = qMax(int(m_quitDeadline - m_clock.elapsed()), 1);
+	}
+
+	// Terminate the players in the player pool
+	m_warmupBuilders.clear();
+	QList<ChessPlayer*> idlePlayers(m_idlePlayers.values());
+	m_idlePlayers.clear();
+	foreach (ChessPlayer* player, idlePlayers)
+		quitPlayer(player);
 
 	// Remove terminated threads from the list
 	QList< QPointer<GameThread> >::iterator it = m_threads.begin();
@@ -374,7 +865,13 @@ void GameManager::cleanup()
 
 	if (m_threads.isEmpty())
 	{
-		emit finished();
+		if (m_quittingPlayerCount <= 0 && m_warmingPlayerCount <= 0)
+		{
+			m_cleaningUp = false;
+			m_quitTimer->stop();
+			stopWorkers();
+			emit finished();
+		}
 		return;
 	}
 
@@ -383,12 +880,14 @@ void GameManager::cleanup()
 	{
 		connect(thread, SIGNAL(finished()), this, SLOT(onThreadQuit()),
 			Qt::QueuedConnection);
-		thread->finish();
+		thread->finish(quitTimeout);
 	}
 }
 
 void GameManager::finish()
 {
+	foreach (const GameEntry& entry, m_gameEntries)
+		m_newGameTimes.remove(entry.game);
 	m_gameEntries.clear();
 	if (m_activeGames.isEmpty())
 		cleanup();
@@ -400,14 +899,16 @@ void GameManager::newGame(ChessGame* game,
 			  const PlayerBuilder* white,
 			  const PlayerBuilder* black,
 			  StartMode startMode,
-			  CleanupMode cleanupMode)
+			  CleanupMode cleanupMode,
+			  const QObject* owner)
 {
 	Q_ASSERT(game != 0);
 	Q_ASSERT(white != 0);
 	Q_ASSERT(black != 0);
 	Q_ASSERT(game->parent() == 0);
 
-	GameEntry entry = { game, white, black, startMode, cleanupMode };
+	GameEntry entry = { game, white, black, startMode, cleanupMode, owner };
+	m_newGameTimes[game] = m_clock.elapsed();
 
 	if (startMode == StartImmediately)
 	{
@@ -416,9 +917,43 @@ void GameManager::newGame(ChessGame* game,
 	}
 
 	m_gameEntries << entry;
+	m_stats.queueDepth.addSample(m_gameEntries.size());
+	trace(QString("queue %1").arg(m_gameEntries.size()));
 	startQueuedGame();
 }
 
+int GameManager::queueWeight(const QObject* owner) const
+{
+	return m_queueWeights.value(owner, 1);
+}
+
+void GameManager::setQueueWeight(const QObject* owner, int weight)
+{
+	Q_ASSERT(owner != 0);
+
+	if (!m_queueWeights.contains(owner))
+		connect(owner, SIGNAL(destroyed(QObject*)),
+			this, SLOT(onOwnerDestroyed(QObject*)));
+	m_queueWeights[owner] = qMax(weight, 1);
+}
+
+void GameManager::onOwnerDestroyed(QObject* owner)
+{
+	m_queueWeights.remove(owner);
+}
+
+void GameManager::onQuitDeadline()
+{
+	QList< QPointer<ChessPlayer> > players(m_quittingPlayers);
+	m_quittingPlayers.clear();
+
+	foreach (ChessPlayer* player, players)
+	{
+		if (player != 0 && player->state() != ChessPlayer::Disconnected)
+			player->kill();
+	}
+}
+
 void GameManager::onThreadQuit()
 {
 	GameThread* thread = qobject_cast<GameThread*>(QObject::sender());
@@ -427,20 +962,36 @@ void GameManager::onThreadQuit()
 	if (thread != 0)
 		thread->deleteLater();
 
-	if (m_threads.isEmpty())
+	if (m_threads.isEmpty()
+	&&  m_quittingPlayerCount <= 0
+	&&  m_warmingPlayerCount <= 0)
 	{
 		m_finishing = false;
+		m_cleaningUp = false;
+		m_quitTimer->stop();
+		stopWorkers();
 		emit finished();
 	}
 }
 
+void GameManager::onThreadFinished()
+{
+	GameThread* thread = qobject_cast<GameThread*>(QObject::sender());
+	Q_ASSERT(thread != 0);
+
+	m_usedCpuSlots.remove(thread->cpuSlot());
+	m_stats.threadsFinished++;
+	trace("thread-finish");
+}
+
 void GameManager::onThreadReady()
 {
 	GameThread* thread = qobject_cast<GameThread*>(QObject::sender());
 	Q_ASSERT(thread != 0);
 	ChessGame* game = thread->game();
 
-	m_activeGames.removeOne(game);
+	if (m_activeGames.removeOne(game))
+		m_workerLoad[thread->worker()]--;
 	m_threads.removeAll(0);
 
 	if (thread->cleanupMode() == DeletePlayers)
@@ -452,6 +1003,7 @@ void GameManager::onThreadReady()
 	if (thread->startMode() == Enqueue)
 	{
 		m_activeQueuedGameCount--;
+		releaseQueueShare(game);
 		startQueuedGame();
 	}
 
@@ -468,6 +1020,8 @@ void GameManager::onGameInitialized(bool success)
 
 	if (!success)
 	{
+		m_newGameTimes.remove(game);
+		releaseQueueShare(game);
 		m_threads.removeOne(gameThread);
 		m_activeThreads.removeOne(gameThread);
 
@@ -479,15 +1033,27 @@ void GameManager::onGameInitialized(bool success)
 	}
 
 	m_activeGames << game;
+	m_workerLoad[gameThread->worker()]++;
 	if (gameThread->startMode() == Enqueue)
 	{
 		m_activeQueuedGameCount++;
 		cleanupIdleThreads();
 	}
 
-	game->moveToThread(gameThread);
+	if (m_maxTimingOverhead > 0)
+	{
+		for (int i = 0; i < 2; i++)
+			connect(game->player(Chess::Side::Type(i)),
+				SIGNAL(moveTimed(int, int)),
+				this, SLOT(onMoveTimed(int, int)),
+				Qt::ConnectionType(Qt::QueuedConnection |
+						   Qt::UniqueConnection));
+	}
+
+	game->moveToThread(gameThread->worker());
+	trace(QString("move-to-worker %1").arg(m_workers.indexOf(gameThread->worker()) + 1));
 	connect(game, SIGNAL(started(ChessGame*)),
-		this, SIGNAL(gameStarted(ChessGame*)),
+		this, SLOT(onGameStarted(ChessGame*)),
 		Qt::QueuedConnection);
 	QMetaObject::invokeMethod(game, "start", Qt::QueuedConnection);
 
@@ -509,11 +1075,26 @@ GameThread* GameManager::getThread(const PlayerBuilder* white,
 		if (tmp->whiteBuilder() == black
 		&&  tmp->blackBuilder() == white)
 			tmp->swapPlayers();
-		if (tmp->whiteBuilder() == white && tmp->blackBuilder() == black)
-			return thread;
+		if (tmp->whiteBuilder() != white || tmp->blackBuilder() != black)
+			continue;
+
+		// Move the idle players to a less busy worker thread if
+		// their current worker is running more games than others.
+		QThread* worker = getWorker();
+		if (m_workerLoad.value(thread->worker()) > m_workerLoad.value(worker) + 1)
+			thread->setWorker(worker);
+		return thread;
 	}
 
-	GameThread* gameThread = new GameThread(white, black, this);
+	// Move the players of the idle threads to the player pool, so
+	// that the new thread can use them.
+	if (m_playerPoolSize > 0
+	&&  (!m_idlePlayers.contains(white) || !m_idlePlayers.contains(black)))
+		cleanupIdleThreads();
+
+	GameThread* gameThread = new GameThread(white, black, getWorker(), this);
+	m_stats.threadsCreated++;
+	trace("thread-create");
 	m_threads << gameThread;
 	m_activeThreads << gameThread;
 	connect(gameThread, SIGNAL(ready()),
@@ -521,11 +1102,185 @@ GameThread* GameManager::getThread(const PlayerBuilder* white,
 	connect(gameThread, SIGNAL(gameInitialized(bool)),
 		this, SLOT(onGameInitialized(bool)),
 		Qt::QueuedConnection);
+	connect(gameThread, SIGNAL(finished()),
+		this, SLOT(onThreadFinished()));
+
+	int cpuSlot = takeCpuSlot();
+	if (cpuSlot != -1)
+		gameThread->setCpuSlot(cpuSlot, m_cpuPlacement);
+
+	// Hand over warmed-up players from the player pool
+	const PlayerBuilder* builders[2] = { white, black };
+	for (int i = 0; i < 2; i++)
+	{
+		ChessPlayer* player = m_idlePlayers.take(builders[i]);
+		if (player == 0)
+			continue;
+
+		player->setParent(0);
+		player->moveToThread(gameThread->worker());
+		QMetaObject::invokeMethod(gameThread->initializer(), "adoptPlayer",
+					  Qt::QueuedConnection,
+					  Q_ARG(int, i),
+					  Q_ARG(QObject*, player));
+	}
 
 	gameThread->start();
 	return gameThread;
 }
 
+QThread* GameManager::getWorker()
+{
+	QThread* worker = 0;
+	foreach (QThread* tmp, m_workers)
+	{
+		if (worker == 0 || m_workerLoad.value(tmp) < m_workerLoad.value(worker))
+			worker = tmp;
+	}
+
+	// Start a new worker only if all the existing ones are busy
+	if ((worker == 0 || m_workerLoad.value(worker) > 0)
+	&&  m_workers.size() < m_workerCount)
+	{
+		worker = new QThread(this);
+		m_workers << worker;
+		m_workerLoad[worker] = 0;
+		worker->start();
+
+		int index = m_workers.size() - 1;
+		LoopProbe* probe = new LoopProbe(index, &m_clock);
+		probe->moveToThread(worker);
+		connect(probe, SIGNAL(probed(int, int)),
+			this, SLOT(onLoopProbed(int, int)),
+			Qt::QueuedConnection);
+		m_probes << probe;
+		while (m_stats.workerLoopLatency.size() <= index)
+			m_stats.workerLoopLatency << LatencyStats();
+
+		if (!m_probeTimer->isActive())
+		{
+			m_lastProbeTime = m_clock.elapsed();
+			m_probeTimer->start();
+		}
+	}
+
+	return worker;
+}
+
+void GameManager::stopWorkers()
+{
+	m_probeTimer->stop();
+	foreach (QThread* worker, m_workers)
+		worker->quit();
+	foreach (QThread* worker, m_workers)
+	{
+		worker->wait();
+		delete worker;
+	}
+	qDeleteAll(m_probes);
+	m_probes.clear();
+	m_workers.clear();
+	m_workerLoad.clear();
+
+	if (m_trace != 0)
+		m_trace->flush();
+}
+
+void GameManager::onProbeTimeout()
+{
+	// A late timer event is the latency of this thread's event loop
+	qint64 now = m_clock.elapsed();
+	int latency = qMax(int(now - m_lastProbeTime) - m_probeTimer->interval(), 0);
+	m_lastProbeTime = now;
+	m_stats.mainLoopLatency.addSample(latency);
+	trace(QString("loop main %1").arg(latency));
+
+	foreach (QObject* probe, m_probes)
+		QMetaObject::invokeMethod(probe, "probe",
+					  Qt::QueuedConnection,
+					  Q_ARG(qint64, now));
+}
+
+void GameManager::onLoopProbed(int worker, int msecs)
+{
+	m_stats.workerLoopLatency[worker].addSample(msecs);
+	trace(QString("loop %1 %2").arg(worker).arg(msecs));
+}
+
+void GameManager::onGameStarted(ChessGame* game)
+{
+	m_stats.gamesStarted++;
+	if (m_newGameTimes.contains(game))
+	{
+		int delay = int(m_clock.elapsed() - m_newGameTimes.take(game));
+		m_stats.startDelay.addSample(delay);
+		trace(QString("start %1").arg(delay));
+	}
+
+	emit gameStarted(game);
+}
+
+void GameManager::onMoveTimed(int moveTime, int reportedTime)
+{
+	// Players that don't report their search time, and moves that
+	// include pondering time, can't be used.
+	if (m_maxTimingOverhead <= 0
+	||  reportedTime <= 0
+	||  reportedTime > moveTime)
+		return;
+
+	m_overheadTotal += moveTime - reportedTime;
+	if (++m_overheadCount >= 32)
+		adjustConcurrency();
+}
+
+static bool isSystemBusy()
+{
+#ifdef Q_OS_UNIX
+	double load = 0.0;
+	if (getloadavg(&load, 1) == 1)
+		return load >= QThread::idealThreadCount();
+#endif // Q_OS_UNIX
+	return false;
+}
+
+void GameManager::adjustConcurrency()
+{
+	int overhead = int(m_overheadTotal / m_overheadCount);
+	m_overheadCount = 0;
+	m_overheadTotal = 0;
+
+	int limit = m_concurrencyLimit;
+	if (overhead > m_maxTimingOverhead)
+		limit = qMax(limit - 1, 1);
+	else if (overhead <= m_maxTimingOverhead / 2 && !isSystemBusy())
+		limit = qMin(limit + 1, m_concurrency);
+	if (limit == m_concurrencyLimit)
+		return;
+
+	emit debugMessage(QString("Concurrency limit changed to %1 "
+				  "(average timing overhead %2 ms)")
+			  .arg(limit).arg(overhead));
+
+	bool grew = (limit > m_concurrencyLimit);
+	m_concurrencyLimit = limit;
+	if (grew)
+		startQueuedGame();
+}
+
+int GameManager::takeCpuSlot()
+{
+	for (int i = 0; i < m_cpuPlacement.slotCount(); i++)
+	{
+		if (!m_usedCpuSlots.contains(i))
+		{
+			m_usedCpuSlots.insert(i);
+			return i;
+		}
+	}
+	return -1;
+}
+
 void GameManager::startGame(const GameEntry& entry)
 {
 	GameThread* gameThread = getThread(entry.white, entry.black);
@@ -534,11 +1289,93 @@ void GameManager::startGame(const GameEntry& entry)
 	gameThread->setStartMode(entry.startMode);
 	gameThread->setCleanupMode(entry.cleanupMode);
 	gameThread->newGame(entry.game);
+
+	if (entry.cleanupMode == ReusePlayers)
+	{
+		// Keep the builders in least recently used order: the
+		// builders that have waited the longest are the most
+		// likely to be needed next.
+		const PlayerBuilder* builders[2] = { entry.white, entry.black };
+		for (int i = 0; i < 2; i++)
+		{
+			m_warmupBuilders.removeOne(builders[i]);
+			m_warmupBuilders.append(builders[i]);
+		}
+		warmUpPlayers();
+	}
+}
+
+void GameManager::warmUpPlayers()
+{
+	if (m_warmupCount <= 0
+	||  m_finishing
+	||  m_cleaningUp
+	||  !m_cpuPlacement.isNull())
+		return;
+
+	foreach (const PlayerBuilder* builder, m_warmupBuilders)
+	{
+		if (m_idlePlayers.size() + m_warmingPlayerCount >= m_warmupCount)
+			break;
+		if (m_idlePlayers.contains(builder)
+		||  m_warmingPlayers.value(builder) > 0)
+			continue;
+
+		PlayerWarmer* warmer = new PlayerWarmer(builder, this);
+		connect(warmer, SIGNAL(playerCreated(QObject*)),
+			this, SLOT(onPlayerWarmedUp(QObject*)),
+			Qt::QueuedConnection);
+		warmer->moveToThread(getWorker());
+
+		m_warmingPlayers[builder]++;
+		m_warmingPlayerCount++;
+		QMetaObject::invokeMethod(warmer, "createPlayer",
+					  Qt::QueuedConnection);
+	}
+}
+
+void GameManager::onPlayerWarmedUp(QObject* object)
+{
+	PlayerWarmer* warmer = qobject_cast<PlayerWarmer*>(sender());
+	Q_ASSERT(warmer != 0);
+	const PlayerBuilder* builder = warmer->builder();
+	warmer->deleteLater();
+
+	m_warmingPlayers[builder]--;
+	m_warmingPlayerCount--;
+
+	ChessPlayer* player = qobject_cast<ChessPlayer*>(object);
+	if (player == 0)
+	{
+		// Don't keep restarting a player that can't be started
+		m_warmupBuilders.removeOne(builder);
+
+		if (m_cleaningUp
+		&&  m_threads.isEmpty()
+		&&  m_quittingPlayerCount <= 0
+		&&  m_warmingPlayerCount <= 0)
+		{
+			m_cleaningUp = false;
+			m_quitTimer->stop();
+			stopWorkers();
+			emit finished();
+		}
+		return;
+	}
+
+	if (m_finishing || m_cleaningUp)
+	{
+		quitPlayer(player);
+		return;
+	}
+
+	player->setParent(this);
+	m_idlePlayers.insert(builder, player);
 }
 
 void GameManager::startQueuedGame()
 {
-	if (m_activeQueuedGameCount >= m_concurrency)
+	if (m_activeQueuedGameCount >= m_concurrencyLimit)
 		return;
 	if (m_gameEntries.isEmpty())
 	{
@@ -546,7 +1383,44 @@ void GameManager::startQueuedGame()
 		return;
 	}
 
-	startGame(m_gameEntries.takeFirst());
+	// Weighted fair share: the owner with the fewest running games
+	// per unit of weight goes next, and ties go to the oldest entry
+	int index = 0;
+	const QObject* owner = m_gameEntries.first().owner;
+	int shares = m_queueShares.value(owner);
+	int weight = queueWeight(owner);
+	for (int i = 1; i < m_gameEntries.size(); i++)
+	{
+		const QObject* other = m_gameEntries.at(i).owner;
+		if (other == owner)
+			continue;
+
+		int otherShares = m_queueShares.value(other);
+		int otherWeight = queueWeight(other);
+		if (qint64(otherShares) * weight < qint64(shares) * otherWeight)
+		{
+			index = i;
+			owner = other;
+			shares = otherShares;
+			weight = otherWeight;
+		}
+	}
+
+	GameEntry entry(m_gameEntries.takeAt(index));
+	m_queueShares[entry.owner]++;
+	m_gameOwners[entry.game] = entry.owner;
+	startGame(entry);
+}
+
+void GameManager::releaseQueueShare(ChessGame* game)
+{
+	QHash<ChessGame*, const QObject*>::iterator it = m_gameOwners.find(game);
+	if (it == m_gameOwners.end())
+		return;
+
+	if (--m_queueShares[it.value()] <= 0)
+		m_queueShares.remove(it.value());
+	m_gameOwners.erase(it);
 }
 
 #include "gamemanager.moc"
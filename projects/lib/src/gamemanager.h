@@ -20,7 +20,17 @@
 
 #include <QObject>
 #include <QList>
+#include <QMultiMap>
+#include <QHash>
 #include <QPointer>
+#include <QSet>
+#include <QElapsedTimer>
+#include "cpuplacement.h"
+#include "latencystats.h"
+class QThread;
+class QTimer;
+class QFile;
+class QTextStream;
 class ChessGame;
 class ChessPlayer;
 class PlayerBuilder;
@@ -34,6 +44,10 @@ class GameThread;
  * multiple games concurrently, and queue games to be
  * run when a game slot/thread is free.
  *
+ * The games don't get an OS thread each. They share a pool of worker
+ * threads, one per CPU core, and each new game is placed on the worker
+ * that runs the fewest games.
+ *
  * \sa ChessGame, PlayerBuilder
  */
 class LIB_EXPORT GameManager : public QObject
@@ -68,8 +82,29 @@ class LIB_EXPORT GameManager : public QObject
 			ReusePlayers
 		};
 
+		/*! \brief Statistics of the game manager's activity. */
+		struct Statistics
+		{
+			/*! The number of games that have started. */
+			int gamesStarted;
+			/*! The number of game threads created. */
+			int threadsCreated;
+			/*! The number of game threads cleaned up. */
+			int threadsFinished;
+			/*! The length of the game queue after each new game. */
+			LatencyStats queueDepth;
+			/*! The time from newGame() to gameStarted() in ms. */
+			LatencyStats startDelay;
+			/*! The event loop latency of the manager's thread in ms. */
+			LatencyStats mainLoopLatency;
+			/*! The event loop latency of each worker thread in ms. */
+			QList<LatencyStats> workerLoopLatency;
+		};
+
 		/*! Creates a new game manager. */
 		GameManager(QObject* parent = 0);
+		/*! Destroys the game manager and stops its worker threads. */
+		virtual ~GameManager();
 
 		/*!
 		 * Returns the list of active games.
@@ -80,6 +115,13 @@ class LIB_EXPORT GameManager : public QObject
 		 * The game loses its active status only when it's deleted.
 		 */
 		QList<ChessGame*> activeGames() const;
+		/*! Returns the number of games waiting in the queue. */
+		int queuedGameCount() const;
+		/*!
+		 * Returns the number of game slots that a game queued now
+		 * could use right away.
+		 */
+		int freeSlotCount() const;
 
 		/*!
 		 * Returns the maximum allowed number of concurrent games.
@@ -97,6 +139,116 @@ class LIB_EXPORT GameManager : public QObject
 		 */
 		void setConcurrency(int concurrency);
 
+		/*!
+		 * Returns the timing overhead limit of adaptive concurrency
+		 * in milliseconds, or 0 if adaptive concurrency is disabled.
+		 *
+		 * \sa setMaxTimingOverhead()
+		 */
+		int maxTimingOverhead() const;
+		/*!
+		 * Enables adaptive concurrency with a timing overhead limit
+		 * of \a msecs milliseconds. 0 disables it (the default).
+		 *
+		 * The timing overhead of a move is the difference between
+		 * the move time charged to a player and the search time the
+		 * player reported. If the average overhead of recent moves
+		 * exceeds the limit, fewer queued games are run at the same
+		 * time. If the overhead stays under half the limit and the
+		 * system isn't overloaded, the number is raised again, up to
+		 * concurrency().
+		 */
+		void setMaxTimingOverhead(int msecs);
+
+		/*!
+		 * Returns the maximum number of idle players kept alive
+		 * per player builder.
+		 *
+		 * \sa setPlayerPoolSize()
+		 */
+		int playerPoolSize() const;
+		/*!
+		 * Sets the maximum number of idle players kept alive per
+		 * player builder to \a size.
+		 *
+		 * When an idle game thread is cleaned up, its players are
+		 * moved to a pool instead of being terminated, as long as
+		 * the pool has room for them. A new game that needs a player
+		 * from the same builder takes it from the pool instead of
+		 * starting a new engine process. This only applies to games
+		 * started in \a ReusePlayers mode. The default value is 0,
+		 * which disables the pool.
+		 */
+		void setPlayerPoolSize(int size);
+
+		/*!
+		 * Returns the number of players that are started ahead of
+		 * the games that need them.
+		 *
+		 * \sa setWarmupCount()
+		 */
+		int warmupCount() const;
+		/*!
+		 * Keeps up to \a count players started and initialized
+		 * ahead of the games that need them.
+		 *
+		 * The players are created in the worker threads while other
+		 * games are running, and they wait in the player pool until
+		 * a new game slot takes them. The players of the builders
+		 * that have been idle for the longest time are started first.
+		 * This only applies to games started in \a ReusePlayers
+		 * mode, and not with CPU placement. The default value is 0,
+		 * which disables the warm-up.
+		 */
+		void setWarmupCount(int count);
+
+		/*!
+		 * Returns the time limit for terminating all the players
+		 * when the manager finishes.
+		 *
+		 * \sa setQuitTimeout()
+		 */
+		int quitTimeout() const;
+		/*!
+		 * Sets the time limit for terminating all the players to
+		 * \a msecs milliseconds.
+		 *
+		 * When the manager cleans up, all the players are told to
+		 * quit at once, and the limit is shared by all of them. The
+		 * players that are still running when it expires are killed
+		 * together. The default value is 0, which leaves each
+		 * player to its own quit timeout.
+		 */
+		void setQuitTimeout(int msecs);
+
+		/*!
+		 * Returns the CPU placement policy for the players.
+		 *
+		 * \sa setCpuPlacement()
+		 */
+		CpuPlacement cpuPlacement() const;
+		/*!
+		 * Sets the CPU placement policy to \a placement.
+		 *
+		 * With a non-null placement each game slot gets its own
+		 * cores, and the players are restricted to them through
+		 * PlayerBuilder::createWithAffinity(). Games that start
+		 * when all the dedicated cores are in use run unrestricted.
+		 * The player pool is not used with CPU placement because
+		 * the pooled players are tied to their cores.
+		 */
+		void setCpuPlacement(const CpuPlacement& placement);
+
+		/*! Returns the statistics of the game manager's activity. */
+		Statistics statistics() const;
+		/*!
+		 * Writes a trace of the game manager's events to \a fileName,
+		 * one event per line, for offline analysis. Each line starts
+		 * with a timestamp in milliseconds. An empty \a fileName
+		 * disables the trace. Returns true if successful.
+		 */
+		bool setTraceFile(const QString& fileName);
+
 		/*!
 		 * Cleans up and deletes all idle game threads
 		 *
@@ -105,6 +257,9 @@ class LIB_EXPORT GameManager : public QObject
 		 * include the players and the thread they're living in. The
 		 * PlayerBuilder objects will not be deleted.
 		 *
+		 * If the player pool is enabled, the players may be kept
+		 * alive in the pool. They're terminated by finish().
+		 *
 		 * Generally this function should be called after a tournament
 		 * has ended.
 		 */
@@ -133,6 +288,10 @@ class LIB_EXPORT GameManager : public QObject
 		 * \a cleanupMode determines whether the players and their builder
 		 * objects are destroyed or reused after the game.
 		 *
+		 * \a owner is the object that queues the game, eg. a
+		 * tournament. When several owners queue games, the free game
+		 * slots are shared among them by their queue weights.
+		 *
 		 * If the game cannot be started because one or both of the players
 		 * can't be initialized, \a game will emit the startFailed() signal.
 		 *
@@ -143,12 +302,33 @@ class LIB_EXPORT GameManager : public QObject
 			     const PlayerBuilder* white,
 			     const PlayerBuilder* black,
 			     StartMode startMode = StartImmediately,
-			     CleanupMode cleanupMode = DeletePlayers);
+			     CleanupMode cleanupMode = DeletePlayers,
+			     const QObject* owner = 0);
+
+		/*!
+		 * Returns the queue weight of \a owner.
+		 *
+		 * \sa setQueueWeight()
+		 */
+		int queueWeight(const QObject* owner) const;
+		/*!
+		 * Sets the queue weight of \a owner to \a weight.
+		 *
+		 * The queued games of each owner get a share of the game
+		 * slots in proportion to its weight: the next free slot goes
+		 * to the owner that runs the fewest games per unit of weight,
+		 * and an owner's own games start in the order they were
+		 * queued. An owner with weight 9 gets about 90% of the slots
+		 * when it competes with an owner with weight 1, but the
+		 * latter isn't starved. The default weight is 1.
+		 */
+		void setQueueWeight(const QObject* owner, int weight);
 
 	public slots:
 		/*!
 		 * Removes all future games from the queue, waits for
-		 * ongoing games to end, and deletes all idle players.
+		 * ongoing games to end, and deletes all idle players,
+		 * including the players in the player pool.
 		 * Emits the finished() signal when done.
 		 */
 		void finish();
@@ -186,6 +366,15 @@ class LIB_EXPORT GameManager : public QObject
 		void onThreadReady();
 		void onThreadQuit();
 		void onGameInitialized(bool success);
+		void onPlayerQuit();
+		void onQuitDeadline();
+		void onThreadFinished();
+		void onMoveTimed(int moveTime, int reportedTime);
+		void onPlayerWarmedUp(QObject* object);
+		void onGameStarted(ChessGame* game);
+		void onProbeTimeout();
+		void onLoopProbed(int worker, int msecs);
+		void onOwnerDestroyed(QObject* owner);
 
 	private:
 		struct GameEntry
@@ -195,20 +384,63 @@ class LIB_EXPORT GameManager : public QObject
 			const PlayerBuilder* black;
 			StartMode startMode;
 			CleanupMode cleanupMode;
+			const QObject* owner;
 		};
 
 		GameThread* getThread(const PlayerBuilder* white,
 				      const PlayerBuilder* black);
 		void startGame(const GameEntry& entry);
 		void startQueuedGame();
+		void releaseQueueShare(ChessGame* game);
 		void cleanup();
+		void releasePlayers(GameThread* thread);
+		void quitPlayer(ChessPlayer* player);
+		QThread* getWorker();
+		void stopWorkers();
+		int takeCpuSlot();
+		void adjustConcurrency();
+		void warmUpPlayers();
+		void trace(const QString& event);
 
 		bool m_finishing;
+		bool m_cleaningUp;
 		int m_concurrency;
+		int m_concurrencyLimit;
+		int m_maxTimingOverhead;
+		int m_overheadCount;
+		qint64 m_overheadTotal;
 		int m_activeQueuedGameCount;
+		int m_playerPoolSize;
+		int m_quittingPlayerCount;
+		int m_quitTimeout;
+		qint64 m_quitDeadline;
+		int m_warmupCount;
+		int m_warmingPlayerCount;
+		int m_workerCount;
+		QMultiMap<const PlayerBuilder*, ChessPlayer*> m_idlePlayers;
+		QHash<const PlayerBuilder*, int> m_warmingPlayers;
+		QList<const PlayerBuilder*> m_warmupBuilders;
+		QList<QThread*> m_workers;
+		QHash<QThread*, int> m_workerLoad;
+		CpuPlacement m_cpuPlacement;
+		QSet<int> m_usedCpuSlots;
+		Statistics m_stats;
+		QElapsedTimer m_clock;
+		qint64 m_lastProbeTime;
+		QTimer* m_probeTimer;
+		QTimer* m_quitTimer;
+		QList< QPointer<ChessPlayer> > m_quittingPlayers;
+		QList<QObject*> m_probes;
+		QHash<ChessGame*, qint64> m_newGameTimes;
+		QFile* m_traceFile;
+		QTextStream* m_trace;
+
 		QList< QPointer<GameThread> > m_threads;
 		QList<GameThread*> m_activeThreads;
 		QList<GameEntry> m_gameEntries;
+		QHash<const QObject*, int> m_queueWeights;
+		QHash<const QObject*, int> m_queueShares;
+		QHash<ChessGame*, const QObject*> m_gameOwners;
 		QList<ChessGame*> m_activeGames;
 };
 
@@ -0,0 +1,59 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "gamesnapshot.h"
+#include <QMutexLocker>
+
+GameSnapshot::GameSnapshot()
+{
+	for (int i = 0; i < 2; i++)
+	{
+		timeLeft[i] = 0;
+		infiniteTime[i] = false;
+	}
+}
+
+
+GameSnapshotSlot::GameSnapshotSlot()
+	: m_serial(0)
+{
+}
+
+int GameSnapshotSlot::serial() const
+{
+	#if QT_VERSION >= 0x050000
+	return m_serial.loadAcquire();
+	#else
+	return m_serial;
+	#endif
+}
+
+GameSnapshot GameSnapshotSlot::snapshot() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_snapshot;
+}
+
+void GameSnapshotSlot::publish(const GameSnapshot& snapshot)
+{
+	// The strings are implicitly shared, so the copy made under the
+	// lock is cheap
+	QMutexLocker locker(&m_mutex);
+	m_snapshot = snapshot;
+	m_serial.fetchAndAddRelease(1);
+}
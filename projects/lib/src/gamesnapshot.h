@@ -0,0 +1,99 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GAMESNAPSHOT_H
+#define GAMESNAPSHOT_H
+
+#include <QString>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include "board/genericmove.h"
+#include "board/result.h"
+#include "board/side.h"
+
+/*!
+ * \brief The displayable state of a chess game at one point in time.
+ *
+ * \sa GameSnapshotSlot
+ */
+struct LIB_EXPORT GameSnapshot
+{
+	/*! Creates an empty snapshot. */
+	GameSnapshot();
+
+	/*! The chess variant. */
+	QString variant;
+	/*! The current position in FEN notation. */
+	QString fen;
+	/*! The latest move, or a null move. */
+	Chess::GenericMove lastMove;
+	/*! The names of the players. */
+	QString playerName[2];
+	/*!
+	 * The players' clock times in milliseconds, at the start of
+	 * their latest turn.
+	 */
+	int timeLeft[2];
+	/*! True for a player with infinite time. */
+	bool infiniteTime[2];
+	/*! The side that is thinking, or a null side. */
+	Chess::Side thinkingSide;
+	/*! Measures the thinking time of \a thinkingSide. */
+	QElapsedTimer thinkingTime;
+	/*! The result of the game, or a null result. */
+	Chess::Result result;
+};
+
+/*!
+ * \brief A shared slot for publishing snapshots of a running game.
+ *
+ * A ChessGame keeps a working copy of its snapshot in the game thread
+ * and publishes it to the slot after each change. Viewers poll the
+ * slot at their own pace, eg. from a display timer, instead of
+ * receiving a queued signal for every move and clock event. The
+ * serial number changes with every published snapshot, so a poller
+ * can skip unchanged games without locking.
+ *
+ * The slot is reference-counted with QSharedPointer, so a viewer
+ * can keep polling it after the game has been destroyed.
+ *
+ * All functions are thread-safe.
+ */
+class LIB_EXPORT GameSnapshotSlot
+{
+	public:
+		/*! Creates a new slot with an empty snapshot. */
+		GameSnapshotSlot();
+
+		/*! Returns the serial number of the latest snapshot. */
+		int serial() const;
+		/*! Returns the latest snapshot. */
+		GameSnapshot snapshot() const;
+		/*! Replaces the snapshot with \a snapshot. */
+		void publish(const GameSnapshot& snapshot);
+
+	private:
+		Q_DISABLE_COPY(GameSnapshotSlot)
+
+		mutable QMutex m_mutex;
+		GameSnapshot m_snapshot;
+		QAtomicInt m_serial;
+};
+
+#endif // GAMESNAPSHOT_H
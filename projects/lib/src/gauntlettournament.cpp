@@ -17,11 +17,18 @@
 
 
 #include "gauntlettournament.h"
+#include <limits>
+#include "sprt.h"
+
+// The minimum number of games against an opponent before its
+// confidence interval is trusted
+static const int s_minStopGames = 10;
 
 GauntletTournament::GauntletTournament(GameManager* gameManager,
 				       QObject *parent)
 	: Tournament(gameManager, parent),
-	  m_opponent(-1)
+	  m_opponent(-1),
+	  m_maxEloError(0.0)
 {
 }
 
@@ -30,9 +37,19 @@ QString GauntletTournament::type() const
 	return "gauntlet";
 }
 
+void GauntletTournament::setMaxEloError(double error)
+{
+	Q_ASSERT(error >= 0.0);
+	m_maxEloError = error;
+}
+
 void GauntletTournament::initializePairing()
 {
 	m_opponent = 1;
+	m_encounters.fill(0, playerCount());
+	m_wins.fill(0, playerCount());
+	m_losses.fill(0, playerCount());
+	m_draws.fill(0, playerCount());
 }
 
 int GauntletTournament::gamesPerCycle() const
@@ -40,8 +57,65 @@ int GauntletTournament::gamesPerCycle() const
 	return playerCount() - 1;
 }
 
+double GauntletTournament::eloError(int opponent) const
+{
+	const int games = m_wins.at(opponent) + m_losses.at(opponent)
+			+ m_draws.at(opponent);
+	double elo;
+	double error;
+	if (games < s_minStopGames
+	||  !Sprt::eloEstimate(m_wins.at(opponent), m_losses.at(opponent),
+			       m_draws.at(opponent), &elo, &error))
+		return std::numeric_limits<double>::infinity();
+
+	return error;
+}
+
 QPair<int, int> GauntletTournament::nextPair()
 {
+	if (m_maxEloError > 0.0)
+	{
+		// Play the regular cycle until an opponent's interval
+		// is narrow enough, and from then on give the games to
+		// the opponent with the widest interval. When all the
+		// intervals are narrow the widest one still gets them.
+		int opponent = -1;
+		double widest = 0.0;
+		bool stopped = false;
+		for (int i = 1; i < playerCount(); i++)
+		{
+			const double error = eloError(i);
+			if (error < m_maxEloError)
+				stopped = true;
+			if (opponent == -1 || error > widest
+			||  (error == widest && m_encounters.at(i) < m_encounters.at(opponent)))
+			{
+				opponent = i;
+				widest = error;
+			}
+		}
+		if (!stopped)
+		{
+			// Without any stopped opponents the pairings follow
+			// the usual order: the least played opponent first
+			opponent = 1;
+			for (int i = 2; i < playerCount(); i++)
+			{
+				if (m_encounters.at(i) < m_encounters.at(opponent))
+					opponent = i;
+			}
+		}
+
+		int white = 0;
+		int black = opponent;
+		if (m_encounters.at(opponent) % 2 == 1)
+			qSwap(white, black);
+
+		m_encounters[opponent]++;
+		setCurrentRound(qMax(currentRound(), m_encounters.at(opponent)));
+		return qMakePair(white, black);
+	}
+
 	if (m_opponent >= playerCount())
 	{
 		m_opponent = 1;
@@ -57,3 +131,46 @@ QPair<int, int> GauntletTournament::nextPair()
 
 	return qMakePair(white, black);
 }
+
+void GauntletTournament::addGameResult(int whiteIndex,
+				       int blackIndex,
+				       const Chess::Result& result)
+{
+	const int opponent = (whiteIndex == 0) ? blackIndex : whiteIndex;
+	const Chess::Side side = (whiteIndex == 0) ? Chess::Side::White
+						   : Chess::Side::Black;
+
+	if (result.winner() == side)
+		m_wins[opponent]++;
+	else if (!result.winner().isNull())
+		m_losses[opponent]++;
+	else if (result.isDraw())
+		m_draws[opponent]++;
+}
+
+QVariantMap GauntletTournament::pairingState() const
+{
+	QVariantMap state;
+	if (m_maxEloError <= 0.0)
+		return state;
+
+	state["encounters"] = toVariantList(m_encounters);
+	state["wins"] = toVariantList(m_wins);
+	state["losses"] = toVariantList(m_losses);
+	state["draws"] = toVariantList(m_draws);
+	return state;
+}
+
+bool GauntletTournament::setPairingState(const QVariantMap& state)
+{
+	return m_maxEloError > 0.0
+	    && fromVariantList(state.value("encounters"), m_encounters)
+	    && fromVariantList(state.value("wins"), m_wins)
+	    && fromVariantList(state.value("losses"), m_losses)
+	    && fromVariantList(state.value("draws"), m_draws);
+}
+
+bool GauntletTournament::hasFixedPairings() const
+{
+	return m_maxEloError <= 0.0;
+}
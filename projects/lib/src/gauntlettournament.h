@@ -25,6 +25,11 @@
  *
  * In a Gauntlet tournament the first participant plays
  * against all the others.
+ *
+ * With early stopping the tournament stops pairing an opponent
+ * once the ELO difference against it is known accurately enough,
+ * and gives its games to the opponents with the widest confidence
+ * intervals instead. The total number of games stays the same.
  */
 class LIB_EXPORT GauntletTournament : public Tournament
 {
@@ -37,14 +42,36 @@ class LIB_EXPORT GauntletTournament : public Tournament
 		// Inherited from Tournament
 		virtual QString type() const;
 
+		/*!
+		 * Enables early stopping of the opponents whose ELO
+		 * difference to the first player has a 95% confidence
+		 * interval narrower than +/- \a error points.
+		 *
+		 * A zero \a error disables early stopping (default).
+		 */
+		void setMaxEloError(double error);
+
 	protected:
 		// Inherited from Tournament
 		virtual void initializePairing();
 		virtual int gamesPerCycle() const;
 		virtual QPair<int, int> nextPair();
+		virtual void addGameResult(int whiteIndex,
+					   int blackIndex,
+					   const Chess::Result& result);
+		virtual QVariantMap pairingState() const;
+		virtual bool setPairingState(const QVariantMap& state);
+		virtual bool hasFixedPairings() const;
 
 	private:
+		double eloError(int opponent) const;
+
 		int m_opponent;
+		double m_maxEloError;
+		QVector<int> m_encounters;
+		QVector<int> m_wins;
+		QVector<int> m_losses;
+		QVector<int> m_draws;
 };
 
 #endif // GAUNTLETTOURNAMENT_H
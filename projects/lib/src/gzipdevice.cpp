@@ -0,0 +1,341 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gzipdevice.h"
+#include <cstring>
+#include "compression/zlib/zlib.h"
+#include "streambuffer.h"
+
+// The size of the compressed and uncompressed data buffers
+static const int s_bufferSize = 0x10000;
+
+GzipDevice::GzipDevice(QIODevice* device, QObject* parent)
+	: QIODevice(parent),
+	  m_device(device),
+	  m_stream(0),
+	  m_outIndex(0),
+	  m_pos(0),
+	  m_start(0),
+	  m_eof(false)
+{
+	Q_ASSERT(device != 0);
+}
+
+GzipDevice::~GzipDevice()
+{
+	close();
+}
+
+bool GzipDevice::isCompressed(QIODevice* device)
+{
+	if (device == 0 || !device->isOpen() || !device->isReadable())
+		return false;
+
+	// Wait for the start of streaming data, eg. a download
+	while (device->bytesAvailable() < 2
+	&&     StreamBuffer::waitForData(device))
+		;
+
+	const QByteArray magic(device->peek(2));
+	return magic.size() == 2
+		&& quint8(magic.at(0)) == 0x1F
+		&& quint8(magic.at(1)) == 0x8B;
+}
+
+QIODevice* GzipDevice::device() const
+{
+	return m_device;
+}
+
+bool GzipDevice::open(OpenMode mode)
+{
+	if (isOpen())
+		return false;
+
+	// The device can't be used for reading and writing at the same time
+	const bool reading = (mode & ReadOnly);
+	if (reading == bool(mode & WriteOnly))
+	{
+		setErrorString("Unsupported open mode");
+		return false;
+	}
+	if (!m_device->isOpen())
+	{
+		setErrorString("The underlying device is not open");
+		return false;
+	}
+
+	m_stream = new z_stream;
+	memset(m_stream, 0, sizeof(z_stream));
+
+	// Add 16 to the window size to write a gzip header, 32 to
+	// detect a gzip or zlib header automatically
+	int ret;
+	if (reading)
+	{
+		ret = inflateInit2(m_stream, 15 + 32);
+		m_in.resize(s_bufferSize);
+		m_out.clear();
+	}
+	else
+	{
+		ret = deflateInit2(m_stream, Z_DEFAULT_COMPRESSION,
+				   Z_DEFLATED, 15 + 16, 8,
+				   Z_DEFAULT_STRATEGY);
+		m_in.clear();
+		m_out.resize(s_bufferSize);
+	}
+	if (ret != Z_OK)
+	{
+		setErrorString("Can't initialize zlib");
+		delete m_stream;
+		m_stream = 0;
+		return false;
+	}
+
+	m_outIndex = 0;
+	m_pos = 0;
+	m_start = m_device->pos();
+	m_eof = false;
+
+	// All buffering is done here, so QIODevice only needs to keep
+	// the characters that are pushed back with ungetChar()
+	return QIODevice::open((mode & ~Text) | Unbuffered);
+}
+
+void GzipDevice::close()
+{
+	if (!isOpen())
+		return;
+
+	if (openMode() & WriteOnly)
+	{
+		m_stream->next_in = 0;
+		m_stream->avail_in = 0;
+		if (!deflateBuffer(Z_FINISH))
+			qWarning("Can't finish gzip stream: %s",
+				 qPrintable(errorString()));
+		deflateEnd(m_stream);
+	}
+	else
+		inflateEnd(m_stream);
+
+	delete m_stream;
+	m_stream = 0;
+	m_in.clear();
+	m_out.clear();
+	QIODevice::close();
+}
+
+bool GzipDevice::isSequential() const
+{
+	return !(openMode() & ReadOnly);
+}
+
+qint64 GzipDevice::size() const
+{
+	// The size is only known after the whole stream is decompressed
+	if ((openMode() & ReadOnly) && m_eof)
+		return m_pos + (m_out.size() - m_outIndex);
+	return 0;
+}
+
+qint64 GzipDevice::bytesAvailable() const
+{
+	if (!(openMode() & ReadOnly))
+		return 0;
+	return (m_out.size() - m_outIndex) + (m_pos - QIODevice::pos());
+}
+
+bool GzipDevice::atEnd() const
+{
+	if (!(openMode() & ReadOnly))
+		return true;
+	if (m_outIndex == m_out.size() && !m_eof)
+		const_cast<GzipDevice*>(this)->fillBuffer();
+	return m_eof && bytesAvailable() == 0;
+}
+
+bool GzipDevice::seek(qint64 pos)
+{
+	if (!(openMode() & ReadOnly))
+		return false;
+
+	// Characters pushed back with ungetChar() are kept by QIODevice.
+	// If the new position is inside them QIODevice just skips some.
+	qint64 pushedBack = m_pos - QIODevice::pos();
+	qint64 offset = pos - QIODevice::pos();
+	if (!QIODevice::seek(pos))
+		return false;
+	if (offset >= 0 && offset < pushedBack)
+		return true;
+
+	if (pos < m_pos - m_outIndex && !restart())
+		return false;
+
+	forever
+	{
+		qint64 bufferStart = m_pos - m_outIndex;
+		qint64 bufferEnd = bufferStart + m_out.size();
+		if (pos <= bufferEnd)
+		{
+			m_outIndex = int(pos - bufferStart);
+			m_pos = pos;
+			return true;
+		}
+
+		m_pos = bufferEnd;
+		m_outIndex = m_out.size();
+		if (!fillBuffer())
+			return false;
+	}
+}
+
+bool GzipDevice::restart()
+{
+	if (!m_device->seek(m_start))
+	{
+		setErrorString(m_device->errorString());
+		return false;
+	}
+
+	inflateReset(m_stream);
+	m_stream->next_in = 0;
+	m_stream->avail_in = 0;
+	m_out.clear();
+	m_outIndex = 0;
+	m_pos = 0;
+	m_eof = false;
+
+	return true;
+}
+
+bool GzipDevice::fillBuffer()
+{
+	m_out.resize(s_bufferSize);
+	m_outIndex = 0;
+	m_stream->next_out = reinterpret_cast<Bytef*>(m_out.data());
+	m_stream->avail_out = m_out.size();
+
+	while (m_stream->avail_out > 0 && !m_eof)
+	{
+		if (m_stream->avail_in == 0)
+		{
+			// A truncated stream, eg. from a crashed writer,
+			// simply ends where the data ends
+			qint64 n = m_device->read(m_in.data(), m_in.size());
+			if (n == 0 && StreamBuffer::waitForData(m_device))
+				continue;
+			if (n <= 0)
+			{
+				if (n < 0)
+					setErrorString(m_device->errorString());
+				m_eof = true;
+				break;
+			}
+			m_stream->next_in = reinterpret_cast<Bytef*>(m_in.data());
+			m_stream->avail_in = uInt(n);
+		}
+
+		int ret = inflate(m_stream, Z_NO_FLUSH);
+		if (ret == Z_STREAM_END)
+		{
+			// Another gzip member may follow
+			if (m_stream->avail_in == 0
+			&&  m_device->atEnd()
+			&&  !StreamBuffer::waitForData(m_device))
+				m_eof = true;
+			else
+				inflateReset(m_stream);
+		}
+		else if (ret != Z_OK && ret != Z_BUF_ERROR)
+		{
+			setErrorString(QString("Invalid gzip data: %1")
+				       .arg(m_stream->msg ? m_stream->msg : ""));
+			m_eof = true;
+		}
+	}
+
+	m_out.resize(m_out.size() - int(m_stream->avail_out));
+	return !m_out.isEmpty();
+}
+
+qint64 GzipDevice::readData(char* data, qint64 maxSize)
+{
+	qint64 n = 0;
+	while (n < maxSize)
+	{
+		if (m_outIndex == m_out.size() && !fillBuffer())
+			break;
+
+		int count = int(qMin(maxSize - n,
+				     qint64(m_out.size() - m_outIndex)));
+		memcpy(data + n, m_out.constData() + m_outIndex, count);
+		m_outIndex += count;
+		n += count;
+	}
+
+	m_pos += n;
+	return n;
+}
+
+bool GzipDevice::deflateBuffer(int flush)
+{
+	// deflate() leaves space in the output buffer only after it
+	// has consumed all the input and finished the flush
+	do
+	{
+		m_stream->next_out = reinterpret_cast<Bytef*>(m_out.data());
+		m_stream->avail_out = m_out.size();
+		if (deflate(m_stream, flush) == Z_STREAM_ERROR)
+		{
+			setErrorString("Can't compress data");
+			return false;
+		}
+
+		qint64 count = m_out.size() - m_stream->avail_out;
+		if (count > 0 && m_device->write(m_out.constData(), count) != count)
+		{
+			setErrorString(m_device->errorString());
+			return false;
+		}
+	}
+	while (m_stream->avail_out == 0);
+
+	return true;
+}
+
+qint64 GzipDevice::writeData(const char* data, qint64 maxSize)
+{
+	m_stream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+	m_stream->avail_in = uInt(maxSize);
+	if (!deflateBuffer(Z_NO_FLUSH))
+		return -1;
+
+	m_pos += maxSize;
+	return maxSize;
+}
+
+bool GzipDevice::flush()
+{
+	if (!(openMode() & WriteOnly))
+		return true;
+
+	m_stream->next_in = 0;
+	m_stream->avail_in = 0;
+	return deflateBuffer(Z_SYNC_FLUSH);
+}
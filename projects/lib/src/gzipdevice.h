@@ -0,0 +1,99 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GZIPDEVICE_H
+#define GZIPDEVICE_H
+
+#include <QIODevice>
+#include <QByteArray>
+struct z_stream_s;
+
+/*!
+ * \brief A QIODevice that compresses or decompresses gzip data.
+ *
+ * GzipDevice operates on another device which contains the compressed
+ * data. In ReadOnly mode the data is decompressed as it is read, and
+ * files made of several concatenated gzip members are read as one
+ * stream. In WriteOnly mode the data is compressed as it is written,
+ * and the gzip member is finished when the device is closed.
+ *
+ * In ReadOnly mode the device supports seeking. Seeking forward skips
+ * decompressed data and seeking backward restarts decompression from
+ * the beginning, so random access is slow.
+ *
+ * If the underlying device is sequential, eg. a network download,
+ * the decompression waits for more data as it arrives.
+ *
+ * GzipDevice doesn't take ownership of the underlying device.
+ */
+class LIB_EXPORT GzipDevice : public QIODevice
+{
+	Q_OBJECT
+
+	public:
+		/*! Creates a new GzipDevice that operates on \a device. */
+		explicit GzipDevice(QIODevice* device, QObject* parent = 0);
+		/*! Closes and destroys the device. */
+		virtual ~GzipDevice();
+
+		/*!
+		 * Returns true if \a device is open and its next bytes
+		 * are the start of gzip data.
+		 */
+		static bool isCompressed(QIODevice* device);
+
+		/*! Returns the underlying device. */
+		QIODevice* device() const;
+		/*!
+		 * Writes all the pending compressed data to the underlying
+		 * device so that everything written so far can be
+		 * decompressed. Flushing too often hurts compression.
+		 *
+		 * Returns true if successfull.
+		 */
+		bool flush();
+
+		// Inherited from QIODevice
+		virtual bool open(OpenMode mode);
+		virtual void close();
+		virtual bool isSequential() const;
+		virtual qint64 size() const;
+		virtual qint64 bytesAvailable() const;
+		virtual bool atEnd() const;
+		virtual bool seek(qint64 pos);
+
+	protected:
+		// Inherited from QIODevice
+		virtual qint64 readData(char* data, qint64 maxSize);
+		virtual qint64 writeData(const char* data, qint64 maxSize);
+
+	private:
+		bool fillBuffer();
+		bool restart();
+		bool deflateBuffer(int flush);
+
+		QIODevice* m_device;
+		z_stream_s* m_stream;
+		QByteArray m_in;
+		QByteArray m_out;
+		int m_outIndex;
+		qint64 m_pos;
+		qint64 m_start;
+		bool m_eof;
+};
+
+#endif // GZIPDEVICE_H
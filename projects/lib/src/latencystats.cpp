@@ -0,0 +1,94 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "latencystats.h"
+
+LatencyStats::LatencyStats()
+	: m_count(0),
+	  m_total(0),
+	  m_maximum(-1)
+{
+	for (int i = 0; i < BucketCount; i++)
+		m_buckets[i] = 0;
+}
+
+bool LatencyStats::isEmpty() const
+{
+	return m_count == 0;
+}
+
+int LatencyStats::count() const
+{
+	return m_count;
+}
+
+qint64 LatencyStats::total() const
+{
+	return m_total;
+}
+
+int LatencyStats::average() const
+{
+	if (m_count == 0)
+		return -1;
+	return int(m_total / m_count);
+}
+
+int LatencyStats::maximum() const
+{
+	return m_maximum;
+}
+
+int LatencyStats::percentile(int percent) const
+{
+	if (m_count == 0)
+		return -1;
+
+	// Bucket 0 holds the samples under 1 ms, and bucket N the
+	// samples from 2^(N-1) to 2^N - 1 ms.
+	qint64 rank = (qint64(m_count) * qBound(0, percent, 100) + 99) / 100;
+	int sum = 0;
+	for (int i = 0; i < BucketCount - 1; i++)
+	{
+		sum += m_buckets[i];
+		if (sum >= rank)
+			return qMin((1 << i) - 1, m_maximum);
+	}
+	return m_maximum;
+}
+
+void LatencyStats::addSample(int msecs)
+{
+	m_count++;
+	m_total += msecs;
+	m_maximum = qMax(m_maximum, msecs);
+
+	int bucket = 0;
+	while (bucket < BucketCount - 1 && msecs >= (1 << bucket))
+		bucket++;
+	m_buckets[bucket]++;
+}
+
+void LatencyStats::merge(const LatencyStats& other)
+{
+	m_count += other.m_count;
+	m_total += other.m_total;
+	m_maximum = qMax(m_maximum, other.m_maximum);
+	for (int i = 0; i < BucketCount; i++)
+		m_buckets[i] += other.m_buckets[i];
+}
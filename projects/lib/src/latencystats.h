@@ -0,0 +1,77 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef LATENCYSTATS_H
+#define LATENCYSTATS_H
+
+#include <QtGlobal>
+
+/*!
+ * \brief Running statistics of a series of latency samples.
+ *
+ * LatencyStats keeps the count, sum and maximum of time samples (in
+ * milliseconds) so that they can be cheaply accumulated and merged.
+ * ChessEngine uses it to measure ping round trips and the delay before
+ * an engine starts responding to a "go" command.
+ *
+ * The samples are also counted in a histogram of power-of-two
+ * buckets, which gives approximate percentiles.
+ */
+class LIB_EXPORT LatencyStats
+{
+	public:
+		/*! Creates a new empty LatencyStats object. */
+		LatencyStats();
+
+		/*! Returns true if there are no samples. */
+		bool isEmpty() const;
+		/*! Returns the number of samples. */
+		int count() const;
+		/*! Returns the sum of all samples. */
+		qint64 total() const;
+		/*!
+		 * Returns the average of the samples, or -1 if there are
+		 * no samples.
+		 */
+		int average() const;
+		/*! Returns the largest sample, or -1 if there are no samples. */
+		int maximum() const;
+		/*!
+		 * Returns an upper bound for the \a percent percentile of
+		 * the samples, or -1 if there are no samples.
+		 *
+		 * The bound is the top of the histogram bucket that holds
+		 * the percentile, so it's at most twice the exact value.
+		 */
+		int percentile(int percent) const;
+
+		/*! Adds a new sample of \a msecs milliseconds. */
+		void addSample(int msecs);
+		/*! Merges the samples of \a other into these statistics. */
+		void merge(const LatencyStats& other);
+
+	private:
+		enum { BucketCount = 18 };
+
+		int m_count;
+		qint64 m_total;
+		int m_maximum;
+		int m_buckets[BucketCount];
+};
+
+#endif // LATENCYSTATS_H
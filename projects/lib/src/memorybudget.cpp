@@ -0,0 +1,152 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "memorybudget.h"
+#include <QString>
+#include <QStringList>
+#ifdef Q_OS_LINUX
+#include <QFile>
+#endif
+#ifdef Q_OS_WIN32
+#include <windows.h>
+#endif
+#include "engineconfiguration.h"
+#include "engineoption.h"
+
+
+MemoryBudget::MemoryBudget(int size, Policy policy)
+	: m_size(size),
+	  m_policy(policy)
+{
+}
+
+int MemoryBudget::size() const
+{
+	if (m_size > 0)
+		return m_size;
+	return int(availableMemory() * 9 / 10);
+}
+
+int MemoryBudget::plan(const QList<EngineConfiguration*>& configs,
+		       int concurrency) const
+{
+	Q_ASSERT(concurrency > 0);
+
+	int budget = size();
+	qint64 required = requiredMemory(configs, concurrency);
+	if (budget <= 0 || required <= budget)
+		return concurrency;
+
+	if (m_policy == CapConcurrency)
+	{
+		qint64 perGame = requiredMemory(configs, 1);
+		return qMax(1, int(budget / perGame));
+	}
+
+	// Every table gets the same share of its requested size, so
+	// the engines keep their relative sizes
+	double factor = double(budget) / required;
+	foreach (EngineConfiguration* config, configs)
+	{
+		int hash = hashSize(*config);
+		if (hash > 0)
+			setHashSize(config, qMax(1, int(hash * factor)));
+	}
+
+	return concurrency;
+}
+
+qint64 MemoryBudget::requiredMemory(const QList<EngineConfiguration*>& configs,
+				    int concurrency)
+{
+	int largest[2] = { 0, 0 };
+	foreach (const EngineConfiguration* config, configs)
+	{
+		int hash = hashSize(*config);
+		if (hash > largest[0])
+		{
+			largest[1] = largest[0];
+			largest[0] = hash;
+		}
+		else if (hash > largest[1])
+			largest[1] = hash;
+	}
+
+	return qint64(largest[0] + largest[1]) * concurrency;
+}
+
+qint64 MemoryBudget::availableMemory()
+{
+#if defined(Q_OS_LINUX)
+	QFile file("/proc/meminfo");
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		return 0;
+
+	// Eg. "MemAvailable:   16277196 kB"
+	forever
+	{
+		QByteArray line(file.readLine());
+		if (line.isEmpty())
+			break;
+		if (!line.startsWith("MemAvailable:"))
+			continue;
+
+		QStringList fields(QString::fromLatin1(line).split(' ',
+			QString::SkipEmptyParts));
+		if (fields.size() < 2)
+			break;
+		return fields.at(1).toLongLong() / 1024;
+	}
+	return 0;
+#elif defined(Q_OS_WIN32)
+	MEMORYSTATUSEX status;
+	status.dwLength = sizeof(status);
+	if (!GlobalMemoryStatusEx(&status))
+		return 0;
+	return qint64(status.ullAvailPhys / (1024 * 1024));
+#else
+	return 0;
+#endif
+}
+
+bool MemoryBudget::isHashOption(const QString& name)
+{
+	return name.compare("Hash", Qt::CaseInsensitive) == 0
+	    || name == "memory";
+}
+
+int MemoryBudget::hashSize(const EngineConfiguration& config)
+{
+	foreach (const EngineOption* option, config.options())
+	{
+		if (isHashOption(option->name()))
+			return qMax(0, option->value().toInt());
+	}
+
+	return 0;
+}
+
+void MemoryBudget::setHashSize(EngineConfiguration* config, int size)
+{
+	Q_ASSERT(config != 0);
+
+	foreach (const EngineOption* option, config->options())
+	{
+		if (isHashOption(option->name()))
+			config->setOption(option->name(), QString::number(size));
+	}
+}
@@ -0,0 +1,102 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include <QList>
+class QString;
+class EngineConfiguration;
+
+/*!
+ * \brief Fits the engines' hash tables of concurrent games into memory.
+ *
+ * MemoryBudget reads the hash table sizes of the engines from their
+ * "Hash" (UCI) and "memory" (Xboard) options, in megabytes. The peak
+ * memory use is estimated as the concurrency times the two largest
+ * hash tables, because any game may pair the two hungriest engines.
+ *
+ * If the estimate exceeds the budget, plan() either lowers the
+ * concurrency or scales down the hash tables.
+ *
+ * The available memory is read from /proc/meminfo on Linux and from
+ * the system on Windows. On other systems it's unknown.
+ */
+class LIB_EXPORT MemoryBudget
+{
+	public:
+		/*! The way to fit the engines into the budget. */
+		enum Policy
+		{
+			CapConcurrency,	//!< Play fewer games at a time
+			ScaleHash	//!< Give the engines smaller hash tables
+		};
+
+		/*!
+		 * Creates a new budget of \a size megabytes.
+		 *
+		 * A \a size of 0 uses 90% of the available memory.
+		 */
+		MemoryBudget(int size = 0, Policy policy = CapConcurrency);
+
+		/*!
+		 * Returns the size of the budget in megabytes, or 0 if
+		 * the budget is based on the available memory and it's
+		 * unknown.
+		 */
+		int size() const;
+
+		/*!
+		 * Returns the concurrency that fits the engines in
+		 * \a configs into the budget when \a concurrency games
+		 * are requested.
+		 *
+		 * With the \a ScaleHash policy the hash options in
+		 * \a configs are scaled down instead, and \a concurrency
+		 * is returned. The hash tables are never smaller than
+		 * 1 MB, so they may still not fit.
+		 */
+		int plan(const QList<EngineConfiguration*>& configs,
+			 int concurrency) const;
+
+		/*!
+		 * Returns the estimated memory use in megabytes of the
+		 * hash tables of \a configs in \a concurrency games.
+		 */
+		static qint64 requiredMemory(const QList<EngineConfiguration*>& configs,
+					     int concurrency);
+		/*!
+		 * Returns the memory available to new processes in
+		 * megabytes, or 0 if it's unknown.
+		 */
+		static qint64 availableMemory();
+		/*! Returns true if option \a name sets a hash table size. */
+		static bool isHashOption(const QString& name);
+		/*!
+		 * Returns the hash table size of \a config in megabytes,
+		 * or 0 if it doesn't set one.
+		 */
+		static int hashSize(const EngineConfiguration& config);
+		/*! Sets the hash table size of \a config to \a size megabytes. */
+		static void setHashSize(EngineConfiguration* config, int size);
+
+	private:
+		int m_size;
+		Policy m_policy;
+};
+
+#endif // MEMORYBUDGET_H
@@ -20,6 +20,7 @@
 
 static int s_index = 0;
 static quint32 s_mt[624];
+static QMutex s_mutex;
 
 static void generateNumbers()
 {
@@ -43,8 +44,7 @@ void Mersenne::initialize(int seed)
 
 quint32 Mersenne::random()
 {
-	static QMutex mutex;
-	mutex.lock();
+	s_mutex.lock();
 
 	if (s_index == 0)
 		generateNumbers();
@@ -56,7 +56,47 @@ quint32 Mersenne::random()
 	y ^= y >> 18;
 
 	s_index = (s_index + 1) % 624;
-	mutex.unlock();
+	s_mutex.unlock();
 
 	return y;
 }
+
+QByteArray Mersenne::state()
+{
+	QMutexLocker locker(&s_mutex);
+
+	// The index followed by the state vector, in little endian
+	QByteArray data;
+	data.reserve(625 * 4);
+	for (int i = -1; i < 624; i++)
+	{
+		quint32 value = (i < 0) ? quint32(s_index) : s_mt[i];
+		for (int j = 0; j < 4; j++)
+			data.append(char((value >> (j * 8)) & 0xFF));
+	}
+
+	return data;
+}
+
+bool Mersenne::setState(const QByteArray& state)
+{
+	if (state.size() != 625 * 4)
+		return false;
+
+	quint32 values[625];
+	for (int i = 0; i < 625; i++)
+	{
+		values[i] = 0;
+		for (int j = 0; j < 4; j++)
+			values[i] |= quint32(quint8(state.at(i * 4 + j))) << (j * 8);
+	}
+	if (values[0] >= 624)
+		return false;
+
+	QMutexLocker locker(&s_mutex);
+	s_index = int(values[0]);
+	for (int i = 0; i < 624; i++)
+		s_mt[i] = values[i + 1];
+
+	return true;
+}
@@ -19,6 +19,7 @@
 #define MERSENNE_H
 
 #include <QtGlobal>
+#include <QByteArray>
 
 /*!
  * \brief A "Mersenne Twister" pseudorandom number generator
@@ -40,6 +41,22 @@ class LIB_EXPORT Mersenne
 		 */
 		static quint32 random();
 
+		/*!
+		 * Returns the full state of the PRNG.
+		 *
+		 * The state can be restored with setState() to continue
+		 * the same sequence of numbers, eg. when resuming an
+		 * interrupted tournament.
+		 */
+		static QByteArray state();
+		/*!
+		 * Restores the PRNG to \a state.
+		 *
+		 * Returns false if \a state is not a valid state returned
+		 * by state().
+		 */
+		static bool setState(const QByteArray& state);
+
 	private:
 		Mersenne();
 };
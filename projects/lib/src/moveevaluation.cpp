@@ -17,12 +17,47 @@
 
 #include "moveevaluation.h"
 
+/*
+ * A packed move has the files and ranks of the source and target
+ * squares in five bits each, followed by the promotion piece's
+ * symbol. For drops the source square is empty and the symbol is
+ * the dropped piece's.
+ */
+static const int s_squareBits = 5;
+static const quint32 s_squareMask = (1 << s_squareBits) - 1;
+static const int s_symbolShift = 4 * s_squareBits;
+static const quint32 s_dropFlag = 1U << 31;
+
+// Parses a square like "e4" or "a10" at \a pos of \a str
+static bool parseSquare(const QStringRef& str, int* pos, quint32* packed)
+{
+	int i = *pos;
+	if (i >= str.size())
+		return false;
+
+	int file = str.at(i++).unicode() - 'a';
+	if (file < 0 || file > 25)
+		return false;
+
+	int rank = 0;
+	for (; i < str.size() && str.at(i).isDigit() && rank <= 31; i++)
+		rank = rank * 10 + str.at(i).digitValue();
+	if (rank < 1 || rank > 31)
+		return false;
+
+	*packed = (*packed << (2 * s_squareBits)) | (file << s_squareBits) | rank;
+	*pos = i;
+	return true;
+}
+
 MoveEvaluation::MoveEvaluation()
 	: m_isBookEval(false),
 	  m_depth(0),
 	  m_score(0),
 	  m_time(0),
-	  m_nodeCount(0)
+	  m_nodeCount(0),
+	  m_hashUsage(0),
+	  m_tbHits(0)
 {
 }
 
@@ -51,6 +86,11 @@ int MoveEvaluation::score() const
 	return m_score;
 }
 
+bool MoveEvaluation::isMateScore() const
+{
+	return m_depth > 0 && qAbs(m_score) >= 29000;
+}
+
 int MoveEvaluation::time() const
 {
 	return m_time;
@@ -61,9 +101,30 @@ quint64 MoveEvaluation::nodeCount() const
 	return m_nodeCount;
 }
 
+int MoveEvaluation::hashUsage() const
+{
+	return m_hashUsage;
+}
+
+quint64 MoveEvaluation::tbHits() const
+{
+	return m_tbHits;
+}
+
 QString MoveEvaluation::pv() const
 {
-	return m_pv;
+	if (m_pvMoves.isEmpty())
+		return m_pv;
+
+	QString str;
+	str.reserve(m_pvMoves.size() * 6);
+	for (int i = 0; i < m_pvMoves.size(); i++)
+	{
+		if (i > 0)
+			str += QLatin1Char(' ');
+		appendMove(str, m_pvMoves.at(i));
+	}
+	return str;
 }
 
 void MoveEvaluation::clear()
@@ -73,7 +134,10 @@ void MoveEvaluation::clear()
 	m_score = 0;
 	m_time = 0;
 	m_nodeCount = 0;
+	m_hashUsage = 0;
+	m_tbHits = 0;
 	m_pv.clear();
+	m_pvMoves.clear();
 }
 
 void MoveEvaluation::setBookEval(bool isBookEval)
@@ -101,7 +165,88 @@ void MoveEvaluation::setNodeCount(quint64 nodeCount)
 	m_nodeCount = nodeCount;
 }
 
+void MoveEvaluation::setHashUsage(int permille)
+{
+	m_hashUsage = permille;
+}
+
+void MoveEvaluation::setTbHits(quint64 tbHits)
+{
+	m_tbHits = tbHits;
+}
+
 void MoveEvaluation::setPv(const QString& pv)
 {
 	m_pv = pv;
+	m_pvMoves.clear();
+}
+
+void MoveEvaluation::setPv(const QVarLengthArray<QStringRef>& moves)
+{
+	// The old buffer is reused if it's no longer shared
+	m_pvMoves.resize(moves.size());
+	for (int i = 0; i < moves.size(); i++)
+	{
+		if (!packMove(moves[i], m_pvMoves.data() + i))
+		{
+			const QStringRef& last = moves[moves.size() - 1];
+			int start = moves[0].position();
+			int end = last.position() + last.size();
+			setPv(last.string()->mid(start, end - start));
+			return;
+		}
+	}
+	m_pv.clear();
+}
+
+bool MoveEvaluation::packMove(const QStringRef& move, quint32* packed)
+{
+	*packed = 0;
+	int pos = 0;
+	quint32 symbol = 0;
+
+	if (move.size() > 2 && move.at(1) == QLatin1Char('@'))
+	{
+		symbol = move.at(0).unicode();
+		pos = 2;
+		if (!parseSquare(move, &pos, packed))
+			return false;
+		*packed |= s_dropFlag;
+	}
+	else
+	{
+		if (!parseSquare(move, &pos, packed)
+		||  !parseSquare(move, &pos, packed))
+			return false;
+		if (pos < move.size())
+			symbol = move.at(pos++).unicode();
+	}
+
+	if (pos != move.size() || symbol > 0x7f)
+		return false;
+	*packed |= symbol << s_symbolShift;
+	return true;
+}
+
+void MoveEvaluation::appendMove(QString& str, quint32 packed)
+{
+	char symbol = char((packed >> s_symbolShift) & 0x7f);
+	int squares = (packed & s_dropFlag) ? 1 : 2;
+
+	if (packed & s_dropFlag)
+	{
+		str += QLatin1Char(symbol);
+		str += QLatin1Char('@');
+	}
+	for (int i = squares - 1; i >= 0; i--)
+	{
+		quint32 square = packed >> (i * 2 * s_squareBits);
+		str += QLatin1Char(char('a' + ((square >> s_squareBits) & s_squareMask)));
+		int rank = square & s_squareMask;
+		if (rank >= 10)
+			str += QLatin1Char(char('0' + rank / 10));
+		str += QLatin1Char(char('0' + rank % 10));
+	}
+	if (symbol != 0 && !(packed & s_dropFlag))
+		str += QLatin1Char(symbol);
 }
@@ -19,6 +19,8 @@
 #define MOVEEVALUATION_H
 
 #include <QString>
+#include <QVector>
+#include <QVarLengthArray>
 
 /*!
  * \brief Evaluation data for a chess move.
@@ -29,6 +31,9 @@
  * could be saved in a PGN file or displayed on the screen.
  *
  * From human players we can only get the move time.
+ *
+ * Principal variations in coordinate notation are stored as packed
+ * moves, which are formatted to text only when pv() is called.
  */
 class LIB_EXPORT MoveEvaluation
 {
@@ -54,6 +59,16 @@ class LIB_EXPORT MoveEvaluation
 		 */
 		int score() const;
 
+		/*!
+		 * Returns true if the score is a mate score, ie. the engine
+		 * reported a forced mate for either side.
+		 *
+		 * UCI mate scores are stored as 30000 minus the distance to
+		 * mate in plies. Xboard engines use scores of similar or
+		 * larger magnitude for mates.
+		 */
+		bool isMateScore() const;
+
 		/*! Move time in milliseconds. */
 		int time() const;
 
@@ -63,6 +78,18 @@ class LIB_EXPORT MoveEvaluation
 		 */
 		quint64 nodeCount() const;
 
+		/*!
+		 * How full the engine's hash table is in permille.
+		 * \note This is 0 if the engine didn't report it.
+		 */
+		int hashUsage() const;
+
+		/*!
+		 * How many positions were found in endgame tablebases?
+		 * \note This is 0 if the engine didn't report it.
+		 */
+		quint64 tbHits() const;
+
 		/*!
 		 * The principal variation.
 		 * This is a sequence of moves that an engine
@@ -90,16 +117,36 @@ class LIB_EXPORT MoveEvaluation
 		/*! Sets the node count to \a nodeCount. */
 		void setNodeCount(quint64 nodeCount);
 
+		/*! Sets the hash table usage to \a permille. */
+		void setHashUsage(int permille);
+
+		/*! Sets the tablebase hit count to \a tbHits. */
+		void setTbHits(quint64 tbHits);
+
 		/*! Sets the principal variation to \a pv. */
 		void setPv(const QString& pv);
+		/*!
+		 * Sets the principal variation to \a moves.
+		 *
+		 * Moves in coordinate notation (eg. "e2e4", "e7e8q" or
+		 * "P@e4") are packed. If any of the moves is in another
+		 * notation, the line is stored as text.
+		 */
+		void setPv(const QVarLengthArray<QStringRef>& moves);
 
 	private:
+		static bool packMove(const QStringRef& move, quint32* packed);
+		static void appendMove(QString& str, quint32 packed);
+
 		bool m_isBookEval;
 		int m_depth;
 		int m_score;
 		int m_time;
 		quint64 m_nodeCount;
+		int m_hashUsage;
+		quint64 m_tbHits;
 		QString m_pv;
+		QVector<quint32> m_pvMoves;
 };
 
 #endif // MOVEEVALUATION_H
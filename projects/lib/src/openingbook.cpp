@@ -19,9 +19,22 @@
 #include <QString>
 #include <QFile>
 #include <QDataStream>
+#include <climits>
 #include "pgngame.h"
 #include "pgnstream.h"
 #include "mersenne.h"
+#include "randomgenerator.h"
+
+// The number of unsorted entries that are collected before they are
+// merged into the sorted entries
+static const int s_minPendingCount = 1 << 20;
+
+static quint32 randomNumber(RandomGenerator* random)
+{
+	if (random != 0)
+		return random->random();
+	return Mersenne::random();
+}
 
 
 QDataStream& operator>>(QDataStream& in, OpeningBook* book)
@@ -34,24 +47,79 @@ QDataStream& operator>>(QDataStream& in, OpeningBook* book)
 
 QDataStream& operator<<(QDataStream& out, const OpeningBook* book)
 {
-	OpeningBook::Map::const_iterator it;
-	for (it = book->m_map.constBegin(); it != book->m_map.constEnd(); ++it)
-		book->writeEntry(it, out);
+	book->compact();
+	foreach (const OpeningBook::Record& record, book->m_records)
+	{
+		OpeningBook::Entry entry =
+			{ record.move, quint16(qMin(record.weight, quint32(0xffff))) };
+		book->writeEntry(record.key, entry, out);
+	}
 
 	return out;
 }
 
+OpeningBook::OpeningBook(AccessMode mode)
+	: m_mode(mode),
+	  m_file(0),
+	  m_data(0),
+	  m_entryCount(0)
+{
+}
+
+OpeningBook::~OpeningBook()
+{
+	unmap();
+}
+
+void OpeningBook::unmap()
+{
+	// Closing the file releases the mapping
+	delete m_file;
+	m_file = 0;
+	m_data = 0;
+	m_entryCount = 0;
+}
+
 bool OpeningBook::read(const QString& filename)
 {
-	QFile file(filename);
-	if (!file.open(QIODevice::ReadOnly))
+	unmap();
+	m_records.clear();
+	m_pending.clear();
+	m_cumWeights.clear();
+
+	QFile* file = new QFile(filename);
+	if (!file->open(QIODevice::ReadOnly))
+	{
+		delete file;
 		return false;
+	}
+
+	int size = entrySize();
+	if (m_mode == Disk && size > 0)
+	{
+		qint64 fileSize = file->size();
+		uchar* data = 0;
+		if (fileSize > 0 && fileSize % size == 0
+		&&  fileSize / size <= INT_MAX)
+			data = file->map(0, fileSize);
 
-	m_map.clear();
-	QDataStream in(&file);
+		if (data != 0)
+		{
+			m_file = file;
+			m_data = data;
+			m_entryCount = int(fileSize / size);
+			return true;
+		}
+	}
+
+	QDataStream in(file);
 	in >> this;
+	delete file;
 
-	return !m_map.isEmpty();
+	// Shared books must not change in move(), so the entries are
+	// sorted right away.
+	compact();
+	return !m_records.isEmpty();
 }
 
 bool OpeningBook::write(const QString& filename) const
@@ -66,21 +134,80 @@ bool OpeningBook::write(const QString& filename) const
 	return true;
 }
 
+bool OpeningBook::recordLessThan(const Record& a, const Record& b)
+{
+	return a.key < b.key;
+}
+
 void OpeningBook::addEntry(const Entry& entry, quint64 key)
 {
-	Map::iterator it = m_map.find(key);
-	while (it != m_map.end() && it.key() == key)
+	Record record = { key, entry.move, entry.weight };
+	m_pending.append(record);
+
+	// Merging costs as much as the sorted entries, so the batches
+	// grow with them.
+	if (m_pending.size() >= qMax(s_minPendingCount, m_records.size()))
+		compact();
+}
+
+void OpeningBook::compact() const
+{
+	if (m_pending.isEmpty())
+		return;
+
+	qSort(m_pending.begin(), m_pending.end(), recordLessThan);
+
+	QVector<Record> records;
+	records.reserve(m_records.size() + m_pending.size());
+
+	// Merge the sorted arrays, and add up the weights of the
+	// entries with the same key and move. A position has only a
+	// few moves, so the moves of a key are compared linearly.
+	int i = 0;
+	int j = 0;
+	int keyStart = 0;
+	while (i < m_records.size() || j < m_pending.size())
 	{
-		Entry& tmp = it.value();
-		if (tmp.move == entry.move)
+		const Record* next;
+		if (j == m_pending.size()
+		||  (i < m_records.size() && m_records.at(i).key <= m_pending.at(j).key))
+			next = &m_records.at(i++);
+		else
+			next = &m_pending.at(j++);
+
+		if (records.isEmpty() || records.last().key != next->key)
+			keyStart = records.size();
+
+		int k;
+		for (k = keyStart; k < records.size(); k++)
 		{
-			tmp.weight += entry.weight;
-			return;
+			if (records.at(k).move == next->move)
+			{
+				records[k].weight += next->weight;
+				break;
+			}
 		}
-		++it;
+		if (k == records.size())
+			records.append(*next);
 	}
-	
-	m_map.insert(key, entry);
+
+	records.squeeze();
+	m_records = records;
+	m_pending.clear();
+	m_pending.squeeze();
+
+	// Precompute the cumulative weights of each key's moves, so
+	// that move() can pick a move with a single binary search
+	m_cumWeights.resize(m_records.size());
+	quint64 weight = 0;
+	for (int k = 0; k < m_records.size(); k++)
+	{
+		if (k == 0 || m_records.at(k).key != m_records.at(k - 1).key)
+			weight = 0;
+		weight += m_records.at(k).weight;
+		m_cumWeights[k] = weight;
+	}
+	m_cumWeights.squeeze();
 }
 
 int OpeningBook::import(const PgnGame& pgn, int maxMoves)
@@ -135,29 +262,100 @@ int OpeningBook::import(PgnStream& in, int maxMoves)
 	return moveCount;
 }
 
-Chess::GenericMove OpeningBook::move(quint64 key) const
+int OpeningBook::entrySize() const
+{
+	return 0;
+}
+
+quint64 OpeningBook::keyFromData(const uchar* data) const
+{
+	Q_UNUSED(data);
+	return 0;
+}
+
+OpeningBook::Entry OpeningBook::entryFromData(const uchar* data) const
+{
+	Q_UNUSED(data);
+	Entry entry = { Chess::GenericMove(), 0 };
+	return entry;
+}
+
+int OpeningBook::firstEntry(quint64 key) const
+{
+	// Binary search for the first file entry with the key
+	int size = entrySize();
+	int first = 0;
+	int count = m_entryCount;
+	while (count > 0)
+	{
+		int step = count / 2;
+		if (keyFromData(m_data + qint64(first + step) * size) < key)
+		{
+			first += step + 1;
+			count -= step + 1;
+		}
+		else
+			count = step;
+	}
+
+	return first;
+}
+
+Chess::GenericMove OpeningBook::move(quint64 key,
+				       RandomGenerator* random) const
 {
 	Chess::GenericMove move;
-	
-	// There can be multiple entries/moves with the same key.
-	// We need to find them all to choose the best one
-	QList<Entry> entries = m_map.values(key);
-	if (entries.size() == 0)
-		return move;
-	
-	// Calculate the total weight of all available moves
-	int totalWeight = 0;
-	foreach (const Entry& entry, entries)
-		totalWeight += entry.weight;
-	if (totalWeight <= 0)
+
+	if (m_data == 0)
+	{
+		compact();
+
+		// There can be multiple entries/moves with the same key.
+		// They are next to each other, and the cumulative weights
+		// of the run tell both the total weight and the pick.
+		const Record* begin = m_records.constData();
+		const Record* end = begin + m_records.size();
+		Record value = { key, Chess::GenericMove(), 0 };
+		const Record* first = qLowerBound(begin, end, value, recordLessThan);
+		const Record* last = first;
+		while (last != end && last->key == key)
+			++last;
+		if (first == last)
+			return move;
+
+		const quint64* weights = m_cumWeights.constData() + (first - begin);
+		int count = int(last - first);
+		quint64 totalWeight = weights[count - 1];
+		if (totalWeight == 0)
+			return move;
+
+		// Pick a move randomly, with the highest-weighted move
+		// having the highest probability of getting picked.
+		quint64 pick = randomNumber(random) % totalWeight;
+		return first[qUpperBound(weights, weights + count, pick) - weights].move;
+	}
+
+	// In Disk mode the entries are read in place, once to add up
+	// the weights and again to find the picked move
+	int size = entrySize();
+	int first = firstEntry(key);
+	int last = first;
+	quint64 totalWeight = 0;
+	for (; last < m_entryCount; last++)
+	{
+		const uchar* data = m_data + qint64(last) * size;
+		if (keyFromData(data) != key)
+			break;
+		totalWeight += entryFromData(data).weight;
+	}
+	if (totalWeight == 0)
 		return move;
 
-	// Pick a move randomly, with the highest-weighted move having
-	// the highest probability of getting picked.
-	int pick = Mersenne::random() % totalWeight;
-	int currentWeight = 0;
-	foreach (const Entry& entry, entries)
+	quint64 pick = randomNumber(random) % totalWeight;
+	quint64 currentWeight = 0;
+	for (int i = first; i < last; i++)
 	{
+		Entry entry = entryFromData(m_data + qint64(i) * size);
 		currentWeight += entry.weight;
 		if (currentWeight > pick)
 			return entry.move;
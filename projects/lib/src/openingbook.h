@@ -19,31 +19,58 @@
 #define OPENING_BOOK_H
 
 #include <QtGlobal>
-#include <QMultiMap>
+#include <QVector>
 #include "board/genericmove.h"
 
 class QString;
+class QFile;
 class QDataStream;
 class PgnGame;
 class PgnStream;
+class RandomGenerator;
 
 
 /*!
  * \brief A collection of opening moves for chess.
  *
- * OpeningBook is a container (binary tree) class for opening moves that
- * can be played by the GUI. When the game goes "out of book", control
+ * OpeningBook is a container class for opening moves that can be played
+ * by the GUI. When the game goes "out of book", control
  * of the game is transferred to the players.
  *
  * The opening book can be stored externally in a binary file. When it's needed,
  * it is loaded in memory, and positions can be found quickly by searching
  * the book for Zobrist keys that match the current board position.
+ *
+ * The entries in memory are kept in a flat array sorted by key. New
+ * entries, eg. from imported games, are collected unsorted and merged
+ * into the array in large batches, so building a book from a big PGN
+ * collection needs no per-entry allocations. The cumulative weights of
+ * each position's moves are stored next to the entries, so a lookup
+ * is one binary search for the key and one for the weighted pick.
+ *
+ * Books whose file format consists of fixed-size entries sorted by key
+ * can also be used in \a Disk mode, where the file is memory mapped and
+ * searched directly instead of being loaded.
  */
 class LIB_EXPORT OpeningBook
 {
 	public:
+		/*! The mode for accessing the book file. */
+		enum AccessMode
+		{
+			Ram,	//!< The entries are loaded in memory
+			Disk	//!< The book file is memory mapped and searched directly
+		};
+
+		/*!
+		 * Creates a new opening book that uses access mode \a mode.
+		 *
+		 * If the book format doesn't support \a Disk mode, the
+		 * entries are loaded in memory.
+		 */
+		OpeningBook(AccessMode mode = Ram);
 		/*! Destroys the opening book. */
-		virtual ~OpeningBook() {}
+		virtual ~OpeningBook();
 		
 		/*!
 		 * Imports a PGN game.
@@ -75,18 +102,34 @@ class LIB_EXPORT OpeningBook
 		 *
 		 * If there are multiple matches, a random, weighted move is
 		 * returned. Popular moves have a higher probablity of being
-		 * selected than unpopular ones.
+		 * selected than unpopular ones. The move is drawn from
+		 * \a random, or from Mersenne::random() if \a random is 0.
+		 *
+		 * \note Entries added since the last lookup are merged into
+		 * the book first, so a book that is still being imported
+		 * must not be probed from several threads at once.
 		 */
-		Chess::GenericMove move(quint64 key) const;
+		Chess::GenericMove move(quint64 key,
+					RandomGenerator* random = 0) const;
 
 		/*!
 		 * Reads a book from \a filename.
+		 *
+		 * In \a Disk mode the file is only mapped, and it stays
+		 * mapped until the book is destroyed or another file is
+		 * read. The mapping is read-only, so a single book can
+		 * serve concurrent move() calls from any number of games.
+		 *
 		 * Returns true if successfull.
 		 */
 		bool read(const QString& filename);
 
 		/*!
 		 * Writes the book to \a filename.
+		 *
+		 * \note Only the entries in memory are written, so a book
+		 * read in \a Disk mode can't be written.
+		 *
 		 * Returns true if successfull.
 		 */
 		bool write(const QString& filename) const;
@@ -115,11 +158,12 @@ class LIB_EXPORT OpeningBook
 			quint16 weight;
 		};
 
-		/*! The type of binary tree. */
-		typedef QMultiMap<quint64, Entry> Map;
-
-
-		/*! Adds a new entry to the book. */
+		/*!
+		 * Adds a new entry to the book.
+		 *
+		 * If the book already has the same move for \a key, the
+		 * weights are added together.
+		 */
 		void addEntry(const Entry& entry, quint64 key);
 		
 		/*!
@@ -130,12 +174,52 @@ class LIB_EXPORT OpeningBook
 		 */
 		virtual void readEntry(QDataStream& in) = 0;
 		
-		/*! Writes the key and entry pointed to by \a it, to \a out. */
-		virtual void writeEntry(const Map::const_iterator& it,
+		/*! Writes \a key and \a entry to \a out. */
+		virtual void writeEntry(quint64 key,
+					const Entry& entry,
 					QDataStream& out) const = 0;
 
+		/*!
+		 * Returns the size of an entry in the book file, or 0 if
+		 * the entries don't have a fixed size.
+		 *
+		 * A book format that returns a non-zero size must store the
+		 * entries sorted by key, and must implement keyFromData()
+		 * and entryFromData(). The default implementation returns 0,
+		 * which disables \a Disk mode.
+		 */
+		virtual int entrySize() const;
+		/*! Returns the key of the file entry stored at \a data. */
+		virtual quint64 keyFromData(const uchar* data) const;
+		/*! Returns the file entry stored at \a data. */
+		virtual Entry entryFromData(const uchar* data) const;
+
 	private:
-		Map m_map;
+		Q_DISABLE_COPY(OpeningBook)
+
+		// An entry in memory. The weight is wider than in Entry,
+		// so that the weights of big imports don't overflow.
+		struct Record
+		{
+			quint64 key;
+			Chess::GenericMove move;
+			quint32 weight;
+		};
+
+		static bool recordLessThan(const Record& a, const Record& b);
+		int firstEntry(quint64 key) const;
+		void compact() const;
+		void unmap();
+
+		AccessMode m_mode;
+		mutable QVector<Record> m_records;
+		// The cumulative weights of each key's moves, in the same
+		// order as m_records
+		mutable QVector<quint64> m_cumWeights;
+		mutable QVector<Record> m_pending;
+		QFile* m_file;
+		const uchar* m_data;
+		int m_entryCount;
 };
 
 /*!
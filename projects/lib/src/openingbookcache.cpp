@@ -0,0 +1,72 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "openingbookcache.h"
+#include <QHash>
+#include <QMutex>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QWeakPointer>
+#include "polyglotbook.h"
+
+static QMutex s_mutex;
+static QHash< QString, QWeakPointer<const OpeningBook> > s_books;
+
+QSharedPointer<const OpeningBook> OpeningBookCache::polyglotBook(
+	const QString& fileName,
+	OpeningBook::AccessMode mode)
+{
+	QFileInfo info(fileName);
+	QString path(info.canonicalFilePath());
+	if (path.isEmpty())
+		return QSharedPointer<const OpeningBook>();
+
+	QString key = QString("%1|%2|%3")
+		.arg(path)
+		.arg(info.lastModified().toTime_t())
+		.arg(int(mode));
+
+	// The lock is held while the book is read, so that concurrent
+	// requests for the same book don't read it more than once.
+	QMutexLocker locker(&s_mutex);
+
+	QSharedPointer<const OpeningBook> book(s_books.value(key).toStrongRef());
+	if (!book.isNull())
+		return book;
+
+	// Forget the books that are no longer in use
+	QHash< QString, QWeakPointer<const OpeningBook> >::iterator it;
+	for (it = s_books.begin(); it != s_books.end(); )
+	{
+		if (it.value().isNull())
+			it = s_books.erase(it);
+		else
+			++it;
+	}
+
+	PolyglotBook* newBook = new PolyglotBook(mode);
+	if (!newBook->read(path))
+	{
+		delete newBook;
+		return QSharedPointer<const OpeningBook>();
+	}
+
+	book = QSharedPointer<const OpeningBook>(newBook);
+	s_books[key] = book;
+	return book;
+}
@@ -0,0 +1,59 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef OPENING_BOOK_CACHE_H
+#define OPENING_BOOK_CACHE_H
+
+#include <QString>
+#include <QSharedPointer>
+#include "openingbook.h"
+
+/*!
+ * \brief A process-wide cache of read-only opening books.
+ *
+ * Reading a big opening book takes time and memory, so when several
+ * engines, games or tournaments use the same book file they should
+ * share one OpeningBook object. The cache identifies a book by the
+ * canonical path and the modification time of its file, and by the
+ * access mode. If the file is modified, the next request reads it again.
+ *
+ * The books are handed out as shared pointers to const objects, and a
+ * book is destroyed when the last pointer to it is released. Because
+ * the shared books are never modified, any thread may call
+ * OpeningBook::move() on them concurrently. All functions of this
+ * class are thread-safe.
+ *
+ * \sa OpeningBook
+ */
+class LIB_EXPORT OpeningBookCache
+{
+	public:
+		/*!
+		 * Returns the Polyglot book in \a fileName, read in access
+		 * mode \a mode.
+		 *
+		 * If the same version of the file is already in use with
+		 * the same mode, the existing book is returned. Returns a
+		 * null pointer if the book can't be read.
+		 */
+		static QSharedPointer<const OpeningBook> polyglotBook(
+			const QString& fileName,
+			OpeningBook::AccessMode mode = OpeningBook::Ram);
+};
+
+#endif // OPENING_BOOK_CACHE_H
@@ -0,0 +1,175 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "openingstats.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QTextStream>
+#include <jsonparser.h>
+#include <jsonserializer.h>
+
+// The version number of the statistics file format
+static const int s_statsVersion = 1;
+
+static QVariantMap suiteInfo(const QString& suiteFileName)
+{
+	QFileInfo info(suiteFileName);
+	QVariantMap map;
+	map["size"] = info.size();
+	map["modified"] = qint64(info.lastModified().toTime_t());
+
+	return map;
+}
+
+OpeningStats::OpeningStats()
+{
+}
+
+int OpeningStats::openingCount() const
+{
+	return m_entries.size();
+}
+
+OpeningStats::Entry OpeningStats::entry(int index) const
+{
+	Entry empty = { 0, 0, 0 };
+	return m_entries.value(index, empty);
+}
+
+void OpeningStats::addResult(int index, const Chess::Result& result)
+{
+	if (index < 0)
+		return;
+
+	const Chess::Side winner(result.winner());
+	if (winner.isNull() && !result.isDraw())
+		return;
+
+	QHash<int, Entry>::iterator it = m_entries.find(index);
+	if (it == m_entries.end())
+	{
+		Entry empty = { 0, 0, 0 };
+		it = m_entries.insert(index, empty);
+	}
+
+	if (winner == Chess::Side::White)
+		it->whiteWins++;
+	else if (winner == Chess::Side::Black)
+		it->blackWins++;
+	else
+		it->draws++;
+}
+
+void OpeningStats::clear()
+{
+	m_entries.clear();
+}
+
+QSet<int> OpeningStats::lowInformation(int minGames, int maxShare) const
+{
+	QSet<int> indexes;
+
+	QHash<int, Entry>::const_iterator it;
+	for (it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+	{
+		const Entry& entry = it.value();
+		int games = entry.whiteWins + entry.blackWins + entry.draws;
+		int most = qMax(entry.draws, qMax(entry.whiteWins, entry.blackWins));
+		if (games >= minGames && most * 100 >= maxShare * games)
+			indexes.insert(it.key());
+	}
+
+	return indexes;
+}
+
+bool OpeningStats::load(const QString& fileName, const QString& suiteFileName)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		return false;
+
+	QTextStream in(&file);
+	JsonParser parser(in);
+	const QVariantMap map(parser.parse().toMap());
+	const QVariantMap suite(map.value("suite").toMap());
+	const QVariantMap current(suiteInfo(suiteFileName));
+	if (parser.hasError()
+	||  map.value("version").toInt() != s_statsVersion
+	||  suite.value("size").toLongLong() != current.value("size").toLongLong()
+	||  suite.value("modified").toLongLong() != current.value("modified").toLongLong())
+		return false;
+
+	foreach (const QVariant& var, map.value("openings").toList())
+	{
+		const QVariantList list(var.toList());
+		if (list.size() != 4)
+			return false;
+
+		int index = list.at(0).toInt();
+		Entry entry = this->entry(index);
+		entry.whiteWins += list.at(1).toInt();
+		entry.blackWins += list.at(2).toInt();
+		entry.draws += list.at(3).toInt();
+		m_entries[index] = entry;
+	}
+
+	return true;
+}
+
+bool OpeningStats::save(const QString& fileName, const QString& suiteFileName) const
+{
+	QVariantList openings;
+	QHash<int, Entry>::const_iterator it;
+	for (it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+	{
+		QVariantList list;
+		list << it.key()
+		     << it->whiteWins
+		     << it->blackWins
+		     << it->draws;
+		openings.append(QVariant(list));
+	}
+
+	QVariantMap map;
+	map["version"] = s_statsVersion;
+	map["suite"] = suiteInfo(suiteFileName);
+	map["openings"] = openings;
+
+	// Write to a temporary file first so that a crash never
+	// destroys the results of the earlier runs
+	const QString tmpName(fileName + ".tmp");
+	QFile file(tmpName);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+		return false;
+
+	QTextStream out(&file);
+	JsonSerializer serializer(map);
+	bool ok = serializer.serialize(out);
+	out.flush();
+	ok = ok && out.status() == QTextStream::Ok && file.flush();
+	file.close();
+	if (!ok)
+	{
+		QFile::remove(tmpName);
+		return false;
+	}
+
+	QFile::remove(fileName);
+	return QFile::rename(tmpName, fileName);
+}
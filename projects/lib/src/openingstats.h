@@ -0,0 +1,98 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef OPENINGSTATS_H
+#define OPENINGSTATS_H
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include "board/result.h"
+
+/*!
+ * \brief Game results per opening of an opening suite.
+ *
+ * OpeningStats counts the results of the games played from each
+ * opening, by the opening's index in the suite file (see
+ * OpeningSuite::lastIndex()). The counts can be saved and loaded
+ * again, so that they accumulate over many runs with the same suite.
+ *
+ * An opening that is nearly always won by the same color, or nearly
+ * always drawn, says little about the engines because the opening
+ * decides the game before they get to think. lowInformation() finds
+ * those openings, and OpeningSuite::writeSubset() can leave them out
+ * of a pruned suite.
+ */
+class LIB_EXPORT OpeningStats
+{
+	public:
+		/*! The results of the games played from one opening. */
+		struct Entry
+		{
+			//! The number of games won by white
+			int whiteWins;
+			//! The number of games won by black
+			int blackWins;
+			//! The number of drawn games
+			int draws;
+		};
+
+		/*! Creates empty statistics. */
+		OpeningStats();
+
+		/*! Returns the number of openings that have results. */
+		int openingCount() const;
+		/*! Returns the results of the opening at \a index. */
+		Entry entry(int index) const;
+		/*!
+		 * Adds \a result to the opening at \a index.
+		 *
+		 * Results that aren't wins or draws are ignored.
+		 */
+		void addResult(int index, const Chess::Result& result);
+		/*! Removes all results. */
+		void clear();
+
+		/*!
+		 * Returns the indexes of the openings that were played at
+		 * least \a minGames times and where the same outcome (a
+		 * white win, a black win or a draw) was reached in at least
+		 * \a maxShare percent of the games.
+		 */
+		QSet<int> lowInformation(int minGames, int maxShare) const;
+
+		/*!
+		 * Adds the results saved in \a fileName for the suite
+		 * \a suiteFileName.
+		 *
+		 * Returns false if the file can't be read, or if it was
+		 * saved for a different version of the suite, in which
+		 * case the indexes may not match anymore.
+		 */
+		bool load(const QString& fileName, const QString& suiteFileName);
+		/*!
+		 * Saves the results for the suite \a suiteFileName to
+		 * \a fileName. Returns true if successful.
+		 */
+		bool save(const QString& fileName, const QString& suiteFileName) const;
+
+	private:
+		QHash<int, Entry> m_entries;
+};
+
+#endif // OPENINGSTATS_H
@@ -17,11 +17,175 @@
 
 #include "openingsuite.h"
 #include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QBuffer>
 #include <QTextStream>
+#include <QtAlgorithms>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include "gzipdevice.h"
+#include "streambuffer.h"
 #include "pgnstream.h"
 #include "epdrecord.h"
 #include "mersenne.h"
 
+// Suites up to this size in bytes are read to memory
+static const qint64 s_maxPreloadSize = 8 << 20;
+
+// The header of an opening suite index file. The index is valid
+// as long as the suite has the same size and modification time.
+struct OpeningSuiteIndexHeader
+{
+	quint32 magic;
+	quint32 version;
+	quint32 byteOrder;
+	qint32 format;
+	qint64 fileSize;
+	qint64 lastModified;
+	qint32 count;
+	qint32 reserved;
+};
+
+static const quint32 s_indexMagic = 0x4343534f;
+static const quint32 s_indexVersion = 1;
+static const quint32 s_indexByteOrder = 0x01020304;
+
+// Number of streamed openings that are read ahead
+static const int s_prefetchCount = 32;
+
+
+/*
+ * Reads and parses the openings of a streamed suite ahead of time.
+ *
+ * While the prefetcher exists its thread owns the suite's streams and
+ * read position. Each opening in the queue keeps the stream state from
+ * before it was read, so that the suite can go back to the first
+ * opening that wasn't taken yet.
+ */
+class OpeningSuite::Prefetcher : public QThread
+{
+	public:
+		Prefetcher(OpeningSuite* suite);
+		virtual ~Prefetcher();
+
+		bool take(PgnGame* game, int* index);
+		QVariantMap nextState() const;
+		void stop();
+
+	protected:
+		virtual void run();
+
+	private:
+		struct Opening
+		{
+			PgnGame game;
+			int index;
+			QVariantMap state;
+		};
+
+		OpeningSuite* m_suite;
+		bool m_running;
+		bool m_stopping;
+		QList<Opening> m_queue;
+		QVariantMap m_pendingState;
+		mutable QMutex m_mutex;
+		QWaitCondition m_queueNotEmpty;
+		QWaitCondition m_queueNotFull;
+};
+
+OpeningSuite::Prefetcher::Prefetcher(OpeningSuite* suite)
+	: m_suite(suite),
+	  m_running(false),
+	  m_stopping(false),
+	  m_pendingState(suite->streamState())
+{
+}
+
+OpeningSuite::Prefetcher::~Prefetcher()
+{
+	stop();
+}
+
+bool OpeningSuite::Prefetcher::take(PgnGame* game, int* index)
+{
+	QMutexLocker locker(&m_mutex);
+
+	// The thread stops after a failed sequential read, which would
+	// fail again right away. It's started again on demand.
+	if (m_queue.isEmpty() && !m_running)
+	{
+		locker.unlock();
+		wait();
+		locker.relock();
+		m_running = true;
+		start();
+	}
+	while (m_queue.isEmpty())
+		m_queueNotEmpty.wait(&m_mutex);
+
+	const Opening opening(m_queue.takeFirst());
+	m_queueNotFull.wakeOne();
+
+	*game = opening.game;
+	*index = opening.index;
+	return opening.index != -1;
+}
+
+QVariantMap OpeningSuite::Prefetcher::nextState() const
+{
+	QMutexLocker locker(&m_mutex);
+	if (m_queue.isEmpty())
+		return m_pendingState;
+	return m_queue.first().state;
+}
+
+void OpeningSuite::Prefetcher::stop()
+{
+	{
+		QMutexLocker locker(&m_mutex);
+		m_stopping = true;
+		m_queueNotFull.wakeOne();
+	}
+	wait();
+}
+
+void OpeningSuite::Prefetcher::run()
+{
+	forever
+	{
+		Opening opening;
+		opening.state = m_suite->streamState();
+		{
+			QMutexLocker locker(&m_mutex);
+			m_pendingState = opening.state;
+			while (!m_stopping && m_queue.size() >= s_prefetchCount)
+				m_queueNotFull.wait(&m_mutex);
+			if (m_stopping)
+			{
+				m_running = false;
+				return;
+			}
+		}
+
+		bool ok = m_suite->readGame(&opening.game, &opening.index);
+
+		QMutexLocker locker(&m_mutex);
+		m_queue.append(opening);
+		m_queueNotEmpty.wakeOne();
+		if (!ok && m_suite->m_order == SequentialOrder)
+		{
+			m_running = false;
+			return;
+		}
+	}
+}
+
 OpeningSuite::OpeningSuite(const QString& fileName,
 			   Format format,
 			   Order order,
@@ -31,15 +195,48 @@ OpeningSuite::OpeningSuite(const QString& fileName,
 	  m_gamesRead(0),
 	  m_gameIndex(0),
 	  m_startIndex(startIndex),
+	  m_lastIndex(-1),
+	  m_nextIndex(0),
 	  m_fileName(fileName),
+	  m_source(0),
 	  m_file(0),
 	  m_epdStream(0),
-	  m_pgnStream(0)
+	  m_pgnStream(0),
+	  m_indexFile(0),
+	  m_positions(0),
+	  m_positionCount(0),
+	  m_prefetcher(0)
 {
 }
 
+OpeningSuite::OpeningSuite(QIODevice* device,
+			   Format format,
+			   Order order,
+			   int startIndex)
+	: m_format(format),
+	  m_order(order),
+	  m_gamesRead(0),
+	  m_gameIndex(0),
+	  m_startIndex(startIndex),
+	  m_lastIndex(-1),
+	  m_nextIndex(0),
+	  m_source(device),
+	  m_file(0),
+	  m_epdStream(0),
+	  m_pgnStream(0),
+	  m_indexFile(0),
+	  m_positions(0),
+	  m_positionCount(0),
+	  m_prefetcher(0)
+{
+	Q_ASSERT(device != 0);
+}
+
 OpeningSuite::~OpeningSuite()
 {
+	delete m_prefetcher;
+	clearIndex();
+
 	if (m_epdStream != 0)
 	{
 		delete m_epdStream->device();
@@ -62,16 +259,33 @@ OpeningSuite::Order OpeningSuite::order() const
 	return m_order;
 }
 
+QString OpeningSuite::fileName() const
+{
+	return m_fileName;
+}
+
 bool OpeningSuite::isNull() const
 {
 	return m_epdStream == 0 && m_pgnStream == 0;
 }
 
+void OpeningSuite::setIndexDirectory(const QString& dir)
+{
+	m_indexDir = dir;
+}
+
 bool OpeningSuite::initialize()
 {
+	stopPrefetch();
+
 	m_gamesRead = 0;
 	m_gameIndex = 0;
-	m_filePositions.clear();
+	m_lastIndex = -1;
+	m_nextIndex = 0;
+	clearIndex();
+	m_fileIndexes.clear();
+	m_games.clear();
+	m_gamePositions.clear();
 
 	if (m_epdStream != 0)
 	{
@@ -86,42 +300,118 @@ bool OpeningSuite::initialize()
 		m_pgnStream = 0;
 	}
 
-	m_file = new QFile(m_fileName);
-	if (!m_file->open(QIODevice::ReadOnly | QIODevice::Text))
+	QIODevice* file = 0;
+	if (m_source != 0)
 	{
-		qWarning("Can't open opening suite %s",
-			 qPrintable(m_fileName));
-		delete m_file;
-		return false;
+		file = readSource();
+		if (file == 0)
+			return false;
+	}
+	else
+	{
+		file = new QFile(m_fileName);
+		if (!file->open(QIODevice::ReadOnly | QIODevice::Text))
+		{
+			qWarning("Can't open opening suite %s",
+				 qPrintable(m_fileName));
+			delete file;
+			return false;
+		}
 	}
 
+	// The openings are read in random order or rewound, so a
+	// compressed suite is decompressed to memory for fast seeking
+	if (GzipDevice::isCompressed(file))
+	{
+		file->setTextModeEnabled(false);
+		GzipDevice gzip(file);
+		if (!gzip.open(QIODevice::ReadOnly))
+		{
+			qWarning("Can't decompress opening suite %s: %s",
+				 qPrintable(m_fileName),
+				 qPrintable(gzip.errorString()));
+			delete file;
+			return false;
+		}
+
+		QBuffer* buffer = new QBuffer;
+		buffer->setData(gzip.readAll());
+		gzip.close();
+		delete file;
+
+		buffer->open(QIODevice::ReadOnly | QIODevice::Text);
+		m_file = buffer;
+	}
+	else
+		m_file = file;
+
 	if (m_format == PgnFormat)
+	{
 		m_pgnStream = new PgnStream(m_file);
+		m_pgnStream->setMappingEnabled(true);
+	}
+
+	if (m_file->size() <= s_maxPreloadSize)
+		preload();
 
 	if (m_order == RandomOrder)
 	{
-		// Create a shuffled vector of file positions
-		forever
+		// Save the PRNG state so that the same order can be
+		// restored later
+		m_randomState = Mersenne::state();
+
+		if (!m_games.isEmpty())
 		{
-			FilePosition pos;
-			if (m_format == EpdFormat)
-				pos = getEpdPos();
-			else if (m_format == PgnFormat)
-				pos = getPgnPos();
+			m_positions = m_gamePositions.constData();
+			m_positionCount = m_gamePositions.size();
+		}
+		else if (!mapIndex())
+		{
+			forever
+			{
+				FilePosition pos;
+				if (m_format == EpdFormat)
+					pos = getEpdPos();
+				else if (m_format == PgnFormat)
+					pos = getPgnPos();
 
-			if (pos.pos == -1)
-				break;
+				if (pos.pos == -1)
+					break;
+				m_positionData.append(pos);
+			}
+			saveIndex(m_positionData);
+
+			// Use the saved index like the other processes do,
+			// so that the positions aren't kept twice in memory
+			if (mapIndex())
+				m_positionData.clear();
+			else
+			{
+				m_positions = m_positionData.constData();
+				m_positionCount = m_positionData.size();
+			}
+		}
 
-			int i = Mersenne::random() % (m_filePositions.size() + 1);
-			if (i == m_filePositions.size())
-				m_filePositions.append(pos);
+		// Create a shuffled vector of opening indexes. The file
+		// positions stay in the file order in the index.
+		m_fileIndexes.reserve(m_positionCount);
+		for (int n = 0; n < m_positionCount; n++)
+		{
+			int i = Mersenne::random() % (m_fileIndexes.size() + 1);
+			if (i == m_fileIndexes.size())
+				m_fileIndexes.append(n);
 			else
 			{
-				m_filePositions.append(m_filePositions.at(i));
-				m_filePositions[i] = pos;
+				m_fileIndexes.append(m_fileIndexes.at(i));
+				m_fileIndexes[i] = n;
 			}
 		}
 	}
+	else if (!m_games.isEmpty())
+	{
+		if (m_startIndex < m_games.size())
+			m_gameIndex = m_startIndex;
+	}
 	else if (m_order == SequentialOrder)
 	{
 		for (int i = 0; i < m_startIndex; i++)
@@ -134,6 +424,7 @@ bool OpeningSuite::initialize()
 
 			if (pos.pos == -1)
 				break;
+			m_nextIndex++;
 		}
 	}
 
@@ -149,14 +440,60 @@ bool OpeningSuite::initialize()
 PgnGame OpeningSuite::nextGame(int maxPlies)
 {
 	PgnGame game;
+	m_lastIndex = -1;
 	if (isNull())
 		return game;
 
+	if (!m_games.isEmpty())
+	{
+		int index;
+		if (m_order == RandomOrder)
+		{
+			index = m_fileIndexes.at(m_gameIndex++);
+			if (m_gameIndex >= m_fileIndexes.size())
+				m_gameIndex = 0;
+		}
+		else
+		{
+			index = m_gameIndex++;
+			if (m_gameIndex >= m_games.size())
+				m_gameIndex = 0;
+		}
+
+		game = m_games.at(index);
+		game.truncateMoves(maxPlies);
+		m_gamesRead++;
+		m_lastIndex = index;
+		return game;
+	}
+
+	// Streamed openings are read and parsed ahead on a worker thread,
+	// so that starting a game doesn't wait for the file
+	if (m_prefetcher == 0)
+		m_prefetcher = new Prefetcher(this);
+
+	int index = -1;
+	if (m_prefetcher->take(&game, &index))
+	{
+		m_gamesRead++;
+		m_lastIndex = index;
+	}
+	game.truncateMoves(maxPlies);
+	return game;
+}
+
+bool OpeningSuite::readGame(PgnGame* game, int* index)
+{
+	Q_ASSERT(game != 0);
+	Q_ASSERT(index != 0);
+
 	FilePosition pos = { -1, -1 };
+	int fileIndex = -1;
 	if (m_order == RandomOrder)
 	{
-		pos = m_filePositions.at(m_gameIndex++);
-		if (m_gameIndex >= m_filePositions.size())
+		fileIndex = m_fileIndexes.at(m_gameIndex++);
+		pos = filePosition(fileIndex);
+		if (m_gameIndex >= m_fileIndexes.size())
 			m_gameIndex = 0;
 	}
 
@@ -174,35 +511,279 @@ PgnGame OpeningSuite::nextGame(int maxPlies)
 
 		// Rewind the EPD input file
 		if (m_order == SequentialOrder
-		&&  !ok && m_gamesRead > 0 && m_epdStream->atEnd())
+		&&  !ok && m_nextIndex > 0 && m_epdStream->atEnd())
 		{
 			m_epdStream->seek(0);
 			m_epdStream->resetStatus();
+			m_nextIndex = 0;
 			ok = epd.parse(*m_epdStream);
 		}
 
 		Chess::Side side(epd.fen().section(' ', 1, 1));
-		game.setStartingFenString(side, epd.fen());
+		game->setStartingFenString(side, epd.fen());
 	}
 	else if (m_format == PgnFormat)
 	{
 		if (pos.pos != -1)
 			m_pgnStream->seek(pos.pos, pos.lineNumber);
 
-		ok = game.read(*m_pgnStream, maxPlies);
+		ok = game->read(*m_pgnStream);
 
 		// Rewind the PGN input file
 		if (m_order == SequentialOrder
-		&&  !ok && m_gamesRead > 0)
+		&&  !ok && m_nextIndex > 0)
 		{
 			m_pgnStream->rewind();
-			ok = game.read(*m_pgnStream, maxPlies);
+			m_nextIndex = 0;
+			ok = game->read(*m_pgnStream);
 		}
 	}
 
+	*index = -1;
 	if (ok)
-		m_gamesRead++;
-	return game;
+		*index = (m_order == RandomOrder) ? fileIndex : m_nextIndex++;
+	return ok;
+}
+
+int OpeningSuite::lastIndex() const
+{
+	return m_lastIndex;
+}
+
+QVariantMap OpeningSuite::saveState() const
+{
+	QVariantMap state;
+	if (isNull())
+		return state;
+
+	state["gamesRead"] = m_gamesRead;
+	if (m_order == SequentialOrder && !m_games.isEmpty())
+	{
+		// The position of the next opening is saved, so that
+		// the state can be restored without preloading too
+		const FilePosition& pos = m_gamePositions.at(m_gameIndex);
+		state["pos"] = pos.pos;
+		if (m_format == PgnFormat)
+			state["lineNumber"] = pos.lineNumber;
+		return state;
+	}
+
+	// The openings that were read ahead haven't been played yet
+	const QVariantMap streamPos(m_prefetcher != 0 ?
+		m_prefetcher->nextState() : streamState());
+	QVariantMap::const_iterator it;
+	for (it = streamPos.constBegin(); it != streamPos.constEnd(); ++it)
+		state[it.key()] = it.value();
+
+	if (m_order == RandomOrder)
+	{
+		state["count"] = m_fileIndexes.size();
+		state["random"] = QString(m_randomState.toHex());
+	}
+
+	return state;
+}
+
+bool OpeningSuite::restoreState(const QVariantMap& state)
+{
+	if (isNull())
+		return false;
+
+	stopPrefetch();
+
+	bool ok = true;
+	int gamesRead = state["gamesRead"].toInt();
+	if (m_order == RandomOrder)
+	{
+		const QByteArray randomState(QByteArray::fromHex(
+			state["random"].toString().toLatin1()));
+		int count = state["count"].toInt();
+		int gameIndex = state["gameIndex"].toInt();
+
+		// Shuffle the openings again with the original PRNG state,
+		// and leave the PRNG in its current state
+		const QByteArray currentState(Mersenne::state());
+		ok = Mersenne::setState(randomState) && initialize();
+		Mersenne::setState(currentState);
+		if (!ok || count != m_fileIndexes.size()
+		||  gameIndex < 0 || gameIndex >= count)
+			return false;
+
+		m_gameIndex = gameIndex;
+	}
+	else if (!m_games.isEmpty())
+	{
+		qint64 pos = state["pos"].toLongLong(&ok);
+		if (!ok || pos < 0)
+			return false;
+		m_gameIndex = preloadedIndex(pos);
+	}
+	else if (!seekState(state))
+		return false;
+
+	m_gamesRead = gamesRead;
+	return true;
+}
+
+QVariantMap OpeningSuite::streamState() const
+{
+	QVariantMap state;
+	if (m_order == RandomOrder)
+		state["gameIndex"] = m_gameIndex;
+	else if (m_format == PgnFormat)
+	{
+		state["pos"] = m_pgnStream->pos();
+		state["lineNumber"] = m_pgnStream->lineNumber();
+		state["index"] = m_nextIndex;
+	}
+	else
+	{
+		state["pos"] = m_epdStream->pos();
+		state["index"] = m_nextIndex;
+	}
+
+	return state;
+}
+
+bool OpeningSuite::seekState(const QVariantMap& state)
+{
+	if (m_order == RandomOrder)
+	{
+		int gameIndex = state["gameIndex"].toInt();
+		if (gameIndex < 0 || gameIndex >= m_fileIndexes.size())
+			return false;
+		m_gameIndex = gameIndex;
+		return true;
+	}
+
+	bool ok = false;
+	qint64 pos = state["pos"].toLongLong(&ok);
+	if (!ok || pos < 0)
+		return false;
+
+	if (m_format == PgnFormat)
+		ok = m_pgnStream->seek(pos, state["lineNumber"].toLongLong());
+	else
+	{
+		ok = m_epdStream->seek(pos);
+		m_epdStream->resetStatus();
+	}
+	if (!ok)
+		return false;
+
+	m_nextIndex = state["index"].toInt();
+	return true;
+}
+
+void OpeningSuite::stopPrefetch()
+{
+	if (m_prefetcher == 0)
+		return;
+
+	// Go back to the first opening that was read ahead
+	m_prefetcher->stop();
+	const QVariantMap state(m_prefetcher->nextState());
+	delete m_prefetcher;
+	m_prefetcher = 0;
+	seekState(state);
+}
+
+int OpeningSuite::writeSubset(const QString& fileName, const QSet<int>& excluded)
+{
+	if (isNull())
+		return -1;
+
+	stopPrefetch();
+
+	// Scanning the file moves a sequential stream, so the position
+	// of the next opening is restored afterwards
+	const bool restore = (m_order == SequentialOrder && m_games.isEmpty());
+	const QVariantMap state(saveState());
+
+	QVector<FilePosition> positions;
+	filePositions(&positions);
+
+	QFile out(fileName);
+	if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		qWarning("Can't open file %s", qPrintable(fileName));
+		if (restore)
+			restoreState(state);
+		return -1;
+	}
+
+	const bool textMode = m_file->isTextModeEnabled();
+	m_file->setTextModeEnabled(false);
+
+	int count = 0;
+	bool ok = true;
+	const qint64 fileSize = m_file->size();
+	for (int i = 0; i < positions.size() && ok; i++)
+	{
+		if (excluded.contains(i))
+			continue;
+
+		qint64 start = positions.at(i).pos;
+		qint64 end = (i + 1 < positions.size()) ?
+			positions.at(i + 1).pos : fileSize;
+		const QByteArray data(m_file->seek(start) ?
+			m_file->read(end - start) : QByteArray());
+		ok = data.size() == end - start
+		  && out.write(data) == data.size();
+		count++;
+	}
+
+	m_file->setTextModeEnabled(textMode);
+	if (restore)
+		restoreState(state);
+
+	out.close();
+	if (!ok || out.error() != QFile::NoError)
+	{
+		qWarning("Can't write file %s", qPrintable(fileName));
+		return -1;
+	}
+
+	return count;
+}
+
+void OpeningSuite::filePositions(QVector<FilePosition>* positions)
+{
+	Q_ASSERT(positions != 0);
+
+	positions->clear();
+	if (!m_games.isEmpty())
+	{
+		*positions = m_gamePositions;
+		return;
+	}
+
+	// The index is already in the file order
+	if (m_order == RandomOrder)
+	{
+		positions->reserve(m_positionCount);
+		for (int i = 0; i < m_positionCount; i++)
+			positions->append(filePosition(i));
+		return;
+	}
+
+	if (m_format == PgnFormat)
+		m_pgnStream->rewind();
+	else
+		m_file->reset();
+
+	forever
+	{
+		FilePosition pos;
+		if (m_format == EpdFormat)
+			pos = getEpdPos();
+		else
+			pos = getPgnPos();
+
+		if (pos.pos == -1)
+			break;
+		positions->append(pos);
+	}
 }
 
 OpeningSuite::FilePosition OpeningSuite::getPgnPos()
@@ -262,3 +843,198 @@ OpeningSuite::FilePosition OpeningSuite::getEpdPos()
 
 	return pos;
 }
+
+QIODevice* OpeningSuite::readSource() const
+{
+	// Compressed streaming data is decompressed as it arrives
+	QIODevice* source = m_source;
+	GzipDevice gzip(m_source);
+	if (GzipDevice::isCompressed(m_source))
+	{
+		m_source->setTextModeEnabled(false);
+		if (!gzip.open(QIODevice::ReadOnly))
+		{
+			qWarning("Can't decompress opening suite: %s",
+				 qPrintable(gzip.errorString()));
+			return 0;
+		}
+		source = &gzip;
+	}
+
+	QByteArray data;
+	do
+		data += source->readAll();
+	while (StreamBuffer::waitForData(source));
+
+	QBuffer* buffer = new QBuffer;
+	buffer->setData(data);
+	buffer->open(QIODevice::ReadOnly | QIODevice::Text);
+	return buffer;
+}
+
+QString OpeningSuite::indexFileName() const
+{
+	if (m_indexDir.isEmpty())
+		return m_fileName + ".idx";
+
+	const QByteArray path(QFileInfo(m_fileName).absoluteFilePath().toUtf8());
+	const QByteArray hash(QCryptographicHash::hash(path,
+		QCryptographicHash::Md5).toHex());
+	return QDir(m_indexDir).filePath(QString::fromLatin1(hash) + ".idx");
+}
+
+bool OpeningSuite::mapIndex()
+{
+	if (m_fileName.isEmpty())
+		return false;
+
+	// The index is never modified in place: a new index replaces
+	// the file, so the mapped pages stay valid
+	QFileInfo info(m_fileName);
+	QFile* file = new QFile(indexFileName());
+	const uchar* data = 0;
+	if (file->open(QIODevice::ReadOnly)
+	&&  file->size() >= qint64(sizeof(OpeningSuiteIndexHeader)))
+		data = file->map(0, file->size());
+
+	const OpeningSuiteIndexHeader* header =
+		reinterpret_cast<const OpeningSuiteIndexHeader*>(data);
+	if (header == 0
+	||  header->magic != s_indexMagic
+	||  header->version != s_indexVersion
+	||  header->byteOrder != s_indexByteOrder
+	||  header->format != qint32(m_format)
+	||  header->fileSize != info.size()
+	||  header->lastModified != qint64(info.lastModified().toTime_t())
+	||  header->count < 0
+	||  file->size() != qint64(sizeof(*header))
+			    + qint64(header->count) * qint64(sizeof(FilePosition)))
+	{
+		delete file;
+		return false;
+	}
+
+	m_indexFile = file;
+	m_positions = reinterpret_cast<const FilePosition*>(header + 1);
+	m_positionCount = header->count;
+	return true;
+}
+
+void OpeningSuite::clearIndex()
+{
+	// Deleting the file unmaps the index
+	delete m_indexFile;
+	m_indexFile = 0;
+	m_positions = 0;
+	m_positionCount = 0;
+	m_positionData.clear();
+}
+
+const OpeningSuite::FilePosition& OpeningSuite::filePosition(int index) const
+{
+	Q_ASSERT(index >= 0 && index < m_positionCount);
+	return m_positions[index];
+}
+
+void OpeningSuite::saveIndex(const QVector<FilePosition>& positions) const
+{
+	if (m_fileName.isEmpty())
+		return;
+
+	QFileInfo info(m_fileName);
+
+	OpeningSuiteIndexHeader header;
+	header.magic = s_indexMagic;
+	header.version = s_indexVersion;
+	header.byteOrder = s_indexByteOrder;
+	header.format = qint32(m_format);
+	header.fileSize = info.size();
+	header.lastModified = info.lastModified().toTime_t();
+	header.count = positions.size();
+	header.reserved = 0;
+
+	// The index is only a cache, so failing to write it (eg. in
+	// a read-only directory) isn't an error. A partial index is
+	// never left behind, and processes that index the same suite
+	// at the same time don't write to the same file.
+	const QString fileName(indexFileName());
+	QFile file(QString("%1.%2.tmp").arg(fileName)
+		   .arg(QCoreApplication::applicationPid()));
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return;
+
+	qint64 size = qint64(positions.size()) * sizeof(FilePosition);
+	bool ok = file.write((const char*)&header, sizeof(header)) == qint64(sizeof(header))
+	       && file.write((const char*)positions.constData(), size) == size;
+	file.close();
+
+	if (!ok || file.error() != QFile::NoError)
+	{
+		file.remove();
+		return;
+	}
+
+	QFile::remove(fileName);
+	if (!file.rename(fileName))
+		file.remove();
+}
+
+void OpeningSuite::preload()
+{
+	if (m_format == PgnFormat)
+	{
+		forever
+		{
+			FilePosition pos = { m_pgnStream->pos(),
+					     m_pgnStream->lineNumber() };
+			PgnGame game;
+			if (!game.read(*m_pgnStream))
+				break;
+
+			m_gamePositions.append(pos);
+			m_games.append(game);
+		}
+		m_pgnStream->rewind();
+	}
+	else if (m_format == EpdFormat)
+	{
+		QTextStream stream(m_file);
+		forever
+		{
+			FilePosition pos = { stream.pos(), -1 };
+			EpdRecord epd;
+			if (!epd.parse(stream))
+				break;
+
+			PgnGame game;
+			Chess::Side side(epd.fen().section(' ', 1, 1));
+			game.setStartingFenString(side, epd.fen());
+
+			m_gamePositions.append(pos);
+			m_games.append(game);
+		}
+		m_file->reset();
+	}
+}
+
+int OpeningSuite::preloadedIndex(qint64 pos) const
+{
+	// A saved position may be in the middle of an opening when the
+	// state was saved without preloading, so the index of the next
+	// opening is returned in that case.
+	FilePosition value = { pos, -1 };
+	QVector<FilePosition>::const_iterator it;
+	it = qLowerBound(m_gamePositions.constBegin(),
+			 m_gamePositions.constEnd(),
+			 value,
+			 filePositionLessThan);
+	if (it == m_gamePositions.constEnd())
+		return 0;
+	return int(it - m_gamePositions.constBegin());
+}
+
+bool OpeningSuite::filePositionLessThan(const FilePosition& a,
+					const FilePosition& b)
+{
+	return a.pos < b.pos;
+}
@@ -19,8 +19,12 @@
 #define OPENINGSUITE_H
 
 #include <QVector>
+#include <QVariant>
+#include <QSet>
+#include <QByteArray>
 #include "pgngame.h"
 class QString;
+class QIODevice;
 class QFile;
 class QTextStream;
 class PgnStream;
@@ -63,6 +67,9 @@ class LIB_EXPORT OpeningSuite
 		 * be the index of the first opening. If \a order is
 		 * \a RandomOrder, then setting a start index does nothing.
 		 *
+		 * Gzip compressed files are decompressed when the suite
+		 * is initialized.
+		 *
 		 * \note The created opening suite is null until
 		 * initialize() is called.
 		 */
@@ -70,6 +77,18 @@ class LIB_EXPORT OpeningSuite
 			     Format format,
 			     Order order = SequentialOrder,
 			     int startIndex = 0);
+		/*!
+		 * Creates a new opening suite that reads the openings
+		 * from \a device, eg. a StreamBuffer fed by a download.
+		 *
+		 * The data is read to memory when the suite is initialized,
+		 * and gzip compressed data is decompressed as it arrives.
+		 * The suite doesn't take ownership of \a device.
+		 */
+		OpeningSuite(QIODevice* device,
+			     Format format,
+			     Order order = SequentialOrder,
+			     int startIndex = 0);
 		/*! Destroys the opening suite. */
 		~OpeningSuite();
 
@@ -77,11 +96,26 @@ class LIB_EXPORT OpeningSuite
 		Format format() const;
 		/*! Returns the order in which openings are picked. */
 		Order order() const;
+		/*!
+		 * Returns the name of the suite file, or an empty string
+		 * if the suite is read from a device.
+		 */
+		QString fileName() const;
 		/*!
 		 * Returns true if the suite contains no data; otherwise
 		 * returns false.
 		 */
 		bool isNull() const;
+		/*!
+		 * Sets the directory of the index file to \a dir.
+		 *
+		 * By default the index of a suite is saved next to the
+		 * suite file. In \a dir the index is named after the hash
+		 * of the suite's absolute path, so that suites in several
+		 * read-only directories can share an index directory.
+		 * Must be called before initialize().
+		 */
+		void setIndexDirectory(const QString& dir);
 
 		/*!
 		 * Initializes the opening suite.
@@ -90,7 +124,14 @@ class LIB_EXPORT OpeningSuite
 		 * the opening suite file and gets ready to read data. If
 		 * \a order is RandomOrder, the file positions of all the
 		 * openings are parsed from the file, which could take some
-		 * time if the file is large.
+		 * time if the file is large. The positions are cached in
+		 * an index file next to the suite, so that they only have
+		 * to be parsed again when the suite changes. The index is
+		 * mapped to memory read-only, so processes that use the
+		 * same suite share its pages.
+		 *
+		 * Small suites are read to memory in both orders, so that
+		 * nextGame() doesn't have to read or parse the file.
 		 *
 		 * Returns true if successfull; otherwise returns false.
 		 */
@@ -98,10 +139,58 @@ class LIB_EXPORT OpeningSuite
 		/*!
 		 * Reads a new opening from the suite and returns it.
 		 * A maximum of \a maxPlies plies (halfmoves) are read.
+		 *
+		 * The openings of a suite that isn't read to memory are
+		 * read and parsed ahead on a worker thread, so this
+		 * function usually returns an opening that's ready.
 		 */
 		PgnGame nextGame(int maxPlies);
+		/*!
+		 * Returns the index of the opening returned by the last
+		 * call to nextGame(), or -1 if it didn't return an opening.
+		 *
+		 * The openings are indexed in the order of the suite file,
+		 * starting from 0, regardless of the order in which they're
+		 * picked, so the indexes stay the same between runs as long
+		 * as the file doesn't change.
+		 */
+		int lastIndex() const;
+
+		/*!
+		 * Returns the current position in the suite.
+		 *
+		 * The state can be saved and given to restoreState() to
+		 * continue from the same opening, eg. when resuming an
+		 * interrupted tournament.
+		 */
+		QVariantMap saveState() const;
+		/*!
+		 * Restores the position in the suite to \a state.
+		 *
+		 * The suite must be initialized and read from the same
+		 * file as when \a state was saved. In random order the
+		 * openings are shuffled again in the original order.
+		 *
+		 * Returns true if successfull.
+		 */
+		bool restoreState(const QVariantMap& state);
+
+		/*!
+		 * Writes the openings of the suite to \a fileName, except
+		 * the openings whose indexes are in \a excluded.
+		 *
+		 * The openings are written uncompressed in their original
+		 * order and text. The suite must be initialized, and the
+		 * next opening picked from it stays the same. Returns the
+		 * number of openings written, or -1 on error.
+		 *
+		 * \sa lastIndex()
+		 */
+		int writeSubset(const QString& fileName, const QSet<int>& excluded);
 
 	private:
+		class Prefetcher;
+
 		struct FilePosition
 		{
 			qint64 pos;
@@ -110,17 +199,44 @@ class LIB_EXPORT OpeningSuite
 
 		FilePosition getPgnPos();
 		FilePosition getEpdPos();
+		QString indexFileName() const;
+		bool mapIndex();
+		void saveIndex(const QVector<FilePosition>& positions) const;
+		void clearIndex();
+		const FilePosition& filePosition(int index) const;
+		void preload();
+		void filePositions(QVector<FilePosition>* positions);
+		bool readGame(PgnGame* game, int* index);
+		QVariantMap streamState() const;
+		bool seekState(const QVariantMap& state);
+		void stopPrefetch();
+		QIODevice* readSource() const;
+		int preloadedIndex(qint64 pos) const;
+		static bool filePositionLessThan(const FilePosition& a,
+						 const FilePosition& b);
 
 		Format m_format;
 		Order m_order;
 		int m_gamesRead;
 		int m_gameIndex;
 		int m_startIndex;
+		int m_lastIndex;
+		int m_nextIndex;
 		QString m_fileName;
-		QFile* m_file;
+		QString m_indexDir;
+		QIODevice* m_source;
+		QIODevice* m_file;
 		QTextStream* m_epdStream;
 		PgnStream* m_pgnStream;
-		QVector<FilePosition> m_filePositions;
+		QFile* m_indexFile;
+		const FilePosition* m_positions;
+		int m_positionCount;
+		QVector<FilePosition> m_positionData;
+		QVector<int> m_fileIndexes;
+		QVector<PgnGame> m_games;
+		QVector<FilePosition> m_gamePositions;
+		QByteArray m_randomState;
+		Prefetcher* m_prefetcher;
 };
 
 #endif // OPENINGSUITE_H
@@ -19,10 +19,52 @@
 #include <QStringList>
 #include <QFile>
 #include <QMetaObject>
+#include <QtAlgorithms>
+#include "allocationstats.h"
 #include "board/boardfactory.h"
 #include "econode.h"
 #include "pgnstream.h"
 
+namespace {
+
+const char* s_rosterTags[] =
+{
+	"Event", "Site", "Date", "Round", "White", "Black", "Result"
+};
+
+typedef QVector< QPair<QString, QString> > TagVector;
+
+int rosterIndex(const QString& tag)
+{
+	for (int i = 0; i < 7; i++)
+	{
+		if (tag == QLatin1String(s_rosterTags[i]))
+			return i;
+	}
+
+	return -1;
+}
+
+// Returns the index of the first tag in \a tags that isn't less than \a tag
+template <typename T>
+int lowerBound(const TagVector& tags, const T& tag)
+{
+	int first = 0;
+	int last = tags.size();
+	while (first < last)
+	{
+		int mid = (first + last) / 2;
+		if (tags.at(mid).first < tag)
+			first = mid + 1;
+		else
+			last = mid;
+	}
+
+	return first;
+}
+
+} // anonymous namespace
+
 PgnStream& operator>>(PgnStream& in, PgnGame& game)
 {
 	game.read(in);
@@ -45,15 +87,35 @@ PgnGame::PgnGame()
 
 bool PgnGame::isNull() const
 {
-	return (m_tags.isEmpty() && m_moves.isEmpty());
+	return (!hasTags() && m_moves.isEmpty() && m_moveTokens.isEmpty());
+}
+
+void PgnGame::swap(PgnGame& other)
+{
+	qSwap(m_startingSide, other.m_startingSide);
+	qSwap(m_eco, other.m_eco);
+	for (int i = 0; i < RosterSize; i++)
+		qSwap(m_roster[i], other.m_roster[i]);
+	qSwap(m_extraTags, other.m_extraTags);
+	qSwap(m_moves, other.m_moves);
+	qSwap(m_variations, other.m_variations);
+	qSwap(m_variationNodes, other.m_variationNodes);
+	qSwap(m_variationComments, other.m_variationComments);
+	qSwap(m_moveTokens, other.m_moveTokens);
 }
 
 void PgnGame::clear()
 {
 	m_startingSide = Chess::Side();
 	m_eco = EcoNode::root();
-	m_tags.clear();
+	for (int i = 0; i < RosterSize; i++)
+		m_roster[i].clear();
+	m_extraTags.clear();
 	m_moves.clear();
+	m_moveTokens.clear();
+	m_variations.clear();
+	m_variationNodes.clear();
+	m_variationComments.clear();
 }
 
 QList< QPair<QString, QString> > PgnGame::tags() const
@@ -61,23 +123,16 @@ QList< QPair<QString, QString> > PgnGame::tags() const
 	QList< QPair<QString, QString> > list;
 
 	// The seven tag roster
-	QStringList roster;
-	roster << "Event" << "Site" << "Date" << "Round"
-	       << "White" << "Black" << "Result";
-	foreach (const QString& tag, roster)
+	for (int i = 0; i < RosterSize; i++)
 	{
-		QString value = m_tags.value(tag);
+		QString value = m_roster[i];
 		if (value.isEmpty())
 			value = "?";
-		list.append(qMakePair(tag, value));
+		list.append(qMakePair(QString(s_rosterTags[i]), value));
 	}
 
-	QMap<QString, QString>::const_iterator it;
-	for (it = m_tags.constBegin(); it != m_tags.constEnd(); ++it)
-	{
-		if (!roster.contains(it.key()) && !it.value().isEmpty())
-			list.append(qMakePair(it.key(), it.value()));
-	}
+	for (int i = 0; i < m_extraTags.size(); i++)
+		list.append(m_extraTags.at(i));
 
 	return list;
 }
@@ -87,19 +142,185 @@ const QVector<PgnGame::MoveData>& PgnGame::moves() const
 	return m_moves;
 }
 
+void PgnGame::addMove(const MoveData& data, const QString& moveString)
+{
+	m_moves.append(data);
+	updateEco(moveString);
+}
+
 void PgnGame::addMove(const MoveData& data)
 {
 	m_moves.append(data);
+	m_eco = 0;
+}
+
+bool PgnGame::isFollowingOpening() const
+{
+	return m_eco != 0 && isStandard();
+}
+
+void PgnGame::truncateMoves(int count)
+{
+	Q_ASSERT(count >= 0);
+
+	if (count < m_moves.size())
+		m_moves.resize(count);
+
+	int variations = m_variations.size();
+	while (variations > 0 && m_variations.at(variations - 1).first >= count)
+		variations--;
+	m_variations.resize(variations);
+}
+
+void PgnGame::setMoveComment(int ply, const QString& comment)
+{
+	Q_ASSERT(ply >= 0 && ply < m_moves.size());
+	m_moves[ply].comment = comment;
+}
+
+bool PgnGame::hasVariations() const
+{
+	return !m_variations.isEmpty();
+}
+
+int PgnGame::variation(int ply) const
+{
+	QVector< QPair<int, int> >::const_iterator it;
+	it = qLowerBound(m_variations.constBegin(), m_variations.constEnd(),
+			 qMakePair(ply, INT_MIN));
+	if (it != m_variations.constEnd() && it->first == ply)
+		return it->second;
+	return -1;
+}
+
+const PgnGame::VariationNode& PgnGame::variationNode(int index) const
+{
+	return m_variationNodes.at(index);
+}
+
+QString PgnGame::variationComment(int index) const
+{
+	const VariationNode& node = m_variationNodes.at(index);
+	return m_variationComments.mid(node.commentPos, node.commentSize);
+}
+
+int PgnGame::addVariation(int ply, const MoveData& data)
+{
+	Q_ASSERT(ply >= 0 && ply < m_moves.size());
+
+	int first = variation(ply);
+	if (first != -1)
+		return addAlternative(first, data);
+
+	int index = addVariationNode(data);
+	QPair<int, int> entry(ply, index);
+	m_variations.insert(qLowerBound(m_variations.begin(),
+					m_variations.end(), entry), entry);
+	return index;
+}
+
+int PgnGame::addAlternative(int index, const MoveData& data)
+{
+	Q_ASSERT(index >= 0 && index < m_variationNodes.size());
+
+	// The alternatives are kept in the order they were added
+	int node = addVariationNode(data);
+	while (m_variationNodes.at(index).alternative != -1)
+		index = m_variationNodes.at(index).alternative;
+	m_variationNodes[index].alternative = node;
+	return node;
+}
+
+int PgnGame::addVariationMove(int index, const MoveData& data)
+{
+	Q_ASSERT(index >= 0 && index < m_variationNodes.size());
+	Q_ASSERT(m_variationNodes.at(index).next == -1);
+
+	int node = addVariationNode(data);
+	m_variationNodes[index].next = node;
+	return node;
+}
+
+int PgnGame::addVariationNode(const MoveData& data)
+{
+	VariationNode node =
+	{
+		data.key, data.move, -1, -1, m_variationComments.size(), 0
+	};
+	m_variationNodes.append(node);
+
+	int index = m_variationNodes.size() - 1;
+	if (!data.comment.isEmpty())
+		appendVariationComment(index, data.comment);
+	return index;
+}
+
+void PgnGame::appendVariationComment(int index, const QString& comment)
+{
+	VariationNode& node = m_variationNodes[index];
+
+	// Comments are usually appended to the newest move, whose comment
+	// is at the end of the storage. Otherwise it's moved there first.
+	if (node.commentPos + node.commentSize != m_variationComments.size())
+	{
+		const QString old(variationComment(index));
+		node.commentPos = m_variationComments.size();
+		m_variationComments.append(old);
+	}
+	m_variationComments.append(comment);
+	node.commentSize += comment.size();
+}
+
+void PgnGame::updateEco(const QString& moveString)
+{
+	m_eco = (m_eco && isStandard()) ? m_eco->child(moveString) : 0;
+	setEcoTags(m_eco);
+}
 
-	m_eco = (m_eco && isStandard()) ? m_eco->child(data.moveString) : 0;
-	if (m_eco && m_eco->isLeaf())
+void PgnGame::setEcoTags(const EcoNode* node)
+{
+	if (node && node->isLeaf())
 	{
-		setTag("ECO", m_eco->ecoCode());
-		setTag("Opening", m_eco->opening());
-		setTag("Variation", m_eco->variation());
+		setTag("ECO", node->ecoCode());
+		setTag("Opening", node->opening());
+		setTag("Variation", node->variation());
 	}
 }
 
+const EcoNode* PgnGame::ecoNodeFromPositions() const
+{
+	if (!isStandard() || m_moves.isEmpty())
+		return 0;
+
+	// The key of each move is the position after the previous
+	// move, so only the final position needs a board
+	int plies = qMin(m_moves.size(), EcoNode::maxDepth());
+	if (plies == m_moves.size())
+	{
+		Chess::Board* board = createBoard();
+		if (board == 0)
+			return 0;
+
+		foreach (const MoveData& md, m_moves)
+			board->makeMove(board->moveFromGenericMove(md.move));
+		const EcoNode* node = EcoNode::find(board->key());
+		delete board;
+
+		if (node != 0)
+			return node;
+		plies--;
+	}
+
+	for (; plies > 0; plies--)
+	{
+		const EcoNode* node = EcoNode::find(m_moves.at(plies).key);
+		if (node != 0)
+			return node;
+	}
+
+	return 0;
+}
+
 Chess::Board* PgnGame::createBoard() const
 {
 	Chess::Board* board = Chess::BoardFactory::create(variant());
@@ -125,9 +346,112 @@ Chess::Board* PgnGame::createBoard() const
 	return board;
 }
 
+// Returns \a move in coordinate notation without looking at the
+// position. \a board, if not null, gives the piece symbols.
+static QString coordinateMoveString(const Chess::Board* board,
+				    const Chess::GenericMove& move)
+{
+	QString symbol;
+	if (board != 0 && move.promotion() != Chess::Piece::NoPiece)
+		symbol = board->pieceSymbol(Chess::Piece(Chess::Side::White,
+							 move.promotion()));
+
+	QString str;
+	const Chess::Square source(move.sourceSquare());
+	const Chess::Square target(move.targetSquare());
+	if (!source.isValid())
+		str += symbol.toUpper() + '@';
+	else
+	{
+		str += QChar('a' + source.file());
+		str += QString::number(source.rank() + 1);
+	}
+	str += QChar('a' + target.file());
+	str += QString::number(target.rank() + 1);
+
+	if (source.isValid())
+		str += symbol.toLower();
+	return str;
+}
+
+QStringList PgnGame::moveStrings() const
+{
+	QStringList list;
+	if (m_moves.isEmpty())
+		return list;
+
+	Chess::Board* board = createBoard();
+	if (board == 0)
+		qWarning("Can't create a board for the game");
+
+	// The rest of the moves are written in coordinate notation
+	// after an illegal move, so that none of them are lost
+	bool legal = (board != 0);
+	foreach (const MoveData& md, m_moves)
+	{
+		if (legal)
+		{
+			Chess::Move move(board->moveFromGenericMove(md.move));
+			legal = !move.isNull() && board->isLegalMove(move);
+			if (legal)
+			{
+				list << board->moveString(move, Chess::Board::StandardAlgebraic);
+				board->makeMove(move);
+				continue;
+			}
+			qWarning("Illegal move in game: move %d", list.size() + 1);
+		}
+		list << coordinateMoveString(board, md.move);
+	}
+
+	delete board;
+	return list;
+}
+
+const QStringList& PgnGame::moveTokens() const
+{
+	return m_moveTokens;
+}
+
+bool PgnGame::resolveMoves()
+{
+	if (m_moveTokens.isEmpty())
+		return true;
+
+	Chess::Board* board = createBoard();
+	if (board == 0)
+	{
+		qWarning("Can't create a board for the game");
+		return false;
+	}
+	m_startingSide = board->startingSide();
+
+	bool ok = true;
+	foreach (const QString& str, m_moveTokens)
+	{
+		Chess::Move move(board->moveFromString(str));
+		if (move.isNull())
+		{
+			qDebug("Illegal move: %s", qPrintable(str));
+			ok = false;
+			break;
+		}
+
+		MoveData md = { board->key(), board->genericMove(move), QString() };
+		m_moves.append(md);
+		board->makeMove(move);
+	}
+
+	delete board;
+	m_moveTokens.clear();
+	setTag("PlyCount", QString::number(m_moves.size()));
+
+	return ok;
+}
+
 bool PgnGame::parseMove(PgnStream& in)
 {
-	if (m_tags.isEmpty())
+	if (!hasTags())
 	{
 		qDebug("No tags found");
 		return false;
@@ -139,7 +463,7 @@ bool PgnGame::parseMove(PgnStream& in)
 	// set the board when we get the first move
 	if (m_moves.isEmpty())
 	{
-		QString tmp(m_tags.value("Variant"));
+		QString tmp(extraTag("Variant"));
 
 		if (!tmp.isEmpty() && !in.setVariant(tmp))
 		{
@@ -150,7 +474,7 @@ bool PgnGame::parseMove(PgnStream& in)
 		if (tmp.isEmpty() && board->variant() != "standard")
 			setTag("Variant", board->variant());
 
-		tmp = m_tags.value("FEN");
+		tmp = extraTag("FEN");
 		if (tmp.isEmpty())
 		{
 			if (board->isRandomVariant())
@@ -177,19 +501,100 @@ bool PgnGame::parseMove(PgnStream& in)
 		return false;
 	}
 
-	MoveData md = { board->key(), board->genericMove(move),
-			str, QString() };
-	addMove(md);
+	MoveData md = { board->key(), board->genericMove(move), QString() };
+	m_moves.append(md);
 
+	// The board is available, so the opening is classified by
+	// position instead of walking the ECO tree with the move strings
 	board->makeMove(move);
+	if (m_moves.size() <= EcoNode::maxDepth() && isStandard())
+		setEcoTags(EcoNode::find(board->key()));
 	return true;
 }
 
-bool PgnGame::read(PgnStream& in, int maxMoves)
+void PgnGame::startVariation(PgnStream& in, QVector<VariationFrame>& frames)
+{
+	// The variation replaces the last move of the current line
+	VariationFrame frame = { -1, m_moves.size() - 1, -1, 0, false, false };
+	if (frames.isEmpty())
+		frame.skip = m_moves.isEmpty();
+	else
+	{
+		const VariationFrame& parent = frames.last();
+		frame.anchor = parent.last;
+		frame.skip = parent.skip || parent.last == -1;
+	}
+
+	if (!frame.skip)
+	{
+		in.board()->undoMove();
+		frame.undone = true;
+	}
+	frames.append(frame);
+}
+
+void PgnGame::endVariation(PgnStream& in, QVector<VariationFrame>& frames)
+{
+	if (frames.isEmpty())
+		return;
+
+	const VariationFrame frame(frames.last());
+	frames.remove(frames.size() - 1);
+
+	Chess::Board* board(in.board());
+	for (int i = 0; i < frame.depth; i++)
+		board->undoMove();
+
+	if (frame.undone)
+	{
+		const Chess::GenericMove& move = (frame.anchor == -1)
+			? m_moves.at(frame.ply).move
+			: m_variationNodes.at(frame.anchor).move;
+		board->makeMove(board->moveFromGenericMove(move));
+	}
+}
+
+void PgnGame::parseVariationMove(PgnStream& in, VariationFrame& frame)
 {
+	if (frame.skip)
+		return;
+
+	Chess::Board* board(in.board());
+	const QString str(in.tokenString());
+	Chess::Move move(board->moveFromString(str));
+	if (move.isNull())
+	{
+		// The mainline is still read
+		qDebug("Illegal move in variation: %s", qPrintable(str));
+		frame.skip = true;
+		return;
+	}
+
+	MoveData md = { board->key(), board->genericMove(move), QString() };
+	if (frame.last != -1)
+		frame.last = addVariationMove(frame.last, md);
+	else if (frame.anchor != -1)
+		frame.last = addAlternative(frame.anchor, md);
+	else
+		frame.last = addVariation(frame.ply, md);
+
+	board->makeMove(move);
+	frame.depth++;
+}
+
+bool PgnGame::read(PgnStream& in, int maxMoves, ReadMode mode)
+{
+	ALLOCATION_SCOPE(Pgn);
+
 	clear();
 	if (!in.nextGame())
 		return false;
+
+	// Variations are only read with a board. Games without them
+	// take the same path as before.
+	QVector<VariationFrame> frames;
+	const bool variationTokens = in.variationTokensEnabled();
+	in.setVariationTokensEnabled(mode == ReadFull);
 	
 	while (in.status() == PgnStream::Ok)
 	{
@@ -201,21 +606,50 @@ bool PgnGame::read(PgnStream& in, int maxMoves)
 			setTag(in.tagName(), in.tagValue());
 			break;
 		case PgnStream::PgnMove:
-			stop = !parseMove(in) || m_moves.size() >= maxMoves;
+			if (mode == ReadHeaders)
+			{
+				// The rest of the movetext is skipped by
+				// PgnStream::nextGame()
+				stop = true;
+			}
+			else if (mode == ReadMoveTokens)
+			{
+				const QString str(in.tokenString());
+				m_moveTokens.append(str);
+				updateEco(str);
+				stop = m_moveTokens.size() >= maxMoves;
+			}
+			else if (!frames.isEmpty())
+				parseVariationMove(in, frames.last());
+			else
+				stop = !parseMove(in) || m_moves.size() >= maxMoves;
 			break;
 		case PgnStream::PgnComment:
-			if (!m_moves.isEmpty())
+			if (!frames.isEmpty())
+			{
+				const VariationFrame& frame = frames.last();
+				if (frame.last != -1 && !frame.skip)
+					appendVariationComment(frame.last,
+							       QString(in.tokenString()));
+			}
+			else if (!m_moves.isEmpty())
 				m_moves.last().comment.append(in.tokenString());
 			break;
+		case PgnStream::PgnVariationStart:
+			startVariation(in, frames);
+			break;
+		case PgnStream::PgnVariationEnd:
+			endVariation(in, frames);
+			break;
 		case PgnStream::PgnResult:
 			{
 				const QString str(in.tokenString());
-				QString result = m_tags.value("Result");
+				const QString& result = m_roster[ResultTag];
 
 				if (!result.isEmpty() && str != result)
 					qDebug("%s",qPrintable(QString("Line %1: The termination "
 						"marker is different from the result tag").arg(in.lineNumber())));
-				setTag("Result", str);
+				setRosterTag(ResultTag, str);
 			}
 			stop = true;
 			break;
@@ -237,141 +671,362 @@ bool PgnGame::read(PgnStream& in, int maxMoves)
 		if (stop)
 			break;
 	}
-	if (m_tags.isEmpty())
+
+	// Unterminated variations are closed to restore the board
+	while (!frames.isEmpty())
+		endVariation(in, frames);
+	in.setVariationTokensEnabled(variationTokens);
+
+	if (!hasTags())
 		return false;
 
-	setTag("PlyCount", QString::number(m_moves.size()));
+	if (mode != ReadFull)
+	{
+		// Without a board the starting side comes from the FEN tag
+		QString fen(extraTag("FEN"));
+		if (!fen.isEmpty())
+			m_startingSide = Chess::Side(fen.section(' ', 1, 1));
+		else
+			m_startingSide = Chess::Side::White;
+	}
+	if (mode == ReadHeaders)
+		return true;
+
+	setTag("PlyCount", QString::number(m_moves.size() + m_moveTokens.size()));
 
 	return true;
 }
 
-static void writeTag(QTextStream& out, const QString& tag, const QString& value)
+// Appends \a str to \a out in UTF-8 and returns its length in characters
+static int appendText(QByteArray& out, const QString& str)
 {
+	const QChar* data = str.constData();
+	const int size = str.size();
+	for (int i = 0; i < size; i++)
+	{
+		if (data[i].unicode() >= 0x80)
+		{
+			out.append(str.toUtf8());
+			return size;
+		}
+	}
+
+	// Plain ASCII, which is what almost all PGN data is
+	for (int i = 0; i < size; i++)
+		out.append(char(data[i].unicode()));
+	return size;
+}
+
+static int appendText(QByteArray& out, const char* str)
+{
+	int size = int(qstrlen(str));
+	out.append(str, size);
+	return size;
+}
+
+static void appendNumber(QByteArray& out, int number)
+{
+	char buf[12];
+	char* p = buf + sizeof(buf);
+	unsigned n = unsigned(qAbs(number));
+	do
+	{
+		*--p = char('0' + n % 10);
+		n /= 10;
+	} while (n != 0);
+	if (number < 0)
+		*--p = '-';
+	out.append(p, int(buf + sizeof(buf) - p));
+}
+
+// Appends \a token of \a length characters to \a out, and starts a new
+// line first if the current line would reach 80 characters
+static void appendToken(QByteArray& out,
+			const QByteArray& token,
+			int length,
+			int* lineLength)
+{
+	if (*lineLength == 0 || *lineLength + length >= 80)
+	{
+		out.append('\n');
+		*lineLength = length;
+	}
+	else
+	{
+		out.append(' ');
+		*lineLength += length + 1;
+	}
+	out.append(token);
+}
+
+template <typename T>
+static void writeTag(QByteArray& out, const T& tag, const QString& value)
+{
+	out.append('[');
+	appendText(out, tag);
 	if (!value.isEmpty())
-		out << "[" << tag << " \"" << value << "\"]\n";
+	{
+		out.append(" \"", 2);
+		appendText(out, value);
+		out.append("\"]\n", 3);
+	}
 	else
-		out << "[" << tag << " \"?\"]\n";
+		out.append(" \"?\"]\n", 6);
 }
 
 void PgnGame::write(QTextStream& out, PgnMode mode) const
 {
-	if (m_tags.isEmpty())
+	QByteArray data;
+	write(data, mode);
+	out << QString::fromUtf8(data.constData(), data.size());
+}
+
+void PgnGame::write(QByteArray& out, PgnMode mode) const
+{
+	ALLOCATION_SCOPE(Pgn);
+
+	if (!hasTags())
 		return;
-	
-	const QList< QPair<QString, QString> > tags = this->tags();
-	int maxTags = (mode == Verbose) ? tags.size() : 7;
-	for (int i = 0; i < maxTags; i++)
-		writeTag(out, tags.at(i).first, tags.at(i).second);
-	
-	if (mode == Minimal && m_tags.contains("FEN"))
+
+	for (int i = 0; i < RosterSize; i++)
+		writeTag(out, s_rosterTags[i], m_roster[i]);
+
+	if (mode == Verbose)
 	{
-		writeTag(out, "FEN", m_tags["FEN"]);
-		writeTag(out, "SetUp", m_tags["SetUp"]);
+		for (int i = 0; i < m_extraTags.size(); i++)
+			writeTag(out, m_extraTags.at(i).first,
+				 m_extraTags.at(i).second);
+
+		// Games that weren't classified by the move strings, eg. because
+		// of a transposition, are classified by position when written
+		if (extraTag("ECO").isEmpty())
+		{
+			const EcoNode* node = ecoNodeFromPositions();
+			if (node != 0)
+			{
+				writeTag(out, "ECO", node->ecoCode());
+				writeTag(out, "Opening", node->opening());
+				if (!node->variation().isEmpty())
+					writeTag(out, "Variation", node->variation());
+			}
+		}
+	}
+	else
+	{
+		QString fen(extraTag("FEN"));
+		if (!fen.isEmpty())
+		{
+			writeTag(out, "FEN", fen);
+			writeTag(out, "SetUp", extraTag("SetUp"));
+		}
 	}
 
-	QString str;
+	const QStringList moves(moveStrings());
+	QByteArray token;
+	token.reserve(32);
 	int lineLength = 0;
 	int movenum = 0;
 	int side = m_startingSide;
 
-	for (int i = 0; i < m_moves.size(); i++)
+	// The variations are written with the help of a board
+	Chess::Board* board = 0;
+	if (mode == Verbose && hasVariations())
+		board = createBoard();
+	bool needNumber = false;
+
+	for (int i = 0; i < moves.size(); i++)
 	{
 		const MoveData& data = m_moves.at(i);
 
-		str.clear();
-		if (i == 0 && side == Chess::Side::Black)
-			str = QString::number(++movenum) + "... ";
-		else if (side == Chess::Side::White)
-			str = QString::number(++movenum) + ". ";
+		token.resize(0);
+		if (side == Chess::Side::White)
+		{
+			appendNumber(token, ++movenum);
+			token.append(". ", 2);
+		}
+		else if (i == 0)
+		{
+			appendNumber(token, ++movenum);
+			token.append("... ", 4);
+		}
+		else if (needNumber)
+		{
+			appendNumber(token, movenum);
+			token.append("... ", 4);
+		}
 
-		str += data.moveString;
+		// The line length is counted in characters, not bytes
+		int length = token.size() + appendText(token, moves.at(i));
 		if (mode == Verbose && !data.comment.isEmpty())
-			str += QString(" {%1}").arg(data.comment);
-
-		// Limit the lines to 80 characters
-		if (lineLength == 0 || lineLength + str.size() >= 80)
 		{
-			out << "\n" << str;
-			lineLength = str.size();
+			token.append(" {", 2);
+			length += appendText(token, data.comment) + 3;
+			token.append('}');
 		}
-		else
+
+		appendToken(out, token, length, &lineLength);
+		needNumber = false;
+
+		if (board != 0)
 		{
-			out << " " << str;
-			lineLength += str.size() + 1;
+			int index = variation(i);
+			if (index != -1)
+			{
+				writeVariations(out, &lineLength, board, index, i);
+				needNumber = true;
+			}
+			board->makeMove(board->moveFromGenericMove(data.move));
 		}
 
 		side = !side;
 	}
-	str = m_tags.value("Result");
-	if (lineLength + str.size() >= 80)
-		out << "\n" << str << "\n\n";
-	else
-		out << " " << str << "\n\n";
+	delete board;
+
+	const QString& result = m_roster[ResultTag];
+	out.append((lineLength + result.size() >= 80) ? '\n' : ' ');
+	appendText(out, result);
+	out.append("\n\n", 2);
+}
+
+void PgnGame::writeVariations(QByteArray& out,
+			      int* lineLength,
+			      Chess::Board* board,
+			      int index,
+			      int ply) const
+{
+	// The board is in the position before the replaced move
+	const int offset = (m_startingSide == Chess::Side::Black) ? 1 : 0;
+	QByteArray token;
+
+	for (int first = index; first != -1;
+	     first = m_variationNodes.at(first).alternative)
+	{
+		int depth = 0;
+		bool needNumber = true;
+
+		for (int i = first; i != -1; i = m_variationNodes.at(i).next)
+		{
+			const VariationNode& node = m_variationNodes.at(i);
+			Chess::Move move(board->moveFromGenericMove(node.move));
+			if (move.isNull() || !board->isLegalMove(move))
+				break;
+
+			const int moveIndex = ply + depth + offset;
+			const bool white = (moveIndex % 2 == 0);
+			token.resize(0);
+			if (i == first)
+				token.append('(');
+			if (white || needNumber)
+			{
+				appendNumber(token, moveIndex / 2 + 1);
+				token.append(white ? ". " : "... ");
+			}
+
+			int length = token.size() + appendText(token,
+				board->moveString(move, Chess::Board::StandardAlgebraic));
+			if (node.commentSize > 0)
+			{
+				token.append(" {", 2);
+				length += appendText(token, variationComment(i)) + 3;
+				token.append('}');
+			}
+			appendToken(out, token, length, lineLength);
+			needNumber = false;
+
+			// The alternatives to the first move were written
+			// by the caller
+			if (i != first && node.alternative != -1)
+			{
+				writeVariations(out, lineLength, board,
+						node.alternative, ply + depth);
+				needNumber = true;
+			}
+
+			board->makeMove(move);
+			depth++;
+		}
+
+		if (depth > 0)
+		{
+			out.append(')');
+			(*lineLength)++;
+		}
+		for (int i = 0; i < depth; i++)
+			board->undoMove();
+	}
 }
 
 bool PgnGame::write(const QString& filename, PgnMode mode) const
 {
-	if (m_tags.isEmpty())
+	if (!hasTags())
 		return false;
 
 	QFile file(filename);
 	if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
 		return false;
 
-	QTextStream out(&file);
-	write(out, mode);
-	return true;
+	QByteArray data;
+	write(data, mode);
+	return file.write(data) == data.size();
 }
 
 bool PgnGame::isStandard() const
 {
-	return variant() == "standard" && !m_tags.contains("FEN");
+	return variant() == "standard" && extraTag("FEN").isEmpty();
 }
 
 QString PgnGame::tagValue(const QString& tag) const
 {
-	return m_tags.value(tag);
+	int i = rosterIndex(tag);
+	if (i != -1)
+		return m_roster[i];
+
+	i = lowerBound(m_extraTags, tag);
+	if (i < m_extraTags.size() && m_extraTags.at(i).first == tag)
+		return m_extraTags.at(i).second;
+	return QString();
 }
 
 QString PgnGame::event() const
 {
-	return m_tags.value("Event");
+	return m_roster[EventTag];
 }
 
 QString PgnGame::site() const
 {
-	return m_tags.value("Site");
+	return m_roster[SiteTag];
 }
 
 QDate PgnGame::date() const
 {
-	return QDate::fromString(m_tags.value("Date"), "yyyy.MM.dd");
+	return QDate::fromString(m_roster[DateTag], "yyyy.MM.dd");
 }
 
 int PgnGame::round() const
 {
-	return m_tags.value("Round").toInt();
+	return m_roster[RoundTag].toInt();
 }
 
 QString PgnGame::playerName(Chess::Side side) const
 {
 	if (side == Chess::Side::White)
-		return m_tags.value("White");
+		return m_roster[WhiteTag];
 	else if (side == Chess::Side::Black)
-		return m_tags.value("Black");
+		return m_roster[BlackTag];
 
 	return QString();
 }
 
 Chess::Result PgnGame::result() const
 {
-	return Chess::Result(m_tags.value("Result"));
+	return Chess::Result(m_roster[ResultTag]);
 }
 
 QString PgnGame::variant() const
 {
-	if (m_tags.contains("Variant"))
-		return m_tags.value("Variant");
+	QString variant(extraTag("Variant"));
+	if (!variant.isEmpty())
+		return variant;
 	return "standard";
 }
 
@@ -382,54 +1037,102 @@ Chess::Side PgnGame::startingSide() const
 
 QString PgnGame::startingFenString() const
 {
-	return m_tags.value("FEN");
+	return extraTag("FEN");
+}
+
+bool PgnGame::hasTags() const
+{
+	if (!m_extraTags.isEmpty())
+		return true;
+	for (int i = 0; i < RosterSize; i++)
+	{
+		if (!m_roster[i].isEmpty())
+			return true;
+	}
+
+	return false;
+}
+
+QString PgnGame::extraTag(const char* tag) const
+{
+	QLatin1String name(tag);
+	int i = lowerBound(m_extraTags, name);
+	if (i < m_extraTags.size() && m_extraTags.at(i).first == name)
+		return m_extraTags.at(i).second;
+	return QString();
+}
+
+void PgnGame::setRosterTag(RosterTag tag, const QString& value)
+{
+	m_roster[tag] = value;
+	if (m_tagReceiver)
+		emitTag(s_rosterTags[tag], value);
+}
+
+void PgnGame::emitTag(const QString& tag, const QString& value)
+{
+	QMetaObject::invokeMethod(m_tagReceiver, "setTag",
+				  Qt::QueuedConnection,
+				  Q_ARG(QString, tag),
+				  Q_ARG(QString, value));
 }
 
 void PgnGame::setTag(const QString& tag, const QString& value)
 {
+	int i = rosterIndex(tag);
+	if (i != -1)
+	{
+		setRosterTag(RosterTag(i), value);
+		return;
+	}
+
+	i = lowerBound(m_extraTags, tag);
+	bool found = (i < m_extraTags.size() && m_extraTags.at(i).first == tag);
 	if (value.isEmpty())
-		m_tags.remove(tag);
+	{
+		if (found)
+			m_extraTags.remove(i);
+	}
+	else if (found)
+		m_extraTags[i].second = value;
 	else
-		m_tags[tag] = value;
+		m_extraTags.insert(i, qMakePair(tag, value));
 
 	if (m_tagReceiver)
-		QMetaObject::invokeMethod(m_tagReceiver, "setTag",
-					  Qt::QueuedConnection,
-					  Q_ARG(QString, tag),
-					  Q_ARG(QString, value));
+		emitTag(tag, value);
 }
 
 void PgnGame::setEvent(const QString& event)
 {
-	setTag("Event", event);
+	setRosterTag(EventTag, event);
 }
 
 void PgnGame::setSite(const QString& site)
 {
-	setTag("Site", site);
+	setRosterTag(SiteTag, site);
 }
 
 void PgnGame::setDate(const QDate& date)
 {
-	setTag("Date", date.toString("yyyy.MM.dd"));
+	setRosterTag(DateTag, date.toString("yyyy.MM.dd"));
 }
 
 void PgnGame::setRound(int round)
 {
-	setTag("Round", QString::number(round));
+	setRosterTag(RoundTag, QString::number(round));
 }
 
 void PgnGame::setPlayerName(Chess::Side side, const QString& name)
 {
 	if (side == Chess::Side::White)
-		setTag("White", name);
+		setRosterTag(WhiteTag, name);
 	else if (side == Chess::Side::Black)
-		setTag("Black", name);
+		setRosterTag(BlackTag, name);
 }
 
 void PgnGame::setResult(const Chess::Result& result)
 {
-	setTag("Result", result.toShortString());
+	setRosterTag(ResultTag, result.toShortString());
 
 	switch (result.type())
 	{
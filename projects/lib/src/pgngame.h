@@ -18,8 +18,8 @@
 #ifndef PGNGAME_H
 #define PGNGAME_H
 
-#include <QMap>
 #include <QString>
+#include <QStringList>
 #include <QVector>
 #include <QList>
 #include <QPair>
@@ -28,6 +28,7 @@
 #include "board/genericmove.h"
 #include "board/result.h"
 class QTextStream;
+class QByteArray;
 class PgnStream;
 class EcoNode;
 class QObject;
@@ -59,33 +60,185 @@ class LIB_EXPORT PgnGame
 			//! Use additional data like extra tags and comments
 			Verbose
 		};
+		/*! The mode for reading PGN games. */
+		enum ReadMode
+		{
+			//! Read only the tags and skip the movetext
+			ReadHeaders,
+			//! Store the moves as unverified SAN tokens
+			ReadMoveTokens,
+			//! Verify the moves on a board and read the comments
+			ReadFull
+		};
 
-		/*! \brief A struct for storing the game's move history. */
+		/*!
+		 * \brief A struct for storing the game's move history.
+		 *
+		 * The move strings aren't stored with the moves because
+		 * they take a lot of memory in big game collections. They
+		 * can be generated with moveStrings() when needed.
+		 */
 		struct MoveData
 		{
 			/*! The zobrist position key before the move. */
 			quint64 key;
 			/*! The move in the "generic" format. */
 			Chess::GenericMove move;
-			/*! The move in Standard Algebraic Notation. */
-			QString moveString;
 			/*! A comment/annotation describing the move. */
 			QString comment;
 		};
 
+		/*!
+		 * \brief A move in a variation of the game.
+		 *
+		 * The variations (Recursive Annotation Variations) of a
+		 * game form a tree whose nodes are stored in one array per
+		 * game, and whose comments are stored in one string. The
+		 * nodes refer to each other by their indexes, so reading a
+		 * heavily annotated game doesn't allocate every move
+		 * separately. Games without variations don't allocate
+		 * anything for the tree.
+		 *
+		 * \sa variation(), variationNode()
+		 */
+		struct VariationNode
+		{
+			/*! The zobrist position key before the move. */
+			quint64 key;
+			/*! The move in the "generic" format. */
+			Chess::GenericMove move;
+			/*! The index of the next move in the variation, or -1. */
+			int next;
+			/*!
+			 * The index of the first move of the next alternative
+			 * to this move, or -1.
+			 */
+			int alternative;
+			//! The position of the comment in the comment storage
+			int commentPos;
+			//! The length of the comment
+			int commentSize;
+		};
+
 		/*! Creates a new PgnGame object. */
 		PgnGame();
 		/*! Returns true if the game doesn't contain any tags or moves. */
 		bool isNull() const;
 		/*! Deletes all tags and moves. */
 		void clear();
+		/*!
+		 * Swaps the tags, moves and variations of this game with
+		 * \a other.
+		 *
+		 * This hands a finished game over without copying it.
+		 * The tag receivers aren't swapped.
+		 */
+		void swap(PgnGame& other);
 
 		/*! Returns the tags that are used to describe the game. */
 		QList< QPair<QString, QString> > tags() const;
 		/*! Returns the moves that were played in the game. */
 		const QVector<MoveData>& moves() const;
-		/*! Adds a new move to the game. */
+		/*!
+		 * Adds a new move to the game.
+		 *
+		 * \a moveString is the move in Standard Algebraic Notation.
+		 * It's only used for finding the game's opening, so it's
+		 * not stored.
+		 */
+		void addMove(const MoveData& data, const QString& moveString);
+		/*!
+		 * Adds a new move to the game without its move string.
+		 *
+		 * The opening isn't followed by the move strings after
+		 * this, so it's classified by the positions when the game
+		 * is written.
+		 *
+		 * \sa isFollowingOpening()
+		 */
 		void addMove(const MoveData& data);
+		/*!
+		 * Returns true if the opening is still followed by the
+		 * move strings passed to addMove(), ie. the game hasn't
+		 * left the ECO tree yet.
+		 */
+		bool isFollowingOpening() const;
+		/*!
+		 * Removes the moves after the first \a count moves.
+		 *
+		 * \note The tags, eg. the ECO code, aren't updated.
+		 */
+		void truncateMoves(int count);
+		/*!
+		 * Replaces the comment/annotation of the move at \a ply
+		 * with \a comment.
+		 */
+		void setMoveComment(int ply, const QString& comment);
+
+		/*! Returns true if the game has any variations. */
+		bool hasVariations() const;
+		/*!
+		 * Returns the index of the first move of the first variation
+		 * that replaces the mainline move at \a ply, or -1 if there
+		 * is no such variation.
+		 *
+		 * The other variations at \a ply are linked by the
+		 * VariationNode::alternative indexes.
+		 */
+		int variation(int ply) const;
+		/*! Returns the variation move at \a index. */
+		const VariationNode& variationNode(int index) const;
+		/*! Returns the comment of the variation move at \a index. */
+		QString variationComment(int index) const;
+		/*!
+		 * Adds a new variation that replaces the mainline move
+		 * at \a ply, and whose first move is \a data.
+		 *
+		 * Returns the index of the new variation move.
+		 */
+		int addVariation(int ply, const MoveData& data);
+		/*!
+		 * Adds \a data as an alternative to the variation move at
+		 * \a index, ie. as the first move of a new variation.
+		 *
+		 * Returns the index of the new variation move.
+		 */
+		int addAlternative(int index, const MoveData& data);
+		/*!
+		 * Adds \a data after the variation move at \a index, which
+		 * must be the last move of its variation.
+		 *
+		 * Returns the index of the new variation move.
+		 */
+		int addVariationMove(int index, const MoveData& data);
+		/*!
+		 * Returns the moves of the game in Standard Algebraic
+		 * Notation.
+		 *
+		 * The strings are generated by replaying the game on a
+		 * new board, so this function shouldn't be called after
+		 * every move. If the game can't be replayed, the moves from
+		 * the problem onwards are in coordinate notation.
+		 */
+		QStringList moveStrings() const;
+		/*!
+		 * Returns the moves that were read in \a ReadMoveTokens
+		 * mode and haven't been resolved yet.
+		 *
+		 * \sa resolveMoves()
+		 */
+		const QStringList& moveTokens() const;
+		/*!
+		 * Converts the move tokens to moves by replaying them on
+		 * a new board.
+		 *
+		 * The tokens are discarded afterwards. Returns false if the
+		 * board can't be created or a move is illegal, in which case
+		 * only the moves before the problem are kept.
+		 *
+		 * \sa moveTokens()
+		 */
+		bool resolveMoves();
 
 		/*!
 		 * Creates a board object for viewing or analyzing the game.
@@ -100,15 +253,28 @@ class LIB_EXPORT PgnGame
 		 *
 		 * \param in The PGN stream to read from.
 		 * \param maxMoves The maximum number of halfmoves to read.
+		 * \param mode How much of the game to read. Callers that
+		 * only need the tags or the move strings can skip the
+		 * move verification this way.
 		 *
 		 * \note Even if the stream contains multiple games,
 		 * only one will be read.
 		 *
 		 * Returns true if any tags and/or moves were read.
 		 */
-		bool read(PgnStream& in, int maxMoves = INT_MAX - 1);
+		bool read(PgnStream& in,
+			  int maxMoves = INT_MAX - 1,
+			  ReadMode mode = ReadFull);
 		/*! Writes the game to a text stream. */
 		void write(QTextStream& out, PgnMode mode = Verbose) const;
+		/*!
+		 * Appends the game to \a out in UTF-8.
+		 *
+		 * This is the fastest way to write many games because the
+		 * text is formatted directly into bytes. The same buffer
+		 * can be reused for each game by resizing it to zero.
+		 */
+		void write(QByteArray& out, PgnMode mode = Verbose) const;
 		/*!
 		 * Writes the game to a file.
 		 * If the file already exists, the game will be appended
@@ -189,12 +355,69 @@ class LIB_EXPORT PgnGame
 		void setTagReceiver(QObject* receiver);
 
 	private:
+		// The Seven Tag Roster, in PGN order
+		enum RosterTag
+		{
+			EventTag,
+			SiteTag,
+			DateTag,
+			RoundTag,
+			WhiteTag,
+			BlackTag,
+			ResultTag,
+			RosterSize
+		};
+
+		// A variation that's being read
+		struct VariationFrame
+		{
+			// The replaced variation move, or -1 for a mainline move
+			int anchor;
+			// The replaced mainline move
+			int ply;
+			// The last move of the variation, or -1
+			int last;
+			// The number of moves made on the board
+			int depth;
+			// True if the replaced move was taken back
+			bool undone;
+			// True if the rest of the variation is skipped
+			bool skip;
+		};
+
 		bool parseMove(PgnStream& in);
+		void startVariation(PgnStream& in,
+				    QVector<VariationFrame>& frames);
+		void endVariation(PgnStream& in,
+				  QVector<VariationFrame>& frames);
+		void parseVariationMove(PgnStream& in, VariationFrame& frame);
+		int addVariationNode(const MoveData& data);
+		void appendVariationComment(int index, const QString& comment);
+		void writeVariations(QByteArray& out,
+				     int* lineLength,
+				     Chess::Board* board,
+				     int index,
+				     int ply) const;
+		void updateEco(const QString& moveString);
+		void setEcoTags(const EcoNode* node);
+		const EcoNode* ecoNodeFromPositions() const;
+		bool hasTags() const;
+		QString extraTag(const char* tag) const;
+		void setRosterTag(RosterTag tag, const QString& value);
+		void emitTag(const QString& tag, const QString& value);
 		
 		Chess::Side m_startingSide;
 		const EcoNode* m_eco;
-		QMap<QString, QString> m_tags;
+		QString m_roster[RosterSize];
+		// The other tags, sorted by name
+		QVector< QPair<QString, QString> > m_extraTags;
 		QVector<MoveData> m_moves;
+		// The first variation of each mainline move that has them,
+		// sorted by ply
+		QVector< QPair<int, int> > m_variations;
+		QVector<VariationNode> m_variationNodes;
+		QString m_variationComments;
+		QStringList m_moveTokens;
 		QObject* m_tagReceiver;
 };
 
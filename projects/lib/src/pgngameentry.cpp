@@ -100,18 +100,39 @@ static int s_stringToInt(const char *s, int size)
 
 bool PgnGameEntry::match(const PgnGameFilter& filter) const
 {
-	const char* data = m_data.constData();
+	if (filter.type() == PgnGameFilter::FixedString)
+		return s_stringContains(m_data.constData(), filter.pattern(),
+					m_data.size()) != -1;
+
+	const char* tags[8];
+	int sizes[8];
+	for (int type = 0; type < 8; type++)
+		tags[type] = tagData(TagType(type), &sizes[type]);
 
+	return matchTags(filter, tags, sizes);
+}
+
+bool PgnGameEntry::matchTags(const PgnGameFilter& filter,
+			     const char* const* tags,
+			     const int* sizes)
+{
 	if (filter.type() == PgnGameFilter::FixedString)
-		return s_stringContains(data, filter.pattern(), m_data.size()) != -1;
+	{
+		for (int type = 0; type < 8; type++)
+		{
+			if (s_stringContains(tags[type], filter.pattern(),
+					     sizes[type]) != -1)
+				return true;
+		}
+		return false;
+	}
 
 	int whitePlayer = 0;
 
-	int i = 0;
 	for (int type = 0; type < 8; type++)
 	{
-		int size = data[i++];
-		const char* str = data + i;
+		int size = sizes[type];
+		const char* str = tags[type];
 
 		switch (type)
 		{
@@ -243,7 +264,6 @@ bool PgnGameEntry::match(const PgnGameFilter& filter) const
 		default:
 			break;
 		}
-		i += size;
 	}
 
 	return true;
@@ -366,12 +386,27 @@ qint64 PgnGameEntry::lineNumber() const
 
 QString PgnGameEntry::tagValue(TagType type) const
 {
+	int size;
+	const char* data = tagData(type, &size);
+	if (size == 0)
+		return QString();
+	return QByteArray(data, size);
+}
+
+const char* PgnGameEntry::tagData(TagType type, int* size) const
+{
+	Q_ASSERT(size != 0);
+
+	if (m_data.isEmpty())
+	{
+		*size = 0;
+		return "";
+	}
+
 	int i = 0;
 	for (int j = 0; j < type; j++)
 		i += m_data[i] + 1;
 
-	int size = m_data[i];
-	if (size == 0)
-		return QString();
-	return m_data.mid(i + 1, size);
+	*size = m_data[i];
+	return m_data.constData() + i + 1;
 }
@@ -79,6 +79,17 @@ class LIB_EXPORT PgnGameEntry
 		 * The matching is case insensitive.
 		 */
 		bool match(const PgnGameFilter& filter) const;
+		/*!
+		 * Returns true if the PGN tags in \a tags match \a filter.
+		 *
+		 * \a tags must have a value for each TagType in order, and
+		 * \a sizes their lengths. The values don't have to be
+		 * null-terminated. This allows filtering game entries that
+		 * are stored outside of PgnGameEntry objects.
+		 */
+		static bool matchTags(const PgnGameFilter& filter,
+				      const char* const* tags,
+				      const int* sizes);
 
 		/*! Returns the stream position where the game begins. */
 		qint64 pos() const;
@@ -87,6 +98,14 @@ class LIB_EXPORT PgnGameEntry
 
 		/*! Returns the tag value corresponding to \a type. */
 		QString tagValue(TagType type) const;
+		/*!
+		 * Returns the raw data of the tag corresponding to \a type,
+		 * and stores its length in \a size.
+		 *
+		 * The data is not null-terminated, and it remains valid
+		 * until the entry is modified or destroyed.
+		 */
+		const char* tagData(TagType type, int* size) const;
 
 	private:
 		void addTag(const QByteArray& tagValue);
@@ -19,7 +19,51 @@
 #include <cctype>
 #include <cstring>
 #include <QIODevice>
+#include <QFile>
 #include "board/boardfactory.h"
+#include "gzipdevice.h"
+#include "streambuffer.h"
+
+// Character classes of the tokenizer
+enum PgnCharClass
+{
+	LineEnd = 0x01,		// '\n' and '\r'
+	Space = 0x02,		// ' ' and '\t'
+	Period = 0x04,		// '.' that ends a move number
+	SectionStart = 0x08,	// Characters that start a skipped section, or '['
+	Blank = 0x10,		// Characters that separate tokens in movetext
+	WhiteSpace = 0x20	// Characters accepted by isspace()
+};
+
+class PgnCharClassTable
+{
+	public:
+		PgnCharClassTable()
+		{
+			for (int i = 0; i < 256; i++)
+				m_classes[i] = (i < 128 && isspace(i)) ? WhiteSpace : 0;
+
+			m_classes[uchar('\n')] |= LineEnd | Blank;
+			m_classes[uchar('\r')] |= LineEnd | Blank;
+			m_classes[uchar(' ')] |= Space | Blank;
+			m_classes[uchar('\t')] |= Space | Blank;
+			m_classes[uchar('.')] |= Period | Blank;
+
+			const char* sectionStart = "[({;%";
+			for (const char* c = sectionStart; *c; c++)
+				m_classes[uchar(*c)] |= SectionStart;
+		}
+
+		int operator[](char c) const
+		{
+			return m_classes[uchar(c)];
+		}
+
+	private:
+		quint8 m_classes[256];
+};
+
+static const PgnCharClassTable s_charClasses;
 
 
 PgnStream::PgnStream(const QString& variant)
@@ -28,22 +72,37 @@ PgnStream::PgnStream(const QString& variant)
 	  m_lineNumber(1),
 	  m_tokenType(NoToken),
 	  m_device(0),
+	  m_gzipDevice(0),
 	  m_string(0),
+	  m_data(0),
+	  m_size(0),
+	  m_skipCr(false),
+	  m_mappingEnabled(false),
+	  m_mappedData(0),
 	  m_status(Ok),
-	  m_phase(OutOfGame)
+	  m_phase(OutOfGame),
+	  m_variationTokens(false)
 {
 	setVariant(variant);
 }
 
 PgnStream::PgnStream(QIODevice* device, const QString& variant)
-	: m_board(0)
+	: m_board(0),
+	  m_gzipDevice(0),
+	  m_mappingEnabled(false),
+	  m_mappedData(0),
+	  m_variationTokens(false)
 {
 	setVariant(variant);
 	setDevice(device);
 }
 
 PgnStream::PgnStream(const QByteArray* string, const QString& variant)
-	: m_board(0)
+	: m_board(0),
+	  m_gzipDevice(0),
+	  m_mappingEnabled(false),
+	  m_mappedData(0),
+	  m_variationTokens(false)
 {
 	setVariant(variant);
 	setString(string);
@@ -51,19 +110,27 @@ PgnStream::PgnStream(const QByteArray* string, const QString& variant)
 
 PgnStream::~PgnStream()
 {
+	unmapDevice();
+	delete m_gzipDevice;
 	delete m_board;
 }
 
 void PgnStream::reset()
 {
+	unmapDevice();
 	m_pos = 0;
 	m_lineNumber = 1;
 	m_tokenString.clear();
 	m_tagName.clear();
 	m_tagValue.clear();
 	m_tokenType = NoToken;
+	delete m_gzipDevice;
+	m_gzipDevice = 0;
 	m_device = 0;
 	m_string = 0;
+	m_data = 0;
+	m_size = 0;
+	m_skipCr = false;
 	m_status = Ok;
 	m_phase = OutOfGame;
 }
@@ -75,6 +142,8 @@ Chess::Board* PgnStream::board()
 
 QIODevice* PgnStream::device() const
 {
+	if (m_gzipDevice != 0)
+		return m_gzipDevice->device();
 	return m_device;
 }
 
@@ -84,6 +153,82 @@ void PgnStream::setDevice(QIODevice* device)
 
 	reset();
 	m_device = device;
+
+	// Decompress gzip data on the fly. Text mode would mangle the
+	// compressed data, so it's disabled on the underlying device.
+	if (GzipDevice::isCompressed(device))
+	{
+		device->setTextModeEnabled(false);
+		m_gzipDevice = new GzipDevice(device);
+		if (m_gzipDevice->open(QIODevice::ReadOnly))
+			m_device = m_gzipDevice;
+		else
+		{
+			qWarning("%s", qPrintable(m_gzipDevice->errorString()));
+			delete m_gzipDevice;
+			m_gzipDevice = 0;
+		}
+	}
+	else if (m_mappingEnabled)
+		mapDevice();
+}
+
+bool PgnStream::isMappingEnabled() const
+{
+	return m_mappingEnabled;
+}
+
+void PgnStream::setMappingEnabled(bool enabled)
+{
+	if (enabled == m_mappingEnabled)
+		return;
+
+	m_mappingEnabled = enabled;
+	if (!enabled)
+		unmapDevice();
+	else if (m_device != 0 && m_gzipDevice == 0)
+		mapDevice();
+}
+
+void PgnStream::mapDevice()
+{
+	QFile* file = qobject_cast<QFile*>(m_device);
+	if (file == 0 || !file->isOpen() || file->isSequential())
+		return;
+
+	qint64 size = file->size();
+	if (size <= 0)
+		return;
+
+	uchar* data = file->map(0, size);
+	if (data == 0)
+		return;
+
+	m_mappedFile = file;
+	m_mappedData = data;
+	m_data = reinterpret_cast<const char*>(data);
+	m_size = size;
+	m_pos = file->pos();
+	// Emulate the device's end-of-line translation
+	m_skipCr = file->isTextModeEnabled();
+}
+
+void PgnStream::unmapDevice()
+{
+	if (m_mappedData == 0)
+		return;
+
+	// The file may have been closed or destroyed already, in which
+	// case Qt has released the mapping itself.
+	if (m_mappedFile != 0 && m_mappedFile->isOpen())
+	{
+		m_mappedFile->unmap(m_mappedData);
+		m_mappedFile->seek(m_pos);
+	}
+	m_mappedFile = 0;
+	m_mappedData = 0;
+	m_data = 0;
+	m_size = 0;
 }
 
 const QByteArray* PgnStream::string() const
@@ -96,6 +241,8 @@ void PgnStream::setString(const QByteArray* string)
 	Q_ASSERT(string != 0);
 	reset();
 	m_string = string;
+	m_data = string->constData();
+	m_size = string->size();
 }
 
 QString PgnStream::variant() const
@@ -125,7 +272,7 @@ bool PgnStream::isOpen() const
 
 qint64 PgnStream::pos() const
 {
-	if (m_device)
+	if (m_data == 0 && m_device)
 		return m_device->pos();
 	return m_pos;
 }
@@ -138,18 +285,31 @@ qint64 PgnStream::lineNumber() const
 char PgnStream::readChar()
 {
 	char c;
-	if (m_device)
+	if (m_data)
 	{
-		if (!m_device->getChar(&m_lastChar))
+		do
 		{
-			m_status = ReadPastEnd;
-			return 0;
+			if (m_pos >= m_size)
+			{
+				m_status = ReadPastEnd;
+				return 0;
+			}
+			c = m_data[m_pos++];
 		}
-		c = m_lastChar;
+		while (c == '\r' && m_skipCr);
 	}
-	else if (m_string && m_pos < m_string->size())
+	else if (m_device)
 	{
-		c = m_string->at(m_pos++);
+		// Streaming data, eg. a download, is parsed as it arrives
+		while (!m_device->getChar(&m_lastChar))
+		{
+			if (!StreamBuffer::waitForData(m_device))
+			{
+				m_status = ReadPastEnd;
+				return 0;
+			}
+		}
+		c = m_lastChar;
 	}
 	else
 	{
@@ -173,14 +333,14 @@ void PgnStream::rewindChar()
 	Q_ASSERT(pos() > 0);
 
 	char c;
-	if (m_device)
+	if (m_data)
+		c = m_data[--m_pos];
+	else if (m_device)
 	{
 		c = m_lastChar;
 		m_device->ungetChar(m_lastChar);
 		m_lastChar = 0;
 	}
-	else if (m_string)
-		c = m_string->at(m_pos--);
 	else
 		return;
 
@@ -193,18 +353,21 @@ bool PgnStream::seek(qint64 pos, qint64 lineNumber)
 	if (pos < 0)
 		return false;
 
-	bool ok = false;
-	if (m_device)
+	if (m_data)
 	{
-		ok = m_device->seek(pos);
-		m_pos = 0;
+		// The end of the data is a valid position, like it is
+		// for a device
+		if (pos > m_size)
+			return false;
+		m_pos = pos;
 	}
-	else if (m_string)
+	else if (m_device)
 	{
-		ok = pos < m_string->size();
-		m_pos = pos;
+		if (!m_device->seek(pos))
+			return false;
+		m_pos = 0;
 	}
-	if (!ok)
+	else
 		return false;
 
 	m_status = Ok;
@@ -220,17 +383,125 @@ PgnStream::Status PgnStream::status() const
 	return m_status;
 }
 
-void PgnStream::parseUntil(const char* chars)
+void PgnStream::parseUntil(int delimiters)
 {
-	Q_ASSERT(chars != 0);
+	// The delimiters must include line endings, so that the token
+	// never spans multiple lines
+	Q_ASSERT(delimiters & LineEnd);
 
-	char c;
-	while ((c = readChar()) != 0)
+	if (m_data == 0)
+	{
+		char c;
+		while ((c = readChar()) != 0)
+		{
+			if (s_charClasses[c] & delimiters)
+				break;
+			m_tokenString.append(c);
+		}
+		return;
+	}
+
+	// Find the end of the token in the buffer and append the
+	// token in one piece. Skipped carriage returns split it.
+	qint64 start = m_pos;
+	while (m_pos < m_size)
+	{
+		char c = m_data[m_pos];
+		if (c == '\r' && m_skipCr)
+		{
+			m_tokenString.append(m_data + start, int(m_pos - start));
+			start = ++m_pos;
+			continue;
+		}
+		if (s_charClasses[c] & delimiters)
+			break;
+		m_pos++;
+	}
+	m_tokenString.append(m_data + start, int(m_pos - start));
+
+	// Consume the delimiter
+	readChar();
+}
+
+bool PgnStream::parseTagData()
+{
+	// Fast path for buffers. Returns false without consuming
+	// anything if the tag needs the character-by-character parser,
+	// ie. if it has an unquoted value or skipped carriage returns.
+	qint64 i = m_pos;
+	qint64 nameStart = -1;
+	qint64 nameEnd = -1;
+	qint64 valueStart = -1;
+	qint64 valueEnd = -1;
+	bool inQuotes = false;
+	int phase = 0;
+
+	for (; i < m_size; i++)
 	{
-		if (strchr(chars, c))
+		char c = m_data[i];
+		if (!inQuotes && c == ']')
 			break;
-		m_tokenString.append(c);
+		if (c == '\n')
+			break;
+		if (c == '\r')
+		{
+			if (m_skipCr)
+				return false;
+			break;
+		}
+
+		bool space = (s_charClasses[c] & WhiteSpace) != 0;
+		switch (phase)
+		{
+		case 0:
+			if (!space)
+			{
+				phase++;
+				nameStart = i;
+				nameEnd = i + 1;
+			}
+			break;
+		case 1:
+			if (!space)
+				nameEnd = i + 1;
+			else
+				phase++;
+			break;
+		case 2:
+			if (!space)
+			{
+				if (c != '\"')
+					return false;
+				phase++;
+				inQuotes = true;
+				valueStart = valueEnd = i + 1;
+			}
+			break;
+		case 3:
+			if (c == '\"')
+			{
+				inQuotes = false;
+				phase++;
+			}
+			else
+				valueEnd = i + 1;
+			break;
+		default:
+			break;
+		}
 	}
+
+	m_tokenString.append(m_data + m_pos, int(i - m_pos));
+	if (nameStart != -1)
+		m_tagName.append(m_data + nameStart, int(nameEnd - nameStart));
+	if (valueStart != -1)
+		m_tagValue.append(m_data + valueStart, int(valueEnd - valueStart));
+
+	// Consume the terminator
+	m_pos = i;
+	readChar();
+
+	return true;
 }
 
 void PgnStream::parseTag()
@@ -242,6 +513,9 @@ void PgnStream::parseTag()
 	m_tagName.clear();
 	m_tagValue.clear();
 
+	if (m_data != 0 && parseTagData())
+		return;
+
 	while ((c = readChar()) != 0)
 	{
 		if (!inQuotes && c == ']')
@@ -300,6 +574,40 @@ void PgnStream::parseComment(char opBracket)
 	int level = 1;
 	char clBracket = (opBracket == '(') ? ')' : '}';
 
+	if (m_data != 0)
+	{
+		// Append the runs of ordinary characters in one piece
+		qint64 start = m_pos;
+		while (m_pos < m_size)
+		{
+			char c = m_data[m_pos];
+			if (c != opBracket && c != clBracket
+			&&  c != '\n' && c != '\r')
+			{
+				m_pos++;
+				continue;
+			}
+
+			m_tokenString.append(m_data + start, int(m_pos - start));
+			start = ++m_pos;
+
+			if (c == '\r' && m_skipCr)
+				continue;
+			if (c == '\n')
+				m_lineNumber++;
+			if (c == opBracket)
+				level++;
+			else if (c == clBracket && --level <= 0)
+				return;
+
+			if (c != '\n' || !m_tokenString.isEmpty())
+				m_tokenString.append(c);
+		}
+		m_tokenString.append(m_data + start, int(m_pos - start));
+		m_status = ReadPastEnd;
+		return;
+	}
+
 	char c;
 	while ((c = readChar()) != 0)
 	{
@@ -313,7 +621,7 @@ void PgnStream::parseComment(char opBracket)
 	}
 }
 
-static void skipSection(PgnStream* in, char start)
+void PgnStream::skipSection(char start)
 {
 	char end;
 	switch (start)
@@ -333,9 +641,40 @@ static void skipSection(PgnStream* in, char start)
 		return;
 	}
 
+	if (m_data != 0 && start == 0)
+	{
+		const char* nl = (const char*)memchr(m_data + m_pos, '\n',
+						     m_size - m_pos);
+		if (nl == 0)
+		{
+			m_pos = m_size;
+			m_status = ReadPastEnd;
+			return;
+		}
+		m_pos = nl - m_data + 1;
+		m_lineNumber++;
+		return;
+	}
+
 	int level = 1;
+	if (m_data != 0)
+	{
+		while (m_pos < m_size)
+		{
+			char c = m_data[m_pos++];
+			if (c == '\n')
+				m_lineNumber++;
+			if (c == end && --level == 0)
+				return;
+			if (c == start)
+				level++;
+		}
+		m_status = ReadPastEnd;
+		return;
+	}
+
 	char c;
-	while ((c = in->readChar()) != 0)
+	while ((c = readChar()) != 0)
 	{
 		if (c == end && --level == 0)
 			break;
@@ -344,8 +683,48 @@ static void skipSection(PgnStream* in, char start)
 	}
 }
 
+void PgnStream::skipBlanks()
+{
+	Q_ASSERT(m_data != 0);
+
+	while (m_pos < m_size)
+	{
+		char c = m_data[m_pos];
+		if (!(s_charClasses[c] & Blank))
+			break;
+		if (c == '\n')
+			m_lineNumber++;
+		m_pos++;
+	}
+}
+
 bool PgnStream::nextGame()
 {
+	if (m_data != 0)
+	{
+		while (m_pos < m_size)
+		{
+			char c = m_data[m_pos];
+			if (!(s_charClasses[c] & SectionStart))
+			{
+				if (c == '\n')
+					m_lineNumber++;
+				m_pos++;
+				continue;
+			}
+			if (c == '[')
+			{
+				m_phase = InTags;
+				return true;
+			}
+
+			m_pos++;
+			skipSection(c);
+		}
+		m_status = ReadPastEnd;
+		return false;
+	}
+
 	char c;
 	while ((c = readChar()) != 0)
 	{
@@ -356,7 +735,7 @@ bool PgnStream::nextGame()
 			return true;
 		}
 		else
-			skipSection(this, c);
+			skipSection(c);
 	}
 
 	return false;
@@ -370,9 +749,22 @@ PgnStream::TokenType PgnStream::readNext()
 	m_tokenType = NoToken;
 	m_tokenString.clear();
 
-	char c;
-	while ((c = readChar()) != 0)
+	forever
 	{
+		if (m_data != 0)
+			skipBlanks();
+
+		char c = readChar();
+		if (c == 0)
+			break;
+
+		if (m_variationTokens && (c == '(' || c == ')'))
+		{
+			m_tokenType = (c == '(') ? PgnVariationStart : PgnVariationEnd;
+			m_phase = InGame;
+			return m_tokenType;
+		}
+
 		switch (c)
 		{
 		case ' ':
@@ -383,7 +775,7 @@ PgnStream::TokenType PgnStream::readNext()
 			break;
 		case '%':
 			// Escape mechanism (skip this line)
-			parseUntil("\n\r");
+			parseUntil(LineEnd);
 			m_tokenString.clear();
 			break;
 		case '[':
@@ -403,12 +795,12 @@ PgnStream::TokenType PgnStream::readNext()
 			return m_tokenType;
 		case ';':
 			m_tokenType = PgnLineComment;
-			parseUntil("\n\r");
+			parseUntil(LineEnd);
 			return m_tokenType;
 		case '$':
 			// NAG (Numeric Annotation Glyph)
 			m_tokenType = PgnNag;
-			parseUntil(" \t\n\r");
+			parseUntil(Space | LineEnd);
 			return m_tokenType;
 		case '*':
 			// Unfinished game
@@ -420,7 +812,7 @@ PgnStream::TokenType PgnStream::readNext()
 		case '6': case '7': case '8': case '9': case '0':
 			// Move number or result
 			m_tokenString.append(c);
-			parseUntil(". \t\n\r");
+			parseUntil(Period | Space | LineEnd);
 
 			if (m_tokenString == "1-0"
 			||  m_tokenString == "0-1"
@@ -440,7 +832,7 @@ PgnStream::TokenType PgnStream::readNext()
 		default:
 			m_tokenType = PgnMove;
 			m_tokenString.append(c);
-			parseUntil(" \t\n\r");
+			parseUntil(Space | LineEnd);
 			m_phase = InGame;
 			return m_tokenType;
 		}
@@ -449,6 +841,16 @@ PgnStream::TokenType PgnStream::readNext()
 	return NoToken;
 }
 
+bool PgnStream::variationTokensEnabled() const
+{
+	return m_variationTokens;
+}
+
+void PgnStream::setVariationTokensEnabled(bool enabled)
+{
+	m_variationTokens = enabled;
+}
+
 QByteArray PgnStream::tokenString() const
 {
 	return m_tokenString;
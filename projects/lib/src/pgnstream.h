@@ -20,7 +20,10 @@
 
 #include <QtGlobal>
 #include <QString>
+#include <QPointer>
 class QIODevice;
+class QFile;
+class GzipDevice;
 namespace Chess { class Board; }
 
 
@@ -74,6 +77,16 @@ class LIB_EXPORT PgnStream
 			PgnNag,
 			/*! Game result. */
 			PgnResult,
+			/*!
+			 * Start of a Recursive Annotation Variation.
+			 * \note Only read if variation tokens are enabled.
+			 */
+			PgnVariationStart,
+			/*!
+			 * End of a Recursive Annotation Variation.
+			 * \note Only read if variation tokens are enabled.
+			 */
+			PgnVariationEnd,
 			/*! Unknown token. */
 			Unknown
 		};
@@ -103,8 +116,42 @@ class LIB_EXPORT PgnStream
 
 		/*! Returns the assigned device, or 0 if no device is in use. */
 		QIODevice* device() const;
-		/*! Sets the current device to \a device. */
+		/*!
+		 * Sets the current device to \a device.
+		 *
+		 * If the device contains gzip compressed data, it's
+		 * decompressed on the fly. The positions used by pos()
+		 * and seek() refer to the decompressed data.
+		 *
+		 * If mapping is enabled and \a device is an uncompressed
+		 * file, the file is memory mapped.
+		 *
+		 * A sequential \a device, eg. a socket or a StreamBuffer
+		 * fed by a download, is parsed as the data arrives.
+		 */
 		void setDevice(QIODevice* device);
+		/*!
+		 * Returns true if file devices are memory mapped.
+		 *
+		 * \sa setMappingEnabled()
+		 */
+		bool isMappingEnabled() const;
+		/*!
+		 * Enables or disables memory mapping of file devices.
+		 * By default mapping is disabled.
+		 *
+		 * A mapped file is read directly from the mapped region
+		 * instead of going through the device one character at a
+		 * time. The device's position is only updated when the
+		 * mapping is disabled, or the stream is reset or destroyed.
+		 * The change applies to the current device too.
+		 *
+		 * \warning If another process truncates a mapped file, the
+		 * process that reads it is killed by SIGBUS. Mapping should
+		 * only be enabled for files that aren't written while
+		 * they're read.
+		 */
+		void setMappingEnabled(bool enabled);
 
 		/*! Returns the assigned string, or 0 if no string is in use. */
 		const QByteArray* string() const;
@@ -158,6 +205,19 @@ class LIB_EXPORT PgnStream
 		/*! Returns the status of the stream. */
 		Status status() const;
 
+		/*! Returns true if variation tokens are enabled. */
+		bool variationTokensEnabled() const;
+		/*!
+		 * Enables or disables reading variation tokens.
+		 *
+		 * If \a enabled is true, the brackets of a Recursive
+		 * Annotation Variation are read as PgnVariationStart and
+		 * PgnVariationEnd tokens, and the moves in between as normal
+		 * tokens. Otherwise a variation is read as one PgnComment
+		 * token. The default is false.
+		 */
+		void setVariationTokensEnabled(bool enabled);
+
 		/*!
 		 * Seeks to the next game in the stream. Returns true if a game
 		 * is available; otherwise returns false.
@@ -199,9 +259,14 @@ class LIB_EXPORT PgnStream
 			InGame
 		};
 
-		void parseUntil(const char* chars);
+		void parseUntil(int delimiters);
 		void parseTag();
+		bool parseTagData();
 		void parseComment(char opBracket);
+		void skipSection(char start);
+		void skipBlanks();
+		void mapDevice();
+		void unmapDevice();
 
 		Chess::Board* m_board;
 		qint64 m_pos;
@@ -212,9 +277,17 @@ class LIB_EXPORT PgnStream
 		QByteArray m_tagValue;
 		TokenType m_tokenType;
 		QIODevice* m_device;
+		GzipDevice* m_gzipDevice;
 		const QByteArray* m_string;
+		const char* m_data;
+		qint64 m_size;
+		bool m_skipCr;
+		bool m_mappingEnabled;
+		QPointer<QFile> m_mappedFile;
+		uchar* m_mappedData;
 		Status m_status;
 		Phase m_phase;
+		bool m_variationTokens;
 };
 
 #endif // PGNSTREAM_H
@@ -0,0 +1,333 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pgnwriter.h"
+#include <climits>
+#include <QFile>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include "gamearchive.h"
+#include "gzipdevice.h"
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+// The maximum time between syncs of the file to the disk, in ms
+static const int s_syncInterval = 5000;
+
+PgnWriter::PgnWriter(const QString& fileName,
+		     PgnGame::PgnMode mode,
+		     Format format,
+		     QObject* parent)
+	: QThread(parent),
+	  m_fileName(fileName),
+	  m_mode(mode),
+	  m_format(format),
+	  m_compressed(format == PgnFormat
+		       && fileName.endsWith(".gz", Qt::CaseInsensitive)),
+	  m_maxGames(0),
+	  m_maxSize(0),
+	  m_fileIndex(0),
+	  m_fileGames(0),
+	  m_file(0),
+	  m_gzip(0),
+	  m_device(0),
+	  m_writeError(false),
+	  m_archive(0),
+	  m_finishing(false),
+	  m_syncRequested(false),
+	  m_stopped(false)
+{
+	// Reserved capacity survives resizing the buffer to zero
+	m_buffer.reserve(4096);
+}
+
+PgnWriter::~PgnWriter()
+{
+	finish();
+}
+
+void PgnWriter::setRotation(int maxGames, qint64 maxSize)
+{
+	Q_ASSERT(!isRunning());
+
+	m_maxGames = qMax(maxGames, 0);
+	m_maxSize = qMax(maxSize, qint64(0));
+}
+
+void PgnWriter::write(const PgnGame& game)
+{
+	QMutexLocker locker(&m_mutex);
+	m_queue.append(game);
+	m_queueNotEmpty.wakeOne();
+}
+
+void PgnWriter::sync()
+{
+	QMutexLocker locker(&m_mutex);
+	if (m_stopped)
+		return;
+
+	m_syncRequested = true;
+	m_queueNotEmpty.wakeOne();
+	while (m_syncRequested)
+		m_synced.wait(&m_mutex);
+}
+
+void PgnWriter::finish()
+{
+	{
+		QMutexLocker locker(&m_mutex);
+		m_finishing = true;
+		m_queueNotEmpty.wakeOne();
+	}
+	wait();
+}
+
+QString PgnWriter::fileName(int index) const
+{
+	if (index == 0)
+		return m_fileName;
+
+	// Insert the file number before the extension, eg.
+	// "games.pgn.gz" -> "games.2.pgn.gz"
+	QString name(m_fileName);
+	QString gzSuffix;
+	if (m_compressed)
+	{
+		gzSuffix = name.right(3);
+		name.chop(3);
+	}
+
+	QString suffix(QFileInfo(name).suffix());
+	if (!suffix.isEmpty())
+	{
+		name.chop(suffix.size() + 1);
+		suffix.prepend('.');
+	}
+
+	return name + '.' + QString::number(index + 1) + suffix + gzSuffix;
+}
+
+bool PgnWriter::openFile()
+{
+	const QString name(fileName(m_fileIndex));
+	m_fileGames = 0;
+
+	if (m_format == ArchiveFormat)
+	{
+		m_archive = new GameArchive;
+		if (!m_archive->open(name, GameArchive::Append))
+		{
+			qWarning("%s", qPrintable(m_archive->errorString()));
+			delete m_archive;
+			m_archive = 0;
+			return false;
+		}
+		m_file = m_archive->file();
+		return true;
+	}
+
+	QFile* file = new QFile(name);
+	if (!file->open(QIODevice::WriteOnly | QIODevice::Append))
+	{
+		qWarning("Can't write to PGN file %s", qPrintable(name));
+		delete file;
+		return false;
+	}
+
+	QIODevice* device = file;
+	if (m_compressed)
+	{
+		GzipDevice* gzip = new GzipDevice(file);
+		if (!gzip->open(QIODevice::WriteOnly))
+		{
+			qWarning("Can't compress PGN file %s: %s",
+				 qPrintable(name),
+				 qPrintable(gzip->errorString()));
+			delete gzip;
+			delete file;
+			return false;
+		}
+		m_gzip = gzip;
+		device = gzip;
+	}
+
+	m_file = file;
+	m_device = device;
+	return true;
+}
+
+void PgnWriter::closeFile()
+{
+	if (m_file == 0)
+		return;
+
+	m_device = 0;
+
+	// Closing the gzip device finishes the compressed stream
+	if (m_gzip != 0)
+	{
+		m_gzip->close();
+		delete m_gzip;
+		m_gzip = 0;
+	}
+
+	// The archive's index is written after the last sync. If it
+	// doesn't make it to the disk the index is rebuilt on reading.
+	syncFile();
+	if (m_archive != 0)
+	{
+		m_archive->close();
+		delete m_archive;
+		m_archive = 0;
+	}
+	else
+		delete m_file;
+	m_file = 0;
+}
+
+void PgnWriter::syncFile()
+{
+	if (m_gzip != 0)
+		m_gzip->flush();
+	m_file->flush();
+#ifdef Q_OS_UNIX
+	fsync(m_file->handle());
+#endif
+}
+
+void PgnWriter::endSync(bool stopped)
+{
+	QMutexLocker locker(&m_mutex);
+	m_syncRequested = false;
+	if (stopped)
+		m_stopped = true;
+	m_synced.wakeAll();
+}
+
+void PgnWriter::writeGame(const PgnGame& game)
+{
+	if (m_file == 0)
+		return;
+
+	if ((m_maxGames > 0 && m_fileGames >= m_maxGames)
+	||  (m_maxSize > 0 && m_file->size() >= m_maxSize))
+	{
+		closeFile();
+		m_fileIndex++;
+		if (!openFile())
+			return;
+	}
+
+	if (m_archive != 0)
+	{
+		if (!m_archive->writeGame(game))
+			qWarning("Can't write to game archive %s: %s",
+				 qPrintable(m_file->fileName()),
+				 qPrintable(m_archive->errorString()));
+	}
+	else
+	{
+		// The games are formatted into a reused buffer and
+		// written to the device without a text stream
+		m_buffer.resize(0);
+		game.write(m_buffer, m_mode);
+		if (m_device->write(m_buffer) != m_buffer.size())
+			m_writeError = true;
+	}
+	m_fileGames++;
+}
+
+void PgnWriter::run()
+{
+	// Continue in the last file of an earlier run
+	m_fileIndex = 0;
+	if (m_compressed || m_maxGames > 0 || m_maxSize > 0)
+	{
+		while (QFile::exists(fileName(m_fileIndex + 1)))
+			m_fileIndex++;
+	}
+	QFileInfo info(fileName(m_fileIndex));
+	if (info.exists() && info.size() > 0
+	&&  (m_compressed || (m_maxSize > 0 && info.size() >= m_maxSize)))
+		m_fileIndex++;
+
+	if (!openFile())
+	{
+		endSync(true);
+		return;
+	}
+
+	QElapsedTimer syncTimer;
+	syncTimer.start();
+	bool synced = true;
+
+	forever
+	{
+		QList<PgnGame> batch;
+		bool syncRequested;
+		{
+			QMutexLocker locker(&m_mutex);
+			while (m_queue.isEmpty() && !m_finishing && !m_syncRequested)
+			{
+				// Wake up for the periodic sync even
+				// if no new games arrive
+				unsigned long timeout = synced ? ULONG_MAX : s_syncInterval;
+				if (!m_queueNotEmpty.wait(&m_mutex, timeout))
+					break;
+			}
+			if (m_queue.isEmpty() && m_finishing)
+				break;
+			batch = m_queue;
+			m_queue.clear();
+			syncRequested = m_syncRequested;
+		}
+
+		foreach (const PgnGame& game, batch)
+			writeGame(game);
+		if (m_file == 0)
+		{
+			if (syncRequested)
+				endSync(false);
+			continue;
+		}
+
+		if (m_writeError)
+		{
+			qWarning("Can't write to PGN file %s",
+				 qPrintable(m_file->fileName()));
+			m_writeError = false;
+		}
+		m_file->flush();
+		if (!batch.isEmpty())
+			synced = false;
+
+		if (syncRequested
+		||  (!synced && syncTimer.elapsed() >= s_syncInterval))
+		{
+			syncFile();
+			syncTimer.restart();
+			synced = true;
+		}
+		if (syncRequested)
+			endSync(false);
+	}
+
+	closeFile();
+	endSync(true);
+}
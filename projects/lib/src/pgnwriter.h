@@ -0,0 +1,131 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PGNWRITER_H
+#define PGNWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include "pgngame.h"
+class QFile;
+class QIODevice;
+class GzipDevice;
+class GameArchive;
+
+/*!
+ * \brief A thread that appends games to a PGN file or a game archive.
+ *
+ * PgnWriter keeps the output file open and writes the games it's
+ * given in batches, so that the thread that finishes the games never
+ * waits for the file system. The written data is flushed after each
+ * batch and synced to the disk every few seconds.
+ *
+ * The games are written in the order in which they were added.
+ *
+ * If the name of a PGN file ends with ".gz", the output is gzip
+ * compressed. The output can also be rotated into numbered files
+ * ("games.pgn", "games.2.pgn", "games.3.pgn", ...) after a number of
+ * games or bytes. When the writer starts it continues in the last
+ * numbered file, except that an existing compressed file is never
+ * appended to because a crash may have left its stream unfinished.
+ *
+ * \sa GameArchive
+ */
+class LIB_EXPORT PgnWriter : public QThread
+{
+	Q_OBJECT
+
+	public:
+		/*! The format of the output file. */
+		enum Format
+		{
+			PgnFormat,	//!< PGN text
+			ArchiveFormat	//!< Binary GameArchive
+		};
+
+		/*!
+		 * Creates a new PgnWriter that appends games to \a fileName
+		 * in format \a format. PGN games are written in mode \a mode.
+		 * The thread must be started with start().
+		 */
+		PgnWriter(const QString& fileName,
+			  PgnGame::PgnMode mode,
+			  Format format = PgnFormat,
+			  QObject* parent = 0);
+		/*! Writes the pending games and destroys the writer. */
+		virtual ~PgnWriter();
+
+		/*!
+		 * Starts a new output file after \a maxGames games or
+		 * when the file size reaches \a maxSize bytes. A zero
+		 * value disables that limit. By default the output isn't
+		 * rotated.
+		 *
+		 * \note This function must be called before start().
+		 */
+		void setRotation(int maxGames, qint64 maxSize);
+		/*! Adds \a game to the end of the write queue. */
+		void write(const PgnGame& game);
+		/*!
+		 * Writes all the pending games, syncs the file to the disk
+		 * and waits until it's done.
+		 */
+		void sync();
+		/*!
+		 * Writes all the pending games, closes the file and waits
+		 * for the thread to exit.
+		 */
+		void finish();
+
+	protected:
+		// Inherited from QThread
+		virtual void run();
+
+	private:
+		QString fileName(int index) const;
+		bool openFile();
+		void closeFile();
+		void syncFile();
+		void writeGame(const PgnGame& game);
+		void endSync(bool stopped);
+
+		QString m_fileName;
+		PgnGame::PgnMode m_mode;
+		Format m_format;
+		bool m_compressed;
+		int m_maxGames;
+		qint64 m_maxSize;
+		int m_fileIndex;
+		int m_fileGames;
+		QFile* m_file;
+		GzipDevice* m_gzip;
+		QIODevice* m_device;
+		QByteArray m_buffer;
+		bool m_writeError;
+		GameArchive* m_archive;
+		bool m_finishing;
+		bool m_syncRequested;
+		bool m_stopped;
+		QList<PgnGame> m_queue;
+		QMutex m_mutex;
+		QWaitCondition m_queueNotEmpty;
+		QWaitCondition m_synced;
+};
+
+#endif // PGNWRITER_H
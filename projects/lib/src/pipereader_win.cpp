@@ -15,110 +15,314 @@
     along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+
 #include "pipereader_win.h"
+#include <QThread>
+#include <QList>
+#include <QMutex>
 #include <QMutexLocker>
+#include <QTime>
+
+
+/*
+ * The I/O completion port shared by all pipe readers. A few worker
+ * threads wait for completed reads and hand them to their readers.
+ */
+class PipeReaderPort
+{
+	public:
+		static PipeReaderPort* instance();
+
+		PipeReaderPort();
+		~PipeReaderPort();
+
+		bool add(PipeReader* reader);
+		void post(PipeReader* reader);
+
+	private:
+		class Worker : public QThread
+		{
+			public:
+				explicit Worker(HANDLE port);
+
+			protected:
+				virtual void run();
+
+			private:
+				HANDLE m_port;
+		};
+
+		HANDLE m_port;
+		QList<Worker*> m_workers;
+};
+
+/*
+ * Each reader has a mutex of its own for its buffer and state, so
+ * the readers of different engines don't wait for each other. The
+ * shared mutex only guards the completion hand-off: a completion can
+ * still be in progress in a worker thread when its reader is being
+ * destroyed, and a static mutex outlives both of them.
+ */
+static QMutex s_mutex;
+static QMutex s_portMutex;
+static PipeReaderPort* s_port = 0;
+
+class PipeReaderPortDeleter
+{
+	public:
+		~PipeReaderPortDeleter()
+		{
+			delete s_port;
+		}
+};
+static PipeReaderPortDeleter s_portDeleter;
+
+
+PipeReaderPort::Worker::Worker(HANDLE port)
+	: m_port(port)
+{
+}
+
+void PipeReaderPort::Worker::run()
+{
+	forever
+	{
+		DWORD bytes = 0;
+		ULONG_PTR key = 0;
+		OVERLAPPED* overlapped = 0;
+
+		BOOL ok = GetQueuedCompletionStatus(m_port, &bytes, &key,
+						    &overlapped, INFINITE);
+		// A null packet tells the worker to quit
+		if (key == 0)
+			return;
+
+		PipeReader* reader = reinterpret_cast<PipeReader*>(key);
+		reader->onReadCompleted(bytes, ok == TRUE);
+	}
+}
+
+PipeReaderPort* PipeReaderPort::instance()
+{
+	QMutexLocker locker(&s_portMutex);
+	if (s_port == 0)
+		s_port = new PipeReaderPort;
+	return s_port;
+}
+
+PipeReaderPort::PipeReaderPort()
+	: m_port(CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 0))
+{
+	int count = qBound(1, QThread::idealThreadCount(), 4);
+	for (int i = 0; i < count; i++)
+	{
+		Worker* worker = new Worker(m_port);
+		m_workers << worker;
+		worker->start();
+	}
+}
+
+PipeReaderPort::~PipeReaderPort()
+{
+	for (int i = 0; i < m_workers.size(); i++)
+		PostQueuedCompletionStatus(m_port, 0, 0, NULL);
+	foreach (Worker* worker, m_workers)
+	{
+		worker->wait();
+		delete worker;
+	}
+	CloseHandle(m_port);
+}
+
+bool PipeReaderPort::add(PipeReader* reader)
+{
+	HANDLE ret = CreateIoCompletionPort(reader->m_pipe, m_port,
+					    reinterpret_cast<ULONG_PTR>(reader),
+					    0);
+	return ret != NULL;
+}
+
+void PipeReaderPort::post(PipeReader* reader)
+{
+	// An empty packet is handled like a closed pipe
+	PostQueuedCompletionStatus(m_port, 0,
+				   reinterpret_cast<ULONG_PTR>(reader),
+				   &reader->m_overlapped);
+}
 
 
 PipeReader::PipeReader(HANDLE pipe, QObject* parent)
-	: QThread(parent),
+	: QObject(parent),
 	  m_pipe(pipe),
-	  m_bufEnd(m_buf + BufSize),
-	  m_start(m_buf),
-	  m_end(m_buf),
-	  m_freeBytes(BufSize),
-	  m_usedBytes(0),
-	  m_lastNewLine(1)
+	  m_reading(false),
+	  m_finished(false),
+	  m_closing(false),
+	  m_pending(0)
 {
 	Q_ASSERT(m_pipe != INVALID_HANDLE_VALUE);
+	ZeroMemory(&m_overlapped, sizeof(m_overlapped));
 }
 
-qint64 PipeReader::bytesAvailable() const
+PipeReader::~PipeReader()
 {
-	return qint64(m_usedBytes.available());
+	m_mutex.lock();
+	m_closing = true;
+
+	// Closing the pipe aborts the pending read. Its completion packet
+	// still refers to this object, so wait for it to be processed.
+	CloseHandle(m_pipe);
+	m_pipe = INVALID_HANDLE_VALUE;
+	m_mutex.unlock();
+
+	QMutexLocker locker(&s_mutex);
+	while (m_pending > 0)
+		m_idle.wait(&s_mutex);
 }
 
-bool PipeReader::canReadLine() const
+void PipeReader::start()
 {
+	if (!PipeReaderPort::instance()->add(this))
+	{
+		qWarning("CreateIoCompletionPort failed with 0x%x",
+			 int(GetLastError()));
+		QMutexLocker locker(&m_mutex);
+		m_finished = true;
+		locker.unlock();
+
+		emit finished();
+		return;
+	}
+
 	QMutexLocker locker(&m_mutex);
-	return m_lastNewLine <= m_usedBytes.available();
+	startRead();
 }
 
-qint64 PipeReader::readData(char* data, qint64 maxSize)
+void PipeReader::startRead()
 {
-	int n = qMin(int(maxSize), m_usedBytes.available());
-	if (n <= 0)
-		return -1;
-	m_usedBytes.acquire(n);
+	// Called with 'm_mutex' locked
+	if (m_reading || m_finished || m_closing)
+		return;
+	if (m_buffer.size() >= BufSize)
+		return;	// resumed by readData()
 
-	// Copy the first (possibly the only) block of data
-	int size1 = qMin(m_bufEnd - m_start, n);
-	memcpy(data, m_start, size_t(size1));
-	m_start += size1;
+	ZeroMemory(&m_overlapped, sizeof(m_overlapped));
+	m_reading = true;
 
-	Q_ASSERT(m_start <= m_bufEnd);
-	if (m_start == m_bufEnd)
-		m_start = m_buf;
+	// Every read ends with exactly one completion packet
+	s_mutex.lock();
+	m_pending++;
+	s_mutex.unlock();
 
-	// Copy the second block of data from the beginning
-	int size2 = n - size1;
-	if (size2 > 0)
+	// Even if the read completes right away, the completion is
+	// delivered through the port.
+	if (!ReadFile(m_pipe, m_chunk, ChunkSize, NULL, &m_overlapped)
+	&&  GetLastError() != ERROR_IO_PENDING)
 	{
-		memcpy(data + size1, m_start, size_t(size2));
-		m_start += size2;
+		DWORD err = GetLastError();
+		if (err != ERROR_INVALID_HANDLE
+		&&  err != ERROR_BROKEN_PIPE)
+			qWarning("ReadFile failed with 0x%x", int(err));
 
-		Q_ASSERT(m_start <= m_bufEnd);
-		if (m_start == m_bufEnd)
-			m_start = m_buf;
+		// Let a worker thread finish the reader
+		PipeReaderPort::instance()->post(this);
 	}
-	Q_ASSERT(n == size1 + size2);
-
-	m_freeBytes.release(n);
-	return n;
 }
 
-void PipeReader::run()
+void PipeReader::onReadCompleted(DWORD bytes, bool ok)
 {
-	DWORD dwRead = 0;
+	QMutexLocker locker(&m_mutex);
 
-	forever
+	bool closed = (!ok || bytes == 0);
+	bool newLine = false;
+	if (!closed && !m_closing)
 	{
-		int maxSize = qMin(BufSize / 10, m_bufEnd - m_end);
-		m_freeBytes.acquire(maxSize);
+		m_buffer.append(m_chunk, int(bytes));
 
-		BOOL ok = ReadFile(m_pipe, m_end, maxSize, &dwRead, 0);
-		if (!ok || dwRead == 0)
-		{
-			DWORD err = GetLastError();
-			if (err != ERROR_INVALID_HANDLE
-			&&  err != ERROR_BROKEN_PIPE)
-				qWarning("ReadFile failed with 0x%x", int(err));
-			return;
-		}
+		// To avoid signal spam, send the 'readyRead' signal only
+		// if we have a whole line of new data
+		newLine = (memchr(m_chunk, '\n', bytes) != 0);
+	}
 
-		m_end += dwRead;
-		Q_ASSERT(m_end <= m_bufEnd);
+	// The completion hasn't been handed off yet, so the destructor
+	// waits until the signals have been sent.
+	if (!m_closing)
+	{
+		locker.unlock();
+		if (newLine)
+			emit readyRead();
+		if (closed)
+			emit finished();
+		locker.relock();
+	}
 
-		QMutexLocker locker(&m_mutex);
+	m_reading = false;
+	if (closed)
+		m_finished = true;
+	else
+		startRead();
+	m_condition.wakeAll();
+	locker.unlock();
+
+	// The reader can be destroyed as soon as this completion is
+	// handed off, so it's the last thing that touches it
+	QMutexLocker handOff(&s_mutex);
+	m_pending--;
+	m_idle.wakeAll();
+}
+
+bool PipeReader::isFinished() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_finished;
+}
 
-		m_lastNewLine += dwRead;
-		for (int i = 1; i <= int(dwRead); i++)
+bool PipeReader::wait(unsigned long msecs)
+{
+	QMutexLocker locker(&m_mutex);
+
+	// The condition is also signaled by completed reads, so keep
+	// waiting until the timeout.
+	QTime timer;
+	timer.start();
+	while (!m_finished)
+	{
+		unsigned long left = msecs;
+		if (msecs != ULONG_MAX)
 		{
-			if (*(m_end - i) == '\n')
-			{
-				m_lastNewLine = i;
+			unsigned long elapsed = (unsigned long)timer.elapsed();
+			if (elapsed >= msecs)
 				break;
-			}
+			left = msecs - elapsed;
 		}
+		m_condition.wait(&m_mutex, left);
+	}
+	return m_finished;
+}
 
-		if (m_end == m_bufEnd)
-			m_end = m_buf;
+qint64 PipeReader::bytesAvailable() const
+{
+	QMutexLocker locker(&m_mutex);
+	return qint64(m_buffer.size());
+}
 
-		m_freeBytes.release(maxSize - dwRead);
-		m_usedBytes.release(dwRead);
+bool PipeReader::canReadLine() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_buffer.contains('\n');
+}
 
-		// To avoid signal spam, send the 'readyRead' signal only
-		// if we have a whole line of new data
-		if (m_lastNewLine <= int(dwRead))
-			emit readyRead();
-	}
+qint64 PipeReader::readData(char* data, qint64 maxSize)
+{
+	QMutexLocker locker(&m_mutex);
+
+	int n = qMin(int(maxSize), m_buffer.size());
+	if (n <= 0)
+		return -1;
+
+	memcpy(data, m_buffer.constData(), size_t(n));
+	m_buffer.remove(0, n);
+
+	// Resume reading if the buffer was full
+	startRead();
+	return n;
 }
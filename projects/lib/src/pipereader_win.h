@@ -15,35 +15,62 @@
     along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+
 #ifndef PIPEREADER_WIN_H
 #define PIPEREADER_WIN_H
 
 #include <windows.h>
-#include <QThread>
+#include <QObject>
+#include <QByteArray>
 #include <QMutex>
-#include <QSemaphore>
+#include <QWaitCondition>
 
 
 /*!
- * \brief A thread class for reading input from a child process
+ * \brief A class for reading input from a child process
  *
  * PipeReader is intended for reading input from chess engines in Windows.
- * It uses blocking read calls to read from a WinAPI pipe, and
- * sends the readyRead() signal when a new line of text data is available.
+ * It uses overlapped read calls on a WinAPI pipe, and sends the
+ * readyRead() signal when a new line of text data is available.
  *
- * No event loops are used. The child process has to terminate or be
- * terminated before the pipe reader can exit cleanly.
+ * All pipe readers share one I/O completion port which is served by a
+ * small pool of worker threads, so running many engines doesn't
+ * require a blocked thread per engine.
  *
  * \note This class is for Windows only
  * \sa EngineProcess
  */
-class LIB_EXPORT PipeReader : public QThread
+class LIB_EXPORT PipeReader : public QObject
 {
 	Q_OBJECT
 
 	public:
-		/*! Creates a new PipeReader and starts the read loop. */
+		/*!
+		 * Creates a new PipeReader.
+		 *
+		 * \a pipe must be opened for overlapped I/O. The reader
+		 * takes ownership of \a pipe and closes it when destroyed.
+		 */
 		PipeReader(HANDLE pipe, QObject* parent = 0);
+		/*!
+		 * Destroys the reader, cancelling any pending read and
+		 * closing the pipe.
+		 */
+		virtual ~PipeReader();
+
+		/*! Starts reading from the pipe. */
+		void start();
+
+		/*! Returns true if the pipe has been closed. */
+		bool isFinished() const;
+
+		/*!
+		 * Blocks until the pipe has been closed, or until \a msecs
+		 * milliseconds have passed.
+		 *
+		 * \return true if the pipe was closed.
+		 */
+		bool wait(unsigned long msecs = ULONG_MAX);
 
 		/*!
 		 * Read up to \a maxSize bytes into \a data.
@@ -60,22 +87,29 @@ class LIB_EXPORT PipeReader : public QThread
 	signals:
 		/*! There's a new line of data available. */
 		void readyRead();
-		
-	protected:
-		virtual void run();
+		/*! The pipe has been closed. */
+		void finished();
 
 	private:
+		friend class PipeReaderPort;
+
 		static const int BufSize = 0x8000;
+		static const int ChunkSize = 0x1000;
+
+		void startRead();
+		void onReadCompleted(DWORD bytes, bool ok);
 
 		HANDLE m_pipe;
-		char m_buf[BufSize];
-		const char* const m_bufEnd;
-		char* m_start;
-		char* m_end;
+		OVERLAPPED m_overlapped;
+		char m_chunk[ChunkSize];
+		QByteArray m_buffer;
+		bool m_reading;
+		bool m_finished;
+		bool m_closing;
+		int m_pending;
 		mutable QMutex m_mutex;
-		QSemaphore m_freeBytes;
-		QSemaphore m_usedBytes;
-		int m_lastNewLine;
+		QWaitCondition m_condition;
+		QWaitCondition m_idle;
 };
 
 #endif // PIPEREADER_WIN_H
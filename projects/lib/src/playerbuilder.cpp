@@ -17,9 +17,18 @@
 
 #include "playerbuilder.h"
 
+// The delay of the second restart within the restart window
+static const int s_restartDelay = 500;
+// The maximum delay between restarts
+static const int s_maxRestartDelay = 30000;
+
 PlayerBuilder::PlayerBuilder(const QString& name)
-	: m_name(name)
+	: m_name(name),
+	  m_maxRestarts(0),
+	  m_restartWindow(0),
+	  m_restartCount(0)
 {
+	m_restartClock.start();
 }
 
 PlayerBuilder::~PlayerBuilder()
@@ -35,3 +44,57 @@ void PlayerBuilder::setName(const QString& name)
 {
 	m_name = name;
 }
+
+ChessPlayer* PlayerBuilder::createWithAffinity(QObject* receiver,
+					       const char* method,
+					       QObject* parent,
+					       QString* error,
+					       const QList<int>& cpus) const
+{
+	Q_UNUSED(cpus);
+	return create(receiver, method, parent, error);
+}
+
+void PlayerBuilder::reconfigure(ChessPlayer* player) const
+{
+	Q_UNUSED(player);
+}
+
+void PlayerBuilder::setRestartLimit(int count, int window)
+{
+	QMutexLocker locker(&m_restartMutex);
+	m_maxRestarts = qMax(count, 0);
+	m_restartWindow = qMax(window, 0);
+	m_restartTimes.clear();
+}
+
+int PlayerBuilder::restartCount() const
+{
+	QMutexLocker locker(&m_restartMutex);
+	return m_restartCount;
+}
+
+int PlayerBuilder::requestRestart() const
+{
+	QMutexLocker locker(&m_restartMutex);
+	if (m_maxRestarts <= 0)
+	{
+		m_restartCount++;
+		return 0;
+	}
+
+	qint64 now = m_restartClock.elapsed();
+	while (!m_restartTimes.isEmpty()
+	&&     now - m_restartTimes.first() > m_restartWindow)
+		m_restartTimes.removeFirst();
+
+	int recent = m_restartTimes.size();
+	if (recent >= m_maxRestarts)
+		return -1;
+
+	m_restartTimes.append(now);
+	m_restartCount++;
+	if (recent == 0)
+		return 0;
+	return qMin(s_restartDelay << qMin(recent - 1, 16), s_maxRestartDelay);
+}
@@ -19,6 +19,9 @@
 #define PLAYERBUILDER_H
 
 #include <QString>
+#include <QList>
+#include <QMutex>
+#include <QElapsedTimer>
 class QObject;
 class ChessPlayer;
 
@@ -60,9 +63,61 @@ class LIB_EXPORT PlayerBuilder
 					    const char* method,
 					    QObject* parent,
 					    QString* error) const = 0;
+		/*!
+		 * Creates a new player like create(), and restricts it to
+		 * the logical CPUs in \a cpus.
+		 *
+		 * This is a hook for players that run in their own process.
+		 * The default implementation ignores \a cpus and calls
+		 * create().
+		 */
+		virtual ChessPlayer* createWithAffinity(QObject* receiver,
+							const char* method,
+							QObject* parent,
+							QString* error,
+							const QList<int>& cpus) const;
+
+		/*!
+		 * Prepares \a player, which was created by this builder and
+		 * played an earlier game, for a new game.
+		 *
+		 * This is a hook for builders whose settings can change
+		 * between games. The default implementation does nothing.
+		 */
+		virtual void reconfigure(ChessPlayer* player) const;
+
+		/*!
+		 * Limits the restarts of crashed players to \a count restarts
+		 * within \a window milliseconds.
+		 *
+		 * Each restart within the window is delayed twice as long as
+		 * the previous one, starting from an immediate restart. If
+		 * the limit is exceeded, the player can't be restarted.
+		 * A \a count of 0 (the default) allows unlimited immediate
+		 * restarts.
+		 */
+		void setRestartLimit(int count, int window);
+		/*! Returns the number of times a crashed player was restarted. */
+		int restartCount() const;
+		/*!
+		 * Registers the restart of a crashed player.
+		 *
+		 * Returns the number of milliseconds to wait before the
+		 * restart, or -1 if the restart limit has been reached.
+		 * This function is thread-safe.
+		 *
+		 * \sa setRestartLimit()
+		 */
+		int requestRestart() const;
 
 	private:
 		QString m_name;
+		int m_maxRestarts;
+		int m_restartWindow;
+		mutable int m_restartCount;
+		mutable QList<qint64> m_restartTimes;
+		mutable QMutex m_restartMutex;
+		QElapsedTimer m_restartClock;
 };
 
 #endif // PLAYERBUILDER_H
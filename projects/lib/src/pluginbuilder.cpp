@@ -0,0 +1,89 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pluginbuilder.h"
+#include <QLibrary>
+#include "pluginplayer.h"
+#include "engineoption.h"
+
+PluginBuilder::PluginBuilder(const EngineConfiguration& config)
+	: PlayerBuilder(config.name()),
+	  m_config(config)
+{
+}
+
+ChessPlayer* PluginBuilder::create(QObject* receiver,
+				   const char* method,
+				   QObject* parent,
+				   QString* error) const
+{
+	// The library stays loaded when the QLibrary object is destroyed,
+	// and loading it again only increases its reference count
+	QLibrary library(m_config.command().trimmed());
+	if (!library.load())
+	{
+		setError(error, library.errorString());
+		return 0;
+	}
+
+	CuteChessPluginEntry entry = (CuteChessPluginEntry)
+		library.resolve(CUTECHESS_PLUGIN_ENTRY);
+	const CuteChessPlugin* plugin = entry ? entry() : 0;
+	if (plugin == 0)
+	{
+		setError(error, tr("Not a Cute Chess plugin: %1")
+			 .arg(library.fileName()));
+		return 0;
+	}
+	if (plugin->version != CUTECHESS_PLUGIN_VERSION)
+	{
+		setError(error, tr("Unsupported plugin version: %1")
+			 .arg(plugin->version));
+		return 0;
+	}
+
+	void* engine = plugin->create();
+	if (engine == 0)
+	{
+		setError(error, tr("The plugin failed to create an engine"));
+		return 0;
+	}
+
+	PluginPlayer* player = new PluginPlayer(plugin, engine, parent);
+	if (!name().isEmpty())
+		player->setName(name());
+	foreach (EngineOption* option, m_config.options())
+		player->setOption(option->name(), option->value());
+
+	if (receiver != 0 && method != 0)
+		QObject::connect(player, SIGNAL(debugMessage(QString)),
+				 receiver, method);
+
+	return player;
+}
+
+void PluginBuilder::setError(QString* error, const QString& message) const
+{
+	QChar sep = error ? '\n' : ' ';
+	QString str(tr("Cannot start engine %1:%2%3")
+		    .arg(name()).arg(sep).arg(message));
+
+	if (error != 0)
+		*error = str;
+	else
+		qWarning("%s", qPrintable(str));
+}
@@ -0,0 +1,56 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLUGINBUILDER_H
+#define PLUGINBUILDER_H
+
+#include "playerbuilder.h"
+#include <QCoreApplication>
+#include "engineconfiguration.h"
+
+
+/*!
+ * \brief A class for constructing engines from shared libraries.
+ *
+ * The configuration's command is the path to a library that exports
+ * the interface declared in cutechessplugin.h. The engine's options
+ * are passed to the plugin, and the other process settings, such as
+ * the arguments and the working directory, are ignored.
+ *
+ * \sa PluginPlayer
+ */
+class LIB_EXPORT PluginBuilder : public PlayerBuilder
+{
+	Q_DECLARE_TR_FUNCTIONS(PluginBuilder)
+
+	public:
+		/*! Creates a new PluginBuilder. */
+		PluginBuilder(const EngineConfiguration& config);
+
+		// Inherited from PlayerBuilder
+		virtual ChessPlayer* create(QObject* receiver,
+					    const char* method,
+					    QObject* parent,
+					    QString* error) const;
+
+	private:
+		void setError(QString* error, const QString& message) const;
+
+		EngineConfiguration m_config;
+};
+
+#endif // PLUGINBUILDER_H
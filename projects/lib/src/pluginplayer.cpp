@@ -0,0 +1,161 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pluginplayer.h"
+#include <QTimer>
+#include "board/board.h"
+#include "timecontrol.h"
+
+static CuteChessPluginMove toPluginMove(const Chess::GenericMove& move)
+{
+	CuteChessPluginMove pmove;
+	pmove.sourceFile = move.sourceSquare().file();
+	pmove.sourceRank = move.sourceSquare().rank();
+	pmove.targetFile = move.targetSquare().file();
+	pmove.targetRank = move.targetSquare().rank();
+	pmove.promotion = move.promotion();
+
+	return pmove;
+}
+
+static Chess::GenericMove fromPluginMove(const CuteChessPluginMove& pmove)
+{
+	return Chess::GenericMove(
+		Chess::Square(pmove.sourceFile, pmove.sourceRank),
+		Chess::Square(pmove.targetFile, pmove.targetRank),
+		pmove.promotion);
+}
+
+PluginPlayer::PluginPlayer(const CuteChessPlugin* plugin,
+			   void* engine,
+			   QObject* parent)
+	: ChessPlayer(parent),
+	  m_plugin(plugin),
+	  m_engine(engine),
+	  m_searchTimer(new QTimer(this))
+{
+	Q_ASSERT(plugin != 0);
+	Q_ASSERT(engine != 0);
+
+	// The search is started from the event loop so that two
+	// players that move instantly don't recurse through the game
+	m_searchTimer->setSingleShot(true);
+	connect(m_searchTimer, SIGNAL(timeout()), this, SLOT(search()));
+
+	setState(Idle);
+	setName(QString::fromUtf8(plugin->name));
+}
+
+PluginPlayer::~PluginPlayer()
+{
+	m_plugin->destroy(m_engine);
+}
+
+void PluginPlayer::setOption(const QString& name, const QVariant& value)
+{
+	if (m_plugin->setOption == 0)
+		return;
+
+	m_plugin->setOption(m_engine,
+			    name.toUtf8().constData(),
+			    value.toString().toUtf8().constData());
+}
+
+void PluginPlayer::startGame()
+{
+	Q_ASSERT(supportsVariant(board()->variant()));
+
+	// Opening moves may have been played before the game started
+	if (board()->isRandomVariant())
+		m_startFen = board()->fenString(Chess::Board::ShredderFen).toUtf8();
+	else
+		m_startFen = board()->fenString(Chess::Board::XFen).toUtf8();
+	m_moves.clear();
+
+	m_plugin->newGame(m_engine, board()->variant().toUtf8().constData());
+}
+
+void PluginPlayer::startThinking()
+{
+	m_searchTimer->start(0);
+}
+
+void PluginPlayer::search()
+{
+	if (state() != Thinking)
+		return;
+
+	m_plugin->setPosition(m_engine, m_startFen.constData(),
+			      m_moves.constData(), m_moves.size());
+
+	const TimeControl* myTc = timeControl();
+	const TimeControl* oppTc = opponent()->timeControl();
+
+	CuteChessPluginLimits limits;
+	limits.timeLeft = myTc->isInfinite() ? -1 : myTc->timeLeft();
+	limits.opponentTimeLeft = oppTc->isInfinite() ? -1 : oppTc->timeLeft();
+	limits.increment = myTc->timeIncrement();
+	limits.movesLeft = myTc->movesLeft();
+	limits.moveTime = myTc->timePerMove();
+	limits.depth = myTc->plyLimit();
+	limits.nodes = myTc->nodeLimit();
+
+	CuteChessPluginMove pmove;
+	if (m_plugin->go(m_engine, &limits, &pmove) != 0)
+	{
+		forfeit(Chess::Result::Disconnection, tr("No move from plugin"));
+		return;
+	}
+
+	Chess::Move move(board()->moveFromGenericMove(fromPluginMove(pmove)));
+	if (move.isNull() || !board()->isLegalMove(move))
+	{
+		forfeit(Chess::Result::IllegalMove);
+		return;
+	}
+
+	addMove(move);
+	emitMove(move);
+}
+
+void PluginPlayer::endGame(const Chess::Result& result)
+{
+	m_searchTimer->stop();
+
+	ChessPlayer::endGame(result);
+	setState(Idle);
+}
+
+void PluginPlayer::addMove(const Chess::Move& move)
+{
+	m_moves.append(toPluginMove(board()->genericMove(move)));
+}
+
+void PluginPlayer::makeMove(const Chess::Move& move)
+{
+	addMove(move);
+}
+
+bool PluginPlayer::supportsVariant(const QString& variant) const
+{
+	return m_plugin->supportsVariant(variant.toUtf8().constData()) != 0;
+}
+
+bool PluginPlayer::isHuman() const
+{
+	return false;
+}
@@ -0,0 +1,85 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLUGINPLAYER_H
+#define PLUGINPLAYER_H
+
+#include "chessplayer.h"
+#include <QByteArray>
+#include <QVector>
+#include "cutechessplugin.h"
+class QTimer;
+
+/*!
+ * \brief A chess engine loaded as a shared library.
+ *
+ * PluginPlayer calls the functions of a CuteChessPlugin table directly
+ * instead of running an engine process and parsing its output. The
+ * search runs in the game's thread, so the plugin must return from
+ * its go() function within the given time limits.
+ *
+ * \sa PluginBuilder
+ */
+class LIB_EXPORT PluginPlayer : public ChessPlayer
+{
+	Q_OBJECT
+
+	public:
+		/*!
+		 * Creates a new PluginPlayer that plays with \a engine,
+		 * an instance created by \a plugin.
+		 *
+		 * The player takes ownership of \a engine, and \a plugin
+		 * must stay valid for the player's lifetime.
+		 */
+		PluginPlayer(const CuteChessPlugin* plugin,
+			     void* engine,
+			     QObject* parent = 0);
+		/*! Destroys the player and its engine instance. */
+		virtual ~PluginPlayer();
+
+		/*!
+		 * Sets option \a name to \a value.
+		 * Does nothing if the plugin doesn't have options.
+		 */
+		void setOption(const QString& name, const QVariant& value);
+
+		// Inherited from ChessPlayer
+		virtual void endGame(const Chess::Result& result);
+		virtual void makeMove(const Chess::Move& move);
+		virtual bool supportsVariant(const QString& variant) const;
+		virtual bool isHuman() const;
+
+	protected:
+		// Inherited from ChessPlayer
+		virtual void startGame();
+		virtual void startThinking();
+
+	private slots:
+		void search();
+
+	private:
+		void addMove(const Chess::Move& move);
+
+		const CuteChessPlugin* m_plugin;
+		void* m_engine;
+		QByteArray m_startFen;
+		QVector<CuteChessPluginMove> m_moves;
+		QTimer* m_searchTimer;
+};
+
+#endif // PLUGINPLAYER_H
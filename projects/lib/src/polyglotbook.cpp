@@ -17,6 +17,7 @@
 
 #include "polyglotbook.h"
 #include <QDataStream>
+#include <QtEndian>
 
 
 static Chess::GenericMove moveFromBits(quint16 pgMove)
@@ -50,6 +51,11 @@ static quint16 moveToBits(const Chess::GenericMove& move)
 	return target | source | promotion;
 }
 
+PolyglotBook::PolyglotBook(AccessMode mode)
+	: OpeningBook(mode)
+{
+}
+
 void PolyglotBook::readEntry(QDataStream& in)
 {
 	quint64 key;
@@ -65,14 +71,35 @@ void PolyglotBook::readEntry(QDataStream& in)
 	addEntry(entry, key);
 }
 
-void PolyglotBook::writeEntry(const Map::const_iterator& it,
+void PolyglotBook::writeEntry(quint64 key,
+			      const Entry& entry,
 			      QDataStream& out) const
 {
 	quint32 learn = 0;
-	quint64 key = it.key();
-	quint16 pgMove = moveToBits(it.value().move);
-	quint16 weight = it.value().weight;
+	quint16 pgMove = moveToBits(entry.move);
+	quint16 weight = entry.weight;
 	
 	// Store the data. Again, big-endian is used by default.
 	out << key << pgMove << weight << learn;
 }
+
+int PolyglotBook::entrySize() const
+{
+	// key (8 bytes), move (2), weight (2) and learn (4)
+	return 16;
+}
+
+quint64 PolyglotBook::keyFromData(const uchar* data) const
+{
+	return qFromBigEndian<quint64>(data);
+}
+
+PolyglotBook::Entry PolyglotBook::entryFromData(const uchar* data) const
+{
+	Entry entry =
+	{
+		moveFromBits(qFromBigEndian<quint16>(data + 8)),
+		qFromBigEndian<quint16>(data + 10)
+	};
+	return entry;
+}
@@ -31,11 +31,19 @@
  */
 class LIB_EXPORT PolyglotBook: public OpeningBook
 {
+	public:
+		/*! Creates a new PolyglotBook that uses access mode \a mode. */
+		PolyglotBook(AccessMode mode = Ram);
+
 	protected:
 		// Inherited from OpeningBook
 		virtual void readEntry(QDataStream& in);
-		virtual void writeEntry(const Map::const_iterator& it,
+		virtual void writeEntry(quint64 key,
+					const Entry& entry,
 					QDataStream& out) const;
+		virtual int entrySize() const;
+		virtual quint64 keyFromData(const uchar* data) const;
+		virtual Entry entryFromData(const uchar* data) const;
 };
 
 #endif // POLYGLOT_BOOK_H
@@ -0,0 +1,54 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "randombuilder.h"
+#include <QCryptographicHash>
+#include "randomplayer.h"
+
+RandomBuilder::RandomBuilder(const QString& name, int delay)
+	: PlayerBuilder(name),
+	  m_delay(delay)
+{
+	Q_ASSERT(delay >= 0);
+}
+
+ChessPlayer* RandomBuilder::create(QObject* receiver,
+				   const char* method,
+				   QObject* parent,
+				   QString* error) const
+{
+	Q_UNUSED(error);
+
+	// qHash() isn't stable between Qt versions, and the games
+	// should be reproducible
+	QByteArray digest(QCryptographicHash::hash(name().toUtf8(),
+						   QCryptographicHash::Md5));
+	quint64 seed = 0;
+	for (int i = 0; i < 8; i++)
+		seed = (seed << 8) | quint8(digest.at(i));
+
+	ChessPlayer* player = new RandomPlayer(m_delay, seed, parent);
+	if (!name().isEmpty())
+		player->setName(name());
+
+	if (receiver != 0 && method != 0)
+		QObject::connect(player, SIGNAL(debugMessage(QString)),
+				 receiver, method);
+
+	return player;
+}
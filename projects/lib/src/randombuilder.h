@@ -0,0 +1,52 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef RANDOMBUILDER_H
+#define RANDOMBUILDER_H
+
+#include "playerbuilder.h"
+#include <QString>
+
+
+/*! \brief A class for constructing random players. */
+class LIB_EXPORT RandomBuilder : public PlayerBuilder
+{
+	public:
+		/*!
+		 * Creates a new RandomBuilder.
+		 *
+		 * The created players have the name \a playerName, and
+		 * they wait \a delay msec before each move. The moves
+		 * are seeded by the name, so players with different
+		 * names play different games.
+		 *
+		 * \sa RandomPlayer
+		 */
+		RandomBuilder(const QString& playerName, int delay = 0);
+
+		// Inherited from PlayerBuilder
+		virtual ChessPlayer* create(QObject* receiver,
+					    const char* method,
+					    QObject* parent,
+					    QString* error) const;
+
+	private:
+		int m_delay;
+};
+
+#endif // RANDOMBUILDER_H
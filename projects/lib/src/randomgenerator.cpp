@@ -0,0 +1,43 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "randomgenerator.h"
+
+RandomGenerator::RandomGenerator(quint64 seed)
+	: m_state(seed)
+{
+}
+
+RandomGenerator::RandomGenerator(quint32 seed, int gameNumber)
+	: m_state((quint64(seed) << 32) | quint32(gameNumber))
+{
+}
+
+void RandomGenerator::setSeed(quint64 seed)
+{
+	m_state = seed;
+}
+
+quint32 RandomGenerator::random()
+{
+	quint64 z = (m_state += Q_UINT64_C(0x9E3779B97F4A7C15));
+	z = (z ^ (z >> 30)) * Q_UINT64_C(0xBF58476D1CE4E5B9);
+	z = (z ^ (z >> 27)) * Q_UINT64_C(0x94D049BB133111EB);
+	z ^= z >> 31;
+
+	return quint32(z >> 32);
+}
@@ -0,0 +1,56 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RANDOMGENERATOR_H
+#define RANDOMGENERATOR_H
+
+#include <QtGlobal>
+
+/*!
+ * \brief A small seedable pseudorandom number generator
+ *
+ * Mersenne has a single global state that is shared by all the
+ * threads, so the numbers a game gets from it depend on the other
+ * games. RandomGenerator is a SplitMix64 generator that can be given
+ * to a single game, so that the game's random starting position and
+ * book moves only depend on the generator's seed.
+ *
+ * The generator isn't thread-safe.
+ *
+ * \sa Mersenne
+ */
+class LIB_EXPORT RandomGenerator
+{
+	public:
+		/*! Creates a new generator seeded with \a seed. */
+		explicit RandomGenerator(quint64 seed = 0);
+		/*!
+		 * Creates a new generator for game \a gameNumber of a
+		 * series of games seeded with \a seed.
+		 */
+		RandomGenerator(quint32 seed, int gameNumber);
+
+		/*! Seeds the generator with \a seed. */
+		void setSeed(quint64 seed);
+		/*! Returns a pseudorandom number between 0 and 0xFFFFFFFF. */
+		quint32 random();
+
+	private:
+		quint64 m_state;
+};
+
+#endif // RANDOMGENERATOR_H
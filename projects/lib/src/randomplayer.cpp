@@ -0,0 +1,95 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "randomplayer.h"
+#include <QTimer>
+#include "board/board.h"
+#include "board/boardfactory.h"
+
+// SplitMix64 finalizer: spreads similar position keys evenly
+static quint64 mix(quint64 x)
+{
+	x ^= x >> 30;
+	x *= Q_UINT64_C(0xBF58476D1CE4E5B9);
+	x ^= x >> 27;
+	x *= Q_UINT64_C(0x94D049BB133111EB);
+	x ^= x >> 31;
+	return x;
+}
+
+RandomPlayer::RandomPlayer(int delay, quint64 seed, QObject* parent)
+	: ChessPlayer(parent),
+	  m_delay(delay),
+	  m_seed(seed),
+	  m_delayTimer(new QTimer(this))
+{
+	Q_ASSERT(delay >= 0);
+
+	m_delayTimer->setSingleShot(true);
+	connect(m_delayTimer, SIGNAL(timeout()), this, SLOT(playMove()));
+
+	setState(Idle);
+	setName("Random");
+}
+
+void RandomPlayer::startGame()
+{
+}
+
+void RandomPlayer::startThinking()
+{
+	// Even without a delay the move is played from the event loop,
+	// otherwise two random players would recurse through the game
+	m_delayTimer->start(m_delay);
+}
+
+void RandomPlayer::playMove()
+{
+	if (state() != Thinking)
+		return;
+
+	QVector<Chess::Move> moves(board()->legalMoves());
+	if (moves.isEmpty())
+		return;
+
+	quint64 hash = mix(board()->key() ^ m_seed);
+	emitMove(moves.at(int(hash % quint64(moves.size()))));
+}
+
+void RandomPlayer::endGame(const Chess::Result& result)
+{
+	m_delayTimer->stop();
+
+	ChessPlayer::endGame(result);
+	setState(Idle);
+}
+
+void RandomPlayer::makeMove(const Chess::Move& move)
+{
+	Q_UNUSED(move);
+}
+
+bool RandomPlayer::supportsVariant(const QString& variant) const
+{
+	return Chess::BoardFactory::variants().contains(variant);
+}
+
+bool RandomPlayer::isHuman() const
+{
+	return false;
+}
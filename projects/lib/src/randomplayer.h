@@ -0,0 +1,67 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef RANDOMPLAYER_H
+#define RANDOMPLAYER_H
+
+#include "chessplayer.h"
+class QTimer;
+
+/*!
+ * \brief An in-process player that plays random legal moves.
+ *
+ * RandomPlayer answers instantly, or after a fixed delay, and uses
+ * no CPU time for thinking. It's meant for measuring how fast the
+ * games themselves can be run, without any engine overhead.
+ *
+ * The moves are picked by hashing the position's key with a seed,
+ * so a player with the same seed always plays the same move in
+ * the same position.
+ */
+class LIB_EXPORT RandomPlayer : public ChessPlayer
+{
+	Q_OBJECT
+
+	public:
+		/*!
+		 * Creates a new RandomPlayer that waits \a delay msec
+		 * before each move and uses \a seed to pick the moves.
+		 */
+		RandomPlayer(int delay = 0, quint64 seed = 0, QObject* parent = 0);
+
+		// Inherited from ChessPlayer
+		virtual void endGame(const Chess::Result& result);
+		virtual void makeMove(const Chess::Move& move);
+		virtual bool supportsVariant(const QString& variant) const;
+		virtual bool isHuman() const;
+
+	protected:
+		// Inherited from ChessPlayer
+		virtual void startGame();
+		virtual void startThinking();
+
+	private slots:
+		void playMove();
+
+	private:
+		int m_delay;
+		quint64 m_seed;
+		QTimer* m_delayTimer;
+};
+
+#endif // RANDOMPLAYER_H
@@ -0,0 +1,330 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ratingsolver.h"
+#include <cmath>
+
+// The number of virtual draws of each player against an opponent
+// of average strength
+static const double s_priorGames = 2.0;
+
+// The convergence limit for the change of a rating in one iteration,
+// in natural log-odds units (about 0.0002 ELO)
+static const double s_tolerance = 1.0e-6;
+
+// ELO points per natural log-odds unit
+static const double s_eloScale = 400.0 / std::log(10.0);
+
+// Returns the standard normal cumulative distribution at \a x
+static double normalCdf(double x)
+{
+	// Abramowitz & Stegun 7.1.26, accurate to 1.5e-7
+	const double z = std::fabs(x) / std::sqrt(2.0);
+	const double t = 1.0 / (1.0 + 0.3275911 * z);
+	const double y = 1.0 - (((((1.061405429 * t - 1.453152027) * t
+			+ 1.421413741) * t - 0.284496736) * t
+			+ 0.254829592) * t) * std::exp(-z * z);
+
+	return (x >= 0.0) ? 0.5 * (1.0 + y) : 0.5 * (1.0 - y);
+}
+
+RatingSolver::RatingSolver(int playerCount)
+	: m_offset(0.0)
+{
+	setPlayerCount(playerCount);
+}
+
+void RatingSolver::setPlayerCount(int count)
+{
+	Q_ASSERT(count >= 0);
+
+	m_pairs.clear();
+	m_pairIndex.clear();
+	m_games.fill(0, count);
+	m_halfPoints.fill(0, count);
+	m_gamma.fill(1.0, count);
+	m_covariance.clear();
+	m_variance.clear();
+	m_offset = 0.0;
+}
+
+int RatingSolver::playerCount() const
+{
+	return m_games.size();
+}
+
+int RatingSolver::gameCount(int player) const
+{
+	return m_games.at(player);
+}
+
+void RatingSolver::addGameResult(int first, int second, int halfPoints)
+{
+	addResults(first, second, 1, halfPoints);
+}
+
+void RatingSolver::addResults(int first, int second, int games, int halfPoints)
+{
+	Q_ASSERT(first >= 0 && first < playerCount());
+	Q_ASSERT(second >= 0 && second < playerCount());
+	Q_ASSERT(first != second);
+	Q_ASSERT(halfPoints >= 0 && halfPoints <= games * 2);
+
+	if (first > second)
+	{
+		qSwap(first, second);
+		halfPoints = games * 2 - halfPoints;
+	}
+
+	const qint64 key = (qint64(first) << 32) | second;
+	int index = m_pairIndex.value(key, -1);
+	if (index == -1)
+	{
+		index = m_pairs.size();
+		Results results = { first, second, 0, 0 };
+		m_pairs.append(results);
+		m_pairIndex[key] = index;
+	}
+
+	m_pairs[index].games += games;
+	m_pairs[index].halfPoints += halfPoints;
+	m_games[first] += games;
+	m_games[second] += games;
+	m_halfPoints[first] += halfPoints;
+	m_halfPoints[second] += games * 2 - halfPoints;
+}
+
+QVector<RatingSolver::Results> RatingSolver::results() const
+{
+	return m_pairs;
+}
+
+RatingSolver::Results RatingSolver::pairResults(int first, int second) const
+{
+	Q_ASSERT(first != second);
+
+	Results results = { first, second, 0, 0 };
+	const qint64 key = (qint64(qMin(first, second)) << 32)
+			 | qMax(first, second);
+	int index = m_pairIndex.value(key, -1);
+	if (index == -1)
+		return results;
+
+	const Results& pair = m_pairs.at(index);
+	results.games = pair.games;
+	results.halfPoints = (pair.first == first)
+		? pair.halfPoints : pair.games * 2 - pair.halfPoints;
+	return results;
+}
+
+bool RatingSolver::solve(int maxIterations)
+{
+	const int n = playerCount();
+	bool converged = false;
+	QVector<double> denom(n);
+
+	// Minorization-maximization (Hunter 2004). Each player's
+	// strength (gamma) is the ratio of the score to the sum of
+	// games / (own gamma + opponent's gamma).
+	for (int iter = 0; iter < maxIterations && !converged; iter++)
+	{
+		for (int i = 0; i < n; i++)
+			denom[i] = s_priorGames / (m_gamma.at(i) + 1.0);
+		foreach (const Results& pair, m_pairs)
+		{
+			const double d = pair.games / (m_gamma.at(pair.first) +
+						       m_gamma.at(pair.second));
+			denom[pair.first] += d;
+			denom[pair.second] += d;
+		}
+
+		double logSum = 0.0;
+		for (int i = 0; i < n; i++)
+		{
+			const double score = m_halfPoints.at(i) / 2.0 + s_priorGames / 2.0;
+			denom[i] = score / denom.at(i);
+			logSum += std::log(denom.at(i));
+		}
+
+		// Keep the geometric mean of the strengths at 1 so that
+		// the prior's virtual opponent stays an average player.
+		// Otherwise the ratings would drift slowly as a whole.
+		const double scale = std::exp(-logSum / n);
+		double maxDelta = 0.0;
+		for (int i = 0; i < n; i++)
+		{
+			const double gamma = denom.at(i) * scale;
+			maxDelta = qMax(maxDelta, std::fabs(std::log(gamma / m_gamma.at(i))));
+			m_gamma[i] = gamma;
+		}
+		converged = (maxDelta < s_tolerance);
+	}
+
+	m_offset = 0.0;
+	int rated = 0;
+	for (int i = 0; i < n; i++)
+	{
+		if (m_games.at(i) == 0)
+			continue;
+		m_offset += std::log(m_gamma.at(i));
+		rated++;
+	}
+	if (rated > 0)
+		m_offset = m_offset / rated * s_eloScale;
+
+	updateCovariance();
+	updateVariance(rated);
+	return converged;
+}
+
+void RatingSolver::updateCovariance()
+{
+	const int n = playerCount();
+
+	// The Fisher information matrix of the log-odds strengths
+	QVector<double> a(n * n, 0.0);
+	for (int i = 0; i < n; i++)
+	{
+		const double p = m_gamma.at(i) / (m_gamma.at(i) + 1.0);
+		a[i * n + i] = s_priorGames * p * (1.0 - p);
+	}
+	foreach (const Results& pair, m_pairs)
+	{
+		const int i = pair.first;
+		const int j = pair.second;
+		const double p = m_gamma.at(i) / (m_gamma.at(i) + m_gamma.at(j));
+		const double w = pair.games * p * (1.0 - p);
+		a[i * n + i] += w;
+		a[j * n + j] += w;
+		a[i * n + j] -= w;
+		a[j * n + i] -= w;
+	}
+
+	// Cholesky decomposition A = L * L^T in the lower triangle.
+	// The prior keeps the matrix positive definite.
+	for (int j = 0; j < n; j++)
+	{
+		double d = a.at(j * n + j);
+		for (int k = 0; k < j; k++)
+			d -= a.at(j * n + k) * a.at(j * n + k);
+		if (d <= 0.0)
+		{
+			m_covariance.clear();
+			return;
+		}
+		d = std::sqrt(d);
+		a[j * n + j] = d;
+
+		for (int i = j + 1; i < n; i++)
+		{
+			double s = a.at(i * n + j);
+			for (int k = 0; k < j; k++)
+				s -= a.at(i * n + k) * a.at(j * n + k);
+			a[i * n + j] = s / d;
+		}
+	}
+
+	// Invert L in place (lower triangle)
+	for (int i = 0; i < n; i++)
+	{
+		a[i * n + i] = 1.0 / a.at(i * n + i);
+		for (int j = 0; j < i; j++)
+		{
+			double s = 0.0;
+			for (int k = j; k < i; k++)
+				s -= a.at(i * n + k) * a.at(k * n + j);
+			a[i * n + j] = s * a.at(i * n + i);
+		}
+	}
+
+	// A^-1 = L^-T * L^-1, scaled to ELO units
+	m_covariance.fill(0.0, n * n);
+	for (int i = 0; i < n; i++)
+	{
+		for (int j = 0; j <= i; j++)
+		{
+			double s = 0.0;
+			for (int k = i; k < n; k++)
+				s += a.at(k * n + i) * a.at(k * n + j);
+			s *= s_eloScale * s_eloScale;
+			m_covariance[i * n + j] = s;
+			m_covariance[j * n + i] = s;
+		}
+	}
+}
+
+void RatingSolver::updateVariance(int rated)
+{
+	const int n = playerCount();
+	m_variance.clear();
+	if (m_covariance.isEmpty() || rated == 0)
+		return;
+
+	// The variance of each rating relative to the average of the
+	// rated players. The covariance matrix itself is dominated by
+	// the uncertainty of the common level of all the ratings.
+	QVector<double> rowMean(n, 0.0);
+	double grandMean = 0.0;
+	for (int i = 0; i < n; i++)
+	{
+		for (int j = 0; j < n; j++)
+		{
+			if (m_games.at(j) != 0)
+				rowMean[i] += m_covariance.at(i * n + j);
+		}
+		rowMean[i] /= rated;
+		if (m_games.at(i) != 0)
+			grandMean += rowMean.at(i);
+	}
+	grandMean /= rated;
+
+	m_variance.resize(n);
+	for (int i = 0; i < n; i++)
+	{
+		m_variance[i] = qMax(0.0, m_covariance.at(i * n + i)
+					  - 2.0 * rowMean.at(i) + grandMean);
+	}
+}
+
+qreal RatingSolver::rating(int player) const
+{
+	return std::log(m_gamma.at(player)) * s_eloScale - m_offset;
+}
+
+qreal RatingSolver::error(int player) const
+{
+	if (m_variance.isEmpty())
+		return 0.0;
+
+	return 1.96 * std::sqrt(m_variance.at(player));
+}
+
+qreal RatingSolver::los(int first, int second) const
+{
+	const double diff = rating(first) - rating(second);
+	if (m_covariance.isEmpty())
+		return (diff > 0.0) ? 1.0 : (diff < 0.0 ? 0.0 : 0.5);
+
+	const int n = playerCount();
+	const double variance = m_covariance.at(first * n + first)
+			      + m_covariance.at(second * n + second)
+			      - 2.0 * m_covariance.at(first * n + second);
+	if (variance <= 0.0)
+		return 0.5;
+
+	return normalCdf(diff / std::sqrt(variance));
+}
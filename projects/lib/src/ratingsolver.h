@@ -0,0 +1,136 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RATINGSOLVER_H
+#define RATINGSOLVER_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <QHash>
+
+/*!
+ * \brief A maximum likelihood rating estimator for many players.
+ *
+ * RatingSolver fits logistic ELO ratings to the results of a tournament
+ * in the Bradley-Terry model, with draws counted as half a win for both
+ * players (as Ordo does). Each player also gets a few virtual draws
+ * against an average opponent, like the prior in BayesElo, so that the
+ * ratings stay finite for players who won or lost all their games.
+ *
+ * The results are kept per pair of players, so adding a game is cheap
+ * and one solver iteration costs O(number of pairs) no matter how many
+ * games have been played. solve() starts from the previous solution,
+ * which makes the update after a few new games converge quickly.
+ *
+ * The error bars come from the inverse of the Fisher information
+ * matrix, which is O(n^3) for n players and computed only by solve().
+ * The ratings and their errors are relative to the average rating of
+ * the players who have played games.
+ */
+class LIB_EXPORT RatingSolver
+{
+	public:
+		/*! The combined results of all games between two players. */
+		struct Results
+		{
+			//! The index of the first player
+			int first;
+			//! The index of the second player
+			int second;
+			//! The number of games played
+			int games;
+			//! The first player's score in half points
+			int halfPoints;
+		};
+
+		/*! Creates a new solver with \a playerCount players. */
+		RatingSolver(int playerCount = 0);
+
+		/*!
+		 * Sets the number of players to \a count and removes
+		 * all results.
+		 */
+		void setPlayerCount(int count);
+		/*! Returns the number of players. */
+		int playerCount() const;
+		/*! Returns the number of games played by \a player. */
+		int gameCount(int player) const;
+
+		/*!
+		 * Adds a game between players \a first and \a second where
+		 * the first player scored \a halfPoints half points
+		 * (0 for a loss, 1 for a draw and 2 for a win).
+		 */
+		void addGameResult(int first, int second, int halfPoints);
+		/*!
+		 * Adds \a games games between players \a first and \a second
+		 * where the first player scored a total of \a halfPoints
+		 * half points.
+		 */
+		void addResults(int first, int second, int games, int halfPoints);
+		/*! Returns the results of every pair of players who met. */
+		QVector<Results> results() const;
+		/*!
+		 * Returns the results of the games between players \a first
+		 * and \a second from \a first's point of view.
+		 *
+		 * If the players haven't met, the number of games is 0.
+		 * This function takes constant time.
+		 */
+		Results pairResults(int first, int second) const;
+
+		/*!
+		 * Updates the ratings and their error bars.
+		 *
+		 * Stops after \a maxIterations iterations if the ratings
+		 * haven't converged by then, in which case false is
+		 * returned. The next call continues from where this one
+		 * stopped.
+		 */
+		bool solve(int maxIterations = 10000);
+		/*!
+		 * Returns the ELO rating of \a player, relative to the
+		 * average of the players who have played games.
+		 */
+		qreal rating(int player) const;
+		/*!
+		 * Returns the half-width of the 95% confidence interval
+		 * of \a player's rating, or 0 if it's not known.
+		 */
+		qreal error(int player) const;
+		/*!
+		 * Returns the likelihood of superiority of player \a first
+		 * over player \a second, ie. the probability that \a first
+		 * is the stronger player.
+		 */
+		qreal los(int first, int second) const;
+
+	private:
+		void updateCovariance();
+		void updateVariance(int rated);
+
+		QVector<Results> m_pairs;
+		QHash<qint64, int> m_pairIndex;
+		QVector<int> m_games;
+		QVector<int> m_halfPoints;
+		QVector<double> m_gamma;
+		QVector<double> m_covariance;
+		QVector<double> m_variance;
+		double m_offset;
+};
+
+#endif // RATINGSOLVER_H
@@ -0,0 +1,143 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "resourcestats.h"
+
+ResourceStats::ResourceStats()
+	: m_count(0),
+	  m_cpuTime(0),
+	  m_memorySum(0),
+	  m_memoryCount(0),
+	  m_peakMemory(0),
+	  m_threadSum(0),
+	  m_threadCount(0),
+	  m_peakThreads(0),
+	  m_throttled(false),
+	  m_throttledTime(0),
+	  m_throttleCount(0),
+	  m_memoryEvents(0)
+{
+}
+
+bool ResourceStats::isEmpty() const
+{
+	return m_count == 0;
+}
+
+int ResourceStats::count() const
+{
+	return m_count;
+}
+
+qint64 ResourceStats::cpuTime() const
+{
+	return m_cpuTime;
+}
+
+qint64 ResourceStats::averageMemory() const
+{
+	if (m_memoryCount == 0)
+		return 0;
+	return m_memorySum / m_memoryCount;
+}
+
+qint64 ResourceStats::peakMemory() const
+{
+	return m_peakMemory;
+}
+
+double ResourceStats::averageThreads() const
+{
+	if (m_threadCount == 0)
+		return 0.0;
+	return double(m_threadSum) / m_threadCount;
+}
+
+int ResourceStats::peakThreads() const
+{
+	return m_peakThreads;
+}
+
+bool ResourceStats::hasThrottling() const
+{
+	return m_throttled;
+}
+
+qint64 ResourceStats::throttledTime() const
+{
+	return m_throttledTime;
+}
+
+int ResourceStats::throttleCount() const
+{
+	return m_throttleCount;
+}
+
+int ResourceStats::memoryEvents() const
+{
+	return m_memoryEvents;
+}
+
+void ResourceStats::addSample(qint64 cpuTime, qint64 memory, int threads)
+{
+	m_count++;
+	// The CPU time is cumulative, so the latest sample has the total
+	if (cpuTime >= 0)
+		m_cpuTime = cpuTime;
+	if (memory >= 0)
+	{
+		m_memorySum += memory;
+		m_memoryCount++;
+		m_peakMemory = qMax(m_peakMemory, memory);
+	}
+	if (threads >= 0)
+	{
+		m_threadSum += threads;
+		m_threadCount++;
+		m_peakThreads = qMax(m_peakThreads, threads);
+	}
+}
+
+void ResourceStats::setThrottling(qint64 throttledTime,
+				  int throttleCount,
+				  int memoryEvents)
+{
+	// The counters are cumulative like the CPU time
+	m_throttled = true;
+	if (throttledTime >= 0)
+		m_throttledTime = throttledTime;
+	if (throttleCount >= 0)
+		m_throttleCount = throttleCount;
+	if (memoryEvents >= 0)
+		m_memoryEvents = memoryEvents;
+}
+
+void ResourceStats::merge(const ResourceStats& other)
+{
+	m_count += other.m_count;
+	m_cpuTime += other.m_cpuTime;
+	m_memorySum += other.m_memorySum;
+	m_memoryCount += other.m_memoryCount;
+	m_peakMemory = qMax(m_peakMemory, other.m_peakMemory);
+	m_threadSum += other.m_threadSum;
+	m_threadCount += other.m_threadCount;
+	m_peakThreads = qMax(m_peakThreads, other.m_peakThreads);
+	m_throttled = m_throttled || other.m_throttled;
+	m_throttledTime += other.m_throttledTime;
+	m_throttleCount += other.m_throttleCount;
+	m_memoryEvents += other.m_memoryEvents;
+}
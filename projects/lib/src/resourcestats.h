@@ -0,0 +1,112 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RESOURCESTATS_H
+#define RESOURCESTATS_H
+
+#include <QtGlobal>
+
+/*!
+ * \brief Statistics of an engine process' resource usage.
+ *
+ * ResourceStats collects samples of the CPU time, resident memory and
+ * thread count of an engine process. The averages and peaks show
+ * engines that use more threads than they were configured to use, or
+ * that leak memory from game to game. Both distort the results of the
+ * other games played at the same time.
+ */
+class LIB_EXPORT ResourceStats
+{
+	public:
+		/*! Creates a new empty ResourceStats object. */
+		ResourceStats();
+
+		/*! Returns true if no samples have been added. */
+		bool isEmpty() const;
+		/*! Returns the number of samples. */
+		int count() const;
+		/*! Returns the CPU time used in milliseconds. */
+		qint64 cpuTime() const;
+		/*! Returns the average resident memory in bytes. */
+		qint64 averageMemory() const;
+		/*! Returns the peak resident memory in bytes. */
+		qint64 peakMemory() const;
+		/*!
+		 * Returns the average number of threads, or 0 if the
+		 * thread count is not known.
+		 */
+		double averageThreads() const;
+		/*!
+		 * Returns the largest number of threads, or 0 if the
+		 * thread count is not known.
+		 */
+		int peakThreads() const;
+		/*! Returns true if the process ran in a throttled cgroup. */
+		bool hasThrottling() const;
+		/*!
+		 * Returns the time in milliseconds that the process was
+		 * stopped by its CPU quota.
+		 */
+		qint64 throttledTime() const;
+		/*! Returns the number of throttled scheduling periods. */
+		int throttleCount() const;
+		/*!
+		 * Returns the number of times the process reached its
+		 * memory limit.
+		 */
+		int memoryEvents() const;
+
+		/*!
+		 * Adds a sample of a process that has used \a cpuTime
+		 * milliseconds of CPU time since it started, and has
+		 * \a memory bytes of resident memory and \a threads
+		 * threads. Negative values are unknown and ignored.
+		 */
+		void addSample(qint64 cpuTime, qint64 memory, int threads);
+		/*!
+		 * Sets the throttling of the process' cgroup since the
+		 * process started: \a throttledTime milliseconds in
+		 * \a throttleCount periods, and \a memoryEvents hits of
+		 * the memory limit. Negative values are unknown and ignored.
+		 *
+		 * \sa EngineProcess::throttleStats()
+		 */
+		void setThrottling(qint64 throttledTime,
+				   int throttleCount,
+				   int memoryEvents);
+		/*!
+		 * Merges the statistics of \a other, which are from a
+		 * different process, into these statistics.
+		 */
+		void merge(const ResourceStats& other);
+
+	private:
+		int m_count;
+		qint64 m_cpuTime;
+		qint64 m_memorySum;
+		int m_memoryCount;
+		qint64 m_peakMemory;
+		qint64 m_threadSum;
+		int m_threadCount;
+		int m_peakThreads;
+		bool m_throttled;
+		qint64 m_throttledTime;
+		int m_throttleCount;
+		int m_memoryEvents;
+};
+
+#endif // RESOURCESTATS_H
@@ -0,0 +1,122 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "searchstats.h"
+#include "moveevaluation.h"
+
+SearchStats::SearchStats()
+	: m_count(0),
+	  m_nodes(0),
+	  m_nodeTime(0),
+	  m_hashUsage(0),
+	  m_hashCount(0),
+	  m_tbHits(0)
+{
+	for (int i = 0; i < PhaseCount; i++)
+	{
+		m_depths[i] = 0;
+		m_depthCounts[i] = 0;
+	}
+}
+
+bool SearchStats::isEmpty() const
+{
+	return m_count == 0;
+}
+
+int SearchStats::count() const
+{
+	return m_count;
+}
+
+quint64 SearchStats::nps() const
+{
+	if (m_nodeTime <= 0)
+		return 0;
+	return quint64(double(m_nodes) * 1000.0 / m_nodeTime);
+}
+
+double SearchStats::depth(Phase phase) const
+{
+	if (m_depthCounts[phase] == 0)
+		return 0.0;
+	return double(m_depths[phase]) / m_depthCounts[phase];
+}
+
+int SearchStats::hashUsage() const
+{
+	if (m_hashCount == 0)
+		return -1;
+	return int(m_hashUsage / m_hashCount);
+}
+
+quint64 SearchStats::tbHits() const
+{
+	return m_tbHits;
+}
+
+void SearchStats::addSearch(const MoveEvaluation& eval, int ply)
+{
+	if (eval.isBookEval()
+	||  (eval.depth() == 0 && eval.nodeCount() == 0))
+		return;
+
+	m_count++;
+	// Moves without a node count would lower the node rate
+	if (eval.nodeCount() > 0 && eval.time() > 0)
+	{
+		m_nodes += eval.nodeCount();
+		m_nodeTime += eval.time();
+	}
+	if (eval.depth() > 0)
+	{
+		Phase p = phase(ply);
+		m_depths[p] += eval.depth();
+		m_depthCounts[p]++;
+	}
+	if (eval.hashUsage() > 0)
+	{
+		m_hashUsage += eval.hashUsage();
+		m_hashCount++;
+	}
+	m_tbHits += eval.tbHits();
+}
+
+void SearchStats::merge(const SearchStats& other)
+{
+	m_count += other.m_count;
+	m_nodes += other.m_nodes;
+	m_nodeTime += other.m_nodeTime;
+	for (int i = 0; i < PhaseCount; i++)
+	{
+		m_depths[i] += other.m_depths[i];
+		m_depthCounts[i] += other.m_depthCounts[i];
+	}
+	m_hashUsage += other.m_hashUsage;
+	m_hashCount += other.m_hashCount;
+	m_tbHits += other.m_tbHits;
+}
+
+SearchStats::Phase SearchStats::phase(int ply)
+{
+	if (ply < 40)
+		return Opening;
+	if (ply < 80)
+		return Middlegame;
+	return Endgame;
+}
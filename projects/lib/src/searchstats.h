@@ -0,0 +1,97 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SEARCHSTATS_H
+#define SEARCHSTATS_H
+
+#include <QtGlobal>
+class MoveEvaluation;
+
+/*!
+ * \brief Statistics of the searches reported by an engine.
+ *
+ * SearchStats sums up the nodes, search depths, hash table usage and
+ * tablebase hits that an engine reports for its moves. The depths are
+ * kept separately for the opening, middlegame and endgame, because
+ * the depth reached normally grows as pieces are traded off. A drop
+ * in the node rate during a match is often the first sign of an
+ * overloaded host.
+ */
+class LIB_EXPORT SearchStats
+{
+	public:
+		/*! A phase of the game. */
+		enum Phase
+		{
+			Opening,	//!< The first 20 moves
+			Middlegame,	//!< Moves 21 to 40
+			Endgame,	//!< Move 41 and later
+			PhaseCount	//!< The number of phases
+		};
+
+		/*! Creates a new empty SearchStats object. */
+		SearchStats();
+
+		/*! Returns true if no searches have been added. */
+		bool isEmpty() const;
+		/*! Returns the number of searches. */
+		int count() const;
+		/*!
+		 * Returns the average node rate in nodes per second, or 0
+		 * if the engine didn't report any nodes.
+		 */
+		quint64 nps() const;
+		/*!
+		 * Returns the average search depth in \a phase, or 0 if
+		 * there are no searches in that phase.
+		 */
+		double depth(Phase phase) const;
+		/*!
+		 * Returns the average hash table usage in permille, or -1
+		 * if the engine didn't report it.
+		 */
+		int hashUsage() const;
+		/*! Returns the total number of tablebase hits. */
+		quint64 tbHits() const;
+
+		/*!
+		 * Adds the search described by \a eval, which was made
+		 * at ply \a ply of the game.
+		 *
+		 * Book moves and moves without a search depth or node
+		 * count are ignored.
+		 */
+		void addSearch(const MoveEvaluation& eval, int ply);
+		/*! Merges the statistics of \a other into these statistics. */
+		void merge(const SearchStats& other);
+
+		/*! Returns the game phase of ply \a ply. */
+		static Phase phase(int ply);
+
+	private:
+		int m_count;
+		quint64 m_nodes;
+		qint64 m_nodeTime;
+		qint64 m_depths[PhaseCount];
+		int m_depthCounts[PhaseCount];
+		qint64 m_hashUsage;
+		int m_hashCount;
+		quint64 m_tbHits;
+};
+
+#endif // SEARCHSTATS_H
@@ -136,8 +136,12 @@ Sprt::Sprt()
 	  m_beta(0),
 	  m_wins(0),
 	  m_losses(0),
-	  m_draws(0)
+	  m_draws(0),
+	  m_model(Trinomial),
+	  m_eloModel(LogisticElo)
 {
+	for (int i = 0; i < 5; i++)
+		m_pairs[i] = 0;
 }
 
 bool Sprt::isNull() const
@@ -146,25 +150,26 @@ bool Sprt::isNull() const
 }
 
 void Sprt::initialize(double elo0, double elo1,
-		      double alpha, double beta)
+		      double alpha, double beta,
+		      Model model, EloModel eloModel)
 {
 	m_elo0 = elo0;
 	m_elo1 = elo1;
 	m_alpha = alpha;
 	m_beta = beta;
+	m_model = model;
+	m_eloModel = eloModel;
 }
 
-Sprt::Status Sprt::status() const
+Sprt::Model Sprt::model() const
 {
-	Status status = {
-		Continue,
-		0.0,
-		0.0,
-		0.0
-	};
+	return m_model;
+}
 
+bool Sprt::bayesEloLlr(double* llr) const
+{
 	if (m_wins <= 0 || m_losses <= 0 || m_draws <= 0)
-		return status;
+		return false;
 
 	// Estimate draw_elo out of sample
 	const SprtProbability p(m_wins, m_losses, m_draws);
@@ -177,9 +182,105 @@ Sprt::Status Sprt::status() const
 	const SprtProbability p0(b0), p1(b1);
 
 	// Log-Likelyhood Ratio
-	status.llr = m_wins * std::log(p1.pWin() / p0.pWin()) +
-		     m_losses * std::log(p1.pLoss() / p0.pLoss()) +
-		     m_draws * std::log(p1.pDraw() / p0.pDraw());
+	*llr = m_wins * std::log(p1.pWin() / p0.pWin()) +
+	       m_losses * std::log(p1.pLoss() / p0.pLoss()) +
+	       m_draws * std::log(p1.pDraw() / p0.pDraw());
+	return true;
+}
+
+static double logisticScore(double elo)
+{
+	return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
+
+bool Sprt::gsprtLlr(double* llr) const
+{
+	// The outcomes of a trial as the first player's score
+	// on a [0, 1] scale, and their frequencies
+	double scores[5];
+	int counts[5];
+	int outcomes;
+	if (m_model == Pentanomial)
+	{
+		outcomes = 5;
+		for (int i = 0; i < 5; i++)
+		{
+			scores[i] = i / 4.0;
+			counts[i] = m_pairs[i];
+		}
+	}
+	else
+	{
+		outcomes = 3;
+		scores[0] = 0.0;
+		scores[1] = 0.5;
+		scores[2] = 1.0;
+		counts[0] = m_losses;
+		counts[1] = m_draws;
+		counts[2] = m_wins;
+	}
+
+	double n = 0.0;
+	double sum = 0.0;
+	for (int i = 0; i < outcomes; i++)
+	{
+		n += counts[i];
+		sum += counts[i] * scores[i];
+	}
+	if (n < 2.0)
+		return false;
+
+	const double mean = sum / n;
+	double variance = 0.0;
+	for (int i = 0; i < outcomes; i++)
+		variance += counts[i] * (scores[i] - mean) * (scores[i] - mean);
+	variance /= n;
+	if (variance <= 0.0)
+		return false;
+
+	// Expected scores under H0 and H1
+	double s0;
+	double s1;
+	if (m_eloModel == NormalizedElo)
+	{
+		// The per-game standard deviation. The score of a game
+		// pair is the mean of two games, so its variance is half
+		// of the variance of a single game.
+		double sigma = std::sqrt(variance);
+		if (m_model == Pentanomial)
+			sigma *= std::sqrt(2.0);
+
+		const double nt = std::log(10.0) / 800.0;
+		s0 = 0.5 + m_elo0 * nt * sigma;
+		s1 = 0.5 + m_elo1 * nt * sigma;
+	}
+	else
+	{
+		s0 = logisticScore(m_elo0);
+		s1 = logisticScore(m_elo1);
+	}
+
+	// Log-likelihood ratio of the normal approximation
+	*llr = n * (s1 - s0) * (2.0 * mean - s0 - s1) / (2.0 * variance);
+	return true;
+}
+
+Sprt::Status Sprt::status() const
+{
+	Status status = {
+		Continue,
+		0.0,
+		0.0,
+		0.0
+	};
+
+	bool ok;
+	if (m_model == Trinomial && m_eloModel == LogisticElo)
+		ok = bayesEloLlr(&status.llr);
+	else
+		ok = gsprtLlr(&status.llr);
+	if (!ok)
+		return status;
 
 	// Bounds based on error levels of the test
 	status.lBound = std::log(m_beta / (1.0 - m_alpha));
@@ -202,3 +303,78 @@ void Sprt::addGameResult(GameResult result)
 	else if (result == Loss)
 		m_losses++;
 }
+
+int Sprt::resultCount(GameResult result) const
+{
+	if (result == Win)
+		return m_wins;
+	if (result == Draw)
+		return m_draws;
+	if (result == Loss)
+		return m_losses;
+	return 0;
+}
+
+void Sprt::setResultCounts(int wins, int losses, int draws)
+{
+	m_wins = wins;
+	m_losses = losses;
+	m_draws = draws;
+}
+
+bool Sprt::eloEstimate(int wins, int losses, int draws,
+		       double* elo, double* error)
+{
+	Q_ASSERT(elo != 0);
+	Q_ASSERT(error != 0);
+
+	const int count = wins + losses + draws;
+	if (count <= 0)
+		return false;
+
+	const double n = count;
+	const double mean = (wins + draws / 2.0) / n;
+	if (mean <= 0.0 || mean >= 1.0)
+		return false;
+
+	const double variance = (wins * (1.0 - mean) * (1.0 - mean)
+			       + draws * (0.5 - mean) * (0.5 - mean)
+			       + losses * mean * mean) / n;
+
+	// Delta method: the slope of the logistic ELO curve
+	// at the measured score
+	const double slope = 400.0 / (std::log(10.0) * mean * (1.0 - mean));
+	*elo = -400.0 * std::log10(1.0 / mean - 1.0);
+	*error = 1.96 * std::sqrt(variance / n) * slope;
+
+	return true;
+}
+
+static int halfPoints(Sprt::GameResult result)
+{
+	if (result == Sprt::Win)
+		return 2;
+	if (result == Sprt::Draw)
+		return 1;
+	return 0;
+}
+
+void Sprt::addGamePairResult(GameResult first, GameResult second)
+{
+	if (first == NoResult || second == NoResult)
+		return;
+
+	m_pairs[halfPoints(first) + halfPoints(second)]++;
+}
+
+int Sprt::pairResultCount(int halfPoints) const
+{
+	Q_ASSERT(halfPoints >= 0 && halfPoints < 5);
+	return m_pairs[halfPoints];
+}
+
+void Sprt::setPairResultCount(int halfPoints, int count)
+{
+	Q_ASSERT(halfPoints >= 0 && halfPoints < 5);
+	m_pairs[halfPoints] = count;
+}
@@ -26,6 +26,12 @@
  * players when the ELO difference is known to be outside of the specified
  * interval.
  *
+ * By default the test treats each game as an independent trial with
+ * a win, draw or loss outcome (the trinomial model). When the openings
+ * are played as color-reversed game pairs, the pentanomial model
+ * treats each pair as one trial with five possible outcomes, which
+ * cancels out most of the opening bias and needs fewer games.
+ *
  * \sa http://en.wikipedia.org/wiki/Sequential_probability_ratio_test
  */
 class LIB_EXPORT Sprt
@@ -48,6 +54,20 @@ class LIB_EXPORT Sprt
 			Draw		//!< Game was drawn
 		};
 
+		/*! The statistical model of the test. */
+		enum Model
+		{
+			Trinomial,	//!< Single games: win, draw or loss
+			Pentanomial	//!< Game pairs: 0 to 2 points
+		};
+
+		/*! The ELO scale used for the hypotheses. */
+		enum EloModel
+		{
+			LogisticElo,	//!< Logistic ELO (BayesElo for trinomial tests)
+			NormalizedElo	//!< ELO scaled by the measured variance
+		};
+
 		/*! The status of the test. */
 		struct Status
 		{
@@ -74,9 +94,19 @@ class LIB_EXPORT Sprt
 		 *
 		 * \a alpha is the maximum probability for a type I error and
 		 * \a beta for a type II error outside interval [elo0, elo1].
+		 *
+		 * \a model is the statistical model and \a eloModel the
+		 * scale of \a elo0 and \a elo1. Except for the default
+		 * trinomial BayesElo test, the log-likelihood ratio is
+		 * computed with the normal approximation of a generalized
+		 * SPRT.
 		 */
 		void initialize(double elo0, double elo1,
-				double alpha, double beta);
+				double alpha, double beta,
+				Model model = Trinomial,
+				EloModel eloModel = LogisticElo);
+		/*! Returns the statistical model of the test. */
+		Model model() const;
 		/*! Returns the current status of the test. */
 		Status status() const;
 		/*!
@@ -86,8 +116,48 @@ class LIB_EXPORT Sprt
 		 * check if H0 or H1 can be accepted.
 		 */
 		void addGameResult(GameResult result);
+		/*!
+		 * Updates the pentanomial statistics with a game pair.
+		 *
+		 * \a first and \a second are the results of two games played
+		 * with the same opening and reversed colors. The pair is
+		 * ignored if either game has no result.
+		 */
+		void addGamePairResult(GameResult first, GameResult second);
+		/*! Returns the number of games of \a result added so far. */
+		int resultCount(GameResult result) const;
+		/*!
+		 * Sets the numbers of wins, losses and draws to \a wins,
+		 * \a losses and \a draws, eg. when resuming a test.
+		 */
+		void setResultCounts(int wins, int losses, int draws);
+		/*!
+		 * Returns the number of game pairs where the first player
+		 * scored \a halfPoints half points (0 to 4).
+		 */
+		int pairResultCount(int halfPoints) const;
+		/*!
+		 * Sets the number of game pairs where the first player
+		 * scored \a halfPoints half points to \a count.
+		 */
+		void setPairResultCount(int halfPoints, int count);
+
+		/*!
+		 * Estimates the ELO difference between two players from
+		 * the first player's \a wins, \a losses and \a draws.
+		 *
+		 * Stores the estimate in \a elo and the half-width of its
+		 * 95% confidence interval in \a error. Returns false if
+		 * there are no games or the first player won or lost all
+		 * of them.
+		 */
+		static bool eloEstimate(int wins, int losses, int draws,
+					double* elo, double* error);
 
 	private:
+		bool bayesEloLlr(double* llr) const;
+		bool gsprtLlr(double* llr) const;
+
 		double m_elo0;
 		double m_elo1;
 		double m_alpha;
@@ -95,6 +165,9 @@ class LIB_EXPORT Sprt
 		int m_wins;
 		int m_losses;
 		int m_draws;
+		int m_pairs[5];
+		Model m_model;
+		EloModel m_eloModel;
 };
 
 #endif // SPRT_H
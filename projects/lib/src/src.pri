@@ -6,6 +6,7 @@ HEADERS += $$PWD/chessengine.h \
     $$PWD/chessplayer.h \
     $$PWD/engineconfiguration.h \
     $$PWD/openingbook.h \
+    $$PWD/openingbookcache.h \
     $$PWD/pgnstream.h \
     $$PWD/pgngame.h \
     $$PWD/polyglotbook.h \
@@ -15,7 +16,9 @@ HEADERS += $$PWD/chessengine.h \
     $$PWD/moveevaluation.h \
     $$PWD/enginemanager.h \
     $$PWD/humanplayer.h \
+    $$PWD/randomplayer.h \
     $$PWD/engineoption.h \
+    $$PWD/engineoptioncache.h \
     $$PWD/enginespinoption.h \
     $$PWD/enginecombooption.h \
     $$PWD/enginecheckoption.h \
@@ -27,24 +30,54 @@ HEADERS += $$PWD/chessengine.h \
     $$PWD/enginebuilder.h \
     $$PWD/classregistry.h \
     $$PWD/enginefactory.h \
+    $$PWD/enginelog.h \
     $$PWD/humanbuilder.h \
+    $$PWD/randombuilder.h \
+    $$PWD/pluginplayer.h \
+    $$PWD/pluginbuilder.h \
+    $$PWD/cutechessplugin.h \
     $$PWD/engineoptionfactory.h \
     $$PWD/pgngamefilter.h \
     $$PWD/tournament.h \
     $$PWD/roundrobintournament.h \
     $$PWD/tournamentfactory.h \
     $$PWD/gauntlettournament.h \
+    $$PWD/bergertournament.h \
+    $$PWD/swisstournament.h \
     $$PWD/epdrecord.h \
     $$PWD/openingsuite.h \
     $$PWD/econode.h \
     $$PWD/mersenne.h \
     $$PWD/sprt.h \
-    $$PWD/gameadjudicator.h
+    $$PWD/gameadjudicator.h \
+    $$PWD/latencystats.h \
+    $$PWD/timeusagestats.h \
+    $$PWD/searchstats.h \
+    $$PWD/resourcestats.h \
+    $$PWD/allocationstats.h \
+    $$PWD/clocktimer.h \
+    $$PWD/gamesnapshot.h \
+    $$PWD/cpuplacement.h \
+    $$PWD/memorybudget.h \
+    $$PWD/engineserver.h \
+    $$PWD/enginerecorder.h \
+    $$PWD/enginereplayer.h \
+    $$PWD/tracelog.h \
+    $$PWD/pgnwriter.h \
+    $$PWD/gamearchive.h \
+    $$PWD/gzipdevice.h \
+    $$PWD/streambuffer.h \
+    $$PWD/ratingsolver.h \
+    $$PWD/openingstats.h \
+    $$PWD/gameannotator.h \
+    $$PWD/fileprefetcher.h \
+    $$PWD/randomgenerator.h
 SOURCES += $$PWD/chessengine.cpp \
     $$PWD/chessgame.cpp \
     $$PWD/chessplayer.cpp \
     $$PWD/engineconfiguration.cpp \
     $$PWD/openingbook.cpp \
+    $$PWD/openingbookcache.cpp \
     $$PWD/pgnstream.cpp \
     $$PWD/pgngame.cpp \
     $$PWD/polyglotbook.cpp \
@@ -54,7 +87,9 @@ SOURCES += $$PWD/chessengine.cpp \
     $$PWD/moveevaluation.cpp \
     $$PWD/enginemanager.cpp \
     $$PWD/humanplayer.cpp \
+    $$PWD/randomplayer.cpp \
     $$PWD/engineoption.cpp \
+    $$PWD/engineoptioncache.cpp \
     $$PWD/enginespinoption.cpp \
     $$PWD/enginecombooption.cpp \
     $$PWD/enginecheckoption.cpp \
@@ -65,22 +100,55 @@ SOURCES += $$PWD/chessengine.cpp \
     $$PWD/playerbuilder.cpp \
     $$PWD/enginebuilder.cpp \
     $$PWD/enginefactory.cpp \
+    $$PWD/enginelog.cpp \
     $$PWD/humanbuilder.cpp \
+    $$PWD/randombuilder.cpp \
+    $$PWD/pluginplayer.cpp \
+    $$PWD/pluginbuilder.cpp \
     $$PWD/engineoptionfactory.cpp \
     $$PWD/pgngamefilter.cpp \
     $$PWD/tournament.cpp \
     $$PWD/roundrobintournament.cpp \
     $$PWD/tournamentfactory.cpp \
     $$PWD/gauntlettournament.cpp \
+    $$PWD/bergertournament.cpp \
+    $$PWD/swisstournament.cpp \
     $$PWD/epdrecord.cpp \
     $$PWD/openingsuite.cpp \
     $$PWD/econode.cpp \
     $$PWD/mersenne.cpp \
     $$PWD/sprt.cpp \
-    $$PWD/gameadjudicator.cpp
+    $$PWD/gameadjudicator.cpp \
+    $$PWD/latencystats.cpp \
+    $$PWD/timeusagestats.cpp \
+    $$PWD/searchstats.cpp \
+    $$PWD/resourcestats.cpp \
+    $$PWD/allocationstats.cpp \
+    $$PWD/clocktimer.cpp \
+    $$PWD/gamesnapshot.cpp \
+    $$PWD/cpuplacement.cpp \
+    $$PWD/memorybudget.cpp \
+    $$PWD/engineserver.cpp \
+    $$PWD/enginerecorder.cpp \
+    $$PWD/enginereplayer.cpp \
+    $$PWD/tracelog.cpp \
+    $$PWD/pgnwriter.cpp \
+    $$PWD/gamearchive.cpp \
+    $$PWD/gzipdevice.cpp \
+    $$PWD/streambuffer.cpp \
+    $$PWD/ratingsolver.cpp \
+    $$PWD/openingstats.cpp \
+    $$PWD/gameannotator.cpp \
+    $$PWD/fileprefetcher.cpp \
+    $$PWD/randomgenerator.cpp
 win32 { 
     HEADERS += $$PWD/engineprocess_win.h \
 	$$PWD/pipereader_win.h
     SOURCES += $$PWD/engineprocess_win.cpp \
 	$$PWD/pipereader_win.cpp
+    LIBS += -lpsapi
+}
+unix {
+    HEADERS += $$PWD/engineprocess_unix.h
+    SOURCES += $$PWD/engineprocess_unix.cpp
 }
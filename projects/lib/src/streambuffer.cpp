@@ -0,0 +1,173 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "streambuffer.h"
+#include <QThread>
+#include <QEventLoop>
+#include <QTimer>
+#include <QMutexLocker>
+#include <cstring>
+#include <climits>
+
+// Read data is discarded from the front of the buffer in chunks
+// of at least this size
+static const int s_compactSize = 0x10000;
+
+StreamBuffer::StreamBuffer(QObject* parent)
+	: QIODevice(parent),
+	  m_readPos(0),
+	  m_finished(false)
+{
+	open(QIODevice::ReadOnly);
+}
+
+void StreamBuffer::setSource(QIODevice* source)
+{
+	Q_ASSERT(source != 0);
+
+	connect(source, SIGNAL(readyRead()),
+		this, SLOT(onSourceReadyRead()));
+	connect(source, SIGNAL(readChannelFinished()),
+		this, SLOT(onSourceReadyRead()));
+	connect(source, SIGNAL(readChannelFinished()),
+		this, SLOT(finish()));
+
+	if (source->bytesAvailable() > 0)
+		append(source->readAll());
+}
+
+bool StreamBuffer::isFinished() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_finished;
+}
+
+bool StreamBuffer::waitForData(QIODevice* device, int msecs)
+{
+	Q_ASSERT(device != 0);
+	return device->isSequential() && device->waitForReadyRead(msecs);
+}
+
+bool StreamBuffer::isSequential() const
+{
+	return true;
+}
+
+qint64 StreamBuffer::bytesAvailable() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_data.size() - m_readPos + QIODevice::bytesAvailable();
+}
+
+bool StreamBuffer::atEnd() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_finished
+		&& m_readPos == m_data.size()
+		&& QIODevice::bytesAvailable() == 0;
+}
+
+bool StreamBuffer::waitForReadyRead(int msecs)
+{
+	QMutexLocker locker(&m_mutex);
+	if (m_readPos < m_data.size())
+		return true;
+	if (m_finished)
+		return false;
+
+	if (QThread::currentThread() != thread())
+	{
+		while (m_readPos == m_data.size() && !m_finished)
+		{
+			if (!m_dataReady.wait(&m_mutex,
+					      msecs < 0 ? ULONG_MAX : msecs))
+				break;
+		}
+		return m_readPos < m_data.size();
+	}
+
+	// The source lives in this thread, so its events must be
+	// processed while waiting
+	locker.unlock();
+	QEventLoop loop;
+	connect(this, SIGNAL(readyRead()), &loop, SLOT(quit()));
+	connect(this, SIGNAL(readChannelFinished()), &loop, SLOT(quit()));
+	if (msecs >= 0)
+		QTimer::singleShot(msecs, &loop, SLOT(quit()));
+	loop.exec(QEventLoop::ExcludeUserInputEvents);
+
+	locker.relock();
+	return m_readPos < m_data.size();
+}
+
+void StreamBuffer::append(const QByteArray& data)
+{
+	if (data.isEmpty())
+		return;
+
+	QMutexLocker locker(&m_mutex);
+	if (m_readPos >= s_compactSize && m_readPos * 2 >= m_data.size())
+	{
+		m_data.remove(0, m_readPos);
+		m_readPos = 0;
+	}
+	m_data.append(data);
+	m_dataReady.wakeAll();
+	locker.unlock();
+
+	emit readyRead();
+}
+
+void StreamBuffer::finish()
+{
+	QMutexLocker locker(&m_mutex);
+	if (m_finished)
+		return;
+	m_finished = true;
+	m_dataReady.wakeAll();
+	locker.unlock();
+
+	emit readChannelFinished();
+}
+
+qint64 StreamBuffer::readData(char* data, qint64 maxSize)
+{
+	QMutexLocker locker(&m_mutex);
+
+	int n = int(qMin(maxSize, qint64(m_data.size() - m_readPos)));
+	if (n <= 0)
+		return m_finished ? -1 : 0;
+
+	memcpy(data, m_data.constData() + m_readPos, n);
+	m_readPos += n;
+	return n;
+}
+
+qint64 StreamBuffer::writeData(const char* data, qint64 maxSize)
+{
+	Q_UNUSED(data);
+	Q_UNUSED(maxSize);
+	return -1;
+}
+
+void StreamBuffer::onSourceReadyRead()
+{
+	QIODevice* source = qobject_cast<QIODevice*>(sender());
+	Q_ASSERT(source != 0);
+
+	append(source->readAll());
+}
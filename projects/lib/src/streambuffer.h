@@ -0,0 +1,109 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STREAMBUFFER_H
+#define STREAMBUFFER_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QMutex>
+#include <QWaitCondition>
+
+/*!
+ * \brief A read-only QIODevice for data that arrives gradually.
+ *
+ * StreamBuffer connects a producer that receives data in chunks, eg.
+ * a QNetworkReply downloading a PGN archive, to a consumer like
+ * PgnStream that parses the data as it arrives. The producer either
+ * calls append() and finish(), or forwards a source device with
+ * setSource(). waitForReadyRead() blocks until more data is
+ * available or the stream is finished.
+ *
+ * The consumer can run in another thread. If it runs in the
+ * buffer's own thread, waitForReadyRead() runs a local event loop so
+ * that the source can make progress.
+ */
+class LIB_EXPORT StreamBuffer : public QIODevice
+{
+	Q_OBJECT
+
+	public:
+		/*! Creates a new, open StreamBuffer. */
+		explicit StreamBuffer(QObject* parent = 0);
+
+		/*!
+		 * Forwards the data from \a source to the buffer as it
+		 * becomes readable. The stream is finished when \a source
+		 * emits readChannelFinished().
+		 *
+		 * StreamBuffer doesn't take ownership of \a source.
+		 */
+		void setSource(QIODevice* source);
+		/*!
+		 * Returns true if the stream is finished.
+		 *
+		 * \note This function is thread-safe.
+		 */
+		bool isFinished() const;
+
+		/*!
+		 * Waits for more data from \a device if it's a sequential
+		 * device, eg. a socket or a StreamBuffer. Returns true if
+		 * more data may be available; returns false when the
+		 * stream has ended or no data arrived in \a msecs
+		 * milliseconds.
+		 */
+		static bool waitForData(QIODevice* device, int msecs = 30000);
+
+		// Inherited from QIODevice
+		virtual bool isSequential() const;
+		virtual qint64 bytesAvailable() const;
+		virtual bool atEnd() const;
+		virtual bool waitForReadyRead(int msecs);
+
+	public slots:
+		/*!
+		 * Appends \a data to the stream.
+		 *
+		 * \note This function is thread-safe.
+		 */
+		void append(const QByteArray& data);
+		/*!
+		 * Marks the end of the stream. The data in the buffer can
+		 * still be read.
+		 *
+		 * \note This function is thread-safe.
+		 */
+		void finish();
+
+	protected:
+		// Inherited from QIODevice
+		virtual qint64 readData(char* data, qint64 maxSize);
+		virtual qint64 writeData(const char* data, qint64 maxSize);
+
+	private slots:
+		void onSourceReadyRead();
+
+	private:
+		mutable QMutex m_mutex;
+		QWaitCondition m_dataReady;
+		QByteArray m_data;
+		int m_readPos;
+		bool m_finished;
+};
+
+#endif // STREAMBUFFER_H
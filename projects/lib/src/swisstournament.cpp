@@ -0,0 +1,272 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "swisstournament.h"
+#include <QtAlgorithms>
+
+// Pairing costs. A rematch is avoided whenever possible, and the
+// score difference (in half points) counts more than the colors.
+static const int s_rematchCost = 1000000;
+static const int s_colorCost = 4;
+
+// The maximum number of improvement passes over the matching
+static const int s_maxPasses = 32;
+
+SwissTournament::SwissTournament(GameManager* gameManager,
+				 QObject *parent)
+	: Tournament(gameManager, parent)
+{
+}
+
+QString SwissTournament::type() const
+{
+	return "swiss";
+}
+
+void SwissTournament::initializePairing()
+{
+	const int count = playerCount();
+	m_encounters.fill(0, count);
+	m_score.fill(0, count);
+	m_busy.fill(0, count);
+	m_colorBalance.fill(0, count);
+	m_met.fill(0, count * count);
+}
+
+int SwissTournament::gamesPerCycle() const
+{
+	return playerCount() / 2;
+}
+
+int SwissTournament::pairingCost(int first, int second) const
+{
+	// Compare the scores relative to 50% so that players who
+	// are a round apart can still be compared
+	const int games = gamesPerEncounter();
+	const int diff = (m_score.at(first) - m_encounters.at(first) * games)
+		       - (m_score.at(second) - m_encounters.at(second) * games);
+
+	int cost = diff * diff;
+	cost += m_met.at(first * playerCount() + second) * s_rematchCost;
+
+	// Both players are due the same color
+	const int b1 = m_colorBalance.at(first);
+	const int b2 = m_colorBalance.at(second);
+	if ((b1 > 0 && b2 > 0) || (b1 < 0 && b2 < 0))
+		cost += qMin(qAbs(b1), qAbs(b2)) * s_colorCost;
+
+	return cost;
+}
+
+bool SwissTournament::isBefore(int first, int second) const
+{
+	// Players who have played fewer rounds are paired first,
+	// then the players with the higher score
+	if (m_encounters.at(first) != m_encounters.at(second))
+		return m_encounters.at(first) < m_encounters.at(second);
+	if (m_score.at(first) != m_score.at(second))
+		return m_score.at(first) > m_score.at(second);
+	return first < second;
+}
+
+QPair<int, int> SwissTournament::nextPair()
+{
+	const int count = playerCount();
+	const int rounds = roundMultiplier();
+
+	int minEncounters = rounds;
+	bool busy = false;
+	for (int i = 0; i < count; i++)
+	{
+		if (m_encounters.at(i) < rounds)
+			minEncounters = qMin(minEncounters, m_encounters.at(i));
+		if (m_busy.at(i) > 0)
+			busy = true;
+	}
+
+	// The busy players take part in the matching so that the free
+	// players aren't paired with each other just because they
+	// happened to finish first, which would cause rematches
+	QList<int> players;
+	int freeCount = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (m_encounters.at(i) < rounds
+		&&  m_encounters.at(i) <= minEncounters + 1)
+		{
+			players.append(i);
+			if (m_busy.at(i) == 0)
+				freeCount++;
+		}
+	}
+
+	if (freeCount < 2)
+	{
+		// Wait for the running games unless nothing is running,
+		// in which case the remaining games must be played by
+		// whoever is left
+		if (busy)
+			return qMakePair(-1, -1);
+
+		players.clear();
+		for (int i = 0; i < count; i++)
+			players.append(i);
+	}
+
+	// Insertion sort by pairing priority
+	for (int i = 1; i < players.size(); i++)
+	{
+		const int player = players.at(i);
+		int j = i;
+		for (; j > 0 && isBefore(player, players.at(j - 1)); j--)
+			players[j] = players.at(j - 1);
+		players[j] = player;
+	}
+	if (players.size() % 2 != 0)
+		players.removeLast();
+
+	// Start from pairing neighbors in the ranking and improve the
+	// matching by exchanging opponents between two pairs as long
+	// as the total cost goes down
+	const int pairCount = players.size() / 2;
+	QVector<int> a(pairCount);
+	QVector<int> b(pairCount);
+	for (int i = 0; i < pairCount; i++)
+	{
+		a[i] = players.at(i * 2);
+		b[i] = players.at(i * 2 + 1);
+	}
+
+	for (int pass = 0; pass < s_maxPasses; pass++)
+	{
+		bool improved = false;
+		for (int i = 0; i < pairCount; i++)
+		{
+			for (int j = i + 1; j < pairCount; j++)
+			{
+				const int cost = pairingCost(a.at(i), b.at(i))
+					       + pairingCost(a.at(j), b.at(j));
+				const int cost1 = pairingCost(a.at(i), a.at(j))
+						+ pairingCost(b.at(i), b.at(j));
+				const int cost2 = pairingCost(a.at(i), b.at(j))
+						+ pairingCost(b.at(i), a.at(j));
+
+				if (cost1 < cost && cost1 <= cost2)
+				{
+					qSwap(b[i], a[j]);
+					improved = true;
+				}
+				else if (cost2 < cost)
+				{
+					qSwap(b[i], b[j]);
+					improved = true;
+				}
+			}
+		}
+		if (!improved)
+			break;
+	}
+
+	// Of the pairs whose players are both free, the one with the
+	// highest priority player is played now. The rest of the
+	// matching is recomputed on the next call with the latest
+	// results, and if no pair is free the busy players are waited for.
+	int white = -1;
+	int black = -1;
+	int bestRank = players.size();
+	for (int i = 0; i < pairCount; i++)
+	{
+		if (m_busy.at(a.at(i)) > 0 || m_busy.at(b.at(i)) > 0)
+			continue;
+
+		const int rank = qMin(players.indexOf(a.at(i)),
+				      players.indexOf(b.at(i)));
+		if (rank < bestRank)
+		{
+			white = a.at(i);
+			black = b.at(i);
+			bestRank = rank;
+		}
+	}
+	if (white == -1)
+		return qMakePair(-1, -1);
+
+	// The player with fewer white games gets white
+	if (m_colorBalance.at(black) < m_colorBalance.at(white)
+	||  (m_colorBalance.at(black) == m_colorBalance.at(white)
+	 &&  (m_encounters.at(white) + m_encounters.at(black)) % 2 == 1))
+		qSwap(white, black);
+
+	const int games = gamesPerEncounter();
+	m_encounters[white]++;
+	m_encounters[black]++;
+	m_busy[white] += games;
+	m_busy[black] += games;
+	m_met[white * count + black]++;
+	m_met[black * count + white]++;
+
+	// Color-reversed repeats of the encounter cancel out
+	m_colorBalance[white] += games % 2;
+	m_colorBalance[black] -= games % 2;
+
+	setCurrentRound(qMax(m_encounters.at(white), m_encounters.at(black)));
+	return qMakePair(white, black);
+}
+
+void SwissTournament::addGameResult(int whiteIndex,
+				    int blackIndex,
+				    const Chess::Result& result)
+{
+	m_busy[whiteIndex]--;
+	m_busy[blackIndex]--;
+
+	if (result.winner() == Chess::Side::White)
+		m_score[whiteIndex] += 2;
+	else if (result.winner() == Chess::Side::Black)
+		m_score[blackIndex] += 2;
+	else if (result.isDraw())
+	{
+		m_score[whiteIndex]++;
+		m_score[blackIndex]++;
+	}
+}
+
+bool SwissTournament::hasFixedPairings() const
+{
+	return false;
+}
+
+QVariantMap SwissTournament::pairingState() const
+{
+	QVariantMap state;
+	state["encounters"] = toVariantList(m_encounters);
+	state["score"] = toVariantList(m_score);
+	state["busy"] = toVariantList(m_busy);
+	state["colorBalance"] = toVariantList(m_colorBalance);
+	state["met"] = toVariantList(m_met);
+
+	return state;
+}
+
+bool SwissTournament::setPairingState(const QVariantMap& state)
+{
+	return fromVariantList(state.value("encounters"), m_encounters)
+	    && fromVariantList(state.value("score"), m_score)
+	    && fromVariantList(state.value("busy"), m_busy)
+	    && fromVariantList(state.value("colorBalance"), m_colorBalance)
+	    && fromVariantList(state.value("met"), m_met);
+}
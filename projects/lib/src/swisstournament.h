@@ -0,0 +1,72 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWISSTOURNAMENT_H
+#define SWISSTOURNAMENT_H
+
+#include "tournament.h"
+
+/*!
+ * \brief Swiss system chess tournament.
+ *
+ * In a Swiss tournament the players meet opponents with a similar
+ * score, and nobody meets the same opponent twice if it can be
+ * avoided. The number of rounds is set with setRoundMultiplier() and
+ * each round has playerCount() / 2 encounters.
+ *
+ * There's no barrier between the rounds: whenever at least two
+ * players are free, a minimum cost matching that weighs the score
+ * difference, rematches and colors is computed for all the players
+ * who can play next, including the busy ones, and a pair of free
+ * players from it is started. A player can get at most one round
+ * ahead of the players who are still playing their previous round.
+ */
+class LIB_EXPORT SwissTournament : public Tournament
+{
+	Q_OBJECT
+
+	public:
+		/*! Creates a new Swiss tournament. */
+		explicit SwissTournament(GameManager* gameManager,
+					 QObject *parent = 0);
+		// Inherited from Tournament
+		virtual QString type() const;
+
+	protected:
+		// Inherited from Tournament
+		virtual void initializePairing();
+		virtual int gamesPerCycle() const;
+		virtual QPair<int, int> nextPair();
+		virtual void addGameResult(int whiteIndex,
+					   int blackIndex,
+					   const Chess::Result& result);
+		virtual QVariantMap pairingState() const;
+		virtual bool setPairingState(const QVariantMap& state);
+		virtual bool hasFixedPairings() const;
+
+	private:
+		int pairingCost(int first, int second) const;
+		bool isBefore(int first, int second) const;
+
+		QVector<int> m_encounters;
+		QVector<int> m_score;
+		QVector<int> m_busy;
+		QVector<int> m_colorBalance;
+		QVector<int> m_met;
+};
+
+#endif // SWISSTOURNAMENT_H
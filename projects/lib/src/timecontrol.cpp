@@ -29,7 +29,13 @@ TimeControl::TimeControl()
 	  m_plyLimit(0),
 	  m_nodeLimit(0),
 	  m_lastMoveTime(0),
+	  m_lastMoveTimeNsecs(0),
 	  m_expiryMargin(0),
+	  m_latencyCredit(0),
+	  m_creditLeftNsecs(0),
+	  m_lastRawMoveTime(0),
+	  m_nodeTolerance(-1),
+	  m_timeScale(1.0),
 	  m_expired(false),
 	  m_infinite(false)
 {
@@ -45,7 +51,13 @@ TimeControl::TimeControl(const QString& str)
 	  m_plyLimit(0),
 	  m_nodeLimit(0),
 	  m_lastMoveTime(0),
+	  m_lastMoveTimeNsecs(0),
 	  m_expiryMargin(0),
+	  m_latencyCredit(0),
+	  m_creditLeftNsecs(0),
+	  m_lastRawMoveTime(0),
+	  m_nodeTolerance(-1),
+	  m_timeScale(1.0),
 	  m_expired(false),
 	  m_infinite(false)
 {
@@ -99,6 +111,8 @@ bool TimeControl::operator==(const TimeControl& other) const
 	&&  m_increment == other.m_increment
 	&&  m_plyLimit == other.m_plyLimit
 	&&  m_nodeLimit == other.m_nodeLimit
+	&&  m_nodeTolerance == other.m_nodeTolerance
+	&&  qFuzzyCompare(m_timeScale, other.m_timeScale)
 	&&  m_infinite == other.m_infinite)
 		return true;
 	return false;
@@ -113,6 +127,7 @@ bool TimeControl::isValid() const
 	||  m_plyLimit < 0
 	||  m_nodeLimit < 0
 	||  m_expiryMargin < 0
+	||  m_latencyCredit < 0
 	||  (m_timePerTc == m_timePerMove && !m_infinite))
 		return false;
 	return true;
@@ -186,6 +201,12 @@ QString TimeControl::toVerboseString() const
 		str += tr(", %1 plies").arg(m_plyLimit);
 	if (m_expiryMargin != 0)
 		str += tr(", %1 msec margin").arg(m_expiryMargin);
+	if (m_latencyCredit != 0)
+		str += tr(", %1 msec latency credit").arg(m_latencyCredit);
+	if (m_nodeTolerance >= 0 && (m_nodeLimit != 0 || m_plyLimit != 0))
+		str += tr(", strict limits");
+	if (!qFuzzyCompare(m_timeScale, 1.0))
+		str += tr(", scaled by %1").arg(m_timeScale, 0, 'f', 3);
 
 	return str;
 }
@@ -194,6 +215,9 @@ void TimeControl::initialize()
 {
 	m_expired = false;
 	m_lastMoveTime = 0;
+	m_lastMoveTimeNsecs = 0;
+	m_lastRawMoveTime = 0;
+	m_creditLeftNsecs = qint64(m_latencyCredit) * 1000000;
 
 	if (m_timePerTc != 0)
 	{
@@ -254,6 +278,16 @@ int TimeControl::expiryMargin() const
 	return m_expiryMargin;
 }
 
+int TimeControl::latencyCredit() const
+{
+	return m_latencyCredit;
+}
+
+int TimeControl::latencyCreditLeft() const
+{
+	return int(m_creditLeftNsecs / 1000000);
+}
+
 void TimeControl::setInfinity(bool enabled)
 {
 	m_infinite = enabled;
@@ -306,24 +340,79 @@ void TimeControl::setNodeLimit(int nodes)
 	m_nodeLimit = nodes;
 }
 
+int TimeControl::nodeTolerance() const
+{
+	return m_nodeTolerance;
+}
+
+bool TimeControl::isWithinLimits(int depth, quint64 nodes) const
+{
+	if (m_nodeTolerance < 0)
+		return true;
+	if (m_plyLimit > 0 && depth > m_plyLimit)
+		return false;
+	if (m_nodeLimit > 0 && nodes > 0
+	&&  nodes * 100 > quint64(m_nodeLimit) * (100 + m_nodeTolerance))
+		return false;
+	return true;
+}
+
+void TimeControl::setNodeTolerance(int percent)
+{
+	m_nodeTolerance = qMax(percent, -1);
+}
+
+double TimeControl::timeScale() const
+{
+	return m_timeScale;
+}
+
+void TimeControl::scale(double factor)
+{
+	Q_ASSERT(factor > 0.0);
+
+	m_timePerTc = qRound(m_timePerTc * factor);
+	m_timePerMove = qRound(m_timePerMove * factor);
+	m_increment = qRound(m_increment * factor);
+	m_timeScale *= factor;
+}
+
 void TimeControl::setExpiryMargin(int expiryMargin)
 {
 	Q_ASSERT(expiryMargin >= 0);
 	m_expiryMargin = expiryMargin;
 }
 
+void TimeControl::setLatencyCredit(int credit)
+{
+	Q_ASSERT(credit >= 0);
+	m_latencyCredit = credit;
+	m_creditLeftNsecs = qint64(credit) * 1000000;
+}
+
 void TimeControl::startTimer()
 {
 	m_time.start();
 }
 
-void TimeControl::update()
+qint64 TimeControl::elapsedNsecs() const
 {
+	return m_time.nsecsElapsed();
+}
+
+void TimeControl::update(qint64 delay, qint64 overhead)
+{
+	qint64 raw = qMax(m_time.nsecsElapsed() - delay, qint64(0));
+	qint64 refund = qBound(qint64(0), overhead, qMin(m_creditLeftNsecs, raw));
+	m_creditLeftNsecs -= refund;
+	m_lastMoveTimeNsecs = raw - refund;
+
 	/*
 	 * This will overflow after roughly 49 days however it's unlikely
 	 * we'll ever hit that limit.
 	 */
-	m_lastMoveTime = (int)m_time.elapsed();
+	m_lastMoveTime = int(m_lastMoveTimeNsecs / 1000000);
+	m_lastRawMoveTime = int(raw / 1000000);
 
 	if (!m_infinite && m_lastMoveTime > m_timeLeft + m_expiryMargin)
 		m_expired = true;
@@ -353,6 +442,16 @@ int TimeControl::lastMoveTime() const
 	return m_lastMoveTime;
 }
 
+qint64 TimeControl::lastMoveTimeNsecs() const
+{
+	return m_lastMoveTimeNsecs;
+}
+
+int TimeControl::lastRawMoveTime() const
+{
+	return m_lastRawMoveTime;
+}
+
 bool TimeControl::expired() const
 {
 	return m_expired;
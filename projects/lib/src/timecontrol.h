@@ -133,6 +133,40 @@ class LIB_EXPORT TimeControl
 		 * The default value is 0.
 		 */
 		int expiryMargin() const;
+		/*!
+		 * Returns the latency credit.
+		 *
+		 * Latency credit is the amount of harness overhead (eg. pipe
+		 * and event loop delays) that can be refunded to a player
+		 * during a game. The default value is 0, which disables the
+		 * refunds.
+		 */
+		int latencyCredit() const;
+		/*! Returns the latency credit left in the current game. */
+		int latencyCreditLeft() const;
+		/*!
+		 * Returns the allowed node count overrun in percent, or -1
+		 * if the node and ply limits aren't enforced.
+		 *
+		 * By default the limits are only passed to the engines.
+		 */
+		int nodeTolerance() const;
+		/*!
+		 * Returns true if a search of \a depth plies and \a nodes
+		 * nodes respects the ply and node limits, or if the limits
+		 * aren't enforced.
+		 *
+		 * A node count of 0 means that the player didn't report one,
+		 * and it isn't checked.
+		 */
+		bool isWithinLimits(int depth, quint64 nodes) const;
+		/*!
+		 * Returns the factor by which the clock times have been
+		 * scaled, or 1.0 if they haven't been scaled.
+		 *
+		 * \sa scale()
+		 */
+		double timeScale() const;
 
 
 		/*!
@@ -167,16 +201,53 @@ class LIB_EXPORT TimeControl
 
 		/*! Sets the expiry margin. */
 		void setExpiryMargin(int expiryMargin);
+		/*! Sets the latency credit to \a credit milliseconds. */
+		void setLatencyCredit(int credit);
+		/*!
+		 * Enforces the node and ply limits with a node count
+		 * tolerance of \a percent percent. A negative value disables
+		 * the enforcement.
+		 */
+		void setNodeTolerance(int percent);
+		/*!
+		 * Multiplies the time per time control, the time per move
+		 * and the time increment by \a factor.
+		 *
+		 * This is used for giving hosts of different speed the
+		 * same amount of work per move. The move counts and the
+		 * node and ply limits are not affected.
+		 */
+		void scale(double factor);
 
 		
 		/*! Start the timer. */
 		void startTimer();
 		
-		/*! Update the time control with the elapsed time. */
-		void update();
+		/*! Returns the number of nanoseconds since the timer was started. */
+		qint64 elapsedNsecs() const;
+		
+		/*!
+		 * Update the time control with the elapsed time.
+		 *
+		 * \a delay is the number of nanoseconds that have passed
+		 * since the move was received. It is not charged to the
+		 * player.
+		 *
+		 * \a overhead is the estimated harness overhead of the move
+		 * in nanoseconds. It is refunded to the player as far as the
+		 * latency credit allows.
+		 */
+		void update(qint64 delay = 0, qint64 overhead = 0);
 
 		/*! Returns the last elapsed move time. */
 		int lastMoveTime() const;
+		/*! Returns the last elapsed move time in nanoseconds. */
+		qint64 lastMoveTimeNsecs() const;
+		/*!
+		 * Returns the last move time before the latency refund,
+		 * in milliseconds.
+		 */
+		int lastRawMoveTime() const;
 
 		/*! Returns true if the allotted time has expired. */
 		bool expired() const;
@@ -200,7 +271,13 @@ class LIB_EXPORT TimeControl
 		int m_plyLimit;
 		int m_nodeLimit;
 		int m_lastMoveTime;
+		qint64 m_lastMoveTimeNsecs;
 		int m_expiryMargin;
+		int m_latencyCredit;
+		qint64 m_creditLeftNsecs;
+		int m_lastRawMoveTime;
+		int m_nodeTolerance;
+		double m_timeScale;
 		bool m_expired;
 		bool m_infinite;
 		QElapsedTimer m_time;
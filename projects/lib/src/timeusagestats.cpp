@@ -0,0 +1,85 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "timeusagestats.h"
+
+TimeUsageStats::TimeUsageStats()
+	: m_forfeits(0),
+	  m_nearMisses(0)
+{
+}
+
+bool TimeUsageStats::isEmpty() const
+{
+	return m_moveTimes.isEmpty() && m_forfeits == 0;
+}
+
+const LatencyStats& TimeUsageStats::moveTimes() const
+{
+	return m_moveTimes;
+}
+
+const LatencyStats& TimeUsageStats::overhead() const
+{
+	return m_overhead;
+}
+
+const LatencyStats& TimeUsageStats::refunds() const
+{
+	return m_refunds;
+}
+
+int TimeUsageStats::forfeits() const
+{
+	return m_forfeits;
+}
+
+int TimeUsageStats::nearMisses() const
+{
+	return m_nearMisses;
+}
+
+void TimeUsageStats::addMove(int moveTime,
+			     int reportedTime,
+			     int timeLeft,
+			     int expiryMargin,
+			     int refund)
+{
+	m_moveTimes.addSample(moveTime);
+	m_refunds.addSample(refund);
+	if (reportedTime > 0)
+		m_overhead.addSample(qMax(moveTime + refund - reportedTime, 0));
+
+	if (timeLeft >= 0
+	&&  moveTime > timeLeft
+	&&  moveTime <= timeLeft + expiryMargin)
+		m_nearMisses++;
+}
+
+void TimeUsageStats::addForfeit()
+{
+	m_forfeits++;
+}
+
+void TimeUsageStats::merge(const TimeUsageStats& other)
+{
+	m_moveTimes.merge(other.m_moveTimes);
+	m_overhead.merge(other.m_overhead);
+	m_refunds.merge(other.m_refunds);
+	m_forfeits += other.m_forfeits;
+	m_nearMisses += other.m_nearMisses;
+}
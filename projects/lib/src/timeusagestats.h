@@ -0,0 +1,92 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TIMEUSAGESTATS_H
+#define TIMEUSAGESTATS_H
+
+#include "latencystats.h"
+
+/*!
+ * \brief Statistics of a player's thinking time usage.
+ *
+ * TimeUsageStats collects the move times of a player, the timing
+ * overhead of each move, and the number of time forfeits and near
+ * misses. The overhead is the difference between the move time
+ * measured by Cute Chess and the time the engine reported, so a
+ * large overhead with few forfeits points to an overloaded host,
+ * while forfeits with a small overhead point to the engine's time
+ * management.
+ *
+ * With a latency credit (see TimeControl::latencyCredit()) part of
+ * the overhead is refunded, and the move times are the times charged
+ * to the player. The raw move time is the move time plus the refund.
+ */
+class LIB_EXPORT TimeUsageStats
+{
+	public:
+		/*! Creates a new empty TimeUsageStats object. */
+		TimeUsageStats();
+
+		/*! Returns true if no moves or forfeits have been added. */
+		bool isEmpty() const;
+		/*! Returns the statistics of the move times. */
+		const LatencyStats& moveTimes() const;
+		/*!
+		 * Returns the statistics of the timing overhead of the moves
+		 * for which the engine reported its own move time.
+		 */
+		const LatencyStats& overhead() const;
+		/*! Returns the statistics of the latency refunds of the moves. */
+		const LatencyStats& refunds() const;
+		/*! Returns the number of games lost on time. */
+		int forfeits() const;
+		/*!
+		 * Returns the number of moves that took longer than the time
+		 * left on the clock, but were saved by the expiry margin.
+		 */
+		int nearMisses() const;
+
+		/*!
+		 * Adds a move that took \a moveTime milliseconds when the
+		 * clock had \a timeLeft milliseconds and the expiry margin
+		 * was \a expiryMargin milliseconds.
+		 *
+		 * \a reportedTime is the move time reported by the engine,
+		 * or 0 if it didn't report one. A negative \a timeLeft means
+		 * that the time control is infinite. \a refund is the
+		 * latency refund in milliseconds that isn't included in
+		 * \a moveTime.
+		 */
+		void addMove(int moveTime,
+			     int reportedTime,
+			     int timeLeft,
+			     int expiryMargin,
+			     int refund = 0);
+		/*! Adds a time forfeit. */
+		void addForfeit();
+		/*! Merges the statistics of \a other into these statistics. */
+		void merge(const TimeUsageStats& other);
+
+	private:
+		LatencyStats m_moveTimes;
+		LatencyStats m_overhead;
+		LatencyStats m_refunds;
+		int m_forfeits;
+		int m_nearMisses;
+};
+
+#endif // TIMEUSAGESTATS_H
@@ -18,14 +18,44 @@
 
 #include "tournament.h"
 #include <QFile>
+#include <QTextStream>
+#include <QtAlgorithms>
+#include <jsonparser.h>
+#include <jsonserializer.h>
 #include "gamemanager.h"
 #include "playerbuilder.h"
 #include "board/boardfactory.h"
 #include "chessplayer.h"
+#include "chessengine.h"
 #include "chessgame.h"
 #include "pgnstream.h"
 #include "openingsuite.h"
 #include "sprt.h"
+#include "ratingsolver.h"
+#include "openingstats.h"
+#include "pgnwriter.h"
+#include "mersenne.h"
+#include "randomgenerator.h"
+#ifdef Q_OS_UNIX
+#include <cstdio>
+#include <unistd.h>
+#endif
+
+// The maximum number of finished games processed per event loop turn.
+// A larger backlog is drained over several turns so that the main
+// thread keeps serving the running games.
+static const int s_finishedBatchSize = 64;
+
+// The maximum number of finished games that wait for an earlier game
+// before they're saved anyway, out of order. This keeps a stuck game
+// from holding an unbounded number of games in memory.
+static const int s_maxPendingPgnGames = 1024;
+
+// The maximum number of unused GameData records kept for reuse
+static const int s_gameDataPoolSize = 256;
+
+// The version number of the checkpoint file format
+static const int s_checkpointVersion = 1;
 
 Tournament::Tournament(GameManager* gameManager, QObject *parent)
 	: QObject(parent),
@@ -34,8 +64,11 @@ Tournament::Tournament(GameManager* gameManager, QObject *parent)
 	  m_variant("standard"),
 	  m_round(0),
 	  m_nextGameNumber(0),
+	  m_randomSeed(0),
 	  m_finishedGameCount(0),
+	  m_skippedGameCount(0),
 	  m_savedGameCount(0),
+	  m_lastSavedGame(0),
 	  m_finalGameCount(0),
 	  m_gamesPerEncounter(1),
 	  m_roundMultiplier(1),
@@ -43,13 +76,34 @@ Tournament::Tournament(GameManager* gameManager, QObject *parent)
 	  m_openingDepth(1024),
 	  m_stopping(false),
 	  m_repeatOpening(false),
+	  m_collapseOpening(false),
 	  m_recover(false),
+	  m_abortOnStop(false),
+	  m_pairedStart(false),
 	  m_pgnCleanup(true),
+	  m_ownsBuilders(true),
 	  m_finished(false),
 	  m_openingSuite(0),
 	  m_sprt(new Sprt),
+	  m_ratings(new RatingSolver),
+	  m_openingStats(new OpeningStats),
+	  m_openingIndex(-1),
+	  m_repeatOpeningIndex(-1),
+	  m_pgnWriter(0),
+	  m_archiveWriter(0),
 	  m_pgnOutMode(PgnGame::Verbose),
-	  m_pair(QPair<int, int>(-1, -1))
+	  m_pgnRotateGames(0),
+	  m_pgnRotateSize(0),
+	  m_pair(QPair<int, int>(-1, -1)),
+	  m_decidedPlies(0),
+	  m_decidedGames(0),
+	  m_finishedPending(false),
+	  m_pairingPending(0),
+	  m_pairsFetched(0),
+	  m_encounterRound(0),
+	  m_shardIndex(0),
+	  m_shardCount(1),
+	  m_checkpointInterval(0)
 {
 	Q_ASSERT(gameManager != 0);
 }
@@ -60,11 +114,19 @@ Tournament::~Tournament()
 		qWarning("Tournament: Destroyed while games are still running.");
 
 	qDeleteAll(m_gameData);
-	foreach (const PlayerData& data, m_players)
-		delete data.builder;
+	qDeleteAll(m_gameDataPool);
+	if (m_ownsBuilders)
+	{
+		foreach (const PlayerData& data, m_players)
+			delete data.builder;
+	}
 
 	delete m_openingSuite;
 	delete m_sprt;
+	delete m_ratings;
+	delete m_openingStats;
+	delete m_pgnWriter;
+	delete m_archiveWriter;
 }
 
 GameManager* Tournament::gameManager() const
@@ -122,6 +184,34 @@ int Tournament::finalGameCount() const
 	return m_finalGameCount;
 }
 
+int Tournament::adjudicatedGameCount() const
+{
+	return m_adjudicatedGames.size();
+}
+
+int Tournament::openingNumber(int gameNumber) const
+{
+	return m_repeatOpening ? (gameNumber + 1) / 2 : gameNumber;
+}
+
+qint64 Tournament::adjudicationSavings() const
+{
+	if (m_decidedGames == 0)
+		return 0;
+
+	double averagePlies = double(m_decidedPlies) / m_decidedGames;
+	double savings = 0.0;
+	for (int i = 0; i < m_adjudicatedGames.size(); i++)
+	{
+		int plies = m_adjudicatedGames.at(i).first;
+		qint64 time = m_adjudicatedGames.at(i).second;
+		if (plies > 0 && plies < averagePlies)
+			savings += (averagePlies - plies) * time / plies;
+	}
+
+	return qint64(savings);
+}
+
 Tournament::PlayerData Tournament::playerAt(int index) const
 {
 	return m_players.at(index);
@@ -137,6 +227,21 @@ Sprt* Tournament::sprt() const
 	return m_sprt;
 }
 
+RatingSolver* Tournament::ratings() const
+{
+	return m_ratings;
+}
+
+OpeningSuite* Tournament::openingSuite() const
+{
+	return m_openingSuite;
+}
+
+OpeningStats* Tournament::openingStats() const
+{
+	return m_openingStats;
+}
+
 void Tournament::setName(const QString& name)
 {
 	m_name = name;
@@ -182,6 +287,16 @@ void Tournament::setRecoveryMode(bool recover)
 	m_recover = recover;
 }
 
+void Tournament::setAbortOnStop(bool enabled)
+{
+	m_abortOnStop = enabled;
+}
+
+void Tournament::setPairedStart(bool enabled)
+{
+	m_pairedStart = enabled;
+}
+
 void Tournament::setAdjudicator(const GameAdjudicator& adjudicator)
 {
 	m_adjudicator = adjudicator;
@@ -198,6 +313,22 @@ void Tournament::setOpeningDepth(int plies)
 	m_openingDepth = plies;
 }
 
+void Tournament::setOpeningCollapsed(bool enabled)
+{
+	m_collapseOpening = enabled;
+}
+
+void Tournament::setPgnRotation(int maxGames, qint64 maxSize)
+{
+	m_pgnRotateGames = maxGames;
+	m_pgnRotateSize = maxSize;
+}
+
+void Tournament::setArchiveOutput(const QString& fileName)
+{
+	m_archiveout = fileName;
+}
+
 void Tournament::setPgnOutput(const QString& fileName, PgnGame::PgnMode mode)
 {
 	m_pgnout = fileName;
@@ -209,11 +340,32 @@ void Tournament::setPgnCleanupEnabled(bool enabled)
 	m_pgnCleanup = enabled;
 }
 
+void Tournament::setPlayerBuildersOwned(bool owned)
+{
+	m_ownsBuilders = owned;
+}
+
 void Tournament::setOpeningRepetition(bool repeat)
 {
 	m_repeatOpening = repeat;
 }
 
+void Tournament::setCheckpoint(const QString& fileName, int interval)
+{
+	Q_ASSERT(interval >= 0);
+	m_checkpointFile = fileName;
+	m_checkpointInterval = interval;
+}
+
+void Tournament::setShard(int index, int count)
+{
+	Q_ASSERT(count > 0);
+	Q_ASSERT(index >= 0 && index < count);
+
+	m_shardIndex = index;
+	m_shardCount = count;
+}
+
 void Tournament::addPlayer(PlayerBuilder* builder,
 			   const TimeControl& timeControl,
 			   const OpeningBook* book,
@@ -221,30 +373,22 @@ void Tournament::addPlayer(PlayerBuilder* builder,
 {
 	Q_ASSERT(builder != 0);
 
-	PlayerData data = { builder, timeControl, book, bookDepth, 0, 0, 0 };
+	PlayerData data = { builder, timeControl, book, bookDepth, 0, 0, 0, 0,
+			    0, 0, 0,
+			    LatencyStats(), LatencyStats() };
 	m_players.append(data);
 }
 
-void Tournament::startNextGame()
+void Tournament::setPlayerHashSize(int index, int size)
 {
-	if (m_stopping || m_nextGameNumber >= m_finalGameCount)
-		return;
-
-	if (m_nextGameNumber % m_gamesPerEncounter == 0)
-	{
-		m_pair = nextPair();
-
-		if (m_players.size() > 2)
-		{
-			m_startFen.clear();
-			m_openingMoves.clear();
-		}
-	}
-	else
-		m_pair = qMakePair(m_pair.second, m_pair.first);
+	Q_ASSERT(index >= 0 && index < m_players.size());
+	m_players[index].hashSize = size;
+}
 
-	PlayerData& white = m_players[m_pair.first];
-	PlayerData& black = m_players[m_pair.second];
+ChessGame* Tournament::createGame(int whiteIndex, int blackIndex)
+{
+	const PlayerData& white = m_players.at(whiteIndex);
+	const PlayerData& black = m_players.at(blackIndex);
 
 	Chess::Board* board = Chess::BoardFactory::create(m_variant);
 	Q_ASSERT(board != 0);
@@ -253,7 +397,7 @@ void Tournament::startNextGame()
 	connect(game, SIGNAL(started(ChessGame*)),
 		this, SLOT(onGameStarted(ChessGame*)));
 	connect(game, SIGNAL(finished(ChessGame*)),
-		this, SLOT(onGameFinished(ChessGame*)));
+		this, SLOT(onGameFinished(ChessGame*)), Qt::DirectConnection);
 
 	game->setTimeControl(white.timeControl, Chess::Side::White);
 	game->setTimeControl(black.timeControl, Chess::Side::Black);
@@ -261,6 +405,81 @@ void Tournament::startNextGame()
 	game->setOpeningBook(white.book, Chess::Side::White, white.bookDepth);
 	game->setOpeningBook(black.book, Chess::Side::Black, black.bookDepth);
 
+	return game;
+}
+
+void Tournament::startGame(ChessGame* game,
+			   int number,
+			   int whiteIndex,
+			   int blackIndex,
+			   int round,
+			   int openingIndex)
+{
+	game->pgn()->setEvent(m_name);
+	game->pgn()->setSite(m_site);
+	game->pgn()->setRound(round);
+	if (m_players.at(whiteIndex).hashSize > 0)
+		game->pgn()->setTag("WhiteHash",
+			QString::number(m_players.at(whiteIndex).hashSize));
+	if (m_players.at(blackIndex).hashSize > 0)
+		game->pgn()->setTag("BlackHash",
+			QString::number(m_players.at(blackIndex).hashSize));
+
+	game->setStartDelay(m_startDelay);
+	game->setOpeningCollapsed(m_collapseOpening);
+	game->setAdjudicator(m_adjudicator);
+
+	GameData* data = newGameData();
+	data->number = number;
+	data->whiteIndex = whiteIndex;
+	data->blackIndex = blackIndex;
+	data->round = round;
+	data->openingIndex = openingIndex;
+	data->startFen = game->startingFen();
+	data->openingMoves = game->moves();
+	m_gameData[game] = data;
+
+	connect(game, SIGNAL(startFailed(ChessGame*)),
+		this, SLOT(onGameStartFailed(ChessGame*)));
+	m_gameManager->newGame(game,
+			       m_players.at(whiteIndex).builder,
+			       m_players.at(blackIndex).builder,
+			       GameManager::Enqueue,
+			       GameManager::ReusePlayers,
+			       this);
+}
+
+ChessGame* Tournament::createNextGame()
+{
+	if (m_nextGameNumber % m_gamesPerEncounter == 0)
+	{
+		const QPair<int, int> pair(takeEncounter());
+		if (pair.first == -1)
+		{
+			// Try again when a game finishes. If no game is
+			// running the pairing would never become available.
+			if (m_gameData.isEmpty())
+			{
+				m_error = "No pairing available for the next game";
+				stop();
+			}
+			else
+				m_pairingPending++;
+			return 0;
+		}
+		m_pair = pair;
+
+		if (m_players.size() > 2)
+		{
+			m_startFen.clear();
+			m_openingMoves.clear();
+		}
+	}
+	else
+		m_pair = qMakePair(m_pair.second, m_pair.first);
+
+	ChessGame* game = createGame(m_pair.first, m_pair.second);
+
 	bool isRepeat = false;
 	if (!m_startFen.isEmpty() || !m_openingMoves.isEmpty())
 	{
@@ -268,38 +487,168 @@ void Tournament::startNextGame()
 		game->setMoves(m_openingMoves);
 		m_startFen.clear();
 		m_openingMoves.clear();
+		m_openingIndex = m_repeatOpeningIndex;
 		isRepeat = true;
 	}
 	else if (m_openingSuite != 0)
+	{
 		game->setMoves(m_openingSuite->nextGame(m_openingDepth));
+		m_openingIndex = m_openingSuite->lastIndex();
+	}
+	else
+		m_openingIndex = -1;
 
+	game->setRandomGenerator(RandomGenerator(m_randomSeed, m_nextGameNumber));
 	game->generateOpening();
 	if (m_repeatOpening && !isRepeat)
 	{
 		m_startFen = game->startingFen();
 		m_openingMoves = game->moves();
+		m_repeatOpeningIndex = m_openingIndex;
 	}
 
-	game->pgn()->setEvent(m_name);
-	game->pgn()->setSite(m_site);
-	game->pgn()->setRound(m_round);
+	return game;
+}
 
-	game->setStartDelay(m_startDelay);
-	game->setAdjudicator(m_adjudicator);
+int Tournament::shardOf(int gameIndex) const
+{
+	// A two-player match with repeated openings and an odd number
+	// of games per encounter repeats the openings across encounters,
+	// so the blocks are made large enough to keep the pairs together
+	int blockSize = m_gamesPerEncounter;
+	if (m_repeatOpening && m_players.size() == 2 && blockSize % 2 != 0)
+		blockSize *= 2;
+
+	return (gameIndex / blockSize) % m_shardCount;
+}
 
-	GameData* data = new GameData;
-	data->number = ++m_nextGameNumber;
-	data->whiteIndex = m_pair.first;
-	data->blackIndex = m_pair.second;
-	m_gameData[game] = data;
+void Tournament::skipOtherShards()
+{
+	if (m_shardCount <= 1)
+		return;
 
-	connect(game, SIGNAL(startFailed(ChessGame*)),
-		this, SLOT(onGameStartFailed(ChessGame*)));
-	m_gameManager->newGame(game,
-			       white.builder,
-			       black.builder,
-			       GameManager::Enqueue,
-			       GameManager::ReusePlayers);
+	// The games of the other shards are set up and thrown away, so
+	// that the pairings, openings and random numbers of this shard's
+	// games are the same as in the complete tournament
+	while (m_nextGameNumber < m_finalGameCount
+	&&     shardOf(m_nextGameNumber) != m_shardIndex)
+	{
+		ChessGame* game = createNextGame();
+		if (game == 0)
+			break;
+
+		m_nextGameNumber++;
+		m_skippedGameCount++;
+		delete game->pgn();
+		delete game;
+	}
+}
+
+void Tournament::startNextGame()
+{
+	if (m_stopping)
+		return;
+
+	// Games that were interrupted by the end of the previous
+	// session are played again before any new games
+	if (!m_resumeGames.isEmpty())
+	{
+		const GameData data(m_resumeGames.takeFirst());
+		ChessGame* game = createGame(data.whiteIndex, data.blackIndex);
+		game->setStartingFen(data.startFen);
+		game->setMoves(data.openingMoves);
+		game->setRandomGenerator(RandomGenerator(m_randomSeed, data.number - 1));
+		startGame(game, data.number, data.whiteIndex,
+			  data.blackIndex, data.round, data.openingIndex);
+		return;
+	}
+
+	if (m_nextGameNumber >= m_finalGameCount)
+		return;
+
+	// The first game of an opening pair waits for a second free
+	// slot, which is coming when the running games end
+	const bool pairedStart = m_pairedStart
+		&& m_repeatOpening
+		&& m_gameManager->concurrency() >= 2
+		&& m_startFen.isEmpty() && m_openingMoves.isEmpty();
+	if (pairedStart
+	&&  m_gameManager->freeSlotCount() < 2
+	&&  !m_gameData.isEmpty())
+		return;
+
+	ChessGame* game = createNextGame();
+	if (game == 0)
+		return;
+
+	startGame(game, ++m_nextGameNumber, m_pair.first, m_pair.second,
+		  m_encounterRound, m_openingIndex);
+
+	// Queue the color-reversed game right behind the first one
+	if (pairedStart
+	&&  (!m_startFen.isEmpty() || !m_openingMoves.isEmpty())
+	&&  m_nextGameNumber < m_finalGameCount
+	&&  (m_shardCount <= 1 || shardOf(m_nextGameNumber) == m_shardIndex))
+	{
+		game = createNextGame();
+		if (game != 0)
+			startGame(game, ++m_nextGameNumber, m_pair.first,
+				  m_pair.second, m_encounterRound, m_openingIndex);
+	}
+	skipOtherShards();
+}
+
+QPair<int, int> Tournament::takeEncounter()
+{
+	if (!hasFixedPairings())
+	{
+		const QPair<int, int> pair(nextPair());
+		m_encounterRound = m_round;
+		return pair;
+	}
+
+	// Fetch the encounters ahead of time so that an encounter from
+	// a later round can start while the players of the earlier
+	// ones are still playing
+	// A sharded tournament takes the encounters in order so that
+	// every shard agrees on the game numbers
+	const int encounterCount = m_finalGameCount / m_gamesPerEncounter;
+	const int lookahead = (m_shardCount > 1) ? 1 : m_players.size();
+	while (m_upcoming.size() < lookahead && m_pairsFetched < encounterCount)
+	{
+		const QPair<int, int> pair(nextPair());
+		Encounter encounter = { pair.first, pair.second, m_round };
+		m_upcoming.append(encounter);
+		m_pairsFetched++;
+	}
+	if (m_upcoming.isEmpty())
+		return qMakePair(-1, -1);
+
+	QVector<int> busy(m_players.size(), 0);
+	foreach (const GameData* data, m_gameData)
+	{
+		busy[data->whiteIndex]++;
+		busy[data->blackIndex]++;
+	}
+
+	// Prefer the earliest encounter whose players are free
+	int best = 0;
+	int bestBusy = -1;
+	for (int i = 0; i < m_upcoming.size() && bestBusy != 0; i++)
+	{
+		const Encounter& encounter = m_upcoming.at(i);
+		const int count = busy.at(encounter.whiteIndex)
+				+ busy.at(encounter.blackIndex);
+		if (bestBusy == -1 || count < bestBusy)
+		{
+			best = i;
+			bestBusy = count;
+		}
+	}
+
+	const Encounter encounter(m_upcoming.takeAt(best));
+	m_encounterRound = encounter.round;
+	return qMakePair(encounter.whiteIndex, encounter.blackIndex);
 }
 
 void Tournament::onGameStarted(ChessGame* game)
@@ -318,6 +667,48 @@ void Tournament::onGameFinished(ChessGame* game)
 {
 	Q_ASSERT(game != 0);
 
+	// Called directly from the game's thread. Only the first game of
+	// a batch posts an event to the tournament's thread; the rest are
+	// picked up by the same processFinishedGames() call.
+	QMutexLocker locker(&m_finishedMutex);
+	m_finishedGames.append(game);
+	if (m_finishedPending)
+		return;
+
+	m_finishedPending = true;
+	QMetaObject::invokeMethod(this, "processFinishedGames",
+				  Qt::QueuedConnection);
+}
+
+void Tournament::processFinishedGames()
+{
+	QList<ChessGame*> batch;
+	{
+		QMutexLocker locker(&m_finishedMutex);
+		if (m_finishedGames.size() <= s_finishedBatchSize)
+		{
+			batch = m_finishedGames;
+			m_finishedGames.clear();
+			m_finishedPending = false;
+		}
+		else
+		{
+			batch = m_finishedGames.mid(0, s_finishedBatchSize);
+			m_finishedGames.erase(m_finishedGames.begin(),
+					      m_finishedGames.begin() + s_finishedBatchSize);
+			QMetaObject::invokeMethod(this, "processFinishedGames",
+						  Qt::QueuedConnection);
+		}
+	}
+
+	foreach (ChessGame* game, batch)
+		processFinishedGame(game);
+}
+
+void Tournament::processFinishedGame(ChessGame* game)
+{
+	Q_ASSERT(game != 0);
+
 	PgnGame* pgn(game->pgn());
 	Chess::Result result(game->result());
 
@@ -328,16 +719,31 @@ void Tournament::onGameFinished(ChessGame* game)
 	int gameNumber = data->number;
 	Sprt::GameResult sprtResult = Sprt::NoResult;
 
+	for (int i = 0; i < 2; i++)
+	{
+		Chess::Side side = Chess::Side::Type(i);
+		PlayerData& player = m_players[side == Chess::Side::White ?
+						data->whiteIndex : data->blackIndex];
+		if (player.book == 0)
+			continue;
+		player.bookGames++;
+		player.bookMoves += game->bookMoveCount(side);
+		if (game->leftBookEarly(side))
+			player.bookExits++;
+	}
+
 	switch (game->result().winner())
 	{
 	case Chess::Side::White:
 		m_players[data->whiteIndex].wins++;
 		m_players[data->blackIndex].losses++;
+		m_ratings->addGameResult(data->whiteIndex, data->blackIndex, 2);
 		sprtResult = (data->whiteIndex == 0) ? Sprt::Win : Sprt::Loss;
 		break;
 	case Chess::Side::Black:
 		m_players[data->blackIndex].wins++;
 		m_players[data->whiteIndex].losses++;
+		m_ratings->addGameResult(data->whiteIndex, data->blackIndex, 0);
 		sprtResult = (data->blackIndex == 0) ? Sprt::Win : Sprt::Loss;
 		break;
 	default:
@@ -345,19 +751,43 @@ void Tournament::onGameFinished(ChessGame* game)
 		{
 			m_players[data->whiteIndex].draws++;
 			m_players[data->blackIndex].draws++;
+			m_ratings->addGameResult(data->whiteIndex, data->blackIndex, 1);
 			sprtResult = Sprt::Draw;
 		}
 		break;
 	}
 
-	if (!m_pgnout.isEmpty())
+	if (!m_pgnout.isEmpty() || !m_archiveout.isEmpty())
 	{
-		m_pgnGames[gameNumber] = *pgn;
-		while (m_pgnGames.contains(m_savedGameCount + 1))
+		// An aborted game counts as saved, so that the games
+		// after it don't wait for it
+		if (m_abortOnStop && m_stopping && result.isNone())
+			m_savedAhead.insert(gameNumber);
+		else if (m_pgnCleanup)
+			m_pgnGames[gameNumber].swap(*pgn);
+		else
+			m_pgnGames[gameNumber] = *pgn;
+		forever
+		{
+			const int next = m_savedGameCount + 1;
+			if (m_savedAhead.remove(next))
+				m_savedGameCount++;
+			else if (m_pgnGames.contains(next))
+			{
+				m_savedGameCount++;
+				savePgnGame(next, m_pgnGames.take(next));
+			}
+			else
+				break;
+		}
+
+		// Save the oldest games out of order if an earlier game
+		// is taking too long
+		while (m_pgnGames.size() > s_maxPendingPgnGames)
 		{
-			PgnGame tmp = m_pgnGames.take(++m_savedGameCount);
-			if (!tmp.write(m_pgnout, m_pgnOutMode))
-				qWarning("Can't write to PGN file %s", qPrintable(m_pgnout));
+			const int number = m_pgnGames.constBegin().key();
+			m_savedAhead.insert(number);
+			savePgnGame(number, m_pgnGames.take(number));
 		}
 	}
 	if (m_pgnCleanup)
@@ -369,16 +799,63 @@ void Tournament::onGameFinished(ChessGame* game)
 	if (!m_recover && crashed)
 		stop();
 
-	if (!m_sprt->isNull() && sprtResult != Sprt::NoResult)
+	if (!m_sprt->isNull())
 	{
-		m_sprt->addGameResult(sprtResult);
-		if (m_sprt->status().result != Sprt::Continue)
-			QMetaObject::invokeMethod(this, "stop", Qt::QueuedConnection);
+		// With repeated openings games 2n-1 and 2n are played
+		// with the same opening and reversed colors
+		if (m_repeatOpening)
+		{
+			const int pair = (gameNumber + 1) / 2;
+			if (m_sprtPairResults.contains(pair))
+				m_sprt->addGamePairResult(
+					Sprt::GameResult(m_sprtPairResults.take(pair)),
+					sprtResult);
+			else
+				m_sprtPairResults[pair] = sprtResult;
+		}
+
+		if (sprtResult != Sprt::NoResult)
+		{
+			m_sprt->addGameResult(sprtResult);
+			if (m_sprt->status().result != Sprt::Continue)
+				QMetaObject::invokeMethod(this, "stop", Qt::QueuedConnection);
+		}
+	}
+
+	updateLatency(game->player(Chess::Side::White), data->whiteIndex);
+	updateLatency(game->player(Chess::Side::Black), data->blackIndex);
+
+	// Adjudicated games are compared with the games that were
+	// played to the end on the board
+	int plies = game->moves().size();
+	if (resultType == Chess::Result::Adjudication)
+	{
+		qint64 time = game->player(Chess::Side::White)->gameTime()
+			    + game->player(Chess::Side::Black)->gameTime();
+		m_adjudicatedGames.append(qMakePair(plies, time));
+	}
+	else if (resultType == Chess::Result::Win
+	     ||  resultType == Chess::Result::Draw)
+	{
+		m_decidedPlies += plies;
+		m_decidedGames++;
 	}
+	m_openingStats->addResult(data->openingIndex, result);
+	addGameResult(data->whiteIndex, data->blackIndex, result);
 
 	emit gameFinished(game, gameNumber, data->whiteIndex, data->blackIndex);
 
-	if (m_finishedGameCount == m_finalGameCount
+	if (!m_checkpointFile.isEmpty() && !m_stopping
+	&&  (m_finishedGameCount + m_skippedGameCount == m_finalGameCount
+	 ||  m_checkpointTimer.elapsed() >= m_checkpointInterval))
+	{
+		if (!saveCheckpoint())
+			qWarning("Can't write checkpoint file %s",
+				 qPrintable(m_checkpointFile));
+		m_checkpointTimer.restart();
+	}
+
+	if (m_finishedGameCount + m_skippedGameCount == m_finalGameCount
 	||  (m_stopping && m_gameData.isEmpty()))
 	{
 		m_stopping = false;
@@ -387,8 +864,186 @@ void Tournament::onGameFinished(ChessGame* game)
 			this, SLOT(onGameDestroyed(ChessGame*)));
 	}
 
-	delete data;
+	releaseGameData(data);
 	game->deleteLater();
+
+	// Start the games whose pairings had to wait for this result
+	const int pending = m_pairingPending;
+	m_pairingPending = 0;
+	for (int i = 0; i < pending && !m_stopping; i++)
+		startNextGame();
+}
+
+void Tournament::savePgnGame(int number, PgnGame game)
+{
+	// A game that doesn't follow the previously saved game gets
+	// its number in a tag, so that the order can be restored
+	if (number != m_lastSavedGame + 1)
+		game.setTag("GameNumber", QString::number(number));
+	m_lastSavedGame = number;
+
+	if (!m_pgnout.isEmpty())
+	{
+		if (m_pgnWriter == 0)
+		{
+			m_pgnWriter = new PgnWriter(m_pgnout, m_pgnOutMode);
+			m_pgnWriter->setRotation(m_pgnRotateGames,
+						 m_pgnRotateSize);
+			m_pgnWriter->start();
+		}
+		m_pgnWriter->write(game);
+	}
+	if (!m_archiveout.isEmpty())
+	{
+		if (m_archiveWriter == 0)
+		{
+			m_archiveWriter = new PgnWriter(m_archiveout,
+				m_pgnOutMode, PgnWriter::ArchiveFormat);
+			m_archiveWriter->start();
+		}
+		m_archiveWriter->write(game);
+	}
+}
+
+Tournament::GameData* Tournament::newGameData()
+{
+	if (!m_gameDataPool.isEmpty())
+		return m_gameDataPool.takeLast();
+	return new GameData;
+}
+
+void Tournament::releaseGameData(GameData* data)
+{
+	if (data == 0)
+		return;
+	if (m_gameDataPool.size() >= s_gameDataPoolSize)
+	{
+		delete data;
+		return;
+	}
+
+	data->startFen.clear();
+	data->openingMoves.clear();
+	m_gameDataPool.append(data);
+}
+
+void Tournament::updateLatency(ChessPlayer* player, int playerIndex)
+{
+	ChessEngine* engine = qobject_cast<ChessEngine*>(player);
+	if (engine == 0)
+		return;
+
+	// The engine's statistics are cumulative, so the latest snapshot
+	// of each engine instance replaces the previous one. An engine
+	// that is restarted between games gets a new instance and id.
+	EngineLatency& latency = m_engineLatency[engine->id()];
+	latency.playerIndex = playerIndex;
+	latency.pingStats = engine->pingStats();
+	latency.responseStats = engine->responseStats();
+	latency.timeUsage = engine->timeUsage();
+	latency.searchStats = engine->searchStats();
+	latency.resourceStats = engine->resourceStats();
+
+	PlayerData& data = m_players[playerIndex];
+	data.pingStats = LatencyStats();
+	data.responseStats = LatencyStats();
+	data.timeUsage = TimeUsageStats();
+	data.searchStats = SearchStats();
+	data.resourceStats = ResourceStats();
+	foreach (const EngineLatency& tmp, m_engineLatency)
+	{
+		if (tmp.playerIndex != playerIndex)
+			continue;
+		data.pingStats.merge(tmp.pingStats);
+		data.responseStats.merge(tmp.responseStats);
+		data.timeUsage.merge(tmp.timeUsage);
+		data.searchStats.merge(tmp.searchStats);
+		data.resourceStats.merge(tmp.resourceStats);
+	}
+}
+
+void Tournament::addGameResult(int whiteIndex,
+			       int blackIndex,
+			       const Chess::Result& result)
+{
+	Q_UNUSED(whiteIndex);
+	Q_UNUSED(blackIndex);
+	Q_UNUSED(result);
+}
+
+QVariantMap Tournament::summary() const
+{
+	QVariantMap summary;
+	summary["shard"] = m_shardIndex + 1;
+	summary["shards"] = m_shardCount;
+	summary["games"] = m_finishedGameCount;
+
+	QVariantList players;
+	foreach (const PlayerData& data, m_players)
+	{
+		QVariantMap player;
+		player["name"] = data.builder->name();
+		player["wins"] = data.wins;
+		player["draws"] = data.draws;
+		player["losses"] = data.losses;
+		players << player;
+	}
+	summary["players"] = players;
+
+	QVariantList pairs;
+	foreach (const RatingSolver::Results& results, m_ratings->results())
+	{
+		QVariantList pair;
+		pair << results.first << results.second
+		     << results.games << results.halfPoints;
+		pairs << QVariant(pair);
+	}
+	summary["pairs"] = pairs;
+
+	if (m_sprt->model() == Sprt::Pentanomial)
+	{
+		QVariantList ptnml;
+		for (int i = 0; i <= 4; i++)
+			ptnml << m_sprt->pairResultCount(i);
+		summary["ptnml"] = ptnml;
+	}
+
+	return summary;
+}
+
+QVariantMap Tournament::pairingState() const
+{
+	return QVariantMap();
+}
+
+bool Tournament::setPairingState(const QVariantMap& state)
+{
+	Q_UNUSED(state);
+	return false;
+}
+
+bool Tournament::hasFixedPairings() const
+{
+	return true;
+}
+
+QVariantList Tournament::toVariantList(const QVector<int>& values)
+{
+	QVariantList list;
+	foreach (int value, values)
+		list << value;
+	return list;
+}
+
+bool Tournament::fromVariantList(const QVariant& var, QVector<int>& values)
+{
+	const QVariantList list(var.toList());
+	if (list.size() != values.size())
+		return false;
+
+	for (int i = 0; i < list.size(); i++)
+		values[i] = list.at(i).toInt();
+	return true;
 }
 
 void Tournament::onGameDestroyed(ChessGame* game)
@@ -398,17 +1053,458 @@ void Tournament::onGameDestroyed(ChessGame* game)
 
 	m_lastGame = 0;
 	m_gameManager->cleanupIdleThreads();
+	closePgnOutput();
 	m_finished = true;
 	emit finished();
 }
 
+void Tournament::closePgnOutput()
+{
+	// Make sure that all the games are on the disk when the
+	// tournament is declared finished
+	delete m_pgnWriter;
+	m_pgnWriter = 0;
+	delete m_archiveWriter;
+	m_archiveWriter = 0;
+}
+
+static bool gameNumberLessThan(const QVariant& a, const QVariant& b)
+{
+	return a.toMap().value("number").toInt() < b.toMap().value("number").toInt();
+}
+
+static bool writeCheckpointFile(const QString& fileName, const QVariant& data)
+{
+	// Write to a temporary file and rename it over the old
+	// checkpoint so that a crash never leaves a partial file
+	const QString tmpName(fileName + ".tmp");
+	QFile file(tmpName);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+		return false;
+
+	QTextStream out(&file);
+	JsonSerializer serializer(data);
+	bool ok = serializer.serialize(out);
+	out.flush();
+	ok = ok && out.status() == QTextStream::Ok && file.flush();
+#ifdef Q_OS_UNIX
+	ok = ok && fsync(file.handle()) == 0;
+#endif
+	file.close();
+	if (!ok)
+	{
+		QFile::remove(tmpName);
+		return false;
+	}
+
+#ifdef Q_OS_UNIX
+	return ::rename(QFile::encodeName(tmpName).constData(),
+			QFile::encodeName(fileName).constData()) == 0;
+#else
+	QFile::remove(fileName);
+	return QFile::rename(tmpName, fileName);
+#endif
+}
+
+QStringList Tournament::moveStrings(const QString& fen,
+				    const QVector<Chess::Move>& moves) const
+{
+	Chess::Board* board = Chess::BoardFactory::create(m_variant);
+	Q_ASSERT(board != 0);
+	if (fen.isEmpty())
+		board->reset();
+	else
+		board->setFenString(fen);
+
+	QStringList strings;
+	foreach (const Chess::Move& move, moves)
+	{
+		strings << board->moveString(move, Chess::Board::LongAlgebraic);
+		board->makeMove(move);
+	}
+
+	delete board;
+	return strings;
+}
+
+bool Tournament::parseMoves(const QString& fen,
+			    const QStringList& strings,
+			    QVector<Chess::Move>* moves) const
+{
+	Q_ASSERT(moves != 0);
+
+	Chess::Board* board = Chess::BoardFactory::create(m_variant);
+	Q_ASSERT(board != 0);
+	bool ok = true;
+	if (fen.isEmpty())
+		board->reset();
+	else
+		ok = board->setFenString(fen);
+
+	moves->clear();
+	for (int i = 0; ok && i < strings.size(); i++)
+	{
+		Chess::Move move(board->moveFromString(strings.at(i)));
+		if (move.isNull())
+			ok = false;
+		else
+		{
+			moves->append(move);
+			board->makeMove(move);
+		}
+	}
+
+	delete board;
+	return ok;
+}
+
+bool Tournament::saveCheckpoint()
+{
+	// The checkpoint must not claim any games that aren't
+	// safely on the disk yet
+	if (m_pgnWriter != 0)
+		m_pgnWriter->sync();
+	if (m_archiveWriter != 0)
+		m_archiveWriter->sync();
+
+	QVariantMap state;
+	state["version"] = s_checkpointVersion;
+	state["type"] = type();
+	state["playerCount"] = m_players.size();
+	state["finalGameCount"] = m_finalGameCount;
+	state["gamesPerEncounter"] = m_gamesPerEncounter;
+	state["nextGameNumber"] = m_nextGameNumber;
+	state["finishedGameCount"] = m_finishedGameCount;
+	state["skippedGameCount"] = m_skippedGameCount;
+	state["savedGameCount"] = m_savedGameCount;
+	state["lastSavedGame"] = m_lastSavedGame;
+
+	QVariantList savedAhead;
+	foreach (int number, m_savedAhead)
+		savedAhead << number;
+	state["savedAhead"] = savedAhead;
+	state["round"] = m_round;
+	state["encounterRound"] = m_encounterRound;
+	state["pair"] = QVariantList() << m_pair.first << m_pair.second;
+	state["pairsFetched"] = m_pairsFetched;
+
+	QVariantList upcoming;
+	foreach (const Encounter& encounter, m_upcoming)
+	{
+		upcoming << QVariant(QVariantList() << encounter.whiteIndex
+					<< encounter.blackIndex
+					<< encounter.round);
+	}
+	state["upcoming"] = upcoming;
+
+	const QVariantMap pairing(pairingState());
+	if (!pairing.isEmpty())
+		state["pairing"] = pairing;
+
+	QVariantList players;
+	foreach (const PlayerData& player, m_players)
+	{
+		QVariantMap map;
+		map["wins"] = player.wins;
+		map["draws"] = player.draws;
+		map["losses"] = player.losses;
+		players << map;
+	}
+	state["players"] = players;
+
+	QVariantList ratings;
+	foreach (const RatingSolver::Results& results, m_ratings->results())
+	{
+		QVariantList list;
+		list << results.first << results.second
+		     << results.games << results.halfPoints;
+		ratings << QVariant(list);
+	}
+	state["ratings"] = ratings;
+
+	if (!m_sprt->isNull())
+	{
+		QVariantMap sprt;
+		sprt["wins"] = m_sprt->resultCount(Sprt::Win);
+		sprt["draws"] = m_sprt->resultCount(Sprt::Draw);
+		sprt["losses"] = m_sprt->resultCount(Sprt::Loss);
+
+		QVariantList pairs;
+		for (int i = 0; i < 5; i++)
+			pairs << m_sprt->pairResultCount(i);
+		sprt["pairs"] = pairs;
+
+		QVariantMap pendingPairs;
+		QMap<int, int>::const_iterator it;
+		for (it = m_sprtPairResults.constBegin();
+		     it != m_sprtPairResults.constEnd(); ++it)
+			pendingPairs[QString::number(it.key())] = it.value();
+		sprt["pendingPairs"] = pendingPairs;
+
+		state["sprt"] = sprt;
+	}
+
+	if (!m_startFen.isEmpty() || !m_openingMoves.isEmpty())
+	{
+		state["repeatFen"] = m_startFen;
+		state["repeatMoves"] = moveStrings(m_startFen, m_openingMoves);
+		state["repeatOpening"] = m_repeatOpeningIndex;
+	}
+
+	QList<GameData> activeGames(m_resumeGames);
+	foreach (const GameData* data, m_gameData)
+		activeGames << *data;
+	QVariantList games;
+	foreach (const GameData& data, activeGames)
+	{
+		QVariantMap map;
+		map["number"] = data.number;
+		map["white"] = data.whiteIndex;
+		map["black"] = data.blackIndex;
+		map["round"] = data.round;
+		map["opening"] = data.openingIndex;
+		map["fen"] = data.startFen;
+		map["moves"] = moveStrings(data.startFen, data.openingMoves);
+		games << map;
+	}
+	qSort(games.begin(), games.end(), gameNumberLessThan);
+	state["activeGames"] = games;
+
+	QVariantList pendingGames;
+	QMap<int, PgnGame>::const_iterator it;
+	for (it = m_pgnGames.constBegin(); it != m_pgnGames.constEnd(); ++it)
+	{
+		QString pgn;
+		QTextStream out(&pgn);
+		it.value().write(out, PgnGame::Verbose);
+		out.flush();
+
+		QVariantMap map;
+		map["number"] = it.key();
+		map["pgn"] = pgn;
+		pendingGames << map;
+	}
+	state["pendingGames"] = pendingGames;
+
+	if (m_openingSuite != 0)
+		state["openingSuite"] = m_openingSuite->saveState();
+	state["random"] = QString::fromLatin1(Mersenne::state().toHex());
+	state["seed"] = m_randomSeed;
+
+	return writeCheckpointFile(m_checkpointFile, state);
+}
+
+bool Tournament::loadCheckpoint(const QString& fileName)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		m_error = QString("Can't open checkpoint file %1").arg(fileName);
+		return false;
+	}
+
+	QTextStream in(&file);
+	JsonParser parser(in);
+	const QVariantMap state(parser.parse().toMap());
+	if (parser.hasError())
+	{
+		m_error = QString("Invalid checkpoint file %1: %2")
+			  .arg(fileName).arg(parser.errorString());
+		return false;
+	}
+
+	m_error = QString("Checkpoint file %1 doesn't match the tournament")
+		  .arg(fileName);
+	const int finalGameCount = gamesPerCycle() * gamesPerEncounter() * roundMultiplier();
+	if (state.value("version").toInt() != s_checkpointVersion
+	||  state.value("type").toString() != type()
+	||  state.value("playerCount").toInt() != m_players.size()
+	||  state.value("finalGameCount").toInt() != finalGameCount
+	||  state.value("gamesPerEncounter").toInt() != m_gamesPerEncounter
+	||  state.value("players").toList().size() != m_players.size()
+	||  state.value("nextGameNumber").toInt() > finalGameCount)
+		return false;
+
+	QList<GameData> resumeGames;
+	foreach (const QVariant& var, state.value("activeGames").toList())
+	{
+		const QVariantMap map(var.toMap());
+		GameData data;
+		data.number = map.value("number").toInt();
+		data.whiteIndex = map.value("white").toInt();
+		data.blackIndex = map.value("black").toInt();
+		data.round = map.value("round").toInt();
+		data.openingIndex = map.value("opening", -1).toInt();
+		data.startFen = map.value("fen").toString();
+
+		if (data.whiteIndex < 0 || data.whiteIndex >= m_players.size()
+		||  data.blackIndex < 0 || data.blackIndex >= m_players.size()
+		||  !parseMoves(data.startFen, map.value("moves").toStringList(),
+				&data.openingMoves))
+			return false;
+		resumeGames << data;
+	}
+
+	QMap<int, PgnGame> pgnGames;
+	foreach (const QVariant& var, state.value("pendingGames").toList())
+	{
+		const QVariantMap map(var.toMap());
+		const QByteArray pgn(map.value("pgn").toString().toUtf8());
+		PgnStream stream(&pgn, m_variant);
+		PgnGame game;
+		if (!game.read(stream))
+			return false;
+		pgnGames[map.value("number").toInt()] = game;
+	}
+
+	QString startFen(state.value("repeatFen").toString());
+	QVector<Chess::Move> openingMoves;
+	if (!parseMoves(startFen, state.value("repeatMoves").toStringList(),
+			&openingMoves))
+		return false;
+
+	if (state.contains("openingSuite"))
+	{
+		if (m_openingSuite == 0
+		||  !m_openingSuite->restoreState(state.value("openingSuite").toMap()))
+		{
+			m_error = QString("Can't restore the opening suite "
+					  "position from checkpoint file %1").arg(fileName);
+			return false;
+		}
+	}
+
+	m_error.clear();
+	m_checkpoint = state;
+	m_resumeGames = resumeGames;
+	m_resumePgnGames = pgnGames;
+	m_resumeStartFen = startFen;
+	m_resumeOpeningMoves = openingMoves;
+
+	return true;
+}
+
+bool Tournament::restoreCheckpoint()
+{
+	const QVariantMap state(m_checkpoint);
+	m_checkpoint.clear();
+
+	m_nextGameNumber = state.value("nextGameNumber").toInt();
+	if (state.contains("pairing"))
+	{
+		if (!setPairingState(state.value("pairing").toMap()))
+		{
+			m_error = "Can't restore the pairings from the checkpoint";
+			return false;
+		}
+
+		m_round = qMax(1, state.value("round").toInt());
+	}
+	else
+	{
+		// Replay the pairings to bring the subclass's pairing
+		// state and the current round to where they were
+		m_pairsFetched = state.value("pairsFetched").toInt();
+		for (int i = 0; i < m_pairsFetched; i++)
+			nextPair();
+
+		foreach (const QVariant& var, state.value("upcoming").toList())
+		{
+			const QVariantList list(var.toList());
+			if (list.size() != 3)
+				continue;
+			Encounter encounter = { list.at(0).toInt(),
+						list.at(1).toInt(),
+						list.at(2).toInt() };
+			if (encounter.whiteIndex < 0
+			||  encounter.whiteIndex >= m_players.size()
+			||  encounter.blackIndex < 0
+			||  encounter.blackIndex >= m_players.size())
+				continue;
+			m_upcoming.append(encounter);
+		}
+	}
+
+	const QVariantList pair(state.value("pair").toList());
+	if (pair.size() == 2)
+		m_pair = qMakePair(pair.at(0).toInt(), pair.at(1).toInt());
+	m_encounterRound = qMax(1, state.value("encounterRound").toInt());
+
+	m_finishedGameCount = state.value("finishedGameCount").toInt();
+	m_skippedGameCount = state.value("skippedGameCount").toInt();
+	m_savedGameCount = state.value("savedGameCount").toInt();
+	m_lastSavedGame = state.value("lastSavedGame", m_savedGameCount).toInt();
+	foreach (const QVariant& var, state.value("savedAhead").toList())
+		m_savedAhead.insert(var.toInt());
+
+	const QVariantList players(state.value("players").toList());
+	for (int i = 0; i < m_players.size(); i++)
+	{
+		const QVariantMap map(players.at(i).toMap());
+		m_players[i].wins = map.value("wins").toInt();
+		m_players[i].draws = map.value("draws").toInt();
+		m_players[i].losses = map.value("losses").toInt();
+	}
+
+	foreach (const QVariant& var, state.value("ratings").toList())
+	{
+		const QVariantList list(var.toList());
+		if (list.size() != 4)
+			continue;
+		const int first = list.at(0).toInt();
+		const int second = list.at(1).toInt();
+		const int games = list.at(2).toInt();
+		const int halfPoints = list.at(3).toInt();
+		if (first < 0 || first >= m_players.size()
+		||  second < 0 || second >= m_players.size() || first == second
+		||  games <= 0 || halfPoints < 0 || halfPoints > games * 2)
+			continue;
+		m_ratings->addResults(first, second, games, halfPoints);
+	}
+
+	if (state.contains("sprt"))
+	{
+		const QVariantMap sprt(state.value("sprt").toMap());
+		m_sprt->setResultCounts(sprt.value("wins").toInt(),
+					sprt.value("losses").toInt(),
+					sprt.value("draws").toInt());
+
+		const QVariantList pairs(sprt.value("pairs").toList());
+		for (int i = 0; i < pairs.size() && i < 5; i++)
+			m_sprt->setPairResultCount(i, pairs.at(i).toInt());
+
+		const QVariantMap pendingPairs(sprt.value("pendingPairs").toMap());
+		QVariantMap::const_iterator it;
+		for (it = pendingPairs.constBegin(); it != pendingPairs.constEnd(); ++it)
+			m_sprtPairResults[it.key().toInt()] = it.value().toInt();
+	}
+
+	m_startFen = m_resumeStartFen;
+	m_openingMoves = m_resumeOpeningMoves;
+	m_repeatOpeningIndex = state.value("repeatOpening", -1).toInt();
+	m_pgnGames = m_resumePgnGames;
+	m_resumeStartFen.clear();
+	m_resumeOpeningMoves.clear();
+	m_resumePgnGames.clear();
+
+	// Restoring the PRNG comes last because replaying the
+	// pairings may have consumed random numbers
+	const QByteArray random(QByteArray::fromHex(state.value("random").toString().toLatin1()));
+	if (!Mersenne::setState(random))
+		qWarning("Can't restore the random number generator's state");
+	if (state.contains("seed"))
+		m_randomSeed = state.value("seed").toUInt();
+
+	return true;
+}
+
 void Tournament::onGameStartFailed(ChessGame* game)
 {
 	m_error = game->errorString();
 
 	delete game->pgn();
 	game->deleteLater();
-	m_gameData.remove(game);
+	releaseGameData(m_gameData.take(game));
 
 	stop();
 }
@@ -419,13 +1515,29 @@ void Tournament::start()
 
 	m_round = 1;
 	m_nextGameNumber = 0;
+	// The games' own generators are seeded from this number and
+	// the game number, so game N gets the same random starting
+	// position and book moves whatever happened to the others
+	m_randomSeed = Mersenne::random();
 	m_finishedGameCount = 0;
 	m_savedGameCount = 0;
 	m_finalGameCount = 0;
 	m_stopping = false;
+	m_adjudicatedGames.clear();
+	m_decidedPlies = 0;
+	m_decidedGames = 0;
 
 	m_gameData.clear();
 	m_pgnGames.clear();
+	m_savedAhead.clear();
+	m_lastSavedGame = 0;
+	m_sprtPairResults.clear();
+	m_ratings->setPlayerCount(m_players.size());
+	m_pairingPending = 0;
+	m_pairsFetched = 0;
+	m_encounterRound = 1;
+	m_upcoming.clear();
+	m_skippedGameCount = 0;
 	m_startFen.clear();
 	m_openingMoves.clear();
 
@@ -435,6 +1547,30 @@ void Tournament::start()
 	initializePairing();
 	m_finalGameCount = gamesPerCycle() * gamesPerEncounter() * roundMultiplier();
 
+	if (m_shardCount > 1 && !hasFixedPairings())
+	{
+		m_error = "Only tournaments with fixed pairings can be sharded";
+		QMetaObject::invokeMethod(this, "stop", Qt::QueuedConnection);
+		return;
+	}
+
+	if (!m_checkpoint.isEmpty())
+	{
+		if (!restoreCheckpoint())
+		{
+			QMetaObject::invokeMethod(this, "stop", Qt::QueuedConnection);
+			return;
+		}
+		if ((m_resumeGames.isEmpty() && m_nextGameNumber >= m_finalGameCount)
+		||  (!m_sprt->isNull() && m_sprt->status().result != Sprt::Continue))
+		{
+			QMetaObject::invokeMethod(this, "stop", Qt::QueuedConnection);
+			return;
+		}
+	}
+	m_checkpointTimer.start();
+
+	skipOtherShards();
 	startNextGame();
 }
 
@@ -449,12 +1585,16 @@ void Tournament::stop()
 	if (m_gameData.isEmpty())
 	{
 		m_gameManager->cleanupIdleThreads();
+		closePgnOutput();
 		m_finished = true;
 		emit finished();
 		return;
 	}
 
+	// The games stop in their own threads, so aborting kills the
+	// engines of all the games at once
 	m_stopping = true;
+	const char* method = m_abortOnStop ? "kill" : "stop";
 	foreach (ChessGame* game, m_gameData.keys())
-		QMetaObject::invokeMethod(game, "stop", Qt::QueuedConnection);
+		QMetaObject::invokeMethod(game, method, Qt::QueuedConnection);
 }
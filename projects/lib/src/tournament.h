@@ -24,16 +24,30 @@
 #include <QList>
 #include <QVector>
 #include <QMap>
+#include <QSet>
+#include <QMutex>
+#include <QStringList>
+#include <QVariant>
+#include <QElapsedTimer>
 #include "board/move.h"
+#include "board/result.h"
 #include "timecontrol.h"
 #include "pgngame.h"
 #include "gameadjudicator.h"
+#include "latencystats.h"
+#include "resourcestats.h"
+#include "timeusagestats.h"
+#include "searchstats.h"
 class GameManager;
+class ChessPlayer;
 class PlayerBuilder;
 class ChessGame;
 class OpeningBook;
 class OpeningSuite;
 class Sprt;
+class RatingSolver;
+class OpeningStats;
+class PgnWriter;
 
 /*!
  * \brief Base class for chess tournaments
@@ -54,12 +68,31 @@ class LIB_EXPORT Tournament : public QObject
 			const OpeningBook* book;
 			//! The maximum book depth in plies
 			int bookDepth;
+			//! The player's hash table size in megabytes, or 0
+			int hashSize;
 			//! The number of games won by the player
 			int wins;
 			//! The number of games drawn by the player
 			int draws;
 			//! The number of games lost by the player
 			int losses;
+			//! The number of games the player started with a book
+			int bookGames;
+			//! The number of book moves played by the player
+			int bookMoves;
+			//! The number of games where the player's book ran
+			//! out of moves before the maximum book depth
+			int bookExits;
+			//! Ping round-trip times of the player's engines
+			LatencyStats pingStats;
+			//! Response delays of the player's engines
+			LatencyStats responseStats;
+			//! Thinking time usage of the player's engines
+			TimeUsageStats timeUsage;
+			//! Search statistics of the player's engines
+			SearchStats searchStats;
+			//! Resource usage of the player's engine processes
+			ResourceStats resourceStats;
 		};
 
 		/*!
@@ -117,6 +150,26 @@ class LIB_EXPORT Tournament : public QObject
 		int finishedGameCount() const;
 		/*! Returns the total number of games that will be played. */
 		int finalGameCount() const;
+		/*! Returns the number of finished games that were adjudicated. */
+		int adjudicatedGameCount() const;
+		/*!
+		 * Returns the number of the opening of game \a gameNumber,
+		 * starting at 1.
+		 *
+		 * When the openings are repeated both games of an opening
+		 * pair have the same number.
+		 */
+		int openingNumber(int gameNumber) const;
+		/*!
+		 * Returns an estimate of the engine time in milliseconds
+		 * that adjudication saved.
+		 *
+		 * Each adjudicated game is assumed to have continued to the
+		 * average length of the games that ended on the board, at
+		 * the same time per move. Returns 0 if no game ended on
+		 * the board.
+		 */
+		qint64 adjudicationSavings() const;
 		/*! Returns player data for the player at \a index. */
 		PlayerData playerAt(int index) const;
 		/*! Returns the number of participants in the tournament. */
@@ -128,6 +181,23 @@ class LIB_EXPORT Tournament : public QObject
 		 * stopping criterion.
 		 */
 		Sprt* sprt() const;
+		/*!
+		 * Returns the rating solver of this tournament.
+		 *
+		 * The solver is updated with the result of every finished
+		 * game; call RatingSolver::solve() before reading the
+		 * ratings.
+		 */
+		RatingSolver* ratings() const;
+		/*! Returns the opening suite, or 0 if there isn't one. */
+		OpeningSuite* openingSuite() const;
+		/*!
+		 * Returns the results of the openings of the suite.
+		 *
+		 * The result of every finished game that started from an
+		 * opening of the suite is added to the opening's entry.
+		 */
+		OpeningStats* openingStats() const;
 
 		/*! Sets the tournament's name to \a name. */
 		void setName(const QString& name);
@@ -157,6 +227,29 @@ class LIB_EXPORT Tournament : public QObject
 		 * whole tournament stops when a player crashes.
 		 */
 		void setRecoveryMode(bool recover);
+		/*!
+		 * Sets the abort mode to \a enabled.
+		 *
+		 * If \a enabled is true then stop(), eg. after an SPRT
+		 * decision, kills the engines of the running games instead
+		 * of waiting for them to finish their current move. The
+		 * interrupted games are unscored and they aren't saved.
+		 * The default value is false.
+		 */
+		void setAbortOnStop(bool enabled);
+		/*!
+		 * Sets the paired start mode to \a enabled.
+		 *
+		 * If \a enabled is true and the openings are repeated, the
+		 * two games of an opening pair are started at the same
+		 * time, so that changes in the host load affect both games
+		 * equally. The first game of a pair waits until two game
+		 * slots are free. This has no effect if the game manager's
+		 * concurrency is less than 2. The default value is false.
+		 *
+		 * \sa setOpeningRepetition()
+		 */
+		void setPairedStart(bool enabled);
 		void setAdjudicator(const GameAdjudicator& adjudicator);
 		/*!
 		 * Uses \a suite as the opening suite (a collection of openings)
@@ -170,15 +263,46 @@ class LIB_EXPORT Tournament : public QObject
 		 * to \a plies (halfmoves).
 		 */
 		void setOpeningDepth(int plies);
+		/*!
+		 * Sets the opening collapse mode to \a enabled.
+		 *
+		 * If \a enabled is true, the engines get the final position
+		 * of each forced opening instead of its moves.
+		 * \sa ChessGame::setOpeningCollapsed()
+		 */
+		void setOpeningCollapsed(bool enabled);
 		/*!
 		 * Sets the PGN output file for the games to \a fileName.
 		 *
-		 * The games are saved to the file in mode \a mode.
-		 * If no PGN output file is set (default) then the games
-		 * won't be saved.
+		 * The games are saved to the file in mode \a mode, in
+		 * the order of their game numbers, by a separate writer
+		 * thread. If no PGN output file is set (default) then the
+		 * games won't be saved.
+		 *
+		 * If \a fileName ends with ".gz", the games are gzip
+		 * compressed.
 		 */
 		void setPgnOutput(const QString& fileName,
 				  PgnGame::PgnMode mode = PgnGame::Verbose);
+		/*!
+		 * Starts a new numbered PGN output file after \a maxGames
+		 * games or when the file reaches \a maxSize bytes. A zero
+		 * value disables that limit (default).
+		 *
+		 * \sa PgnWriter::setRotation()
+		 */
+		void setPgnRotation(int maxGames, qint64 maxSize);
+		/*!
+		 * Sets the binary game archive file for the games to
+		 * \a fileName.
+		 *
+		 * The archive holds the same data as a verbose PGN file
+		 * in a much smaller space. If no archive file is set
+		 * (default) then no archive is written.
+		 *
+		 * \sa GameArchive
+		 */
+		void setArchiveOutput(const QString& fileName);
 
 		/*!
 		 * Sets PgnGame cleanup mode to \a enabled.
@@ -187,6 +311,16 @@ class LIB_EXPORT Tournament : public QObject
 		 * objects are destroyed automatically once the games are finished.
 		 */
 		void setPgnCleanupEnabled(bool enabled);
+		/*!
+		 * Sets the ownership of the player builders to \a owned.
+		 *
+		 * If \a owned is true (the default) the builders given to
+		 * addPlayer() are deleted with the tournament. Otherwise
+		 * their owner must keep them alive until the game manager
+		 * is done with them, eg. to let a later tournament reuse
+		 * the idle engines in the player pool.
+		 */
+		void setPlayerBuildersOwned(bool owned);
 
 		/*!
 		 * Sets the opening repetition mode to \a repeat.
@@ -195,6 +329,56 @@ class LIB_EXPORT Tournament : public QObject
 		 * rounds; otherwise each game gets its own opening.
 		 */
 		void setOpeningRepetition(bool repeat);
+		/*!
+		 * Saves the tournament's state to checkpoint file \a fileName
+		 * every \a interval msec, and once more when the tournament
+		 * is finished.
+		 *
+		 * The checkpoints are written between games, after the
+		 * finished games are flushed to the PGN and archive files.
+		 * An empty \a fileName disables checkpoints (default).
+		 *
+		 * \sa loadCheckpoint()
+		 */
+		void setCheckpoint(const QString& fileName, int interval);
+		/*!
+		 * Loads the state of an interrupted tournament from checkpoint
+		 * file \a fileName.
+		 *
+		 * The tournament continues from the checkpoint when it's
+		 * started. The games that were running when the checkpoint
+		 * was saved are played again from their beginning. This
+		 * function must be called after the players, the opening
+		 * suite and the other settings are set, and before start().
+		 *
+		 * Returns true if successful; otherwise returns false and
+		 * sets errorString().
+		 */
+		bool loadCheckpoint(const QString& fileName);
+		/*!
+		 * Plays only shard \a index (starting from 0) of \a count
+		 * shards of the tournament.
+		 *
+		 * The games are divided into blocks of whole encounters,
+		 * and the shards take turns playing them. The pairings,
+		 * openings and game numbers are the same as in the
+		 * complete tournament, so when every shard uses the same
+		 * settings and random seed, the games of the shards can be
+		 * merged without renumbering. Only tournaments with fixed
+		 * pairings can be sharded.
+		 *
+		 * \sa summary()
+		 */
+		void setShard(int index, int count);
+		/*!
+		 * Returns a summary of the results that can be added up
+		 * over the shards of a tournament.
+		 *
+		 * The summary contains the shard, the players' names and
+		 * scores, the combined results of each pair of players
+		 * and the pentanomial SPRT counts.
+		 */
+		QVariantMap summary() const;
 		/*!
 		 * Adds player \a builder to the tournament.
 		 *
@@ -202,12 +386,19 @@ class LIB_EXPORT Tournament : public QObject
 		 * may differ from the other players' time controls.
 		 *
 		 * The Tournament object takes ownership of \a builder and will
-		 * take care of deleting it.
+		 * take care of deleting it, unless setPlayerBuildersOwned()
+		 * says otherwise.
 		 */
 		void addPlayer(PlayerBuilder* builder,
 			       const TimeControl& timeControl,
 			       const OpeningBook* book = 0,
 			       int bookDepth = 256);
+		/*!
+		 * Sets the hash table size of player \a index to \a size
+		 * megabytes. The size is saved in the "WhiteHash" or
+		 * "BlackHash" tag of the player's games.
+		 */
+		void setPlayerHashSize(int index, int size);
 
 	public slots:
 		/*! Starts the tournament. */
@@ -290,13 +481,71 @@ class LIB_EXPORT Tournament : public QObject
 		 * setCurrentRound() to increase the round when needed.
 		 * Subclasses should also alternate the colors when needed,
 		 * to make the tournament as fair as possible.
+		 *
+		 * A subclass whose pairings depend on the results of the
+		 * running games can return (-1, -1) if no pair can be made
+		 * yet. The tournament then asks again after the next game
+		 * finishes. While no games are running there must always
+		 * be a pair.
 		 */
 		virtual QPair<int, int> nextPair() = 0;
+		/*!
+		 * Tells the subclass that a game between players
+		 * \a whiteIndex and \a blackIndex ended with \a result.
+		 *
+		 * This is called for every game started by the tournament,
+		 * also the ones that end without a result. The default
+		 * implementation does nothing.
+		 */
+		virtual void addGameResult(int whiteIndex,
+					   int blackIndex,
+					   const Chess::Result& result);
+		/*!
+		 * Returns the state of the pairings for a checkpoint.
+		 *
+		 * The default implementation returns an empty map, which
+		 * means that the state is restored by calling nextPair()
+		 * again for every encounter that was started. Subclasses
+		 * whose pairings depend on the game results must save
+		 * their state here and restore it in setPairingState().
+		 */
+		virtual QVariantMap pairingState() const;
+		/*!
+		 * Restores the pairings from \a state, which was returned
+		 * by pairingState(). Called after initializePairing().
+		 *
+		 * Returns true if successful. The default implementation
+		 * returns false.
+		 */
+		virtual bool setPairingState(const QVariantMap& state);
+		/*!
+		 * Returns true if the pairings don't depend on the results
+		 * or on the running games (the default).
+		 *
+		 * Fixed pairings are fetched from nextPair() ahead of time,
+		 * and an encounter from a later round is played first if
+		 * the players of the earlier ones are still busy.
+		 */
+		virtual bool hasFixedPairings() const;
+
+		/*!
+		 * Returns \a values as a variant list, eg. for saving
+		 * them in pairingState().
+		 */
+		static QVariantList toVariantList(const QVector<int>& values);
+		/*!
+		 * Reads \a values from the variant list \a var, which must
+		 * have as many items as \a values.
+		 *
+		 * Returns true if successful.
+		 */
+		static bool fromVariantList(const QVariant& var, QVector<int>& values);
 
 	private slots:
 		void startNextGame();
 		void onGameStarted(ChessGame* game);
 		void onGameFinished(ChessGame* game);
+		void processFinishedGames();
 		void onGameDestroyed(ChessGame* game);
 		void onGameStartFailed(ChessGame* game);
 
@@ -306,7 +555,51 @@ class LIB_EXPORT Tournament : public QObject
 			int number;
 			int whiteIndex;
 			int blackIndex;
+			int round;
+			int openingIndex;
+			QString startFen;
+			QVector<Chess::Move> openingMoves;
 		};
+		struct Encounter
+		{
+			int whiteIndex;
+			int blackIndex;
+			int round;
+		};
+		struct EngineLatency
+		{
+			int playerIndex;
+			LatencyStats pingStats;
+			LatencyStats responseStats;
+			TimeUsageStats timeUsage;
+			SearchStats searchStats;
+			ResourceStats resourceStats;
+		};
+
+		QPair<int, int> takeEncounter();
+		ChessGame* createGame(int whiteIndex, int blackIndex);
+		ChessGame* createNextGame();
+		int shardOf(int gameIndex) const;
+		void skipOtherShards();
+		void startGame(ChessGame* game,
+			       int number,
+			       int whiteIndex,
+			       int blackIndex,
+			       int round,
+			       int openingIndex);
+		void processFinishedGame(ChessGame* game);
+		void savePgnGame(int number, PgnGame game);
+		GameData* newGameData();
+		void releaseGameData(GameData* data);
+		bool saveCheckpoint();
+		bool restoreCheckpoint();
+		QStringList moveStrings(const QString& fen,
+					const QVector<Chess::Move>& moves) const;
+		bool parseMoves(const QString& fen,
+				const QStringList& strings,
+				QVector<Chess::Move>* moves) const;
+		void updateLatency(ChessPlayer* player, int playerIndex);
+		void closePgnOutput();
 
 		GameManager* m_gameManager;
 		ChessGame* m_lastGame;
@@ -316,8 +609,11 @@ class LIB_EXPORT Tournament : public QObject
 		QString m_variant;
 		int m_round;
 		int m_nextGameNumber;
+		quint32 m_randomSeed;
 		int m_finishedGameCount;
+		int m_skippedGameCount;
 		int m_savedGameCount;
+		int m_lastSavedGame;
 		int m_finalGameCount;
 		int m_gamesPerEncounter;
 		int m_roundMultiplier;
@@ -325,20 +621,57 @@ class LIB_EXPORT Tournament : public QObject
 		int m_openingDepth;
 		bool m_stopping;
 		bool m_repeatOpening;
+		bool m_collapseOpening;
 		bool m_recover;
+		bool m_abortOnStop;
+		bool m_pairedStart;
 		bool m_pgnCleanup;
+		bool m_ownsBuilders;
 		bool m_finished;
 		GameAdjudicator m_adjudicator;
 		OpeningSuite* m_openingSuite;
 		Sprt* m_sprt;
+		RatingSolver* m_ratings;
+		OpeningStats* m_openingStats;
+		int m_openingIndex;
+		int m_repeatOpeningIndex;
+		PgnWriter* m_pgnWriter;
+		PgnWriter* m_archiveWriter;
 		QString m_pgnout;
+		QString m_archiveout;
 		QString m_startFen;
 		PgnGame::PgnMode m_pgnOutMode;
+		int m_pgnRotateGames;
+		qint64 m_pgnRotateSize;
 		QPair<int, int> m_pair;
 		QList<PlayerData> m_players;
 		QMap<int, PgnGame> m_pgnGames;
+		QSet<int> m_savedAhead;
 		QMap<ChessGame*, GameData*> m_gameData;
+		QList<GameData*> m_gameDataPool;
+		QMap<int, int> m_sprtPairResults;
+		QMap<int, EngineLatency> m_engineLatency;
+		QVector< QPair<int, qint64> > m_adjudicatedGames;
+		qint64 m_decidedPlies;
+		int m_decidedGames;
+		QMutex m_finishedMutex;
+		QList<ChessGame*> m_finishedGames;
+		bool m_finishedPending;
+		int m_pairingPending;
+		int m_pairsFetched;
+		int m_encounterRound;
+		int m_shardIndex;
+		int m_shardCount;
+		QList<Encounter> m_upcoming;
 		QVector<Chess::Move> m_openingMoves;
+		QString m_checkpointFile;
+		int m_checkpointInterval;
+		QElapsedTimer m_checkpointTimer;
+		QVariantMap m_checkpoint;
+		QList<GameData> m_resumeGames;
+		QMap<int, PgnGame> m_resumePgnGames;
+		QString m_resumeStartFen;
+		QVector<Chess::Move> m_resumeOpeningMoves;
 };
 
 #endif // TOURNAMENT_H
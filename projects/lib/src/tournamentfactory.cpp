@@ -18,6 +18,8 @@
 #include "tournamentfactory.h"
 #include "roundrobintournament.h"
 #include "gauntlettournament.h"
+#include "bergertournament.h"
+#include "swisstournament.h"
 
 Tournament* TournamentFactory::create(const QString& type,
 				      GameManager* manager,
@@ -27,6 +29,10 @@ Tournament* TournamentFactory::create(const QString& type,
 		return new RoundRobinTournament(manager, parent);
 	if (type == "gauntlet")
 		return new GauntletTournament(manager, parent);
+	if (type == "berger")
+		return new BergerTournament(manager, parent);
+	if (type == "swiss")
+		return new SwissTournament(manager, parent);
 
 	return 0;
 }
@@ -0,0 +1,149 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tracelog.h"
+#include <QMutex>
+#include <QVector>
+#include <QHash>
+#include <QThread>
+#include <QFile>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <jsonserializer.h>
+
+struct TraceEvent
+{
+	char phase;
+	const char* category;
+	QString name;
+	qint64 timestamp;
+	qint64 duration;
+	quintptr thread;
+	QVariantMap args;
+};
+
+bool TraceLog::s_enabled = false;
+
+static QMutex s_mutex;
+static QElapsedTimer s_clock;
+static QString s_fileName;
+static QVector<TraceEvent> s_events;
+
+void TraceLog::start(const QString& fileName)
+{
+	QMutexLocker locker(&s_mutex);
+
+	s_fileName = fileName;
+	s_events.clear();
+	s_clock.start();
+	s_enabled = true;
+}
+
+void TraceLog::addEvent(char phase,
+			const char* category,
+			const QString& name,
+			qint64 duration,
+			const QVariantMap& args)
+{
+	TraceEvent event;
+	event.phase = phase;
+	event.category = category;
+	event.name = name;
+	event.duration = duration;
+	event.thread = quintptr(QThread::currentThreadId());
+	event.args = args;
+
+	QMutexLocker locker(&s_mutex);
+	if (!s_enabled)
+		return;
+
+	event.timestamp = s_clock.nsecsElapsed() / 1000 - duration;
+	s_events.append(event);
+}
+
+void TraceLog::instant(const char* category,
+		       const QString& name,
+		       const QVariantMap& args)
+{
+	addEvent('i', category, name, 0, args);
+}
+
+void TraceLog::complete(const char* category,
+			const QString& name,
+			qint64 duration,
+			const QVariantMap& args)
+{
+	addEvent('X', category, name, qMax(duration, qint64(0)), args);
+}
+
+bool TraceLog::finish()
+{
+	QVector<TraceEvent> events;
+	QString fileName;
+	{
+		QMutexLocker locker(&s_mutex);
+		s_enabled = false;
+		events = s_events;
+		fileName = s_fileName;
+		s_events.clear();
+	}
+
+	// Chrome's viewer wants small integer thread ids
+	QHash<quintptr, int> threadIds;
+	QVariantList list;
+	foreach (const TraceEvent& event, events)
+	{
+		if (!threadIds.contains(event.thread))
+			threadIds.insert(event.thread, threadIds.size() + 1);
+
+		QVariantMap map;
+		map["name"] = event.name;
+		map["cat"] = QString(event.category);
+		map["ph"] = QString(QChar(event.phase));
+		map["ts"] = event.timestamp;
+		map["pid"] = 1;
+		map["tid"] = threadIds.value(event.thread);
+		if (event.phase == 'X')
+			map["dur"] = event.duration;
+		else
+			map["s"] = QString("t");
+		if (!event.args.isEmpty())
+			map["args"] = event.args;
+		list.append(map);
+	}
+
+	QVariantMap trace;
+	trace["traceEvents"] = list;
+	trace["displayTimeUnit"] = QString("ms");
+
+	QFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+	{
+		qWarning("Can't open trace file %s", qPrintable(fileName));
+		return false;
+	}
+
+	QTextStream out(&file);
+	JsonSerializer serializer(trace);
+	if (!serializer.serialize(out))
+	{
+		qWarning("%s", qPrintable(serializer.errorString()));
+		return false;
+	}
+
+	return true;
+}
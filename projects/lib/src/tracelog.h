@@ -0,0 +1,80 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRACELOG_H
+#define TRACELOG_H
+
+#include <QString>
+#include <QVariantMap>
+
+/*!
+ * \brief A process-wide timeline of events in Chrome's trace format.
+ *
+ * When tracing is enabled, the engine commands and responses, the
+ * players' clocks, the moves and adjudications of games, and the
+ * game manager's scheduling events are buffered in memory. finish()
+ * writes them to a JSON file that can be opened in chrome://tracing
+ * or Perfetto.
+ *
+ * The logging functions are thread-safe. The callers should check
+ * isEnabled() before formatting the arguments, so that disabled
+ * tracing costs no more than a branch.
+ */
+class LIB_EXPORT TraceLog
+{
+	public:
+		/*! Returns true if events are being recorded. */
+		static bool isEnabled() { return s_enabled; }
+
+		/*!
+		 * Starts recording events for the trace file \a fileName.
+		 * This should be called before any games are started.
+		 */
+		static void start(const QString& fileName);
+		/*!
+		 * Stops recording and writes the events to the trace file.
+		 * Returns true if successful.
+		 */
+		static bool finish();
+
+		/*!
+		 * Records an instant event \a name of \a category with
+		 * arguments \a args.
+		 */
+		static void instant(const char* category,
+				    const QString& name,
+				    const QVariantMap& args = QVariantMap());
+		/*!
+		 * Records an event \a name of \a category with arguments
+		 * \a args that ends now and lasted \a duration microseconds.
+		 */
+		static void complete(const char* category,
+				     const QString& name,
+				     qint64 duration,
+				     const QVariantMap& args = QVariantMap());
+
+	private:
+		static void addEvent(char phase,
+				     const char* category,
+				     const QString& name,
+				     qint64 duration,
+				     const QVariantMap& args);
+
+		static bool s_enabled;
+};
+
+#endif // TRACELOG_H
@@ -33,7 +33,14 @@
 
 UciEngine::UciEngine(QObject* parent)
 	: ChessEngine(parent),
-	  m_sendOpponentsName(false)
+	  m_startPositionSize(0),
+	  m_lastInfoHasScore(false),
+	  m_sendOpponentsName(false),
+	  m_canPonder(false),
+	  m_ponderSearch(false),
+	  m_ponderHit(false),
+	  m_analysisSearch(false),
+	  m_ignoredMoves(0)
 {
 	addVariant("standard");
 	setName("UciEngine");
@@ -41,23 +48,53 @@ UciEngine::UciEngine(QObject* parent)
 
 void UciEngine::startProtocol()
 {
+	m_ponderSearch = false;
+	m_ponderHit = false;
+	m_ignoredMoves = 0;
+
 	// Tell the engine to turn on UCI mode
 	write("uci");
 }
 
+void UciEngine::addMove(const Chess::Move& move)
+{
+	if (m_position.size() == m_startPositionSize)
+		m_position += " moves";
+	m_position += ' ';
+	board()->appendLanMove(m_position, move);
+}
+
 void UciEngine::sendPosition()
 {
-	QString str("position");
-	
-	if (board()->isRandomVariant() || m_startFen != board()->defaultFenString())
-		str += QString(" fen ") + m_startFen;
-	else
-		str += " startpos";
-	
-	if (!m_moveStrings.isEmpty())
-		str += QString(" moves") + m_moveStrings;
-	
-	write(str);
+	write(m_position);
+}
+
+void UciEngine::startPondering(const QByteArray& ponderMove)
+{
+	Q_ASSERT(!m_ponderSearch);
+
+	QByteArray position(m_position);
+	if (position.size() == m_startPositionSize)
+		position += " moves";
+	position += ' ';
+	position += ponderMove;
+
+	m_ponderMove = ponderMove;
+	m_ponderSearch = true;
+	write(position);
+	write(goCommand(true));
+}
+
+void UciEngine::stopPondering()
+{
+	if (!m_ponderSearch && !m_ponderHit)
+		return;
+
+	// The engine replies to "stop" with a move that must be ignored
+	write("stop");
+	m_ignoredMoves++;
+	m_ponderSearch = false;
+	m_ponderHit = false;
 }
 
 static QString variantFromUci(const QString& str)
@@ -92,15 +129,22 @@ static QString variantToUci(const QString& str)
 	return tmp;
 }
 
-void UciEngine::startGame()
+void UciEngine::sendNewGame()
 {
-	Q_ASSERT(supportsVariant(board()->variant()));
-
-	m_moveStrings.clear();
+	QString startFen;
 	if (board()->isRandomVariant())
-		m_startFen = board()->fenString(Chess::Board::ShredderFen);
+		startFen = board()->fenString(Chess::Board::ShredderFen);
 	else
-		m_startFen = board()->fenString(Chess::Board::XFen);
+		startFen = board()->fenString(Chess::Board::XFen);
+
+	// The position command only grows by one move per ply, so it's
+	// kept in a byte buffer and the moves are appended to it.
+	m_position = "position";
+	if (board()->isRandomVariant() || startFen != board()->defaultFenString())
+		m_position += " fen " + startFen.toLatin1();
+	else
+		m_position += " startpos";
+	m_startPositionSize = m_position.size();
 	
 	QString uciVariant(variantToUci(board()->variant()));
 	if (uciVariant != m_variantOption)
@@ -112,7 +156,17 @@ void UciEngine::startGame()
 	if (!m_variantOption.isEmpty())
 		sendOption(m_variantOption, true);
 
+	if (m_canPonder)
+		sendOption("Ponder", pondering());
+
 	write("ucinewgame");
+}
+
+void UciEngine::startGame()
+{
+	Q_ASSERT(supportsVariant(board()->variant()));
+
+	sendNewGame();
 
 	if (m_sendOpponentsName)
 	{
@@ -128,17 +182,45 @@ void UciEngine::startGame()
 
 void UciEngine::endGame(const Chess::Result& result)
 {
+	stopPondering();
 	stopThinking();
 	ChessEngine::endGame(result);
 }
 
 void UciEngine::makeMove(const Chess::Move& move)
 {
-	m_moveStrings += " " + board()->moveString(move, Chess::Board::LongAlgebraic);
+	addMove(move);
+
+	// On a ponder hit the engine keeps searching the same position,
+	// and startThinking() only tells it to stop pondering.
+	if (m_ponderSearch
+	&&  m_position.endsWith(m_ponderMove)
+	&&  m_position.at(m_position.size() - m_ponderMove.size() - 1) == ' ')
+	{
+		m_ponderSearch = false;
+		m_ponderHit = true;
+		return;
+	}
+
+	stopPondering();
 	sendPosition();
 }
 
 void UciEngine::startThinking()
+{
+	if (m_ponderHit)
+	{
+		m_ponderHit = false;
+		write("ponderhit");
+		return;
+	}
+
+	m_lastInfo.clear();
+	m_lastInfoHasScore = false;
+	write(goCommand(false));
+}
+
+QString UciEngine::goCommand(bool ponder) const
 {
 	const TimeControl* whiteTc = 0;
 	const TimeControl* blackTc = 0;
@@ -155,8 +237,10 @@ void UciEngine::startThinking()
 	}
 	else
 		qFatal("Player %s doesn't have a side", qPrintable(name()));
-	
+
 	QString command = "go";
+	if (ponder)
+		command += " ponder";
 	if (myTc->isInfinite())
 	{
 		if (myTc->plyLimit() == 0 && myTc->nodeLimit() == 0)
@@ -180,7 +264,7 @@ void UciEngine::startThinking()
 	if (myTc->nodeLimit() > 0)
 		command += QString(" nodes %1").arg(myTc->nodeLimit());
 
-	write(command);
+	return command;
 }
 
 void UciEngine::sendStop()
@@ -188,6 +272,51 @@ void UciEngine::sendStop()
 	write("stop");
 }
 
+void UciEngine::stopAnalysisSearch()
+{
+	if (!m_analysisSearch)
+		return;
+
+	// The engine replies to "stop" with a move that must be ignored
+	write("stop");
+	m_ignoredMoves++;
+	m_analysisSearch = false;
+}
+
+void UciEngine::sendAnalysisStart()
+{
+	stopAnalysisSearch();
+	sendNewGame();
+}
+
+void UciEngine::sendAnalysisUndo()
+{
+	int pos = m_position.lastIndexOf(' ');
+	Q_ASSERT(pos >= m_startPositionSize);
+
+	m_position.truncate(pos);
+	if (m_position.endsWith(" moves"))
+		m_position.truncate(m_startPositionSize);
+}
+
+void UciEngine::sendAnalysisMove(const Chess::Move& move)
+{
+	addMove(move);
+}
+
+void UciEngine::sendAnalysisGo()
+{
+	stopAnalysisSearch();
+	sendPosition();
+	write("go infinite");
+	m_analysisSearch = true;
+}
+
+void UciEngine::sendAnalysisEnd()
+{
+	stopAnalysisSearch();
+}
+
 QString UciEngine::protocol() const
 {
 	return "uci";
@@ -285,7 +414,13 @@ void UciEngine::parseInfo(const QVarLengthArray<QStringRef>& tokens,
 		m_eval.setNodeCount(tokens[0].toString().toULongLong());
 		break;
 	case InfoPv:
-		m_eval.setPv(joinTokens(tokens).toString());
+		m_eval.setPv(tokens);
+		break;
+	case InfoHashFull:
+		m_eval.setHashUsage(tokens[0].toString().toInt());
+		break;
+	case InfoTbHits:
+		m_eval.setTbHits(tokens[0].toString().toULongLong());
 		break;
 	case InfoScore:
 		{
@@ -446,10 +581,57 @@ void UciEngine::parseLine(const QString& line)
 
 	if (command == "info")
 	{
-		parseInfo(command);
+		// During analysis every line with a principal variation
+		// is reported right away, except the lines of a search
+		// that was already stopped
+		if (state() == Analyzing)
+		{
+			if (m_ignoredMoves == 0
+			&&  line.contains(" pv ")
+			&&  !line.contains(" string "))
+			{
+				parseInfo(command);
+				emit analysisUpdated(m_eval);
+			}
+			return;
+		}
+
+
+		// Only the evaluation of the final move is stored, so the
+		// info lines are just scanned here. The last line with an
+		// exact score (or a depth if no score has been seen) is
+		// parsed when the move arrives.
+		int pos = line.indexOf(" score ");
+		if (pos != -1
+		&&  line.lastIndexOf(" string ", pos) == -1
+		&&  !line.contains("bound"))
+		{
+			m_lastInfo = line;
+			m_lastInfoHasScore = true;
+		}
+		else if (!m_lastInfoHasScore
+		     &&  line.contains(" depth ")
+		     &&  !line.contains(" string "))
+			m_lastInfo = line;
 	}
 	else if (command == "bestmove")
 	{
+		if (m_ignoredMoves > 0)
+		{
+			// The result of an interrupted ponder search
+			m_ignoredMoves--;
+			m_lastInfo.clear();
+			m_lastInfoHasScore = false;
+			return;
+		}
+
+		if (!m_lastInfo.isEmpty())
+		{
+			parseInfo(firstToken(m_lastInfo));
+			m_lastInfo.clear();
+			m_lastInfoHasScore = false;
+		}
+
 		if (state() != Thinking)
 		{
 			if (state() == FinishingGame)
@@ -459,14 +641,28 @@ void UciEngine::parseLine(const QString& line)
 			return;
 		}
 
-		QString moveString(nextToken(command).toString());
-		m_moveStrings += " " + moveString;
-		Chess::Move move = board()->moveFromString(moveString);
+		// UCI moves are in LAN, so the other notations are only
+		// tried if the move isn't legal LAN
+		QStringRef token(nextToken(command));
+		Chess::Move move = board()->parseLanMove(token);
+		if (!board()->isLegalMove(move))
+			move = board()->moveFromString(token.toString());
 
-		if (!move.isNull())
-			emitMove(move);
-		else
-			forfeit(Chess::Result::IllegalMove, moveString);
+		QByteArray ponderMove;
+		if (nextToken(token) == "ponder")
+			ponderMove = nextToken(nextToken(token)).toLatin1();
+
+		if (move.isNull())
+		{
+			forfeit(Chess::Result::IllegalMove, token.toString());
+			return;
+		}
+		addMove(move);
+
+		emitMove(move);
+		if (pondering() && m_canPonder
+		&&  !ponderMove.isEmpty() && state() == Observing)
+			startPondering(ponderMove);
 	}
 	else if (command == "readyok")
 	{
@@ -506,10 +702,11 @@ void UciEngine::parseLine(const QString& line)
 			addVariant(variant);
 		else if (option->name() == "UCI_Opponent")
 			m_sendOpponentsName = true;
-		else if (option->name() == "Ponder"
-		     ||  (option->name().startsWith("UCI_") &&
-			  option->name() != "UCI_LimitStrength" &&
-			  option->name() != "UCI_Elo"))
+		else if (option->name() == "Ponder")
+			m_canPonder = true;
+		else if (option->name().startsWith("UCI_") &&
+			 option->name() != "UCI_LimitStrength" &&
+			 option->name() != "UCI_Elo")
 		{
 			// TODO: Deal with UCI features
 		}
@@ -50,6 +50,11 @@ class LIB_EXPORT UciEngine : public ChessEngine
 		virtual void startThinking();
 		virtual void parseLine(const QString& line);
 		virtual void sendOption(const QString& name, const QVariant& value);
+		virtual void sendAnalysisStart();
+		virtual void sendAnalysisUndo();
+		virtual void sendAnalysisMove(const Chess::Move& move);
+		virtual void sendAnalysisGo();
+		virtual void sendAnalysisEnd();
 		
 	private:
 		static QStringRef parseUciTokens(const QStringRef& first,
@@ -61,12 +66,26 @@ class LIB_EXPORT UciEngine : public ChessEngine
 			       int type);
 		void parseInfo(const QStringRef& line);
 		EngineOption* parseOption(const QStringRef& line);
+		void addMove(const Chess::Move& move);
 		void sendPosition();
+		void sendNewGame();
+		void stopAnalysisSearch();
+		QString goCommand(bool ponder) const;
+		void startPondering(const QByteArray& ponderMove);
+		void stopPondering();
 		
 		QString m_variantOption;
-		QString m_startFen;
-		QString m_moveStrings;
+		QByteArray m_position;
+		int m_startPositionSize;
+		QString m_lastInfo;
+		bool m_lastInfoHasScore;
 		bool m_sendOpponentsName;
+		bool m_canPonder;
+		bool m_ponderSearch;
+		bool m_ponderHit;
+		bool m_analysisSearch;
+		int m_ignoredMoves;
+		QByteArray m_ponderMove;
 };
 
 #endif // UCIENGINE_H
@@ -25,6 +25,7 @@
 #include <climits>
 
 #include "timecontrol.h"
+#include "clocktimer.h"
 #include "enginebuttonoption.h"
 #include "enginecheckoption.h"
 #include "enginecombooption.h"
@@ -49,6 +50,7 @@ XboardEngine::XboardEngine(QObject* parent)
 	: ChessEngine(parent),
 	  m_forceMode(false),
 	  m_drawOnNextMove(false),
+	  m_analyzing(false),
 	  m_ftName(false),
 	  m_ftPing(false),
 	  m_ftSetboard(false),
@@ -58,10 +60,11 @@ XboardEngine::XboardEngine(QObject* parent)
 	  m_ftNps(false),
 	  m_gotResult(false),
 	  m_lastPing(0),
+	  m_lastTimeLeft(-1),
+	  m_lastOppTimeLeft(-1),
 	  m_notation(Chess::Board::LongAlgebraic),
-	  m_initTimer(new QTimer(this))
+	  m_initTimer(new ClockTimer(this))
 {
-	m_initTimer->setSingleShot(true);
 	m_initTimer->setInterval(8000);
 	connect(m_initTimer, SIGNAL(timeout()), this, SLOT(initialize()));
 
@@ -106,12 +109,8 @@ static QString variantToXboard(const QString& str)
 	return str;
 }
 
-void XboardEngine::startGame()
+void XboardEngine::sendNewGame()
 {
-	m_drawOnNextMove = false;
-	m_gotResult = false;
-	m_forceMode = false;
-	m_nextMove = Chess::Move();
 	write("new");
 	
 	if (board()->variant() != "standard")
@@ -125,6 +124,17 @@ void XboardEngine::startGame()
 		else
 			qDebug("%s doesn't support the setboard command", qPrintable(name()));
 	}
+}
+
+void XboardEngine::startGame()
+{
+	m_drawOnNextMove = false;
+	m_gotResult = false;
+	m_forceMode = false;
+	m_nextMove = Chess::Move();
+	m_lastTimeLeft = -1;
+	m_lastOppTimeLeft = -1;
+	sendNewGame();
 	
 	// Send the time controls
 	const TimeControl* myTc = timeControl();
@@ -153,8 +163,8 @@ void XboardEngine::startGame()
 
 	// Show thinking
 	write("post");
-	// Disable pondering
-	write("easy");
+	// Enable or disable pondering
+	write(pondering() ? "hard" : "easy");
 	setForceMode(true);
 	
 	// Tell the opponent's type and name to the engine
@@ -214,7 +224,9 @@ void XboardEngine::sendTimeLeft()
 	
 	if (timeControl()->isInfinite())
 	{
-		write(QString("time %1").arg(s_infiniteSec));
+		if (m_lastTimeLeft != s_infiniteSec)
+			write(QString("time %1").arg(s_infiniteSec));
+		m_lastTimeLeft = s_infiniteSec;
 		return;
 	}
 
@@ -226,6 +238,13 @@ void XboardEngine::sendTimeLeft()
 	if (ocsLeft < 0)
 		ocsLeft = 0;
 
+	// The engine already has these values if the clocks
+	// haven't moved since the last update
+	if (csLeft == m_lastTimeLeft && ocsLeft == m_lastOppTimeLeft)
+		return;
+	m_lastTimeLeft = csLeft;
+	m_lastOppTimeLeft = ocsLeft;
+
 	write(QString("time %1\notim %2").arg(csLeft).arg(ocsLeft));
 }
 
@@ -244,26 +263,31 @@ void XboardEngine::setForceMode(bool enable)
 	m_forceMode = enable;
 }
 
-QString XboardEngine::moveString(const Chess::Move& move)
+QByteArray XboardEngine::moveString(const Chess::Move& move)
 {
 	Q_ASSERT(!move.isNull());
 
+	if (m_notation != Chess::Board::LongAlgebraic)
+		return board()->moveString(move, m_notation).toLatin1();
+
 	// Xboard always uses SAN for castling moves in random variants
-	if (m_notation == Chess::Board::LongAlgebraic && board()->isRandomVariant())
+	if (board()->isRandomVariant())
 	{
 		QString str(board()->moveString(move, Chess::Board::StandardAlgebraic));
 		if (str.startsWith("O-O"))
-			return str;
+			return str.toLatin1();
 	}
 
-	return board()->moveString(move, m_notation);
+	QByteArray str;
+	board()->appendLanMove(str, move);
+	return str;
 }
 
 void XboardEngine::makeMove(const Chess::Move& move)
 {
 	Q_ASSERT(!move.isNull());
 
-	QString moveString;
+	QByteArray moveString;
 	if (move == m_nextMove)
 		moveString = m_nextMoveString;
 	else
@@ -320,6 +344,51 @@ void XboardEngine::sendStop()
 	write("?");
 }
 
+void XboardEngine::sendAnalysisStart()
+{
+	sendAnalysisEnd();
+
+	m_nextMove = Chess::Move();
+	sendNewGame();
+	write("post");
+
+	// The "new" command takes the engine out of force mode
+	m_forceMode = false;
+	setForceMode(true);
+}
+
+void XboardEngine::sendAnalysisUndo()
+{
+	write("undo");
+}
+
+void XboardEngine::sendAnalysisMove(const Chess::Move& move)
+{
+	// The engine restarts the analysis after each move and takeback
+	if (m_ftUsermove)
+		write("usermove " + moveString(move));
+	else
+		write(moveString(move));
+}
+
+void XboardEngine::sendAnalysisGo()
+{
+	if (m_analyzing)
+		return;
+
+	write("analyze");
+	m_analyzing = true;
+}
+
+void XboardEngine::sendAnalysisEnd()
+{
+	if (!m_analyzing)
+		return;
+
+	write("exit");
+	m_analyzing = false;
+}
+
 QString XboardEngine::protocol() const
 {
 	return "xboard";
@@ -600,6 +669,8 @@ void XboardEngine::parseLine(const QString& line)
 			return;
 		m_eval.setPv(ref.toString());
 
+		if (state() == Analyzing)
+			emit analysisUpdated(m_eval);
 		return;
 	}
 
@@ -616,7 +687,10 @@ void XboardEngine::parseLine(const QString& line)
 			return;
 		}
 
-		Chess::Move move = board()->moveFromString(args);
+		// Most engines send LAN, so it's tried first
+		Chess::Move move = board()->parseLanMove(QStringRef(&args));
+		if (!board()->isLegalMove(move))
+			move = board()->moveFromString(args);
 		if (move.isNull())
 		{
 			forfeit(Chess::Result::IllegalMove, args);
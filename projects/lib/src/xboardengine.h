@@ -50,6 +50,11 @@ class LIB_EXPORT XboardEngine : public ChessEngine
 		virtual void parseLine(const QString& line);
 		virtual void sendOption(const QString& name, const QVariant& value);
 		virtual bool restartsBetweenGames() const;
+		virtual void sendAnalysisStart();
+		virtual void sendAnalysisUndo();
+		virtual void sendAnalysisMove(const Chess::Move& move);
+		virtual void sendAnalysisGo();
+		virtual void sendAnalysisEnd();
 
 	protected slots:
 		// Inherited from ChessEngine
@@ -63,12 +68,14 @@ class LIB_EXPORT XboardEngine : public ChessEngine
 		EngineOption* parseOption(const QString& line);
 		void setFeature(const QString& name, const QString& val);
 		void setForceMode(bool enable);
+		void sendNewGame();
 		void sendTimeLeft();
 		void finishGame();
-		QString moveString(const Chess::Move& move);
+		QByteArray moveString(const Chess::Move& move);
 		
 		bool m_forceMode;
 		bool m_drawOnNextMove;
+		bool m_analyzing;
 		
 		// Engine features
 		bool m_ftName;
@@ -81,10 +88,12 @@ class LIB_EXPORT XboardEngine : public ChessEngine
 		
 		bool m_gotResult;
 		int m_lastPing;
+		int m_lastTimeLeft;
+		int m_lastOppTimeLeft;
 		Chess::Move m_nextMove;
-		QString m_nextMoveString;
+		QByteArray m_nextMoveString;
 		Chess::Board::MoveNotation m_notation;
-		QTimer* m_initTimer;
+		ClockTimer* m_initTimer;
 };
 
 #endif // XBOARDENGINE_H
@@ -21,6 +21,12 @@ class tst_Board: public QObject
 		void perft_data() const;
 		void perft();
 
+		void sanParsing_data() const;
+		void sanParsing();
+
+		void repeatCount_data() const;
+		void repeatCount();
+
 		void cleanupTestCase();
 	
 	private:
@@ -232,6 +238,11 @@ void tst_Board::perft_data() const
 		<< Q_UINT64_C(11030083);
 	
 	variant = "capablanca";
+	QTest::newRow("capablanca startpos")
+		<< variant
+		<< "rnabqkbcnr/pppppppppp/10/10/10/10/PPPPPPPPPP/RNABQKBCNR w KQkq - 0 1"
+		<< 4
+		<< Q_UINT64_C(805128);
 	QTest::newRow("gothic startpos")
 		<< variant
 		<< "rnbqckabnr/pppppppppp/10/10/10/10/PPPPPPPPPP/RNBQCKABNR w KQkq - 0 1"
@@ -276,6 +287,50 @@ void tst_Board::perft_data() const
 		<< "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w - KQkq - 0 1"
 		<< 5
 		<< Q_UINT64_C(4888832);
+	QTest::newRow("crazyhouse hand only")
+		<< variant
+		<< "2k5/8/8/8/8/8/8/4K3 w QBqb - - 0 1"
+		<< 3
+		<< Q_UINT64_C(836401);
+	QTest::newRow("crazyhouse pawn drops")
+		<< variant
+		<< "r1bqk2r/pppp1ppp/2n2n2/4p3/1bB1P3/2N2N2/PPPP1PPP/R1BQK2R w Pp KQkq - 0 1"
+		<< 3
+		<< Q_UINT64_C(171047);
+	QTest::newRow("crazyhouse promoted")
+		<< variant
+		<< "4k3/1Q~6/8/8/4b3/8/Kpp5/8 b - - - 0 1"
+		<< 4
+		<< Q_UINT64_C(132758);
+
+	variant = "atomic";
+	QTest::newRow("atomic startpos")
+		<< variant
+		<< "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+		<< 4
+		<< Q_UINT64_C(197326);
+	QTest::newRow("atomic pos2")
+		<< variant
+		<< "rnbqkb1r/ppp1pppp/5n2/3p4/3P4/5N2/PPP1PPPP/RNBQKB1R w KQkq - 0 1"
+		<< 3
+		<< Q_UINT64_C(24740);
+	QTest::newRow("atomic touching kings")
+		<< variant
+		<< "8/8/8/8/3kK3/8/1R6/6r1 w - - 0 1"
+		<< 4
+		<< Q_UINT64_C(158645);
+	QTest::newRow("atomic pos4")
+		<< variant
+		<< "r4b1r/2kb1N2/p2Bpnp1/8/2Pp3p/1P1PPP2/P5PP/R3K2R b KQ - 0 1"
+		<< 3
+		<< Q_UINT64_C(4462);
+
+	variant = "losers";
+	QTest::newRow("losers startpos")
+		<< variant
+		<< "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+		<< 4
+		<< Q_UINT64_C(152955);
 }
 
 void tst_Board::perft()
@@ -290,5 +345,103 @@ void tst_Board::perft()
 	QCOMPARE(smpPerft(m_board, depth), nodecount);
 }
 
+void tst_Board::sanParsing_data() const
+{
+	QTest::addColumn<QString>("variant");
+	QTest::addColumn<QString>("fen");
+
+	QTest::newRow("startpos")
+		<< "standard"
+		<< "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+	QTest::newRow("pos2")
+		<< "standard"
+		<< "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -";
+	QTest::newRow("promotions")
+		<< "standard"
+		<< "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1";
+	QTest::newRow("crazyhouse")
+		<< "crazyhouse"
+		<< "r1bqk2r/pppp1ppp/2n2n2/2b1p3/2B1P3/2N2N2/PPPP1PPP/R1BQK2R w Pp KQkq - 0 1";
+	QTest::newRow("goth2")
+		<< "capablanca"
+		<< "r1b1c2rk1/p4a1ppp/1ppq2pn2/3p1p4/3A1Pn3/1PN3PN2/P1PQP1BPPP/3RC2RK1 w - -";
+}
+
+void tst_Board::sanParsing()
+{
+	QFETCH(QString, variant);
+	QFETCH(QString, fen);
+
+	setVariant(variant);
+	QVERIFY(m_board->setFenString(fen));
+
+	// Every legal move must survive a round trip through SAN,
+	// and through the LAN byte codec used by the engines
+	QVector<Chess::Move> moves(m_board->legalMoves());
+	QStringList sanMoves;
+	foreach (const Chess::Move& move, moves)
+	{
+		QString str(m_board->moveString(move, Chess::Board::StandardAlgebraic));
+		QCOMPARE(m_board->moveFromString(str), move);
+		sanMoves << str;
+
+		QByteArray lan;
+		m_board->appendLanMove(lan, move);
+		QString lanStr(QString::fromLatin1(lan));
+		QCOMPARE(lanStr, m_board->moveString(move, Chess::Board::LongAlgebraic));
+		QCOMPARE(m_board->parseLanMove(QStringRef(&lanStr)), move);
+	}
+
+	QBENCHMARK
+	{
+		foreach (const QString& str, sanMoves)
+			m_board->moveFromString(str);
+	}
+}
+
+void tst_Board::repeatCount_data() const
+{
+	QTest::addColumn<QString>("variant");
+	QTest::addColumn<QString>("fen");
+	QTest::addColumn<QString>("moves");
+	QTest::addColumn<int>("repeatCount");
+
+	QTest::newRow("kings")
+		<< "standard"
+		<< "4k3/8/8/8/8/8/8/4K3 w - - 0 1"
+		<< "Kd1 Kd8 Ke1 Ke8"
+		<< 1;
+	QTest::newRow("pawn move")
+		<< "standard"
+		<< "4k3/8/8/8/8/8/4P3/4K3 w - - 0 1"
+		<< "Kd1 Kd8 Ke1 Ke8 e3"
+		<< 0;
+	// The captured knights go back to the reserves
+	QTest::newRow("crazyhouse captures")
+		<< "crazyhouse"
+		<< "4k3/8/8/8/8/8/8/4K3 w Nn - - 0 1"
+		<< "N@d7 Kxd7 Kd1 N@d2 Kxd2 Ke7 Ke1 Ke8"
+		<< 1;
+}
+
+void tst_Board::repeatCount()
+{
+	QFETCH(QString, variant);
+	QFETCH(QString, fen);
+	QFETCH(QString, moves);
+	QFETCH(int, repeatCount);
+
+	setVariant(variant);
+	QVERIFY(m_board->setFenString(fen));
+
+	foreach (const QString& str, moves.split(' '))
+	{
+		Chess::Move move(m_board->moveFromString(str));
+		QVERIFY(!move.isNull());
+		m_board->makeMove(move);
+	}
+	QCOMPARE(m_board->repeatCount(), repeatCount);
+}
+
 QTEST_MAIN(tst_Board)
 #include "tst_board.moc"
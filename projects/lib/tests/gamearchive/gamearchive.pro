@@ -0,0 +1,4 @@
+include(../tests.pri)
+
+TARGET = tst_gamearchive
+SOURCES += tst_gamearchive.cpp
@@ -0,0 +1,157 @@
+#include <QtTest/QtTest>
+#include <QTemporaryFile>
+#include <gamearchive.h>
+#include <pgngame.h>
+#include <pgnstream.h>
+
+
+class tst_GameArchive: public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void initTestCase();
+
+		void roundTrip();
+		void truncatedRecord();
+
+	private:
+		QString tempFileName();
+
+		QList<PgnGame> m_games;
+		QTemporaryFile m_file;
+};
+
+
+// Book, score, mate, time and free-text comments
+static const char s_standardPgn[] =
+	"[Event \"Test\"]\n"
+	"[Site \"?\"]\n"
+	"[Date \"2026.10.15\"]\n"
+	"[Round \"1\"]\n"
+	"[White \"Alpha\"]\n"
+	"[Black \"Beta\"]\n"
+	"[Result \"1-0\"]\n"
+	"[TimeControl \"40/60\"]\n"
+	"\n"
+	"1. e4 {book} e5 {book} 2. Nf3 {+0.25/12 1.5s} Nc6 {-0.40/9 0.25s} "
+	"3. Bc4 {+0.31/14 12s} Nf6 {a free-text comment} 4. Ng5 {0.0s} "
+	"d5 {+0.00/1 0.003s} 5. exd5 {+M5/20 3.1s} Nxd5 {-M3/18 2.0s} "
+	"6. Nxf7 {white wins} 1-0\n";
+
+// A crazyhouse game with drops
+static const char s_crazyhousePgn[] =
+	"[Event \"Test\"]\n"
+	"[Site \"?\"]\n"
+	"[Date \"2026.10.15\"]\n"
+	"[Round \"2\"]\n"
+	"[White \"Alpha\"]\n"
+	"[Black \"Beta\"]\n"
+	"[Result \"*\"]\n"
+	"[Variant \"crazyhouse\"]\n"
+	"\n"
+	"1. e4 d5 2. exd5 {+0.50/8 0.5s} Qxd5 3. P@e4 {a drop} Qd8 "
+	"4. Nf3 P@e5 *\n";
+
+static QByteArray pgnString(const PgnGame& game)
+{
+	QByteArray data;
+	game.write(data, PgnGame::Verbose);
+	return data;
+}
+
+void tst_GameArchive::initTestCase()
+{
+	QList<QByteArray> pgns;
+	pgns << s_standardPgn << s_crazyhousePgn;
+	foreach (const QByteArray& pgn, pgns)
+	{
+		PgnStream in(&pgn);
+		PgnGame game;
+		QVERIFY(game.read(in));
+		m_games.append(game);
+	}
+	QCOMPARE(m_games.at(0).moves().size(), 11);
+	QCOMPARE(m_games.at(1).moves().size(), 8);
+
+	QVERIFY(m_file.open());
+	m_file.close();
+}
+
+QString tst_GameArchive::tempFileName()
+{
+	QFile::remove(m_file.fileName());
+	return m_file.fileName();
+}
+
+void tst_GameArchive::roundTrip()
+{
+	const QString fileName(tempFileName());
+
+	GameArchive archive;
+	QVERIFY2(archive.open(fileName, GameArchive::Append),
+		 qPrintable(archive.errorString()));
+	foreach (const PgnGame& game, m_games)
+		QVERIFY2(archive.writeGame(game), qPrintable(archive.errorString()));
+	archive.close();
+
+	QVERIFY2(archive.open(fileName, GameArchive::ReadOnly),
+		 qPrintable(archive.errorString()));
+	QCOMPARE(archive.gameCount(), m_games.size());
+	for (int i = 0; i < m_games.size(); i++)
+	{
+		PgnGame game;
+		QVERIFY2(archive.readGame(i, game), qPrintable(archive.errorString()));
+		QCOMPARE(game.moves().size(), m_games.at(i).moves().size());
+		QCOMPARE(pgnString(game), pgnString(m_games.at(i)));
+	}
+	archive.close();
+}
+
+void tst_GameArchive::truncatedRecord()
+{
+	const QString fileName(tempFileName());
+
+	GameArchive archive;
+	QVERIFY(archive.open(fileName, GameArchive::Append));
+	QVERIFY(archive.writeGame(m_games.at(0)));
+	QVERIFY(archive.writeGame(m_games.at(1)));
+	const qint64 end = archive.file()->pos();
+	QVERIFY(archive.writeGame(m_games.at(0)));
+	const qint64 lastEnd = archive.file()->pos();
+	archive.close();
+
+	// Cut the last record in half, as if the program had crashed
+	// while writing it. The index is lost too.
+	{
+		QFile file(fileName);
+		QVERIFY(file.resize((end + lastEnd) / 2));
+	}
+
+	QVERIFY2(archive.open(fileName, GameArchive::ReadOnly),
+		 qPrintable(archive.errorString()));
+	QCOMPARE(archive.gameCount(), 2);
+	for (int i = 0; i < 2; i++)
+	{
+		PgnGame game;
+		QVERIFY2(archive.readGame(i, game), qPrintable(archive.errorString()));
+		QCOMPARE(pgnString(game), pgnString(m_games.at(i)));
+	}
+	archive.close();
+
+	// Appending drops the partial record
+	QVERIFY(archive.open(fileName, GameArchive::Append));
+	QCOMPARE(archive.gameCount(), 2);
+	QVERIFY(archive.writeGame(m_games.at(1)));
+	archive.close();
+
+	QVERIFY(archive.open(fileName, GameArchive::ReadOnly));
+	QCOMPARE(archive.gameCount(), 3);
+	PgnGame game;
+	QVERIFY2(archive.readGame(2, game), qPrintable(archive.errorString()));
+	QCOMPARE(pgnString(game), pgnString(m_games.at(1)));
+	archive.close();
+}
+
+QTEST_MAIN(tst_GameArchive)
+#include "tst_gamearchive.moc"
@@ -0,0 +1,4 @@
+include(../tests.pri)
+
+TARGET = tst_pgngame
+SOURCES += tst_pgngame.cpp
@@ -0,0 +1,265 @@
+#include <QtTest/QtTest>
+#include <QTextStream>
+#include <pgngame.h>
+#include <pgnstream.h>
+#include <streambuffer.h>
+
+
+class tst_PgnGame: public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void initTestCase();
+
+		void write();
+		void streamRead();
+		void variations();
+		void swap();
+		void illegalMove();
+
+		void writeBenchmark_data() const;
+		void writeBenchmark();
+
+	private:
+		PgnGame m_game;
+};
+
+
+static const char s_pgn[] =
+	"[Event \"Test\"]\n"
+	"[Site \"?\"]\n"
+	"[Date \"2026.10.15\"]\n"
+	"[Round \"1\"]\n"
+	"[White \"Alpha\"]\n"
+	"[Black \"Beta\"]\n"
+	"[Result \"1/2-1/2\"]\n"
+	"[FEN \"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1\"]\n"
+	"[SetUp \"1\"]\n"
+	"\n"
+	"1. e4 {+0.00/10 0.0s} e5 {+0.03/11 1.1s} 2. Nf3 {+0.06/12 2.2s} Nc6 "
+	"3. Bb5 {+0.12/14 1.4s} a6 {+0.15/15 2.5s} 4. Ba4 {+0.18/16 0.6s} Nf6 "
+	"5. O-O {+0.24/11 2.8s} Be7 {+0.27/12 0.9s} 6. Re1 {+0.30/13 1.0s} b5 "
+	"7. Bb3 {+0.36/15 0.2s} d6 {+0.39/16 1.3s} 8. c3 {+0.42/10 2.4s} O-O "
+	"9. h3 {+0.48/12 1.6s} Nb8 {+0.51/13 2.7s} 10. d4 {+0.54/14 0.8s} Nbd7 "
+	"11. c4 {+0.60/16 2.0s} c6 {+0.63/10 0.1s} 12. cxb5 {+0.66/11 1.2s} axb5 "
+	"13. Nc3 {+0.72/13 0.4s} Bb7 {+0.75/14 1.5s} 1/2-1/2\n";
+
+// The output of the QTextStream based writer before the byte writer
+static const char s_verbose[] =
+	"[Event \"Test\"]\n"
+	"[Site \"?\"]\n"
+	"[Date \"2026.10.15\"]\n"
+	"[Round \"1\"]\n"
+	"[White \"Alpha\"]\n"
+	"[Black \"Beta\"]\n"
+	"[Result \"1/2-1/2\"]\n"
+	"[FEN \"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1\"]\n"
+	"[PlyCount \"26\"]\n"
+	"[SetUp \"1\"]\n"
+	"\n"
+	"1. e4 {+0.00/10 0.0s} e5 {+0.03/11 1.1s} 2. Nf3 {+0.06/12 2.2s} Nc6\n"
+	"3. Bb5 {+0.12/14 1.4s} a6 {+0.15/15 2.5s} 4. Ba4 {+0.18/16 0.6s} Nf6\n"
+	"5. O-O {+0.24/11 2.8s} Be7 {+0.27/12 0.9s} 6. Re1 {+0.30/13 1.0s} b5\n"
+	"7. Bb3 {+0.36/15 0.2s} d6 {+0.39/16 1.3s} 8. c3 {+0.42/10 2.4s} O-O\n"
+	"9. h3 {+0.48/12 1.6s} Nb8 {+0.51/13 2.7s} 10. d4 {+0.54/14 0.8s} Nbd7\n"
+	"11. c4 {+0.60/16 2.0s} c6 {+0.63/10 0.1s} 12. cxb5 {+0.66/11 1.2s} axb5\n"
+	"13. Nc3 {+0.72/13 0.4s} Bb7 {+0.75/14 1.5s} 1/2-1/2\n"
+	"\n";
+
+static const char s_minimal[] =
+	"[Event \"Test\"]\n"
+	"[Site \"?\"]\n"
+	"[Date \"2026.10.15\"]\n"
+	"[Round \"1\"]\n"
+	"[White \"Alpha\"]\n"
+	"[Black \"Beta\"]\n"
+	"[Result \"1/2-1/2\"]\n"
+	"[FEN \"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1\"]\n"
+	"[SetUp \"1\"]\n"
+	"\n"
+	"1. e4 e5 2. Nf3 Nc6 3. Bb5 a6 4. Ba4 Nf6 5. O-O Be7 6. Re1 b5 7. Bb3 d6 8. c3\n"
+	"O-O 9. h3 Nb8 10. d4 Nbd7 11. c4 c6 12. cxb5 axb5 13. Nc3 Bb7 1/2-1/2\n"
+	"\n";
+
+void tst_PgnGame::initTestCase()
+{
+	QByteArray data(s_pgn);
+	PgnStream in(&data);
+	QVERIFY(m_game.read(in));
+	QCOMPARE(m_game.moves().size(), 26);
+}
+
+void tst_PgnGame::write()
+{
+	QByteArray data;
+	m_game.write(data, PgnGame::Verbose);
+	QCOMPARE(data, QByteArray(s_verbose));
+
+	// Games are appended to the buffer
+	m_game.write(data, PgnGame::Minimal);
+	QCOMPARE(data, QByteArray(s_verbose) + QByteArray(s_minimal));
+
+	QString str;
+	QTextStream out(&str);
+	m_game.write(out, PgnGame::Verbose);
+	out.flush();
+	QCOMPARE(str, QString(s_verbose));
+}
+
+void tst_PgnGame::streamRead()
+{
+	// The second half of the game arrives while the first half
+	// is being parsed
+	const QByteArray data(s_pgn);
+	const int half = data.size() / 2;
+
+	StreamBuffer buffer;
+	buffer.append(data.left(half));
+	QMetaObject::invokeMethod(&buffer, "append", Qt::QueuedConnection,
+				  Q_ARG(QByteArray, data.mid(half)));
+	QMetaObject::invokeMethod(&buffer, "finish", Qt::QueuedConnection);
+
+	PgnStream in(&buffer);
+	PgnGame game;
+	QVERIFY(game.read(in));
+	QCOMPARE(game.moves().size(), m_game.moves().size());
+	QVERIFY(buffer.atEnd());
+	QVERIFY(!game.read(in));
+}
+
+void tst_PgnGame::variations()
+{
+	static const char movetext[] =
+		"1. e4 e5 (1... c5 2. Nf3 (2. c3) 2... d6) (1... e6) "
+		"2. Nf3 {good} Nc6 *";
+	QByteArray data("[Event \"Test\"]\n[Result \"*\"]\n\n"
+			"1. e4 e5 (1... c5 2. Nf3 (2. c3) d6) (1... e6) "
+			"2. Nf3 {good} Nc6 *\n");
+
+	PgnStream in(&data);
+	PgnGame game;
+	QVERIFY(game.read(in));
+	QCOMPARE(game.moves().size(), 4);
+	QCOMPARE(game.moves().at(2).comment, QString("good"));
+	QVERIFY(game.hasVariations());
+	QCOMPARE(game.variation(0), -1);
+
+	// 1... c5 2. Nf3 (2. c3) 2... d6 and 1... e6
+	int c5 = game.variation(1);
+	QVERIFY(c5 != -1);
+	int nf3 = game.variationNode(c5).next;
+	QVERIFY(nf3 != -1);
+	int c3 = game.variationNode(nf3).alternative;
+	QVERIFY(c3 != -1);
+	QCOMPARE(game.variationNode(c3).next, -1);
+	int d6 = game.variationNode(nf3).next;
+	QVERIFY(d6 != -1);
+	QCOMPARE(game.variationNode(d6).next, -1);
+	int e6 = game.variationNode(c5).alternative;
+	QVERIFY(e6 != -1);
+	QCOMPARE(game.variationNode(e6).alternative, -1);
+
+	// The variations are written back, and read the same way
+	QByteArray out;
+	game.write(out, PgnGame::Verbose);
+	QVERIFY(out.contains(movetext));
+
+	PgnStream in2(&out);
+	PgnGame game2;
+	QVERIFY(game2.read(in2));
+	QByteArray out2;
+	game2.write(out2, PgnGame::Verbose);
+	QCOMPARE(out2, out);
+
+	// Minimal games and games without variations don't have them
+	out.clear();
+	game.write(out, PgnGame::Minimal);
+	QVERIFY(!out.contains('('));
+	QVERIFY(!m_game.hasVariations());
+}
+
+void tst_PgnGame::swap()
+{
+	PgnGame game(m_game);
+	PgnGame other;
+	other.swap(game);
+
+	QVERIFY(game.isNull());
+	QCOMPARE(other.moves().size(), m_game.moves().size());
+
+	QByteArray data;
+	other.write(data, PgnGame::Verbose);
+	QCOMPARE(data, QByteArray(s_verbose));
+}
+
+void tst_PgnGame::illegalMove()
+{
+	// A move that can't be replayed and the moves after it are
+	// written in coordinate notation
+	PgnGame game(m_game);
+	PgnGame::MoveData md =
+	{
+		0,
+		Chess::GenericMove(Chess::Square(0, 0), Chess::Square(0, 7), 0),
+		QString()
+	};
+	game.addMove(md);
+	md.move = Chess::GenericMove(Chess::Square(4, 6), Chess::Square(4, 4), 0);
+	game.addMove(md);
+
+	QStringList moves(game.moveStrings());
+	QCOMPARE(moves.size(), 28);
+	QCOMPARE(moves.at(25), QString("Bb7"));
+	QCOMPARE(moves.at(26), QString("a1a8"));
+	QCOMPARE(moves.at(27), QString("e7e5"));
+
+	QByteArray data;
+	game.write(data, PgnGame::Minimal);
+	QVERIFY(data.contains("14. a1a8"));
+	QVERIFY(data.endsWith("e7e5 1/2-1/2\n\n"));
+}
+
+void tst_PgnGame::writeBenchmark_data() const
+{
+	QTest::addColumn<bool>("textStream");
+
+	QTest::newRow("bytes") << false;
+	QTest::newRow("textstream") << true;
+}
+
+void tst_PgnGame::writeBenchmark()
+{
+	QFETCH(bool, textStream);
+
+	// Bulk export of the same game, like a tournament's PGN output
+	const int count = 100;
+	QByteArray data;
+	data.reserve(count * int(sizeof(s_verbose)));
+
+	if (textStream)
+	{
+		QBENCHMARK
+		{
+			data.resize(0);
+			QTextStream out(&data, QIODevice::WriteOnly);
+			for (int i = 0; i < count; i++)
+				m_game.write(out, PgnGame::Verbose);
+			out.flush();
+		}
+	}
+	else
+	{
+		QBENCHMARK
+		{
+			data.resize(0);
+			for (int i = 0; i < count; i++)
+				m_game.write(data, PgnGame::Verbose);
+		}
+	}
+
+	QCOMPARE(data.size(), count * int(sizeof(s_verbose) - 1));
+}
+
+QTEST_MAIN(tst_PgnGame)
+#include "tst_pgngame.moc"
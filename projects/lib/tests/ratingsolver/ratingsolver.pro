@@ -0,0 +1,4 @@
+include(../tests.pri)
+
+TARGET = tst_ratingsolver
+SOURCES += tst_ratingsolver.cpp
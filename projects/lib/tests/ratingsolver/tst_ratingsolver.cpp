@@ -0,0 +1,75 @@
+#include <QtTest/QtTest>
+#include <ratingsolver.h>
+
+
+class tst_RatingSolver: public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void order();
+		void symmetry();
+		void equalPlayers();
+};
+
+
+static bool isClose(qreal a, qreal b, qreal tolerance = 0.01)
+{
+	return qAbs(a - b) <= tolerance;
+}
+
+void tst_RatingSolver::order()
+{
+	// Round robin where each player scores 70% against
+	// every player with a higher index
+	RatingSolver solver(4);
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = i + 1; j < 4; j++)
+			solver.addResults(i, j, 20, 28);
+	}
+	QVERIFY(solver.solve());
+
+	for (int i = 1; i < 4; i++)
+		QVERIFY(solver.rating(i - 1) > solver.rating(i));
+
+	qreal sum = 0.0;
+	for (int i = 0; i < 4; i++)
+		sum += solver.rating(i);
+	QVERIFY(isClose(sum, 0.0));
+}
+
+void tst_RatingSolver::symmetry()
+{
+	// A 60% score is worth about 70 points without the prior,
+	// which pulls the ratings towards each other
+	RatingSolver solver(2);
+	solver.addResults(0, 1, 100, 120);
+	QVERIFY(solver.solve());
+
+	const qreal diff = solver.rating(0) - solver.rating(1);
+	QVERIFY(diff > 50.0 && diff < 70.5);
+	QVERIFY(isClose(solver.rating(0), -solver.rating(1)));
+
+	QVERIFY(solver.error(0) > 0.0);
+	QVERIFY(isClose(solver.error(0), solver.error(1)));
+	QVERIFY(solver.los(0, 1) > 0.9);
+	QVERIFY(isClose(solver.los(0, 1) + solver.los(1, 0), 1.0));
+}
+
+void tst_RatingSolver::equalPlayers()
+{
+	RatingSolver solver(2);
+	for (int i = 0; i < 50; i++)
+		solver.addGameResult(i % 2, (i + 1) % 2, 1);
+	QVERIFY(solver.solve());
+
+	QVERIFY(isClose(solver.rating(0), 0.0));
+	QVERIFY(isClose(solver.rating(1), 0.0));
+	QVERIFY(isClose(solver.error(0), solver.error(1)));
+	QVERIFY(isClose(solver.los(0, 1), 0.5));
+	QVERIFY(isClose(solver.los(1, 0), 0.5));
+}
+
+QTEST_MAIN(tst_RatingSolver)
+#include "tst_ratingsolver.moc"
@@ -0,0 +1,4 @@
+include(../tests.pri)
+
+TARGET = tst_swisstournament
+SOURCES += tst_swisstournament.cpp
@@ -0,0 +1,130 @@
+#include <QtTest/QtTest>
+#include <swisstournament.h>
+#include <gamemanager.h>
+#include <humanbuilder.h>
+#include <timecontrol.h>
+#include <board/result.h>
+
+
+// Exposes the pairing interface so that the games can be "played"
+// without a game manager actually running them
+class PairingTournament : public SwissTournament
+{
+	public:
+		explicit PairingTournament(GameManager* manager)
+			: SwissTournament(manager) {}
+
+		void initialize() { initializePairing(); }
+		QPair<int, int> pair() { return nextPair(); }
+		void finish(int white, int black, const Chess::Result& result)
+		{
+			addGameResult(white, black, result);
+		}
+		int totalGames() const { return gamesPerCycle() * roundMultiplier(); }
+};
+
+
+class tst_SwissTournament: public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void pairings_data() const;
+		void pairings();
+};
+
+
+void tst_SwissTournament::pairings_data() const
+{
+	QTest::addColumn<int>("players");
+	QTest::addColumn<int>("rounds");
+
+	QTest::newRow("6 players, 2 rounds") << 6 << 2;
+	QTest::newRow("6 players, 5 rounds") << 6 << 5;
+	QTest::newRow("8 players, 4 rounds") << 8 << 4;
+	QTest::newRow("8 players, 7 rounds") << 8 << 7;
+}
+
+void tst_SwissTournament::pairings()
+{
+	QFETCH(int, players);
+	QFETCH(int, rounds);
+
+	GameManager manager;
+	PairingTournament tournament(&manager);
+	for (int i = 0; i < players; i++)
+		tournament.addPlayer(new HumanBuilder(QString::number(i)),
+				     TimeControl());
+	tournament.setRoundMultiplier(rounds);
+	tournament.initialize();
+
+	QVector<int> encounters(players, 0);
+	QVector<bool> met(players * players, false);
+	QList< QPair<int, int> > running;
+	const int total = tournament.totalGames();
+	int started = 0;
+	int finished = 0;
+
+	while (started < total || !running.isEmpty())
+	{
+		while (started < total)
+		{
+			const QPair<int, int> pair(tournament.pair());
+			if (pair.first == -1)
+				break;
+
+			const int white = pair.first;
+			const int black = pair.second;
+			QVERIFY(white != black);
+			QVERIFY2(!met.at(white * players + black), "Rematch");
+
+			// Nobody gets more than a round ahead
+			int minEncounters = rounds;
+			for (int i = 0; i < players; i++)
+			{
+				if (encounters.at(i) < rounds)
+					minEncounters = qMin(minEncounters, encounters.at(i));
+			}
+			QVERIFY(encounters.at(white) <= minEncounters + 1);
+			QVERIFY(encounters.at(black) <= minEncounters + 1);
+
+			encounters[white]++;
+			encounters[black]++;
+			met[white * players + black] = true;
+			met[black * players + white] = true;
+			running.append(pair);
+			started++;
+		}
+		QVERIFY2(!running.isEmpty(), "No pairing while nothing is running");
+
+		// Finish the games out of order, with a result that
+		// depends only on the players
+		const QPair<int, int> pair(running.takeAt(finished % running.size()));
+		finished++;
+
+		const int white = pair.first;
+		const int black = pair.second;
+		Chess::Result result;
+		switch ((white + black) % 3)
+		{
+		case 0:
+			result = Chess::Result(Chess::Result::Win, white < black ?
+				 Chess::Side::White : Chess::Side::Black);
+			break;
+		case 1:
+			result = Chess::Result(Chess::Result::Draw);
+			break;
+		default:
+			result = Chess::Result(Chess::Result::Win, white > black ?
+				 Chess::Side::White : Chess::Side::Black);
+			break;
+		}
+		tournament.finish(white, black, result);
+	}
+
+	for (int i = 0; i < players; i++)
+		QCOMPARE(encounters.at(i), rounds);
+}
+
+QTEST_MAIN(tst_SwissTournament)
+#include "tst_swisstournament.moc"
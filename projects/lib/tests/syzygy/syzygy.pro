@@ -0,0 +1,4 @@
+include(../tests.pri)
+
+TARGET = tst_syzygy
+SOURCES += tst_syzygy.cpp
@@ -0,0 +1,88 @@
+#include <QtTest/QtTest>
+#include <board/standardboard.h>
+#include <board/syzygytablebase.h>
+
+
+class tst_Syzygy: public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void initTestCase();
+		
+		void tbInitialized();
+		
+		void positions_data() const;
+		void positions();
+		
+		void cleanupTestCase();
+		
+	private:
+		Chess::StandardBoard m_board;
+};
+
+
+void tst_Syzygy::initTestCase()
+{
+	SyzygyTablebase::initialize(QStringList() << "syzygy_path");
+}
+
+void tst_Syzygy::cleanupTestCase()
+{
+	SyzygyTablebase::cleanup();
+}
+
+void tst_Syzygy::tbInitialized()
+{
+	QVERIFY2(SyzygyTablebase::largest() >= 4,
+	         "4-piece tablebases unavailable");
+}
+
+void tst_Syzygy::positions_data() const
+{
+	QTest::addColumn<QString>("fen");
+	QTest::addColumn<QString>("result");
+	
+	QTest::newRow("startpos")
+		<< "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+		<< "*";
+	QTest::newRow("kings")
+		<< "8/8/4k3/8/8/3K4/8/8 w - - 0 1"
+		<< "1/2-1/2";
+	QTest::newRow("pos2")
+		<< "7k/8/8/8/5KP1/8/8/8 w - - 0 1"
+		<< "1-0";
+	QTest::newRow("pos3")
+		<< "7k/8/8/6P1/5K2/8/8/8 w - - 0 1"
+		<< "1/2-1/2";
+	QTest::newRow("pos4")
+		<< "8/2k5/8/6N1/5K2/1r6/8/8 w - - 0 1"
+		<< "1/2-1/2";
+	QTest::newRow("pos5")
+		<< "1n6/8/8/8/8/8/6R1/2K1k3 w - - 0 1"
+		<< "1-0";
+	QTest::newRow("pos10")
+		<< "2B5/8/8/8/8/2K2k2/6p1/8 b - - 0 1"
+		<< "0-1";
+	QTest::newRow("pos11")
+		<< "8/B7/8/8/8/2K2k2/6p1/8 b - - 0 1"
+		<< "1/2-1/2";
+	QTest::newRow("pos12")
+		<< "2K4N/8/8/8/7p/5k2/8/8 w - - 0 1"
+		<< "0-1";
+	QTest::newRow("capture")
+		<< "8/8/8/4k3/8/8/1q6/K7 w - - 0 1"
+		<< "1/2-1/2";
+}
+
+void tst_Syzygy::positions()
+{
+	QFETCH(QString, fen);
+	QFETCH(QString, result);
+
+	QVERIFY(m_board.setFenString(fen));
+	QCOMPARE(m_board.tablebaseResult().toShortString(), result);
+}
+
+QTEST_MAIN(tst_Syzygy)
+#include "tst_syzygy.moc"